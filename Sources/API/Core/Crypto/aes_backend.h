@@ -0,0 +1,70 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+
+#pragma once
+
+#include "../api_core.h"
+
+namespace clan
+{
+/// \addtogroup clanCore_Crypto clanCore Crypto
+/// \{
+
+/// \brief Selects the implementation used by the AES classes
+///
+/// By default the AES-NI and PCLMULQDQ instructions are used when the CPU supports them.
+/// Otherwise a constant-time bitsliced implementation is used. Neither implementation uses
+/// key or data dependent table lookups.
+class CL_API_CORE AES_Backend
+{
+/// \name Attributes
+/// \{
+
+public:
+	/// \brief Returns true if the CPU supports the AES-NI instructions
+	static bool is_hardware_supported();
+
+	/// \brief Returns true if keys set from now on will use the AES-NI instructions
+	static bool is_hardware_enabled();
+
+/// \}
+/// \name Operations
+/// \{
+
+public:
+	/// \brief Enables or disables the AES-NI instructions
+	///
+	/// This only affects keys set after the call. Disabling is mainly useful for testing and benchmarking the portable implementation.
+	static void set_hardware_enabled(bool enable);
+/// \}
+};
+
+}
+
+/// \}
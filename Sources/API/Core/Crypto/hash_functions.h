@@ -46,6 +46,8 @@ namespace clan
 /// \addtogroup clanCore_Crypto clanCore Crypto
 /// \{
 
+class WorkQueue;
+
 /// \brief A Collection of checksum functions.
 class CL_API_CORE HashFunctions
 {
@@ -68,9 +70,23 @@ public:
 	/// \brief Calculate a CRC32 checksum on the data. 
 	static ubyte32 crc32(const void *data, int size, ubyte32 running_crc=0);
 
-	/// \brief Calculate a CRC32 checksum on the data. 
+	/// \brief Returns the CRC32 checksum of two concatenated blocks.
+	///
+	/// \param crc1 = CRC32 checksum of the first block
+	/// \param crc2 = CRC32 checksum of the second block
+	/// \param size2 = Size of the second block
+	static ubyte32 crc32_combine(ubyte32 crc1, ubyte32 crc2, ubyte64 size2);
+
+	/// \brief Calculate an Adler32 checksum on the data. 
 	static ubyte32 adler32(const void *data, int size, ubyte32 running_adler32=0);
 
+	/// \brief Returns the Adler32 checksum of two concatenated blocks.
+	///
+	/// \param adler1 = Adler32 checksum of the first block
+	/// \param adler2 = Adler32 checksum of the second block
+	/// \param size2 = Size of the second block
+	static ubyte32 adler32_combine(ubyte32 adler1, ubyte32 adler2, ubyte64 size2);
+
 	/// \brief Generate SHA-1 hash from data.
 	static std::string sha1(const void *data, int size, bool uppercase = false);
 
@@ -109,6 +125,21 @@ public:
 	/// \param out_hash = char
 	static void sha1(const DataBuffer &data, unsigned char out_hash[20]);
 
+	/// \brief Calculates the SHA-1 hashes of many independent buffers
+	///
+	/// \param data = Buffers to hash
+	/// \param num_buffers = Number of buffers
+	/// \param out_hashes = Receives num_buffers * SHA1::hash_size bytes, one hash per buffer
+	static void sha1_batch(const DataBuffer *data, int num_buffers, unsigned char *out_hashes);
+
+	/// \brief Calculates the SHA-1 hashes of many independent buffers on the threads of a work queue
+	///
+	/// \param data = Buffers to hash
+	/// \param num_buffers = Number of buffers
+	/// \param out_hashes = Receives num_buffers * SHA1::hash_size bytes, one hash per buffer
+	/// \param work_queue = Work queue to use. The call blocks until all hashes are calculated.
+	static void sha1_batch(const DataBuffer *data, int num_buffers, unsigned char *out_hashes, WorkQueue &work_queue);
+
 	/// \brief Generate SHA-1 hash from data.
 	static std::string md5(const void *data, int size, bool uppercase = false);
 
@@ -224,6 +255,21 @@ public:
 	/// \param out_hash = char
 	static void sha256(const DataBuffer &data, unsigned char out_hash[32]);
 
+	/// \brief Calculates the SHA-256 hashes of many independent buffers
+	///
+	/// \param data = Buffers to hash
+	/// \param num_buffers = Number of buffers
+	/// \param out_hashes = Receives num_buffers * SHA256::hash_size bytes, one hash per buffer
+	static void sha256_batch(const DataBuffer *data, int num_buffers, unsigned char *out_hashes);
+
+	/// \brief Calculates the SHA-256 hashes of many independent buffers on the threads of a work queue
+	///
+	/// \param data = Buffers to hash
+	/// \param num_buffers = Number of buffers
+	/// \param out_hashes = Receives num_buffers * SHA256::hash_size bytes, one hash per buffer
+	/// \param work_queue = Work queue to use. The call blocks until all hashes are calculated.
+	static void sha256_batch(const DataBuffer *data, int num_buffers, unsigned char *out_hashes, WorkQueue &work_queue);
+
 	/// \brief Generate SHA-384 hash from data.
 	static std::string sha384(const void *data, int size, bool uppercase = false);
 
@@ -300,6 +346,21 @@ public:
 	/// \param out_hash = char
 	static void sha512(const DataBuffer &data, unsigned char out_hash[64]);
 
+	/// \brief Calculates the SHA-512 hashes of many independent buffers
+	///
+	/// \param data = Buffers to hash
+	/// \param num_buffers = Number of buffers
+	/// \param out_hashes = Receives num_buffers * SHA512::hash_size bytes, one hash per buffer
+	static void sha512_batch(const DataBuffer *data, int num_buffers, unsigned char *out_hashes);
+
+	/// \brief Calculates the SHA-512 hashes of many independent buffers on the threads of a work queue
+	///
+	/// \param data = Buffers to hash
+	/// \param num_buffers = Number of buffers
+	/// \param out_hashes = Receives num_buffers * SHA512::hash_size bytes, one hash per buffer
+	/// \param work_queue = Work queue to use. The call blocks until all hashes are calculated.
+	static void sha512_batch(const DataBuffer *data, int num_buffers, unsigned char *out_hashes, WorkQueue &work_queue);
+
 	/// \brief Generate SHA-512_224 hash from data.
 	static std::string sha512_224(const void *data, int size, bool uppercase = false);
 
@@ -0,0 +1,159 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "../api_core.h"
+#include "json_value.h"
+#include <memory>
+#include <string>
+
+namespace clan
+{
+/// \addtogroup clanCore_JSON clanCore JSON
+/// \{
+
+class IODevice;
+class JsonDocument_Impl;
+
+/// \brief Read-only reference to a value in a JsonDocument
+///
+/// A node is only valid as long as the document it came from.
+class CL_API_CORE JsonNode
+{
+/// \name Construction
+/// \{
+public:
+	/// \brief Constructs a null node
+	JsonNode() : document(0), index(0) { }
+/// \}
+
+/// \name Attributes
+/// \{
+public:
+	/// \brief Get value type
+	JsonValue::Type get_type() const;
+
+	/// \brief Get number of object members, array items or string bytes
+	size_t get_size() const;
+
+	/// \brief Returns the member with the specified key, or a null node if the object has no such member
+	JsonNode operator[](const char *key) const;
+	JsonNode operator[](const std::string &key) const;
+
+	/// \brief Returns the array item at the specified index
+	JsonNode operator[](int index) const;
+
+	/// \brief Returns true if the object has a member with the specified key
+	bool has_member(const std::string &key) const;
+
+	/// \brief Returns the key of an object member. Members are sorted by key.
+	std::string get_member_name(int index) const;
+
+	/// \brief Returns the value of an object member. Members are sorted by key.
+	JsonNode get_member_value(int index) const;
+
+	bool is_null() const { return get_type() == JsonValue::type_null; }
+	bool is_object() const { return get_type() == JsonValue::type_object; }
+	bool is_array() const { return get_type() == JsonValue::type_array; }
+	bool is_string() const { return get_type() == JsonValue::type_string; }
+	bool is_number() const { return get_type() == JsonValue::type_number; }
+	bool is_boolean() const { return get_type() == JsonValue::type_boolean; }
+
+	/// \brief Returns the null terminated UTF-8 data of a string value without copying it
+	const char *get_string_data() const;
+
+	/// \brief Convert value to a string
+	std::string to_string() const;
+
+	/// \brief Convert value to an int
+	int to_int() const { return (int)to_double(); }
+
+	/// \brief Convert value to a float
+	float to_float() const { return (float)to_double(); }
+
+	/// \brief Convert value to a double
+	double to_double() const;
+
+	/// \brief Convert value to a boolean
+	bool to_boolean() const;
+
+	/// \brief Copies the value and everything below it into a JsonValue tree
+	JsonValue to_value() const;
+/// \}
+
+/// \name Implementation
+/// \{
+private:
+	JsonNode(const JsonDocument_Impl *document, unsigned int index) : document(document), index(index) { }
+
+	const JsonDocument_Impl *document;
+	unsigned int index;
+	friend class JsonDocument;
+/// \}
+};
+
+/// \brief Read-only JSON document parsed into a few contiguous arrays
+///
+/// Unlike JsonValue::from_json, parsing does not allocate per value. All values,
+/// strings and object members are stored in arrays owned by the document, and
+/// object members are kept sorted by key so lookups are binary searches.
+class CL_API_CORE JsonDocument
+{
+/// \name Construction
+/// \{
+public:
+	/// \brief Constructs an empty document with a null root
+	JsonDocument();
+
+	/// \brief Parses a document from UTF-8 JSON data
+	JsonDocument(const char *data, size_t length);
+	JsonDocument(const std::string &json);
+
+	/// \brief Parses a document streamed from a device
+	JsonDocument(IODevice &device);
+
+	~JsonDocument();
+/// \}
+
+/// \name Attributes
+/// \{
+public:
+	/// \brief Returns the top level value
+	JsonNode get_root() const;
+/// \}
+
+/// \name Implementation
+/// \{
+private:
+	std::shared_ptr<JsonDocument_Impl> impl;
+/// \}
+};
+
+/// \}
+}
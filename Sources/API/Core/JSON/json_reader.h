@@ -0,0 +1,124 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "../api_core.h"
+#include <memory>
+#include <string>
+
+namespace clan
+{
+/// \addtogroup clanCore_JSON clanCore JSON
+/// \{
+
+class IODevice;
+class JsonReader_Impl;
+
+/// \brief Pull parser reading JSON one token at a time.
+///
+/// The reader does not build a tree of values. Each call to next() returns the
+/// next token in document order, and the value of the current token is fetched
+/// with get_string(), get_number() or get_boolean().
+class CL_API_CORE JsonReader
+{
+public:
+	/// \brief Token types returned by next()
+	enum Token
+	{
+		token_end,
+		token_begin_object,
+		token_end_object,
+		token_begin_array,
+		token_end_array,
+		token_key,
+		token_string,
+		token_number,
+		token_boolean,
+		token_null
+	};
+
+/// \name Construction
+/// \{
+public:
+	/// \brief Constructs a reader for UTF-8 JSON data in memory
+	///
+	/// The data is not copied and must stay valid while the reader is used.
+	JsonReader(const char *data, size_t length);
+	JsonReader(const std::string &json);
+
+	/// \brief Constructs a reader streaming UTF-8 JSON data from a device
+	JsonReader(IODevice &device);
+
+	~JsonReader();
+/// \}
+
+/// \name Attributes
+/// \{
+public:
+	/// \brief Returns the current token
+	Token get_token() const;
+
+	/// \brief Returns the object key or string value of the current token
+	const std::string &get_string() const;
+
+	/// \brief Returns the number value of the current token
+	double get_number() const;
+
+	/// \brief Returns the boolean value of the current token
+	bool get_boolean() const;
+
+	/// \brief Returns the number of objects and arrays enclosing the current token
+	int get_depth() const;
+/// \}
+
+/// \name Operations
+/// \{
+public:
+	/// \brief Reads the next token
+	///
+	/// Returns token_end when the top level value has been read.
+	/// Throws JsonException if the data is not valid JSON.
+	Token next();
+
+	/// \brief Skips the value of the current token
+	///
+	/// If the current token begins an object or array, all tokens up to and
+	/// including the matching end token are skipped. If it is a key, its value is skipped.
+	void skip();
+/// \}
+
+/// \name Implementation
+/// \{
+private:
+	std::shared_ptr<JsonReader_Impl> impl;
+/// \}
+};
+
+/// \}
+}
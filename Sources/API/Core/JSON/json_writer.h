@@ -0,0 +1,108 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "../api_core.h"
+#include <memory>
+#include <string>
+
+namespace clan
+{
+/// \addtogroup clanCore_JSON clanCore JSON
+/// \{
+
+class IODevice;
+class JsonValue;
+class JsonWriter_Impl;
+
+/// \brief Streaming JSON writer.
+///
+/// Values are written to the device as they are added, through a small internal buffer.
+/// Separators are inserted automatically. Call flush() when done writing.
+class CL_API_CORE JsonWriter
+{
+/// \name Construction
+/// \{
+public:
+	/// \brief Constructs a writer emitting UTF-8 JSON to a device
+	JsonWriter(IODevice &device);
+
+	/// \brief Flushes remaining output
+	~JsonWriter();
+/// \}
+
+/// \name Operations
+/// \{
+public:
+	/// \brief Begins an object value
+	void begin_object();
+
+	/// \brief Ends the current object
+	void end_object();
+
+	/// \brief Begins an array value
+	void begin_array();
+
+	/// \brief Ends the current array
+	void end_array();
+
+	/// \brief Writes the key of the next object member
+	void write_key(const std::string &key);
+	void write_key(const char *key);
+
+	/// \brief Writes a string value
+	void write_string(const std::string &value);
+	void write_string(const char *value);
+
+	/// \brief Writes a number value
+	void write_number(int value);
+	void write_number(double value);
+
+	/// \brief Writes a boolean value
+	void write_boolean(bool value);
+
+	/// \brief Writes a null value
+	void write_null();
+
+	/// \brief Writes a complete value tree
+	void write_value(const JsonValue &value);
+
+	/// \brief Writes buffered output to the device
+	void flush();
+/// \}
+
+/// \name Implementation
+/// \{
+private:
+	std::shared_ptr<JsonWriter_Impl> impl;
+/// \}
+};
+
+/// \}
+}
@@ -85,6 +85,9 @@ public:
 	/// \brief Returns true if a resource exists.
 	bool resource_exists(const std::string &resource_id) const;
 
+	/// \brief Returns true if the document was loaded from a resource bundle.
+	bool is_bundle() const;
+
 	/// \brief Returns all the resource sections available.
 	std::vector<std::string> get_section_names() const;
 
@@ -172,6 +175,28 @@ public:
 	/// \param directory = Virtual Directory
 	void load(IODevice file, const std::string &base_path = std::string(), const FileSystem &file_system = FileSystem());
 
+	/// \brief Save resources as a precompiled binary resource bundle.
+	///
+	/// The bundle contains an interned string table, a perfect hash resource index and the
+	/// resource elements in binary form, so loading it does not parse any XML.
+	///
+	/// \param filename = the filename to save
+	/// \param embed_files = Copy files referenced by file attributes into the bundle
+	void save_bundle(const std::string &filename, bool embed_files = true);
+
+	/// \brief Save bundle
+	///
+	/// \param file = IODevice
+	/// \param embed_files = Copy files referenced by file attributes into the bundle
+	void save_bundle(IODevice file, bool embed_files = true);
+
+	/// \brief Load a precompiled resource bundle.
+	///
+	/// The bundle is memory mapped and resources are decoded on first access. Files embedded
+	/// in the bundle are opened directly from the mapping, other files relative to the bundle.
+	/// load(filename) also detects bundles automatically.
+	void load_bundle(const std::string &filename);
+
 /// \}
 /// \name Implementation
 /// \{
@@ -114,6 +114,7 @@ private:
 	std::shared_ptr<XMLResourceNode_Impl> impl;
 
 	friend class XMLResourceDocument;
+	friend class XMLResourceDocument_Impl;
 /// \}
 };
 
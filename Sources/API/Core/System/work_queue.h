@@ -32,6 +32,7 @@
 #include "../api_core.h"
 #include <memory>
 #include <functional>
+#include <vector>
 
 namespace clan
 {
@@ -51,24 +52,49 @@ public:
 	virtual void work_completed() { }
 };
 
+/// \brief Scheduling priority of a work item
+///
+/// Worker threads always pick the highest priority item available.
+enum WorkPriority
+{
+	work_priority_high,
+	work_priority_normal,
+	work_priority_low
+};
+
 class WorkQueue_Impl;
 
 /// \brief Thread pool for worker threads
+///
+/// Each worker thread owns a local queue. Items queued from a worker thread go to its own queue,
+/// while items queued from other threads are distributed among the workers. Idle workers steal
+/// items from the queues of busy workers.
 class CL_API_CORE WorkQueue
 {
 public:
 	/// \brief Constructs a work queue
 	/// \param serial_queue If true, executes items in the order they are queued, one at a time
-	WorkQueue(bool serial_queue = false);
+	/// \param num_threads Number of worker threads. If zero, one less than the number of cores is used. Ignored for serial queues.
+	WorkQueue(bool serial_queue = false, int num_threads = 0);
 	~WorkQueue();
 
 	/// \brief Queue some work to be executed on a worker thread
 	///
 	/// Transfers ownership of the item queued. WorkQueue will delete the item.
-	void queue(WorkItem *item);
+	void queue(WorkItem *item, WorkPriority priority = work_priority_normal);
 
 	/// \brief Queue some work to be executed on a worker thread
-	void queue(const std::function<void()> &func);
+	void queue(const std::function<void()> &func, WorkPriority priority = work_priority_normal);
+
+	/// \brief Queue several work items at once
+	///
+	/// Transfers ownership of the items queued. Cheaper than queueing the items one by one.
+	void queue_batch(const std::vector<WorkItem *> &items, WorkPriority priority = work_priority_normal);
+
+	/// \brief Queue child work items and a parent item that is processed when all children have been processed
+	///
+	/// Transfers ownership of all items. The parent may itself queue further work.
+	void queue_children(WorkItem *parent, const std::vector<WorkItem *> &children, WorkPriority priority = work_priority_normal);
 
 	/// \brief Queue some work to be executed on the main WorkQueue thread
 	void work_completed(const std::function<void()> &func);
@@ -76,6 +102,9 @@ public:
 	/// \brief Returns the number of items currently queued
 	int get_items_queued() const;
 
+	/// \brief Returns the number of worker threads
+	int get_num_threads() const;
+
 private:
 
 	std::shared_ptr<WorkQueue_Impl> impl;
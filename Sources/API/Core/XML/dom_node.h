@@ -425,6 +425,8 @@ protected:
 	friend class DomDocument;
 
 	friend class DomNamedNodeMap;
+
+	friend class XPathEvaluator_Impl;
 /// \}
 };
 
@@ -0,0 +1,111 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "../api_core.h"
+#include <string>
+
+namespace clan
+{
+/// \addtogroup clanCore_XML clanCore XML
+/// \{
+
+/// \brief Characters of a XML token, pointing directly into the XML data.
+///
+/// The string is only valid as long as the data it points into. XML entities are not
+/// replaced until to_string() is called.
+class CL_API_CORE XMLTokenString
+{
+/// \name Construction
+/// \{
+
+public:
+	XMLTokenString() : data(0), length(0), escaped(false)
+	{
+	}
+
+	/// \brief Constructs a XMLTokenString
+	///
+	/// \param data = First character
+	/// \param length = Number of characters
+	/// \param escaped = True if the characters may contain XML entities
+	XMLTokenString(const char *data, size_t length, bool escaped = false) : data(data), length(length), escaped(escaped)
+	{
+	}
+
+/// \}
+/// \name Attributes
+/// \{
+
+public:
+	/// \brief Returns the characters as they appear in the XML data
+	const char *get_data() const { return data; }
+
+	/// \brief Returns the number of characters in the XML data
+	size_t get_length() const { return length; }
+
+	/// \brief Returns true if there are no characters
+	bool empty() const { return length == 0; }
+
+	/// \brief Returns true if the characters may contain XML entities
+	bool is_escaped() const { return escaped; }
+
+	/// \brief Compares the characters as they appear in the XML data
+	bool operator==(const char *text) const;
+	bool operator==(const std::string &text) const;
+	bool operator!=(const char *text) const { return !(*this == text); }
+	bool operator!=(const std::string &text) const { return !(*this == text); }
+
+/// \}
+/// \name Operations
+/// \{
+
+public:
+	/// \brief Returns the characters with XML entities replaced
+	std::string to_string() const;
+
+	/// \brief Stores the characters with XML entities replaced in out_text
+	///
+	/// Reuses the memory already allocated by out_text.
+	void to_string(std::string &out_text) const;
+
+/// \}
+/// \name Implementation
+/// \{
+
+private:
+	const char *data;
+	size_t length;
+	bool escaped;
+/// \}
+};
+
+}
+
+/// \}
@@ -0,0 +1,97 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "../api_core.h"
+#include "xml_token.h"
+#include "xml_token_string.h"
+#include <vector>
+#include <utility>
+
+namespace clan
+{
+/// \addtogroup clanCore_XML clanCore XML
+/// \{
+
+/// \brief XML token referencing the XML data it was read from.
+///
+/// A token view is returned by XMLTokenizer::next_view(). It does not copy or unescape
+/// any text and is only valid as long as the data held by the tokenizer.
+class CL_API_CORE XMLTokenView
+{
+/// \name Construction
+/// \{
+
+public:
+	XMLTokenView() : type(XMLToken::NULL_TOKEN), variant(XMLToken::SINGLE)
+	{
+	}
+
+/// \}
+/// \name Attributes
+/// \{
+
+public:
+	// Attribute name/value pair.
+	typedef std::pair<XMLTokenString, XMLTokenString> Attribute;
+
+	/// \brief The token type.
+	XMLToken::TokenType type;
+
+	/// \brief The token variant.
+	XMLToken::TokenVariant variant;
+
+	/// \brief The name of the token.
+	XMLTokenString name;
+
+	/// \brief The value of the token.
+	XMLTokenString value;
+
+	/// \brief All the attributes attached to the token.
+	std::vector<Attribute> attributes;
+
+/// \}
+/// \name Operations
+/// \{
+
+public:
+	/// \brief Copies the token into a XMLToken, replacing XML entities
+	void to_token(XMLToken &out_token) const;
+
+/// \}
+/// \name Implementation
+/// \{
+
+private:
+/// \}
+};
+
+}
+
+/// \}
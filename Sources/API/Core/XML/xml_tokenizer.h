@@ -39,6 +39,7 @@ namespace clan
 
 class IODevice;
 class XMLToken;
+class XMLTokenView;
 class XMLTokenizer_Impl;
 
 /// \brief The XML Tokenizer breaks a XML file into XML tokens.
@@ -60,8 +61,20 @@ public:
 	/// \param input = IODevice
 	XMLTokenizer(IODevice &input);
 
+	/// \brief Constructs a XMLTokenizer reading XML data in memory
+	///
+	/// The data is not copied. It must stay valid as long as the tokenizer and the
+	/// token views returned by next_view() are used.
+	///
+	/// \param data = UTF-8 XML data, for example a memory mapped file
+	/// \param size = Size of the data in bytes
+	XMLTokenizer(const void *data, int size);
+
 	virtual ~XMLTokenizer();
 
+	/// \brief Creates a XMLTokenizer that is fed the XML data in chunks using add_data()
+	static XMLTokenizer create_incremental();
+
 /// \}
 /// \name Attributes
 /// \{
@@ -73,6 +86,12 @@ public:
 	/// \brief If enabled, will eat any whitespace between tags.
 	void set_eat_whitespace(bool enable);
 
+	/// \brief Returns true if an incremental tokenizer reached the end of the data added so far.
+	///
+	/// The token that was being read is returned again by the next call to next() or next_view()
+	/// after more data has been added.
+	bool is_data_needed() const;
+
 /// \}
 /// \name Operations
 /// \{
@@ -86,6 +105,23 @@ public:
 	/// \param out_token = XMLToken
 	void next(XMLToken *out_token);
 
+	/// \brief Reads the next token without copying or unescaping any text.
+	///
+	/// The token view points into the tokenizer data and is valid until the data is
+	/// released or add_data() is called.
+	///
+	/// \param out_token = Receives the token
+	/// \return false if no token is available
+	bool next_view(XMLTokenView *out_token);
+
+	/// \brief Adds a chunk of XML data to an incremental tokenizer
+	///
+	/// The data is copied. Token views returned earlier are no longer valid afterwards.
+	void add_data(const void *data, int size);
+
+	/// \brief Tells an incremental tokenizer that all data has been added
+	void end_of_data();
+
 /// \}
 /// \name Implementation
 /// \{
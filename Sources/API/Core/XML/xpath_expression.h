@@ -0,0 +1,113 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "xpath_object.h"
+
+namespace clan
+{
+/// \addtogroup clanCore_XML clanCore XML
+/// \{
+
+class DomNode;
+class XPathExpression_Impl;
+
+/// \brief Compiled XPath expression.
+///
+/// The expression is parsed once and can then be evaluated any number of times.
+/// Location paths using the child, attribute, self, parent and descendant axes with
+/// position and attribute predicates are compiled into an evaluation plan that walks
+/// the document directly. Other expressions are evaluated by XPathEvaluator.
+class XPathExpression
+{
+/// \name Construction
+/// \{
+
+public:
+	/// \brief Constructs a null instance.
+	XPathExpression();
+
+	/// \brief Constructs a XPathExpression
+	///
+	/// \param expression = XPath expression
+	XPathExpression(const std::string &expression);
+
+	/// \brief Returns a compiled expression from the expression cache
+	///
+	/// The cache keeps the most recently used expressions.
+	static XPathExpression get_cached(const std::string &expression);
+
+	/// \brief Sets how many expressions the expression cache keeps (default is 256)
+	static void set_cache_size(int max_expressions);
+
+/// \}
+/// \name Attributes
+/// \{
+
+public:
+	/// \brief Returns true if this is a null instance
+	bool is_null() const { return !impl; }
+
+	/// \brief Returns the expression string
+	const std::string &get_expression() const;
+
+	/// \brief Returns true if the expression compiled into a location path evaluation plan
+	bool is_location_path() const;
+
+/// \}
+/// \name Operations
+/// \{
+
+public:
+	/// \brief Evaluate
+	///
+	/// \param context_node = Dom Node
+	///
+	/// \return XPath Object
+	XPathObject evaluate(const DomNode &context_node) const;
+
+	/// \brief Returns all the nodes matching the expression
+	///
+	/// \param context_node = Dom Node
+	std::vector<DomNode> select_nodes(const DomNode &context_node) const;
+
+/// \}
+/// \name Implementation
+/// \{
+
+private:
+	std::shared_ptr<XPathExpression_Impl> impl;
+/// \}
+};
+
+}
+
+/// \}
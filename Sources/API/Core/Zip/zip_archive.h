@@ -90,6 +90,15 @@ public:
 	/// \brief Opens a file in the archive.
 	IODevice open_file(const std::string &filename);
 
+	/// \brief Returns the contents of a stored (uncompressed) file without copying them.
+	///
+	/// Only available if the archive was constructed from a filename and could be memory mapped.
+	/// The data stays valid until the archive is reloaded or its last copy is destroyed.
+	/// \param filename = Filename in archive
+	/// \param out_size = Receives the size of the file
+	/// \return Pointer to the file contents, or null if the file is compressed or the archive is not memory mapped
+	const unsigned char *get_file_view(const std::string &filename, int &out_size);
+
 	/// \brief Get full path to source:
 	std::string get_pathname(const std::string &filename);
 
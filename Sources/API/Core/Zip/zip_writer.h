@@ -40,6 +40,8 @@ namespace clan
 /// \{
 
 class IODevice;
+class DataBuffer;
+class WorkQueue;
 class ZipWriter_Impl;
 
 /// \brief Zip file writer.
@@ -56,6 +58,13 @@ public:
 	/// \param storeFilenamesAsUTF8 = bool
 	ZipWriter(IODevice &output, bool storeFilenamesAsUTF8 = false);
 
+	/// \brief Constructs a ZipWriter compressing entries added with add_file on a work queue
+	///
+	/// \param output = IODevice
+	/// \param work_queue = Work queue compressing the file entries
+	/// \param storeFilenamesAsUTF8 = bool
+	ZipWriter(IODevice &output, WorkQueue &work_queue, bool storeFilenamesAsUTF8 = false);
+
 /// \}
 /// \name Operations
 /// \{
@@ -70,6 +79,12 @@ public:
 	/// \brief Ends the file entry.
 	void end_file();
 
+	/// \brief Adds a complete file entry to the zip file.
+	///
+	/// With a work queue, small entries are compressed concurrently and large entries are compressed
+	/// in parallel blocks. Entries are always written in the order they were added.
+	void add_file(const std::string &filename, const DataBuffer &data, bool compress);
+
 	/// \brief Writes the table of contents part of the zip file.
 	void write_toc();
 
@@ -35,6 +35,7 @@ namespace clan
 /// \{
 
 class DataBuffer;
+class WorkQueue;
 
 /// \brief Deflate compressor
 class ZLibCompression
@@ -42,6 +43,9 @@ class ZLibCompression
 /// \name Operations
 /// \{
 public:
+	/// \brief Size of the blocks compressed in parallel
+	static const int parallel_block_size = 512*1024;
+
 	enum CompressionMode
 	{
 		default_strategy,
@@ -58,6 +62,19 @@ public:
 	// \param mode Compression strategy
 	static DataBuffer compress(const DataBuffer &data, bool raw = true, int compression_level = 6, CompressionMode mode = default_strategy);
 
+	// \brief Compress data in parallel on a work queue
+	//
+	// The data is split into blocks of parallel_block_size bytes that are deflated independently,
+	// each primed with the 32 KB preceding it. The output is a single deflate stream that only
+	// depends on the data, not on the number of threads. Data no larger than one block is compressed
+	// as with compress(). Must not be called from a worker thread of work_queue.
+	// \param data Data to compress
+	// \param work_queue Work queue compressing the blocks
+	// \param raw Skips header if true
+	// \param compression_level Compression level in range 0-9. 0 = no compression, 1 = best speed, 6 = default, 9 = best compression.
+	// \param mode Compression strategy
+	static DataBuffer compress(const DataBuffer &data, WorkQueue &work_queue, bool raw = true, int compression_level = 6, CompressionMode mode = default_strategy);
+
 	// \brief Decompress data
 	// \param data Data to compress
 	// \param raw Skips header if true
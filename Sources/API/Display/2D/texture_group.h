@@ -106,6 +106,12 @@ public:
 	/// \brief Allocate space for another sub texture.
 	Subtexture add(GraphicContext &context, const Size &size);
 
+	/// \brief Allocate space for another sub texture in one of the existing textures.
+	///
+	/// Unlike add(), no new texture is created and the allocation policy is ignored.
+	/// Returns a null Subtexture if none of the textures have room.
+	Subtexture try_add(GraphicContext &context, const Size &size);
+
 	/// \brief Deallocate space, from a previously allocated texture
 	///
 	/// Warning - It is advised to set TextureAllocationPolicy to search_previous_textures
@@ -210,6 +210,14 @@ public:
 	/// \return The character index. -1 = Not at specified point
 	int get_character_index(Canvas &canvas, const std::string &text, const Point &point);
 
+	/// \brief Prepares the glyphs used by a text, so drawing it later does not stall
+	///
+	/// Glyphs not already cached are rasterized in parallel when the font engine supports it.
+	///
+	/// \param canvas = Canvas
+	/// \param text = The characters to prefetch
+	void prefetch(Canvas &canvas, const std::string &text);
+
 /// \}
 /// \name Implementation
 /// \{
@@ -71,23 +71,62 @@ public:
 	/// \param filename File name of JPEG.
 	/// \param directory Directory that the file name is relative to.
 	/// \param quality The quality level of the JPEG (0-100), 100 being best quality.
+	/// \param restart_interval Number of MCUs between restart markers, or 0 for none. Restart markers allow the loader to decode the image on several cores.
 	static void save(
 		PixelBuffer buffer,
 		const std::string &filename,
 		FileSystem &fs,
-		int quality = 85);
+		int quality = 85,
+		int restart_interval = 0);
 
 	static void save(
 		PixelBuffer buffer,
 		const std::string &fullname,
-		int quality = 85);
+		int quality = 85,
+		int restart_interval = 0);
 
 	static void save(
 		PixelBuffer buffer,
 		IODevice &file,
-		int quality = 85);
+		int quality = 85,
+		int restart_interval = 0);
 
 /// \}
+/// \name Attributes
+/// \{
+
+public:
+	/// \brief Instruction sets the JPEG decoder can use for the IDCT and color conversion
+	enum DecoderInstructions
+	{
+		decoder_scalar,
+		decoder_sse2,
+		decoder_avx2
+	};
+
+	/// \brief Returns true if the CPU supports the given decoder instructions
+	static bool is_decoder_instructions_supported(DecoderInstructions instructions);
+
+	/// \brief Returns the instructions used by images loaded from now on
+	static DecoderInstructions get_decoder_instructions();
+
+/// \}
+/// \name Operations
+/// \{
+
+public:
+	/// \brief Selects the instructions used by the JPEG decoder
+	///
+	/// By default the fastest instructions the CPU supports are used. All of them decode to the same pixels,
+	/// except the scalar code, which may round differently. This is mainly useful for testing and benchmarking.
+	/// Throws an exception if the CPU does not support the instructions.
+	static void set_decoder_instructions(DecoderInstructions instructions);
+
+	/// \brief Decodes images with restart markers on several threads, even when they are small or the machine has a single core
+	///
+	/// Mainly useful for testing the parallel decoder on any machine.
+	static void set_parallel_decode_forced(bool force);
+/// \}
 };
 
 }
@@ -68,6 +68,25 @@ public:
 	/// \return Pixel Buffer
 	static PixelBuffer load(IODevice &dev, bool srgb = false);
 
+	/// \brief Load into a specific pixel format
+	///
+	/// Decoded rows are converted directly into the pixel buffer, avoiding
+	/// an intermediate full size image in the native PNG format.
+	///
+	/// \param name Name of the file to load.
+	/// \param fs File system that file name is relative to.
+	/// \param format Pixel format of the returned pixel buffer.
+	static PixelBuffer load(
+		const std::string &filename,
+		const FileSystem &fs,
+		TextureFormat format);
+
+	static PixelBuffer load(
+		const std::string &fullname,
+		TextureFormat format);
+
+	static PixelBuffer load(IODevice &dev, TextureFormat format);
+
 	/// \brief Called to save a given PixelBuffer to a file
 	static void save(
 		PixelBuffer buffer,
@@ -32,6 +32,7 @@
 #include "../api_display.h"
 #include "../../Core/Resources/resource.h"
 #include <memory>
+#include <string>
 
 namespace clan
 {
@@ -48,6 +49,37 @@ class Font;
 class FontDescription;
 class CollisionOutline;
 
+/// \brief Statistics for asynchronous resource loading in a DisplayCache
+class DisplayCacheLoadStats
+{
+public:
+	DisplayCacheLoadStats()
+	: decode_queue_depth(0), upload_queue_depth(0), resources_loaded(0), resources_failed(0), average_latency(0.0f), max_latency(0.0f)
+	{
+	}
+
+	/// \brief Number of resources waiting for their files to be decoded
+	int decode_queue_depth;
+
+	/// \brief Number of decoded resources waiting to be uploaded to the GPU
+	int upload_queue_depth;
+
+	/// \brief Number of resources loaded asynchronously
+	int resources_loaded;
+
+	/// \brief Number of asynchronously requested resources that could not be loaded
+	int resources_failed;
+
+	/// \brief Error message of the last resource that could not be loaded
+	std::string last_error;
+
+	/// \brief Average time in milliseconds from request until a resource was uploaded
+	float average_latency;
+
+	/// \brief Longest time in milliseconds from request until a resource was uploaded
+	float max_latency;
+};
+
 class CL_API_DISPLAY DisplayCache
 {
 public:
@@ -58,6 +90,32 @@ public:
 	virtual Resource<Font> get_font(Canvas &canvas, const FontDescription &desc) = 0;
 	virtual Resource<CollisionOutline> get_collision(const std::string &id) = 0;
 
+	/// \brief Returns a sprite without blocking on file I/O
+	///
+	/// The returned resource is empty until the sprite has been loaded by process_uploads.
+	/// Use Resource::updated() to find out when it has been set.
+	/// If the sprite cannot be loaded it is set to a null sprite and the error is reported by get_load_stats().
+	virtual Resource<Sprite> get_sprite_async(Canvas &canvas, const std::string &id) { return get_sprite(canvas, id); }
+
+	/// \brief Returns an image without blocking on file I/O
+	virtual Resource<Image> get_image_async(Canvas &canvas, const std::string &id) { return get_image(canvas, id); }
+
+	/// \brief Returns a texture without blocking on file I/O
+	virtual Resource<Texture> get_texture_async(GraphicContext &gc, const std::string &id) { return get_texture(gc, id); }
+
+	/// \brief Starts decoding the files of all sprites, images and textures in a section and its subsections
+	virtual void preload(const std::string &section) { }
+
+	/// \brief Uploads decoded resources to the GPU
+	///
+	/// Call this once per frame on the thread owning the graphic context.
+	/// \param canvas = Canvas to create the resources for
+	/// \param max_upload_bytes = Pixel data budget for this call. At least one resource is uploaded if any is ready.
+	virtual void process_uploads(Canvas &canvas, int max_upload_bytes = 4 * 1024 * 1024) { }
+
+	/// \brief Returns asynchronous loading statistics
+	virtual DisplayCacheLoadStats get_load_stats() const { return DisplayCacheLoadStats(); }
+
 	static DisplayCache &get(const ResourceManager &resources);
 	static void set(ResourceManager &resources, const std::shared_ptr<DisplayCache> &cache);
 };
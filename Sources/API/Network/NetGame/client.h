@@ -32,6 +32,7 @@
 #include "../api_network.h"
 
 #include "connection_site.h"	// TODO: Remove
+#include "connection.h"
 #include "../../Core/System/event.h"
 #include "../../Core/Signals/signal_v0.h"
 #include "../../Core/Signals/signal_v1.h"
@@ -42,7 +43,6 @@ namespace clan
 /// \{
 
 class NetGameEvent;
-class NetGameConnection;
 class NetGameClient_Impl;
 
 /// \brief NetGameClient
@@ -68,6 +68,28 @@ public:
 	///
 	/// \param game_event = Net Game Event
 	void send_event(const NetGameEvent &game_event);
+
+	/// \brief Set when queued events are sent
+	///
+	/// \param policy = Flush policy (default is flush_immediately)
+	void set_flush_policy(NetGameConnection::FlushPolicy policy);
+
+	/// \brief Set if repeated events only send the arguments that changed
+	///
+	/// \param enable = Enable delta encoding (default is false)
+	void set_delta_encoding(bool enable);
+
+	/// \brief Set if the compact wire format is announced when connecting
+	///
+	/// Only enable this when the server is known to support the format. Older servers receive
+	/// the announcement as an ordinary event named "_compact".
+	///
+	/// \param enable = Announce the compact format (default is false)
+	void set_compact_encoding(bool enable);
+
+	/// \brief Sends all queued events
+	void flush();
+
 	Signal_v1<const NetGameEvent &> &sig_event_received();
 
 	/// \brief Sig connected
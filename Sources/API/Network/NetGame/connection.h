@@ -45,11 +45,21 @@ namespace clan
 
 class NetGameConnectionSite;
 class NetGameConnection_Impl;
+class NetGameConnectionReactor;
 
 /// \brief NetGameConnection
 class CL_API_NETWORK NetGameConnection
 {
 public:
+	/// \brief Controls when queued events are written to the socket
+	enum FlushPolicy
+	{
+		/// \brief Events are sent as soon as the connection thread picks them up
+		flush_immediately,
+
+		/// \brief Events are held back until flush() is called, typically once per game tick
+		flush_per_tick
+	};
 
 	/// \brief Constructs a NetGameConnection
 	///
@@ -78,6 +88,35 @@ public:
 	/// \param game_event = Net Game Event
 	void send_event(const NetGameEvent &game_event);
 
+	/// \brief Set when queued events are sent
+	///
+	/// With flush_per_tick all events queued during a tick are sent with a single write when
+	/// flush() is called. Large backlogs are still flushed early to bound memory use.
+	///
+	/// \param policy = Flush policy (default is flush_immediately)
+	void set_flush_policy(FlushPolicy policy);
+
+	/// \brief Set if repeated events only send the arguments that changed
+	///
+	/// Applies once the compact wire format is in use, see announce_compact_encoding().
+	/// Each event name remembers the arguments it was last sent with, so this works best for
+	/// frequent updates such as positions, where most arguments stay the same.
+	///
+	/// \param enable = Enable delta encoding (default is false)
+	void set_delta_encoding(bool enable);
+
+	/// \brief Announces that this side understands the compact wire format
+	///
+	/// A peer that supports the format answers the announcement, and both sides then send in
+	/// the compact format. A connection answers announcements it receives automatically, so
+	/// only the connecting side needs to call this. Older versions of ClanLib receive the
+	/// announcement as an ordinary event named "_compact", so only call this when the peer
+	/// is known to support the format.
+	void announce_compact_encoding();
+
+	/// \brief Sends all queued events
+	void flush();
+
 	/// \brief Disconnects a client
 	void disconnect();
 
@@ -87,11 +126,16 @@ public:
 	SocketName get_remote_name() const;
 
 private:
+	/// \brief Constructs a connection serviced by the reactor threads of a NetGameServer
+	NetGameConnection(NetGameConnectionSite *site, const TCPConnection &connection, NetGameConnectionReactor *reactor);
+
 	/// \brief Disallow copy constructors
 	NetGameConnection(NetGameConnection &other);
 	NetGameConnection &operator =(const NetGameConnection &other);
 
 	NetGameConnection_Impl *impl;
+
+	friend class NetGameServer;
 };
 
 }
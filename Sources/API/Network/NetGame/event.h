@@ -90,7 +90,7 @@ public:
 	/// \brief Get Name
 	///
 	/// \return name
-	std::string get_name() const { return name; };
+	const std::string &get_name() const { return name; };
 
 	unsigned int get_argument_count() const;
 
@@ -99,7 +99,7 @@ public:
 	/// \param index = value
 	///
 	/// \return Net Game Event Value
-	NetGameEventValue get_argument(unsigned int index) const;
+	const NetGameEventValue &get_argument(unsigned int index) const;
 
 	/// \brief Add argument
 	///
@@ -32,6 +32,7 @@
 #include "../api_network.h"
 
 #include "connection_site.h"	// TODO: Remove
+#include "connection.h"
 #include "../../Core/System/event.h"
 #include "../../Core/Signals/signal_v1.h"
 #include "../../Core/Signals/signal_v2.h"
@@ -42,7 +43,6 @@ namespace clan
 /// \{
 
 class NetGameEvent;
-class NetGameConnection;
 class NetGameServer_Impl;
 
 /// \brief NetGameServer
@@ -50,6 +50,19 @@ class CL_API_NETWORK NetGameServer : NetGameConnectionSite
 {
 public:
 	NetGameServer();
+
+	/// \brief Constructs a NetGameServer
+	///
+	/// In reactor mode connections do not get a thread each. Instead a small pool of
+	/// threads waits for socket activity on all connections using epoll, which lets a
+	/// server handle thousands of clients. Events from a connection are still received
+	/// in order. Reactor mode is only available on Linux; other platforms use one
+	/// thread per connection.
+	///
+	/// \param use_reactor = Use event driven connection handling
+	/// \param num_reactor_threads = Number of reactor threads (0 = one less than the number of cores)
+	NetGameServer(bool use_reactor, int num_reactor_threads = 0);
+
 	~NetGameServer();
 
 	/// \brief Start
@@ -74,6 +87,19 @@ public:
 	/// \param game_event = Net Game Event
 	void send_event(const NetGameEvent &game_event);
 
+	/// \brief Set when queued events are sent, for current and future connections
+	///
+	/// \param policy = Flush policy (default is flush_immediately)
+	void set_flush_policy(NetGameConnection::FlushPolicy policy);
+
+	/// \brief Set if repeated events only send the arguments that changed, for current and future connections
+	///
+	/// \param enable = Enable delta encoding (default is false)
+	void set_delta_encoding(bool enable);
+
+	/// \brief Sends the events queued on all connections
+	void flush();
+
 	Signal_v1<NetGameConnection *> &sig_client_connected();
 	Signal_v2<NetGameConnection *, const std::string &> &sig_client_disconnected();
 	Signal_v2<NetGameConnection *, const NetGameEvent &> &sig_event_received();
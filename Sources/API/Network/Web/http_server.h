@@ -48,8 +48,21 @@ class CL_API_NETWORK HTTPServer
 /// \{
 
 public:
+	/// \brief Constructs a HTTP server that uses one thread per connection
 	HTTPServer();
 
+	/// \brief Constructs a HTTP server
+	///
+	/// In reactor mode a single thread waits for socket activity on all connections and
+	/// requests are processed by a fixed pool of worker threads. Connections are kept alive
+	/// between requests and pipelined requests are answered in order. Request bodies must
+	/// have a Content-Length. Reactor mode is only available on Linux; other platforms
+	/// use one thread per connection.
+	///
+	/// \param use_reactor = Use event driven connection handling
+	/// \param num_workers = Number of worker threads (0 = one less than the number of cores)
+	HTTPServer(bool use_reactor, int num_workers = 0);
+
 	~HTTPServer();
 
 /// \}
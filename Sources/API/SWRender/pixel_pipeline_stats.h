@@ -0,0 +1,78 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+
+#pragma once
+
+#include "api_swrender.h"
+#include "../Core/System/cl_platform.h"
+
+namespace clan
+{
+/// \addtogroup clanSWRender_Display clanSWRender Display
+/// \{
+
+/// \brief Performance counters of the pixel pipeline
+///
+/// Counters are always collected. Times are in microseconds and are only measured while profiling is enabled.
+class PixelPipelineStats
+{
+//!Construction
+public:
+	PixelPipelineStats()
+	: commands_queued(0), producer_stalls(0), worker_parks(0), queue_time(0), wait_for_space_time(0), wait_for_workers_time(0), alloc_time(0)
+	{
+	}
+
+//!Attributes
+public:
+	/// \brief Number of commands queued
+	ubyte64 commands_queued;
+
+	/// \brief Number of times the queueing thread had to sleep because the command ring was full
+	ubyte64 producer_stalls;
+
+	/// \brief Number of times a worker thread went to sleep waiting for commands
+	ubyte64 worker_parks;
+
+	/// \brief Time spent queueing commands
+	ubyte64 queue_time;
+
+	/// \brief Time the queueing thread spent waiting for space in the command ring
+	ubyte64 wait_for_space_time;
+
+	/// \brief Time spent waiting for the worker threads to finish
+	ubyte64 wait_for_workers_time;
+
+	/// \brief Time spent allocating and freeing commands
+	ubyte64 alloc_time;
+};
+
+}
+
+/// \}
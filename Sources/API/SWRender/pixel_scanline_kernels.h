@@ -0,0 +1,121 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+
+#pragma once
+
+#include "api_swrender.h"
+#include "../Display/Render/graphic_context.h"
+
+namespace clan
+{
+/// \addtogroup clanSWRender_Display clanSWRender Display
+/// \{
+
+/// \brief Horizontal span of pixels rendered by PixelScanlineKernels
+///
+/// Texture coordinates are 16.16 fixed point texel positions and colors are 16.16 fixed point (65536 is 1.0).
+/// The slopes are added once per pixel.
+class PixelScanline
+{
+//!Construction
+public:
+	PixelScanline()
+	: dest(0), length(0), src(0), src_width(0), src_height(0), tx(0), ty(0), red(0), green(0), blue(0), alpha(0),
+	  slope_tx(0), slope_ty(0), slope_red(0), slope_green(0), slope_blue(0), slope_alpha(0)
+	{
+	}
+
+//!Attributes
+public:
+	unsigned int *dest;
+	int length;
+
+	const unsigned int *src;
+	int src_width;
+	int src_height;
+
+	int tx, ty;
+	int red, green, blue, alpha;
+	int slope_tx, slope_ty;
+	int slope_red, slope_green, slope_blue, slope_alpha;
+};
+
+/// \brief Textured scanline kernels for ARGB8888 targets
+///
+/// The SSE2 and AVX2 kernels produce exactly the same pixels as the reference kernel.
+class API_SWRender PixelScanlineKernels
+{
+//!Attributes
+public:
+	enum InstructionSet
+	{
+		isa_reference,
+		isa_sse2,
+		isa_avx2
+	};
+
+	enum BlendMode
+	{
+		/// \brief Source alpha, one minus source alpha
+		blend_normal,
+
+		/// \brief One, one minus source alpha
+		blend_premultiplied,
+
+		/// \brief One, one
+		blend_additive,
+
+		/// \brief One, zero
+		blend_copy
+	};
+
+	/// \brief Returns the fastest instruction set supported by the CPU
+	static InstructionSet get_instruction_set();
+
+	/// \brief Returns the blend mode matching the blend functions. Unsupported combinations use blend_normal.
+	static BlendMode get_blend_mode(BlendFunc src, BlendFunc dest);
+
+//!Operations
+public:
+	/// \brief Renders a span using nearest texel sampling with repeat wrapping
+	static void render_nearest(PixelScanline scanline, BlendMode blend, InstructionSet isa);
+	static void render_nearest(const PixelScanline &scanline, BlendMode blend) { render_nearest(scanline, blend, get_instruction_set()); }
+
+	/// \brief Renders a span using bilinear texel sampling with repeat wrapping
+	static void render_linear(PixelScanline scanline, BlendMode blend, InstructionSet isa);
+	static void render_linear(const PixelScanline &scanline, BlendMode blend) { render_linear(scanline, blend, get_instruction_set()); }
+
+	/// \brief Blends a solid color over a span of pixels
+	static void fill_blend(unsigned int *dest, int length, const Colorf &color, InstructionSet isa);
+	static void fill_blend(unsigned int *dest, int length, const Colorf &color) { fill_blend(dest, length, color, get_instruction_set()); }
+};
+
+}
+
+/// \}
@@ -30,6 +30,7 @@
 #pragma once
 
 #include "api_swrender.h"
+#include "pixel_pipeline_stats.h"
 
 
 #include "../Display/Render/graphic_context.h"
@@ -67,8 +68,17 @@ public:
 	/// \brief Returns the pixel pipeline class needed to allocated PixelCommand objects.
 	PixelPipeline *get_pipeline() const;
 
+	/// \brief Returns the performance counters of the pixel pipeline
+	PixelPipelineStats get_pipeline_stats() const;
+
 //!Operations
 public:
+	/// \brief Enables measuring of the time spent in the pixel pipeline
+	void set_pipeline_profiling(bool enable);
+
+	/// \brief Resets the performance counters of the pixel pipeline
+	void reset_pipeline_stats();
+
 	void draw_pixels(float x, float y, float zoom_x, float zoom_y, const PixelBuffer &pixel_buffer, const Rect &src_rect, const Colorf &color);
 	void draw_pixels_bicubic(int x, int y, int zoom_number, int zoom_denominator, const PixelBuffer &pixels);
 
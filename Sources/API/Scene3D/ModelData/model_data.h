@@ -36,6 +36,8 @@
 #include "model_data_particle_emitter.h"
 #include "model_data_animation.h"
 #include "model_data_texture.h"
+#include "model_data_compressed_animation.h"
+#include "../../Core/IOData/memory_mapped_file.h"
 
 namespace clan
 {
@@ -53,6 +55,12 @@ public:
 	std::vector<ModelDataParticleEmitter> particle_emitters;
 	std::vector<ModelDataAnimation> animations;
 	Vec3f aabb_min, aabb_max;
+
+	/// \brief Compressed bone animations, used instead of the bone timelines when set
+	std::shared_ptr<ModelDataCompressedAnimation> compressed_animation;
+
+	/// \brief Keeps the memory referenced by the mesh streams alive
+	std::shared_ptr<MemoryMappedFile> mapped_file;
 };
 
 }
@@ -0,0 +1,108 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "../api_scene3d.h"
+#include "model_data_animation_data.h"
+#include "model_data_compressed_animation.h"
+#include <memory>
+
+namespace clan
+{
+
+class ModelData;
+class ModelDataBone;
+class ModelDataAnimationBoneLanes;
+
+/// \brief Keyframe positions remembered between samples of an animation
+///
+/// Each bone track stores the keyframe found by the previous sample, so an
+/// animation playing forward rarely needs to search its timestamps.
+class ModelDataAnimationCursors
+{
+public:
+	ModelDataAnimationCursors() : animation_index(-1) { }
+
+	int animation_index;
+	std::vector<int> keys;
+};
+
+/// \brief Evaluates the bone transforms of a model animation
+///
+/// Bones are sampled four at a time with SSE2 where available. Models with compressed
+/// animations are decoded directly from ModelData::compressed_animation.
+class CL_API_SCENE ModelDataAnimationSampler
+{
+public:
+	ModelDataAnimationSampler();
+	ModelDataAnimationSampler(const std::shared_ptr<ModelData> &model_data);
+
+	/// \brief Number of vectors written per bone by sample_bones
+	static const int vectors_per_bone = 3;
+
+	int get_num_bones() const { return num_bones; }
+
+	/// \brief Samples the transforms of all bones
+	///
+	/// For each bone the first three rows of translate(position) * rotate(orientation) * scale(scale)
+	/// are written to out_vectors. The result matches ModelDataAnimationData::get_value for the
+	/// three bone tracks. Billboarded bones are written without any camera correction.
+	///
+	/// \param animation_index = Animation to sample
+	/// \param timestamp = Time in the animation
+	/// \param cursors = Keyframe cursors of the instance playing the animation
+	/// \param out_vectors = Destination for get_num_bones() * vectors_per_bone vectors
+	void sample_bones(int animation_index, float timestamp, ModelDataAnimationCursors &cursors, Vec4f *out_vectors) const;
+
+	/// \brief Samples the position, orientation and scale of a single bone
+	void sample_bone(int animation_index, float timestamp, int bone, Vec3f &out_position, Quaternionf &out_orientation, Vec3f &out_scale) const;
+
+private:
+	class BoneTracks
+	{
+	public:
+		BoneTracks() : position(0), orientation(0), scale(0) { }
+		const ModelDataAnimationTimeline<Vec3f> *position;
+		const ModelDataAnimationTimeline<Quaternionf> *orientation;
+		const ModelDataAnimationTimeline<Vec3f> *scale;
+	};
+
+	void gather_bone(ModelDataAnimationBoneLanes &lanes, int lane, int animation_index, int bone, int *keys, float timestamp) const;
+
+	template<typename Type>
+	static const ModelDataAnimationTimeline<Type> *find_timeline(const ModelDataAnimationData<Type> &data, int animation_index);
+
+	std::shared_ptr<ModelData> model_data;
+	const ModelDataCompressedAnimation *compressed;
+	int num_bones;
+	int num_animations;
+	std::vector<BoneTracks> tracks;
+};
+
+}
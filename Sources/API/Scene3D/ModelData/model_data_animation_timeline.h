@@ -69,10 +69,11 @@ public:
 	}
 
 private:
+	// Returns the last key at or before the timestamp
 	size_t binary_search(float timestamp) const
 	{
 		size_t imin = 0;
-		size_t imax = timestamps.size() - 1;
+		size_t imax = timestamps.size();
 		while (imin < imax)
 		{
 			size_t imid = imin + (imax - imin) / 2;
@@ -81,10 +82,7 @@ private:
 			else
 				imin = imid + 1;
 		}
-		if (imin < timestamps.size() - 1)
-			return imin - 1;
-		else
-			return imin;
+		return imin > 0 ? imin - 1 : 0;
 	}
 };
 
@@ -0,0 +1,210 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "../api_scene3d.h"
+#include "../../Core/Math/cl_math.h"
+#include <memory>
+
+namespace clan
+{
+
+class ModelData;
+
+/// \brief Error bounds used when compressing the bone animations of a model
+class ModelDataAnimationCompression
+{
+public:
+	ModelDataAnimationCompression() : max_position_error(0.001f), max_orientation_error(0.001f), max_scale_error(0.001f) { }
+
+	/// \brief Largest allowed position difference in object units
+	float max_position_error;
+
+	/// \brief Largest allowed difference of a quaternion component
+	float max_orientation_error;
+
+	/// \brief Largest allowed difference of a scale component
+	float max_scale_error;
+};
+
+/// \brief Quantized keyframe track
+///
+/// Uniformly sampled tracks store no timestamps; key i is at start_time + i / sample_rate.
+/// Vec3f keys are three 16 bit values in the range of the track. Quaternion keys use the
+/// smallest three encoding: the largest component is dropped and rebuilt from the other
+/// three, which are stored with 15 bits each. The index of the dropped component is kept
+/// in the top bits of the first two words.
+class ModelDataCompressedTrack
+{
+public:
+	ModelDataCompressedTrack() : num_keys(0), start_time(0.0f), sample_rate(0.0f) { }
+
+	int num_keys;
+	float start_time;
+
+	/// \brief Keys per second for uniformly sampled tracks, or zero when timestamps are stored
+	float sample_rate;
+	std::vector<float> timestamps;
+
+	Vec3f range_min;
+	Vec3f range_extent;
+
+	/// \brief Three words per key
+	std::vector<unsigned short> values;
+
+	bool is_uniform() const { return sample_rate != 0.0f; }
+
+	/// \brief Finds the keys surrounding a timestamp and the interpolation position between them
+	///
+	/// \param cursor = Key found by the previous call, updated to the key found now
+	float find_keys(float timestamp, int &cursor, int &index, int &index2) const
+	{
+		if (num_keys <= 1)
+		{
+			index = 0;
+			index2 = 0;
+			return 0.0f;
+		}
+
+		if (is_uniform())
+		{
+			float position = max((timestamp - start_time) * sample_rate, 0.0f);
+			index = min((int)position, num_keys - 1);
+			index2 = min(index + 1, num_keys - 1);
+			return (index != index2) ? min(position - index, 1.0f) : 0.0f;
+		}
+
+		index = find_key(&timestamps[0], num_keys, timestamp, cursor);
+		index2 = min(index + 1, num_keys - 1);
+		cursor = index;
+
+		float start = timestamps[index];
+		float end = timestamps[index2];
+		return (start != end) ? clamp((timestamp - start) / (end - start), 0.0f, 1.0f) : 0.0f;
+	}
+
+	Vec3f get_vec3(int key) const
+	{
+		const unsigned short *v = &values[key * 3];
+		const float scale = 1.0f / 65535.0f;
+		return Vec3f(
+			range_min.x + range_extent.x * (v[0] * scale),
+			range_min.y + range_extent.y * (v[1] * scale),
+			range_min.z + range_extent.z * (v[2] * scale));
+	}
+
+	/// \brief Decodes a quaternion key into x, y, z, w order
+	void get_quaternion(int key, float *out_xyzw) const
+	{
+		const unsigned short *v = &values[key * 3];
+		const float scale = 1.41421356f / 32767.0f;
+		const float offset = -0.70710678f;
+		int largest = ((v[0] >> 15) << 1) | (v[1] >> 15);
+
+		float c0 = (v[0] & 0x7fff) * scale + offset;
+		float c1 = (v[1] & 0x7fff) * scale + offset;
+		float c2 = (v[2] & 0x7fff) * scale + offset;
+		float c3 = std::sqrt(max(1.0f - c0 * c0 - c1 * c1 - c2 * c2, 0.0f));
+
+		int j = 0;
+		const float small[3] = { c0, c1, c2 };
+		for (int i = 0; i < 4; i++)
+			out_xyzw[i] = (i == largest) ? c3 : small[j++];
+	}
+
+	/// \brief Finds the last key at or before the timestamp, starting the search at the cursor
+	static int find_key(const float *timestamps, int num_keys, float timestamp, int cursor)
+	{
+		const int max_cursor_steps = 4;
+		if (cursor < num_keys && timestamps[cursor] <= timestamp)
+		{
+			for (int step = 0; step < max_cursor_steps; step++)
+			{
+				if (cursor + 1 == num_keys || timestamps[cursor + 1] > timestamp)
+					return cursor;
+				cursor++;
+			}
+		}
+
+		int imin = 0;
+		int imax = num_keys;
+		while (imin < imax)
+		{
+			int imid = imin + (imax - imin) / 2;
+			if (timestamps[imid] > timestamp)
+				imax = imid;
+			else
+				imin = imid + 1;
+		}
+		return imin > 0 ? imin - 1 : 0;
+	}
+};
+
+/// \brief Bone animations of a model in compressed form
+///
+/// When ModelData::compressed_animation is set, ModelDataAnimationSampler decodes the bones
+/// from it and the bone timelines in ModelData can be cleared to save memory.
+class CL_API_SCENE ModelDataCompressedAnimation
+{
+public:
+	ModelDataCompressedAnimation() : num_animations(0), num_bones(0) { }
+
+	enum TrackType
+	{
+		track_position,
+		track_orientation,
+		track_scale,
+		num_track_types
+	};
+
+	int num_animations;
+	int num_bones;
+
+	/// \brief Unique tracks
+	std::vector<ModelDataCompressedTrack> tracks;
+
+	/// \brief Index into tracks for each animation, bone and track type, or -1 for the default value
+	std::vector<int> track_indices;
+
+	int get_track_index(int animation_index, int bone, TrackType type) const { return track_indices[(animation_index * num_bones + bone) * num_track_types + type]; }
+
+	/// \brief Compresses the bone timelines of a model
+	///
+	/// Each track is stored in whichever of a uniformly resampled or a keyframe reduced form is
+	/// smaller while staying within the error bounds at every original keyframe.
+	static std::shared_ptr<ModelDataCompressedAnimation> compress(const ModelData &model_data, const ModelDataAnimationCompression &settings = ModelDataAnimationCompression());
+
+	/// \brief Bytes used by the compressed tracks
+	size_t get_memory_usage() const;
+
+	/// \brief Bytes used by the bone timelines of a model
+	static size_t get_uncompressed_memory_usage(const ModelData &model_data);
+};
+
+}
@@ -0,0 +1,61 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "../api_scene3d.h"
+#include <memory>
+#include <string>
+
+namespace clan
+{
+
+class ModelData;
+
+/// \brief Binary, memory mappable model file
+///
+/// The file is loaded with a single memory mapping. Mesh vertices are stored interleaved in the
+/// layout the model shaders use, and ModelDataMesh::stream points directly into the mapping, so
+/// they can be uploaded to the GPU without being copied or converted first. The remaining arrays
+/// are copied out of the mapping in bulk. All offsets in the file are relative to its start.
+///
+/// Files with another version number are rejected, so they can be converted again from source.
+class CL_API_SCENE ModelDataFile
+{
+public:
+	/// \brief Current version of the file format
+	static const int version = 1;
+
+	/// \brief Saves the model data to a file
+	static void save(const std::string &filename, const ModelData &model_data);
+
+	/// \brief Memory maps a model file. Throws an exception if the file is invalid or from another version.
+	static std::shared_ptr<ModelData> load(const std::string &filename);
+};
+
+}
@@ -29,6 +29,7 @@
 #pragma once
 
 #include "model_data_draw_range.h"
+#include "model_data_mesh_stream.h"
 
 namespace clan
 {
@@ -48,6 +49,9 @@ public:
 	std::vector<unsigned int> elements;
 	std::vector<ModelDataDrawRange> draw_ranges;
 
+	/// \brief Interleaved vertex data used instead of the vectors above when not null
+	ModelDataMeshStream stream;
+
 	void calculate_tangents();
 };
 
@@ -0,0 +1,92 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include <vector>
+
+namespace clan
+{
+
+/// \brief Interleaved, GPU-ready vertex and element data for a mesh
+///
+/// The data is not owned by the stream. It points into the memory kept alive by ModelData::mapped_file.
+class ModelDataMeshStream
+{
+public:
+	ModelDataMeshStream() : vertex_data(), vertex_stride(), num_vertices(), element_data(), num_elements() { }
+
+	/// \brief Vertex attributes in the order of the model shader attribute locations
+	enum Attribute
+	{
+		attribute_vertices,
+		attribute_normals,
+		attribute_bitangents,
+		attribute_tangents,
+		attribute_bone_weights,
+		attribute_bone_selectors,
+		attribute_colors,
+		attribute_channels
+	};
+
+	/// \brief Returns true if the mesh uses the per-attribute vectors instead of a stream
+	bool is_null() const { return vertex_data == 0; }
+
+	/// \brief Returns the size in bytes of an attribute in the stream
+	static int get_attribute_size(int attribute)
+	{
+		switch (attribute)
+		{
+		case attribute_vertices:
+		case attribute_normals:
+		case attribute_bitangents:
+		case attribute_tangents:
+			return 3 * sizeof(float);
+		case attribute_bone_weights:
+		case attribute_bone_selectors:
+		case attribute_colors:
+			return 4;
+		default:
+			return 2 * sizeof(float);
+		}
+	}
+
+	const unsigned char *vertex_data;
+	int vertex_stride;
+	int num_vertices;
+
+	/// \brief Byte offset of each attribute within a vertex, or -1 if the mesh does not have it
+	///
+	/// Indexed by Attribute, with one entry per texture channel starting at attribute_channels.
+	std::vector<int> attribute_offsets;
+
+	const unsigned int *element_data;
+	int num_elements;
+};
+
+}
@@ -0,0 +1,97 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "../api_scene3d.h"
+#include "../../Core/Signals/callback_1.h"
+#include <memory>
+#include <string>
+
+namespace clan
+{
+/// \addtogroup clanScene_Scene clanScene Scene
+/// \{
+
+class ModelData;
+class LevelData;
+class SceneDataFileCache_Impl;
+
+/// \brief Converts model and level source files to memory mappable binary files in the background
+///
+/// Converted files are stored in the cache directory and named after the SHA-1 hash of the source
+/// file and the file format version. An edited source file or a newer format is therefore converted
+/// again instead of mapping a stale file. A SceneCache implementation can call get_model_data from
+/// its own get_model_data.
+class CL_API_SCENE SceneDataFileCache
+{
+public:
+	/// \brief Loads model data from a source file. May be called from worker threads.
+	typedef Callback_1<std::shared_ptr<ModelData>, const std::string &> ModelLoader;
+
+	/// \brief Loads level data from a source file. May be called from worker threads.
+	typedef Callback_1<std::shared_ptr<LevelData>, const std::string &> LevelLoader;
+
+	/// \brief Constructs a cache storing converted files in cache_path
+	SceneDataFileCache(const std::string &cache_path, const ModelLoader &model_loader, const LevelLoader &level_loader = LevelLoader());
+	~SceneDataFileCache();
+
+	/// \brief Returns the model data for a source file
+	///
+	/// Maps the converted file if the cache has it. Otherwise the source is loaded on the calling thread
+	/// and converted in the background. The returned data must not be modified while the conversion is pending.
+	std::shared_ptr<ModelData> get_model_data(const std::string &filename);
+
+	/// \brief Returns the level data for a source file
+	std::shared_ptr<LevelData> get_level_data(const std::string &filename);
+
+	/// \brief Converts a model source file in the background unless the cache already has it
+	void convert_model(const std::string &filename);
+
+	/// \brief Converts a level source file in the background unless the cache already has it
+	void convert_level(const std::string &filename);
+
+	/// \brief Returns the number of conversions queued or in progress
+	int get_pending_conversions() const;
+
+	/// \brief Blocks until all queued conversions have finished
+	void wait_for_conversions();
+
+	/// \brief Returns the name of the converted model file for a source file
+	std::string get_model_cache_filename(const std::string &filename) const;
+
+	/// \brief Returns the name of the converted level file for a source file
+	std::string get_level_cache_filename(const std::string &filename) const;
+
+private:
+	std::shared_ptr<SceneDataFileCache_Impl> impl;
+};
+
+}
+
+/// \}
@@ -82,6 +82,8 @@ public:
 	void set_cull_oct_tree(const AxisAlignedBoundingBox &aabb);
 	void set_cull_oct_tree(const Vec3f &aabb_min, const Vec3f &aabb_max);
 	void set_cull_oct_tree(float max_size);
+	void set_cull_bvh();
+	void set_visit_threads(int num_threads);
 
 	ScenePass add_pass(const std::string &name, const std::string &insert_before = std::string());
 	void remove_pass(const std::string &name);
@@ -33,6 +33,7 @@
 #include "../Core/Math/vec3.h"
 #include "../Core/Math/mat4.h"
 #include <vector>
+#include <memory>
 
 namespace clan
 {
@@ -66,6 +67,27 @@ public:
 
 	virtual std::vector<SceneItem *> cull(const FrustumPlanes &frustum) = 0;
 	virtual std::vector<SceneItem *> cull(const Vec3f &point) = 0;
+
+	/// \brief Finds the potential visible sets for several views
+	///
+	/// The default implementation culls each view separately. Providers able to
+	/// test all views in a single traversal override this.
+	///
+	/// \param frustums = Frustum planes for each view
+	/// \return One potential visible set per frustum
+	virtual std::vector<std::vector<SceneItem *> > cull_views(const std::vector<FrustumPlanes> &frustums);
+
+	/// \brief Creates an oct tree cull provider covering the specified box
+	static std::unique_ptr<SceneCullProvider> create_oct_tree(const AxisAlignedBoundingBox &aabb);
+
+	/// \brief Creates a R-tree cull provider
+	static std::unique_ptr<SceneCullProvider> create_rtree();
+
+	/// \brief Creates a bounding volume hierarchy cull provider
+	///
+	/// The hierarchy is rebuilt lazily when objects are added or removed, and refitted
+	/// when an object moves. It is well suited for large numbers of mostly static objects.
+	static std::unique_ptr<SceneCullProvider> create_bvh();
 };
 
 }
@@ -124,6 +124,9 @@
 #include "Core/Resources/xml_resource_document.h"
 #include "Core/Resources/xml_resource_manager.h"
 #include "Core/JSON/json_value.h"
+#include "Core/JSON/json_reader.h"
+#include "Core/JSON/json_writer.h"
+#include "Core/JSON/json_document.h"
 #include "Core/XML/dom_processing_instruction.h"
 #include "Core/XML/dom_entity_reference.h"
 #include "Core/XML/dom_notation.h"
@@ -146,10 +149,14 @@
 #include "Core/XML/xml_tokenizer.h"
 #include "Core/XML/xml_writer.h"
 #include "Core/XML/xml_token.h"
+#include "Core/XML/xml_token_string.h"
+#include "Core/XML/xml_token_view.h"
 #include "Core/XML/xpath_evaluator.h"
+#include "Core/XML/xpath_expression.h"
 #include "Core/XML/xpath_object.h"
 #include "Core/IOData/file.h"
 #include "Core/IOData/file_help.h"
+#include "Core/IOData/memory_mapped_file.h"
 #include "Core/IOData/path_help.h"
 #include "Core/IOData/iodevice.h"
 #include "Core/IOData/iodevice_provider.h"
@@ -215,6 +222,10 @@
 #include "Core/Crypto/aes192_decrypt.h"
 #include "Core/Crypto/aes256_encrypt.h"
 #include "Core/Crypto/aes256_decrypt.h"
+#include "Core/Crypto/aes_ctr.h"
+#include "Core/Crypto/aes_gcm_encrypt.h"
+#include "Core/Crypto/aes_gcm_decrypt.h"
+#include "Core/Crypto/aes_backend.h"
 #include "Core/Crypto/rsa.h"
 #include "Core/Crypto/tls_client.h"
 #include "Core/Math/size.h"
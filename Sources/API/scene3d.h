@@ -45,8 +45,12 @@
 #include "Scene3D/scene_pass.h"
 #include "Scene3D/scene_cull_provider.h"
 #include "Scene3D/Resources/scene_cache.h"
+#include "Scene3D/Resources/scene_data_file_cache.h"
 #include "Scene3D/ModelData/model_data.h"
+#include "Scene3D/ModelData/model_data_animation_sampler.h"
+#include "Scene3D/ModelData/model_data_file.h"
 #include "Scene3D/LevelData/level_data.h"
+#include "Scene3D/LevelData/level_data_file.h"
 #include "Scene3D/Performance/gpu_timer.h"
 #include "Scene3D/Performance/scope_timer.h"
 
@@ -40,9 +40,11 @@
 #include "SWRender/setup_swrender.h"
 #include "SWRender/swr_graphic_context.h"
 #include "SWRender/pixel_command.h"
+#include "SWRender/pixel_pipeline_stats.h"
 #include "SWRender/pixel_thread_context.h"
 #include "SWRender/pixel_buffer_data.h"
 #include "SWRender/blit_argb8_sse.h"
+#include "SWRender/pixel_scanline_kernels.h"
 #include "SWRender/software_program.h"
 #include "SWRender/swr_program_object.h"
 
@@ -68,11 +68,7 @@ void AES128_Encrypt_Impl::reset()
 
 void AES128_Encrypt_Impl::set_iv(const unsigned char iv[16])
 {
-	initialisation_vector_1 = get_word(iv);
-	initialisation_vector_2 = get_word(iv + 4);
-	initialisation_vector_3 = get_word(iv + 8);
-	initialisation_vector_4 = get_word(iv + 12);
-
+	memcpy(initialisation_vector, iv, aes128_block_size_bytes);
 	initialisation_vector_set = true;
 }
 
@@ -88,7 +84,7 @@ void AES128_Encrypt_Impl::set_padding(bool value, bool use_pkcs7, unsigned int n
 void AES128_Encrypt_Impl::set_key(const unsigned char key[16])
 {
 	cipher_key_set = true;
-	extract_encrypt_key128(key, key_expanded);
+	set_cipher_key(key, aes128_key_length_bytes);
 }
 
 void AES128_Encrypt_Impl::add(const void *_data, int size)
@@ -104,20 +100,34 @@ void AES128_Encrypt_Impl::add(const void *_data, int size)
 
 	const unsigned char *data = (const unsigned char *) _data;
 	int pos = 0;
-	while (pos < size)
+
+	// Complete a partially filled chunk first
+	if (chunk_filled > 0)
 	{
-		int data_left = size - pos;
-		int buffer_space = aes128_block_size_bytes - chunk_filled;
-		int data_used = min(buffer_space, data_left);
-		memcpy(chunk + chunk_filled, data + pos, data_used);
+		int data_used = min(aes128_block_size_bytes - chunk_filled, size);
+		memcpy(chunk + chunk_filled, data, data_used);
 		chunk_filled += data_used;
 		pos += data_used;
 		if (chunk_filled == aes128_block_size_bytes)
 		{
-			process_chunk();
+			encrypt_cbc(initialisation_vector, chunk, append_data(databuffer, aes128_block_size_bytes), 1);
 			chunk_filled = 0;
 		}
 	}
+
+	// Encrypt all whole blocks directly from the input
+	if (chunk_filled == 0)
+	{
+		int num_blocks = (size - pos) / aes128_block_size_bytes;
+		if (num_blocks > 0)
+		{
+			encrypt_cbc(initialisation_vector, data + pos, append_data(databuffer, num_blocks * aes128_block_size_bytes), num_blocks);
+			pos += num_blocks * aes128_block_size_bytes;
+		}
+
+		memcpy(chunk, data + pos, size - pos);
+		chunk_filled = size - pos;
+	}
 }
 
 void AES128_Encrypt_Impl::calculate()
@@ -133,7 +143,7 @@ void AES128_Encrypt_Impl::calculate()
 			// PKCS#7
 			unsigned char pad_size = aes128_block_size_bytes - chunk_filled;
 			memset(chunk + chunk_filled, pad_size, pad_size);
-			process_chunk();
+			encrypt_cbc(initialisation_vector, chunk, append_data(databuffer, aes128_block_size_bytes), 1);
 			chunk_filled = 0;
 		}
 		else
@@ -155,96 +165,7 @@ void AES128_Encrypt_Impl::calculate()
 	calculated = true;
 	initialisation_vector_set = false;	// Force to reset after each call
 	cipher_key_set = false;				// Force to reset after each call (to avoid keeping the cipher key in memory)
-	memset(key_expanded, 0, sizeof(key_expanded));	// Remove the key from memory
-}
-
-/////////////////////////////////////////////////////////////////////////////
-// AES128_Encrypt_Impl Implementation:
-
-void AES128_Encrypt_Impl::process_chunk()
-{
-
-	const ubyte32 *key_expanded_ptr = key_expanded;
-
-	/* Electronic Codebook Mode
-	ubyte32 s0 = get_word(chunk) ^ key_expanded_ptr[0];
-	ubyte32 s1 = get_word(chunk + 4) ^ key_expanded_ptr[1];
-	ubyte32 s2 = get_word(chunk + 8) ^ key_expanded_ptr[2];
-	ubyte32 s3 = get_word(chunk + 12) ^ key_expanded_ptr[3];
-	*/
-
-	// Cipher Block Chaining Mode
-	ubyte32 s0 = initialisation_vector_1 ^ get_word(chunk) ^ key_expanded_ptr[0];
-	ubyte32 s1 = initialisation_vector_2 ^ get_word(chunk + 4) ^ key_expanded_ptr[1];
-	ubyte32 s2 = initialisation_vector_3 ^ get_word(chunk + 8) ^ key_expanded_ptr[2];
-	ubyte32 s3 = initialisation_vector_4 ^ get_word(chunk + 12) ^ key_expanded_ptr[3];
-
-	ubyte32 t0;
-	ubyte32 t1;
-	ubyte32 t2;
-	ubyte32 t3;
-
-	// round 1
-	t0 = table_e0[s0 >> 24] ^ table_e1[(s1 >> 16) & 0xff] ^ table_e2[(s2 >>  8) & 0xff] ^ table_e3[s3 & 0xff] ^ key_expanded_ptr[ 4];
-	t1 = table_e0[s1 >> 24] ^ table_e1[(s2 >> 16) & 0xff] ^ table_e2[(s3 >>  8) & 0xff] ^ table_e3[s0 & 0xff] ^ key_expanded_ptr[ 5];
-	t2 = table_e0[s2 >> 24] ^ table_e1[(s3 >> 16) & 0xff] ^ table_e2[(s0 >>  8) & 0xff] ^ table_e3[s1 & 0xff] ^ key_expanded_ptr[ 6];
-	t3 = table_e0[s3 >> 24] ^ table_e1[(s0 >> 16) & 0xff] ^ table_e2[(s1 >>  8) & 0xff] ^ table_e3[s2 & 0xff] ^ key_expanded_ptr[ 7];
-	// round 2
-	s0 = table_e0[t0 >> 24] ^ table_e1[(t1 >> 16) & 0xff] ^ table_e2[(t2 >>  8) & 0xff] ^ table_e3[t3 & 0xff] ^ key_expanded_ptr[ 8];
-	s1 = table_e0[t1 >> 24] ^ table_e1[(t2 >> 16) & 0xff] ^ table_e2[(t3 >>  8) & 0xff] ^ table_e3[t0 & 0xff] ^ key_expanded_ptr[ 9];
-	s2 = table_e0[t2 >> 24] ^ table_e1[(t3 >> 16) & 0xff] ^ table_e2[(t0 >>  8) & 0xff] ^ table_e3[t1 & 0xff] ^ key_expanded_ptr[10];
-	s3 = table_e0[t3 >> 24] ^ table_e1[(t0 >> 16) & 0xff] ^ table_e2[(t1 >>  8) & 0xff] ^ table_e3[t2 & 0xff] ^ key_expanded_ptr[11];
-	// round 3
-	t0 = table_e0[s0 >> 24] ^ table_e1[(s1 >> 16) & 0xff] ^ table_e2[(s2 >>  8) & 0xff] ^ table_e3[s3 & 0xff] ^ key_expanded_ptr[12];
-	t1 = table_e0[s1 >> 24] ^ table_e1[(s2 >> 16) & 0xff] ^ table_e2[(s3 >>  8) & 0xff] ^ table_e3[s0 & 0xff] ^ key_expanded_ptr[13];
-	t2 = table_e0[s2 >> 24] ^ table_e1[(s3 >> 16) & 0xff] ^ table_e2[(s0 >>  8) & 0xff] ^ table_e3[s1 & 0xff] ^ key_expanded_ptr[14];
-	t3 = table_e0[s3 >> 24] ^ table_e1[(s0 >> 16) & 0xff] ^ table_e2[(s1 >>  8) & 0xff] ^ table_e3[s2 & 0xff] ^ key_expanded_ptr[15];
-	// round 4
-	s0 = table_e0[t0 >> 24] ^ table_e1[(t1 >> 16) & 0xff] ^ table_e2[(t2 >>  8) & 0xff] ^ table_e3[t3 & 0xff] ^ key_expanded_ptr[16];
-	s1 = table_e0[t1 >> 24] ^ table_e1[(t2 >> 16) & 0xff] ^ table_e2[(t3 >>  8) & 0xff] ^ table_e3[t0 & 0xff] ^ key_expanded_ptr[17];
-	s2 = table_e0[t2 >> 24] ^ table_e1[(t3 >> 16) & 0xff] ^ table_e2[(t0 >>  8) & 0xff] ^ table_e3[t1 & 0xff] ^ key_expanded_ptr[18];
-	s3 = table_e0[t3 >> 24] ^ table_e1[(t0 >> 16) & 0xff] ^ table_e2[(t1 >>  8) & 0xff] ^ table_e3[t2 & 0xff] ^ key_expanded_ptr[19];
-	// round 5
-	t0 = table_e0[s0 >> 24] ^ table_e1[(s1 >> 16) & 0xff] ^ table_e2[(s2 >>  8) & 0xff] ^ table_e3[s3 & 0xff] ^ key_expanded_ptr[20];
-	t1 = table_e0[s1 >> 24] ^ table_e1[(s2 >> 16) & 0xff] ^ table_e2[(s3 >>  8) & 0xff] ^ table_e3[s0 & 0xff] ^ key_expanded_ptr[21];
-	t2 = table_e0[s2 >> 24] ^ table_e1[(s3 >> 16) & 0xff] ^ table_e2[(s0 >>  8) & 0xff] ^ table_e3[s1 & 0xff] ^ key_expanded_ptr[22];
-	t3 = table_e0[s3 >> 24] ^ table_e1[(s0 >> 16) & 0xff] ^ table_e2[(s1 >>  8) & 0xff] ^ table_e3[s2 & 0xff] ^ key_expanded_ptr[23];
-	// round 6
-	s0 = table_e0[t0 >> 24] ^ table_e1[(t1 >> 16) & 0xff] ^ table_e2[(t2 >>  8) & 0xff] ^ table_e3[t3 & 0xff] ^ key_expanded_ptr[24];
-	s1 = table_e0[t1 >> 24] ^ table_e1[(t2 >> 16) & 0xff] ^ table_e2[(t3 >>  8) & 0xff] ^ table_e3[t0 & 0xff] ^ key_expanded_ptr[25];
-	s2 = table_e0[t2 >> 24] ^ table_e1[(t3 >> 16) & 0xff] ^ table_e2[(t0 >>  8) & 0xff] ^ table_e3[t1 & 0xff] ^ key_expanded_ptr[26];
-	s3 = table_e0[t3 >> 24] ^ table_e1[(t0 >> 16) & 0xff] ^ table_e2[(t1 >>  8) & 0xff] ^ table_e3[t2 & 0xff] ^ key_expanded_ptr[27];
-	// round 7
-	t0 = table_e0[s0 >> 24] ^ table_e1[(s1 >> 16) & 0xff] ^ table_e2[(s2 >>  8) & 0xff] ^ table_e3[s3 & 0xff] ^ key_expanded_ptr[28];
-	t1 = table_e0[s1 >> 24] ^ table_e1[(s2 >> 16) & 0xff] ^ table_e2[(s3 >>  8) & 0xff] ^ table_e3[s0 & 0xff] ^ key_expanded_ptr[29];
-	t2 = table_e0[s2 >> 24] ^ table_e1[(s3 >> 16) & 0xff] ^ table_e2[(s0 >>  8) & 0xff] ^ table_e3[s1 & 0xff] ^ key_expanded_ptr[30];
-	t3 = table_e0[s3 >> 24] ^ table_e1[(s0 >> 16) & 0xff] ^ table_e2[(s1 >>  8) & 0xff] ^ table_e3[s2 & 0xff] ^ key_expanded_ptr[31];
-	// round 8
-	s0 = table_e0[t0 >> 24] ^ table_e1[(t1 >> 16) & 0xff] ^ table_e2[(t2 >>  8) & 0xff] ^ table_e3[t3 & 0xff] ^ key_expanded_ptr[32];
-	s1 = table_e0[t1 >> 24] ^ table_e1[(t2 >> 16) & 0xff] ^ table_e2[(t3 >>  8) & 0xff] ^ table_e3[t0 & 0xff] ^ key_expanded_ptr[33];
-	s2 = table_e0[t2 >> 24] ^ table_e1[(t3 >> 16) & 0xff] ^ table_e2[(t0 >>  8) & 0xff] ^ table_e3[t1 & 0xff] ^ key_expanded_ptr[34];
-	s3 = table_e0[t3 >> 24] ^ table_e1[(t0 >> 16) & 0xff] ^ table_e2[(t1 >>  8) & 0xff] ^ table_e3[t2 & 0xff] ^ key_expanded_ptr[35];
-	// round 9
-	t0 = table_e0[s0 >> 24] ^ table_e1[(s1 >> 16) & 0xff] ^ table_e2[(s2 >>  8) & 0xff] ^ table_e3[s3 & 0xff] ^ key_expanded_ptr[36];
-	t1 = table_e0[s1 >> 24] ^ table_e1[(s2 >> 16) & 0xff] ^ table_e2[(s3 >>  8) & 0xff] ^ table_e3[s0 & 0xff] ^ key_expanded_ptr[37];
-	t2 = table_e0[s2 >> 24] ^ table_e1[(s3 >> 16) & 0xff] ^ table_e2[(s0 >>  8) & 0xff] ^ table_e3[s1 & 0xff] ^ key_expanded_ptr[38];
-	t3 = table_e0[s3 >> 24] ^ table_e1[(s0 >> 16) & 0xff] ^ table_e2[(s1 >>  8) & 0xff] ^ table_e3[s2 & 0xff] ^ key_expanded_ptr[39];
-
-	key_expanded_ptr += aes128_num_rounds_nr * 4;
- 
-	// Apply last round
-	s0 = (sbox_substitution_values[(t0 >> 24) ] & 0xff000000) ^ (sbox_substitution_values[(t1 >> 16) & 0xff] & 0x00ff0000) ^ (sbox_substitution_values[(t2 >> 8) & 0xff] & 0x0000ff00) ^ (sbox_substitution_values[(t3 ) & 0xff] & 0x000000ff) ^ key_expanded_ptr[0];
-	s1 = (sbox_substitution_values[(t1 >> 24) ] & 0xff000000) ^ (sbox_substitution_values[(t2 >> 16) & 0xff] & 0x00ff0000) ^ (sbox_substitution_values[(t3 >> 8) & 0xff] & 0x0000ff00) ^ (sbox_substitution_values[(t0 ) & 0xff] & 0x000000ff) ^ key_expanded_ptr[1];
-	s2 = (sbox_substitution_values[(t2 >> 24) ] & 0xff000000) ^ (sbox_substitution_values[(t3 >> 16) & 0xff] & 0x00ff0000) ^ (sbox_substitution_values[(t0 >> 8) & 0xff] & 0x0000ff00) ^ (sbox_substitution_values[(t1 ) & 0xff] & 0x000000ff) ^ key_expanded_ptr[2];
-	s3 = (sbox_substitution_values[(t3 >> 24) ] & 0xff000000) ^ (sbox_substitution_values[(t0 >> 16) & 0xff] & 0x00ff0000) ^ (sbox_substitution_values[(t1 >> 8) & 0xff] & 0x0000ff00) ^ (sbox_substitution_values[(t2 ) & 0xff] & 0x000000ff) ^ key_expanded_ptr[3];
-
-	store_block(s0, s1, s2, s3, databuffer);
-
-	initialisation_vector_1 = s0;
-	initialisation_vector_2 = s1;
-	initialisation_vector_3 = s2;
-	initialisation_vector_4 = s3;
-	
+	clear_cipher_key();	// Remove the key from memory
 }
 
 }
@@ -101,15 +101,8 @@ public:
 /// \{
 
 private:
-	void process_chunk();
-
-	ubyte32 key_expanded[aes192_nb_mult_nr_plus1];
-
 	unsigned char chunk[aes192_block_size_bytes];
-	ubyte32 initialisation_vector_1;
-	ubyte32 initialisation_vector_2;
-	ubyte32 initialisation_vector_3;
-	ubyte32 initialisation_vector_4;
+	unsigned char initialisation_vector[aes192_block_size_bytes];
 	
 	int chunk_filled;
 
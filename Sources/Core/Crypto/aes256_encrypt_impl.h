@@ -98,15 +98,8 @@ public:
 /// \{
 
 private:
-	void process_chunk();
-
-	ubyte32 key_expanded[aes256_nb_mult_nr_plus1];
-
 	unsigned char chunk[aes256_block_size_bytes];
-	ubyte32 initialisation_vector_1;
-	ubyte32 initialisation_vector_2;
-	ubyte32 initialisation_vector_3;
-	ubyte32 initialisation_vector_4;
+	unsigned char initialisation_vector[aes256_block_size_bytes];
 	
 	int chunk_filled;
 
@@ -0,0 +1,57 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Core/precomp.h"
+#include "API/Core/Crypto/aes_backend.h"
+#include "aes_impl.h"
+
+namespace clan
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// AES_Backend Attributes:
+
+bool AES_Backend::is_hardware_supported()
+{
+	return AES_Impl::is_aesni_supported();
+}
+
+bool AES_Backend::is_hardware_enabled()
+{
+	return AES_Impl::is_aesni_enabled();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// AES_Backend Operations:
+
+void AES_Backend::set_hardware_enabled(bool enable)
+{
+	AES_Impl::set_aesni_enabled(enable);
+}
+
+}
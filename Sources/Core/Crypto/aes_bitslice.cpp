@@ -0,0 +1,531 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+**    Mark Page
+**    Thomas Pornin (bitsliced AES from BearSSL, see below)
+*/
+
+/*
+**  The bitsliced AES core in this file (the AES_Bitslice S-box, ortho,
+**  interleave, shift rows, mix columns and key expansion functions) is a
+**  port of aes_ct64.c, aes_ct64_enc.c and aes_ct64_dec.c from BearSSL
+**  (https://www.bearssl.org/), which is distributed under this license:
+**
+**  Copyright (c) 2016 Thomas Pornin <pornin@bolet.org>
+**
+**  Permission is hereby granted, free of charge, to any person obtaining
+**  a copy of this software and associated documentation files (the
+**  "Software"), to deal in the Software without restriction, including
+**  without limitation the rights to use, copy, modify, merge, publish,
+**  distribute, sublicense, and/or sell copies of the Software, and to
+**  permit persons to whom the Software is furnished to do so, subject to
+**  the following conditions:
+**
+**  The above copyright notice and this permission notice shall be
+**  included in all copies or substantial portions of the Software.
+**
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+**  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+**  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+**  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+**  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+**  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+**  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+**  SOFTWARE.
+*/
+
+#include "Core/precomp.h"
+#include "aes_bitslice.h"
+
+namespace clan
+{
+
+ubyte32 AES_Bitslice::sub_word(ubyte32 x)
+{
+	ubyte64 q[8] = { x, 0, 0, 0, 0, 0, 0, 0 };
+	ortho(q);
+	sbox(q);
+	ortho(q);
+	ubyte32 result = (ubyte32)q[0];
+	memset(q, 0, sizeof(q));
+	return result;
+}
+
+void AES_Bitslice::expand_key(const ubyte32 *round_key_words, int num_rounds, ubyte64 *bitsliced_keys)
+{
+	for (int round = 0; round <= num_rounds; round++)
+	{
+		ubyte64 q[8];
+		interleave_in(&q[0], &q[4], round_key_words + round * 4);
+		q[1] = q[0];
+		q[2] = q[0];
+		q[3] = q[0];
+		q[5] = q[4];
+		q[6] = q[4];
+		q[7] = q[4];
+		ortho(q);
+
+		// Every block in the batch uses the same key, so spread each key bit over all four block positions
+		ubyte64 compressed[2];
+		compressed[0] = (q[0] & 0x1111111111111111ULL) | (q[1] & 0x2222222222222222ULL) | (q[2] & 0x4444444444444444ULL) | (q[3] & 0x8888888888888888ULL);
+		compressed[1] = (q[4] & 0x1111111111111111ULL) | (q[5] & 0x2222222222222222ULL) | (q[6] & 0x4444444444444444ULL) | (q[7] & 0x8888888888888888ULL);
+		for (int i = 0; i < 2; i++)
+		{
+			ubyte64 x0 = compressed[i] & 0x1111111111111111ULL;
+			ubyte64 x1 = (compressed[i] & 0x2222222222222222ULL) >> 1;
+			ubyte64 x2 = (compressed[i] & 0x4444444444444444ULL) >> 2;
+			ubyte64 x3 = (compressed[i] & 0x8888888888888888ULL) >> 3;
+			ubyte64 *dest = bitsliced_keys + round * 8 + i * 4;
+			dest[0] = (x0 << 4) - x0;
+			dest[1] = (x1 << 4) - x1;
+			dest[2] = (x2 << 4) - x2;
+			dest[3] = (x3 << 4) - x3;
+		}
+		memset(q, 0, sizeof(q));
+	}
+}
+
+void AES_Bitslice::load_blocks(const unsigned char *input, ubyte64 q[8])
+{
+	for (int i = 0; i < 4; i++)
+	{
+		ubyte32 w[4];
+		for (int j = 0; j < 4; j++)
+		{
+			const unsigned char *p = input + i * 16 + j * 4;
+			w[j] = (ubyte32)p[0] | ((ubyte32)p[1] << 8) | ((ubyte32)p[2] << 16) | ((ubyte32)p[3] << 24);
+		}
+		interleave_in(&q[i], &q[i + 4], w);
+	}
+	ortho(q);
+}
+
+void AES_Bitslice::store_blocks(const ubyte64 q[8], unsigned char *output)
+{
+	ubyte64 t[8];
+	memcpy(t, q, sizeof(t));
+	ortho(t);
+	for (int i = 0; i < 4; i++)
+	{
+		ubyte32 w[4];
+		interleave_out(w, t[i], t[i + 4]);
+		for (int j = 0; j < 4; j++)
+		{
+			unsigned char *p = output + i * 16 + j * 4;
+			p[0] = (unsigned char)w[j];
+			p[1] = (unsigned char)(w[j] >> 8);
+			p[2] = (unsigned char)(w[j] >> 16);
+			p[3] = (unsigned char)(w[j] >> 24);
+		}
+	}
+}
+
+void AES_Bitslice::encrypt(int num_rounds, const ubyte64 *bitsliced_keys, ubyte64 q[8])
+{
+	for (int i = 0; i < 8; i++)
+		q[i] ^= bitsliced_keys[i];
+
+	for (int round = 1; round < num_rounds; round++)
+	{
+		sbox(q);
+		shift_rows(q);
+		mix_columns(q);
+		for (int i = 0; i < 8; i++)
+			q[i] ^= bitsliced_keys[round * 8 + i];
+	}
+
+	sbox(q);
+	shift_rows(q);
+	for (int i = 0; i < 8; i++)
+		q[i] ^= bitsliced_keys[num_rounds * 8 + i];
+}
+
+void AES_Bitslice::decrypt(int num_rounds, const ubyte64 *bitsliced_keys, ubyte64 q[8])
+{
+	for (int i = 0; i < 8; i++)
+		q[i] ^= bitsliced_keys[num_rounds * 8 + i];
+
+	for (int round = num_rounds - 1; round > 0; round--)
+	{
+		inverse_shift_rows(q);
+		inverse_sbox(q);
+		for (int i = 0; i < 8; i++)
+			q[i] ^= bitsliced_keys[round * 8 + i];
+		inverse_mix_columns(q);
+	}
+
+	inverse_shift_rows(q);
+	inverse_sbox(q);
+	for (int i = 0; i < 8; i++)
+		q[i] ^= bitsliced_keys[i];
+}
+
+// Boyar-Peralta S-box circuit: a linear layer, a shared GF(2^4) inversion and a second linear layer
+void AES_Bitslice::sbox(ubyte64 *q)
+{
+	ubyte64 x0 = q[7];
+	ubyte64 x1 = q[6];
+	ubyte64 x2 = q[5];
+	ubyte64 x3 = q[4];
+	ubyte64 x4 = q[3];
+	ubyte64 x5 = q[2];
+	ubyte64 x6 = q[1];
+	ubyte64 x7 = q[0];
+
+	// Top linear transformation
+	ubyte64 y14 = x3 ^ x5;
+	ubyte64 y13 = x0 ^ x6;
+	ubyte64 y9 = x0 ^ x3;
+	ubyte64 y8 = x0 ^ x5;
+	ubyte64 t0 = x1 ^ x2;
+	ubyte64 y1 = t0 ^ x7;
+	ubyte64 y4 = y1 ^ x3;
+	ubyte64 y12 = y13 ^ y14;
+	ubyte64 y2 = y1 ^ x0;
+	ubyte64 y5 = y1 ^ x6;
+	ubyte64 y3 = y5 ^ y8;
+	ubyte64 t1 = x4 ^ y12;
+	ubyte64 y15 = t1 ^ x5;
+	ubyte64 y20 = t1 ^ x1;
+	ubyte64 y6 = y15 ^ x7;
+	ubyte64 y10 = y15 ^ t0;
+	ubyte64 y11 = y20 ^ y9;
+	ubyte64 y7 = x7 ^ y11;
+	ubyte64 y17 = y10 ^ y11;
+	ubyte64 y19 = y10 ^ y8;
+	ubyte64 y16 = t0 ^ y11;
+	ubyte64 y21 = y13 ^ y16;
+	ubyte64 y18 = x0 ^ y16;
+
+	// Non-linear section
+	ubyte64 t2 = y12 & y15;
+	ubyte64 t3 = y3 & y6;
+	ubyte64 t4 = t3 ^ t2;
+	ubyte64 t5 = y4 & x7;
+	ubyte64 t6 = t5 ^ t2;
+	ubyte64 t7 = y13 & y16;
+	ubyte64 t8 = y5 & y1;
+	ubyte64 t9 = t8 ^ t7;
+	ubyte64 t10 = y2 & y7;
+	ubyte64 t11 = t10 ^ t7;
+	ubyte64 t12 = y9 & y11;
+	ubyte64 t13 = y14 & y17;
+	ubyte64 t14 = t13 ^ t12;
+	ubyte64 t15 = y8 & y10;
+	ubyte64 t16 = t15 ^ t12;
+	ubyte64 t17 = t4 ^ t14;
+	ubyte64 t18 = t6 ^ t16;
+	ubyte64 t19 = t9 ^ t14;
+	ubyte64 t20 = t11 ^ t16;
+	ubyte64 t21 = t17 ^ y20;
+	ubyte64 t22 = t18 ^ y19;
+	ubyte64 t23 = t19 ^ y21;
+	ubyte64 t24 = t20 ^ y18;
+
+	ubyte64 t25 = t21 ^ t22;
+	ubyte64 t26 = t21 & t23;
+	ubyte64 t27 = t24 ^ t26;
+	ubyte64 t28 = t25 & t27;
+	ubyte64 t29 = t28 ^ t22;
+	ubyte64 t30 = t23 ^ t24;
+	ubyte64 t31 = t22 ^ t26;
+	ubyte64 t32 = t31 & t30;
+	ubyte64 t33 = t32 ^ t24;
+	ubyte64 t34 = t23 ^ t33;
+	ubyte64 t35 = t27 ^ t33;
+	ubyte64 t36 = t24 & t35;
+	ubyte64 t37 = t36 ^ t34;
+	ubyte64 t38 = t27 ^ t36;
+	ubyte64 t39 = t29 & t38;
+	ubyte64 t40 = t25 ^ t39;
+
+	ubyte64 t41 = t40 ^ t37;
+	ubyte64 t42 = t29 ^ t33;
+	ubyte64 t43 = t29 ^ t40;
+	ubyte64 t44 = t33 ^ t37;
+	ubyte64 t45 = t42 ^ t41;
+	ubyte64 z0 = t44 & y15;
+	ubyte64 z1 = t37 & y6;
+	ubyte64 z2 = t33 & x7;
+	ubyte64 z3 = t43 & y16;
+	ubyte64 z4 = t40 & y1;
+	ubyte64 z5 = t29 & y7;
+	ubyte64 z6 = t42 & y11;
+	ubyte64 z7 = t45 & y17;
+	ubyte64 z8 = t41 & y10;
+	ubyte64 z9 = t44 & y12;
+	ubyte64 z10 = t37 & y3;
+	ubyte64 z11 = t33 & y4;
+	ubyte64 z12 = t43 & y13;
+	ubyte64 z13 = t40 & y5;
+	ubyte64 z14 = t29 & y2;
+	ubyte64 z15 = t42 & y9;
+	ubyte64 z16 = t45 & y14;
+	ubyte64 z17 = t41 & y8;
+
+	// Bottom linear transformation
+	ubyte64 t46 = z15 ^ z16;
+	ubyte64 t47 = z10 ^ z11;
+	ubyte64 t48 = z5 ^ z13;
+	ubyte64 t49 = z9 ^ z10;
+	ubyte64 t50 = z2 ^ z12;
+	ubyte64 t51 = z2 ^ z5;
+	ubyte64 t52 = z7 ^ z8;
+	ubyte64 t53 = z0 ^ z3;
+	ubyte64 t54 = z6 ^ z7;
+	ubyte64 t55 = z16 ^ z17;
+	ubyte64 t56 = z12 ^ t48;
+	ubyte64 t57 = t50 ^ t53;
+	ubyte64 t58 = z4 ^ t46;
+	ubyte64 t59 = z3 ^ t54;
+	ubyte64 t60 = t46 ^ t57;
+	ubyte64 t61 = z14 ^ t57;
+	ubyte64 t62 = t52 ^ t58;
+	ubyte64 t63 = t49 ^ t58;
+	ubyte64 t64 = z4 ^ t59;
+	ubyte64 t65 = t61 ^ t62;
+	ubyte64 t66 = z1 ^ t63;
+	ubyte64 s0 = t59 ^ t63;
+	ubyte64 s6 = t56 ^ ~t62;
+	ubyte64 s7 = t48 ^ ~t60;
+	ubyte64 t67 = t64 ^ t65;
+	ubyte64 s3 = t53 ^ t66;
+	ubyte64 s4 = t51 ^ t66;
+	ubyte64 s5 = t47 ^ t65;
+	ubyte64 s1 = t64 ^ ~s3;
+	ubyte64 s2 = t55 ^ ~t67;
+
+	q[7] = s0;
+	q[6] = s1;
+	q[5] = s2;
+	q[4] = s3;
+	q[3] = s4;
+	q[2] = s5;
+	q[1] = s6;
+	q[0] = s7;
+}
+
+// The inverse S-box is the forward S-box surrounded by the inverse of its affine transform
+void AES_Bitslice::inverse_sbox(ubyte64 *q)
+{
+	ubyte64 q0 = ~q[0];
+	ubyte64 q1 = ~q[1];
+	ubyte64 q2 = q[2];
+	ubyte64 q3 = q[3];
+	ubyte64 q4 = q[4];
+	ubyte64 q5 = ~q[5];
+	ubyte64 q6 = ~q[6];
+	ubyte64 q7 = q[7];
+	q[7] = q1 ^ q4 ^ q6;
+	q[6] = q0 ^ q3 ^ q5;
+	q[5] = q7 ^ q2 ^ q4;
+	q[4] = q6 ^ q1 ^ q3;
+	q[3] = q5 ^ q0 ^ q2;
+	q[2] = q4 ^ q7 ^ q1;
+	q[1] = q3 ^ q6 ^ q0;
+	q[0] = q2 ^ q5 ^ q7;
+
+	sbox(q);
+
+	q0 = ~q[0];
+	q1 = ~q[1];
+	q2 = q[2];
+	q3 = q[3];
+	q4 = q[4];
+	q5 = ~q[5];
+	q6 = ~q[6];
+	q7 = q[7];
+	q[7] = q1 ^ q4 ^ q6;
+	q[6] = q0 ^ q3 ^ q5;
+	q[5] = q7 ^ q2 ^ q4;
+	q[4] = q6 ^ q1 ^ q3;
+	q[3] = q5 ^ q0 ^ q2;
+	q[2] = q4 ^ q7 ^ q1;
+	q[1] = q3 ^ q6 ^ q0;
+	q[0] = q2 ^ q5 ^ q7;
+}
+
+// Transposes the bits so that each word holds one bit position of every byte
+void AES_Bitslice::ortho(ubyte64 *q)
+{
+	#define CL_AES_SWAPN(cl, ch, s, x, y) \
+		{ \
+			ubyte64 a = (x); \
+			ubyte64 b = (y); \
+			(x) = (a & (ubyte64)(cl)) | ((b & (ubyte64)(cl)) << (s)); \
+			(y) = ((a & (ubyte64)(ch)) >> (s)) | (b & (ubyte64)(ch)); \
+		}
+	#define CL_AES_SWAP2(x, y) CL_AES_SWAPN(0x5555555555555555ULL, 0xAAAAAAAAAAAAAAAAULL, 1, x, y)
+	#define CL_AES_SWAP4(x, y) CL_AES_SWAPN(0x3333333333333333ULL, 0xCCCCCCCCCCCCCCCCULL, 2, x, y)
+	#define CL_AES_SWAP8(x, y) CL_AES_SWAPN(0x0F0F0F0F0F0F0F0FULL, 0xF0F0F0F0F0F0F0F0ULL, 4, x, y)
+
+	CL_AES_SWAP2(q[0], q[1]);
+	CL_AES_SWAP2(q[2], q[3]);
+	CL_AES_SWAP2(q[4], q[5]);
+	CL_AES_SWAP2(q[6], q[7]);
+
+	CL_AES_SWAP4(q[0], q[2]);
+	CL_AES_SWAP4(q[1], q[3]);
+	CL_AES_SWAP4(q[4], q[6]);
+	CL_AES_SWAP4(q[5], q[7]);
+
+	CL_AES_SWAP8(q[0], q[4]);
+	CL_AES_SWAP8(q[1], q[5]);
+	CL_AES_SWAP8(q[2], q[6]);
+	CL_AES_SWAP8(q[3], q[7]);
+
+	#undef CL_AES_SWAP8
+	#undef CL_AES_SWAP4
+	#undef CL_AES_SWAP2
+	#undef CL_AES_SWAPN
+}
+
+void AES_Bitslice::interleave_in(ubyte64 *q0, ubyte64 *q1, const ubyte32 *w)
+{
+	ubyte64 x0 = w[0];
+	ubyte64 x1 = w[1];
+	ubyte64 x2 = w[2];
+	ubyte64 x3 = w[3];
+	x0 |= (x0 << 16);
+	x1 |= (x1 << 16);
+	x2 |= (x2 << 16);
+	x3 |= (x3 << 16);
+	x0 &= 0x0000FFFF0000FFFFULL;
+	x1 &= 0x0000FFFF0000FFFFULL;
+	x2 &= 0x0000FFFF0000FFFFULL;
+	x3 &= 0x0000FFFF0000FFFFULL;
+	x0 |= (x0 << 8);
+	x1 |= (x1 << 8);
+	x2 |= (x2 << 8);
+	x3 |= (x3 << 8);
+	x0 &= 0x00FF00FF00FF00FFULL;
+	x1 &= 0x00FF00FF00FF00FFULL;
+	x2 &= 0x00FF00FF00FF00FFULL;
+	x3 &= 0x00FF00FF00FF00FFULL;
+	*q0 = x0 | (x2 << 8);
+	*q1 = x1 | (x3 << 8);
+}
+
+void AES_Bitslice::interleave_out(ubyte32 *w, ubyte64 q0, ubyte64 q1)
+{
+	ubyte64 x0 = q0 & 0x00FF00FF00FF00FFULL;
+	ubyte64 x1 = q1 & 0x00FF00FF00FF00FFULL;
+	ubyte64 x2 = (q0 >> 8) & 0x00FF00FF00FF00FFULL;
+	ubyte64 x3 = (q1 >> 8) & 0x00FF00FF00FF00FFULL;
+	x0 |= (x0 >> 8);
+	x1 |= (x1 >> 8);
+	x2 |= (x2 >> 8);
+	x3 |= (x3 >> 8);
+	x0 &= 0x0000FFFF0000FFFFULL;
+	x1 &= 0x0000FFFF0000FFFFULL;
+	x2 &= 0x0000FFFF0000FFFFULL;
+	x3 &= 0x0000FFFF0000FFFFULL;
+	w[0] = (ubyte32)x0 | (ubyte32)(x0 >> 16);
+	w[1] = (ubyte32)x1 | (ubyte32)(x1 >> 16);
+	w[2] = (ubyte32)x2 | (ubyte32)(x2 >> 16);
+	w[3] = (ubyte32)x3 | (ubyte32)(x3 >> 16);
+}
+
+void AES_Bitslice::shift_rows(ubyte64 *q)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		ubyte64 x = q[i];
+		q[i] = (x & 0x000000000000FFFFULL)
+			| ((x & 0x00000000FFF00000ULL) >> 4)
+			| ((x & 0x00000000000F0000ULL) << 12)
+			| ((x & 0x0000FF0000000000ULL) >> 8)
+			| ((x & 0x000000FF00000000ULL) << 8)
+			| ((x & 0xF000000000000000ULL) >> 12)
+			| ((x & 0x0FFF000000000000ULL) << 4);
+	}
+}
+
+void AES_Bitslice::inverse_shift_rows(ubyte64 *q)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		ubyte64 x = q[i];
+		q[i] = (x & 0x000000000000FFFFULL)
+			| ((x & 0x000000000FFF0000ULL) << 4)
+			| ((x & 0x00000000F0000000ULL) >> 12)
+			| ((x & 0x000000FF00000000ULL) << 8)
+			| ((x & 0x0000FF0000000000ULL) >> 8)
+			| ((x & 0x000F000000000000ULL) << 12)
+			| ((x & 0xFFF0000000000000ULL) >> 4);
+	}
+}
+
+static inline ubyte64 cl_aes_rotr32(ubyte64 x)
+{
+	return (x << 32) | (x >> 32);
+}
+
+void AES_Bitslice::mix_columns(ubyte64 *q)
+{
+	ubyte64 q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3], q4 = q[4], q5 = q[5], q6 = q[6], q7 = q[7];
+	ubyte64 r0 = (q0 >> 16) | (q0 << 48);
+	ubyte64 r1 = (q1 >> 16) | (q1 << 48);
+	ubyte64 r2 = (q2 >> 16) | (q2 << 48);
+	ubyte64 r3 = (q3 >> 16) | (q3 << 48);
+	ubyte64 r4 = (q4 >> 16) | (q4 << 48);
+	ubyte64 r5 = (q5 >> 16) | (q5 << 48);
+	ubyte64 r6 = (q6 >> 16) | (q6 << 48);
+	ubyte64 r7 = (q7 >> 16) | (q7 << 48);
+
+	q[0] = q7 ^ r7 ^ r0 ^ cl_aes_rotr32(q0 ^ r0);
+	q[1] = q0 ^ r0 ^ q7 ^ r7 ^ r1 ^ cl_aes_rotr32(q1 ^ r1);
+	q[2] = q1 ^ r1 ^ r2 ^ cl_aes_rotr32(q2 ^ r2);
+	q[3] = q2 ^ r2 ^ q7 ^ r7 ^ r3 ^ cl_aes_rotr32(q3 ^ r3);
+	q[4] = q3 ^ r3 ^ q7 ^ r7 ^ r4 ^ cl_aes_rotr32(q4 ^ r4);
+	q[5] = q4 ^ r4 ^ r5 ^ cl_aes_rotr32(q5 ^ r5);
+	q[6] = q5 ^ r5 ^ r6 ^ cl_aes_rotr32(q6 ^ r6);
+	q[7] = q6 ^ r6 ^ r7 ^ cl_aes_rotr32(q7 ^ r7);
+}
+
+void AES_Bitslice::inverse_mix_columns(ubyte64 *q)
+{
+	ubyte64 q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3], q4 = q[4], q5 = q[5], q6 = q[6], q7 = q[7];
+	ubyte64 r0 = (q0 >> 16) | (q0 << 48);
+	ubyte64 r1 = (q1 >> 16) | (q1 << 48);
+	ubyte64 r2 = (q2 >> 16) | (q2 << 48);
+	ubyte64 r3 = (q3 >> 16) | (q3 << 48);
+	ubyte64 r4 = (q4 >> 16) | (q4 << 48);
+	ubyte64 r5 = (q5 >> 16) | (q5 << 48);
+	ubyte64 r6 = (q6 >> 16) | (q6 << 48);
+	ubyte64 r7 = (q7 >> 16) | (q7 << 48);
+
+	q[0] = q5 ^ q6 ^ q7 ^ r0 ^ r5 ^ r7 ^ cl_aes_rotr32(q0 ^ q5 ^ q6 ^ r0 ^ r5);
+	q[1] = q0 ^ q5 ^ r0 ^ r1 ^ r5 ^ r6 ^ r7 ^ cl_aes_rotr32(q1 ^ q5 ^ q7 ^ r1 ^ r5 ^ r6);
+	q[2] = q0 ^ q1 ^ q6 ^ r1 ^ r2 ^ r6 ^ r7 ^ cl_aes_rotr32(q0 ^ q2 ^ q6 ^ r2 ^ r6 ^ r7);
+	q[3] = q0 ^ q1 ^ q2 ^ q5 ^ q6 ^ r0 ^ r2 ^ r3 ^ r5 ^ cl_aes_rotr32(q0 ^ q1 ^ q3 ^ q5 ^ q6 ^ q7 ^ r0 ^ r3 ^ r5 ^ r7);
+	q[4] = q1 ^ q2 ^ q3 ^ q5 ^ r1 ^ r3 ^ r4 ^ r5 ^ r6 ^ r7 ^ cl_aes_rotr32(q1 ^ q2 ^ q4 ^ q5 ^ q7 ^ r1 ^ r4 ^ r5 ^ r6);
+	q[5] = q2 ^ q3 ^ q4 ^ q6 ^ r2 ^ r4 ^ r5 ^ r6 ^ r7 ^ cl_aes_rotr32(q2 ^ q3 ^ q5 ^ q6 ^ r2 ^ r5 ^ r6 ^ r7);
+	q[6] = q3 ^ q4 ^ q5 ^ q7 ^ r3 ^ r5 ^ r6 ^ r7 ^ cl_aes_rotr32(q3 ^ q4 ^ q6 ^ q7 ^ r3 ^ r6 ^ r7);
+	q[7] = q4 ^ q5 ^ q6 ^ r4 ^ r6 ^ r7 ^ cl_aes_rotr32(q4 ^ q5 ^ q7 ^ r4 ^ r7);
+}
+
+}
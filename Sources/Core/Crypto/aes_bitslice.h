@@ -0,0 +1,74 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+**    Mark Page
+*/
+
+#pragma once
+
+#include "API/Core/System/cl_platform.h"
+
+namespace clan
+{
+
+/// \brief Constant-time bitsliced AES
+///
+/// Four blocks are processed at a time, spread over eight 64 bit words so that each word
+/// holds one bit of every byte. The S-box is computed with boolean operations instead of
+/// a table lookup, so the timing does not depend on the key or the data.
+class AES_Bitslice
+{
+public:
+	/// \brief Number of blocks processed by encrypt() and decrypt()
+	static const int num_parallel_blocks = 4;
+
+	/// \brief Applies the S-box to one 32 bit word (used by the key schedule)
+	static ubyte32 sub_word(ubyte32 x);
+
+	/// \brief Converts round key words (in little endian byte order) to the bitsliced round keys
+	static void expand_key(const ubyte32 *round_key_words, int num_rounds, ubyte64 *bitsliced_keys);
+
+	/// \brief Converts four 16 byte blocks to and from the bitsliced representation
+	static void load_blocks(const unsigned char *input, ubyte64 q[8]);
+	static void store_blocks(const ubyte64 q[8], unsigned char *output);
+
+	/// \brief Encrypts or decrypts four bitsliced blocks
+	static void encrypt(int num_rounds, const ubyte64 *bitsliced_keys, ubyte64 q[8]);
+	static void decrypt(int num_rounds, const ubyte64 *bitsliced_keys, ubyte64 q[8]);
+
+private:
+	static void sbox(ubyte64 *q);
+	static void inverse_sbox(ubyte64 *q);
+	static void ortho(ubyte64 *q);
+	static void interleave_in(ubyte64 *q0, ubyte64 *q1, const ubyte32 *w);
+	static void interleave_out(ubyte32 *w, ubyte64 q0, ubyte64 q1);
+	static void shift_rows(ubyte64 *q);
+	static void inverse_shift_rows(ubyte64 *q);
+	static void mix_columns(ubyte64 *q);
+	static void inverse_mix_columns(ubyte64 *q);
+};
+
+}
@@ -0,0 +1,151 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Core/precomp.h"
+#include "aes_ctr_impl.h"
+
+#ifndef WIN32
+#include <cstring>
+#endif
+
+namespace clan
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// AES_CTR_Impl Construction:
+
+AES_CTR_Impl::AES_CTR_Impl() : keystream_position(block_size_bytes), counter_low_32_bits(false), initialisation_vector_set(false), cipher_key_set(false)
+{
+	memset(counter, 0, sizeof(counter));
+	memset(keystream, 0, sizeof(keystream));
+	reset();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// AES_CTR_Impl Attributes:
+
+DataBuffer AES_CTR_Impl::get_data() const
+{
+	return databuffer;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// AES_CTR_Impl Operations:
+
+void AES_CTR_Impl::reset()
+{
+	calculated = false;
+	keystream_position = block_size_bytes;
+	memset(keystream, 0, sizeof(keystream));
+	databuffer.set_size(0);
+}
+
+void AES_CTR_Impl::set_iv(const unsigned char iv[16])
+{
+	set_counter(iv, false);
+	initialisation_vector_set = true;
+}
+
+void AES_CTR_Impl::set_key(const unsigned char *key, int key_length)
+{
+	set_cipher_key(key, key_length);
+	cipher_key_set = true;
+}
+
+void AES_CTR_Impl::add(const void *data, int size)
+{
+	if (calculated)
+		reset();
+
+	if (!initialisation_vector_set)
+		throw Exception("AES-CTR initialisation vector has not been set");
+
+	if (!cipher_key_set)
+		throw Exception("AES-CTR cipher key has not been set");
+
+	if (size > 0)
+		process_stream((const unsigned char *) data, append_data(databuffer, size), size);
+}
+
+void AES_CTR_Impl::calculate()
+{
+	if (calculated)
+		reset();
+
+	calculated = true;
+	initialisation_vector_set = false;	// Force to reset after each call
+	cipher_key_set = false;				// Force to reset after each call (to avoid keeping the cipher key in memory)
+	clear_cipher_key();	// Remove the key from memory
+	memset(keystream, 0, sizeof(keystream));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// AES_CTR_Impl Implementation:
+
+void AES_CTR_Impl::set_counter(const unsigned char counter_block[16], bool increment_low_32_bits)
+{
+	memcpy(counter, counter_block, block_size_bytes);
+	counter_low_32_bits = increment_low_32_bits;
+	keystream_position = block_size_bytes;
+}
+
+void AES_CTR_Impl::process_stream(const unsigned char *input, unsigned char *output, int size)
+{
+	int pos = 0;
+
+	// Use what is left of the key stream block from the previous call
+	while (keystream_position < block_size_bytes && pos < size)
+	{
+		output[pos] = input[pos] ^ keystream[keystream_position];
+		keystream_position++;
+		pos++;
+	}
+
+	int num_blocks = (size - pos) / block_size_bytes;
+	if (num_blocks > 0)
+	{
+		process_ctr(counter, input + pos, output + pos, num_blocks, counter_low_32_bits);
+		pos += num_blocks * block_size_bytes;
+	}
+
+	if (pos < size)
+	{
+		unsigned char zero_block[block_size_bytes];
+		memset(zero_block, 0, sizeof(zero_block));
+		process_ctr(counter, zero_block, keystream, 1, counter_low_32_bits);
+		keystream_position = 0;
+		while (pos < size)
+		{
+			output[pos] = input[pos] ^ keystream[keystream_position];
+			keystream_position++;
+			pos++;
+		}
+	}
+}
+
+}
@@ -0,0 +1,97 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "API/Core/System/cl_platform.h"
+#include "API/Core/System/databuffer.h"
+#include "aes_impl.h"
+
+namespace clan
+{
+
+class AES_CTR_Impl : public AES_Impl
+{
+/// \name Construction
+/// \{
+
+public:
+	AES_CTR_Impl();
+
+/// \}
+/// \name Attributes
+/// \{
+
+	/// \brief Get the processed data
+	DataBuffer get_data() const;
+
+/// \}
+/// \name Operations
+/// \{
+
+public:
+	/// \brief Resets the cipher
+	void reset();
+
+	/// \brief Sets the initial counter block
+	void set_iv(const unsigned char iv[16]);
+
+	/// \brief Sets the cipher key
+	void set_key(const unsigned char *key, int key_length);
+
+	/// \brief Adds data to be processed
+	void add(const void *data, int size);
+
+	/// \brief Finalize the cipher
+	void calculate();
+
+/// \}
+/// \name Implementation
+/// \{
+
+protected:
+	/// \brief Sets the counter block used by process_stream()
+	void set_counter(const unsigned char counter_block[16], bool increment_low_32_bits);
+
+	/// \brief XORs the data with the key stream, continuing where the previous call stopped
+	void process_stream(const unsigned char *input, unsigned char *output, int size);
+
+	unsigned char counter[block_size_bytes];
+	unsigned char keystream[block_size_bytes];
+	int keystream_position;
+	bool counter_low_32_bits;
+
+	bool initialisation_vector_set;
+	bool cipher_key_set;
+	bool calculated;
+
+	DataBuffer databuffer;
+/// \}
+};
+
+}
@@ -0,0 +1,549 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+**    Thomas Pornin (portable GHASH from BearSSL, see below)
+*/
+
+/*
+**  The portable GHASH in this file (cl_bmul64, cl_rev64 and
+**  cl_ghash_portable) is a port of ghash_ctmul64.c from BearSSL
+**  (https://www.bearssl.org/), which is distributed under this license:
+**
+**  Copyright (c) 2016 Thomas Pornin <pornin@bolet.org>
+**
+**  Permission is hereby granted, free of charge, to any person obtaining
+**  a copy of this software and associated documentation files (the
+**  "Software"), to deal in the Software without restriction, including
+**  without limitation the rights to use, copy, modify, merge, publish,
+**  distribute, sublicense, and/or sell copies of the Software, and to
+**  permit persons to whom the Software is furnished to do so, subject to
+**  the following conditions:
+**
+**  The above copyright notice and this permission notice shall be
+**  included in all copies or substantial portions of the Software.
+**
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+**  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+**  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+**  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+**  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+**  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+**  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+**  SOFTWARE.
+*/
+
+#include "Core/precomp.h"
+#include "aes_gcm_impl.h"
+#include "API/Core/Math/cl_math.h"
+
+#ifndef WIN32
+#include <cstring>
+#endif
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+	#if defined(_MSC_VER) && _MSC_VER >= 1600
+		#define CL_GHASH_PCLMUL
+		#define cl_target_pclmul
+		#include <wmmintrin.h>
+		#include <tmmintrin.h>
+	#elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+		#define CL_GHASH_PCLMUL
+		#define cl_target_pclmul __attribute__((target("pclmul,ssse3")))
+		#include <wmmintrin.h>
+		#include <tmmintrin.h>
+	#endif
+#endif
+
+namespace clan
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// GHASH kernels:
+
+static inline ubyte64 cl_load_be64(const unsigned char *p)
+{
+	ubyte64 value = 0;
+	for (int i = 0; i < 8; i++)
+		value = (value << 8) | p[i];
+	return value;
+}
+
+static inline void cl_store_be64(unsigned char *p, ubyte64 value)
+{
+	for (int i = 7; i >= 0; i--)
+	{
+		p[i] = (unsigned char)value;
+		value >>= 8;
+	}
+}
+
+// Carry-less 64x64 multiplication (low half) using integer multiplies with holes between the bits, so carries cannot spill
+static inline ubyte64 cl_bmul64(ubyte64 x, ubyte64 y)
+{
+	ubyte64 x0 = x & 0x1111111111111111ULL;
+	ubyte64 x1 = x & 0x2222222222222222ULL;
+	ubyte64 x2 = x & 0x4444444444444444ULL;
+	ubyte64 x3 = x & 0x8888888888888888ULL;
+	ubyte64 y0 = y & 0x1111111111111111ULL;
+	ubyte64 y1 = y & 0x2222222222222222ULL;
+	ubyte64 y2 = y & 0x4444444444444444ULL;
+	ubyte64 y3 = y & 0x8888888888888888ULL;
+	ubyte64 z0 = (x0 * y0) ^ (x1 * y3) ^ (x2 * y2) ^ (x3 * y1);
+	ubyte64 z1 = (x0 * y1) ^ (x1 * y0) ^ (x2 * y3) ^ (x3 * y2);
+	ubyte64 z2 = (x0 * y2) ^ (x1 * y1) ^ (x2 * y0) ^ (x3 * y3);
+	ubyte64 z3 = (x0 * y3) ^ (x1 * y2) ^ (x2 * y1) ^ (x3 * y0);
+	z0 &= 0x1111111111111111ULL;
+	z1 &= 0x2222222222222222ULL;
+	z2 &= 0x4444444444444444ULL;
+	z3 &= 0x8888888888888888ULL;
+	return z0 | z1 | z2 | z3;
+}
+
+static inline ubyte64 cl_rev64(ubyte64 x)
+{
+	x = ((x & 0x5555555555555555ULL) << 1) | ((x >> 1) & 0x5555555555555555ULL);
+	x = ((x & 0x3333333333333333ULL) << 2) | ((x >> 2) & 0x3333333333333333ULL);
+	x = ((x & 0x0F0F0F0F0F0F0F0FULL) << 4) | ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL);
+	x = ((x & 0x00FF00FF00FF00FFULL) << 8) | ((x >> 8) & 0x00FF00FF00FF00FFULL);
+	x = ((x & 0x0000FFFF0000FFFFULL) << 16) | ((x >> 16) & 0x0000FFFF0000FFFFULL);
+	return (x << 32) | (x >> 32);
+}
+
+// Constant-time GHASH without table lookups. The high halves of the products are computed by multiplying the bit reversed operands.
+static void cl_ghash_portable(unsigned char state[16], const unsigned char hash_key[16], const unsigned char *data, int num_blocks)
+{
+	ubyte64 y1 = cl_load_be64(state);
+	ubyte64 y0 = cl_load_be64(state + 8);
+	ubyte64 h1 = cl_load_be64(hash_key);
+	ubyte64 h0 = cl_load_be64(hash_key + 8);
+	ubyte64 h0r = cl_rev64(h0);
+	ubyte64 h1r = cl_rev64(h1);
+	ubyte64 h2 = h0 ^ h1;
+	ubyte64 h2r = h0r ^ h1r;
+
+	for (int block = 0; block < num_blocks; block++)
+	{
+		y1 ^= cl_load_be64(data + block * 16);
+		y0 ^= cl_load_be64(data + block * 16 + 8);
+
+		ubyte64 y0r = cl_rev64(y0);
+		ubyte64 y1r = cl_rev64(y1);
+		ubyte64 y2 = y0 ^ y1;
+		ubyte64 y2r = y0r ^ y1r;
+
+		// Karatsuba multiplication
+		ubyte64 z0 = cl_bmul64(y0, h0);
+		ubyte64 z1 = cl_bmul64(y1, h1);
+		ubyte64 z2 = cl_bmul64(y2, h2);
+		ubyte64 z0h = cl_bmul64(y0r, h0r);
+		ubyte64 z1h = cl_bmul64(y1r, h1r);
+		ubyte64 z2h = cl_bmul64(y2r, h2r);
+		z2 ^= z0 ^ z1;
+		z2h ^= z0h ^ z1h;
+		z0h = cl_rev64(z0h) >> 1;
+		z1h = cl_rev64(z1h) >> 1;
+		z2h = cl_rev64(z2h) >> 1;
+
+		ubyte64 v0 = z0;
+		ubyte64 v1 = z0h ^ z2;
+		ubyte64 v2 = z1 ^ z2h;
+		ubyte64 v3 = z1h;
+
+		// GHASH uses reflected bit order, shift the 255 bit product into place
+		v3 = (v3 << 1) | (v2 >> 63);
+		v2 = (v2 << 1) | (v1 >> 63);
+		v1 = (v1 << 1) | (v0 >> 63);
+		v0 = (v0 << 1);
+
+		// Reduce modulo x^128 + x^7 + x^2 + x + 1
+		v2 ^= v0 ^ (v0 >> 1) ^ (v0 >> 2) ^ (v0 >> 7);
+		v1 ^= (v0 << 63) ^ (v0 << 62) ^ (v0 << 57);
+		v3 ^= v1 ^ (v1 >> 1) ^ (v1 >> 2) ^ (v1 >> 7);
+		v2 ^= (v1 << 63) ^ (v1 << 62) ^ (v1 << 57);
+
+		y0 = v2;
+		y1 = v3;
+	}
+
+	cl_store_be64(state, y1);
+	cl_store_be64(state + 8, y0);
+}
+
+#ifdef CL_GHASH_PCLMUL
+
+// 128x128 bit carry-less multiplication, giving a 256 bit product
+cl_target_pclmul static inline void cl_clmul128(__m128i a, __m128i b, __m128i &low, __m128i &high)
+{
+	__m128i t0 = _mm_clmulepi64_si128(a, b, 0x00);
+	__m128i t1 = _mm_clmulepi64_si128(a, b, 0x10);
+	__m128i t2 = _mm_clmulepi64_si128(a, b, 0x01);
+	__m128i t3 = _mm_clmulepi64_si128(a, b, 0x11);
+	t1 = _mm_xor_si128(t1, t2);
+	low = _mm_xor_si128(t0, _mm_slli_si128(t1, 8));
+	high = _mm_xor_si128(t3, _mm_srli_si128(t1, 8));
+}
+
+// Shifts the byte reflected product left by one bit and reduces it modulo the GCM polynomial
+cl_target_pclmul static inline __m128i cl_ghash_reduce(__m128i low, __m128i high)
+{
+	__m128i t7 = _mm_srli_epi32(low, 31);
+	__m128i t8 = _mm_srli_epi32(high, 31);
+	low = _mm_slli_epi32(low, 1);
+	high = _mm_slli_epi32(high, 1);
+	__m128i t9 = _mm_srli_si128(t7, 12);
+	t8 = _mm_slli_si128(t8, 4);
+	t7 = _mm_slli_si128(t7, 4);
+	low = _mm_or_si128(low, t7);
+	high = _mm_or_si128(high, t8);
+	high = _mm_or_si128(high, t9);
+
+	t7 = _mm_slli_epi32(low, 31);
+	t8 = _mm_slli_epi32(low, 30);
+	t9 = _mm_slli_epi32(low, 25);
+	t7 = _mm_xor_si128(t7, t8);
+	t7 = _mm_xor_si128(t7, t9);
+	t8 = _mm_srli_si128(t7, 4);
+	t7 = _mm_slli_si128(t7, 12);
+	low = _mm_xor_si128(low, t7);
+
+	__m128i t2 = _mm_srli_epi32(low, 1);
+	__m128i t4 = _mm_srli_epi32(low, 2);
+	__m128i t5 = _mm_srli_epi32(low, 7);
+	t2 = _mm_xor_si128(t2, t4);
+	t2 = _mm_xor_si128(t2, t5);
+	t2 = _mm_xor_si128(t2, t8);
+	low = _mm_xor_si128(low, t2);
+	return _mm_xor_si128(high, low);
+}
+
+cl_target_pclmul static inline __m128i cl_ghash_multiply(__m128i a, __m128i b)
+{
+	__m128i low, high;
+	cl_clmul128(a, b, low, high);
+	return cl_ghash_reduce(low, high);
+}
+
+// Stores H, H^2, H^3 and H^4 in byte reflected order
+cl_target_pclmul static void cl_ghash_pclmul_powers(const unsigned char hash_key[16], unsigned char *hash_key_powers)
+{
+	const __m128i byte_swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i h1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)hash_key), byte_swap);
+	__m128i h2 = cl_ghash_multiply(h1, h1);
+	__m128i h3 = cl_ghash_multiply(h2, h1);
+	__m128i h4 = cl_ghash_multiply(h3, h1);
+	_mm_storeu_si128((__m128i *)hash_key_powers, h1);
+	_mm_storeu_si128((__m128i *)(hash_key_powers + 16), h2);
+	_mm_storeu_si128((__m128i *)(hash_key_powers + 32), h3);
+	_mm_storeu_si128((__m128i *)(hash_key_powers + 48), h4);
+}
+
+cl_target_pclmul static void cl_ghash_pclmul(unsigned char state[16], const unsigned char *hash_key_powers, const unsigned char *data, int num_blocks)
+{
+	const __m128i byte_swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i h1 = _mm_loadu_si128((const __m128i *)hash_key_powers);
+	__m128i h2 = _mm_loadu_si128((const __m128i *)(hash_key_powers + 16));
+	__m128i h3 = _mm_loadu_si128((const __m128i *)(hash_key_powers + 32));
+	__m128i h4 = _mm_loadu_si128((const __m128i *)(hash_key_powers + 48));
+	__m128i y = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)state), byte_swap);
+
+	// Four blocks share one reduction: Y' = (Y + X1) H^4 + X2 H^3 + X3 H^2 + X4 H
+	int block = 0;
+	for (; block + 4 <= num_blocks; block += 4)
+	{
+		__m128i x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + block * 16)), byte_swap);
+		__m128i x2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + block * 16 + 16)), byte_swap);
+		__m128i x3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + block * 16 + 32)), byte_swap);
+		__m128i x4 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + block * 16 + 48)), byte_swap);
+
+		__m128i low, high, low2, high2;
+		cl_clmul128(_mm_xor_si128(y, x1), h4, low, high);
+		cl_clmul128(x2, h3, low2, high2);
+		low = _mm_xor_si128(low, low2);
+		high = _mm_xor_si128(high, high2);
+		cl_clmul128(x3, h2, low2, high2);
+		low = _mm_xor_si128(low, low2);
+		high = _mm_xor_si128(high, high2);
+		cl_clmul128(x4, h1, low2, high2);
+		low = _mm_xor_si128(low, low2);
+		high = _mm_xor_si128(high, high2);
+		y = cl_ghash_reduce(low, high);
+	}
+	for (; block < num_blocks; block++)
+	{
+		__m128i x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + block * 16)), byte_swap);
+		y = cl_ghash_multiply(_mm_xor_si128(y, x), h1);
+	}
+
+	_mm_storeu_si128((__m128i *)state, _mm_shuffle_epi8(y, byte_swap));
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+// AES_GCM_Impl Construction:
+
+AES_GCM_Impl::AES_GCM_Impl(bool decrypt_mode) : decrypt_mode(decrypt_mode), use_pclmul(false)
+{
+	memset(pre_counter_block, 0, sizeof(pre_counter_block));
+	memset(tag, 0, sizeof(tag));
+	memset(hash_key, 0, sizeof(hash_key));
+	memset(hash_key_powers, 0, sizeof(hash_key_powers));
+	reset();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// AES_GCM_Impl Attributes:
+
+void AES_GCM_Impl::get_tag(unsigned char out_tag[16]) const
+{
+	if (!calculated)
+		throw Exception("AES-GCM authentication tag is not available until calculate() has been called");
+	memcpy(out_tag, tag, block_size_bytes);
+}
+
+bool AES_GCM_Impl::verify_tag(const unsigned char expected_tag[16]) const
+{
+	unsigned char difference = 0;
+	for (int i = 0; i < block_size_bytes; i++)
+		difference |= tag[i] ^ expected_tag[i];
+	return calculated && difference == 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// AES_GCM_Impl Operations:
+
+void AES_GCM_Impl::reset()
+{
+	AES_CTR_Impl::reset();
+	data_started = false;
+	memset(hash_state, 0, sizeof(hash_state));
+	memset(hash_buffer, 0, sizeof(hash_buffer));
+	hash_buffer_filled = 0;
+	authenticated_data_length = 0;
+	data_length = 0;
+}
+
+void AES_GCM_Impl::set_key(const unsigned char *key, int key_length)
+{
+	AES_CTR_Impl::set_key(key, key_length);
+
+	// The hash key is the encrypted zero block
+	unsigned char zero_block[block_size_bytes];
+	memset(zero_block, 0, sizeof(zero_block));
+	encrypt_ecb(zero_block, hash_key, 1);
+
+	use_pclmul = is_using_aesni() && is_pclmul_supported();
+#ifdef CL_GHASH_PCLMUL
+	if (use_pclmul)
+		cl_ghash_pclmul_powers(hash_key, hash_key_powers);
+#endif
+}
+
+void AES_GCM_Impl::set_iv(const unsigned char *iv, int iv_length)
+{
+	if (!cipher_key_set)
+		throw Exception("AES-GCM cipher key must be set before the initialisation vector");
+	if (iv_length <= 0)
+		throw Exception("AES-GCM initialisation vector must not be empty");
+
+	if (calculated)
+		reset();
+
+	if (iv_length == 12)
+	{
+		memcpy(pre_counter_block, iv, 12);
+		pre_counter_block[12] = 0;
+		pre_counter_block[13] = 0;
+		pre_counter_block[14] = 0;
+		pre_counter_block[15] = 1;
+	}
+	else
+	{
+		memset(hash_state, 0, sizeof(hash_state));
+		ghash_add(iv, iv_length);
+		ghash_pad();
+		ghash_lengths(0, (ubyte64)iv_length * 8);
+		memcpy(pre_counter_block, hash_state, block_size_bytes);
+	}
+
+	// The first block of the key stream is used for the tag, the data starts at the next counter value
+	unsigned char first_counter[block_size_bytes];
+	memcpy(first_counter, pre_counter_block, block_size_bytes);
+	for (int i = 15; i >= 12; i--)
+	{
+		if (++first_counter[i] != 0)
+			break;
+	}
+	set_counter(first_counter, true);
+
+	data_started = false;
+	memset(hash_state, 0, sizeof(hash_state));
+	hash_buffer_filled = 0;
+	authenticated_data_length = 0;
+	data_length = 0;
+	initialisation_vector_set = true;
+}
+
+void AES_GCM_Impl::add_authenticated_data(const void *data, int size)
+{
+	if (!initialisation_vector_set)
+		throw Exception("AES-GCM initialisation vector has not been set");
+	if (data_started)
+		throw Exception("AES-GCM authenticated data must be added before the data to be processed");
+
+	ghash_add((const unsigned char *) data, size);
+	authenticated_data_length += size;
+}
+
+void AES_GCM_Impl::add(const void *_data, int size)
+{
+	if (calculated)
+		reset();
+
+	if (!initialisation_vector_set)
+		throw Exception("AES-GCM initialisation vector has not been set");
+
+	if (!cipher_key_set)
+		throw Exception("AES-GCM cipher key has not been set");
+
+	if (!data_started)
+	{
+		ghash_pad();
+		data_started = true;
+	}
+
+	if (size <= 0)
+		return;
+
+	const unsigned char *data = (const unsigned char *) _data;
+	unsigned char *output = append_data(databuffer, size);
+	for (int pos = 0; pos < size; pos += segment_size)
+	{
+		int length = min(segment_size, size - pos);
+		if (decrypt_mode)
+		{
+			ghash_add(data + pos, length);
+			process_stream(data + pos, output + pos, length);
+		}
+		else
+		{
+			process_stream(data + pos, output + pos, length);
+			ghash_add(output + pos, length);
+		}
+	}
+	data_length += size;
+}
+
+void AES_GCM_Impl::calculate()
+{
+	if (calculated)
+		reset();
+
+	if (!initialisation_vector_set)
+		throw Exception("AES-GCM initialisation vector has not been set");
+
+	if (!data_started)
+		ghash_pad();
+	ghash_pad();
+	ghash_lengths(authenticated_data_length * 8, data_length * 8);
+
+	encrypt_ecb(pre_counter_block, tag, 1);
+	for (int i = 0; i < block_size_bytes; i++)
+		tag[i] ^= hash_state[i];
+
+	calculated = true;
+	initialisation_vector_set = false;	// Force to reset after each call
+	cipher_key_set = false;				// Force to reset after each call (to avoid keeping the cipher key in memory)
+	clear_cipher_key();	// Remove the key from memory
+	memset(keystream, 0, sizeof(keystream));
+	memset(hash_key, 0, sizeof(hash_key));
+	memset(hash_key_powers, 0, sizeof(hash_key_powers));
+	memset(hash_state, 0, sizeof(hash_state));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// AES_GCM_Impl Implementation:
+
+void AES_GCM_Impl::ghash_add(const unsigned char *data, int size)
+{
+	int pos = 0;
+	if (hash_buffer_filled > 0)
+	{
+		int data_used = min(block_size_bytes - hash_buffer_filled, size);
+		memcpy(hash_buffer + hash_buffer_filled, data, data_used);
+		hash_buffer_filled += data_used;
+		pos += data_used;
+		if (hash_buffer_filled == block_size_bytes)
+		{
+			ghash_blocks(hash_buffer, 1);
+			hash_buffer_filled = 0;
+		}
+	}
+
+	if (hash_buffer_filled == 0)
+	{
+		int num_blocks = (size - pos) / block_size_bytes;
+		if (num_blocks > 0)
+		{
+			ghash_blocks(data + pos, num_blocks);
+			pos += num_blocks * block_size_bytes;
+		}
+		memcpy(hash_buffer, data + pos, size - pos);
+		hash_buffer_filled = size - pos;
+	}
+}
+
+void AES_GCM_Impl::ghash_pad()
+{
+	if (hash_buffer_filled > 0)
+	{
+		memset(hash_buffer + hash_buffer_filled, 0, block_size_bytes - hash_buffer_filled);
+		ghash_blocks(hash_buffer, 1);
+		hash_buffer_filled = 0;
+	}
+}
+
+void AES_GCM_Impl::ghash_lengths(ubyte64 first_length, ubyte64 second_length)
+{
+	unsigned char block[block_size_bytes];
+	cl_store_be64(block, first_length);
+	cl_store_be64(block + 8, second_length);
+	ghash_blocks(block, 1);
+}
+
+void AES_GCM_Impl::ghash_blocks(const unsigned char *data, int num_blocks)
+{
+#ifdef CL_GHASH_PCLMUL
+	if (use_pclmul)
+	{
+		cl_ghash_pclmul(hash_state, hash_key_powers, data, num_blocks);
+		return;
+	}
+#endif
+	cl_ghash_portable(hash_state, hash_key, data, num_blocks);
+}
+
+}
@@ -0,0 +1,102 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "API/Core/System/cl_platform.h"
+#include "API/Core/System/databuffer.h"
+#include "aes_ctr_impl.h"
+
+namespace clan
+{
+
+/// \brief AES in Galois/Counter Mode (NIST SP 800-38D)
+///
+/// The data is processed in segments that are first run through the counter mode cipher
+/// and then through GHASH, so that the second pass reads the data from the cache.
+class AES_GCM_Impl : public AES_CTR_Impl
+{
+/// \name Construction
+/// \{
+
+public:
+	AES_GCM_Impl(bool decrypt_mode);
+
+/// \}
+/// \name Attributes
+/// \{
+
+	/// \brief Get the authentication tag (valid after calculate())
+	void get_tag(unsigned char out_tag[16]) const;
+
+	/// \brief Compares the authentication tag in constant time
+	bool verify_tag(const unsigned char expected_tag[16]) const;
+
+/// \}
+/// \name Operations
+/// \{
+
+public:
+	void reset();
+	void set_iv(const unsigned char *iv, int iv_length);
+	void set_key(const unsigned char *key, int key_length);
+	void add_authenticated_data(const void *data, int size);
+	void add(const void *data, int size);
+	void calculate();
+
+/// \}
+/// \name Implementation
+/// \{
+
+private:
+	void ghash_add(const unsigned char *data, int size);
+	void ghash_pad();
+	void ghash_lengths(ubyte64 first_length, ubyte64 second_length);
+	void ghash_blocks(const unsigned char *data, int num_blocks);
+
+	static const int segment_size = 16 * 1024;
+
+	bool decrypt_mode;
+	bool use_pclmul;
+	bool data_started;
+
+	unsigned char pre_counter_block[block_size_bytes];
+	unsigned char tag[block_size_bytes];
+
+	unsigned char hash_key[block_size_bytes];
+	unsigned char hash_key_powers[4 * block_size_bytes];
+	unsigned char hash_state[block_size_bytes];
+	unsigned char hash_buffer[block_size_bytes];
+	int hash_buffer_filled;
+
+	ubyte64 authenticated_data_length;
+	ubyte64 data_length;
+/// \}
+};
+
+}
@@ -28,274 +28,503 @@
 */
 
 #include "Core/precomp.h"
-#include "API/Core/System/cl_platform.h"
-#include "API/Core/System/databuffer.h"
-#include "API/Core/Math/cl_math.h"
 #include "aes_impl.h"
+#include "aes_bitslice.h"
+#include "API/Core/System/system.h"
+#include "API/Core/Math/cl_math.h"
 
 #ifndef WIN32
 #include <cstring>
 #endif
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+	#if defined(_MSC_VER) && _MSC_VER >= 1600
+		#define CL_AES_NI
+		#define cl_target_aesni
+		#include <wmmintrin.h>
+		#include <tmmintrin.h>
+	#elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+		#define CL_AES_NI
+		#define cl_target_aesni __attribute__((target("aes,ssse3")))
+		#include <wmmintrin.h>
+		#include <tmmintrin.h>
+	#endif
+#endif
+
 namespace clan
 {
 
+#ifdef CL_AES_NI
+
 /////////////////////////////////////////////////////////////////////////////
-// AES_Impl Construction:
+// AES-NI kernels:
+//
+// Independent blocks are processed eight at a time to hide the latency of the AESENC/AESDEC instructions.
 
-AES_Impl::AES_Impl()
+static const int cl_aesni_parallel_blocks = 8;
+
+cl_target_aesni static inline __m128i cl_aesni_encrypt_block(const __m128i *keys, int num_rounds, __m128i block)
+{
+	block = _mm_xor_si128(block, keys[0]);
+	for (int round = 1; round < num_rounds; round++)
+		block = _mm_aesenc_si128(block, keys[round]);
+	return _mm_aesenclast_si128(block, keys[num_rounds]);
+}
+
+cl_target_aesni static inline void cl_aesni_encrypt_blocks8(const __m128i *keys, int num_rounds, __m128i *b)
 {
-	if (!is_tables_created)
+	for (int i = 0; i < 8; i++)
+		b[i] = _mm_xor_si128(b[i], keys[0]);
+	for (int round = 1; round < num_rounds; round++)
 	{
-		create_tables();
-		is_tables_created = true;
+		__m128i key = keys[round];
+		b[0] = _mm_aesenc_si128(b[0], key);
+		b[1] = _mm_aesenc_si128(b[1], key);
+		b[2] = _mm_aesenc_si128(b[2], key);
+		b[3] = _mm_aesenc_si128(b[3], key);
+		b[4] = _mm_aesenc_si128(b[4], key);
+		b[5] = _mm_aesenc_si128(b[5], key);
+		b[6] = _mm_aesenc_si128(b[6], key);
+		b[7] = _mm_aesenc_si128(b[7], key);
 	}
+	for (int i = 0; i < 8; i++)
+		b[i] = _mm_aesenclast_si128(b[i], keys[num_rounds]);
 }
 
-/////////////////////////////////////////////////////////////////////////////
-// AES_Impl Attributes:
-
-bool AES_Impl::is_tables_created = false;
-
-ubyte32 AES_Impl::table_e0[256];
-ubyte32 AES_Impl::table_e1[256];
-ubyte32 AES_Impl::table_e2[256];
-ubyte32 AES_Impl::table_e3[256];
-ubyte32 AES_Impl::table_d0[256];
-ubyte32 AES_Impl::table_d1[256];
-ubyte32 AES_Impl::table_d2[256];
-ubyte32 AES_Impl::table_d3[256];
-ubyte32 AES_Impl::sbox_inverse_substitution_values[256];
-ubyte32 AES_Impl::sbox_substitution_values[256];
-ubyte32 AES_Impl::rcon_values[10];
+cl_target_aesni static void cl_aesni_encrypt_ecb(const unsigned char *round_keys, int num_rounds, const unsigned char *input, unsigned char *output, int num_blocks)
+{
+	__m128i keys[AES_Impl::max_num_rounds + 1];
+	for (int i = 0; i <= num_rounds; i++)
+		keys[i] = _mm_loadu_si128((const __m128i *)(round_keys + i * 16));
 
-/////////////////////////////////////////////////////////////////////////////
-// AES_Impl Operations:
+	int block = 0;
+	for (; block + cl_aesni_parallel_blocks <= num_blocks; block += cl_aesni_parallel_blocks)
+	{
+		__m128i b[8];
+		for (int i = 0; i < 8; i++)
+			b[i] = _mm_loadu_si128((const __m128i *)(input + (block + i) * 16));
+		cl_aesni_encrypt_blocks8(keys, num_rounds, b);
+		for (int i = 0; i < 8; i++)
+			_mm_storeu_si128((__m128i *)(output + (block + i) * 16), b[i]);
+	}
+	for (; block < num_blocks; block++)
+	{
+		__m128i b = _mm_loadu_si128((const __m128i *)(input + block * 16));
+		_mm_storeu_si128((__m128i *)(output + block * 16), cl_aesni_encrypt_block(keys, num_rounds, b));
+	}
+}
 
-void AES_Impl::extract_encrypt_key128(const unsigned char key[aes128_key_length_bytes], ubyte32 key_expanded[aes128_nb_mult_nr_plus1])
+cl_target_aesni static void cl_aesni_encrypt_cbc(const unsigned char *round_keys, int num_rounds, unsigned char iv[16], const unsigned char *input, unsigned char *output, int num_blocks)
 {
-	for (int cnt=0; cnt<aes128_key_length_nk; cnt++)
+	__m128i keys[AES_Impl::max_num_rounds + 1];
+	for (int i = 0; i <= num_rounds; i++)
+		keys[i] = _mm_loadu_si128((const __m128i *)(round_keys + i * 16));
+
+	// Each block depends on the previous ciphertext, so CBC encryption cannot be interleaved
+	__m128i chain = _mm_loadu_si128((const __m128i *)iv);
+	for (int block = 0; block < num_blocks; block++)
 	{
-		key_expanded[cnt] = get_word(key + 4*cnt);
+		__m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(input + block * 16)), chain);
+		chain = cl_aesni_encrypt_block(keys, num_rounds, b);
+		_mm_storeu_si128((__m128i *)(output + block * 16), chain);
 	}
+	_mm_storeu_si128((__m128i *)iv, chain);
+}
 
-	ubyte32 *key_expanded_ptr = key_expanded;
+cl_target_aesni static void cl_aesni_decrypt_cbc(const unsigned char *inverse_round_keys, int num_rounds, unsigned char iv[16], const unsigned char *input, unsigned char *output, int num_blocks)
+{
+	__m128i keys[AES_Impl::max_num_rounds + 1];
+	for (int i = 0; i <= num_rounds; i++)
+		keys[i] = _mm_loadu_si128((const __m128i *)(inverse_round_keys + i * 16));
 
-	for (int cnt=0; cnt < aes128_num_rounds_nr; cnt++)
+	__m128i chain = _mm_loadu_si128((const __m128i *)iv);
+	int block = 0;
+	for (; block + cl_aesni_parallel_blocks <= num_blocks; block += cl_aesni_parallel_blocks)
+	{
+		__m128i c[8];
+		__m128i b[8];
+		for (int i = 0; i < 8; i++)
+		{
+			c[i] = _mm_loadu_si128((const __m128i *)(input + (block + i) * 16));
+			b[i] = _mm_xor_si128(c[i], keys[0]);
+		}
+		for (int round = 1; round < num_rounds; round++)
+		{
+			__m128i key = keys[round];
+			b[0] = _mm_aesdec_si128(b[0], key);
+			b[1] = _mm_aesdec_si128(b[1], key);
+			b[2] = _mm_aesdec_si128(b[2], key);
+			b[3] = _mm_aesdec_si128(b[3], key);
+			b[4] = _mm_aesdec_si128(b[4], key);
+			b[5] = _mm_aesdec_si128(b[5], key);
+			b[6] = _mm_aesdec_si128(b[6], key);
+			b[7] = _mm_aesdec_si128(b[7], key);
+		}
+		for (int i = 0; i < 8; i++)
+		{
+			b[i] = _mm_aesdeclast_si128(b[i], keys[num_rounds]);
+			b[i] = _mm_xor_si128(b[i], chain);
+			chain = c[i];
+			// Output may overlap the input, so store only after the ciphertext block was loaded
+			_mm_storeu_si128((__m128i *)(output + (block + i) * 16), b[i]);
+		}
+	}
+	for (; block < num_blocks; block++)
 	{
-		ubyte32 temp = key_expanded_ptr[3];
-		key_expanded_ptr[4] = key_expanded_ptr[0] ^
-		(sbox_substitution_values[(temp >> 16) & 0xff] & 0xff000000) ^
-		(sbox_substitution_values[(temp >>  8) & 0xff] & 0x00ff0000) ^
-		(sbox_substitution_values[(temp      ) & 0xff] & 0x0000ff00) ^
-		(sbox_substitution_values[(temp >> 24)       ] & 0x000000ff) ^
-		rcon_values[cnt];
-		key_expanded_ptr[5] = key_expanded_ptr[1] ^ key_expanded_ptr[4];
-		key_expanded_ptr[6] = key_expanded_ptr[2] ^ key_expanded_ptr[5];
-		key_expanded_ptr[7] = key_expanded_ptr[3] ^ key_expanded_ptr[6];
-
-		key_expanded_ptr += 4;
+		__m128i c = _mm_loadu_si128((const __m128i *)(input + block * 16));
+		__m128i b = _mm_xor_si128(c, keys[0]);
+		for (int round = 1; round < num_rounds; round++)
+			b = _mm_aesdec_si128(b, keys[round]);
+		b = _mm_aesdeclast_si128(b, keys[num_rounds]);
+		_mm_storeu_si128((__m128i *)(output + block * 16), _mm_xor_si128(b, chain));
+		chain = c;
 	}
+	_mm_storeu_si128((__m128i *)iv, chain);
 }
 
-void AES_Impl::extract_encrypt_key192(const unsigned char key[aes192_key_length_bytes], ubyte32 key_expanded[aes192_nb_mult_nr_plus1])
+cl_target_aesni static void cl_aesni_ctr(const unsigned char *round_keys, int num_rounds, unsigned char counter[16], const unsigned char *input, unsigned char *output, int num_blocks, bool increment_low_32_bits)
 {
-	for (int cnt=0; cnt<aes192_key_length_nk; cnt++)
+	__m128i keys[AES_Impl::max_num_rounds + 1];
+	for (int i = 0; i <= num_rounds; i++)
+		keys[i] = _mm_loadu_si128((const __m128i *)(round_keys + i * 16));
+
+	ubyte64 counter_high = 0;
+	ubyte64 counter_low = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		counter_high = (counter_high << 8) | counter[i];
+		counter_low = (counter_low << 8) | counter[i + 8];
+	}
+
+	const __m128i byte_swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	const ubyte64 low_32_mask = 0xffffffffULL;
+
+	int block = 0;
+	while (block < num_blocks)
 	{
-		key_expanded[cnt] = get_word(key + 4*cnt);
+		int count = min(num_blocks - block, cl_aesni_parallel_blocks);
+		__m128i b[8];
+		for (int i = 0; i < 8; i++)
+		{
+			b[i] = _mm_shuffle_epi8(_mm_set_epi64x((byte64)counter_high, (byte64)counter_low), byte_swap);
+			if (i >= count)
+				continue;
+			if (increment_low_32_bits)
+			{
+				counter_low = (counter_low & ~low_32_mask) | ((counter_low + 1) & low_32_mask);
+			}
+			else
+			{
+				counter_low++;
+				if (counter_low == 0)
+					counter_high++;
+			}
+		}
+		cl_aesni_encrypt_blocks8(keys, num_rounds, b);
+
+		for (int i = 0; i < count; i++)
+		{
+			__m128i data = _mm_loadu_si128((const __m128i *)(input + (block + i) * 16));
+			_mm_storeu_si128((__m128i *)(output + (block + i) * 16), _mm_xor_si128(data, b[i]));
+		}
+		block += count;
 	}
 
-	ubyte32 *key_expanded_ptr = key_expanded;
+	for (int i = 7; i >= 0; i--)
+	{
+		counter[i] = (unsigned char)counter_high;
+		counter[i + 8] = (unsigned char)counter_low;
+		counter_high >>= 8;
+		counter_low >>= 8;
+	}
+}
 
-	for (int cnt=0; cnt < 8; cnt++ )
+cl_target_aesni static void cl_aesni_inverse_round_keys(const unsigned char *round_keys, int num_rounds, unsigned char *inverse_round_keys)
+{
+	// Equivalent inverse cipher: reverse the round order and apply InvMixColumns to the inner round keys
+	memcpy(inverse_round_keys, round_keys + num_rounds * 16, 16);
+	for (int round = 1; round < num_rounds; round++)
 	{
-		ubyte32 temp = key_expanded_ptr[5];
-		key_expanded_ptr[6] = key_expanded_ptr[0] ^
-		(sbox_substitution_values[(temp >> 16) & 0xff] & 0xff000000) ^
-		(sbox_substitution_values[(temp >>  8) & 0xff] & 0x00ff0000) ^
-		(sbox_substitution_values[(temp      ) & 0xff] & 0x0000ff00) ^
-		(sbox_substitution_values[(temp >> 24)       ] & 0x000000ff) ^
-		rcon_values[cnt];
-		key_expanded_ptr[7] = key_expanded_ptr[1] ^ key_expanded_ptr[6];
-		key_expanded_ptr[8] = key_expanded_ptr[2] ^ key_expanded_ptr[7];
-		key_expanded_ptr[9] = key_expanded_ptr[3] ^ key_expanded_ptr[8];
-
-		if (cnt == (8-1))
-			break;
-
-		key_expanded_ptr[10] = key_expanded_ptr[4] ^ key_expanded_ptr[9];
-		key_expanded_ptr[11] = key_expanded_ptr[5] ^ key_expanded_ptr[10];
-
-		key_expanded_ptr += 6;
+		__m128i key = _mm_loadu_si128((const __m128i *)(round_keys + (num_rounds - round) * 16));
+		_mm_storeu_si128((__m128i *)(inverse_round_keys + round * 16), _mm_aesimc_si128(key));
 	}
+	memcpy(inverse_round_keys + num_rounds * 16, round_keys, 16);
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+// AES_Impl Construction:
+
+AES_Impl::AES_Impl() : num_rounds(0), use_aesni(false)
+{
+	memset(round_keys, 0, sizeof(round_keys));
+	memset(inverse_round_keys, 0, sizeof(inverse_round_keys));
+	memset(bitsliced_keys, 0, sizeof(bitsliced_keys));
+}
+
+AES_Impl::~AES_Impl()
+{
+	clear_cipher_key();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// AES_Impl Attributes:
+
+bool AES_Impl::aesni_enabled = true;
+
+bool AES_Impl::is_aesni_supported()
+{
+#ifdef CL_AES_NI
+	static bool supported = System::detect_cpu_extension(System::aes) && System::detect_cpu_extension(System::ssse3);
+	return supported;
+#else
+	return false;
+#endif
+}
+
+bool AES_Impl::is_aesni_enabled()
+{
+	return aesni_enabled && is_aesni_supported();
+}
+
+bool AES_Impl::is_pclmul_supported()
+{
+#ifdef CL_AES_NI
+	static bool supported = System::detect_cpu_extension(System::pclmulqdq) && System::detect_cpu_extension(System::ssse3);
+	return supported;
+#else
+	return false;
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// AES_Impl Operations:
+
+void AES_Impl::set_aesni_enabled(bool enable)
+{
+	aesni_enabled = enable;
 }
 
-void AES_Impl::extract_encrypt_key256(const unsigned char key[aes256_key_length_bytes], ubyte32 key_expanded[aes256_nb_mult_nr_plus1])
+void AES_Impl::set_cipher_key(const unsigned char *key, int key_length_bytes)
 {
-	for (int cnt=0; cnt<aes256_key_length_nk; cnt++)
+	int key_length_nk;
+	switch (key_length_bytes)
 	{
-		key_expanded[cnt] = get_word(key + 4*cnt);
+	case aes128_key_length_bytes:
+		key_length_nk = aes128_key_length_nk;
+		num_rounds = aes128_num_rounds_nr;
+		break;
+	case aes192_key_length_bytes:
+		key_length_nk = aes192_key_length_nk;
+		num_rounds = aes192_num_rounds_nr;
+		break;
+	case aes256_key_length_bytes:
+		key_length_nk = aes256_key_length_nk;
+		num_rounds = aes256_num_rounds_nr;
+		break;
+	default:
+		throw Exception("AES key length must be 16, 24 or 32 bytes");
 	}
 
-	ubyte32 *key_expanded_ptr = key_expanded;
+	// Key expansion (FIPS-197 section 5.2), with the words stored in little endian byte order.
+	// SubWord uses the bitsliced S-box so that no table lookup depends on the key.
+	const int num_words = (num_rounds + 1) * 4;
+	ubyte32 words[(max_num_rounds + 1) * 4];
+	for (int i = 0; i < key_length_nk; i++)
+		words[i] = (ubyte32)key[i * 4] | ((ubyte32)key[i * 4 + 1] << 8) | ((ubyte32)key[i * 4 + 2] << 16) | ((ubyte32)key[i * 4 + 3] << 24);
 
-	for (int cnt=0; cnt < 7; cnt++)
+	ubyte32 rcon = 1;
+	for (int i = key_length_nk; i < num_words; i++)
 	{
-		ubyte32 temp = key_expanded_ptr[7];
-		key_expanded_ptr[8] = key_expanded_ptr[0] ^
-		(sbox_substitution_values[(temp >> 16) & 0xff] & 0xff000000) ^
-		(sbox_substitution_values[(temp >>  8) & 0xff] & 0x00ff0000) ^
-		(sbox_substitution_values[(temp      ) & 0xff] & 0x0000ff00) ^
-		(sbox_substitution_values[(temp >> 24)       ] & 0x000000ff) ^
-		rcon_values[cnt];
-		key_expanded_ptr[9] = key_expanded_ptr[1] ^ key_expanded_ptr[8];
-		key_expanded_ptr[10] = key_expanded_ptr[2] ^ key_expanded_ptr[9];
-		key_expanded_ptr[11] = key_expanded_ptr[3] ^ key_expanded_ptr[10];
-
-		if (cnt == (7-1))
-			break;
-
-		temp = key_expanded_ptr[11];
-		key_expanded_ptr[12] = key_expanded_ptr[4] ^
-		(sbox_substitution_values[(temp >> 24) & 0xff] & 0xff000000) ^
-		(sbox_substitution_values[(temp >> 16) & 0xff] & 0x00ff0000) ^
-		(sbox_substitution_values[(temp >>  8) & 0xff] & 0x0000ff00) ^
-		(sbox_substitution_values[(temp      ) & 0xff] & 0x000000ff);
-		key_expanded_ptr[13] = key_expanded_ptr[5] ^ key_expanded_ptr[12];
-		key_expanded_ptr[14] = key_expanded_ptr[6] ^ key_expanded_ptr[13];
-		key_expanded_ptr[15] = key_expanded_ptr[7] ^ key_expanded_ptr[14];
-		key_expanded_ptr += 8;
+		ubyte32 temp = words[i - 1];
+		if (i % key_length_nk == 0)
+		{
+			temp = AES_Bitslice::sub_word((temp >> 8) | (temp << 24)) ^ rcon;
+			rcon = ((rcon << 1) ^ (0x1b & (0 - (rcon >> 7)))) & 0xff;
+		}
+		else if (key_length_nk > 6 && i % key_length_nk == 4)
+		{
+			temp = AES_Bitslice::sub_word(temp);
+		}
+		words[i] = words[i - key_length_nk] ^ temp;
+	}
 
+	use_aesni = is_aesni_enabled();
+	if (use_aesni)
+	{
+		for (int i = 0; i < num_words; i++)
+		{
+			round_keys[i * 4] = (unsigned char)words[i];
+			round_keys[i * 4 + 1] = (unsigned char)(words[i] >> 8);
+			round_keys[i * 4 + 2] = (unsigned char)(words[i] >> 16);
+			round_keys[i * 4 + 3] = (unsigned char)(words[i] >> 24);
+		}
+#ifdef CL_AES_NI
+		cl_aesni_inverse_round_keys(round_keys, num_rounds, inverse_round_keys);
+#endif
+	}
+	else
+	{
+		AES_Bitslice::expand_key(words, num_rounds, bitsliced_keys);
 	}
+
+	memset(words, 0, sizeof(words));
 }
-void AES_Impl::store_block(ubyte32 s0, ubyte32 s1, ubyte32 s2, ubyte32 s3, DataBuffer &databuffer)
+
+void AES_Impl::clear_cipher_key()
 {
-	// (Note AES 128, 192 and 256 all have the same block size)
+	memset(round_keys, 0, sizeof(round_keys));
+	memset(inverse_round_keys, 0, sizeof(inverse_round_keys));
+	memset(bitsliced_keys, 0, sizeof(bitsliced_keys));
+	num_rounds = 0;
+}
 
-	// Store the data
-	int current_size = databuffer.get_size();
-	int current_capacity = databuffer.get_capacity();
-	int available = current_capacity - current_size;
-	if (available < aes128_block_size_bytes)	// Increase capacity required
+void AES_Impl::encrypt_ecb(const unsigned char *input, unsigned char *output, int num_blocks) const
+{
+#ifdef CL_AES_NI
+	if (use_aesni)
 	{
-		databuffer.set_capacity(current_capacity + 1024);	// Increase in blocks of 1K
+		cl_aesni_encrypt_ecb(round_keys, num_rounds, input, output, num_blocks);
+		return;
 	}
-	databuffer.set_size(current_size + aes128_block_size_bytes);
-	unsigned char *dest_ptr = (unsigned char *) databuffer.get_data();
-	dest_ptr += current_size;
-
-	put_word(s0, dest_ptr);
-	put_word(s1, dest_ptr+4);
-	put_word(s2, dest_ptr+8);
-	put_word(s3, dest_ptr+12);
+#endif
+	encrypt_blocks_bitsliced(input, output, num_blocks);
 }
 
-void AES_Impl::extract_decrypt_key(ubyte32 *key_expanded, int num_rounds)
+void AES_Impl::encrypt_cbc(unsigned char iv[16], const unsigned char *input, unsigned char *output, int num_blocks) const
 {
-	// Invert the order of the round keys
-	for (int start_value = 0, end_value = 4*num_rounds; start_value < end_value; start_value += 4, end_value -= 4)
+#ifdef CL_AES_NI
+	if (use_aesni)
 	{
-		ubyte32 temp;
-		temp = key_expanded[start_value    ]; key_expanded[start_value    ] = key_expanded[end_value    ]; key_expanded[end_value    ] = temp;
-		temp = key_expanded[start_value + 1]; key_expanded[start_value + 1] = key_expanded[end_value + 1]; key_expanded[end_value + 1] = temp;
-		temp = key_expanded[start_value + 2]; key_expanded[start_value + 2] = key_expanded[end_value + 2]; key_expanded[end_value + 2] = temp;
-		temp = key_expanded[start_value + 3]; key_expanded[start_value + 3] = key_expanded[end_value + 3]; key_expanded[end_value + 3] = temp;
+		cl_aesni_encrypt_cbc(round_keys, num_rounds, iv, input, output, num_blocks);
+		return;
 	}
+#endif
 
-	// Apply the inverse MixColumn transform to all round keys but the first and the last
-	ubyte32 *key_expanded_ptr = key_expanded;
-	for (int cnt = 1; cnt < num_rounds; cnt++)
+	// Each block depends on the previous one, so only one of the four bitsliced lanes is used
+	unsigned char block[AES_Bitslice::num_parallel_blocks * 16];
+	memset(block, 0, sizeof(block));
+	for (int i = 0; i < num_blocks; i++)
 	{
-		key_expanded_ptr += 4;
-		key_expanded_ptr[0] =
-			table_d0[sbox_substitution_values[(key_expanded_ptr[0] >> 24)] & 0xff] ^
-			table_d1[sbox_substitution_values[(key_expanded_ptr[0] >> 16) & 0xff] & 0xff] ^
-			table_d2[sbox_substitution_values[(key_expanded_ptr[0] >>  8) & 0xff] & 0xff] ^
-			table_d3[sbox_substitution_values[(key_expanded_ptr[0] ) & 0xff] & 0xff];
-		key_expanded_ptr[1] =
-			table_d0[sbox_substitution_values[(key_expanded_ptr[1] >> 24)] & 0xff] ^
-			table_d1[sbox_substitution_values[(key_expanded_ptr[1] >> 16) & 0xff] & 0xff] ^
-			table_d2[sbox_substitution_values[(key_expanded_ptr[1] >>  8) & 0xff] & 0xff] ^
-			table_d3[sbox_substitution_values[(key_expanded_ptr[1] ) & 0xff] & 0xff];
-		key_expanded_ptr[2] =
-			table_d0[sbox_substitution_values[(key_expanded_ptr[2] >> 24)] & 0xff] ^
-			table_d1[sbox_substitution_values[(key_expanded_ptr[2] >> 16) & 0xff] & 0xff] ^
-			table_d2[sbox_substitution_values[(key_expanded_ptr[2] >>  8) & 0xff] & 0xff] ^
-			table_d3[sbox_substitution_values[(key_expanded_ptr[2] ) & 0xff] & 0xff];
-		key_expanded_ptr[3] =
-			table_d0[sbox_substitution_values[(key_expanded_ptr[3] >> 24)] & 0xff] ^
-			table_d1[sbox_substitution_values[(key_expanded_ptr[3] >> 16) & 0xff] & 0xff] ^
-			table_d2[sbox_substitution_values[(key_expanded_ptr[3] >>  8) & 0xff] & 0xff] ^
-			table_d3[sbox_substitution_values[(key_expanded_ptr[3] ) & 0xff] & 0xff];
+		for (int j = 0; j < 16; j++)
+			block[j] = input[i * 16 + j] ^ iv[j];
+		ubyte64 q[8];
+		AES_Bitslice::load_blocks(block, q);
+		AES_Bitslice::encrypt(num_rounds, bitsliced_keys, q);
+		AES_Bitslice::store_blocks(q, block);
+		memcpy(iv, block, 16);
+		memcpy(output + i * 16, block, 16);
 	}
+	memset(block, 0, sizeof(block));
 }
 
-
-void AES_Impl::create_tables()
+void AES_Impl::decrypt_cbc(unsigned char iv[16], const unsigned char *input, unsigned char *output, int num_blocks) const
 {
-	int power[256];
-    int logarithm[256];
-
-	int cnt, x;
+#ifdef CL_AES_NI
+	if (use_aesni)
+	{
+		cl_aesni_decrypt_cbc(inverse_round_keys, num_rounds, iv, input, output, num_blocks);
+		return;
+	}
+#endif
 
-	// Calculate power and logarithm helper tables over GF(2^8)
-    for (cnt = 0, x = 1; cnt < 256; cnt++)
+	const int batch_blocks = AES_Bitslice::num_parallel_blocks;
+	unsigned char ciphertext[batch_blocks * 16];
+	unsigned char plaintext[batch_blocks * 16];
+	for (int block = 0; block < num_blocks; block += batch_blocks)
 	{
-		power[cnt] = x;
-		logarithm[x] = cnt;
-		x = ( x ^ x_time( x ) ) & 0xff;
+		int count = min(num_blocks - block, batch_blocks);
+		memset(ciphertext, 0, sizeof(ciphertext));
+		memcpy(ciphertext, input + block * 16, count * 16);
+
+		ubyte64 q[8];
+		AES_Bitslice::load_blocks(ciphertext, q);
+		AES_Bitslice::decrypt(num_rounds, bitsliced_keys, q);
+		AES_Bitslice::store_blocks(q, plaintext);
+
+		for (int i = 0; i < count; i++)
+		{
+			const unsigned char *chain = (i == 0) ? iv : ciphertext + (i - 1) * 16;
+			for (int j = 0; j < 16; j++)
+				output[(block + i) * 16 + j] = plaintext[i * 16 + j] ^ chain[j];
+		}
+		memcpy(iv, ciphertext + (count - 1) * 16, 16);
 	}
+	memset(plaintext, 0, sizeof(plaintext));
+}
 
-	// Calculate the rcon table
-	for (cnt=0, x = 1; cnt < 10; cnt++)
+void AES_Impl::process_ctr(unsigned char counter[16], const unsigned char *input, unsigned char *output, int num_blocks, bool increment_low_32_bits) const
+{
+#ifdef CL_AES_NI
+	if (use_aesni)
 	{
-		rcon_values[cnt] = x << 24;
-		x = x_time( x ) & 0xFF;
+		cl_aesni_ctr(round_keys, num_rounds, counter, input, output, num_blocks, increment_low_32_bits);
+		return;
 	}
+#endif
 
-	// Create the SBox's
-	sbox_substitution_values[0] = 0x63636363;
-	sbox_inverse_substitution_values[0x63] = 0;
-	for (cnt = 1; cnt < 256; cnt++)
+	const int batch_blocks = AES_Bitslice::num_parallel_blocks;
+	unsigned char keystream[batch_blocks * 16];
+	for (int block = 0; block < num_blocks; block += batch_blocks)
 	{
-		x = power[255 - logarithm[cnt] ];
-		int y  = x; y = ( (y << 1) | (y >> 7) ) & 0xFF;
-		x ^= y; y = ( (y << 1) | (y >> 7) ) & 0xFF;
-		x ^= y; y = ( (y << 1) | (y >> 7) ) & 0xFF;
-		x ^= y; y = ( (y << 1) | (y >> 7) ) & 0xFF;
-		x ^= y ^ 0x63;
+		int count = min(num_blocks - block, batch_blocks);
+		for (int i = 0; i < batch_blocks; i++)
+		{
+			memcpy(keystream + i * 16, counter, 16);
+			if (i < count)
+			{
+				// Big endian increment of the counter
+				int last_byte = increment_low_32_bits ? 12 : 0;
+				for (int j = 15; j >= last_byte; j--)
+				{
+					if (++counter[j] != 0)
+						break;
+				}
+			}
+		}
+
+		ubyte64 q[8];
+		AES_Bitslice::load_blocks(keystream, q);
+		AES_Bitslice::encrypt(num_rounds, bitsliced_keys, q);
+		AES_Bitslice::store_blocks(q, keystream);
+
+		for (int i = 0; i < count * 16; i++)
+			output[block * 16 + i] = input[block * 16 + i] ^ keystream[i];
+	}
+	memset(keystream, 0, sizeof(keystream));
+}
 
-		x = x & 0xFF;
-		sbox_substitution_values[cnt] = x << 24 | x << 16 | x << 8 | x;
-		sbox_inverse_substitution_values[x] = cnt << 24 | cnt << 16 | cnt << 8 | cnt;
+unsigned char *AES_Impl::append_data(DataBuffer &databuffer, int size)
+{
+	unsigned int current_size = databuffer.get_size();
+	unsigned int new_size = current_size + size;
+	if (new_size > databuffer.get_capacity())
+		databuffer.set_capacity(max(new_size, databuffer.get_capacity() * 2));
+	databuffer.set_size(new_size);
+	return (unsigned char *)databuffer.get_data() + current_size;
+}
 
-	}
+/////////////////////////////////////////////////////////////////////////////
+// AES_Impl Implementation:
 
-	// Create the encrypt tables
-	for (cnt = 0; cnt < 256; cnt++)
+void AES_Impl::encrypt_blocks_bitsliced(const unsigned char *input, unsigned char *output, int num_blocks) const
+{
+	const int batch_blocks = AES_Bitslice::num_parallel_blocks;
+	unsigned char buffer[batch_blocks * 16];
+	for (int block = 0; block < num_blocks; block += batch_blocks)
 	{
-		// Get the sbox value
-		x = sbox_substitution_values[cnt] & 0xFF;
-		int y = x_time( x ) & 0xFF;
-		int z =  ( y ^ x ) & 0xFF;
-
-		table_e0[cnt] = z | x << 8 | x << 16 | y << 24;
-		table_e1[cnt] = x | x << 8 | y << 16 | z << 24;
-		table_e2[cnt] = x | y << 8 | z << 16 | x << 24;
-		table_e3[cnt] = y | z << 8 | x << 16 | x << 24;
-
-		x = sbox_inverse_substitution_values[cnt] & 0xFF;
-		int a =  mul_value(0xe, x, power, logarithm);
-		int b =  mul_value(0x9, x, power, logarithm);
-		int c =  mul_value(0xd, x, power, logarithm);
-		int d =  mul_value(0xb, x, power, logarithm);
-		table_d0[cnt] = d | c << 8 | b << 16 | a << 24;
-		table_d1[cnt] = c | b << 8 | a << 16 | d << 24;
-		table_d2[cnt] = b | a << 8 | d << 16 | c << 24;
-		table_d3[cnt] = a | d << 8 | c << 16 | b << 24;
-
+		int count = min(num_blocks - block, batch_blocks);
+		memset(buffer, 0, sizeof(buffer));
+		memcpy(buffer, input + block * 16, count * 16);
+
+		ubyte64 q[8];
+		AES_Bitslice::load_blocks(buffer, q);
+		AES_Bitslice::encrypt(num_rounds, bitsliced_keys, q);
+		AES_Bitslice::store_blocks(q, buffer);
+		memcpy(output + block * 16, buffer, count * 16);
 	}
-
+	memset(buffer, 0, sizeof(buffer));
 }
 
 }
@@ -29,9 +29,16 @@
 
 #pragma once
 
+#include "API/Core/System/cl_platform.h"
+#include "API/Core/System/databuffer.h"
+
 namespace clan
 {
 
+/// \brief AES block cipher shared by the AES encryption classes
+///
+/// Uses the AES-NI instructions when the CPU supports them, otherwise a constant-time
+/// bitsliced implementation. Neither backend uses key or data dependent table lookups.
 class AES_Impl
 {
 /// \name Construction
@@ -39,8 +46,7 @@ class AES_Impl
 
 public:
 	AES_Impl();
-
-	static void create_tables();
+	~AES_Impl();
 
 /// \}
 /// \name Attributes
@@ -57,76 +63,80 @@ public:
 	static const int aes256_num_rounds_nr = 14;
 
 	static const int aes128_key_length_bytes = aes128_key_length_nk * 4;
-	static const int aes128_nb_mult_nr_plus1 = aes128_block_size_nb * (aes128_num_rounds_nr+1);
 	static const int aes128_block_size_bytes = aes128_block_size_nb * 4;
 	static const int aes192_key_length_bytes = aes192_key_length_nk * 4;
-	static const int aes192_nb_mult_nr_plus1 = aes192_block_size_nb * (aes192_num_rounds_nr+1);
 	static const int aes192_block_size_bytes = aes192_block_size_nb * 4;
 	static const int aes256_key_length_bytes = aes256_key_length_nk * 4;
-	static const int aes256_nb_mult_nr_plus1 = aes256_block_size_nb * (aes256_num_rounds_nr+1);
 	static const int aes256_block_size_bytes = aes256_block_size_nb * 4;
 
-	static ubyte32 sbox_substitution_values[256];
-	static ubyte32 sbox_inverse_substitution_values[256];
-	static ubyte32 rcon_values[10];
-
-	// Combining SubBytes and ShiftRows with MixColumns, and transforming them into a sequence of table lookups
-	static ubyte32 table_e0[256];
-	static ubyte32 table_e1[256];
-	static ubyte32 table_e2[256];
-	static ubyte32 table_e3[256];
-	static ubyte32 table_d0[256];
-	static ubyte32 table_d1[256];
-	static ubyte32 table_d2[256];
-	static ubyte32 table_d3[256];
+	static const int block_size_bytes = 16;
+	static const int max_num_rounds = aes256_num_rounds_nr;
+
+	/// \brief Returns true if the AES-NI instructions are supported by the CPU
+	static bool is_aesni_supported();
+
+	/// \brief Returns true if keys set from now on will use the AES-NI instructions
+	static bool is_aesni_enabled();
+
+	/// \brief Returns true if the CPU supports carry-less multiplication (used by GHASH)
+	static bool is_pclmul_supported();
+
+	/// \brief Returns true if this key schedule uses the AES-NI instructions
+	bool is_using_aesni() const { return use_aesni; }
+
 /// \}
 /// \name Operations
 /// \{
 
 public:
-	void extract_encrypt_key128(const unsigned char key[aes128_key_length_bytes], ubyte32 key_expanded[aes128_nb_mult_nr_plus1]);
-	void extract_encrypt_key192(const unsigned char key[aes192_key_length_bytes], ubyte32 key_expanded[aes192_nb_mult_nr_plus1]);
-	void extract_encrypt_key256(const unsigned char key[aes256_key_length_bytes], ubyte32 key_expanded[aes256_nb_mult_nr_plus1]);
-	void extract_decrypt_key(ubyte32 *key_expanded, int num_rounds);
-	void store_block(ubyte32 s0, ubyte32 s1, ubyte32 s2, ubyte32 s3, DataBuffer &databuffer);
-
-	inline ubyte32 get_word(const unsigned char *data) const
-	{
-		return ( (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | (data[3]) );
-	}
-
-	inline void put_word(ubyte32 source_value, unsigned char *dest_data) const
-	{
-		dest_data[0] = (unsigned char) (source_value >> 24);
-		dest_data[1] = (unsigned char) (source_value >> 16);
-		dest_data[2] = (unsigned char) (source_value >> 8);
-		dest_data[3] = (unsigned char) (source_value);
-	}
-
-	static inline int x_time(int value)
-	{
-		return ( ( value << 1 ) ^ ( ( value & 0x80 ) ? 0x1B : 0x00 ) );
-	}
-
-	static inline int mul_value(int x, int y, const int *power, const int *logarithm)
-	{
-		if ( x && y )
-		{
-			return power[ (logarithm[x] +logarithm[y] ) % 255];
-		}
-		else
-		{
-			return 0;
-		}
-	}
-	
+	/// \brief Enables or disables the AES-NI backend for keys set from now on
+	static void set_aesni_enabled(bool enable);
+
+	/// \brief Expands the cipher key (16, 24 or 32 bytes)
+	void set_cipher_key(const unsigned char *key, int key_length_bytes);
+
+	/// \brief Removes the expanded key from memory
+	void clear_cipher_key();
+
+	/// \brief Encrypts independent blocks
+	void encrypt_ecb(const unsigned char *input, unsigned char *output, int num_blocks) const;
+
+	/// \brief Encrypts blocks in Cipher Block Chaining mode. The iv is updated to the last ciphertext block
+	void encrypt_cbc(unsigned char iv[16], const unsigned char *input, unsigned char *output, int num_blocks) const;
+
+	/// \brief Decrypts blocks in Cipher Block Chaining mode. The iv is updated to the last ciphertext block
+	void decrypt_cbc(unsigned char iv[16], const unsigned char *input, unsigned char *output, int num_blocks) const;
+
+	/// \brief XORs the data with the encrypted counter blocks and advances the big endian counter
+	///
+	/// \param increment_low_32_bits = Only the last 32 bits of the counter are incremented (as required by GCM)
+	void process_ctr(unsigned char counter[16], const unsigned char *input, unsigned char *output, int num_blocks, bool increment_low_32_bits) const;
+
+	/// \brief Grows the databuffer and returns a pointer to the new space
+	///
+	/// The capacity grows geometrically, so appending many small amounts stays linear in time.
+	static unsigned char *append_data(DataBuffer &databuffer, int size);
+
 /// \}
 /// \name Implementation
 /// \{
 
 private:
-	static bool is_tables_created;
+	void encrypt_blocks_bitsliced(const unsigned char *input, unsigned char *output, int num_blocks) const;
+
+	int num_rounds;
+	bool use_aesni;
+
+	/// \brief Round keys in byte order, as used by the AES-NI instructions
+	unsigned char round_keys[(max_num_rounds + 1) * 16];
+
+	/// \brief Equivalent inverse cipher round keys for AESDEC
+	unsigned char inverse_round_keys[(max_num_rounds + 1) * 16];
+
+	/// \brief Round keys for the bitsliced backend
+	ubyte64 bitsliced_keys[(max_num_rounds + 1) * 8];
 
+	static bool aesni_enabled;
 /// \}
 };
 
@@ -0,0 +1,437 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+/*
+**  The CRC-32 folding kernel and its constants in cl_crc32_pclmul follow
+**  crc_folding.c by Intel as included with the Chromium zlib, which is
+**  distributed under the zlib license, the same terms as ClanLib above:
+**
+**  Copyright (C) 2013 Intel Corporation. All rights reserved.
+**  Authors: Wajdi Feghali, Jim Guilford, Vinodh Gopal, Erdinc Ozturk,
+**  Jim Kukunas
+**
+**  The SSSE3 Adler-32 kernel in cl_adler32_ssse3 follows adler32_simd.c
+**  from the Chromium zlib, which is distributed under this license:
+**
+**  Copyright 2017 The Chromium Authors. All rights reserved.
+**
+**  Redistribution and use in source and binary forms, with or without
+**  modification, are permitted provided that the following conditions are
+**  met:
+**
+**     * Redistributions of source code must retain the above copyright
+**  notice, this list of conditions and the following disclaimer.
+**     * Redistributions in binary form must reproduce the above
+**  copyright notice, this list of conditions and the following disclaimer
+**  in the documentation and/or other materials provided with the
+**  distribution.
+**     * Neither the name of Google Inc. nor the names of its
+**  contributors may be used to endorse or promote products derived from
+**  this software without specific prior written permission.
+**
+**  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+**  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+**  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+**  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+**  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+**  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+**  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+**  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+**  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+**  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+**  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Core/precomp.h"
+#include "checksum_impl.h"
+#include "API/Core/System/system.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+	#if defined(_MSC_VER) && _MSC_VER >= 1600
+		#define CL_CHECKSUM_SIMD
+		#define cl_target_pclmul
+		#define cl_target_ssse3
+		#include <wmmintrin.h>
+		#include <tmmintrin.h>
+	#elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+		#define CL_CHECKSUM_SIMD
+		#define cl_target_pclmul __attribute__((target("pclmul,sse2")))
+		#define cl_target_ssse3 __attribute__((target("ssse3")))
+		#include <wmmintrin.h>
+		#include <tmmintrin.h>
+	#endif
+#endif
+
+namespace clan
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// Tables:
+
+namespace
+{
+	const ubyte32 crc32_polynomial = 0xedb88320;
+	const ubyte32 adler32_base = 65521;
+	const size_t adler32_nmax = 5552; // Largest n such that 255n(n+1)/2 + (n+1)(base-1) fits in 32 bits
+
+	/// \brief Slice-by-16 tables. Table 0 is the classic byte-at-a-time table.
+	class CRC32Tables
+	{
+	public:
+		CRC32Tables()
+		{
+			for (ubyte32 i = 0; i < 256; i++)
+			{
+				ubyte32 crc = i;
+				for (int j = 0; j < 8; j++)
+					crc = (crc & 1) ? (crc >> 1) ^ crc32_polynomial : crc >> 1;
+				table[0][i] = crc;
+			}
+
+			for (ubyte32 i = 0; i < 256; i++)
+			{
+				for (int slice = 1; slice < 16; slice++)
+					table[slice][i] = (table[slice - 1][i] >> 8) ^ table[0][table[slice - 1][i] & 0xff];
+			}
+		}
+
+		ubyte32 table[16][256];
+	};
+
+	const CRC32Tables crc32_tables;
+
+	inline ubyte32 load_le32(const unsigned char *data)
+	{
+		return data[0] | (data[1] << 8) | (data[2] << 16) | ((ubyte32) data[3] << 24);
+	}
+}
+
+#ifdef CL_CHECKSUM_SIMD
+
+/////////////////////////////////////////////////////////////////////////////
+// SIMD kernels:
+
+// CRC-32 by folding 4x128 bits at a time with carry-less multiplication, followed by a Barrett
+// reduction. Constants are for the bit-reflected gzip polynomial, see Intel's "Fast CRC Computation
+// for Generic Polynomials Using PCLMULQDQ Instruction". Size must be at least 64 and a multiple of 16.
+cl_target_pclmul static ubyte32 cl_crc32_pclmul(ubyte32 crc, const unsigned char *data, size_t size)
+{
+	const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+	const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+	const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+	const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+	const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+	__m128i x1 = _mm_loadu_si128((const __m128i *) (data + 0x00));
+	__m128i x2 = _mm_loadu_si128((const __m128i *) (data + 0x10));
+	__m128i x3 = _mm_loadu_si128((const __m128i *) (data + 0x20));
+	__m128i x4 = _mm_loadu_si128((const __m128i *) (data + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+	data += 64;
+	size -= 64;
+
+	// Fold 64 bytes at a time:
+	while (size >= 64)
+	{
+		__m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+		__m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+		__m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+		__m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *) (data + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *) (data + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *) (data + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *) (data + 0x30)));
+		data += 64;
+		size -= 64;
+	}
+
+	// Fold the four lanes into one:
+	__m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x4), x5);
+
+	// Fold 16 bytes at a time:
+	while (size >= 16)
+	{
+		x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+		x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_loadu_si128((const __m128i *) data)), x5);
+		data += 16;
+		size -= 16;
+	}
+
+	// Fold 128 bits to 64 bits:
+	x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, mask32);
+	x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k5k0, 0x00), x2);
+
+	// Barrett reduction to 32 bits:
+	x2 = _mm_and_si128(x1, mask32);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+	x2 = _mm_and_si128(x2, mask32);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+	return _mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+
+// Adler-32 over 32 byte blocks. s1 is summed with psadbw and s2 with pmaddubsw against the
+// descending byte weights, reducing modulo the base every nmax bytes.
+cl_target_ssse3 static ubyte32 cl_adler32_ssse3(ubyte32 adler, const unsigned char *data, size_t num_blocks)
+{
+	const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17);
+	const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi16(1);
+
+	ubyte32 s1 = adler & 0xffff;
+	ubyte32 s2 = adler >> 16;
+	while (num_blocks > 0)
+	{
+		size_t n = adler32_nmax / 32;
+		if (n > num_blocks)
+			n = num_blocks;
+		num_blocks -= n;
+
+		__m128i v_ps = _mm_set_epi32(0, 0, 0, s1 * (ubyte32) n);
+		__m128i v_s2 = _mm_set_epi32(0, 0, 0, s2);
+		__m128i v_s1 = _mm_setzero_si128();
+		do
+		{
+			__m128i bytes1 = _mm_loadu_si128((const __m128i *) data);
+			__m128i bytes2 = _mm_loadu_si128((const __m128i *) (data + 16));
+
+			// Every byte of the previous blocks is counted 32 more times in s2:
+			v_ps = _mm_add_epi32(v_ps, v_s1);
+
+			v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes1, zero));
+			v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes1, tap1), ones));
+			v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes2, zero));
+			v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes2, tap2), ones));
+			data += 32;
+		} while (--n);
+
+		v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+
+		v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, _MM_SHUFFLE(1, 0, 3, 2)));
+		s1 += _mm_cvtsi128_si32(v_s1);
+		v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(2, 3, 0, 1)));
+		v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(1, 0, 3, 2)));
+		s2 = _mm_cvtsi128_si32(v_s2);
+
+		s1 %= adler32_base;
+		s2 %= adler32_base;
+	}
+	return s1 | (s2 << 16);
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+// Checksum_Impl Attributes:
+
+bool Checksum_Impl::simd_enabled = true;
+
+bool Checksum_Impl::is_pclmul_supported()
+{
+#ifdef CL_CHECKSUM_SIMD
+	static bool supported = System::detect_cpu_extension(System::pclmulqdq) && System::detect_cpu_extension(System::sse2);
+	return supported;
+#else
+	return false;
+#endif
+}
+
+bool Checksum_Impl::is_ssse3_supported()
+{
+#ifdef CL_CHECKSUM_SIMD
+	static bool supported = System::detect_cpu_extension(System::ssse3);
+	return supported;
+#else
+	return false;
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Checksum_Impl Operations:
+
+ubyte32 Checksum_Impl::crc32_update(ubyte32 crc, const void *data, size_t size)
+{
+	const unsigned char *d = (const unsigned char *) data;
+#ifdef CL_CHECKSUM_SIMD
+	if (size >= 64 && simd_enabled && is_pclmul_supported())
+	{
+		size_t folded_size = size & ~(size_t) 15;
+		crc = cl_crc32_pclmul(crc, d, folded_size);
+		d += folded_size;
+		size -= folded_size;
+	}
+#endif
+	return crc32_slice_by_16(crc, d, size);
+}
+
+ubyte32 Checksum_Impl::crc32_combine(ubyte32 crc1, ubyte32 crc2, ubyte64 size2)
+{
+	// Multiply crc1 by x^(8*size2) modulo the polynomial, using repeated squares of x^8
+	ubyte32 power = 1u << 23; // x^8
+	ubyte32 product = 1u << 31; // x^0
+	while (size2 != 0)
+	{
+		if (size2 & 1)
+			product = multiply_mod_polynomial(power, product);
+		power = multiply_mod_polynomial(power, power);
+		size2 >>= 1;
+	}
+	return multiply_mod_polynomial(product, crc1) ^ crc2;
+}
+
+ubyte32 Checksum_Impl::adler32_update(ubyte32 adler, const void *data, size_t size)
+{
+	const unsigned char *d = (const unsigned char *) data;
+#ifdef CL_CHECKSUM_SIMD
+	if (size >= 64 && simd_enabled && is_ssse3_supported())
+	{
+		size_t num_blocks = size / 32;
+		adler = cl_adler32_ssse3(adler, d, num_blocks);
+		d += num_blocks * 32;
+		size -= num_blocks * 32;
+	}
+#endif
+	return adler32_scalar(adler, d, size);
+}
+
+ubyte32 Checksum_Impl::adler32_combine(ubyte32 adler1, ubyte32 adler2, ubyte64 size2)
+{
+	ubyte32 remainder = (ubyte32) (size2 % adler32_base);
+	ubyte32 sum1 = adler1 & 0xffff;
+	ubyte32 sum2 = (remainder * sum1) % adler32_base;
+	sum1 += (adler2 & 0xffff) + adler32_base - 1;
+	sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + adler32_base - remainder;
+	if (sum1 >= adler32_base) sum1 -= adler32_base;
+	if (sum1 >= adler32_base) sum1 -= adler32_base;
+	if (sum2 >= (adler32_base << 1)) sum2 -= (adler32_base << 1);
+	if (sum2 >= adler32_base) sum2 -= adler32_base;
+	return sum1 | (sum2 << 16);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Checksum_Impl Implementation:
+
+ubyte32 Checksum_Impl::crc32_slice_by_16(ubyte32 crc, const unsigned char *data, size_t size)
+{
+	const ubyte32 (*table)[256] = crc32_tables.table;
+
+	while (size >= 16)
+	{
+		ubyte32 word0 = load_le32(data) ^ crc;
+		ubyte32 word1 = load_le32(data + 4);
+		ubyte32 word2 = load_le32(data + 8);
+		ubyte32 word3 = load_le32(data + 12);
+		crc =
+			table[15][word0 & 0xff] ^ table[14][(word0 >> 8) & 0xff] ^ table[13][(word0 >> 16) & 0xff] ^ table[12][word0 >> 24] ^
+			table[11][word1 & 0xff] ^ table[10][(word1 >> 8) & 0xff] ^ table[9][(word1 >> 16) & 0xff] ^ table[8][word1 >> 24] ^
+			table[7][word2 & 0xff] ^ table[6][(word2 >> 8) & 0xff] ^ table[5][(word2 >> 16) & 0xff] ^ table[4][word2 >> 24] ^
+			table[3][word3 & 0xff] ^ table[2][(word3 >> 8) & 0xff] ^ table[1][(word3 >> 16) & 0xff] ^ table[0][word3 >> 24];
+		data += 16;
+		size -= 16;
+	}
+
+	if (size >= 8)
+	{
+		ubyte32 word0 = load_le32(data) ^ crc;
+		ubyte32 word1 = load_le32(data + 4);
+		crc =
+			table[7][word0 & 0xff] ^ table[6][(word0 >> 8) & 0xff] ^ table[5][(word0 >> 16) & 0xff] ^ table[4][word0 >> 24] ^
+			table[3][word1 & 0xff] ^ table[2][(word1 >> 8) & 0xff] ^ table[1][(word1 >> 16) & 0xff] ^ table[0][word1 >> 24];
+		data += 8;
+		size -= 8;
+	}
+
+	while (size > 0)
+	{
+		crc = (crc >> 8) ^ table[0][(crc ^ *data) & 0xff];
+		data++;
+		size--;
+	}
+	return crc;
+}
+
+ubyte32 Checksum_Impl::adler32_scalar(ubyte32 adler, const unsigned char *data, size_t size)
+{
+	ubyte32 s1 = adler & 0xffff;
+	ubyte32 s2 = adler >> 16;
+	while (size > 0)
+	{
+		size_t block_size = size < adler32_nmax ? size : adler32_nmax;
+		size -= block_size;
+		while (block_size >= 8)
+		{
+			s1 += data[0]; s2 += s1;
+			s1 += data[1]; s2 += s1;
+			s1 += data[2]; s2 += s1;
+			s1 += data[3]; s2 += s1;
+			s1 += data[4]; s2 += s1;
+			s1 += data[5]; s2 += s1;
+			s1 += data[6]; s2 += s1;
+			s1 += data[7]; s2 += s1;
+			data += 8;
+			block_size -= 8;
+		}
+		while (block_size > 0)
+		{
+			s1 += *(data++);
+			s2 += s1;
+			block_size--;
+		}
+		s1 %= adler32_base;
+		s2 %= adler32_base;
+	}
+	return s1 | (s2 << 16);
+}
+
+ubyte32 Checksum_Impl::multiply_mod_polynomial(ubyte32 a, ubyte32 b)
+{
+	// Bit-reflected multiplication modulo the CRC-32 polynomial. Bit 31 is x^0.
+	ubyte32 product = 0;
+	for (ubyte32 bit = 1u << 31; bit != 0; bit >>= 1)
+	{
+		if (a & bit)
+			product ^= b;
+		b = (b & 1) ? (b >> 1) ^ crc32_polynomial : b >> 1;
+	}
+	return product;
+}
+
+}
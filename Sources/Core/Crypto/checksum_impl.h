@@ -0,0 +1,83 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "API/Core/System/cl_platform.h"
+
+namespace clan
+{
+
+/// \brief CRC-32 and Adler-32 checksums shared by HashFunctions, the zip classes and zlib compression
+///
+/// CRC-32 uses PCLMULQDQ folding when available, otherwise slice-by-16 and slice-by-8 tables.
+/// Adler-32 uses SSSE3 when available.
+class Checksum_Impl
+{
+/// \name Attributes
+/// \{
+
+public:
+	static bool is_pclmul_supported();
+
+	static bool is_ssse3_supported();
+
+	/// \brief Enables or disables the SIMD code paths (used for testing the table based paths)
+	static void set_simd_enabled(bool enable) { simd_enabled = enable; }
+
+/// \}
+/// \name Operations
+/// \{
+
+public:
+	/// \brief Updates a CRC-32 register. The register is not inverted at the start or end.
+	static ubyte32 crc32_update(ubyte32 crc, const void *data, size_t size);
+
+	/// \brief Returns the CRC-32 of two concatenated blocks, given the CRC-32 of each block.
+	static ubyte32 crc32_combine(ubyte32 crc1, ubyte32 crc2, ubyte64 size2);
+
+	/// \brief Updates an Adler-32 checksum. Start with 1.
+	static ubyte32 adler32_update(ubyte32 adler, const void *data, size_t size);
+
+	/// \brief Returns the Adler-32 of two concatenated blocks, given the Adler-32 of each block.
+	static ubyte32 adler32_combine(ubyte32 adler1, ubyte32 adler2, ubyte64 size2);
+
+/// \}
+/// \name Implementation
+/// \{
+
+private:
+	static ubyte32 crc32_slice_by_16(ubyte32 crc, const unsigned char *data, size_t size);
+	static ubyte32 adler32_scalar(ubyte32 adler, const unsigned char *data, size_t size);
+	static ubyte32 multiply_mod_polynomial(ubyte32 a, ubyte32 b);
+
+	static bool simd_enabled;
+/// \}
+};
+
+}
@@ -31,7 +31,8 @@
 #include "Core/precomp.h"
 #include "API/Core/Crypto/hash_functions.h"
 #include "API/Core/System/databuffer.h"
-#include "Core/Zip/miniz.h"
+#include "checksum_impl.h"
+#include "sha_batch.h"
 
 namespace clan
 {
@@ -47,20 +48,26 @@ namespace clan
 
 ubyte32 HashFunctions::crc32( const void *data, int size, ubyte32 running_crc/*=0*/ )
 {
-	ubyte32 crc = running_crc;
-	if (crc == 0)
-		crc = mz_crc32(0L, 0, 0);
+	return ~Checksum_Impl::crc32_update(~running_crc, data, size);
+}
 
-	return mz_crc32(running_crc, (const unsigned char*)data, size);;
+ubyte32 HashFunctions::crc32_combine(ubyte32 crc1, ubyte32 crc2, ubyte64 size2)
+{
+	return Checksum_Impl::crc32_combine(crc1, crc2, size2);
 }
 
 ubyte32 HashFunctions::adler32( const void *data, int size, ubyte32 running_adler32/*=0*/ )
 {
 	ubyte32 adler = running_adler32;
 	if (adler == 0)
-		adler = mz_adler32(0L, 0, 0);
+		adler = 1;
+
+	return Checksum_Impl::adler32_update(adler, data, size);
+}
 
-	return mz_adler32(adler, (const unsigned char*)data, size);
+ubyte32 HashFunctions::adler32_combine(ubyte32 adler1, ubyte32 adler2, ubyte64 size2)
+{
+	return Checksum_Impl::adler32_combine(adler1, adler2, size2);
 }
 
 std::string HashFunctions::md5(const void *data, int size, bool uppercase)
@@ -136,6 +143,16 @@ void HashFunctions::sha1(const std::string &data, unsigned char out_hash[20])
 	sha1(data.data(), data.length(), out_hash);
 }
 
+void HashFunctions::sha1_batch(const DataBuffer *data, int num_buffers, unsigned char *out_hashes)
+{
+	SHA_Batch::sha1(data, num_buffers, out_hashes);
+}
+
+void HashFunctions::sha1_batch(const DataBuffer *data, int num_buffers, unsigned char *out_hashes, WorkQueue &work_queue)
+{
+	SHA_Batch::run(&SHA_Batch::sha1, 20, data, num_buffers, out_hashes, work_queue);
+}
+
 std::string HashFunctions::sha224(const void *data, int size, bool uppercase)
 {
 	SHA224 sha224;
@@ -208,6 +225,16 @@ void HashFunctions::sha256(const std::string &data, unsigned char out_hash[32])
 	sha256(data.data(), data.length(), out_hash);
 }
 
+void HashFunctions::sha256_batch(const DataBuffer *data, int num_buffers, unsigned char *out_hashes)
+{
+	SHA_Batch::sha256(data, num_buffers, out_hashes);
+}
+
+void HashFunctions::sha256_batch(const DataBuffer *data, int num_buffers, unsigned char *out_hashes, WorkQueue &work_queue)
+{
+	SHA_Batch::run(&SHA_Batch::sha256, 32, data, num_buffers, out_hashes, work_queue);
+}
+
 
 std::string HashFunctions::sha384(const void *data, int size, bool uppercase)
 {
@@ -281,6 +308,16 @@ void HashFunctions::sha512(const std::string &data, unsigned char out_hash[64])
 	sha512(data.data(), data.length(), out_hash);
 }
 
+void HashFunctions::sha512_batch(const DataBuffer *data, int num_buffers, unsigned char *out_hashes)
+{
+	SHA_Batch::sha512(data, num_buffers, out_hashes);
+}
+
+void HashFunctions::sha512_batch(const DataBuffer *data, int num_buffers, unsigned char *out_hashes, WorkQueue &work_queue)
+{
+	SHA_Batch::run(&SHA_Batch::sha512, 64, data, num_buffers, out_hashes, work_queue);
+}
+
 std::string HashFunctions::sha512_224(const void *data, int size, bool uppercase)
 {
 	SHA512_224 sha512_224;
@@ -28,6 +28,7 @@
 
 #include "Core/precomp.h"
 #include "sha1_impl.h"
+#include "sha_simd.h"
 
 #include "../../API/Core/Math/cl_math.h"
 #include "../../API/Core/Crypto/sha1.h"
@@ -121,15 +122,25 @@ void SHA1_Impl::add(const void *_data, int size)
 	while (pos < size)
 	{
 		int data_left = size - pos;
-		int buffer_space = block_size - chunk_filled;
-		int data_used = min(buffer_space, data_left);
-		memcpy(chunk + chunk_filled, data + pos, data_used);
-		chunk_filled += data_used;
-		pos += data_used;
-		if (chunk_filled == block_size)
+		if (chunk_filled == 0 && data_left >= block_size)
 		{
-			process_chunk();
-			chunk_filled = 0;
+			// Hash whole blocks directly from the input data
+			int num_blocks = data_left / block_size;
+			process_blocks(data + pos, num_blocks);
+			pos += num_blocks * block_size;
+		}
+		else
+		{
+			int buffer_space = block_size - chunk_filled;
+			int data_used = min(buffer_space, data_left);
+			memcpy(chunk + chunk_filled, data + pos, data_used);
+			chunk_filled += data_used;
+			pos += data_used;
+			if (chunk_filled == block_size)
+			{
+				process_blocks(chunk, 1);
+				chunk_filled = 0;
+			}
 		}
 	}
 	length_message += size * (ubyte64) 8;
@@ -221,17 +232,36 @@ void SHA1_Impl::calculate()
 /////////////////////////////////////////////////////////////////////////////
 // SHA1_Impl Implementation:
 
-void SHA1_Impl::process_chunk()
+void SHA1_Impl::process_blocks(const unsigned char *data, int num_blocks)
+{
+	if (SHA_SIMD::is_sha_enabled())
+	{
+		ubyte32 state[5] = { h0, h1, h2, h3, h4 };
+		SHA_SIMD::sha1_process_blocks(state, data, num_blocks);
+		h0 = state[0];
+		h1 = state[1];
+		h2 = state[2];
+		h3 = state[3];
+		h4 = state[4];
+	}
+	else
+	{
+		for (int cnt = 0; cnt < num_blocks; cnt++)
+			process_block(data + cnt * block_size);
+	}
+}
+
+void SHA1_Impl::process_block(const unsigned char *block)
 {
 	int i;
 	unsigned int w[80];
 
 	for (i = 0; i < 16; i++)
 	{
-		unsigned int b1 = chunk[i*4];
-		unsigned int b2 = chunk[i*4+1];
-		unsigned int b3 = chunk[i*4+2];
-		unsigned int b4 = chunk[i*4+3];
+		unsigned int b1 = block[i*4];
+		unsigned int b2 = block[i*4+1];
+		unsigned int b3 = block[i*4+2];
+		unsigned int b4 = block[i*4+3];
 		w[i] = (b1 << 24) + (b2 << 16) + (b3 << 8) + b4;
 	}
 	
@@ -244,31 +274,39 @@ void SHA1_Impl::process_chunk()
 	ubyte32 d = h3;
 	ubyte32 e = h4;
 	
-	for (i = 0; i < 80; i++)
+	for (i = 0; i < 20; i++)
 	{
-		ubyte32 f, k;
-		if (i < 20)
-		{
-			f = (b & c) | ((~b) & d);
-			k = 0x5A827999;
-		}
-		else if (i < 40)
-		{
-			f = b ^ c ^ d;
-			k = 0x6ED9EBA1;
-		}
-		else if (i < 60)
-		{
-			f = (b & c) | (b & d) | (c & d);
-			k = 0x8F1BBCDC;
-		}
-		else
-		{
-			f =  b ^ c ^ d;
-			k = 0xCA62C1D6;
-		}
-		
-		ubyte32 temp = leftrotate_uint32(a, 5) + f + e + k + w[i];
+		ubyte32 temp = leftrotate_uint32(a, 5) + ((b & c) | ((~b) & d)) + e + 0x5A827999 + w[i];
+		e = d;
+		d = c;
+		c = leftrotate_uint32(b, 30);
+		b = a;
+		a = temp;
+	}
+
+	for (; i < 40; i++)
+	{
+		ubyte32 temp = leftrotate_uint32(a, 5) + (b ^ c ^ d) + e + 0x6ED9EBA1 + w[i];
+		e = d;
+		d = c;
+		c = leftrotate_uint32(b, 30);
+		b = a;
+		a = temp;
+	}
+
+	for (; i < 60; i++)
+	{
+		ubyte32 temp = leftrotate_uint32(a, 5) + ((b & c) | (b & d) | (c & d)) + e + 0x8F1BBCDC + w[i];
+		e = d;
+		d = c;
+		c = leftrotate_uint32(b, 30);
+		b = a;
+		a = temp;
+	}
+
+	for (; i < 80; i++)
+	{
+		ubyte32 temp = leftrotate_uint32(a, 5) + (b ^ c ^ d) + e + 0xCA62C1D6 + w[i];
 		e = d;
 		d = c;
 		c = leftrotate_uint32(b, 30);
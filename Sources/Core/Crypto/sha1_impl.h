@@ -71,7 +71,8 @@ public:
 /// \{
 
 private:
-	void process_chunk();
+	void process_blocks(const unsigned char *data, int num_blocks);
+	void process_block(const unsigned char *block);
 
 	inline unsigned int leftrotate_uint32(unsigned int value, int shift) const
 	{
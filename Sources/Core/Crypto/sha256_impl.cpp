@@ -29,6 +29,7 @@
 
 #include "Core/precomp.h"
 #include "sha256_impl.h"
+#include "sha_simd.h"
 
 #include "../../API/Core/Math/cl_math.h"
 #include "../../API/Core/Crypto/sha224.h"
@@ -172,15 +173,25 @@ void SHA256_Impl::add(const void *_data, int size)
 	while (pos < size)
 	{
 		int data_left = size - pos;
-		int buffer_space = block_size - chunk_filled;
-		int data_used = min(buffer_space, data_left);
-		memcpy(chunk + chunk_filled, data + pos, data_used);
-		chunk_filled += data_used;
-		pos += data_used;
-		if (chunk_filled == block_size)
+		if (chunk_filled == 0 && data_left >= block_size)
 		{
-			process_chunk();
-			chunk_filled = 0;
+			// Hash whole blocks directly from the input data
+			int num_blocks = data_left / block_size;
+			process_blocks(data + pos, num_blocks);
+			pos += num_blocks * block_size;
+		}
+		else
+		{
+			int buffer_space = block_size - chunk_filled;
+			int data_used = min(buffer_space, data_left);
+			memcpy(chunk + chunk_filled, data + pos, data_used);
+			chunk_filled += data_used;
+			pos += data_used;
+			if (chunk_filled == block_size)
+			{
+				process_blocks(chunk, 1);
+				chunk_filled = 0;
+			}
 		}
 	}
 	length_message += size * (ubyte64) 8;
@@ -301,7 +312,29 @@ void SHA256_Impl::calculate()
 /////////////////////////////////////////////////////////////////////////////
 // SHA256_Impl Implementation:
 
-void SHA256_Impl::process_chunk()
+void SHA256_Impl::process_blocks(const unsigned char *data, int num_blocks)
+{
+	if (SHA_SIMD::is_sha_enabled())
+	{
+		ubyte32 state[8] = { h0, h1, h2, h3, h4, h5, h6, h7 };
+		SHA_SIMD::sha256_process_blocks(state, data, num_blocks);
+		h0 = state[0];
+		h1 = state[1];
+		h2 = state[2];
+		h3 = state[3];
+		h4 = state[4];
+		h5 = state[5];
+		h6 = state[6];
+		h7 = state[7];
+	}
+	else
+	{
+		for (int cnt = 0; cnt < num_blocks; cnt++)
+			process_block(data + cnt * block_size);
+	}
+}
+
+void SHA256_Impl::process_block(const unsigned char *block)
 {
 	// Constants defined in FIPS 180-3, section 4.2.2
 	static const ubyte32 constant_K[64] = {
@@ -325,10 +358,10 @@ void SHA256_Impl::process_chunk()
 
 	for (i = 0; i < 16; i++)
 	{
-		unsigned int b1 = chunk[i*4];
-		unsigned int b2 = chunk[i*4+1];
-		unsigned int b3 = chunk[i*4+2];
-		unsigned int b4 = chunk[i*4+3];
+		unsigned int b1 = block[i*4];
+		unsigned int b2 = block[i*4+1];
+		unsigned int b3 = block[i*4+2];
+		unsigned int b4 = block[i*4+3];
 		w[i] = (b1 << 24) + (b2 << 16) + (b3 << 8) + b4;
 	}
 	
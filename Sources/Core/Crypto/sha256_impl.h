@@ -101,7 +101,8 @@ private:
 		return  (((x) & ((y) | (z))) | ((y) & (z)));
 	}
 
-	void process_chunk();
+	void process_blocks(const unsigned char *data, int num_blocks);
+	void process_block(const unsigned char *block);
 
 	ubyte32 h0, h1, h2, h3, h4, h5, h6, h7;
 
@@ -259,15 +259,26 @@ void SHA512_Impl::add(const void *_data, int size)
 	while (pos < size)
 	{
 		int data_left = size - pos;
-		int buffer_space = block_size - chunk_filled;
-		int data_used = min(buffer_space, data_left);
-		memcpy(chunk + chunk_filled, data + pos, data_used);
-		chunk_filled += data_used;
-		pos += data_used;
-		if (chunk_filled == block_size)
+		if (chunk_filled == 0 && data_left >= block_size)
 		{
-			process_chunk();
-			chunk_filled = 0;
+			// Hash whole blocks directly from the input data
+			int num_blocks = data_left / block_size;
+			for (int cnt = 0; cnt < num_blocks; cnt++)
+				process_block(data + pos + cnt * block_size);
+			pos += num_blocks * block_size;
+		}
+		else
+		{
+			int buffer_space = block_size - chunk_filled;
+			int data_used = min(buffer_space, data_left);
+			memcpy(chunk + chunk_filled, data + pos, data_used);
+			chunk_filled += data_used;
+			pos += data_used;
+			if (chunk_filled == block_size)
+			{
+				process_block(chunk);
+				chunk_filled = 0;
+			}
 		}
 	}
 	length_message = length_message + (size * (ubyte64) 8);
@@ -421,7 +432,7 @@ void SHA512_Impl::calculate()
 /////////////////////////////////////////////////////////////////////////////
 // SHA512_Impl Implementation:
 
-void SHA512_Impl::process_chunk()
+void SHA512_Impl::process_block(const unsigned char *block)
 {
 	// Constants defined in FIPS 180-3, section 4.2.3
 	static const ubyte64 constant_K[80] = {
@@ -460,14 +471,14 @@ void SHA512_Impl::process_chunk()
 
 	for (i = 0; i < 16; i++)
 	{
-		ubyte64 b1 = chunk[i*8];
-		ubyte64 b2 = chunk[i*8+1];
-		ubyte64 b3 = chunk[i*8+2];
-		ubyte64 b4 = chunk[i*8+3];
-		ubyte64 b5 = chunk[i*8+4];
-		ubyte64 b6 = chunk[i*8+5];
-		ubyte64 b7 = chunk[i*8+6];
-		ubyte64 b8 = chunk[i*8+7];
+		ubyte64 b1 = block[i*8];
+		ubyte64 b2 = block[i*8+1];
+		ubyte64 b3 = block[i*8+2];
+		ubyte64 b4 = block[i*8+3];
+		ubyte64 b5 = block[i*8+4];
+		ubyte64 b6 = block[i*8+5];
+		ubyte64 b7 = block[i*8+6];
+		ubyte64 b8 = block[i*8+7];
 		w[i] = (b1 << 56) + (b2 << 48) + (b3 << 40) + (b4 << 32) + (b5 << 24) + (b6 << 16) + (b7 << 8) + b8;
 	}
 	
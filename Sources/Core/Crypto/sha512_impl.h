@@ -102,7 +102,7 @@ private:
 		return  (((x) & ((y) | (z))) | ((y) & (z)));
 	}
 
-	void process_chunk();
+	void process_block(const unsigned char *block);
 
 	ubyte64 h0, h1, h2, h3, h4, h5, h6, h7;
 
@@ -0,0 +1,304 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Core/precomp.h"
+#include "sha_batch.h"
+#include "sha_simd.h"
+#include "sha1_impl.h"
+#include "sha256_impl.h"
+#include "sha512_impl.h"
+#include "API/Core/System/databuffer.h"
+#include "API/Core/System/work_queue.h"
+#include "API/Core/System/event.h"
+#include "API/Core/System/interlocked_variable.h"
+#include "API/Core/Math/cl_math.h"
+
+#ifndef WIN32
+#include <cstring>
+#endif
+
+namespace clan
+{
+
+/// \brief Shared state of a batch spread over a work queue
+class SHA_BatchGroups
+{
+public:
+	SHA_BatchGroups(int num_groups) : failed(false)
+	{
+		groups_remaining.set(num_groups);
+	}
+
+	InterlockedVariable groups_remaining;
+	Event done_event;
+	bool failed;
+};
+
+class SHA_BatchWorkItem : public WorkItem
+{
+public:
+	SHA_BatchWorkItem(const std::shared_ptr<SHA_BatchGroups> &groups, SHA_Batch::BatchFunction func, const DataBuffer *data, int num_buffers, unsigned char *out_hashes)
+	: groups(groups), func(func), data(data), num_buffers(num_buffers), out_hashes(out_hashes)
+	{
+	}
+
+	void process_work()
+	{
+		try
+		{
+			func(data, num_buffers, out_hashes);
+		}
+		catch (...)
+		{
+			groups->failed = true;
+		}
+
+		if (groups->groups_remaining.decrement() == 0)
+			groups->done_event.set();
+	}
+
+private:
+	std::shared_ptr<SHA_BatchGroups> groups;
+	SHA_Batch::BatchFunction func;
+	const DataBuffer *data;
+	int num_buffers;
+	unsigned char *out_hashes;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// SHA_Batch Operations:
+
+void SHA_Batch::sha1(const DataBuffer *data, int num_buffers, unsigned char *out_hashes)
+{
+	SHA1_Impl sha1;
+	for (int i = 0; i < num_buffers; i++)
+	{
+		sha1.reset();
+		sha1.add(data[i].get_data(), data[i].get_size());
+		sha1.calculate();
+		sha1.get_hash(out_hashes + i * 20);
+	}
+}
+
+void SHA_Batch::sha256(const DataBuffer *data, int num_buffers, unsigned char *out_hashes)
+{
+	if (!SHA_SIMD::is_sha_enabled() && SHA_SIMD::is_avx2_enabled())
+	{
+		sha256_multi_buffer(data, num_buffers, out_hashes);
+	}
+	else
+	{
+		SHA256_Impl sha256(cl_sha_256);
+		for (int i = 0; i < num_buffers; i++)
+		{
+			sha256.reset();
+			sha256.add(data[i].get_data(), data[i].get_size());
+			sha256.calculate();
+			sha256.get_hash(out_hashes + i * 32);
+		}
+	}
+}
+
+void SHA_Batch::sha512(const DataBuffer *data, int num_buffers, unsigned char *out_hashes)
+{
+	SHA512_Impl sha512(cl_sha_512);
+	for (int i = 0; i < num_buffers; i++)
+	{
+		sha512.reset();
+		sha512.add(data[i].get_data(), data[i].get_size());
+		sha512.calculate();
+		sha512.get_hash(out_hashes + i * 64);
+	}
+}
+
+void SHA_Batch::run(BatchFunction func, int hash_size, const DataBuffer *data, int num_buffers, unsigned char *out_hashes, WorkQueue &work_queue)
+{
+	if (num_buffers <= 0)
+		return;
+
+	ubyte64 total_size = 0;
+	for (int i = 0; i < num_buffers; i++)
+		total_size += data[i].get_size() + 64;
+
+	// A few groups per thread, so threads finishing early can steal work from the others
+	int num_threads = max(work_queue.get_num_threads(), 1);
+	ubyte64 group_size = total_size / (num_threads * 4) + 1;
+
+	std::vector<int> group_starts;
+	ubyte64 size = 0;
+	for (int i = 0; i < num_buffers; i++)
+	{
+		if (size == 0)
+			group_starts.push_back(i);
+		size += data[i].get_size() + 64;
+		if (size >= group_size)
+			size = 0;
+	}
+	group_starts.push_back(num_buffers);
+
+	int num_groups = group_starts.size() - 1;
+	std::shared_ptr<SHA_BatchGroups> groups(new SHA_BatchGroups(num_groups));
+	std::vector<WorkItem *> items;
+	items.reserve(num_groups);
+	for (int i = 0; i < num_groups; i++)
+	{
+		int start = group_starts[i];
+		items.push_back(new SHA_BatchWorkItem(groups, func, data + start, group_starts[i + 1] - start, out_hashes + start * hash_size));
+	}
+	work_queue.queue_batch(items);
+	groups->done_event.wait();
+
+	if (groups->failed)
+		throw Exception("SHA batch hashing failed");
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// SHA_Batch Implementation:
+
+void SHA_Batch::sha256_multi_buffer(const DataBuffer *data, int num_buffers, unsigned char *out_hashes)
+{
+	static const ubyte32 initial_state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+	const int num_lanes = SHA_SIMD::num_lanes;
+
+	struct Lane
+	{
+		int buffer;
+		const unsigned char *data;
+		int blocks_left;
+		bool tail_pending;
+		int tail_blocks;
+		unsigned char tail[128];
+	};
+
+	Lane lanes[num_lanes];
+	ubyte32 states[8 * num_lanes];
+	const unsigned char *lane_data[num_lanes];
+	int next_buffer = 0;
+	int lanes_active = 0;
+
+	for (int lane = 0; lane < num_lanes; lane++)
+		lanes[lane].buffer = -1;
+
+	while (true)
+	{
+		// Start the next message in idle lanes
+		for (int lane = 0; lane < num_lanes; lane++)
+		{
+			Lane &l = lanes[lane];
+			if (l.buffer != -1 || next_buffer == num_buffers)
+				continue;
+
+			l.buffer = next_buffer++;
+			const unsigned char *message = (const unsigned char *) data[l.buffer].get_data();
+			int size = data[l.buffer].get_size();
+			int full_blocks = size / 64;
+			int remaining = size % 64;
+
+			// Padding: a single "1" bit, zeros and the message length in bits as a 64-bit big-endian integer
+			l.tail_blocks = (remaining + 9 <= 64) ? 1 : 2;
+			memset(l.tail, 0, sizeof(l.tail));
+			if (remaining > 0)
+				memcpy(l.tail, message + full_blocks * 64, remaining);
+			l.tail[remaining] = 0x80;
+			ubyte64 length_bits = size * (ubyte64) 8;
+			for (int i = 0; i < 8; i++)
+				l.tail[l.tail_blocks * 64 - 1 - i] = (unsigned char) (length_bits >> (i * 8));
+
+			if (full_blocks > 0)
+			{
+				l.data = message;
+				l.blocks_left = full_blocks;
+				l.tail_pending = true;
+			}
+			else
+			{
+				l.data = l.tail;
+				l.blocks_left = l.tail_blocks;
+				l.tail_pending = false;
+			}
+
+			for (int i = 0; i < 8; i++)
+				states[i * num_lanes + lane] = initial_state[i];
+			lanes_active++;
+		}
+
+		if (lanes_active == 0)
+			break;
+
+		// Run all lanes for as many blocks as the shortest active lane has. Idle lanes hash a copy of an active lane.
+		int num_blocks = 0x7fffffff;
+		const unsigned char *idle_data = 0;
+		for (int lane = 0; lane < num_lanes; lane++)
+		{
+			if (lanes[lane].buffer != -1)
+			{
+				num_blocks = min(num_blocks, lanes[lane].blocks_left);
+				idle_data = lanes[lane].data;
+			}
+		}
+		for (int lane = 0; lane < num_lanes; lane++)
+			lane_data[lane] = (lanes[lane].buffer != -1) ? lanes[lane].data : idle_data;
+
+		SHA_SIMD::sha256_process_blocks_x8(states, lane_data, num_blocks);
+
+		for (int lane = 0; lane < num_lanes; lane++)
+		{
+			Lane &l = lanes[lane];
+			if (l.buffer == -1)
+				continue;
+
+			l.data += num_blocks * 64;
+			l.blocks_left -= num_blocks;
+			if (l.blocks_left > 0)
+				continue;
+
+			if (l.tail_pending)
+			{
+				l.data = l.tail;
+				l.blocks_left = l.tail_blocks;
+				l.tail_pending = false;
+			}
+			else
+			{
+				unsigned char *out_hash = out_hashes + l.buffer * 32;
+				for (int i = 0; i < 8; i++)
+				{
+					ubyte32 value = states[i * num_lanes + lane];
+					out_hash[i * 4] = (unsigned char) (value >> 24);
+					out_hash[i * 4 + 1] = (unsigned char) (value >> 16);
+					out_hash[i * 4 + 2] = (unsigned char) (value >> 8);
+					out_hash[i * 4 + 3] = (unsigned char) value;
+				}
+				l.buffer = -1;
+				lanes_active--;
+			}
+		}
+	}
+}
+
+}
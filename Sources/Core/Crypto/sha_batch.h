@@ -0,0 +1,65 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "API/Core/System/cl_platform.h"
+
+namespace clan
+{
+
+class DataBuffer;
+class WorkQueue;
+
+/// \brief Hashes many independent buffers, used by the HashFunctions batch functions
+class SHA_Batch
+{
+/// \name Operations
+/// \{
+
+public:
+	typedef void (*BatchFunction)(const DataBuffer *data, int num_buffers, unsigned char *out_hashes);
+
+	static void sha1(const DataBuffer *data, int num_buffers, unsigned char *out_hashes);
+	static void sha256(const DataBuffer *data, int num_buffers, unsigned char *out_hashes);
+	static void sha512(const DataBuffer *data, int num_buffers, unsigned char *out_hashes);
+
+	/// \brief Splits the buffers into groups of similar total size and hashes the groups on the work queue threads
+	static void run(BatchFunction func, int hash_size, const DataBuffer *data, int num_buffers, unsigned char *out_hashes, WorkQueue &work_queue);
+
+/// \}
+/// \name Implementation
+/// \{
+
+private:
+	/// \brief Hashes eight messages at a time with the AVX2 kernel, refilling lanes as messages complete
+	static void sha256_multi_buffer(const DataBuffer *data, int num_buffers, unsigned char *out_hashes);
+/// \}
+};
+
+}
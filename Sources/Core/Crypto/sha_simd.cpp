@@ -0,0 +1,464 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Core/precomp.h"
+#include "sha_simd.h"
+#include "API/Core/System/system.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+	#if defined(_MSC_VER) && _MSC_VER >= 1900
+		#define CL_SHA_SIMD
+		#define cl_target_sha
+		#define cl_target_avx2
+		#include <immintrin.h>
+	#elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+		#define CL_SHA_SIMD
+		#define cl_target_sha __attribute__((target("sha,sse4.1")))
+		#define cl_target_avx2 __attribute__((target("avx2")))
+		#include <immintrin.h>
+	#endif
+#endif
+
+namespace clan
+{
+
+#ifdef CL_SHA_SIMD
+
+/////////////////////////////////////////////////////////////////////////////
+// SHA-NI kernels:
+//
+// The message schedule is interleaved with the rounds as described in Intel's
+// "New Instructions Supporting the Secure Hash Algorithm on Intel Architecture Processors".
+
+static const ubyte32 cl_sha256_k[64] =
+{
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+cl_target_sha static void cl_sha1_shani(ubyte32 state[5], const unsigned char *data, int num_blocks)
+{
+	const __m128i byte_swap = _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+
+	__m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) state), 0x1b);
+	__m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+	__m128i e1;
+
+	for (int block = 0; block < num_blocks; block++, data += 64)
+	{
+		__m128i abcd_save = abcd;
+		__m128i e0_save = e0;
+
+		// Rounds 0-3
+		__m128i msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 0)), byte_swap);
+		e0 = _mm_add_epi32(e0, msg0);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+		// Rounds 4-7
+		__m128i msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16)), byte_swap);
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+		// Rounds 8-11
+		__m128i msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 32)), byte_swap);
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+
+		// Rounds 12-15
+		__m128i msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 48)), byte_swap);
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+
+		// Rounds 16-19
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+
+		// Rounds 20-23
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+		msg3 = _mm_xor_si128(msg3, msg1);
+
+		// Rounds 24-27
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+
+		// Rounds 28-31
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+
+		// Rounds 32-35
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+
+		// Rounds 36-39
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+		msg3 = _mm_xor_si128(msg3, msg1);
+
+		// Rounds 40-43
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+
+		// Rounds 44-47
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+
+		// Rounds 48-51
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+
+		// Rounds 52-55
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+		msg3 = _mm_xor_si128(msg3, msg1);
+
+		// Rounds 56-59
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+
+		// Rounds 60-63
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+
+		// Rounds 64-67
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+
+		// Rounds 68-71
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+		msg3 = _mm_xor_si128(msg3, msg1);
+
+		// Rounds 72-75
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+		// Rounds 76-79
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+		e0 = _mm_sha1nexte_epu32(e0, e0_save);
+		abcd = _mm_add_epi32(abcd, abcd_save);
+	}
+
+	_mm_storeu_si128((__m128i *) state, _mm_shuffle_epi32(abcd, 0x1b));
+	state[4] = _mm_extract_epi32(e0, 3);
+}
+
+/// \brief Four SHA-256 rounds, the message schedule of the following quad and message words for a later quad
+///
+/// Quad i uses msg[i % 4]. After the rounds, msg[(i + 1) % 4] is completed and msg1 is applied to msg[(i + 3) % 4].
+cl_target_sha static inline void cl_sha256_shani_quad(__m128i &state0, __m128i &state1, const __m128i &current, __m128i &next, const __m128i &previous, __m128i &later, int quad)
+{
+	__m128i msg = _mm_add_epi32(current, _mm_loadu_si128((const __m128i *) (cl_sha256_k + quad * 4)));
+	state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+	if (quad >= 3 && quad < 15)
+		next = _mm_sha256msg2_epu32(_mm_add_epi32(next, _mm_alignr_epi8(current, previous, 4)), current);
+	msg = _mm_shuffle_epi32(msg, 0x0e);
+	state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+	if (quad >= 1 && quad < 13)
+		later = _mm_sha256msg1_epu32(later, current);
+}
+
+cl_target_sha static void cl_sha256_shani(ubyte32 state[8], const unsigned char *data, int num_blocks)
+{
+	const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+
+	// Reorder the state into the ABEF and CDGH form used by SHA256RNDS2
+	__m128i cdab = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) state), 0xb1);
+	__m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) (state + 4)), 0x1b);
+	__m128i state0 = _mm_alignr_epi8(cdab, efgh, 8);
+	__m128i state1 = _mm_blend_epi16(efgh, cdab, 0xf0);
+
+	for (int block = 0; block < num_blocks; block++, data += 64)
+	{
+		__m128i state0_save = state0;
+		__m128i state1_save = state1;
+
+		__m128i msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 0)), byte_swap);
+		__m128i msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16)), byte_swap);
+		__m128i msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 32)), byte_swap);
+		__m128i msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 48)), byte_swap);
+
+		cl_sha256_shani_quad(state0, state1, msg0, msg1, msg3, msg3, 0);
+		cl_sha256_shani_quad(state0, state1, msg1, msg2, msg0, msg0, 1);
+		cl_sha256_shani_quad(state0, state1, msg2, msg3, msg1, msg1, 2);
+		cl_sha256_shani_quad(state0, state1, msg3, msg0, msg2, msg2, 3);
+		for (int quad = 4; quad < 16; quad += 4)
+		{
+			cl_sha256_shani_quad(state0, state1, msg0, msg1, msg3, msg3, quad);
+			cl_sha256_shani_quad(state0, state1, msg1, msg2, msg0, msg0, quad + 1);
+			cl_sha256_shani_quad(state0, state1, msg2, msg3, msg1, msg1, quad + 2);
+			cl_sha256_shani_quad(state0, state1, msg3, msg0, msg2, msg2, quad + 3);
+		}
+
+		state0 = _mm_add_epi32(state0, state0_save);
+		state1 = _mm_add_epi32(state1, state1_save);
+	}
+
+	// Back from ABEF and CDGH to ABCD and EFGH
+	__m128i feba = _mm_shuffle_epi32(state0, 0x1b);
+	__m128i dchg = _mm_shuffle_epi32(state1, 0xb1);
+	_mm_storeu_si128((__m128i *) state, _mm_blend_epi16(feba, dchg, 0xf0));
+	_mm_storeu_si128((__m128i *) (state + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// AVX2 multi-buffer kernel:
+//
+// Each 32 bit lane of the vectors holds the state of a different message.
+
+cl_target_avx2 static inline __m256i cl_avx2_rotr(__m256i value, int shift)
+{
+	return _mm256_or_si256(_mm256_srli_epi32(value, shift), _mm256_slli_epi32(value, 32 - shift));
+}
+
+cl_target_avx2 static inline void cl_avx2_transpose8x8(__m256i *r)
+{
+	__m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+	__m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+	__m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+	__m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+	__m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+	__m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+	__m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+	__m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+	__m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+	__m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+	__m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+	__m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+	__m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+	__m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+	__m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+	__m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+	r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+	r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+	r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+	r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+	r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+	r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+	r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+	r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+cl_target_avx2 static void cl_sha256_avx2_x8(ubyte32 *states, const unsigned char * const *data, int num_blocks)
+{
+	const __m256i byte_swap = _mm256_setr_epi8(
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+	__m256i s[8];
+	for (int i = 0; i < 8; i++)
+		s[i] = _mm256_loadu_si256((const __m256i *) (states + i * 8));
+
+	for (int block = 0; block < num_blocks; block++)
+	{
+		__m256i w[16];
+		for (int half = 0; half < 2; half++)
+		{
+			for (int lane = 0; lane < 8; lane++)
+				w[half * 8 + lane] = _mm256_loadu_si256((const __m256i *) (data[lane] + block * 64 + half * 32));
+			cl_avx2_transpose8x8(w + half * 8);
+			for (int i = 0; i < 8; i++)
+				w[half * 8 + i] = _mm256_shuffle_epi8(w[half * 8 + i], byte_swap);
+		}
+
+		__m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+		for (int i = 0; i < 64; i++)
+		{
+			if (i >= 16)
+			{
+				__m256i w2 = w[(i - 2) & 15];
+				__m256i w15 = w[(i - 15) & 15];
+				__m256i sigma1 = _mm256_xor_si256(_mm256_xor_si256(cl_avx2_rotr(w2, 17), cl_avx2_rotr(w2, 19)), _mm256_srli_epi32(w2, 10));
+				__m256i sigma0 = _mm256_xor_si256(_mm256_xor_si256(cl_avx2_rotr(w15, 7), cl_avx2_rotr(w15, 18)), _mm256_srli_epi32(w15, 3));
+				w[i & 15] = _mm256_add_epi32(_mm256_add_epi32(sigma1, w[(i - 7) & 15]), _mm256_add_epi32(sigma0, w[i & 15]));
+			}
+
+			__m256i big_sigma1 = _mm256_xor_si256(_mm256_xor_si256(cl_avx2_rotr(e, 6), cl_avx2_rotr(e, 11)), cl_avx2_rotr(e, 25));
+			__m256i ch = _mm256_xor_si256(_mm256_and_si256(e, _mm256_xor_si256(f, g)), g);
+			__m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, big_sigma1), _mm256_add_epi32(ch, _mm256_add_epi32(_mm256_set1_epi32(cl_sha256_k[i]), w[i & 15])));
+			__m256i big_sigma0 = _mm256_xor_si256(_mm256_xor_si256(cl_avx2_rotr(a, 2), cl_avx2_rotr(a, 13)), cl_avx2_rotr(a, 22));
+			__m256i maj = _mm256_or_si256(_mm256_and_si256(a, _mm256_or_si256(b, c)), _mm256_and_si256(b, c));
+			__m256i t2 = _mm256_add_epi32(big_sigma0, maj);
+
+			h = g;
+			g = f;
+			f = e;
+			e = _mm256_add_epi32(d, t1);
+			d = c;
+			c = b;
+			b = a;
+			a = _mm256_add_epi32(t1, t2);
+		}
+
+		s[0] = _mm256_add_epi32(s[0], a);
+		s[1] = _mm256_add_epi32(s[1], b);
+		s[2] = _mm256_add_epi32(s[2], c);
+		s[3] = _mm256_add_epi32(s[3], d);
+		s[4] = _mm256_add_epi32(s[4], e);
+		s[5] = _mm256_add_epi32(s[5], f);
+		s[6] = _mm256_add_epi32(s[6], g);
+		s[7] = _mm256_add_epi32(s[7], h);
+	}
+
+	for (int i = 0; i < 8; i++)
+		_mm256_storeu_si256((__m256i *) (states + i * 8), s[i]);
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+// SHA_SIMD Attributes:
+
+bool SHA_SIMD::sha_enabled = true;
+bool SHA_SIMD::avx2_enabled = true;
+
+bool SHA_SIMD::is_sha_supported()
+{
+#ifdef CL_SHA_SIMD
+	static bool supported = System::detect_cpu_extension(System::sha) && System::detect_cpu_extension(System::sse4_1) && System::detect_cpu_extension(System::ssse3);
+	return supported;
+#else
+	return false;
+#endif
+}
+
+bool SHA_SIMD::is_avx2_supported()
+{
+#ifdef CL_SHA_SIMD
+	static bool supported = System::detect_cpu_extension(System::avx2);
+	return supported;
+#else
+	return false;
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// SHA_SIMD Operations:
+
+void SHA_SIMD::sha1_process_blocks(ubyte32 state[5], const unsigned char *data, int num_blocks)
+{
+#ifdef CL_SHA_SIMD
+	cl_sha1_shani(state, data, num_blocks);
+#else
+	throw Exception("SHA extensions not supported");
+#endif
+}
+
+void SHA_SIMD::sha256_process_blocks(ubyte32 state[8], const unsigned char *data, int num_blocks)
+{
+#ifdef CL_SHA_SIMD
+	cl_sha256_shani(state, data, num_blocks);
+#else
+	throw Exception("SHA extensions not supported");
+#endif
+}
+
+void SHA_SIMD::sha256_process_blocks_x8(ubyte32 states[8 * num_lanes], const unsigned char * const data[num_lanes], int num_blocks)
+{
+#ifdef CL_SHA_SIMD
+	cl_sha256_avx2_x8(states, data, num_blocks);
+#else
+	throw Exception("AVX2 not supported");
+#endif
+}
+
+}
@@ -0,0 +1,94 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "API/Core/System/cl_platform.h"
+
+namespace clan
+{
+
+/// \brief SIMD compression functions for the SHA hash classes
+///
+/// SHA-1 and SHA-256 use the SHA extensions (SHA-NI) when available. SHA-256 additionally has an
+/// AVX2 kernel that hashes eight independent messages at once, used for batches on CPUs without SHA-NI.
+class SHA_SIMD
+{
+/// \name Attributes
+/// \{
+
+public:
+	/// \brief Number of messages processed together by sha256_process_blocks_x8
+	static const int num_lanes = 8;
+
+	/// \brief Returns true if the CPU supports the SHA extensions
+	static bool is_sha_supported();
+
+	/// \brief Returns true if the CPU and OS support AVX2
+	static bool is_avx2_supported();
+
+	/// \brief Returns true if the SHA extensions are supported and enabled
+	static bool is_sha_enabled() { return sha_enabled && is_sha_supported(); }
+
+	/// \brief Returns true if AVX2 is supported and enabled
+	static bool is_avx2_enabled() { return avx2_enabled && is_avx2_supported(); }
+
+/// \}
+/// \name Operations
+/// \{
+
+public:
+	/// \brief Enables or disables the SHA extension code paths (used for testing the portable paths)
+	static void set_sha_enabled(bool enable) { sha_enabled = enable; }
+
+	/// \brief Enables or disables the AVX2 code paths (used for testing the portable paths)
+	static void set_avx2_enabled(bool enable) { avx2_enabled = enable; }
+
+	/// \brief Compresses 64 byte blocks into a SHA-1 state. Requires is_sha_supported()
+	static void sha1_process_blocks(ubyte32 state[5], const unsigned char *data, int num_blocks);
+
+	/// \brief Compresses 64 byte blocks into a SHA-256 state. Requires is_sha_supported()
+	static void sha256_process_blocks(ubyte32 state[8], const unsigned char *data, int num_blocks);
+
+	/// \brief Compresses 64 byte blocks of eight independent messages. Requires is_avx2_supported()
+	///
+	/// \param states = SHA-256 states, interleaved so word i of lane j is at states[i * num_lanes + j]
+	/// \param data = Data pointer for each lane. Each must have num_blocks blocks available.
+	static void sha256_process_blocks_x8(ubyte32 states[8 * num_lanes], const unsigned char * const data[num_lanes], int num_blocks);
+
+/// \}
+/// \name Implementation
+/// \{
+
+private:
+	static bool sha_enabled;
+	static bool avx2_enabled;
+/// \}
+};
+
+}
@@ -0,0 +1,117 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Core/precomp.h"
+#include "API/Core/IOData/memory_mapped_file.h"
+#include "API/Core/Text/string_help.h"
+#include "API/Core/Text/string_format.h"
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace clan
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// MemoryMappedFile construction:
+
+#ifdef WIN32
+
+MemoryMappedFile::MemoryMappedFile(const std::string &filename)
+: data(0), size(0), file_handle(INVALID_HANDLE_VALUE), mapping_handle(0)
+{
+	file_handle = CreateFile(StringHelp::utf8_to_ucs2(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, 0);
+	if (file_handle == INVALID_HANDLE_VALUE)
+		throw Exception(string_format("Unable to open %1 for memory mapping", filename));
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0)
+	{
+		CloseHandle(file_handle);
+		throw Exception(string_format("Unable to memory map %1", filename));
+	}
+
+	mapping_handle = CreateFileMapping(file_handle, 0, PAGE_READONLY, 0, 0, 0);
+	if (mapping_handle)
+		data = (const unsigned char *) MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+
+	if (data == 0)
+	{
+		if (mapping_handle)
+			CloseHandle(mapping_handle);
+		CloseHandle(file_handle);
+		throw Exception(string_format("Unable to memory map %1", filename));
+	}
+	size = file_size.QuadPart;
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	UnmapViewOfFile(data);
+	CloseHandle(mapping_handle);
+	CloseHandle(file_handle);
+}
+
+#else
+
+MemoryMappedFile::MemoryMappedFile(const std::string &filename)
+: data(0), size(0)
+{
+	std::string filename_a = StringHelp::text_to_local8(filename);
+	int handle = ::open(filename_a.c_str(), O_RDONLY);
+	if (handle == -1)
+		throw Exception(string_format("Unable to open %1 for memory mapping", filename));
+
+	struct stat file_stat;
+	if (fstat(handle, &file_stat) == -1 || file_stat.st_size == 0)
+	{
+		::close(handle);
+		throw Exception(string_format("Unable to memory map %1", filename));
+	}
+
+	void *mapping = mmap(0, file_stat.st_size, PROT_READ, MAP_SHARED, handle, 0);
+	::close(handle);
+	if (mapping == MAP_FAILED)
+		throw Exception(string_format("Unable to memory map %1", filename));
+
+	data = (const unsigned char *) mapping;
+	size = file_stat.st_size;
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	munmap((void *) data, size);
+}
+
+#endif
+
+}
@@ -0,0 +1,420 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Core/precomp.h"
+#include "API/Core/JSON/json_document.h"
+#include "API/Core/JSON/json_reader.h"
+#include <algorithm>
+
+namespace clan
+{
+
+class JsonDocument_Impl
+{
+public:
+	struct Node
+	{
+		unsigned char type;
+		bool boolean;
+		unsigned int offset; // Into strings, members or items, depending on type
+		unsigned int size;
+		double number;
+	};
+
+	struct Member
+	{
+		unsigned int key_offset;
+		unsigned int key_length;
+		unsigned int value;
+	};
+
+	void parse(JsonReader &reader);
+
+	const Node &get_node(unsigned int index) const { return nodes[index]; }
+	const char *get_string(unsigned int offset) const { return &strings[offset]; }
+	int find_member(const Node &node, const char *key, size_t length) const;
+
+	std::vector<Node> nodes;
+	std::vector<Member> members;
+	std::vector<unsigned int> items;
+	std::vector<char> strings;
+
+private:
+	unsigned int add_node(JsonValue::Type type);
+	unsigned int add_string(const std::string &str);
+	void end_object(unsigned int node_index, size_t first_member);
+	void end_array(unsigned int node_index, size_t first_item);
+
+	struct MemberLess
+	{
+		MemberLess(const std::vector<char> &strings) : strings(strings) { }
+		bool operator()(const Member &a, const Member &b) const
+		{
+			return compare(&strings[a.key_offset], a.key_length, &strings[b.key_offset], b.key_length) < 0;
+		}
+		const std::vector<char> &strings;
+	};
+
+	static int compare(const char *a, size_t a_length, const char *b, size_t b_length)
+	{
+		int result = memcmp(a, b, std::min(a_length, b_length));
+		if (result != 0)
+			return result;
+		return (a_length < b_length) ? -1 : (a_length > b_length) ? 1 : 0;
+	}
+
+	struct Frame
+	{
+		unsigned int node_index;
+		size_t first_child;
+	};
+
+	// Members and items of the containers currently being parsed
+	std::vector<Frame> frames;
+	std::vector<Member> member_stack;
+	std::vector<unsigned int> item_stack;
+
+	friend class JsonNode;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+JsonDocument::JsonDocument()
+: impl(new JsonDocument_Impl)
+{
+	JsonDocument_Impl::Node node = { JsonValue::type_null, false, 0, 0, 0.0 };
+	impl->nodes.push_back(node);
+}
+
+JsonDocument::JsonDocument(const char *data, size_t length)
+: impl(new JsonDocument_Impl)
+{
+	JsonReader reader(data, length);
+	impl->parse(reader);
+}
+
+JsonDocument::JsonDocument(const std::string &json)
+: impl(new JsonDocument_Impl)
+{
+	JsonReader reader(json);
+	impl->parse(reader);
+}
+
+JsonDocument::JsonDocument(IODevice &device)
+: impl(new JsonDocument_Impl)
+{
+	JsonReader reader(device);
+	impl->parse(reader);
+}
+
+JsonDocument::~JsonDocument()
+{
+}
+
+JsonNode JsonDocument::get_root() const
+{
+	return JsonNode(impl.get(), 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+JsonValue::Type JsonNode::get_type() const
+{
+	if (!document)
+		return JsonValue::type_null;
+	return (JsonValue::Type)document->get_node(index).type;
+}
+
+size_t JsonNode::get_size() const
+{
+	if (!document)
+		return 0;
+	const JsonDocument_Impl::Node &node = document->get_node(index);
+	switch (node.type)
+	{
+	case JsonValue::type_object:
+	case JsonValue::type_array:
+	case JsonValue::type_string:
+		return node.size;
+	default:
+		return 0;
+	}
+}
+
+JsonNode JsonNode::operator[](const char *key) const
+{
+	if (get_type() != JsonValue::type_object)
+		throw JsonException("JSON Value is not an object");
+	const JsonDocument_Impl::Node &node = document->get_node(index);
+	int member_index = document->find_member(node, key, strlen(key));
+	if (member_index == -1)
+		return JsonNode();
+	return JsonNode(document, document->members[node.offset + member_index].value);
+}
+
+JsonNode JsonNode::operator[](const std::string &key) const
+{
+	if (get_type() != JsonValue::type_object)
+		throw JsonException("JSON Value is not an object");
+	const JsonDocument_Impl::Node &node = document->get_node(index);
+	int member_index = document->find_member(node, key.data(), key.length());
+	if (member_index == -1)
+		return JsonNode();
+	return JsonNode(document, document->members[node.offset + member_index].value);
+}
+
+JsonNode JsonNode::operator[](int item_index) const
+{
+	if (get_type() != JsonValue::type_array)
+		throw JsonException("JSON Value is not an array");
+	const JsonDocument_Impl::Node &node = document->get_node(index);
+	if (item_index < 0 || (unsigned int)item_index >= node.size)
+		throw JsonException("JSON array index out of range");
+	return JsonNode(document, document->items[node.offset + item_index]);
+}
+
+bool JsonNode::has_member(const std::string &key) const
+{
+	if (get_type() != JsonValue::type_object)
+		return false;
+	return document->find_member(document->get_node(index), key.data(), key.length()) != -1;
+}
+
+std::string JsonNode::get_member_name(int member_index) const
+{
+	if (get_type() != JsonValue::type_object)
+		throw JsonException("JSON Value is not an object");
+	const JsonDocument_Impl::Node &node = document->get_node(index);
+	if (member_index < 0 || (unsigned int)member_index >= node.size)
+		throw JsonException("JSON member index out of range");
+	const JsonDocument_Impl::Member &member = document->members[node.offset + member_index];
+	return std::string(document->get_string(member.key_offset), member.key_length);
+}
+
+JsonNode JsonNode::get_member_value(int member_index) const
+{
+	if (get_type() != JsonValue::type_object)
+		throw JsonException("JSON Value is not an object");
+	const JsonDocument_Impl::Node &node = document->get_node(index);
+	if (member_index < 0 || (unsigned int)member_index >= node.size)
+		throw JsonException("JSON member index out of range");
+	return JsonNode(document, document->members[node.offset + member_index].value);
+}
+
+const char *JsonNode::get_string_data() const
+{
+	if (get_type() != JsonValue::type_string)
+		throw JsonException("JSON Value is not a string");
+	return document->get_string(document->get_node(index).offset);
+}
+
+std::string JsonNode::to_string() const
+{
+	if (get_type() != JsonValue::type_string)
+		throw JsonException("JSON Value is not a string");
+	const JsonDocument_Impl::Node &node = document->get_node(index);
+	return std::string(document->get_string(node.offset), node.size);
+}
+
+double JsonNode::to_double() const
+{
+	if (get_type() != JsonValue::type_number)
+		throw JsonException("JSON Value is not a number");
+	return document->get_node(index).number;
+}
+
+bool JsonNode::to_boolean() const
+{
+	if (get_type() != JsonValue::type_boolean)
+		throw JsonException("JSON Value is not a boolean");
+	return document->get_node(index).boolean;
+}
+
+JsonValue JsonNode::to_value() const
+{
+	switch (get_type())
+	{
+	case JsonValue::type_object:
+		{
+			JsonValue value = JsonValue::object();
+			int size = get_size();
+			for (int i = 0; i < size; i++)
+				value[get_member_name(i)] = get_member_value(i).to_value();
+			return value;
+		}
+	case JsonValue::type_array:
+		{
+			JsonValue value = JsonValue::array();
+			int size = get_size();
+			value.get_items().reserve(size);
+			for (int i = 0; i < size; i++)
+				value.get_items().push_back((*this)[i].to_value());
+			return value;
+		}
+	case JsonValue::type_string:
+		return JsonValue::string(to_string());
+	case JsonValue::type_number:
+		return JsonValue::number(to_double());
+	case JsonValue::type_boolean:
+		return JsonValue::boolean(to_boolean());
+	default:
+		return JsonValue::null();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void JsonDocument_Impl::parse(JsonReader &reader)
+{
+	while (true)
+	{
+		JsonReader::Token token = reader.next();
+		switch (token)
+		{
+		case JsonReader::token_end:
+			return;
+		case JsonReader::token_key:
+			{
+				Member member = { add_string(reader.get_string()), (unsigned int)reader.get_string().length(), 0 };
+				member_stack.push_back(member);
+			}
+			break;
+		case JsonReader::token_begin_object:
+			{
+				Frame frame = { add_node(JsonValue::type_object), member_stack.size() };
+				frames.push_back(frame);
+			}
+			break;
+		case JsonReader::token_begin_array:
+			{
+				Frame frame = { add_node(JsonValue::type_array), item_stack.size() };
+				frames.push_back(frame);
+			}
+			break;
+		case JsonReader::token_end_object:
+			end_object(frames.back().node_index, frames.back().first_child);
+			frames.pop_back();
+			break;
+		case JsonReader::token_end_array:
+			end_array(frames.back().node_index, frames.back().first_child);
+			frames.pop_back();
+			break;
+		case JsonReader::token_string:
+			{
+				unsigned int offset = add_string(reader.get_string());
+				unsigned int node_index = add_node(JsonValue::type_string);
+				nodes[node_index].offset = offset;
+				nodes[node_index].size = reader.get_string().length();
+			}
+			break;
+		case JsonReader::token_number:
+			nodes[add_node(JsonValue::type_number)].number = reader.get_number();
+			break;
+		case JsonReader::token_boolean:
+			nodes[add_node(JsonValue::type_boolean)].boolean = reader.get_boolean();
+			break;
+		case JsonReader::token_null:
+			add_node(JsonValue::type_null);
+			break;
+		}
+	}
+}
+
+unsigned int JsonDocument_Impl::add_node(JsonValue::Type type)
+{
+	unsigned int node_index = nodes.size();
+	Node node = { (unsigned char)type, false, 0, 0, 0.0 };
+	nodes.push_back(node);
+
+	// Attach the node to the container being parsed
+	if (!frames.empty())
+	{
+		if (nodes[frames.back().node_index].type == JsonValue::type_object)
+			member_stack.back().value = node_index;
+		else
+			item_stack.push_back(node_index);
+	}
+	return node_index;
+}
+
+unsigned int JsonDocument_Impl::add_string(const std::string &str)
+{
+	unsigned int offset = strings.size();
+	strings.insert(strings.end(), str.begin(), str.end());
+	strings.push_back(0);
+	return offset;
+}
+
+void JsonDocument_Impl::end_object(unsigned int node_index, size_t first_member)
+{
+	std::vector<Member>::iterator begin = member_stack.begin() + first_member;
+	std::stable_sort(begin, member_stack.end(), MemberLess(strings));
+
+	// When a key appears more than once the last value wins, as with JsonValue
+	Node &node = nodes[node_index];
+	node.offset = members.size();
+	for (std::vector<Member>::iterator it = begin; it != member_stack.end(); ++it)
+	{
+		if (members.size() > node.offset && !MemberLess(strings)(members.back(), *it))
+			members.back() = *it;
+		else
+			members.push_back(*it);
+	}
+	node.size = members.size() - node.offset;
+	member_stack.erase(begin, member_stack.end());
+}
+
+void JsonDocument_Impl::end_array(unsigned int node_index, size_t first_item)
+{
+	Node &node = nodes[node_index];
+	node.offset = items.size();
+	node.size = item_stack.size() - first_item;
+	items.insert(items.end(), item_stack.begin() + first_item, item_stack.end());
+	item_stack.resize(first_item);
+}
+
+int JsonDocument_Impl::find_member(const Node &node, const char *key, size_t length) const
+{
+	int low = 0;
+	int high = (int)node.size - 1;
+	while (low <= high)
+	{
+		int middle = (low + high) / 2;
+		const Member &member = members[node.offset + middle];
+		int result = compare(&strings[member.key_offset], member.key_length, key, length);
+		if (result < 0)
+			low = middle + 1;
+		else if (result > 0)
+			high = middle - 1;
+		else
+			return middle;
+	}
+	return -1;
+}
+
+}
@@ -0,0 +1,535 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Core/precomp.h"
+#include "API/Core/JSON/json_reader.h"
+#include "API/Core/JSON/json_value.h"
+#include "API/Core/IOData/iodevice.h"
+#include <cstdlib>
+
+namespace clan
+{
+
+class JsonReader_Impl
+{
+public:
+	JsonReader_Impl()
+	: pos(0), end(0), has_device(false), token(JsonReader::token_end), number(), boolean(),
+	  after_key(false), need_separator(false), just_opened(false), root_done(false)
+	{
+	}
+
+	JsonReader::Token next();
+	void skip();
+
+	const char *pos;
+	const char *end;
+
+	IODevice device;
+	bool has_device;
+	std::vector<char> buffer;
+
+	std::vector<char> stack;
+	JsonReader::Token token;
+	std::string value;
+	std::string number_text;
+	double number;
+	bool boolean;
+
+	bool after_key;
+	bool need_separator;
+	bool just_opened;
+	bool root_done;
+
+	static const int device_buffer_size = 64 * 1024;
+
+private:
+	bool fill();
+	int peek() { if (pos == end && !fill()) return -1; return (unsigned char)*pos; }
+	char get() { if (pos == end && !fill()) throw_end(); return *(pos++); }
+	void end_value() { if (stack.empty()) root_done = true; else need_separator = true; }
+
+	void read_whitespace();
+	void read_string();
+	void read_escape();
+	unsigned int read_hex4();
+	void read_number();
+	void read_literal(const char *text, int length);
+
+	static void throw_end() { throw JsonException("Unexpected end of JSON data"); }
+	static void throw_unexpected() { throw JsonException("Unexpected character in JSON data"); }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+JsonReader::JsonReader(const char *data, size_t length)
+: impl(new JsonReader_Impl)
+{
+	impl->pos = data;
+	impl->end = data + length;
+}
+
+JsonReader::JsonReader(const std::string &json)
+: impl(new JsonReader_Impl)
+{
+	impl->pos = json.data();
+	impl->end = json.data() + json.length();
+}
+
+JsonReader::JsonReader(IODevice &device)
+: impl(new JsonReader_Impl)
+{
+	impl->device = device;
+	impl->has_device = true;
+	impl->buffer.resize(JsonReader_Impl::device_buffer_size);
+}
+
+JsonReader::~JsonReader()
+{
+}
+
+JsonReader::Token JsonReader::get_token() const
+{
+	return impl->token;
+}
+
+const std::string &JsonReader::get_string() const
+{
+	return impl->value;
+}
+
+double JsonReader::get_number() const
+{
+	return impl->number;
+}
+
+bool JsonReader::get_boolean() const
+{
+	return impl->boolean;
+}
+
+int JsonReader::get_depth() const
+{
+	return impl->stack.size();
+}
+
+JsonReader::Token JsonReader::next()
+{
+	return impl->next();
+}
+
+void JsonReader::skip()
+{
+	impl->skip();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+JsonReader::Token JsonReader_Impl::next()
+{
+	read_whitespace();
+
+	if (root_done)
+	{
+		if (peek() != -1)
+			throw_unexpected();
+		token = JsonReader::token_end;
+		return token;
+	}
+
+	int c = peek();
+	if (c == -1)
+		throw_end();
+
+	if (!stack.empty())
+	{
+		char container = stack.back();
+		char close = (container == '{') ? '}' : ']';
+		if (c == close && (need_separator || just_opened) && !after_key)
+		{
+			pos++;
+			stack.pop_back();
+			just_opened = false;
+			end_value();
+			token = (container == '{') ? JsonReader::token_end_object : JsonReader::token_end_array;
+			return token;
+		}
+
+		if (need_separator)
+		{
+			if (c != ',')
+				throw_unexpected();
+			pos++;
+			need_separator = false;
+			read_whitespace();
+			c = peek();
+			if (c == -1)
+				throw_end();
+		}
+		just_opened = false;
+
+		if (container == '{' && !after_key)
+		{
+			if (c != '"')
+				throw_unexpected();
+			read_string();
+			read_whitespace();
+			c = peek();
+			if (c == -1)
+				throw_end();
+			else if (c != ':')
+				throw_unexpected();
+			pos++;
+			after_key = true;
+			token = JsonReader::token_key;
+			return token;
+		}
+	}
+
+	after_key = false;
+	switch (c)
+	{
+	case '{':
+		pos++;
+		stack.push_back('{');
+		just_opened = true;
+		token = JsonReader::token_begin_object;
+		break;
+	case '[':
+		pos++;
+		stack.push_back('[');
+		just_opened = true;
+		token = JsonReader::token_begin_array;
+		break;
+	case '"':
+		read_string();
+		end_value();
+		token = JsonReader::token_string;
+		break;
+	case '-':
+	case '0':
+	case '1':
+	case '2':
+	case '3':
+	case '4':
+	case '5':
+	case '6':
+	case '7':
+	case '8':
+	case '9':
+		read_number();
+		end_value();
+		token = JsonReader::token_number;
+		break;
+	case 't':
+		read_literal("true", 4);
+		boolean = true;
+		end_value();
+		token = JsonReader::token_boolean;
+		break;
+	case 'f':
+		read_literal("false", 5);
+		boolean = false;
+		end_value();
+		token = JsonReader::token_boolean;
+		break;
+	case 'n':
+		read_literal("null", 4);
+		end_value();
+		token = JsonReader::token_null;
+		break;
+	default:
+		throw_unexpected();
+	}
+	return token;
+}
+
+void JsonReader_Impl::skip()
+{
+	if (token == JsonReader::token_key)
+		next();
+
+	if (token == JsonReader::token_begin_object || token == JsonReader::token_begin_array)
+	{
+		size_t depth = stack.size();
+		while (stack.size() >= depth)
+			next();
+	}
+}
+
+bool JsonReader_Impl::fill()
+{
+	if (!has_device)
+		return false;
+
+	int received = device.read(&buffer[0], buffer.size(), false);
+	if (received <= 0)
+		return false;
+
+	pos = &buffer[0];
+	end = pos + received;
+	return true;
+}
+
+void JsonReader_Impl::read_whitespace()
+{
+	while (true)
+	{
+		while (pos != end && (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t' || *pos == '\f'))
+			pos++;
+		if (pos != end || !fill())
+			break;
+	}
+}
+
+void JsonReader_Impl::read_string()
+{
+	pos++;
+	value.clear();
+	while (true)
+	{
+		if (pos == end && !fill())
+			throw_end();
+
+		const char *start = pos;
+		while (pos != end && *pos != '"' && *pos != '\\' && (unsigned char)*pos >= 0x20)
+			pos++;
+		value.append(start, pos);
+
+		if (pos == end)
+			continue;
+
+		if (*pos == '"')
+		{
+			pos++;
+			break;
+		}
+		else if (*pos != '\\')
+		{
+			throw JsonException("Unescaped control character in JSON string");
+		}
+
+		pos++;
+		read_escape();
+	}
+}
+
+void JsonReader_Impl::read_escape()
+{
+	char c = get();
+	switch (c)
+	{
+	case '"':
+	case '\\':
+	case '/':
+		value.push_back(c);
+		break;
+	case 'b':
+		value.push_back('\b');
+		break;
+	case 'f':
+		value.push_back('\f');
+		break;
+	case 'n':
+		value.push_back('\n');
+		break;
+	case 'r':
+		value.push_back('\r');
+		break;
+	case 't':
+		value.push_back('\t');
+		break;
+	case 'u':
+		{
+			unsigned int code = read_hex4();
+			if (code >= 0xdc00 && code <= 0xdfff)
+				throw JsonException("Invalid unicode escape in JSON data");
+			if (code >= 0xd800 && code <= 0xdbff)
+			{
+				if (get() != '\\' || get() != 'u')
+					throw JsonException("Invalid unicode escape in JSON data");
+				unsigned int low = read_hex4();
+				if (low < 0xdc00 || low > 0xdfff)
+					throw JsonException("Invalid unicode escape in JSON data");
+				code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+			}
+
+			if (code < 0x80)
+			{
+				value.push_back((char)code);
+			}
+			else if (code < 0x800)
+			{
+				value.push_back((char)(0xc0 | (code >> 6)));
+				value.push_back((char)(0x80 | (code & 0x3f)));
+			}
+			else if (code < 0x10000)
+			{
+				value.push_back((char)(0xe0 | (code >> 12)));
+				value.push_back((char)(0x80 | ((code >> 6) & 0x3f)));
+				value.push_back((char)(0x80 | (code & 0x3f)));
+			}
+			else
+			{
+				value.push_back((char)(0xf0 | (code >> 18)));
+				value.push_back((char)(0x80 | ((code >> 12) & 0x3f)));
+				value.push_back((char)(0x80 | ((code >> 6) & 0x3f)));
+				value.push_back((char)(0x80 | (code & 0x3f)));
+			}
+		}
+		break;
+	default:
+		throw_unexpected();
+	}
+}
+
+unsigned int JsonReader_Impl::read_hex4()
+{
+	unsigned int code = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		char c = get();
+		code <<= 4;
+		if (c >= '0' && c <= '9')
+			code += c - '0';
+		else if (c >= 'a' && c <= 'f')
+			code += c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			code += c - 'A' + 10;
+		else
+			throw_unexpected();
+	}
+	return code;
+}
+
+void JsonReader_Impl::read_number()
+{
+	// Collect the number text, validating the JSON number grammar as we go.
+	// A number may span several device buffers, so it is copied rather than parsed in place.
+	number_text.clear();
+	int digits = 0;
+	int fraction_digits = 0;
+	bool has_exponent = false;
+	ubyte64 mantissa = 0;
+
+	int c = peek();
+	if (c == '-')
+	{
+		number_text.push_back('-');
+		pos++;
+		c = peek();
+	}
+
+	while (c >= '0' && c <= '9')
+	{
+		number_text.push_back(c);
+		mantissa = mantissa * 10 + (c - '0');
+		digits++;
+		pos++;
+		c = peek();
+		if (digits == 1 && number_text[number_text.length() - 1] == '0' && c >= '0' && c <= '9')
+			throw_unexpected();
+	}
+	if (digits == 0)
+		throw_unexpected();
+
+	if (c == '.')
+	{
+		number_text.push_back('.');
+		pos++;
+		c = peek();
+		while (c >= '0' && c <= '9')
+		{
+			number_text.push_back(c);
+			mantissa = mantissa * 10 + (c - '0');
+			fraction_digits++;
+			pos++;
+			c = peek();
+		}
+		if (fraction_digits == 0)
+			throw_unexpected();
+	}
+
+	if (c == 'e' || c == 'E')
+	{
+		has_exponent = true;
+		number_text.push_back('e');
+		pos++;
+		c = peek();
+		if (c == '+' || c == '-')
+		{
+			number_text.push_back(c);
+			pos++;
+			c = peek();
+		}
+		int exponent_digits = 0;
+		while (c >= '0' && c <= '9')
+		{
+			number_text.push_back(c);
+			exponent_digits++;
+			pos++;
+			c = peek();
+		}
+		if (exponent_digits == 0)
+			throw_unexpected();
+	}
+
+	// Up to 15 significant digits and a power of ten up to 22 are exact doubles,
+	// so a single multiplication or division gives the correctly rounded result.
+	static const double powers_of_ten[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	if (!has_exponent && digits + fraction_digits <= 15)
+	{
+		number = (double)(byte64)mantissa;
+		if (fraction_digits > 0)
+			number /= powers_of_ten[fraction_digits];
+		if (number_text[0] == '-')
+			number = -number;
+	}
+	else
+	{
+		number = strtod(number_text.c_str(), 0);
+	}
+}
+
+void JsonReader_Impl::read_literal(const char *text, int length)
+{
+	for (int i = 0; i < length; i++)
+	{
+		if (pos == end && !fill())
+			throw_end();
+		if (*pos != text[i])
+			throw_unexpected();
+		pos++;
+	}
+}
+
+}
@@ -0,0 +1,355 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Core/precomp.h"
+#include "API/Core/JSON/json_writer.h"
+#include "API/Core/JSON/json_value.h"
+#include "API/Core/IOData/iodevice.h"
+#include <cmath>
+#include <cstdlib>
+
+namespace clan
+{
+
+class JsonWriter_Impl
+{
+public:
+	JsonWriter_Impl() : need_separator(false), after_key(false) { }
+
+	void begin_value();
+	void end_value() { need_separator = true; if (buffer.size() >= flush_threshold) flush(); }
+	void write_key(const char *key, size_t length);
+	void write_string(const char *str, size_t length);
+	void write_number(double value);
+	void write_value(const JsonValue &value);
+	void flush();
+
+	IODevice device;
+	std::string buffer;
+	std::vector<char> stack;
+	bool need_separator;
+	bool after_key;
+
+	static const size_t flush_threshold = 64 * 1024;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+JsonWriter::JsonWriter(IODevice &device)
+: impl(new JsonWriter_Impl)
+{
+	impl->device = device;
+	impl->buffer.reserve(JsonWriter_Impl::flush_threshold + 256);
+}
+
+JsonWriter::~JsonWriter()
+{
+	try
+	{
+		impl->flush();
+	}
+	catch (...)
+	{
+	}
+}
+
+void JsonWriter::begin_object()
+{
+	impl->begin_value();
+	impl->buffer.push_back('{');
+	impl->stack.push_back('{');
+	impl->need_separator = false;
+}
+
+void JsonWriter::end_object()
+{
+	if (impl->stack.empty() || impl->stack.back() != '{' || impl->after_key)
+		throw JsonException("Unbalanced JSON object");
+	impl->buffer.push_back('}');
+	impl->stack.pop_back();
+	impl->end_value();
+}
+
+void JsonWriter::begin_array()
+{
+	impl->begin_value();
+	impl->buffer.push_back('[');
+	impl->stack.push_back('[');
+	impl->need_separator = false;
+}
+
+void JsonWriter::end_array()
+{
+	if (impl->stack.empty() || impl->stack.back() != '[')
+		throw JsonException("Unbalanced JSON array");
+	impl->buffer.push_back(']');
+	impl->stack.pop_back();
+	impl->end_value();
+}
+
+void JsonWriter::write_key(const std::string &key)
+{
+	impl->write_key(key.data(), key.length());
+}
+
+void JsonWriter::write_key(const char *key)
+{
+	impl->write_key(key, strlen(key));
+}
+
+void JsonWriter::write_string(const std::string &value)
+{
+	impl->begin_value();
+	impl->write_string(value.data(), value.length());
+	impl->end_value();
+}
+
+void JsonWriter::write_string(const char *value)
+{
+	impl->begin_value();
+	impl->write_string(value, strlen(value));
+	impl->end_value();
+}
+
+void JsonWriter::write_number(int value)
+{
+	impl->begin_value();
+	char text[16];
+	char *p = text + 16;
+	unsigned int v = (value < 0) ? 0u - (unsigned int)value : (unsigned int)value;
+	do
+	{
+		*(--p) = '0' + v % 10;
+		v /= 10;
+	} while (v != 0);
+	if (value < 0)
+		*(--p) = '-';
+	impl->buffer.append(p, text + 16);
+	impl->end_value();
+}
+
+void JsonWriter::write_number(double value)
+{
+	impl->begin_value();
+	impl->write_number(value);
+	impl->end_value();
+}
+
+void JsonWriter::write_boolean(bool value)
+{
+	impl->begin_value();
+	impl->buffer.append(value ? "true" : "false");
+	impl->end_value();
+}
+
+void JsonWriter::write_null()
+{
+	impl->begin_value();
+	impl->buffer.append("null");
+	impl->end_value();
+}
+
+void JsonWriter::write_value(const JsonValue &value)
+{
+	impl->write_value(value);
+}
+
+void JsonWriter::flush()
+{
+	impl->flush();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void JsonWriter_Impl::begin_value()
+{
+	if (stack.empty())
+	{
+		if (need_separator)
+			throw JsonException("JSON data can only have one top level value");
+	}
+	else if (stack.back() == '{')
+	{
+		if (!after_key)
+			throw JsonException("JSON object member written without a key");
+		after_key = false;
+	}
+	else if (need_separator)
+	{
+		buffer.push_back(',');
+	}
+}
+
+void JsonWriter_Impl::write_key(const char *key, size_t length)
+{
+	if (stack.empty() || stack.back() != '{' || after_key)
+		throw JsonException("JSON key written outside an object");
+	if (need_separator)
+		buffer.push_back(',');
+	write_string(key, length);
+	buffer.push_back(':');
+	after_key = true;
+}
+
+void JsonWriter_Impl::write_string(const char *str, size_t length)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	buffer.push_back('"');
+	const char *end = str + length;
+	while (str != end)
+	{
+		const char *start = str;
+		while (str != end && *str != '"' && *str != '\\' && (unsigned char)*str >= 0x20)
+			str++;
+		buffer.append(start, str);
+		if (str == end)
+			break;
+
+		unsigned char c = *(str++);
+		buffer.push_back('\\');
+		switch (c)
+		{
+		case '"': buffer.push_back('"'); break;
+		case '\\': buffer.push_back('\\'); break;
+		case '\b': buffer.push_back('b'); break;
+		case '\f': buffer.push_back('f'); break;
+		case '\n': buffer.push_back('n'); break;
+		case '\r': buffer.push_back('r'); break;
+		case '\t': buffer.push_back('t'); break;
+		default:
+			buffer.append("u00");
+			buffer.push_back(hex[c >> 4]);
+			buffer.push_back(hex[c & 15]);
+			break;
+		}
+	}
+	buffer.push_back('"');
+}
+
+void JsonWriter_Impl::write_number(double value)
+{
+	// JSON has no representation for infinity or NaN
+	if (value != value || value - value != 0.0)
+	{
+		buffer.append("null");
+		return;
+	}
+
+	// Use the shortest precision that reads back to the same value
+	char text[64];
+#ifdef WIN32
+	_snprintf(text, 63, "%.15g", value);
+#else
+	snprintf(text, 63, "%.15g", value);
+#endif
+	text[63] = 0;
+	if (strtod(text, 0) != value)
+	{
+#ifdef WIN32
+		_snprintf(text, 63, "%.17g", value);
+#else
+		snprintf(text, 63, "%.17g", value);
+#endif
+		text[63] = 0;
+	}
+	buffer.append(text);
+}
+
+void JsonWriter_Impl::write_value(const JsonValue &value)
+{
+	switch (value.get_type())
+	{
+	case JsonValue::type_null:
+		begin_value();
+		buffer.append("null");
+		end_value();
+		break;
+	case JsonValue::type_object:
+		{
+			begin_value();
+			buffer.push_back('{');
+			stack.push_back('{');
+			need_separator = false;
+			const std::map<std::string, JsonValue> &members = value.get_members();
+			std::map<std::string, JsonValue>::const_iterator it;
+			for (it = members.begin(); it != members.end(); ++it)
+			{
+				write_key(it->first.data(), it->first.length());
+				write_value(it->second);
+			}
+			buffer.push_back('}');
+			stack.pop_back();
+			end_value();
+		}
+		break;
+	case JsonValue::type_array:
+		{
+			begin_value();
+			buffer.push_back('[');
+			stack.push_back('[');
+			need_separator = false;
+			const std::vector<JsonValue> &items = value.get_items();
+			for (size_t i = 0; i < items.size(); i++)
+				write_value(items[i]);
+			buffer.push_back(']');
+			stack.pop_back();
+			end_value();
+		}
+		break;
+	case JsonValue::type_string:
+		{
+			begin_value();
+			std::string str = value.to_string();
+			write_string(str.data(), str.length());
+			end_value();
+		}
+		break;
+	case JsonValue::type_number:
+		begin_value();
+		write_number(value.to_double());
+		end_value();
+		break;
+	case JsonValue::type_boolean:
+		begin_value();
+		buffer.append(value.to_boolean() ? "true" : "false");
+		end_value();
+		break;
+	}
+}
+
+void JsonWriter_Impl::flush()
+{
+	if (!buffer.empty())
+	{
+		device.write(buffer.data(), buffer.size());
+		buffer.clear();
+	}
+}
+
+}
@@ -0,0 +1,585 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+#include "Core/precomp.h"
+#include "xml_resource_bundle.h"
+#include "API/Core/XML/dom_named_node_map.h"
+#include "API/Core/XML/dom_text.h"
+#include "API/Core/XML/dom_cdata_section.h"
+#include "API/Core/IOData/path_help.h"
+#include "API/Core/System/databuffer.h"
+#include "API/Core/Text/string_format.h"
+#include <algorithm>
+#include <unordered_map>
+#include <set>
+
+namespace clan
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// XMLResourceBundleWriter Class:
+
+class XMLResourceBundleWriter
+{
+public:
+	XMLResourceBundleWriter(const FileSystem &fs, const std::string &base_path, bool embed_files)
+	: fs(fs), base_path(base_path), embed_files(embed_files)
+	{
+		intern(std::string());
+	}
+
+	ubyte32 intern(const std::string &str)
+	{
+		std::unordered_map<std::string, ubyte32>::iterator it = string_lookup.find(str);
+		if (it != string_lookup.end())
+			return it->second;
+		ubyte32 index = strings.size();
+		strings.push_back(str);
+		string_lookup[str] = index;
+		return index;
+	}
+
+	void write_element(const DomElement &element)
+	{
+		DomNamedNodeMap attributes = element.get_attributes();
+		unsigned long num_attributes = attributes.get_length();
+
+		nodes.push_back(DomNode::ELEMENT_NODE);
+		nodes.push_back(intern(element.get_namespace_uri()));
+		nodes.push_back(intern(element.get_node_name()));
+		nodes.push_back(num_attributes);
+		for (unsigned long i = 0; i < num_attributes; i++)
+		{
+			DomNode attribute = attributes.item(i);
+			nodes.push_back(intern(attribute.get_namespace_uri()));
+			nodes.push_back(intern(attribute.get_node_name()));
+			nodes.push_back(intern(attribute.get_node_value()));
+			if (embed_files && attribute.get_local_name() == "file")
+				add_file(attribute.get_node_value());
+		}
+
+		size_t child_count_pos = nodes.size();
+		nodes.push_back(0);
+		for (DomNode child = element.get_first_child(); !child.is_null(); child = child.get_next_sibling())
+		{
+			if (child.is_element())
+			{
+				write_element(child.to_element());
+			}
+			else if (child.is_text() || child.is_cdata_section())
+			{
+				nodes.push_back(child.get_node_type());
+				nodes.push_back(intern(child.get_node_value()));
+			}
+			else
+			{
+				continue;
+			}
+			nodes[child_count_pos]++;
+		}
+	}
+
+	void add_file(const std::string &filename)
+	{
+		// Store the path the way FileSystem::open_file passes it on to its provider. Paths are
+		// relative to the document so the bundle can be moved independently of the base path.
+		std::string path = PathHelp::make_relative("/", PathHelp::make_absolute("/", filename, PathHelp::path_type_virtual), PathHelp::path_type_virtual);
+		if (!file_paths.insert(path).second)
+			return;
+
+		DataBuffer contents;
+		try
+		{
+			IODevice file = fs.open_file(PathHelp::combine(base_path, filename), File::open_existing, File::access_read, File::share_read);
+			contents.set_size(file.get_size());
+			if (contents.get_size() > 0 && file.read(contents.get_data(), contents.get_size()) != (int) contents.get_size())
+				return;
+		}
+		catch (const Exception &)
+		{
+			// Files that cannot be embedded are left to be opened from the file system at runtime
+			return;
+		}
+
+		EmbeddedFile embedded_file;
+		embedded_file.path = path;
+		embedded_file.contents = contents;
+		files.push_back(embedded_file);
+	}
+
+	struct EmbeddedFile
+	{
+		std::string path;
+		DataBuffer contents;
+
+		bool operator<(const EmbeddedFile &other) const { return path < other.path; }
+	};
+
+	FileSystem fs;
+	std::string base_path;
+	bool embed_files;
+
+	std::vector<std::string> strings;
+	std::unordered_map<std::string, ubyte32> string_lookup;
+
+	std::vector<ubyte32> nodes;
+
+	std::set<std::string> file_paths;
+	std::vector<EmbeddedFile> files;
+};
+
+namespace
+{
+	struct LargerBucket
+	{
+		LargerBucket(const std::vector<std::vector<ubyte32> > &buckets) : buckets(buckets) { }
+		bool operator()(ubyte32 a, ubyte32 b) const { return buckets[a].size() > buckets[b].size(); }
+		const std::vector<std::vector<ubyte32> > &buckets;
+	};
+
+	void write_words(unsigned char *out, ubyte32 offset, const ubyte32 *values, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			out[offset + i * 4] = values[i] & 0xff;
+			out[offset + i * 4 + 1] = (values[i] >> 8) & 0xff;
+			out[offset + i * 4 + 2] = (values[i] >> 16) & 0xff;
+			out[offset + i * 4 + 3] = (values[i] >> 24) & 0xff;
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// XMLResourceBundle Construction:
+
+XMLResourceBundle::XMLResourceBundle(const std::string &filename)
+: data(0), size(0)
+{
+	mapped_file = std::shared_ptr<MemoryMappedFile>(new MemoryMappedFile(filename));
+	data = mapped_file->get_data();
+	if (mapped_file->get_size() < header_field_count * 4 || mapped_file->get_size() > 0xffffffff)
+		throw Exception(string_format("%1 is not a resource bundle", filename));
+	size = (ubyte32) mapped_file->get_size();
+
+	if (read_uint32(header_magic * 4) != bundle_magic)
+		throw Exception(string_format("%1 is not a resource bundle", filename));
+	if (read_uint32(header_version * 4) != bundle_version)
+		throw Exception(string_format("Unsupported resource bundle version in %1", filename));
+	if (read_uint32(header_file_size * 4) != size)
+		throw Exception(string_format("Resource bundle %1 is truncated", filename));
+
+	string_count = read_uint32(header_string_count * 4);
+	string_index_offset = read_uint32(header_string_index_offset * 4);
+	resource_count = read_uint32(header_resource_count * 4);
+	bucket_count = read_uint32(header_bucket_count * 4);
+	bucket_offset = read_uint32(header_bucket_offset * 4);
+	slot_offset = read_uint32(header_slot_offset * 4);
+	resource_offset = read_uint32(header_resource_offset * 4);
+	node_offset = read_uint32(header_node_offset * 4);
+	node_size = read_uint32(header_node_size * 4);
+	file_count = read_uint32(header_file_count * 4);
+	file_offset = read_uint32(header_file_offset * 4);
+
+	// Validate the tables once so lookups only have to check the offsets they read from them
+	const ubyte64 table_sizes[][2] =
+	{
+		{ string_index_offset, (ubyte64) string_count * 8 },
+		{ bucket_offset, (ubyte64) bucket_count * 4 },
+		{ slot_offset, (ubyte64) resource_count * 4 },
+		{ resource_offset, (ubyte64) resource_count * 12 },
+		{ node_offset, node_size },
+		{ file_offset, (ubyte64) file_count * 12 }
+	};
+	for (size_t i = 0; i < sizeof(table_sizes) / sizeof(table_sizes[0]); i++)
+	{
+		if (table_sizes[i][0] + table_sizes[i][1] > size)
+			throw_corrupt();
+	}
+	if (string_count == 0 || (resource_count > 0 && bucket_count == 0))
+		throw_corrupt();
+}
+
+XMLResourceBundle::~XMLResourceBundle()
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// XMLResourceBundle Attributes:
+
+bool XMLResourceBundle::is_bundle(IODevice &file)
+{
+	unsigned char magic[4] = { 0 };
+	if (file.peek(magic, 4) != 4)
+		return false;
+	return (magic[0] | (magic[1] << 8) | (magic[2] << 16) | (magic[3] << 24)) == bundle_magic;
+}
+
+int XMLResourceBundle::find_resource(const std::string &resource_id) const
+{
+	if (resource_count == 0)
+		return -1;
+
+	ubyte32 bucket = hash(resource_id.data(), resource_id.length(), 0) % bucket_count;
+	ubyte32 seed = read_uint32(bucket_offset + bucket * 4);
+	ubyte32 slot = hash(resource_id.data(), resource_id.length(), seed) % resource_count;
+	ubyte32 index = read_uint32(slot_offset + slot * 4);
+	if (index >= resource_count)
+		throw_corrupt();
+
+	// The hash is only perfect for ids in the bundle. Others must be rejected by comparing the id
+	const char *id_data;
+	ubyte32 id_length;
+	get_string(read_uint32(resource_offset + index * 12), id_data, id_length);
+	if (id_length != resource_id.length() || memcmp(id_data, resource_id.data(), id_length) != 0)
+		return -1;
+	return index;
+}
+
+std::string XMLResourceBundle::get_resource_id(int index) const
+{
+	return get_string(read_uint32(resource_offset + index * 12));
+}
+
+std::string XMLResourceBundle::get_resource_type(int index) const
+{
+	return get_string(read_uint32(resource_offset + index * 12 + 4));
+}
+
+std::string XMLResourceBundle::get_ns_resources() const
+{
+	return get_string(read_uint32(header_ns_resources * 4));
+}
+
+std::string XMLResourceBundle::get_root_name() const
+{
+	return get_string(read_uint32(header_root_name * 4));
+}
+
+bool XMLResourceBundle::find_file(const std::string &filename, const unsigned char *&out_data, int &out_size) const
+{
+	ubyte32 first = 0, last = file_count;
+	while (first < last)
+	{
+		ubyte32 middle = first + (last - first) / 2;
+		ubyte32 entry = file_offset + middle * 12;
+
+		const char *path_data;
+		ubyte32 path_length;
+		get_string(read_uint32(entry), path_data, path_length);
+
+		int result = memcmp(path_data, filename.data(), std::min<size_t>(path_length, filename.length()));
+		if (result == 0 && path_length != filename.length())
+			result = (path_length < filename.length()) ? -1 : 1;
+
+		if (result < 0)
+		{
+			first = middle + 1;
+		}
+		else if (result > 0)
+		{
+			last = middle;
+		}
+		else
+		{
+			ubyte32 offset = read_uint32(entry + 4);
+			ubyte32 length = read_uint32(entry + 8);
+			if ((ubyte64) offset + length > size || length > 0x7fffffff)
+				throw_corrupt();
+			out_data = data + offset;
+			out_size = length;
+			return true;
+		}
+	}
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// XMLResourceBundle Operations:
+
+DomElement XMLResourceBundle::create_element(int index, DomDocument &document) const
+{
+	ubyte32 node_pos = read_uint32(resource_offset + index * 12 + 8);
+	DomNode node = create_node(node_pos, document, 0);
+	if (!node.is_element())
+		throw_corrupt();
+	return node.to_element();
+}
+
+void XMLResourceBundle::save(
+	IODevice &file,
+	const std::string &ns_resources,
+	const std::string &root_name,
+	const std::vector<std::pair<std::string, DomElement> > &resources,
+	const FileSystem &fs,
+	const std::string &base_path,
+	bool embed_files)
+{
+	XMLResourceBundleWriter writer(fs, base_path, embed_files);
+
+	ubyte32 count = resources.size();
+	std::vector<ubyte32> resource_table;
+	resource_table.reserve(count * 3);
+	for (ubyte32 i = 0; i < count; i++)
+	{
+		if (i > 0 && !(resources[i - 1].first < resources[i].first))
+			throw Exception("Resource bundle ids must be unique and sorted");
+
+		resource_table.push_back(writer.intern(resources[i].first));
+		resource_table.push_back(writer.intern(resources[i].second.get_local_name()));
+		resource_table.push_back(writer.nodes.size() * 4);
+		writer.write_element(resources[i].second);
+	}
+
+	std::sort(writer.files.begin(), writer.files.end());
+	std::vector<ubyte32> file_paths;
+	for (size_t i = 0; i < writer.files.size(); i++)
+		file_paths.push_back(writer.intern(writer.files[i].path));
+
+	// Build a minimal perfect hash (hash and displace). Ids are distributed into buckets of about
+	// four and a displacement seed is searched per bucket, largest buckets first, that maps all
+	// ids in the bucket to free slots.
+	ubyte32 num_buckets = std::max<ubyte32>(1, (count + 3) / 4);
+	std::vector<std::vector<ubyte32> > buckets(num_buckets);
+	for (ubyte32 i = 0; i < count; i++)
+	{
+		const std::string &id = resources[i].first;
+		buckets[hash(id.data(), id.length(), 0) % num_buckets].push_back(i);
+	}
+
+	std::vector<ubyte32> bucket_order(num_buckets);
+	for (ubyte32 i = 0; i < num_buckets; i++)
+		bucket_order[i] = i;
+	std::stable_sort(bucket_order.begin(), bucket_order.end(), LargerBucket(buckets));
+
+	std::vector<ubyte32> seeds(num_buckets, 0);
+	std::vector<ubyte32> slots(count, 0xffffffff);
+	std::vector<ubyte32> bucket_slots;
+	for (ubyte32 i = 0; i < num_buckets && count > 0; i++)
+	{
+		const std::vector<ubyte32> &bucket = buckets[bucket_order[i]];
+		if (bucket.empty())
+			break;
+
+		for (ubyte32 seed = 1; ; seed++)
+		{
+			if (seed == 0x1000000)
+				throw Exception("Unable to build resource bundle hash index");
+
+			bucket_slots.clear();
+			for (size_t j = 0; j < bucket.size(); j++)
+			{
+				const std::string &id = resources[bucket[j]].first;
+				ubyte32 slot = hash(id.data(), id.length(), seed) % count;
+				if (slots[slot] != 0xffffffff || std::find(bucket_slots.begin(), bucket_slots.end(), slot) != bucket_slots.end())
+					break;
+				bucket_slots.push_back(slot);
+			}
+
+			if (bucket_slots.size() == bucket.size())
+			{
+				for (size_t j = 0; j < bucket.size(); j++)
+					slots[bucket_slots[j]] = bucket[j];
+				seeds[bucket_order[i]] = seed;
+				break;
+			}
+		}
+	}
+
+	ubyte32 header[header_field_count] = { 0 };
+	header[header_ns_resources] = writer.intern(ns_resources);
+	header[header_root_name] = writer.intern(root_name);
+
+	ubyte32 pos = header_field_count * 4;
+	header[header_magic] = bundle_magic;
+	header[header_version] = bundle_version;
+	header[header_string_count] = writer.strings.size();
+	header[header_string_index_offset] = pos;
+	pos += writer.strings.size() * 8;
+
+	std::vector<ubyte32> string_index;
+	for (size_t i = 0; i < writer.strings.size(); i++)
+	{
+		string_index.push_back(pos);
+		string_index.push_back(writer.strings[i].length());
+		pos += writer.strings[i].length();
+	}
+	pos = (pos + 3) & ~3;
+
+	header[header_resource_count] = count;
+	header[header_bucket_count] = num_buckets;
+	header[header_bucket_offset] = pos;
+	pos += num_buckets * 4;
+	header[header_slot_offset] = pos;
+	pos += count * 4;
+	header[header_resource_offset] = pos;
+	pos += count * 12;
+	header[header_node_offset] = pos;
+	header[header_node_size] = writer.nodes.size() * 4;
+	pos += writer.nodes.size() * 4;
+
+	// Node offsets in the resource table are relative to the node data
+	for (ubyte32 i = 0; i < count; i++)
+		resource_table[i * 3 + 2] += header[header_node_offset];
+
+	header[header_file_count] = writer.files.size();
+	header[header_file_offset] = pos;
+	pos += writer.files.size() * 12;
+	std::vector<ubyte32> file_table;
+	for (size_t i = 0; i < writer.files.size(); i++)
+	{
+		pos = (pos + 15) & ~15;
+		file_table.push_back(file_paths[i]);
+		file_table.push_back(pos);
+		file_table.push_back(writer.files[i].contents.get_size());
+		pos += writer.files[i].contents.get_size();
+	}
+	header[header_file_size] = pos;
+
+	// Everything is written through one buffer to avoid many small writes to the device
+	DataBuffer output(pos);
+	unsigned char *out = (unsigned char *) output.get_data();
+	memset(out, 0, pos);
+
+	write_words(out, 0, header, header_field_count);
+	write_words(out, header[header_string_index_offset], string_index.data(), string_index.size());
+	for (size_t i = 0; i < writer.strings.size(); i++)
+		memcpy(out + string_index[i * 2], writer.strings[i].data(), writer.strings[i].length());
+	write_words(out, header[header_bucket_offset], seeds.data(), seeds.size());
+	write_words(out, header[header_slot_offset], slots.data(), slots.size());
+	write_words(out, header[header_resource_offset], resource_table.data(), resource_table.size());
+	write_words(out, header[header_node_offset], writer.nodes.data(), writer.nodes.size());
+	write_words(out, header[header_file_offset], file_table.data(), file_table.size());
+	for (size_t i = 0; i < writer.files.size(); i++)
+	{
+		if (writer.files[i].contents.get_size() > 0)
+			memcpy(out + file_table[i * 3 + 1], writer.files[i].contents.get_data(), writer.files[i].contents.get_size());
+	}
+
+	file.write(output.get_data(), output.get_size());
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// XMLResourceBundle Implementation:
+
+ubyte32 XMLResourceBundle::hash(const char *data, int length, ubyte32 seed)
+{
+	// FNV-1a followed by the murmur3 finalizer to spread the bits for the modulo
+	ubyte32 h = 2166136261u ^ (seed * 0x9e3779b9u);
+	for (int i = 0; i < length; i++)
+	{
+		h ^= (unsigned char) data[i];
+		h *= 16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	return h;
+}
+
+ubyte32 XMLResourceBundle::read_uint32(ubyte32 offset) const
+{
+	if (offset > size - 4)
+		throw_corrupt();
+	const unsigned char *p = data + offset;
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((ubyte32) p[3] << 24);
+}
+
+void XMLResourceBundle::get_string(ubyte32 string_index, const char *&out_data, ubyte32 &out_length) const
+{
+	if (string_index >= string_count)
+		throw_corrupt();
+	ubyte32 offset = read_uint32(string_index_offset + string_index * 8);
+	ubyte32 length = read_uint32(string_index_offset + string_index * 8 + 4);
+	if ((ubyte64) offset + length > size)
+		throw_corrupt();
+	out_data = (const char *) data + offset;
+	out_length = length;
+}
+
+std::string XMLResourceBundle::get_string(ubyte32 string_index) const
+{
+	const char *str_data;
+	ubyte32 str_length;
+	get_string(string_index, str_data, str_length);
+	return std::string(str_data, str_length);
+}
+
+DomNode XMLResourceBundle::create_node(ubyte32 &node_pos, DomDocument &document, int depth) const
+{
+	if (node_pos < node_offset || node_pos >= node_offset + node_size || depth > 256)
+		throw_corrupt();
+
+	ubyte32 node_type = read_uint32(node_pos);
+	node_pos += 4;
+	switch (node_type)
+	{
+	case DomNode::ELEMENT_NODE:
+		{
+			std::string namespace_uri = get_string(read_uint32(node_pos));
+			std::string qualified_name = get_string(read_uint32(node_pos + 4));
+			ubyte32 num_attributes = read_uint32(node_pos + 8);
+			node_pos += 12;
+
+			DomElement element = namespace_uri.empty() ? document.create_element(qualified_name) : document.create_element_ns(namespace_uri, qualified_name);
+			for (ubyte32 i = 0; i < num_attributes; i++)
+			{
+				std::string attribute_namespace_uri = get_string(read_uint32(node_pos));
+				std::string attribute_name = get_string(read_uint32(node_pos + 4));
+				std::string attribute_value = get_string(read_uint32(node_pos + 8));
+				node_pos += 12;
+				if (attribute_namespace_uri.empty())
+					element.set_attribute(attribute_name, attribute_value);
+				else
+					element.set_attribute_ns(attribute_namespace_uri, attribute_name, attribute_value);
+			}
+
+			ubyte32 num_children = read_uint32(node_pos);
+			node_pos += 4;
+			for (ubyte32 i = 0; i < num_children; i++)
+				element.append_child(create_node(node_pos, document, depth + 1));
+			return element;
+		}
+	case DomNode::TEXT_NODE:
+		node_pos += 4;
+		return document.create_text_node(get_string(read_uint32(node_pos - 4)));
+	case DomNode::CDATA_SECTION_NODE:
+		node_pos += 4;
+		return document.create_cdata_section(get_string(read_uint32(node_pos - 4)));
+	default:
+		throw_corrupt();
+		return DomNode();
+	}
+}
+
+void XMLResourceBundle::throw_corrupt()
+{
+	throw Exception("Resource bundle is corrupt");
+}
+
+}
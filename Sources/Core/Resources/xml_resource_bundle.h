@@ -0,0 +1,173 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+#pragma once
+
+#include "API/Core/XML/dom_document.h"
+#include "API/Core/XML/dom_element.h"
+#include "API/Core/IOData/file_system.h"
+#include "API/Core/IOData/iodevice.h"
+#include "API/Core/IOData/memory_mapped_file.h"
+#include <vector>
+#include <memory>
+
+namespace clan
+{
+
+/// \brief Precompiled binary form of a XMLResourceDocument.
+///
+/// The bundle is memory mapped and resource elements are only decoded into
+/// DOM nodes when requested. All integers are stored as little endian 32 bit words.
+///
+/// Layout:
+/// - Header (see HeaderField)
+/// - String index: {offset, length} for each interned string, followed by the string data
+/// - Hash buckets: one displacement seed per bucket of the minimal perfect hash
+/// - Hash slots: the resource index for each hash slot
+/// - Resources: {id, type, node offset} sorted by id
+/// - Node data: resource elements encoded as {ELEMENT_NODE, namespace, name, attribute count,
+///   {namespace, name, value}..., child count, children...}, {TEXT_NODE, value} or {CDATA_SECTION_NODE, value}
+/// - Files: {path, data offset, data size} sorted by path, followed by the embedded file contents
+class XMLResourceBundle
+{
+/// \name Construction
+/// \{
+
+public:
+	/// \brief Maps a resource bundle file. Throws an exception if the file is not a valid bundle.
+	XMLResourceBundle(const std::string &filename);
+
+	~XMLResourceBundle();
+
+
+/// \}
+/// \name Attributes
+/// \{
+
+public:
+	/// \brief Returns true if the file starts with the resource bundle signature.
+	static bool is_bundle(IODevice &file);
+
+	int get_resource_count() const { return resource_count; }
+
+	/// \brief Returns the index of a resource, or -1 if the bundle does not contain it.
+	int find_resource(const std::string &resource_id) const;
+
+	std::string get_resource_id(int index) const;
+
+	std::string get_resource_type(int index) const;
+
+	/// \brief Namespace URI of the resources document.
+	std::string get_ns_resources() const;
+
+	/// \brief Qualified name of the document element.
+	std::string get_root_name() const;
+
+	/// \brief Finds an embedded file. Filename is relative to the resources document.
+	bool find_file(const std::string &filename, const unsigned char *&out_data, int &out_size) const;
+
+
+/// \}
+/// \name Operations
+/// \{
+
+public:
+	/// \brief Decodes the element of a resource into the document.
+	DomElement create_element(int index, DomDocument &document) const;
+
+	/// \brief Writes a resource bundle.
+	///
+	/// \param file = Output device
+	/// \param ns_resources = Namespace URI of the resources document
+	/// \param root_name = Qualified name of the document element
+	/// \param resources = Resource ids and elements, sorted by id
+	/// \param fs = File system of the resources document
+	/// \param base_path = Base path of the resources document
+	/// \param embed_files = Copy files referenced by file attributes into the bundle
+	static void save(
+		IODevice &file,
+		const std::string &ns_resources,
+		const std::string &root_name,
+		const std::vector<std::pair<std::string, DomElement> > &resources,
+		const FileSystem &fs,
+		const std::string &base_path,
+		bool embed_files);
+
+
+/// \}
+/// \name Implementation
+/// \{
+
+private:
+	XMLResourceBundle(const XMLResourceBundle &);
+	XMLResourceBundle &operator=(const XMLResourceBundle &);
+
+	enum HeaderField
+	{
+		header_magic,
+		header_version,
+		header_string_count,
+		header_string_index_offset,
+		header_resource_count,
+		header_bucket_count,
+		header_bucket_offset,
+		header_slot_offset,
+		header_resource_offset,
+		header_node_offset,
+		header_node_size,
+		header_file_count,
+		header_file_offset,
+		header_ns_resources,
+		header_root_name,
+		header_file_size,
+		header_field_count
+	};
+
+	static const ubyte32 bundle_magic = 0x42524c43; // "CLRB"
+	static const ubyte32 bundle_version = 1;
+
+	/// \brief Hash used by the perfect hash index. Seed zero selects the bucket.
+	static ubyte32 hash(const char *data, int length, ubyte32 seed);
+
+	ubyte32 read_uint32(ubyte32 offset) const;
+	void get_string(ubyte32 string_index, const char *&out_data, ubyte32 &out_length) const;
+	std::string get_string(ubyte32 string_index) const;
+	DomNode create_node(ubyte32 &node_pos, DomDocument &document, int depth) const;
+	static void throw_corrupt();
+
+	std::shared_ptr<MemoryMappedFile> mapped_file;
+	const unsigned char *data;
+	ubyte32 size;
+
+	ubyte32 string_count, string_index_offset;
+	ubyte32 resource_count, bucket_count, bucket_offset, slot_offset, resource_offset;
+	ubyte32 node_offset, node_size;
+	ubyte32 file_count, file_offset;
+/// \}
+};
+
+}
@@ -0,0 +1,152 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+#include "Core/precomp.h"
+#include "xml_resource_bundle_provider.h"
+#include "API/Core/IOData/iodevice.h"
+
+namespace clan
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// FileSystemProvider_XMLResourceBundle Construction:
+
+FileSystemProvider_XMLResourceBundle::FileSystemProvider_XMLResourceBundle(const std::shared_ptr<XMLResourceBundle> &bundle, const FileSystem &fallback_fs)
+: bundle(bundle), fallback_fs(fallback_fs)
+{
+}
+
+FileSystemProvider_XMLResourceBundle::~FileSystemProvider_XMLResourceBundle()
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// FileSystemProvider_XMLResourceBundle Attributes:
+
+std::string FileSystemProvider_XMLResourceBundle::get_path() const
+{
+	return fallback_fs.get_path();
+}
+
+std::string FileSystemProvider_XMLResourceBundle::get_identifier() const
+{
+	return "bundle:" + fallback_fs.get_identifier();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// FileSystemProvider_XMLResourceBundle Operations:
+
+IODevice FileSystemProvider_XMLResourceBundle::open_file(const std::string &filename,
+	File::OpenMode mode,
+	unsigned int access,
+	unsigned int share,
+	unsigned int flags)
+{
+	const unsigned char *data = 0;
+	int size = 0;
+	if (mode == File::open_existing && bundle->find_file(filename, data, size))
+		return IODevice(new IODeviceProvider_XMLResourceBundleFile(bundle, data, size));
+	return fallback_fs.open_file(filename, mode, access, share, flags);
+}
+
+bool FileSystemProvider_XMLResourceBundle::initialize_directory_listing(const std::string &path)
+{
+	return fallback_fs.get_provider()->initialize_directory_listing(path);
+}
+
+bool FileSystemProvider_XMLResourceBundle::next_file(DirectoryListingEntry &entry)
+{
+	return fallback_fs.get_provider()->next_file(entry);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// IODeviceProvider_XMLResourceBundleFile Construction:
+
+IODeviceProvider_XMLResourceBundleFile::IODeviceProvider_XMLResourceBundleFile(const std::shared_ptr<XMLResourceBundle> &bundle, const unsigned char *data, int size)
+: bundle(bundle), data(data), size(size), position(0)
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// IODeviceProvider_XMLResourceBundleFile Operations:
+
+int IODeviceProvider_XMLResourceBundleFile::send(const void *send_data, int len, bool send_all)
+{
+	throw Exception("Files embedded in a resource bundle are read only");
+}
+
+int IODeviceProvider_XMLResourceBundleFile::receive(void *recv_data, int len, bool receive_all)
+{
+	len = peek(recv_data, len);
+	position += len;
+	return len;
+}
+
+int IODeviceProvider_XMLResourceBundleFile::peek(void *recv_data, int len)
+{
+	int data_available = size - position;
+	if (len > data_available)
+		len = data_available;
+	memcpy(recv_data, data + position, len);
+	return len;
+}
+
+bool IODeviceProvider_XMLResourceBundleFile::seek(int requested_position, IODevice::SeekMode mode)
+{
+	int new_position = position;
+	switch (mode)
+	{
+	case IODevice::seek_set:
+		new_position = requested_position;
+		break;
+	case IODevice::seek_cur:
+		new_position += requested_position;
+		break;
+	case IODevice::seek_end:
+		new_position = size + requested_position;
+		break;
+	default:
+		return false;
+	}
+
+	if (new_position >= 0 && new_position <= size)
+	{
+		position = new_position;
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
+IODeviceProvider *IODeviceProvider_XMLResourceBundleFile::duplicate()
+{
+	return new IODeviceProvider_XMLResourceBundleFile(bundle, data, size);
+}
+
+}
@@ -0,0 +1,140 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+#pragma once
+
+#include "API/Core/IOData/file_system_provider.h"
+#include "API/Core/IOData/file_system.h"
+#include "API/Core/IOData/iodevice_provider.h"
+#include "xml_resource_bundle.h"
+
+namespace clan
+{
+
+/// \brief File source serving files embedded in a resource bundle.
+///
+/// Files not found in the bundle are opened from the fallback file system.
+class FileSystemProvider_XMLResourceBundle : public FileSystemProvider
+{
+/// \name Construction
+/// \{
+
+public:
+	FileSystemProvider_XMLResourceBundle(const std::shared_ptr<XMLResourceBundle> &bundle, const FileSystem &fallback_fs);
+
+	~FileSystemProvider_XMLResourceBundle();
+
+
+/// \}
+/// \name Attributes
+/// \{
+
+public:
+	std::string get_path() const;
+
+	std::string get_identifier() const;
+
+
+/// \}
+/// \name Operations
+/// \{
+
+public:
+	IODevice open_file(const std::string &filename,
+		File::OpenMode mode = File::open_existing,
+		unsigned int access = File::access_read | File::access_write,
+		unsigned int share = File::share_all,
+		unsigned int flags = 0);
+
+	bool initialize_directory_listing(const std::string &path);
+
+	bool next_file(DirectoryListingEntry &entry);
+
+
+/// \}
+/// \name Implementation
+/// \{
+
+private:
+	std::shared_ptr<XMLResourceBundle> bundle;
+
+	FileSystem fallback_fs;
+/// \}
+};
+
+/// \brief Read-only device for a file embedded in a memory mapped resource bundle.
+class IODeviceProvider_XMLResourceBundleFile : public IODeviceProvider
+{
+/// \name Construction
+/// \{
+
+public:
+	IODeviceProvider_XMLResourceBundleFile(const std::shared_ptr<XMLResourceBundle> &bundle, const unsigned char *data, int size);
+
+
+/// \}
+/// \name Attributes
+/// \{
+
+public:
+	int get_size() const { return size; }
+
+	int get_position() const { return position; }
+
+
+/// \}
+/// \name Operations
+/// \{
+
+public:
+	int send(const void *data, int len, bool send_all = true);
+
+	int receive(void *data, int len, bool receive_all = true);
+
+	int peek(void *data, int len);
+
+	bool seek(int position, IODevice::SeekMode mode);
+
+	IODeviceProvider *duplicate();
+
+
+/// \}
+/// \name Implementation
+/// \{
+
+private:
+	std::shared_ptr<XMLResourceBundle> bundle;
+
+	const unsigned char *data;
+
+	int size;
+
+	int position;
+/// \}
+};
+
+}
@@ -37,6 +37,7 @@
 #include "API/Core/Text/string_format.h"
 #include "API/Core/Text/string_help.h"
 #include "xml_resource_document_impl.h"
+#include "xml_resource_bundle_provider.h"
 #include <map>
 
 namespace clan
@@ -96,6 +97,9 @@ bool XMLResourceDocument::resource_exists(const std::string &resource_id) const
 	if (it != impl->resources.end())
 		return true;
 
+	if (impl->bundle && impl->bundle->find_resource(resource_id) != -1)
+		return true;
+
 	for (std::vector<XMLResourceDocument>::const_iterator it = impl->additional_resources.begin();
 		it != impl->additional_resources.end();
 		++it)
@@ -104,14 +108,20 @@ bool XMLResourceDocument::resource_exists(const std::string &resource_id) const
 	return false;
 }
 
+bool XMLResourceDocument::is_bundle() const
+{
+	return impl->bundle != 0;
+}
+
 std::vector<std::string> XMLResourceDocument::get_section_names() const
 {
 	std::vector<std::string> names;
 	std::string last_section;
-	std::map<std::string, XMLResourceNode>::const_iterator it;
-	for (it = impl->resources.begin(); it != impl->resources.end(); ++it)
+	std::vector<std::string> resource_ids = impl->get_resource_ids();
+	std::vector<std::string>::const_iterator it;
+	for (it = resource_ids.begin(); it != resource_ids.end(); ++it)
 	{
-		std::string section = PathHelp::get_fullpath(it->first, PathHelp::path_type_virtual);
+		std::string section = PathHelp::get_fullpath(*it, PathHelp::path_type_virtual);
 		if (section != last_section)
 		{
 			names.push_back(section);
@@ -137,27 +147,20 @@ std::vector<std::string> XMLResourceDocument::get_section_names() const
 
 std::vector<std::string> XMLResourceDocument::get_resource_names() const
 {
-	std::vector<std::string> names;
-	std::string last_section;
-	std::map<std::string, XMLResourceNode>::const_iterator it;
-	for (it = impl->resources.begin(); it != impl->resources.end(); ++it)
-	{
-		std::string resource_id = it->first;
-		names.push_back(resource_id);
-	}
-	return names;
+	return impl->get_resource_ids();
 }
 
 std::vector<std::string> XMLResourceDocument::get_resource_names(const std::string &section) const
 {
 	std::vector<std::string> names;
-	std::map<std::string, XMLResourceNode>::const_iterator it;
-	for (it = impl->resources.begin(); it != impl->resources.end(); ++it)
+	std::vector<std::string> resource_ids = impl->get_resource_ids();
+	std::vector<std::string>::const_iterator it;
+	for (it = resource_ids.begin(); it != resource_ids.end(); ++it)
 	{
-		std::string cur_section = PathHelp::get_basepath(it->first, PathHelp::path_type_virtual);
+		std::string cur_section = PathHelp::get_basepath(*it, PathHelp::path_type_virtual);
 		if (section == cur_section)
 		{
-			std::string name = PathHelp::get_filename(it->first, PathHelp::path_type_virtual);
+			std::string name = PathHelp::get_filename(*it, PathHelp::path_type_virtual);
 			names.push_back(name);
 		}
 	}
@@ -181,11 +184,12 @@ std::vector<std::string> XMLResourceDocument::get_resource_names(const std::stri
 std::vector<std::string> XMLResourceDocument::get_resource_names_of_type(const std::string &type) const
 {
 	std::vector<std::string> names;
-	std::map<std::string, XMLResourceNode>::const_iterator it;
-	for (it = impl->resources.begin(); it != impl->resources.end(); ++it)
+	std::vector<std::string> resource_ids = impl->get_resource_ids();
+	std::vector<std::string>::const_iterator it;
+	for (it = resource_ids.begin(); it != resource_ids.end(); ++it)
 	{
-		if (it->second.get_type() == type)
-			names.push_back(it->first);
+		if (impl->get_resource_type(*it) == type)
+			names.push_back(*it);
 	}
 	return names;
 }
@@ -198,14 +202,15 @@ std::vector<std::string> XMLResourceDocument::get_resource_names_of_type(
 	std::string section_trailing_slash = PathHelp::add_trailing_slash(section, PathHelp::path_type_virtual);
 
 	std::vector<std::string> names;
-	std::map<std::string, XMLResourceNode>::const_iterator it;
-	for (it = impl->resources.begin(); it != impl->resources.end(); ++it)
+	std::vector<std::string> resource_ids = impl->get_resource_ids();
+	std::vector<std::string>::const_iterator it;
+	for (it = resource_ids.begin(); it != resource_ids.end(); ++it)
 	{
-		std::string cur_section = PathHelp::get_fullpath(it->first, PathHelp::path_type_virtual);
+		std::string cur_section = PathHelp::get_fullpath(*it, PathHelp::path_type_virtual);
 		if (section_trailing_slash == cur_section)
 		{
-			if (it->second.get_type() == type)
-				names.push_back(it->first);
+			if (impl->get_resource_type(*it) == type)
+				names.push_back(*it);
 		}
 	}
 	return names;
@@ -220,13 +225,29 @@ XMLResourceNode XMLResourceDocument::get_resource(
 	return node;
 }
 
-XMLResourceNode XMLResourceDocument_Impl::get_resource(const std::string &resource_id) const
+XMLResourceNode XMLResourceDocument_Impl::get_resource(const std::string &resource_id)
 {
  	std::map<std::string, XMLResourceNode>::const_iterator it;
 	it = resources.find(resource_id);
 	if (it != resources.end())
 		return it->second;
 
+	if (bundle)
+	{
+		int index = bundle->find_resource(resource_id);
+		if (index != -1)
+		{
+			// Materialise the resource element at its section so the DOM stays a valid resources document
+			DomElement element = bundle->create_element(index, document);
+			get_section_element(resource_id).append_child(element);
+
+			XMLResourceDocument resource_document(self);
+			XMLResourceNode node(element, resource_document);
+			resources[resource_id] = node;
+			return node;
+		}
+	}
+
 	std::vector<XMLResourceDocument>::size_type i;
 	for (i = 0; i < additional_resources.size(); i++)
 	{
@@ -238,6 +259,96 @@ XMLResourceNode XMLResourceDocument_Impl::get_resource(const std::string &resour
 	return XMLResourceNode();
 }
 
+std::vector<std::string> XMLResourceDocument_Impl::get_resource_ids() const
+{
+	std::vector<std::string> ids;
+	if (bundle)
+	{
+		// Bundles are unbundled before resources are created or destroyed, so the bundle contains all ids
+		int count = bundle->get_resource_count();
+		ids.reserve(count);
+		for (int i = 0; i < count; i++)
+			ids.push_back(bundle->get_resource_id(i));
+	}
+	else
+	{
+		ids.reserve(resources.size());
+		std::map<std::string, XMLResourceNode>::const_iterator it;
+		for (it = resources.begin(); it != resources.end(); ++it)
+			ids.push_back(it->first);
+	}
+	return ids;
+}
+
+std::string XMLResourceDocument_Impl::get_resource_type(const std::string &resource_id)
+{
+	if (bundle)
+	{
+		int index = bundle->find_resource(resource_id);
+		if (index != -1)
+			return bundle->get_resource_type(index);
+	}
+	return get_resource(resource_id).get_type();
+}
+
+DomElement XMLResourceDocument_Impl::get_section_element(const std::string &resource_id)
+{
+	std::vector<std::string> path_elements = PathHelp::split_basepath(resource_id);
+
+	// Walk tree as deep as we can get:
+	DomElement parent = document.get_document_element();
+	DomNode cur = parent.get_first_child();
+	std::vector<std::string>::iterator path_it = path_elements.begin();
+	while (!cur.is_null() && path_it != path_elements.end())
+	{
+		if (cur.is_element() &&
+			cur.get_namespace_uri() == ns_resources &&
+			cur.get_local_name() == "section")
+		{
+			DomElement element = cur.to_element();
+			std::string name = element.get_attribute_ns(ns_resources, "name");
+			if (name == *path_it)
+			{
+				++path_it;
+				parent = element;
+				cur = cur.get_first_child();
+				continue;
+			}
+		}
+		cur = cur.get_next_sibling();
+	}
+
+	// Create any missing parent nodes:
+	std::string prefix = parent.get_prefix();
+	while (path_it != path_elements.end())
+	{
+		DomElement section = document.create_element_ns(ns_resources, prefix.empty() ? "section" : (prefix + ":section"));
+		section.set_attribute_ns(ns_resources, prefix.empty() ? "name" : (prefix + ":name"), *path_it);
+		parent.append_child(section);
+		parent = section;
+		++path_it;
+	}
+
+	return parent;
+}
+
+void XMLResourceDocument_Impl::unbundle()
+{
+	if (!bundle)
+		return;
+
+	int count = bundle->get_resource_count();
+	for (int i = 0; i < count; i++)
+	{
+		std::string resource_id = bundle->get_resource_id(i);
+		if (resources.find(resource_id) == resources.end())
+			get_resource(resource_id);
+	}
+
+	// Files embedded in the bundle stay available through the file system provider
+	bundle.reset();
+}
+
 bool XMLResourceDocument::get_boolean_resource(
 	const std::string &resource_id,
 	bool default_value) const
@@ -308,49 +419,11 @@ XMLResourceNode XMLResourceDocument::create_resource(const std::string &resource
 	if (resource_exists(resource_id))
 		throw Exception(string_format("Resource %1 already exists", resource_id));
 
-	std::vector<std::string> path_elements = PathHelp::split_basepath(resource_id);
-	std::string name = PathHelp::get_filename(resource_id);
-
-	// Walk tree as deep as we can get:
-	DomNode parent = impl->document.get_document_element();
-	DomNode cur = parent.get_first_child();
-	std::vector<std::string>::iterator path_it = path_elements.begin();
-	while (!cur.is_null() && path_it != path_elements.end())
-	{
-		if (cur.is_element() &&
-			cur.get_namespace_uri() == impl->ns_resources &&
-			cur.get_local_name() == "section")
-		{
-			DomElement element = cur.to_element();
-			std::string name = element.get_attribute_ns(impl->ns_resources, "name");
-			if (name == *path_it)
-			{
-				++path_it;
-				parent = cur;
-				cur = cur.get_first_child();
-				continue;
-			}
-		}
-		cur = cur.get_next_sibling();
-	}
+	impl->unbundle();
 
-	// Create any missing parent nodes:
+	std::string name = PathHelp::get_filename(resource_id);
+	DomElement parent = impl->get_section_element(resource_id);
 	std::string prefix = parent.get_prefix();
-	while (path_it != path_elements.end())
-	{
-		DomElement section;
-		if (prefix.empty())
-		{
-			section = impl->document.create_element_ns( impl->ns_resources, (*path_it) );
-		}
-		else
-		{
-			section = impl->document.create_element_ns( impl->ns_resources,(prefix + ":" + *path_it));
-		}
-		parent.append_child(section);
-		parent = section;
-		++path_it;
-	}
 
 	// Create node:
 	DomElement resource_node;
@@ -376,6 +449,8 @@ XMLResourceNode XMLResourceDocument::create_resource(const std::string &resource
 
 void XMLResourceDocument::destroy_resource(const std::string &resource_id)
 {
+	impl->unbundle();
+
 	std::map<std::string, XMLResourceNode>::iterator it;
 	it = impl->resources.find(resource_id);
 	if (it == impl->resources.end())
@@ -406,11 +481,80 @@ void XMLResourceDocument::save(const std::string &filename, const FileSystem &fs
 
 void XMLResourceDocument::save(IODevice file)
 {
+	impl->unbundle();
 	impl->document.save(file);
 }
 
+void XMLResourceDocument::save_bundle(const std::string &filename, bool embed_files)
+{
+	File file(filename, File::create_always, File::access_read_write);
+	save_bundle(file, embed_files);
+}
+
+void XMLResourceDocument::save_bundle(IODevice file, bool embed_files)
+{
+	std::vector<std::string> resource_ids = impl->get_resource_ids();
+	std::vector<std::pair<std::string, DomElement> > resources;
+	resources.reserve(resource_ids.size());
+	for (size_t i = 0; i < resource_ids.size(); i++)
+		resources.push_back(std::pair<std::string, DomElement>(resource_ids[i], impl->get_resource(resource_ids[i]).get_element()));
+
+	XMLResourceBundle::save(
+		file,
+		impl->ns_resources,
+		impl->document.get_document_element().get_node_name(),
+		resources,
+		impl->fs,
+		impl->base_path,
+		embed_files);
+}
+
+void XMLResourceDocument::load_bundle(const std::string &filename)
+{
+	std::shared_ptr<XMLResourceBundle> bundle(new XMLResourceBundle(filename));
+	std::string ns_resources = bundle->get_ns_resources();
+	std::string root_name = bundle->get_root_name();
+
+	DomDocument new_document;
+	DomElement document_element;
+	if (ns_resources.empty())
+	{
+		document_element = new_document.create_element(root_name);
+	}
+	else
+	{
+		document_element = new_document.create_element_ns(ns_resources, root_name);
+		std::string::size_type prefix_length = root_name.find(':');
+		document_element.set_attribute_ns(
+			"http://www.w3.org/2000/xmlns/",
+			prefix_length == std::string::npos ? std::string("xmlns") : "xmlns:" + root_name.substr(0, prefix_length),
+			ns_resources);
+	}
+	new_document.append_child(document_element);
+
+	// Embedded file paths are relative to the document, other files are opened relative to the bundle
+	FileSystem vfs(PathHelp::get_fullpath(filename, PathHelp::path_type_file));
+	impl->document = new_document;
+	impl->ns_resources = ns_resources;
+	impl->fs = FileSystem(new FileSystemProvider_XMLResourceBundle(bundle, vfs));
+	impl->base_path = std::string();
+	impl->resources.clear();
+	impl->bundle = bundle;
+	impl->self = impl;
+}
+
 void XMLResourceDocument::load(const std::string &fullname)
 {
+	{
+		File file(fullname);
+		if (XMLResourceBundle::is_bundle(file))
+		{
+			file.close();
+			load_bundle(fullname);
+			return;
+		}
+	}
+
 	std::string path = PathHelp::get_fullpath(fullname, PathHelp::path_type_file);
 	std::string filename = PathHelp::get_filename(fullname, PathHelp::path_type_file);
 	FileSystem vfs(path);
@@ -451,6 +595,7 @@ void XMLResourceDocument::load(IODevice file, const std::string &base_path, cons
 	impl->fs = fs;
 	impl->base_path = base_path;
 	impl->resources.clear();
+	impl->bundle.reset();
 
 	std::vector<std::string> section_stack;
 	std::vector<DomNode> nodes_stack;
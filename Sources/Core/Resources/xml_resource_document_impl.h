@@ -31,6 +31,7 @@
 #include "API/Core/IOData/file_system.h"
 #include "API/Core/XML/dom_document.h"
 #include "API/Core/XML/dom_element.h"
+#include "xml_resource_bundle.h"
 #include <map>
 
 namespace clan
@@ -39,7 +40,18 @@ namespace clan
 class XMLResourceDocument_Impl
 {
 public:
-	XMLResourceNode get_resource(const std::string &resource_id) const;
+	XMLResourceNode get_resource(const std::string &resource_id);
+
+	/// \brief Returns all resource ids of this document in sorted order.
+	std::vector<std::string> get_resource_ids() const;
+
+	std::string get_resource_type(const std::string &resource_id);
+
+	/// \brief Returns the section element for a resource, creating missing sections.
+	DomElement get_section_element(const std::string &resource_id);
+
+	/// \brief Decodes all resources not yet materialised from the bundle and detaches it.
+	void unbundle();
 
 	FileSystem fs;
 	std::string base_path;
@@ -51,6 +63,12 @@ public:
 	std::vector<XMLResourceDocument> additional_resources;
 
 	std::string ns_resources;
+
+	/// \brief Bundle the resources are materialised from on first access, if any.
+	std::shared_ptr<XMLResourceBundle> bundle;
+
+	/// \brief Used to give materialised resource nodes a reference back to the document.
+	std::weak_ptr<XMLResourceDocument_Impl> self;
 };
 
 }
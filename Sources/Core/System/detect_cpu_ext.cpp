@@ -55,6 +55,8 @@ bool System::detect_cpu_extension(CPU_ExtensionX86 ext)
 
 #define __cpuid(out, infoType)\
 	asm("cpuid": "=a" ((out)[0]), "=b" ((out)[1]), "=c" ((out)[2]), "=d" ((out)[3]): "a" (infoType));
+#define __cpuidex(out, infoType, subType)\
+	asm("cpuid": "=a" ((out)[0]), "=b" ((out)[1]), "=c" ((out)[2]), "=d" ((out)[3]): "a" (infoType), "c" (subType));
 #else
 
 #define __cpuid(out, infoType) \
@@ -63,11 +65,35 @@ bool System::detect_cpu_extension(CPU_ExtensionX86 ext)
 			"movl %%ebx, %1 \n" \
 			"popl %%ebx" \
 		: "=a" ((out)[0]), "=r" ((out)[1]), "=c" ((out)[2]), "=d" ((out)[3]): "a" (infoType));
+#define __cpuidex(out, infoType, subType) \
+	asm volatile(	"pushl %%ebx \n" \
+			"cpuid \n" \
+			"movl %%ebx, %1 \n" \
+			"popl %%ebx" \
+		: "=a" ((out)[0]), "=r" ((out)[1]), "=c" ((out)[2]), "=d" ((out)[3]): "a" (infoType), "c" (subType));
 
 #endif
 
 #endif
 
+// Returns true if the OS saves the AVX registers on context switches
+static bool cl_os_supports_avx()
+{
+	unsigned int cpuinfo[4] = {0};
+	__cpuid((int*)cpuinfo, 0x1);
+	if ((cpuinfo[2] & (1 << 27)) == 0) // OSXSAVE
+		return false;
+
+#if (defined(WIN32) || defined(_WIN32) || defined(_WIN64)) && !defined __MINGW32__
+	unsigned long long xcr0 = _xgetbv(0);
+#else
+	unsigned int xcr0_low, xcr0_high;
+	asm volatile(".byte 0x0f, 0x01, 0xd0" : "=a" (xcr0_low), "=d" (xcr0_high) : "c" (0));
+	unsigned long long xcr0 = xcr0_low;
+#endif
+	return (xcr0 & 6) == 6;
+}
+
 bool System::detect_cpu_extension(CPU_ExtensionPPC ext)
 {
 	throw ("Congratulations, you've just been selected to code this feature!");
@@ -182,6 +208,33 @@ bool System::detect_cpu_extension(CPU_ExtensionX86 ext)
 		__cpuid((int*)cpuinfo, 0x80000001);
 		return ((cpuinfo[2] & (1 << 16)) != 0);
 	}
+	else if(ext == avx2)
+	{
+		__cpuid((int*)cpuinfo, 0x0);
+		if(cpuinfo[0] < 0x7)
+			return false;
+
+		__cpuid((int*)cpuinfo, 0x1);
+		if((cpuinfo[2] & (1 << 28)) == 0 || !cl_os_supports_avx())
+			return false;
+
+		__cpuidex((int*)cpuinfo, 0x7, 0x0);
+		return ((cpuinfo[1] & (1 << 5)) != 0);
+	}
+	else if(ext == pclmulqdq)
+	{
+		__cpuid((int*)cpuinfo, 0x1);
+		return ((cpuinfo[2] & (1 << 1)) != 0);
+	}
+	else if(ext == sha)
+	{
+		__cpuid((int*)cpuinfo, 0x0);
+		if(cpuinfo[0] < 0x7)
+			return false;
+
+		__cpuidex((int*)cpuinfo, 0x7, 0x0);
+		return ((cpuinfo[1] & (1 << 29)) != 0);
+	}
 	return false;
 }
 
@@ -34,6 +34,9 @@
 #include "API/Core/System/thread.h"
 #include "API/Core/System/system.h"
 #include "API/Core/System/interlocked_variable.h"
+#include "API/Core/System/thread_local_storage.h"
+#include <deque>
+#include <algorithm>
 
 #undef max
 
@@ -63,32 +66,103 @@ private:
 	std::function<void()> func;
 };
 
+class WorkQueue_Impl;
+
+/// \brief Completion counter shared by the children of a parent work item
+class WorkQueueGroup
+{
+public:
+	WorkQueueGroup(WorkItem *parent, WorkPriority priority, int num_children)
+	: parent(parent), priority(priority)
+	{
+		remaining.set(num_children);
+	}
+
+	WorkItem *parent;
+	WorkPriority priority;
+	InterlockedVariable remaining;
+};
+
+class WorkQueueTask
+{
+public:
+	WorkQueueTask() : item(0), group(0) { }
+	WorkQueueTask(WorkItem *item, WorkQueueGroup *group) : item(item), group(group) { }
+
+	WorkItem *item;
+	WorkQueueGroup *group;
+};
+
+/// \brief Worker thread with its own local queue
+///
+/// The owning thread takes items from the front of its queue. Other workers steal from the back.
+class WorkQueueWorker
+{
+public:
+	WorkQueueWorker(WorkQueue_Impl *work_queue) : work_queue(work_queue) { }
+
+	static const int num_priorities = work_priority_low + 1;
+
+	WorkQueue_Impl *work_queue;
+	Thread thread;
+	Mutex mutex;
+	std::deque<WorkQueueTask> tasks[num_priorities];
+	std::vector<WorkItem *> finished_items;
+	Event work_available_event;
+};
+
 class WorkQueue_Impl : public KeepAliveObject
 {
 public:
-	WorkQueue_Impl(bool serial_queue);
+	WorkQueue_Impl(bool serial_queue, int num_threads);
 	~WorkQueue_Impl();
 
-	void queue(WorkItem *item); // transfers ownership
+	void queue(WorkItem *item, WorkPriority priority); // transfers ownership
+	void queue_batch(const std::vector<WorkItem *> &items, WorkPriority priority); // transfers ownership
+	void queue_children(WorkItem *parent, const std::vector<WorkItem *> &children, WorkPriority priority); // transfers ownership
 	void work_completed(WorkItem *item); // transfers ownership
 
 	int get_items_queued() const { return items_queued.get(); }
+	int get_num_threads() const { return num_threads; }
 
 private:
 	void process();
-	void worker_main();
+	void worker_main(WorkQueueWorker *worker);
+	void start_threads();
+
+	void push(const WorkQueueTask &task, WorkPriority priority);
+	void push_batch(const std::vector<WorkItem *> &items, WorkQueueGroup *group, WorkPriority priority);
+	bool pop_local(WorkQueueWorker *worker, WorkQueueTask &out_task);
+	bool steal(WorkQueueWorker *thief, WorkQueueTask &out_task);
+	void process_task(WorkQueueWorker *worker, const WorkQueueTask &task);
+	WorkQueueWorker *get_current_worker();
+	WorkQueueWorker *get_next_worker();
+	WorkQueueWorker *unpark_worker(WorkQueueWorker *exclude);
+	void park_worker(WorkQueueWorker *worker);
+	void remove_parked_worker(WorkQueueWorker *worker);
+	void wake_worker(WorkQueueWorker *worker);
+	void wake_idle_worker(WorkQueueWorker *exclude);
 
 	bool serial_queue;
-	std::vector<Thread> threads;
+	int num_threads;
+	std::vector<WorkQueueWorker *> workers;
 	Mutex mutex;
-	Event stop_event, work_available_event;
-	std::vector<WorkItem *> queued_items;
+	Event stop_event;
 	std::vector<WorkItem *> finished_items;
 	InterlockedVariable items_queued;
+	InterlockedVariable stopped;
+	Mutex parked_mutex;
+	std::vector<WorkQueueWorker *> parked_workers;
+	InterlockedVariable idle_workers;
+	InterlockedVariable next_worker;
+
+	static cl_tls_variable WorkQueueWorker *current_worker;
 };
 
-WorkQueue::WorkQueue(bool serial_queue)
-	: impl(new WorkQueue_Impl(serial_queue))
+cl_tls_variable WorkQueueWorker *WorkQueue_Impl::current_worker = 0;
+
+WorkQueue::WorkQueue(bool serial_queue, int num_threads)
+	: impl(new WorkQueue_Impl(serial_queue, num_threads))
 {
 }
 
@@ -96,14 +170,24 @@ WorkQueue::~WorkQueue()
 {
 }
 
-void WorkQueue::queue(WorkItem *item) // transfers ownership
+void WorkQueue::queue(WorkItem *item, WorkPriority priority) // transfers ownership
+{
+	impl->queue(item, priority);
+}
+
+void WorkQueue::queue(const std::function<void()> &func, WorkPriority priority)
+{
+	impl->queue(new WorkItemProcess(func), priority);
+}
+
+void WorkQueue::queue_batch(const std::vector<WorkItem *> &items, WorkPriority priority) // transfers ownership
 {
-	impl->queue(item);
+	impl->queue_batch(items, priority);
 }
 
-void WorkQueue::queue(const std::function<void()> &func)
+void WorkQueue::queue_children(WorkItem *parent, const std::vector<WorkItem *> &children, WorkPriority priority) // transfers ownership
 {
-	impl->queue(new WorkItemProcess(func));
+	impl->queue_children(parent, children, priority);
 }
 
 void WorkQueue::work_completed(const std::function<void()> &func)
@@ -116,42 +200,85 @@ int WorkQueue::get_items_queued() const
 	return impl->get_items_queued();
 }
 
+int WorkQueue::get_num_threads() const
+{
+	return impl->get_num_threads();
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
-WorkQueue_Impl::WorkQueue_Impl(bool serial_queue)
-	: serial_queue(serial_queue)
+WorkQueue_Impl::WorkQueue_Impl(bool serial_queue, int num_threads)
+	: serial_queue(serial_queue), num_threads(num_threads)
 {
+	if (serial_queue)
+		this->num_threads = 1;
+	else if (num_threads <= 0)
+		this->num_threads = std::max(System::get_num_cores() - 1, 1);
 }
 
 WorkQueue_Impl::~WorkQueue_Impl()
 {
+	stopped.set(1);
 	stop_event.set();
-	for (size_t i = 0; i < threads.size(); i++)
-		threads[i].join();
-	for (size_t i = 0; i < queued_items.size(); i++)
-		delete queued_items[i];
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i]->thread.join();
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		WorkQueueWorker *worker = workers[i];
+		for (int priority = 0; priority < WorkQueueWorker::num_priorities; priority++)
+		{
+			for (size_t j = 0; j < worker->tasks[priority].size(); j++)
+			{
+				const WorkQueueTask &task = worker->tasks[priority][j];
+				delete task.item;
+				if (task.group && task.group->remaining.decrement() == 0)
+				{
+					delete task.group->parent;
+					delete task.group;
+				}
+			}
+		}
+		for (size_t j = 0; j < worker->finished_items.size(); j++)
+			delete worker->finished_items[j];
+		delete worker;
+	}
+
 	for (size_t i = 0; i < finished_items.size(); i++)
 		delete finished_items[i];
 }
 
-void WorkQueue_Impl::queue(WorkItem *item) // transfers ownership
+void WorkQueue_Impl::queue(WorkItem *item, WorkPriority priority) // transfers ownership
+{
+	start_threads();
+	items_queued.increment();
+	push(WorkQueueTask(item, 0), priority);
+}
+
+void WorkQueue_Impl::queue_batch(const std::vector<WorkItem *> &items, WorkPriority priority) // transfers ownership
 {
-	if (threads.empty())
+	if (items.empty())
+		return;
+
+	start_threads();
+	for (size_t i = 0; i < items.size(); i++)
+		items_queued.increment();
+	push_batch(items, 0, priority);
+}
+
+void WorkQueue_Impl::queue_children(WorkItem *parent, const std::vector<WorkItem *> &children, WorkPriority priority) // transfers ownership
+{
+	if (children.empty())
 	{
-		int num_cores = serial_queue ? 1 : std::max(System::get_num_cores() - 1, 1);
-		for (int i = 0; i < num_cores; i++)
-		{
-			Thread thread;
-			thread.start(this, &WorkQueue_Impl::worker_main);
-			threads.push_back(thread);
-		}
+		queue(parent, priority);
+		return;
 	}
 
-	MutexSection mutex_lock(&mutex);
-	queued_items.push_back(item);
+	start_threads();
 	items_queued.increment();
-	mutex_lock.unlock();
-	work_available_event.set();
+	for (size_t i = 0; i < children.size(); i++)
+		items_queued.increment();
+	push_batch(children, new WorkQueueGroup(parent, priority, (int)children.size()), priority);
 }
 
 void WorkQueue_Impl::work_completed(WorkItem *item) // transfers ownership
@@ -163,12 +290,220 @@ void WorkQueue_Impl::work_completed(WorkItem *item) // transfers ownership
 	set_wakeup_event();
 }
 
+void WorkQueue_Impl::start_threads()
+{
+	if (workers.empty())
+	{
+		// All workers must exist before any thread starts, as they steal from each other
+		for (int i = 0; i < num_threads; i++)
+			workers.push_back(new WorkQueueWorker(this));
+		for (int i = 0; i < num_threads; i++)
+			workers[i]->thread.start(this, &WorkQueue_Impl::worker_main, workers[i]);
+	}
+}
+
+WorkQueueWorker *WorkQueue_Impl::get_current_worker()
+{
+	if (current_worker && current_worker->work_queue == this)
+		return current_worker;
+	else
+		return 0;
+}
+
+WorkQueueWorker *WorkQueue_Impl::get_next_worker()
+{
+	unsigned int index = (unsigned int)next_worker.increment();
+	return workers[index % workers.size()];
+}
+
+WorkQueueWorker *WorkQueue_Impl::unpark_worker(WorkQueueWorker *exclude)
+{
+	if (idle_workers.get() == 0)
+		return 0;
+
+	MutexSection mutex_lock(&parked_mutex);
+	for (size_t i = parked_workers.size(); i > 0; i--)
+	{
+		WorkQueueWorker *worker = parked_workers[i - 1];
+		if (worker != exclude)
+		{
+			parked_workers.erase(parked_workers.begin() + (i - 1));
+			idle_workers.decrement();
+			return worker;
+		}
+	}
+	return 0;
+}
+
+void WorkQueue_Impl::park_worker(WorkQueueWorker *worker)
+{
+	MutexSection mutex_lock(&parked_mutex);
+	parked_workers.push_back(worker);
+	idle_workers.increment();
+}
+
+void WorkQueue_Impl::remove_parked_worker(WorkQueueWorker *worker)
+{
+	if (idle_workers.get() == 0)
+		return;
+
+	MutexSection mutex_lock(&parked_mutex);
+	std::vector<WorkQueueWorker *>::iterator it = std::find(parked_workers.begin(), parked_workers.end(), worker);
+	if (it != parked_workers.end())
+	{
+		parked_workers.erase(it);
+		idle_workers.decrement();
+	}
+}
+
+void WorkQueue_Impl::wake_worker(WorkQueueWorker *worker)
+{
+	remove_parked_worker(worker);
+	worker->work_available_event.set();
+}
+
+void WorkQueue_Impl::wake_idle_worker(WorkQueueWorker *exclude)
+{
+	WorkQueueWorker *worker = unpark_worker(exclude);
+	if (worker)
+		worker->work_available_event.set();
+}
+
+void WorkQueue_Impl::push(const WorkQueueTask &task, WorkPriority priority)
+{
+	// Work from outside the pool goes to a parked worker if there is one
+	WorkQueueWorker *worker = get_current_worker();
+	bool local = (worker != 0);
+	if (!worker)
+		worker = unpark_worker(0);
+	if (!worker)
+		worker = get_next_worker();
+
+	MutexSection mutex_lock(&worker->mutex);
+	worker->tasks[priority].push_back(task);
+	mutex_lock.unlock();
+
+	wake_worker(worker);
+	if (local)
+		wake_idle_worker(worker);
+}
+
+void WorkQueue_Impl::push_batch(const std::vector<WorkItem *> &items, WorkQueueGroup *group, WorkPriority priority)
+{
+	WorkQueueWorker *local_worker = get_current_worker();
+	if (local_worker)
+	{
+		// Keep the batch local and let idle workers steal from it
+		MutexSection mutex_lock(&local_worker->mutex);
+		for (size_t i = 0; i < items.size(); i++)
+			local_worker->tasks[priority].push_back(WorkQueueTask(items[i], group));
+		mutex_lock.unlock();
+
+		for (size_t i = 1; i < items.size() && i < workers.size(); i++)
+			wake_idle_worker(local_worker);
+	}
+	else
+	{
+		// Hand out the batch in contiguous chunks, locking each worker only once
+		size_t num_chunks = std::min(items.size(), workers.size());
+		size_t chunk_start = 0;
+		for (size_t chunk = 0; chunk < num_chunks; chunk++)
+		{
+			size_t chunk_end = (items.size() * (chunk + 1)) / num_chunks;
+			WorkQueueWorker *worker = unpark_worker(0);
+			if (!worker)
+				worker = get_next_worker();
+
+			MutexSection mutex_lock(&worker->mutex);
+			for (size_t i = chunk_start; i < chunk_end; i++)
+				worker->tasks[priority].push_back(WorkQueueTask(items[i], group));
+			mutex_lock.unlock();
+
+			wake_worker(worker);
+			chunk_start = chunk_end;
+		}
+	}
+}
+
+bool WorkQueue_Impl::pop_local(WorkQueueWorker *worker, WorkQueueTask &out_task)
+{
+	MutexSection mutex_lock(&worker->mutex);
+	for (int priority = 0; priority < WorkQueueWorker::num_priorities; priority++)
+	{
+		std::deque<WorkQueueTask> &tasks = worker->tasks[priority];
+		if (!tasks.empty())
+		{
+			out_task = tasks.front();
+			tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+bool WorkQueue_Impl::steal(WorkQueueWorker *thief, WorkQueueTask &out_task)
+{
+	size_t num_workers = workers.size();
+	if (num_workers < 2)
+		return false;
+
+	size_t thief_index = 0;
+	while (workers[thief_index] != thief)
+		thief_index++;
+
+	for (size_t i = 1; i < num_workers; i++)
+	{
+		WorkQueueWorker *victim = workers[(thief_index + i) % num_workers];
+		if (!victim->mutex.try_lock())
+			continue;
+
+		for (int priority = 0; priority < WorkQueueWorker::num_priorities; priority++)
+		{
+			std::deque<WorkQueueTask> &tasks = victim->tasks[priority];
+			if (!tasks.empty())
+			{
+				out_task = tasks.back();
+				tasks.pop_back();
+				victim->mutex.unlock();
+				return true;
+			}
+		}
+		victim->mutex.unlock();
+	}
+	return false;
+}
+
+void WorkQueue_Impl::process_task(WorkQueueWorker *worker, const WorkQueueTask &task)
+{
+	task.item->process_work();
+
+	MutexSection mutex_lock(&worker->mutex);
+	worker->finished_items.push_back(task.item);
+	mutex_lock.unlock();
+	set_wakeup_event();
+
+	if (task.group && task.group->remaining.decrement() == 0)
+	{
+		push(WorkQueueTask(task.group->parent, 0), task.group->priority);
+		delete task.group;
+	}
+}
+
 void WorkQueue_Impl::process()
 {
-	MutexSection mutex_lock(&mutex);
 	std::vector<WorkItem *> items;
+
+	MutexSection mutex_lock(&mutex);
 	items.swap(finished_items);
 	mutex_lock.unlock();
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		MutexSection worker_lock(&workers[i]->mutex);
+		items.insert(items.end(), workers[i]->finished_items.begin(), workers[i]->finished_items.end());
+		workers[i]->finished_items.clear();
+	}
+
 	for (size_t i = 0; i < items.size(); i++)
 	{
 		try
@@ -186,30 +521,34 @@ void WorkQueue_Impl::process()
 	}
 }
 
-void WorkQueue_Impl::worker_main()
+void WorkQueue_Impl::worker_main(WorkQueueWorker *worker)
 {
-	while (true)
+	current_worker = worker;
+	while (stopped.get() == 0)
 	{
-		int wakeup_reason = Event::wait(stop_event, work_available_event);
-		if (wakeup_reason != 1)
-			break;
-		MutexSection mutex_lock(&mutex);
-		if (!queued_items.empty())
+		WorkQueueTask task;
+		if (pop_local(worker, task) || steal(worker, task))
 		{
-			WorkItem *item = queued_items.front();
-			queued_items.erase(queued_items.begin());
-			mutex_lock.unlock();
-			item->process_work();
-			mutex_lock.lock();
-			finished_items.push_back(item);
-			mutex_lock.unlock();
-			set_wakeup_event();
+			process_task(worker, task);
+			continue;
 		}
-		else
+
+		// Check the queues again after parking, or work pushed in between would be missed
+		worker->work_available_event.reset();
+		park_worker(worker);
+		if (pop_local(worker, task) || steal(worker, task))
 		{
-			work_available_event.reset();
+			remove_parked_worker(worker);
+			process_task(worker, task);
+			continue;
 		}
+
+		int wakeup_reason = Event::wait(stop_event, worker->work_available_event);
+		remove_parked_worker(worker);
+		if (wakeup_reason != 1)
+			break;
 	}
+	current_worker = 0;
 }
 
 }
@@ -43,6 +43,7 @@
 #include "API/Core/XML/dom_document_fragment.h"
 #include "API/Core/XML/dom_notation.h"
 #include "API/Core/XML/xpath_evaluator.h"
+#include "API/Core/XML/xpath_expression.h"
 #include "API/Core/Text/string_help.h"
 #include "API/Core/Text/string_format.h"
 #include "dom_node_generic.h"
@@ -719,8 +720,7 @@ DomString DomNode::find_prefix(const DomString &namespace_uri) const
 
 std::vector<DomNode> DomNode::select_nodes(const DomString &xpath_expression) const
 {
-	XPathEvaluator evaluator;
-	return evaluator.evaluate(xpath_expression, *this).get_node_set();
+	return XPathExpression::get_cached(xpath_expression).select_nodes(*this);
 }
 
 DomNode DomNode::select_node(const DomString &xpath_expression) const
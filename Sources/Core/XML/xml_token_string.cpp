@@ -0,0 +1,115 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Core/precomp.h"
+#include "API/Core/XML/xml_token_string.h"
+#include <cstring>
+
+namespace clan
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// XMLTokenString attributes:
+
+bool XMLTokenString::operator==(const char *text) const
+{
+	return strlen(text) == length && memcmp(data, text, length) == 0;
+}
+
+bool XMLTokenString::operator==(const std::string &text) const
+{
+	return text.length() == length && memcmp(data, text.data(), length) == 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// XMLTokenString operations:
+
+std::string XMLTokenString::to_string() const
+{
+	std::string text;
+	to_string(text);
+	return text;
+}
+
+void XMLTokenString::to_string(std::string &out_text) const
+{
+	const char *end = data + length;
+	const char *amp = escaped ? static_cast<const char *>(memchr(data, '&', length)) : 0;
+	if (amp == 0)
+	{
+		out_text.assign(data, length);
+		return;
+	}
+
+	// Replace all entities in a single pass. The replacements never produce a '&',
+	// so this gives the same result as replacing one entity type at a time.
+	out_text.clear();
+	out_text.reserve(length);
+	const char *read_pos = data;
+	while (amp)
+	{
+		out_text.append(read_pos, amp);
+
+		size_t available = end - amp;
+		if (available >= 4 && memcmp(amp, "&lt;", 4) == 0)
+		{
+			out_text.push_back('<');
+			read_pos = amp + 4;
+		}
+		else if (available >= 4 && memcmp(amp, "&gt;", 4) == 0)
+		{
+			out_text.push_back('>');
+			read_pos = amp + 4;
+		}
+		else if (available >= 5 && memcmp(amp, "&amp;", 5) == 0)
+		{
+			out_text.push_back('&');
+			read_pos = amp + 5;
+		}
+		else if (available >= 6 && memcmp(amp, "&quot;", 6) == 0)
+		{
+			out_text.push_back('"');
+			read_pos = amp + 6;
+		}
+		else if (available >= 6 && memcmp(amp, "&apos;", 6) == 0)
+		{
+			out_text.push_back('\'');
+			read_pos = amp + 6;
+		}
+		else
+		{
+			out_text.push_back('&');
+			read_pos = amp + 1;
+		}
+
+		amp = static_cast<const char *>(memchr(read_pos, '&', end - read_pos));
+	}
+	out_text.append(read_pos, end);
+}
+
+}
@@ -0,0 +1,54 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Core/precomp.h"
+#include "API/Core/XML/xml_token_view.h"
+
+namespace clan
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// XMLTokenView operations:
+
+void XMLTokenView::to_token(XMLToken &out_token) const
+{
+	out_token.type = type;
+	out_token.variant = variant;
+	name.to_string(out_token.name);
+	value.to_string(out_token.value);
+
+	// Resize rather than clear to reuse the string memory of earlier tokens
+	out_token.attributes.resize(attributes.size());
+	for (size_t i = 0; i < attributes.size(); i++)
+	{
+		attributes[i].first.to_string(out_token.attributes[i].first);
+		attributes[i].second.to_string(out_token.attributes[i].second);
+	}
+}
+
+}
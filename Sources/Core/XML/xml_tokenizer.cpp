@@ -29,12 +29,13 @@
 #include "Core/precomp.h"
 #include "API/Core/XML/xml_tokenizer.h"
 #include "API/Core/XML/xml_token.h"
-#include "API/Core/System/databuffer.h"
+#include "API/Core/XML/xml_token_view.h"
 #include "API/Core/Text/string_format.h"
 #include "API/Core/Text/string_help.h"
 #include "xml_tokenizer_generic.h"
 #include <algorithm>
 #include <utility>
+#include <cstring>
 
 namespace clan
 {
@@ -53,38 +54,34 @@ XMLTokenizer::XMLTokenizer(const XMLTokenizer &copy) : impl(copy.impl)
 XMLTokenizer::XMLTokenizer(IODevice &input) : impl(new XMLTokenizer_Impl)
 {
 	impl->input = input;
-	impl->size = input.get_size();
-	impl->pos = 0;
 
-	DataBuffer buffer(impl->size);
-	input.receive(buffer.get_data(), buffer.get_size(), true);
+	std::string::size_type size = input.get_size();
+	impl->buffer.resize(size);
+	if (size > 0)
+		input.receive(&impl->buffer[0], size, true);
 
-	StringHelp::BOMType bom_type = StringHelp::detect_bom(buffer.get_data(), buffer.get_size());
-	switch (bom_type)
-	{
-	default:
-	case StringHelp::bom_none:
-		impl->data = StringHelp::utf8_to_text(std::string(buffer.get_data(), buffer.get_size()));
-		break;
-	case StringHelp::bom_utf32_be:
-	case StringHelp::bom_utf32_le:
-		throw Exception("UTF-16 XML files not supported yet");
-		break;
-	case StringHelp::bom_utf16_be:
-	case StringHelp::bom_utf16_le:
-		throw Exception("UTF-32 XML files not supported yet");
-		break;
-	case StringHelp::bom_utf8:
-		impl->data = StringHelp::utf8_to_text(std::string(buffer.get_data()+3, buffer.get_size()-3));
-		break;
-	}
+	impl->set_data(impl->buffer.data(), impl->buffer.size());
+}
 
+XMLTokenizer::XMLTokenizer(const void *data, int size) : impl(new XMLTokenizer_Impl)
+{
+	impl->set_data(static_cast<const char *>(data), size);
 }
 
 XMLTokenizer::~XMLTokenizer()
 {
 }
 
+XMLTokenizer XMLTokenizer::create_incremental()
+{
+	XMLTokenizer tokenizer;
+	tokenizer.impl = std::shared_ptr<XMLTokenizer_Impl>(new XMLTokenizer_Impl);
+	tokenizer.impl->incremental = true;
+	tokenizer.impl->all_data_added = false;
+	tokenizer.impl->bom_checked = false;
+	return tokenizer;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // XMLTokenizer attributes:
 
@@ -98,22 +95,24 @@ void XMLTokenizer::set_eat_whitespace(bool enable)
 	impl->eat_whitespace = enable;
 }
 
+bool XMLTokenizer::is_data_needed() const
+{
+	return impl && impl->data_needed;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // XMLTokenizer operations:
 
 void XMLTokenizer::next(XMLToken *out_token)
 {
-	out_token->type = XMLToken::NULL_TOKEN;
-	out_token->variant = XMLToken::SINGLE;
-//	out_token->attributes.clear();
-	while (!out_token->attributes.empty())
-		out_token->attributes.pop_back();
-
 	if (impl)
 	{
-		if (impl->next_text_node(out_token))
-			return;
-		impl->next_tag_node(out_token);
+		impl->next_view(&impl->view);
+		impl->view.to_token(*out_token);
+	}
+	else
+	{
+		XMLTokenView().to_token(*out_token);
 	}
 }
 
@@ -124,24 +123,147 @@ XMLToken XMLTokenizer::next()
 	return token;
 }
 
+bool XMLTokenizer::next_view(XMLTokenView *out_token)
+{
+	if (impl)
+	{
+		return impl->next_view(out_token);
+	}
+	else
+	{
+		*out_token = XMLTokenView();
+		return false;
+	}
+}
+
+void XMLTokenizer::add_data(const void *data, int size)
+{
+	impl->add_data(static_cast<const char *>(data), size);
+}
+
+void XMLTokenizer::end_of_data()
+{
+	impl->end_of_data();
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // XMLTokenizer implementation:
 
-bool XMLTokenizer_Impl::next_text_node(XMLToken *out_token)
+void XMLTokenizer_Impl::set_data(const char *new_data, std::string::size_type new_size)
+{
+	std::string::size_type bom_size = get_bom_size(new_data, new_size);
+	data = new_data + bom_size;
+	size = new_size - bom_size;
+	pos = 0;
+}
+
+void XMLTokenizer_Impl::add_data(const char *new_data, std::string::size_type new_size)
+{
+	if (!incremental)
+		throw_exception("XMLTokenizer was not created for incremental data");
+	if (all_data_added)
+		throw_exception("XML data added after end of data");
+
+	// Discard everything already tokenized. This is what invalidates the token views.
+	discarded_lines += static_cast<int>(std::count(buffer.begin(), buffer.begin() + pos, '\n'));
+	buffer.erase(0, pos);
+	buffer.append(new_data, new_size);
+	data = buffer.data();
+	size = buffer.size();
+	pos = 0;
+	data_needed = false;
+	check_bom();
+}
+
+void XMLTokenizer_Impl::end_of_data()
+{
+	if (!incremental)
+		throw_exception("XMLTokenizer was not created for incremental data");
+	all_data_added = true;
+	data_needed = false;
+	check_bom();
+}
+
+void XMLTokenizer_Impl::check_bom()
+{
+	// The longest byte order mark is four bytes
+	if (!bom_checked && (size >= 4 || all_data_added))
+	{
+		buffer.erase(0, get_bom_size(buffer.data(), buffer.size()));
+		data = buffer.data();
+		size = buffer.size();
+		bom_checked = true;
+	}
+}
+
+std::string::size_type XMLTokenizer_Impl::get_bom_size(const char *data, std::string::size_type size)
+{
+	StringHelp::BOMType bom_type = StringHelp::detect_bom(data, size);
+	switch (bom_type)
+	{
+	default:
+	case StringHelp::bom_none:
+		return 0;
+	case StringHelp::bom_utf32_be:
+	case StringHelp::bom_utf32_le:
+		throw Exception("UTF-32 XML files not supported yet");
+	case StringHelp::bom_utf16_be:
+	case StringHelp::bom_utf16_le:
+		throw Exception("UTF-16 XML files not supported yet");
+	case StringHelp::bom_utf8:
+		return 3;
+	}
+}
+
+bool XMLTokenizer_Impl::next_view(XMLTokenView *out_token)
+{
+	out_token->type = XMLToken::NULL_TOKEN;
+	out_token->variant = XMLToken::SINGLE;
+	out_token->name = XMLTokenString();
+	out_token->value = XMLTokenString();
+	out_token->attributes.clear();
+	data_needed = false;
+
+	if (bom_checked)
+	{
+		std::string::size_type token_start = pos;
+		try
+		{
+			if (next_text_node(out_token) || next_tag_node(out_token))
+				return true;
+		}
+		catch (const NeedMoreData &)
+		{
+			// Read the whole token again when more data has been added
+			pos = token_start;
+			out_token->type = XMLToken::NULL_TOKEN;
+			out_token->variant = XMLToken::SINGLE;
+			out_token->attributes.clear();
+		}
+	}
+
+	data_needed = !all_data_added;
+	return false;
+}
+
+bool XMLTokenizer_Impl::next_text_node(XMLTokenView *out_token)
 {
 	while (pos < size && data[pos] != '<')
 	{
 		std::string::size_type start_pos = pos;
-		std::string::size_type end_pos = data.find('<', start_pos);
-		if (end_pos == data.npos) end_pos = size;
+		std::string::size_type end_pos = find('<', start_pos);
+		if (end_pos == std::string::npos)
+		{
+			if (!all_data_added)
+				throw NeedMoreData();
+			end_pos = size;
+		}
 		pos = end_pos;
 
-		std::string text;
-		std::string text_orig = data.substr(start_pos, end_pos-start_pos);
-		unescape(text, text_orig);
+		XMLTokenString text(data + start_pos, end_pos - start_pos, true);
 		if (eat_whitespace)
 		{
-			text = trim_whitespace(text);
+			text = trim_whitespace(start_pos, end_pos, true);
 			if (text.empty())
 				continue;
 		}
@@ -153,14 +275,14 @@ bool XMLTokenizer_Impl::next_text_node(XMLToken *out_token)
 	return false;
 }
 
-bool XMLTokenizer_Impl::next_tag_node(XMLToken *out_token)
+bool XMLTokenizer_Impl::next_tag_node(XMLTokenView *out_token)
 {
 	if (pos == size || data[pos] != '<')
 		return false;
 
 	pos++;
 	if (pos == size)
-		XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+		throw_premature_end();
 
 	// Try to early predict what sort of node it might be:
 	bool closing = (data[pos] == '/');
@@ -171,7 +293,7 @@ bool XMLTokenizer_Impl::next_tag_node(XMLToken *out_token)
 	{
 		pos++;
 		if (pos == size)
-			XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+			throw_premature_end();
 	}
 
 	if (exclamationMark) // check for cdata section, comments or doctype
@@ -182,26 +304,26 @@ bool XMLTokenizer_Impl::next_tag_node(XMLToken *out_token)
 
 	// Extract the tag name:
 	std::string::size_type start_pos = pos;
-	std::string::size_type end_pos = data.find_first_of(" \r\n\t?/>", start_pos);
-	if (end_pos == data.npos)
-		XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+	std::string::size_type end_pos = find_first_of(" \r\n\t?/>", start_pos);
+	if (end_pos == std::string::npos)
+		throw_premature_end();
 	pos = end_pos;
 
 	out_token->type = questionMark ? XMLToken::PROCESSING_INSTRUCTION_TOKEN : XMLToken::ELEMENT_TOKEN;
 	out_token->variant = closing ? XMLToken::END : XMLToken::BEGIN;
-	out_token->name = data.substr(start_pos, end_pos - start_pos);
+	out_token->name = XMLTokenString(data + start_pos, end_pos - start_pos);
 
 	if (out_token->type == XMLToken::PROCESSING_INSTRUCTION_TOKEN)
 	{
 		// Strip whitespace:
-		pos = data.find_first_not_of(" \r\n\t", pos);
-		if (pos == data.npos)
-			XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
-
-		end_pos = data.find_first_of("?", pos);
-		if (end_pos == data.npos)
-			XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
-		out_token->value = data.substr(pos, end_pos - pos);
+		pos = skip_whitespace(pos);
+		if (pos == std::string::npos)
+			throw_premature_end();
+
+		end_pos = find('?', pos);
+		if (end_pos == std::string::npos)
+			throw_premature_end();
+		out_token->value = XMLTokenString(data + pos, end_pos - pos);
 		pos = end_pos;
 	}
 	else // out_token->type == XMLToken::ELEMENT_TOKEN
@@ -210,9 +332,9 @@ bool XMLTokenizer_Impl::next_tag_node(XMLToken *out_token)
 		while (true)
 		{
 			// Strip whitespace:
-			pos = data.find_first_not_of(" \r\n\t", pos);
-			if (pos == data.npos)
-				XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+			pos = skip_whitespace(pos);
+			if (pos == std::string::npos)
+				throw_premature_end();
 
 			// End of tag, stop searching for more attributes:
 			if (data[pos] == '/' || data[pos] == '?' || data[pos] == '>')
@@ -220,58 +342,50 @@ bool XMLTokenizer_Impl::next_tag_node(XMLToken *out_token)
 
 			// Extract attribute name:
 			std::string::size_type start_pos = pos;
-			std::string::size_type end_pos = data.find_first_of(" \r\n\t=", start_pos);
-			if (end_pos == data.npos)
-				XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+			std::string::size_type end_pos = find_first_of(" \r\n\t=", start_pos);
+			if (end_pos == std::string::npos)
+				throw_premature_end();
 			pos = end_pos;
 
-			std::string attributeName = data.substr(start_pos, end_pos-start_pos);
+			XMLTokenString attributeName(data + start_pos, end_pos - start_pos);
 
 			// Find seperator:
-			pos = data.find_first_not_of(" \r\n\t", pos);
-			if (pos == data.npos || pos == size-1)
-				XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+			pos = skip_whitespace(pos);
+			if (pos == std::string::npos || pos == size-1)
+				throw_premature_end();
 			if (data[pos++] != '=')
-				XMLTokenizer_Impl::throw_exception(string_format("XML error(s), parser confused at line %1 (tag=%2, attributeName=%3)", get_line_number(), out_token->name, attributeName));
+				throw_exception(string_format("XML error(s), parser confused at line %1 (tag=%2, attributeName=%3)", get_line_number(), out_token->name.to_string(), attributeName.to_string()));
 
 			// Strip whitespace:
-			pos = data.find_first_not_of(" \r\n\t", pos);
-			if (pos == data.npos)
-				XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+			pos = skip_whitespace(pos);
+			if (pos == std::string::npos)
+				throw_premature_end();
 
 			// Extract attribute value:
-			std::string::value_type const * first_of = " \r\n\t";
-			if (data[pos] == '"')
+			if (data[pos] == '"' || data[pos] == '\'')
 			{
-				first_of = "\"";
+				char quote = data[pos];
 				pos++;
 				if (pos == size)
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+					throw_premature_end();
+
+				start_pos = pos;
+				end_pos = find(quote, start_pos);
 			}
 			else
-				if (data[pos] == '\'')
-				{
-					first_of = "'";
-					pos++;
-					if (pos == size)
-						XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
-				}
-
+			{
 				start_pos = pos;
-				end_pos = data.find_first_of(first_of, start_pos);
-				if (end_pos == data.npos)
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
-
-				std::string attributeValue;
-				std::string attributeValueOrig = data.substr(start_pos, end_pos-start_pos);
-				unescape(attributeValue, attributeValueOrig);
+				end_pos = find_first_of(" \r\n\t", start_pos);
+			}
+			if (end_pos == std::string::npos)
+				throw_premature_end();
 
-				pos = end_pos + 1;
-				if (pos == size)
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+			pos = end_pos + 1;
+			if (pos == size)
+				throw_premature_end();
 
-				// Finally apply attribute to token:
-				out_token->attributes.push_back(XMLToken::Attribute(attributeName, attributeValue));
+			// Finally apply attribute to token:
+			out_token->attributes.push_back(XMLTokenView::Attribute(attributeName, XMLTokenString(data + start_pos, end_pos - start_pos, true)));
 		}
 	}
 
@@ -281,196 +395,145 @@ bool XMLTokenizer_Impl::next_tag_node(XMLToken *out_token)
 		out_token->variant = XMLToken::SINGLE;
 		pos++;
 		if (pos == size)
-			XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+			throw_premature_end();
 	}
 
 	// Data stream should be ending now.
 	if (data[pos] != '>')
-		XMLTokenizer_Impl::throw_exception(string_format("Error in XML stream, line %1 (expected end of tag)", get_line_number()));
+		throw_exception(string_format("Error in XML stream, line %1 (expected end of tag)", get_line_number()));
 	pos++;
 
 	return true;
 }
 
-bool XMLTokenizer_Impl::next_exclamation_mark_node(XMLToken *out_token)
+bool XMLTokenizer_Impl::next_exclamation_mark_node(XMLTokenView *out_token)
 {
 	if (pos+2 >= size)
-		XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+		throw_premature_end();
 	
-	if (data.compare(pos, 2, "--") == 0) // comment block
+	if (compare(pos, "--", 2)) // comment block
 	{
 		std::string::size_type start_pos = pos+2;
-		std::string::size_type end_pos = data.find("-->", start_pos);
-		if (end_pos == data.npos)
-			XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+		std::string::size_type end_pos = find("-->", start_pos);
+		if (end_pos == std::string::npos)
+			throw_premature_end();
 		pos = end_pos+3;
 
-		std::string text;
-		std::string text_orig = data.substr(start_pos, end_pos-start_pos);
-		unescape(text, text_orig);
-		if (eat_whitespace)
-			text = trim_whitespace(text);
-
 		out_token->type = XMLToken::COMMENT_TOKEN;
 		out_token->variant = XMLToken::SINGLE;
-		out_token->value = text;
+		if (eat_whitespace)
+			out_token->value = trim_whitespace(start_pos, end_pos, true);
+		else
+			out_token->value = XMLTokenString(data + start_pos, end_pos - start_pos, true);
 		return true;
 	}
 
 	if (pos+7 >= size)
-		XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+		throw_premature_end();
 	
-	if (data.compare(pos, 7, "DOCTYPE") == 0)
+	if (compare(pos, "DOCTYPE", 7))
 	{
 		// Strip whitespace:
-		pos = data.find_first_not_of(" \r\n\t", pos+7);
-		if (pos == data.npos)
-			XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+		pos = skip_whitespace(pos+7);
+		if (pos == std::string::npos)
+			throw_premature_end();
 
 		// Find doctype name:				
 		std::string::size_type name_start = pos;
-		std::string::size_type name_end = data.find_first_of(" \r\n\t?/>", name_start);
-		if (name_end == data.npos)
-			XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+		std::string::size_type name_end = find_first_of(" \r\n\t?/>", name_start);
+		if (name_end == std::string::npos)
+			throw_premature_end();
 		pos = name_end;
 		
 		// Strip whitespace:
-		pos = data.find_first_not_of(" \r\n\t", pos);
-		if (pos == data.npos)
-			XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
-
-		std::string::size_type public_start = data.npos;
-		std::string::size_type public_end = data.npos;
-		std::string::size_type system_start = data.npos;
-		std::string::size_type system_end = data.npos;
-		std::string::size_type subset_start = data.npos;
-		std::string::size_type subset_end = data.npos;
+		pos = skip_whitespace(pos);
+		if (pos == std::string::npos)
+			throw_premature_end();
 
 		// Look for possible external id:
 		if (data[pos] != '[' && data[pos] != '>')
 		{
 			if (pos+6 >= size)
-				XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
-
-			if (data.compare(pos, 6, "SYSTEM") == 0)
-			{
-				pos+=6;
-				if (pos == size)
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+				throw_premature_end();
 
-				// Strip whitespace:
-				pos = data.find_first_not_of(" \r\n\t", pos);
-				if (pos == data.npos)
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+			int num_literals = 0;
+			if (compare(pos, "SYSTEM", 6))
+				num_literals = 1;
+			else if (compare(pos, "PUBLIC", 6))
+				num_literals = 2;
+			else
+				throw_exception(string_format("Error in XML stream, line %1 (unknown external identifier type in DOCTYPE)", get_line_number()));
 
-				// Read system literal:
-				std::string::value_type literal_char = data[pos];
-				if (literal_char != '\'' && literal_char != '"')
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+			pos+=6;
+			if (pos == size)
+				throw_premature_end();
 
-				system_start = pos+1;
-				system_end = data.find(literal_char, system_start);
-				if (system_end == data.npos)
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
-				pos = system_end + 1;
-				if (pos >= size)
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
-			}
-			else if (data.compare(pos, 6, "PUBLIC") == 0)
+			// Read public and/or system literal:
+			for (int i = 0; i < num_literals; i++)
 			{
-				pos+=6;
-				if (pos == size)
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
-
 				// Strip whitespace:
-				pos = data.find_first_not_of(" \r\n\t", pos);
-				if (pos == data.npos)
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+				pos = skip_whitespace(pos);
+				if (pos == std::string::npos)
+					throw_premature_end();
 
-				// Read public literal:
-				std::string::value_type literal_char = data[pos];
+				char literal_char = data[pos];
 				if (literal_char != '\'' && literal_char != '"')
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+					throw_premature_end();
 
-				public_start = pos+1;
-				public_end = data.find(literal_char, public_start);
-				if (public_end == data.npos)
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
-				pos = public_end + 1;
+				std::string::size_type literal_end = find(literal_char, pos+1);
+				if (literal_end == std::string::npos)
+					throw_premature_end();
+				pos = literal_end + 1;
 				if (pos >= size)
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
-
-				// Strip whitespace:
-				pos = data.find_first_not_of(" \r\n\t", pos);
-				if (pos == data.npos)
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
-
-				// Read system literal:
-				literal_char = data[pos];
-				if (literal_char != '\'' && literal_char != '"')
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
-
-				system_start = pos+1;
-				system_end = data.find(literal_char, system_start);
-				if (system_end == data.npos)
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
-				pos = system_end + 1;
-				if (pos >= size)
-					XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+					throw_premature_end();
 			}
-			else
-				XMLTokenizer_Impl::throw_exception(string_format("Error in XML stream, line %1 (unknown external identifier type in DOCTYPE)", get_line_number()));
 		
 			// Strip whitespace:
-			pos = data.find_first_not_of(" \r\n\t", pos);
-			if (pos == data.npos)
-				XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+			pos = skip_whitespace(pos);
+			if (pos == std::string::npos)
+				throw_premature_end();
 		}
 		
 		// Look for possible internal subset:
 		if (data[pos] == '[')
 		{
-			subset_start = pos + 1;
-		
 			// Search for the end of the internal subset:
 			// (to avoid parsing it, we search backwards)
-			std::string::size_type end_pos = data.find('>', pos+1);
-			if (end_pos == data.npos)
-				XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
-			
-			subset_end = data.rfind(']', end_pos);
-			if (subset_end == data.npos)
-				XMLTokenizer_Impl::throw_exception(string_format("Error in XML stream, line %1 (expected end of internal subset in DOCTYPE)", get_line_number()));
+			std::string::size_type end_pos = find('>', pos+1);
+			if (end_pos == std::string::npos)
+				throw_premature_end();
+
+			const char *subset_end = std::find(std::reverse_iterator<const char *>(data + end_pos), std::reverse_iterator<const char *>(data), ']').base();
+			if (subset_end == data)
+				throw_exception(string_format("Error in XML stream, line %1 (expected end of internal subset in DOCTYPE)", get_line_number()));
 				
 			pos = end_pos;
 		}
 		
 		// Expect DOCTYPE tag to end now:
 		if (data[pos] != '>')
-			XMLTokenizer_Impl::throw_exception(string_format("Error in XML stream, line %1 (expected end of DOCTYPE)", get_line_number()));
+			throw_exception(string_format("Error in XML stream, line %1 (expected end of DOCTYPE)", get_line_number()));
 		pos++;
 
 		out_token->type = XMLToken::DOCUMENT_TYPE_TOKEN;
 		return true;
 	}
-	else if (data.compare(pos, 7, "[CDATA[") == 0)
+	else if (compare(pos, "[CDATA[", 7))
 	{
 		std::string::size_type start_pos = pos+7;
-		std::string::size_type end_pos = data.find("]]>", start_pos);
-		if (end_pos == data.npos)
-			XMLTokenizer_Impl::throw_exception("Premature end of XML data!");
+		std::string::size_type end_pos = find("]]>", start_pos);
+		if (end_pos == std::string::npos)
+			throw_premature_end();
 		pos = end_pos+3;
 
-		std::string value = data.substr(start_pos, end_pos-start_pos);
-
 		out_token->type = XMLToken::CDATA_SECTION_TOKEN;
 		out_token->variant = XMLToken::SINGLE;
-		out_token->value = value;
+		out_token->value = XMLTokenString(data + start_pos, end_pos - start_pos);
 		return true;
 	}
 	else
 	{
-		XMLTokenizer_Impl::throw_exception(string_format("Error in XML stream at position %1", static_cast<int>(pos)));
+		throw_exception(string_format("Error in XML stream at position %1", static_cast<int>(pos)));
 		return false;
 	}
 }
@@ -480,69 +543,74 @@ void XMLTokenizer_Impl::throw_exception(const std::string &str)
 	throw Exception(str);
 }
 
+void XMLTokenizer_Impl::throw_premature_end()
+{
+	if (!all_data_added)
+		throw NeedMoreData();
+	throw_exception("Premature end of XML data!");
+}
+
 int XMLTokenizer_Impl::get_line_number()
 {
-	int line = 1;
-	std::string::size_type tmp_pos = 0;
+	std::string::size_type end_pos = std::min(pos + 1, size);
+	return 1 + discarded_lines + static_cast<int>(std::count(data, data + end_pos, '\n'));
+}
 
-	std::string::const_iterator it;
-	for( it = data.begin(); it != data.end() && tmp_pos <= pos; ++it, tmp_pos++ )
+inline std::string::size_type XMLTokenizer_Impl::find(char c, std::string::size_type start) const
+{
+	if (start >= size)
+		return std::string::npos;
+	const char *found = static_cast<const char *>(memchr(data + start, c, size - start));
+	return found ? found - data : std::string::npos;
+}
+
+inline std::string::size_type XMLTokenizer_Impl::find(const char *str, std::string::size_type start) const
+{
+	std::string::size_type length = strlen(str);
+	while (true)
 	{
-		if( (*it) == '\n' )
-			line++;
+		start = find(str[0], start);
+		if (start == std::string::npos || size - start < length)
+			return std::string::npos;
+		if (memcmp(data + start, str, length) == 0)
+			return start;
+		start++;
 	}
-
-	return line;
 }
 
-inline void XMLTokenizer_Impl::unescape(std::string &unescaped, const std::string &text)
+inline std::string::size_type XMLTokenizer_Impl::find_first_of(const char *chars, std::string::size_type start) const
 {
-	static const std::string quot("&quot;");
-	static const std::string apos("&apos;");
-	static const std::string lt("&lt;");
-	static const std::string gt("&gt;");
-	static const std::string amp("&amp;");
-
-	unescaped = text;
-	unescape(unescaped, quot, '"');
-	unescape(unescaped, apos, '\'');
-	unescape(unescaped, lt, '<');
-	unescape(unescaped, gt, '>');
-	unescape(unescaped, amp, '&');
+	std::string::size_type num_chars = strlen(chars);
+	for (std::string::size_type i = start; i < size; i++)
+	{
+		if (memchr(chars, data[i], num_chars))
+			return i;
+	}
+	return std::string::npos;
 }
 
-inline void XMLTokenizer_Impl::unescape(std::string &text, const std::string &search, std::string::value_type replace)
+inline std::string::size_type XMLTokenizer_Impl::skip_whitespace(std::string::size_type start) const
 {
-	std::string::size_type read_pos = 0;
-	std::string::size_type length = text.length();
-	std::string::size_type search_length = search.length();
-	while (true)
+	for (std::string::size_type i = start; i < size; i++)
 	{
-		std::string::size_type next_match = text.find(search, read_pos);
-		if (next_match == std::string::npos)
-			break;
-
-		std::string::size_type copy_size = length - (next_match + search_length);
-		if (copy_size > 0)
-			memcpy(&text[next_match + 1], &text[next_match + search_length], copy_size * sizeof(std::string::value_type));
-		text[next_match] = replace;
-		length -= search_length - 1;
-		read_pos = next_match + 1;
-		if (read_pos > length)
-			break;
+		if (!is_whitespace(data[i]))
+			return i;
 	}
-	text.resize(length);
+	return std::string::npos;
+}
+
+inline bool XMLTokenizer_Impl::compare(std::string::size_type start, const char *str, std::string::size_type length) const
+{
+	return size - start >= length && memcmp(data + start, str, length) == 0;
 }
 
-inline std::string XMLTokenizer_Impl::trim_whitespace(const std::string &text)
+inline XMLTokenString XMLTokenizer_Impl::trim_whitespace(std::string::size_type start, std::string::size_type end, bool escaped) const
 {
-	std::string::size_type pos_start = text.find_first_not_of(" \t\r\n");
-	if (pos_start == std::string::npos)
-		return std::string();
-	std::string::size_type pos_end = text.find_last_not_of(" \t\r\n");
-	if (pos_end == std::string::npos)
-		return std::string();
-	return text.substr(pos_start, pos_end - pos_start + 1);
+	while (start < end && is_whitespace(data[start]))
+		start++;
+	while (end > start && is_whitespace(data[end - 1]))
+		end--;
+	return XMLTokenString(data + start, end - start, escaped);
 }
 
 }
@@ -29,6 +29,7 @@
 #pragma once
 
 #include "API/Core/IOData/iodevice.h"
+#include "API/Core/XML/xml_token_view.h"
 
 namespace clan
 {
@@ -38,37 +39,70 @@ class XMLTokenizer_Impl
 /// \name Construction
 /// \{
 public:
-	XMLTokenizer_Impl() : pos(0), size(0), eat_whitespace(true) { }
+	XMLTokenizer_Impl()
+	: data(0), pos(0), size(0), eat_whitespace(true), incremental(false), all_data_added(true), data_needed(false), bom_checked(true), discarded_lines(0)
+	{
+	}
 /// \}
 
 /// \name Attributes
 /// \{
 public:
 	IODevice input;
+
+	// Data owned by the tokenizer when not reading from a caller buffer
+	std::string buffer;
+
+	const char *data;
 	std::string::size_type pos, size;
-	std::string data;
 	bool eat_whitespace;
+
+	// Incremental tokenizers wait for more data instead of failing at the end of the buffer
+	bool incremental;
+	bool all_data_added;
+	bool data_needed;
+	bool bom_checked;
+	int discarded_lines;
+
+	// Used by XMLTokenizer::next(XMLToken *)
+	XMLTokenView view;
 /// \}
 
 /// \name Operations
 /// \{
 public:
 	static void throw_exception(const std::string &str);
-	bool next_text_node(XMLToken *out_token);
-	bool next_tag_node(XMLToken *out_token);
-	bool next_exclamation_mark_node(XMLToken *out_token);
+	void throw_premature_end();
+
+	void set_data(const char *data, std::string::size_type size);
+	void add_data(const char *data, std::string::size_type size);
+	void end_of_data();
+
+	bool next_view(XMLTokenView *out_token);
+	bool next_text_node(XMLTokenView *out_token);
+	bool next_tag_node(XMLTokenView *out_token);
+	bool next_exclamation_mark_node(XMLTokenView *out_token);
 
 	// used to get the line number when there is an error in the xml file
 	int get_line_number();
-
-	void unescape(std::string &text_out, const std::string &text_in);
-	void unescape(std::string &text, const std::string &search, std::string::value_type replace);
-	std::string trim_whitespace(const std::string &text);
 /// \}
 
 /// \name Implementation
 /// \{
 private:
+	// Thrown when an incremental tokenizer reaches the end of the data added so far
+	struct NeedMoreData { };
+
+	void check_bom();
+	static std::string::size_type get_bom_size(const char *data, std::string::size_type size);
+
+	static bool is_whitespace(char c) { return c == ' ' || c == '\r' || c == '\n' || c == '\t'; }
+	std::string::size_type find(char c, std::string::size_type start) const;
+	std::string::size_type find(const char *str, std::string::size_type start) const;
+	std::string::size_type find_first_of(const char *chars, std::string::size_type start) const;
+	std::string::size_type skip_whitespace(std::string::size_type start) const;
+	bool compare(std::string::size_type start, const char *str, std::string::size_type length) const;
+	XMLTokenString trim_whitespace(std::string::size_type start, std::string::size_type end, bool escaped) const;
 /// \}
 };
 
@@ -30,6 +30,7 @@
 #include "Core/precomp.h"
 #include "API/Core/XML/xpath_evaluator.h"
 #include "API/Core/XML/xpath_exception.h"
+#include "API/Core/XML/xpath_expression.h"
 #include "API/Core/XML/dom_node.h"
 #include "xpath_evaluator_impl.h"
 #include "xpath_token.h"
@@ -58,4 +59,9 @@ XPathObject XPathEvaluator::evaluate(const std::string &expression, const DomNod
 	return result.result;
 }
 
+XPathObject XPathEvaluator::evaluate(const XPathExpression &expression, const DomNode &context_node) const
+{
+	return expression.evaluate(context_node);
+}
+
 }
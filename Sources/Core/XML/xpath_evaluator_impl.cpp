@@ -40,6 +40,8 @@
 #include "xpath_evaluator_impl.h"
 #include "xpath_token.h"
 #include "xpath_location_step.h"
+#include "dom_document_generic.h"
+#include "dom_tree_node.h"
 #include <cmath>
 #include <limits>
 
@@ -155,11 +157,12 @@ XPathEvaluateResult XPathEvaluator_Impl::evaluate(
 			predicate.pos = cur_token.pos + cur_token.length;
 			predicate.length = end_token.pos - predicate.pos;
 
+			std::string predicate_expression = expression.substr(predicate.pos, predicate.length);
 			XPathNodeSet filtered_nodes;
 			XPathNodeSet nodes = cur_operand.get_node_set();
 			for (XPathNodeSet::size_type node_index = 0, num_nodes = nodes.size(); node_index < num_nodes; node_index++)
 			{
-				if (confirm_step_predicate(nodes, node_index, predicate, expression))
+				if (confirm_step_predicate(nodes, node_index, predicate_expression))
 					filtered_nodes.push_back(nodes[node_index]);
 			}
 
@@ -1110,7 +1113,7 @@ void XPathEvaluator_Impl::evaluate_location_step(const XPathNodeSet &context, XP
 			select_nodes_descendant_or_self(context, context_node_index, steps, step_index, expression, nodes);
 		else if (steps[step_index].axis == "following")
 			select_nodes_following(context, context_node_index, steps, step_index, expression, nodes);
-		else if (steps[step_index].axis == "follwing-sibling")
+		else if (steps[step_index].axis == "following-sibling")
 			select_nodes_following_sibling(context, context_node_index, steps, step_index, expression, nodes);
 		else if (steps[step_index].axis == "namespace")
 			select_nodes_namespace(context, context_node_index, steps, step_index, expression, nodes);
@@ -1222,6 +1225,11 @@ void XPathEvaluator_Impl::select_nodes_descendant_or_self(const XPathNodeSet &co
 	XPathNodeSet nodeset;
 
 	DomNode cur_node = context[context_node_index];
+	if (!cur_node.is_null() && confirm_step_requirements(cur_node, steps[step_index], expression))
+		nodeset.push_back(cur_node);
+
+	// Walk the descendants without continuing into the siblings of the context node:
+	cur_node = cur_node.get_first_child();
 	while (!cur_node.is_null())
 	{
 		if (confirm_step_requirements(cur_node, steps[step_index], expression))
@@ -1408,9 +1416,9 @@ bool XPathEvaluator_Impl::confirm_step_requirements(const DomNode &node, const X
 	return test_passed;
 }
 
-bool XPathEvaluator_Impl::confirm_step_predicate(XPathNodeSet &context, XPathNodeSet::size_type context_node_index, const XPathLocationStep::Predicate &predicate, const std::string &expression) const
+bool XPathEvaluator_Impl::confirm_step_predicate(XPathNodeSet &context, XPathNodeSet::size_type context_node_index, const std::string &predicate_expression) const
 {
-	XPathEvaluateResult result = evaluate(expression.substr(predicate.pos, predicate.length), context, context_node_index, XPathToken());
+	XPathEvaluateResult result = evaluate(predicate_expression, context, context_node_index, XPathToken());
 	bool include_in_nodeset = false;
 	switch (result.result.get_type())
 	{
@@ -1437,10 +1445,11 @@ void XPathEvaluator_Impl::evaluate_location_step_predicates(const XPathNodeSet &
 	XPathNodeSet nodeset = context;
 	for (std::vector<XPathLocationStep::Predicate>::const_iterator pit = steps[step_index].predicates.begin(), pEnd = steps[step_index].predicates.end(); pit != pEnd; ++pit)
 	{
+		std::string predicate_expression = expression.substr(pit->pos, pit->length);
 		XPathNodeSet filtered_nodes;
 		for (XPathNodeSet::size_type node_index = 0, num_nodes = nodeset.size(); node_index < num_nodes; node_index++)
 		{
-			if (confirm_step_predicate(nodeset, node_index, *pit, expression))
+			if (confirm_step_predicate(nodeset, node_index, predicate_expression))
 				filtered_nodes.push_back(nodeset[node_index]);
 		}
 		nodeset = filtered_nodes;
@@ -1450,6 +1459,290 @@ void XPathEvaluator_Impl::evaluate_location_step_predicates(const XPathNodeSet &
 		evaluate_location_step(nodeset, node_index, steps, step_index+1, expression, nodes);
 }
 
+bool XPathEvaluator_Impl::compile_location_path(const std::string &expression, XPathLocationPath &out_path) const
+{
+	out_path = XPathLocationPath();
+
+	// Mirrors the parsing done by read_location_path and read_location_steps, but only accepts
+	// expressions consisting of a single location path with predicates that can be compiled.
+	XPathToken cur_token = read_token(expression);
+	if (cur_token.type == XPathToken::type_operator && cur_token.value.oper == XPathToken::operator_slash)
+	{
+		out_path.absolute = true;
+		cur_token = read_token(expression, cur_token);
+		if (cur_token.type == XPathToken::type_none)
+			return true;
+	}
+	else if (cur_token.type == XPathToken::type_operator && cur_token.value.oper == XPathToken::operator_double_slash)
+	{
+		out_path.absolute = true;
+	}
+
+	if (cur_token.type != XPathToken::type_axis_name &&
+		cur_token.type != XPathToken::type_name_test &&
+		cur_token.type != XPathToken::type_node_type &&
+		cur_token.type != XPathToken::type_at_sign &&
+		cur_token.type != XPathToken::type_dot &&
+		cur_token.type != XPathToken::type_double_dot &&
+		!(cur_token.type == XPathToken::type_operator && cur_token.value.oper == XPathToken::operator_double_slash))
+		return false;
+
+	while (true)
+	{
+		XPathLocationStep step;
+		cur_token = read_location_step(expression, cur_token, step);
+
+		out_path.steps.push_back(XPathLocationPath::Step());
+		if (!compile_location_step(expression, step, out_path.steps.back()))
+			return false;
+
+		XPathToken next_token = read_token(expression, cur_token);
+		if ((next_token.type == XPathToken::type_operator && next_token.value.oper == XPathToken::operator_slash) ||
+			(cur_token.type == XPathToken::type_operator && cur_token.value.oper == XPathToken::operator_double_slash))
+		{
+			if (next_token.type == XPathToken::type_operator && next_token.value.oper == XPathToken::operator_slash)
+				next_token = read_token(expression, next_token);
+			if (next_token.type == XPathToken::type_axis_name ||
+				next_token.type == XPathToken::type_name_test ||
+				next_token.type == XPathToken::type_node_type ||
+				next_token.type == XPathToken::type_at_sign ||
+				next_token.type == XPathToken::type_dot ||
+				next_token.type == XPathToken::type_double_dot)
+			{
+				cur_token = next_token;
+			}
+			else
+			{
+				break;
+			}
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	return read_token(expression, cur_token).type == XPathToken::type_none;
+}
+
+bool XPathEvaluator_Impl::compile_location_step(const std::string &expression, const XPathLocationStep &step, XPathLocationPath::Step &out_step) const
+{
+	if (step.axis == "child")
+		out_step.axis = XPathLocationPath::axis_child;
+	else if (step.axis == "attribute")
+		out_step.axis = XPathLocationPath::axis_attribute;
+	else if (step.axis == "self")
+		out_step.axis = XPathLocationPath::axis_self;
+	else if (step.axis == "parent")
+		out_step.axis = XPathLocationPath::axis_parent;
+	else if (step.axis == "descendant")
+		out_step.axis = XPathLocationPath::axis_descendant;
+	else if (step.axis == "descendant-or-self")
+		out_step.axis = XPathLocationPath::axis_descendant_or_self;
+	else
+		return false;
+
+	out_step.test_type = step.test_type;
+	out_step.test_str = step.test_str;
+	out_step.node_type = step.node_type;
+
+	for (std::vector<XPathLocationStep::Predicate>::size_type i = 0; i < step.predicates.size(); i++)
+	{
+		XPathLocationPath::Predicate predicate;
+		if (!compile_predicate(expression.substr(step.predicates[i].pos, step.predicates[i].length), predicate))
+			return false;
+		out_step.predicates.push_back(predicate);
+	}
+	return true;
+}
+
+bool XPathEvaluator_Impl::compile_predicate(const std::string &predicate_expression, XPathLocationPath::Predicate &out_predicate) const
+{
+	// Supported predicates are [number], [@name], [@name='literal'] and [@name!='literal']
+	XPathToken cur_token = read_token(predicate_expression);
+	if (cur_token.type == XPathToken::type_number)
+	{
+		out_predicate.type = XPathLocationPath::predicate_position;
+		out_predicate.position = StringHelp::text_to_double(cur_token.value.str);
+	}
+	else if (cur_token.type == XPathToken::type_at_sign)
+	{
+		cur_token = read_token(predicate_expression, cur_token);
+		if (cur_token.type != XPathToken::type_name_test)
+			return false;
+		out_predicate.type = XPathLocationPath::predicate_attribute_exists;
+		out_predicate.attribute_name = cur_token.value.str;
+
+		XPathToken next_token = read_token(predicate_expression, cur_token);
+		if (next_token.type == XPathToken::type_operator &&
+			(next_token.value.oper == XPathToken::operator_compare_equal || next_token.value.oper == XPathToken::operator_compare_not_equal))
+		{
+			out_predicate.type = (next_token.value.oper == XPathToken::operator_compare_equal) ? XPathLocationPath::predicate_attribute_equal : XPathLocationPath::predicate_attribute_not_equal;
+			cur_token = read_token(predicate_expression, next_token);
+			if (cur_token.type != XPathToken::type_literal)
+				return false;
+			out_predicate.value = cur_token.value.str;
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	return read_token(predicate_expression, cur_token).type == XPathToken::type_none;
+}
+
+void XPathEvaluator_Impl::evaluate_location_path(const XPathLocationPath &path, const DomNode &context_node, XPathNodeSet &out_nodeset) const
+{
+	DomDocument_Impl *doc_impl = (DomDocument_Impl *) context_node.impl->owner_document.lock().get();
+	unsigned int node_index = context_node.impl->node_index;
+	if (path.absolute)
+	{
+		while (doc_impl->nodes[node_index]->parent != cl_null_node_index)
+			node_index = doc_impl->nodes[node_index]->parent;
+	}
+	evaluate_path_step(doc_impl, path, 0, node_index, out_nodeset);
+}
+
+void XPathEvaluator_Impl::evaluate_path_step(DomDocument_Impl *doc_impl, const XPathLocationPath &path, std::vector<XPathLocationPath::Step>::size_type step_index, unsigned int node_index, XPathNodeSet &out_nodeset) const
+{
+	if (step_index == path.steps.size())
+	{
+		DomNode_Impl *dom_node = doc_impl->allocate_dom_node();
+		dom_node->node_index = node_index;
+		out_nodeset.push_back(DomNode(std::shared_ptr<DomNode_Impl>(dom_node, DomDocument_Impl::NodeDeleter(doc_impl))));
+		return;
+	}
+
+	// Position counters for the predicates of this step
+	std::vector<int> positions(path.steps[step_index].predicates.size(), 0);
+
+	const DomTreeNode *tree_node = doc_impl->nodes[node_index];
+	switch (path.steps[step_index].axis)
+	{
+	case XPathLocationPath::axis_child:
+		for (unsigned int child = tree_node->first_child; child != cl_null_node_index; child = doc_impl->nodes[child]->next_sibling)
+			match_path_step(doc_impl, path, step_index, child, positions, out_nodeset);
+		break;
+
+	case XPathLocationPath::axis_attribute:
+		if (tree_node->node_type == DomNode::ELEMENT_NODE)
+		{
+			for (unsigned int attribute = tree_node->first_attribute; attribute != cl_null_node_index; attribute = doc_impl->nodes[attribute]->next_sibling)
+				match_path_step(doc_impl, path, step_index, attribute, positions, out_nodeset);
+		}
+		break;
+
+	case XPathLocationPath::axis_self:
+		match_path_step(doc_impl, path, step_index, node_index, positions, out_nodeset);
+		break;
+
+	case XPathLocationPath::axis_parent:
+		if (tree_node->parent != cl_null_node_index)
+			match_path_step(doc_impl, path, step_index, tree_node->parent, positions, out_nodeset);
+		break;
+
+	case XPathLocationPath::axis_descendant_or_self:
+		match_path_step(doc_impl, path, step_index, node_index, positions, out_nodeset);
+		// Fall through to the descendants
+	case XPathLocationPath::axis_descendant:
+		{
+			unsigned int cur = tree_node->first_child;
+			while (cur != cl_null_node_index)
+			{
+				match_path_step(doc_impl, path, step_index, cur, positions, out_nodeset);
+
+				if (doc_impl->nodes[cur]->first_child != cl_null_node_index)
+				{
+					cur = doc_impl->nodes[cur]->first_child;
+				}
+				else
+				{
+					while (cur != node_index && doc_impl->nodes[cur]->next_sibling == cl_null_node_index)
+						cur = doc_impl->nodes[cur]->parent;
+					cur = (cur != node_index) ? doc_impl->nodes[cur]->next_sibling : cl_null_node_index;
+				}
+			}
+		}
+		break;
+	}
+}
+
+inline void XPathEvaluator_Impl::match_path_step(DomDocument_Impl *doc_impl, const XPathLocationPath &path, std::vector<XPathLocationPath::Step>::size_type step_index, unsigned int node_index, std::vector<int> &positions, XPathNodeSet &out_nodeset) const
+{
+	const XPathLocationPath::Step &step = path.steps[step_index];
+	const DomTreeNode *tree_node = doc_impl->nodes[node_index];
+	if (!confirm_node_test(tree_node, step))
+		return;
+
+	// The position of a node is counted among the nodes that passed the previous predicates
+	for (std::vector<XPathLocationPath::Predicate>::size_type i = 0; i < step.predicates.size(); i++)
+	{
+		positions[i]++;
+		if (!confirm_path_predicate(doc_impl, tree_node, step.predicates[i], positions[i]))
+			return;
+	}
+
+	evaluate_path_step(doc_impl, path, step_index + 1, node_index, out_nodeset);
+}
+
+inline bool XPathEvaluator_Impl::confirm_node_test(const DomTreeNode *tree_node, const XPathLocationPath::Step &step)
+{
+	switch (step.test_type)
+	{
+	default:
+	case XPathLocationStep::type_none:
+		return true;
+	case XPathLocationStep::type_name:
+		return (tree_node->node_type == DomNode::ELEMENT_NODE || tree_node->node_type == DomNode::ATTRIBUTE_NODE) && (step.test_str == "*" || tree_node->node_name == step.test_str);
+	case XPathLocationStep::type_node:
+		switch (step.node_type)
+		{
+		default:
+		case XPathToken::node_type_node:
+			return true;
+		case XPathToken::node_type_comment:
+			return tree_node->node_type == DomNode::COMMENT_NODE;
+		case XPathToken::node_type_text:
+			return tree_node->node_type == DomNode::TEXT_NODE;
+		case XPathToken::node_type_processing_instruction:
+			return tree_node->node_type == DomNode::PROCESSING_INSTRUCTION_NODE;
+		}
+	}
+}
+
+inline bool XPathEvaluator_Impl::confirm_path_predicate(DomDocument_Impl *doc_impl, const DomTreeNode *tree_node, const XPathLocationPath::Predicate &predicate, int position)
+{
+	if (predicate.type == XPathLocationPath::predicate_position)
+		return predicate.position == position;
+
+	if (tree_node->node_type != DomNode::ELEMENT_NODE)
+		return false;
+
+	for (unsigned int attribute = tree_node->first_attribute; attribute != cl_null_node_index; attribute = doc_impl->nodes[attribute]->next_sibling)
+	{
+		const DomTreeNode *attribute_node = doc_impl->nodes[attribute];
+		if (predicate.attribute_name == "*" || attribute_node->node_name == predicate.attribute_name)
+		{
+			switch (predicate.type)
+			{
+			default:
+			case XPathLocationPath::predicate_attribute_exists:
+				return true;
+			case XPathLocationPath::predicate_attribute_equal:
+				if (attribute_node->node_value == predicate.value)
+					return true;
+				break;
+			case XPathLocationPath::predicate_attribute_not_equal:
+				if (attribute_node->node_value != predicate.value)
+					return true;
+				break;
+			}
+		}
+	}
+	return false;
+}
+
 XPathToken XPathEvaluator_Impl::read_token(
 	const std::string &expression,
 	const XPathToken &previous_token) const
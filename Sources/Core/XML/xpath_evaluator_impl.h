@@ -32,10 +32,14 @@
 #include "API/Core/XML/xpath_object.h"
 #include "xpath_token.h"
 #include "xpath_location_step.h"
+#include "xpath_location_path.h"
 
 namespace clan
 {
 
+class DomDocument_Impl;
+class DomTreeNode;
+
 class XPathEvaluateResult
 {
 public:
@@ -55,6 +59,9 @@ public:
 		XPathNodeSet::size_type context_node_index,
 		XPathToken prev_token) const;
 
+	bool compile_location_path(const std::string &expression, XPathLocationPath &out_path) const;
+	void evaluate_location_path(const XPathLocationPath &path, const DomNode &context_node, XPathNodeSet &out_nodeset) const;
+
 private:
 	typedef XPathToken::Operator Operator;
 	typedef XPathObject Operand;
@@ -120,7 +127,14 @@ private:
 	void select_nodes_preceding_sibling(const XPathNodeSet &context, XPathNodeSet::size_type context_node_index, const std::vector<XPathLocationStep> &steps, std::vector<XPathLocationStep>::size_type step_index, const std::string &expression, XPathNodeSet &out_nodeset) const;
 	void select_nodes_self(const XPathNodeSet &context, XPathNodeSet::size_type context_node_index, const std::vector<XPathLocationStep> &steps, std::vector<XPathLocationStep>::size_type step_index, const std::string &expression, XPathNodeSet &out_nodeset) const;
 	bool confirm_step_requirements(const DomNode &node, const XPathLocationStep &step, const std::string &expression) const;
-	bool confirm_step_predicate(XPathNodeSet &context, XPathNodeSet::size_type context_node_index, const XPathLocationStep::Predicate &predicate, const std::string &expression) const;
+	bool confirm_step_predicate(XPathNodeSet &context, XPathNodeSet::size_type context_node_index, const std::string &predicate_expression) const;
+
+	bool compile_location_step(const std::string &expression, const XPathLocationStep &step, XPathLocationPath::Step &out_step) const;
+	bool compile_predicate(const std::string &predicate_expression, XPathLocationPath::Predicate &out_predicate) const;
+	void evaluate_path_step(DomDocument_Impl *doc_impl, const XPathLocationPath &path, std::vector<XPathLocationPath::Step>::size_type step_index, unsigned int node_index, XPathNodeSet &out_nodeset) const;
+	void match_path_step(DomDocument_Impl *doc_impl, const XPathLocationPath &path, std::vector<XPathLocationPath::Step>::size_type step_index, unsigned int node_index, std::vector<int> &positions, XPathNodeSet &out_nodeset) const;
+	static bool confirm_node_test(const DomTreeNode *tree_node, const XPathLocationPath::Step &step);
+	static bool confirm_path_predicate(DomDocument_Impl *doc_impl, const DomTreeNode *tree_node, const XPathLocationPath::Predicate &predicate, int position);
 
 	XPathObject call_function(const XPathNodeSet& context, XPathNodeSet::size_type context_node_index, const std::string &name, const std::vector<XPathObject> &parameters) const;
 	XPathObject get_variable(const std::string &name) const;
@@ -0,0 +1,200 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Core/precomp.h"
+#include "API/Core/XML/xpath_expression.h"
+#include "API/Core/XML/xpath_exception.h"
+#include "API/Core/XML/dom_node.h"
+#include "API/Core/System/mutex.h"
+#include "xpath_evaluator_impl.h"
+#include <list>
+#include <unordered_map>
+
+namespace clan
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// XPathExpression_Impl Class:
+
+class XPathExpression_Impl
+{
+public:
+	XPathExpression_Impl(const std::string &expression)
+	: expression(expression), is_location_path(false)
+	{
+		try
+		{
+			is_location_path = evaluator.compile_location_path(expression, location_path);
+		}
+		catch (const Exception &)
+		{
+			// Syntax errors are reported when the expression is evaluated
+			is_location_path = false;
+		}
+	}
+
+	std::string expression;
+	bool is_location_path;
+	XPathLocationPath location_path;
+	XPathEvaluator_Impl evaluator;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// XPathExpressionCache Class:
+
+class XPathExpressionCache
+{
+public:
+	XPathExpressionCache() : max_expressions(256) { }
+
+	XPathExpression get(const std::string &expression)
+	{
+		MutexSection mutex_lock(&mutex);
+		ExpressionMap::iterator it = expressions.find(expression);
+		if (it != expressions.end())
+		{
+			lru_list.splice(lru_list.begin(), lru_list, it->second);
+			return *it->second;
+		}
+		mutex_lock.unlock();
+
+		XPathExpression compiled(expression);
+
+		mutex_lock.lock();
+		if (expressions.find(expression) == expressions.end())
+		{
+			lru_list.push_front(compiled);
+			expressions[expression] = lru_list.begin();
+			trim();
+		}
+		return compiled;
+	}
+
+	void set_max_expressions(int new_max_expressions)
+	{
+		MutexSection mutex_lock(&mutex);
+		max_expressions = new_max_expressions;
+		trim();
+	}
+
+	static XPathExpressionCache &instance()
+	{
+		static XPathExpressionCache cache;
+		return cache;
+	}
+
+private:
+	void trim()
+	{
+		while (!lru_list.empty() && (int)lru_list.size() > max_expressions)
+		{
+			expressions.erase(lru_list.back().get_expression());
+			lru_list.pop_back();
+		}
+	}
+
+	typedef std::unordered_map<std::string, std::list<XPathExpression>::iterator> ExpressionMap;
+
+	Mutex mutex;
+	int max_expressions;
+	std::list<XPathExpression> lru_list;
+	ExpressionMap expressions;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// XPathExpression Construction:
+
+XPathExpression::XPathExpression()
+{
+}
+
+XPathExpression::XPathExpression(const std::string &expression)
+: impl(new XPathExpression_Impl(expression))
+{
+}
+
+XPathExpression XPathExpression::get_cached(const std::string &expression)
+{
+	return XPathExpressionCache::instance().get(expression);
+}
+
+void XPathExpression::set_cache_size(int max_expressions)
+{
+	XPathExpressionCache::instance().set_max_expressions(max_expressions);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// XPathExpression Attributes:
+
+const std::string &XPathExpression::get_expression() const
+{
+	if (!impl)
+		throw Exception("XPathExpression is null");
+	return impl->expression;
+}
+
+bool XPathExpression::is_location_path() const
+{
+	return impl && impl->is_location_path;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// XPathExpression Operations:
+
+XPathObject XPathExpression::evaluate(const DomNode &context_node) const
+{
+	if (!impl)
+		throw Exception("XPathExpression is null");
+
+	if (impl->is_location_path && !context_node.is_null())
+	{
+		std::vector<DomNode> nodes;
+		impl->evaluator.evaluate_location_path(impl->location_path, context_node, nodes);
+		return XPathObject(nodes);
+	}
+
+	XPathToken prev_token;
+	std::vector<DomNode> nodelist(1, context_node);
+	XPathEvaluateResult result = impl->evaluator.evaluate(impl->expression, nodelist, 0, prev_token);
+	if (result.next_token.type != XPathToken::type_none)
+		throw XPathException("Expected end of expression", impl->expression, result.next_token);
+	return result.result;
+}
+
+std::vector<DomNode> XPathExpression::select_nodes(const DomNode &context_node) const
+{
+	if (impl && impl->is_location_path && !context_node.is_null())
+	{
+		std::vector<DomNode> nodes;
+		impl->evaluator.evaluate_location_path(impl->location_path, context_node, nodes);
+		return nodes;
+	}
+	return evaluate(context_node).get_node_set();
+}
+
+}
@@ -0,0 +1,85 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "xpath_token.h"
+#include "xpath_location_step.h"
+
+namespace clan
+{
+
+/// \brief Location path compiled from an XPath expression
+class XPathLocationPath
+{
+public:
+	XPathLocationPath()
+	: absolute(false)
+	{
+	}
+
+	enum Axis
+	{
+		axis_child,
+		axis_attribute,
+		axis_self,
+		axis_parent,
+		axis_descendant,
+		axis_descendant_or_self
+	};
+
+	enum PredicateType
+	{
+		predicate_position,
+		predicate_attribute_exists,
+		predicate_attribute_equal,
+		predicate_attribute_not_equal
+	};
+
+	struct Predicate
+	{
+		PredicateType type;
+		double position;
+		std::string attribute_name;
+		std::string value;
+	};
+
+	struct Step
+	{
+		Axis axis;
+		XPathLocationStep::TestType test_type;
+		std::string test_str;
+		XPathToken::NodeType node_type;
+		std::vector<Predicate> predicates;
+	};
+
+	bool absolute;
+	std::vector<Step> steps;
+};
+
+}
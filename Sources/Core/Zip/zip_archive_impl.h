@@ -31,6 +31,8 @@
 #include "API/Core/Zip/zip_file_entry.h"
 #include "API/Core/IOData/iodevice.h"
 #include "zip_flags.h"
+#include "API/Core/IOData/memory_mapped_file.h"
+#include <unordered_map>
 
 namespace clan
 {
@@ -50,26 +52,33 @@ public:
 public:
 	std::vector<ZipFileEntry> files;
 
+	/// \brief Maps archive filenames (without leading slash) to their index in files.
+	std::unordered_map<std::string, int> file_index;
+
 	IODevice input;
 
+	/// \brief Memory mapping of the archive, if it was opened from a filename.
+	std::shared_ptr<MemoryMappedFile> mapped_file;
+
 
 /// \}
 /// \name Operations
 /// \{
 
 public:
-	static ubyte32 calc_crc32(const void *data, byte64 size, ubyte32 crc = ZIP_CRC_START_VALUE, bool last_block = true);
+	/// \brief Returns the index of a file in files, or -1 if not found.
+	int find_file(const std::string &filename);
 
-	static void calc_time_and_date(byte16 &out_date, byte16 &out_time);
+	/// \brief Rebuilds file_index from files.
+	void build_file_index();
 
+	/// \brief Returns the archive filename in the form used as key in file_index.
+	static std::string get_index_name(const std::string &archive_filename);
 
-/// \}
-/// \name Implementation
-/// \{
+	static ubyte32 calc_crc32(const void *data, byte64 size, ubyte32 crc = ZIP_CRC_START_VALUE, bool last_block = true);
+
+	static void calc_time_and_date(byte16 &out_date, byte16 &out_time);
 
-private:
-	// crc32_table_quotient = 0xdebb20e3
-	static ubyte32 crc32_table[256];
 /// \}
 };
 
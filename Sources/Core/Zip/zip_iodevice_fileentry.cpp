@@ -42,14 +42,19 @@ namespace clan
 // ZipIODevice_FileEntry construction:
 
 ZipIODevice_FileEntry::ZipIODevice_FileEntry(IODevice iodevice, const ZipFileEntry &entry)
-: iodevice(iodevice), file_entry(entry), zstream_open(false), peeked_data(0)
+: iodevice(iodevice), file_entry(entry), peeked_data(0)
+{
+	init();
+}
+
+ZipIODevice_FileEntry::ZipIODevice_FileEntry(const std::shared_ptr<MemoryMappedFile> &mapped_file, const ZipFileEntry &entry)
+: mapped_file(mapped_file), file_entry(entry), peeked_data(0)
 {
 	init();
 }
 
 ZipIODevice_FileEntry::~ZipIODevice_FileEntry()
 {
-	deinit();
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -62,7 +67,7 @@ int ZipIODevice_FileEntry::get_size() const
 
 int ZipIODevice_FileEntry::get_position() const
 {
-	return (int) pos;
+	return (int) (pos - peeked_data.get_size());
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -126,33 +131,51 @@ bool ZipIODevice_FileEntry::seek(int seek_pos, IODevice::SeekMode mode)
 		break;
 
 	case IODevice::seek_cur:
- 		absolute_pos = pos + seek_pos;
+ 		absolute_pos = pos - peeked_data.get_size() + seek_pos;
 		break;
 
 	case IODevice::seek_end:
 		absolute_pos = file_header.uncompressed_size + seek_pos;
 		break;
 	}
+	absolute_pos = clamp(absolute_pos, (byte64)0, (byte64)file_header.uncompressed_size);
 
 	switch (file_header.compression_method)
 	{
 	case zip_compress_store: // no compression
-		iodevice.seek(int(absolute_pos-pos), IODevice::seek_cur);
+		peeked_data.set_size(0);
+		if (!mapped_file)
+			iodevice.seek(int(data_offset + absolute_pos), IODevice::seek_set);
+		pos = absolute_pos;
 		break;
 
 	case zip_compress_deflate:
-		// if backward seeking, restart at beginning of stream.
-		if (absolute_pos < pos)
 		{
-			deinit();
-			init();
-		}
+			peeked_data.set_size(0);
 
-		char buffer[1024];
-		while (absolute_pos > pos)
-		{
-			int received = receive(buffer, int(min(absolute_pos-pos, (byte64)1024)), true);
-			if (received == 0) break;
+			// Find the last checkpoint before the seek target:
+			const InflateCheckpoint *checkpoint = 0;
+			for (size_t i = checkpoints.size(); i > 0; i--)
+			{
+				if (checkpoints[i-1].pos <= absolute_pos)
+				{
+					checkpoint = &checkpoints[i-1];
+					break;
+				}
+			}
+
+			// Resume from the checkpoint if it is closer than the current position.
+			// If backward seeking without a checkpoint, restart at beginning of stream.
+			if (checkpoint && (absolute_pos < pos || checkpoint->pos > pos))
+				restore_checkpoint(*checkpoint);
+			else if (absolute_pos < pos)
+				init();
+
+			while (absolute_pos > pos)
+			{
+				if (inflate_read(0, int(min(absolute_pos-pos, (byte64)checkpoint_interval))) == 0)
+					break;
+			}
 		}
 		break;
 
@@ -172,8 +195,10 @@ bool ZipIODevice_FileEntry::seek(int seek_pos, IODevice::SeekMode mode)
 
 IODeviceProvider *ZipIODevice_FileEntry::duplicate()
 {
-	ZipIODevice_FileEntry *new_provider = new ZipIODevice_FileEntry(this, file_entry);
-	return new_provider;
+	if (mapped_file)
+		return new ZipIODevice_FileEntry(mapped_file, file_entry);
+	else
+		return new ZipIODevice_FileEntry(iodevice.duplicate(), file_entry);
 }
 
 
@@ -182,38 +207,62 @@ IODeviceProvider *ZipIODevice_FileEntry::duplicate()
 
 void ZipIODevice_FileEntry::init()
 {
-	iodevice.seek(file_entry.impl->record.relative_offset_of_local_header, IODevice::seek_set);
-	file_header.load(iodevice);
-
-	//This fix allows OS X created .zips to be opened - SAR
-	if (file_header.general_purpose_bit_flag  & ZIP_CRC32_IN_FILE_DESCRIPTOR) //if this bit is set, it means the local header data for sizes was not
+	if (mapped_file)
+	{
+		// Only the variable field lengths are needed from the local header.
+		// The remaining attributes are taken from the central directory record.
+		ZipFileHeader &record = file_entry.impl->record;
+		byte64 header_offset = (ubyte32) record.relative_offset_of_local_header;
+		const unsigned char *header = mapped_file->get_data() + header_offset;
+		if (header_offset + 30 > mapped_file->get_size() || header[0] != 0x50 || header[1] != 0x4b || header[2] != 0x03 || header[3] != 0x04)
+			throw Exception("Incorrect Local File Header signature");
+
+		int file_name_length = header[26] | (header[27] << 8);
+		int extra_field_length = header[28] | (header[29] << 8);
+		data_offset = header_offset + 30 + file_name_length + extra_field_length;
+
+		file_header.general_purpose_bit_flag = record.general_purpose_bit_flag;
+		file_header.compression_method = record.compression_method;
+		file_header.crc32 = record.crc32;
+		file_header.compressed_size = record.compressed_size;
+		file_header.uncompressed_size = record.uncompressed_size;
+
+		if (data_offset + (ubyte32) file_header.compressed_size > mapped_file->get_size())
+			throw Exception("Zip file entry data exceeds the size of the archive");
+	}
+	else
 	{
-		//the correct size data is not in the local header.. luckily, we have a real copy from the entry database
-		file_header.compressed_size = file_entry.get_compressed_size();
-		file_header.uncompressed_size = file_entry.get_uncompressed_size();
+		iodevice.seek(file_entry.impl->record.relative_offset_of_local_header, IODevice::seek_set);
+		file_header.load(iodevice);
+		data_offset = iodevice.get_position();
+
+		//This fix allows OS X created .zips to be opened - SAR
+		if (file_header.general_purpose_bit_flag  & ZIP_CRC32_IN_FILE_DESCRIPTOR) //if this bit is set, it means the local header data for sizes was not
+		{
+			//the correct size data is not in the local header.. luckily, we have a real copy from the entry database
+			file_header.compressed_size = file_entry.get_compressed_size();
+			file_header.uncompressed_size = file_entry.get_uncompressed_size();
+		}
 	}
 
 	pos = 0;
 	compressed_pos = 0;
+	next_in = 0;
+	avail_in = 0;
 
 	// Initialize decompression:
-	int result = 0;
 	switch (file_header.compression_method)
 	{
 	case zip_compress_store: // no compression
 		break;
 
 	case zip_compress_deflate:
-		memset(&zs, 0, sizeof(mz_stream));
-		zs.next_in = 0;
-		zs.avail_in = 0;
-		zs.zalloc = 0;
-		zs.zfree = 0;
-		zs.opaque = 0;
-		//result = inflateInit(&zs);
-		result = mz_inflateInit2(&zs, -15); // Undocumented: if wbits is negative, zlib skips header check
-		if (result != MZ_OK) throw Exception("Zlib inflateInit failed for zip index!");
-		zstream_open = true;
+		tinfl_init(&inflator);
+		inflate_status = TINFL_STATUS_NEEDS_MORE_INPUT;
+		dictionary_offset = 0;
+		dictionary_avail = 0;
+		// Large entries get fewer checkpoints per megabyte, so they never take more than max_checkpoints
+		checkpoint_spacing = int(max((byte64)checkpoint_interval, ((ubyte32)file_header.uncompressed_size + max_checkpoints - 1) / (byte64)max_checkpoints));
 		break;
 
 	case zip_compress_shrunk:
@@ -230,19 +279,24 @@ void ZipIODevice_FileEntry::init()
 	}
 }
 
-void ZipIODevice_FileEntry::deinit()
+int ZipIODevice_FileEntry::lowlevel_read(void *data, int size, bool read_all)
 {
-	// Clean up decompression:
 	switch (file_header.compression_method)
 	{
 	case zip_compress_store: // no compression
+		{
+			int received = int(min((byte64)size, file_header.uncompressed_size - pos));
+			if (mapped_file)
+				memcpy(data, mapped_file->get_data() + data_offset + pos, received);
+			else
+				received = iodevice.receive(data, received, read_all);
+			pos += received;
+			return received;
+		}
 		break;
 
 	case zip_compress_deflate:
-		if (zstream_open)
-			mz_inflateEnd(&zs);
-		zstream_open = false;
-		break;
+		return inflate_read((unsigned char *) data, size);
 
 	case zip_compress_shrunk:
 	case zip_compress_expand_factor_1:
@@ -255,68 +309,99 @@ void ZipIODevice_FileEntry::deinit()
 	case zip_compress_pkware_implode:
 		break;
 	}
+
+	return 0;
 }
 
-int ZipIODevice_FileEntry::lowlevel_read(void *data, int size, bool read_all)
+int ZipIODevice_FileEntry::inflate_read(unsigned char *data, int size)
 {
-	switch (file_header.compression_method)
+	int bytes_read = 0;
+	while (bytes_read < size)
 	{
-	case zip_compress_store: // no compression
+		// Copy out data already decompressed into the dictionary:
+		if (dictionary_avail > 0)
 		{
-			int received = iodevice.receive(data, int(min((byte64)size, file_header.uncompressed_size - pos)), read_all);
-			pos += received;
-			return received;
+			int length = min((int) dictionary_avail, size - bytes_read);
+			if (data)
+				memcpy(data + bytes_read, dictionary + dictionary_offset, length);
+			dictionary_offset = (dictionary_offset + length) & (TINFL_LZ_DICT_SIZE - 1);
+			dictionary_avail -= length;
+			bytes_read += length;
+			pos += length;
+			continue;
 		}
-		break;
 
-	case zip_compress_deflate:
-		zs.next_out = (unsigned char *) data;
-		zs.avail_out = size;
-		// Continue feeding zlib data until we get our data:
-		while (zs.avail_out > 0)
-		{
-			// zlib needs more data:
-			if (zs.avail_in == 0 && compressed_pos < file_header.compressed_size)
-			{
-				// Read some compressed data:
-				int received_input = 0;
-				while (received_input < 16*1024)
-				{
-					received_input += iodevice.receive(zbuffer, int(min((byte64)16*1024, file_header.compressed_size - compressed_pos)), true);
-					if (compressed_pos + received_input == file_header.compressed_size) break;
-				}
-				compressed_pos += received_input;
+		if (inflate_status == TINFL_STATUS_DONE)
+			break;
 
-				zs.next_in = (unsigned char *) zbuffer;
-				zs.avail_in = received_input;
-			}
+		if (pos >= (checkpoints.empty() ? 0 : checkpoints.back().pos) + checkpoint_spacing)
+			add_checkpoint();
 
-			// Decompress data:
-			int result = mz_inflate(&zs, 0);
-			if (result == MZ_STREAM_END) break;
-			if (result == MZ_NEED_DICT) throw Exception("Zlib inflate wants a dictionary!");
-			if (result == MZ_DATA_ERROR) throw Exception("Zip data stream is corrupted");
-			if (result == MZ_STREAM_ERROR) throw Exception("Zip stream structure was inconsistent!");
-			if (result == MZ_MEM_ERROR) throw Exception("Zlib did not have enough memory to decompress file!");
-			if (result == MZ_BUF_ERROR) throw Exception("Not enough data in buffer when Z_FINISH was used");
-			if (result != MZ_OK) throw Exception("Zlib inflate failed while decompressing zip file!");
-		}
-		pos += size - zs.avail_out;
-		return size - zs.avail_out;
+		// Continue feeding tinfl data until we get our data:
+		if (avail_in == 0 && compressed_pos < file_header.compressed_size)
+			read_compressed_data();
 
-	case zip_compress_shrunk:
-	case zip_compress_expand_factor_1:
-	case zip_compress_expand_factor_2:
-	case zip_compress_expand_factor_3:
-	case zip_compress_expand_factor_4:
-	case zip_compress_implode:
-	case zip_compress_tokenize:
-	case zip_compress_deflate64:
-	case zip_compress_pkware_implode:
-		break;
+		size_t in_bytes = avail_in;
+		size_t out_bytes = TINFL_LZ_DICT_SIZE - dictionary_offset;
+		mz_uint32 flags = (compressed_pos < file_header.compressed_size) ? TINFL_FLAG_HAS_MORE_INPUT : 0;
+		inflate_status = tinfl_decompress(&inflator, next_in, &in_bytes, dictionary, dictionary + dictionary_offset, &out_bytes, flags);
+		next_in += in_bytes;
+		avail_in -= (int) in_bytes;
+		dictionary_avail = (mz_uint) out_bytes;
+
+		if (inflate_status < 0)
+			throw Exception("Zip data stream is corrupted");
 	}
+	return bytes_read;
+}
 
-	return 0;
+void ZipIODevice_FileEntry::read_compressed_data()
+{
+	if (mapped_file)
+	{
+		next_in = mapped_file->get_data() + data_offset + compressed_pos;
+		avail_in = int(min(file_header.compressed_size - compressed_pos, (byte64)0x40000000));
+	}
+	else
+	{
+		avail_in = iodevice.receive(zbuffer, int(min((byte64)sizeof(zbuffer), file_header.compressed_size - compressed_pos)), true);
+		if (avail_in <= 0)
+			throw Exception("Unexpected end of zip file entry data");
+		next_in = zbuffer;
+	}
+	compressed_pos += avail_in;
+}
+
+void ZipIODevice_FileEntry::add_checkpoint()
+{
+	checkpoints.push_back(InflateCheckpoint());
+	InflateCheckpoint &checkpoint = checkpoints.back();
+	checkpoint.pos = pos;
+	checkpoint.compressed_pos = compressed_pos - avail_in;
+	checkpoint.inflator = inflator;
+	checkpoint.status = inflate_status;
+	checkpoint.dictionary_offset = dictionary_offset;
+	checkpoint.dictionary.assign(dictionary, dictionary + TINFL_LZ_DICT_SIZE);
+}
+
+void ZipIODevice_FileEntry::restore_checkpoint(const InflateCheckpoint &checkpoint)
+{
+	pos = checkpoint.pos;
+	inflator = checkpoint.inflator;
+	inflate_status = checkpoint.status;
+	dictionary_offset = checkpoint.dictionary_offset;
+	dictionary_avail = 0;
+	memcpy(dictionary, &checkpoint.dictionary[0], TINFL_LZ_DICT_SIZE);
+	seek_compressed_data(checkpoint.compressed_pos);
+}
+
+void ZipIODevice_FileEntry::seek_compressed_data(byte64 new_compressed_pos)
+{
+	compressed_pos = new_compressed_pos;
+	next_in = 0;
+	avail_in = 0;
+	if (!mapped_file)
+		iodevice.seek(int(data_offset + compressed_pos), IODevice::seek_set);
 }
 
 }
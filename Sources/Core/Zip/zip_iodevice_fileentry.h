@@ -32,7 +32,9 @@
 #include "API/Core/Zip/zip_file_entry.h"
 #include "API/Core/System/databuffer.h"
 #include "zip_local_file_header.h"
+#include "API/Core/IOData/memory_mapped_file.h"
 #include <stack>
+#include <vector>
 #include "Core/Zip/miniz.h"
 
 namespace clan
@@ -46,6 +48,9 @@ class ZipIODevice_FileEntry : public IODeviceProvider
 public:
 	ZipIODevice_FileEntry(IODevice iodevice, const ZipFileEntry &entry);
 
+	/// \brief Constructs a file entry device reading directly from a memory mapped archive.
+	ZipIODevice_FileEntry(const std::shared_ptr<MemoryMappedFile> &mapped_file, const ZipFileEntry &entry);
+
 	~ZipIODevice_FileEntry();
 
 
@@ -80,25 +85,71 @@ public:
 /// \{
 
 private:
-	void init();
+	/// \brief Saved inflate state that decompression can be restarted from.
+	struct InflateCheckpoint
+	{
+		byte64 pos;
+		byte64 compressed_pos;
+		tinfl_decompressor inflator;
+		tinfl_status status;
+		mz_uint dictionary_offset;
+		std::vector<unsigned char> dictionary;
+	};
 
-	void deinit();
+	void init();
 
 	int lowlevel_read(void *buffer, int size, bool read_all);
 
+	/// \brief Decompresses up to size bytes. If data is null the output is discarded.
+	int inflate_read(unsigned char *data, int size);
+
+	void read_compressed_data();
+
+	void add_checkpoint();
+
+	void restore_checkpoint(const InflateCheckpoint &checkpoint);
+
+	void seek_compressed_data(byte64 new_compressed_pos);
+
+	/// \brief Smallest distance in uncompressed bytes between inflate checkpoints.
+	static const int checkpoint_interval = 256*1024;
+
+	/// \brief Largest number of checkpoints saved for an entry.
+	///
+	/// Each checkpoint holds the inflate state and a copy of the dictionary, about 43 KB.
+	static const int max_checkpoints = 64;
+
 	IODevice iodevice;
 
+	std::shared_ptr<MemoryMappedFile> mapped_file;
+
 	ZipFileEntry file_entry;
 
 	ZipLocalFileHeader file_header;
 
+	/// \brief Offset of the entry data in the archive.
+	byte64 data_offset;
+
 	byte64 pos, compressed_pos;
 
-	mz_stream zs;
+	tinfl_decompressor inflator;
+
+	tinfl_status inflate_status;
+
+	unsigned char dictionary[TINFL_LZ_DICT_SIZE];
+
+	mz_uint dictionary_offset, dictionary_avail;
+
+	const unsigned char *next_in;
+
+	int avail_in;
+
+	unsigned char zbuffer[16*1024];
 
-	char zbuffer[16*1024];
+	std::vector<InflateCheckpoint> checkpoints;
 
-	bool zstream_open;
+	/// \brief Distance in uncompressed bytes between inflate checkpoints of this entry.
+	int checkpoint_spacing;
 
 	DataBuffer peeked_data;
 /// \}
@@ -29,6 +29,10 @@
 #include "Core/precomp.h"
 #include "API/Core/Zip/zip_writer.h"
 #include "API/Core/Text/string_help.h"
+#include "API/Core/Zip/zlib_compression.h"
+#include "API/Core/System/work_queue.h"
+#include "API/Core/System/event.h"
+#include "API/Core/Math/cl_math.h"
 #include "zip_archive_impl.h"
 #include "zip_local_file_header.h"
 #include "zip_compression_method.h"
@@ -36,10 +40,67 @@
 #include "zip_end_of_central_directory_record.h"
 #include "zip_flags.h"
 #include "Core/Zip/miniz.h"
+#include <deque>
 
 namespace clan
 {
 
+/////////////////////////////////////////////////////////////////////////////
+// ZipWriter_PendingFile class:
+
+/// \brief File entry added with ZipWriter::add_file, waiting to be written.
+class ZipWriter_PendingFile
+{
+public:
+	ZipWriter_PendingFile() : crc32(0), failed(false) { }
+
+	void process()
+	{
+		crc32 = ZipArchive_Impl::calc_crc32(data.get_data(), data.get_size());
+		if (local_header.compression_method == zip_compress_deflate)
+			compressed_data = ZLibCompression::compress(data, true, 6);
+		else
+			compressed_data = data;
+	}
+
+	ZipLocalFileHeader local_header;
+	DataBuffer data;
+	DataBuffer compressed_data;
+	ubyte32 crc32;
+	std::string error;
+	bool failed;
+	Event done_event;
+};
+
+class ZipWriter_CompressFile : public WorkItem
+{
+public:
+	ZipWriter_CompressFile(const std::shared_ptr<ZipWriter_PendingFile> &file) : file(file) { }
+
+	void process_work()
+	{
+		try
+		{
+			file->process();
+		}
+		catch (Exception &e)
+		{
+			file->error = e.message;
+			file->failed = true;
+		}
+		catch (...)
+		{
+			file->error = "ZipWriter failed compressing file entry";
+			file->failed = true;
+		}
+		file->data = DataBuffer();
+		file->done_event.set();
+	}
+
+private:
+	std::shared_ptr<ZipWriter_PendingFile> file;
+};
+
 /////////////////////////////////////////////////////////////////////////////
 // ZipWriter_Impl class:
 
@@ -78,6 +139,13 @@ public:
 	mz_stream zs;
 	char zbuffer[16*1024];
 	std::vector<FileEntry> written_files;
+
+	std::unique_ptr<WorkQueue> work_queue;
+	std::deque<std::shared_ptr<ZipWriter_PendingFile> > pending_files;
+
+	ZipLocalFileHeader create_local_header(const std::string &filename, bool compress);
+	void write_file(const ZipWriter_PendingFile &file);
+	void write_pending_files(size_t max_pending);
 };
 
 /////////////////////////////////////////////////////////////////////////////
@@ -88,6 +156,12 @@ ZipWriter::ZipWriter(IODevice &output, bool storeFilenamesAsUTF8)
 {
 }
 
+ZipWriter::ZipWriter(IODevice &output, WorkQueue &work_queue, bool storeFilenamesAsUTF8)
+: impl(new ZipWriter_Impl(output, storeFilenamesAsUTF8))
+{
+	impl->work_queue.reset(new WorkQueue(work_queue));
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // ZipWriter Operations:
 
@@ -95,6 +169,7 @@ void ZipWriter::begin_file(const std::string &filename, bool compress)
 {
 	if (impl->file_begun)
 		throw Exception("ZipWriter already writing a file");
+	impl->write_pending_files(0);
 	impl->file_begun = true;
 
 	impl->uncompressed_length = 0;
@@ -103,40 +178,7 @@ void ZipWriter::begin_file(const std::string &filename, bool compress)
 	impl->crc32 = ZIP_CRC_START_VALUE;
 
 	impl->local_header_offset = impl->output.get_position();
-	impl->local_header = ZipLocalFileHeader();
-	impl->local_header.version_needed_to_extract = 20;
-	if (impl->storeFilenamesAsUTF8)
-		impl->local_header.general_purpose_bit_flag = ZIP_USE_UTF8;
-	else
-		impl->local_header.general_purpose_bit_flag = 0;
-	impl->local_header.compression_method = compress ? zip_compress_deflate : zip_compress_store;
-	ZipArchive_Impl::calc_time_and_date(
-		impl->local_header.last_mod_file_date,
-		impl->local_header.last_mod_file_time);
-	impl->local_header.crc32 = 0;
-	impl->local_header.uncompressed_size = 0;
-	impl->local_header.compressed_size = 0;
-	impl->local_header.file_name_length = filename.length();
-	impl->local_header.filename = filename;
-
-	if (!impl->storeFilenamesAsUTF8) // Add UTF-8 as extra field if we aren't storing normal UTF-8 filenames
-	{
-		// -Info-ZIP Unicode Path Extra Field (0x7075)
-		std::string filename_cp437 = StringHelp::text_to_cp437(filename);
-		std::string filename_utf8 = StringHelp::text_to_utf8(filename);
-		DataBuffer unicode_path(9 + filename_utf8.length());
-		ubyte16 *extra_id = (ubyte16 *) (unicode_path.get_data());
-		ubyte16 *extra_len = (ubyte16 *) (unicode_path.get_data() + 2);
-		ubyte8 *extra_version = (ubyte8 *) (unicode_path.get_data() + 4);
-		ubyte32 *extra_crc32 = (ubyte32 *) (unicode_path.get_data() + 5);
-		*extra_id = 0x7075;
-		*extra_len = 5 + filename_utf8.length();
-		*extra_version = 1;
-		*extra_crc32 = ZipArchive_Impl::calc_crc32(filename_cp437.data(), filename_cp437.size());
-		memcpy(unicode_path.get_data() + 9, filename_utf8.data(), filename_utf8.length());
-		impl->local_header.extra_field_length = unicode_path.get_size();
-		impl->local_header.extra_field = unicode_path;
-	}
+	impl->local_header = impl->create_local_header(filename, compress);
 
 	impl->local_header.save(impl->output);
 
@@ -242,10 +284,45 @@ void ZipWriter::end_file()
 	impl->file_begun = false;
 }
 
+void ZipWriter::add_file(const std::string &filename, const DataBuffer &data, bool compress)
+{
+	if (impl->file_begun)
+		throw Exception("ZipWriter already writing a file");
+
+	std::shared_ptr<ZipWriter_PendingFile> file(new ZipWriter_PendingFile);
+	file->local_header = impl->create_local_header(filename, compress);
+	file->local_header.uncompressed_size = data.get_size();
+
+	if (impl->work_queue && data.get_size() <= ZLibCompression::parallel_block_size)
+	{
+		// Keep a copy, as the caller may reuse its buffer before the entry is compressed
+		file->data = DataBuffer(data.get_data(), data.get_size());
+		impl->pending_files.push_back(file);
+		impl->work_queue->queue(new ZipWriter_CompressFile(file));
+		impl->write_pending_files(max(2, impl->work_queue->get_num_threads() * 2));
+	}
+	else
+	{
+		impl->write_pending_files(0);
+		file->data = data;
+		if (impl->work_queue && compress)
+		{
+			file->crc32 = ZipArchive_Impl::calc_crc32(data.get_data(), data.get_size());
+			file->compressed_data = ZLibCompression::compress(data, *impl->work_queue, true, 6);
+		}
+		else
+		{
+			file->process();
+		}
+		impl->write_file(*file);
+	}
+}
+
 void ZipWriter::write_toc()
 {
 	if (impl->file_begun)
 		throw Exception("Cannot write zip TOC when already writing a file entry");
+	impl->write_pending_files(0);
 
 	byte64 offset_start_central_dir = impl->output.get_position();
 
@@ -296,4 +373,72 @@ void ZipWriter::write_toc()
 /////////////////////////////////////////////////////////////////////////////
 // ZipWriter Implementation:
 
+ZipLocalFileHeader ZipWriter_Impl::create_local_header(const std::string &filename, bool compress)
+{
+	ZipLocalFileHeader local_header;
+	local_header.version_needed_to_extract = 20;
+	if (storeFilenamesAsUTF8)
+		local_header.general_purpose_bit_flag = ZIP_USE_UTF8;
+	else
+		local_header.general_purpose_bit_flag = 0;
+	local_header.compression_method = compress ? zip_compress_deflate : zip_compress_store;
+	ZipArchive_Impl::calc_time_and_date(
+		local_header.last_mod_file_date,
+		local_header.last_mod_file_time);
+	local_header.crc32 = 0;
+	local_header.uncompressed_size = 0;
+	local_header.compressed_size = 0;
+	local_header.file_name_length = filename.length();
+	local_header.filename = filename;
+	local_header.extra_field_length = 0;
+
+	if (!storeFilenamesAsUTF8) // Add UTF-8 as extra field if we aren't storing normal UTF-8 filenames
+	{
+		// -Info-ZIP Unicode Path Extra Field (0x7075)
+		std::string filename_cp437 = StringHelp::text_to_cp437(filename);
+		std::string filename_utf8 = StringHelp::text_to_utf8(filename);
+		DataBuffer unicode_path(9 + filename_utf8.length());
+		ubyte16 *extra_id = (ubyte16 *) (unicode_path.get_data());
+		ubyte16 *extra_len = (ubyte16 *) (unicode_path.get_data() + 2);
+		ubyte8 *extra_version = (ubyte8 *) (unicode_path.get_data() + 4);
+		ubyte32 *extra_crc32 = (ubyte32 *) (unicode_path.get_data() + 5);
+		*extra_id = 0x7075;
+		*extra_len = 5 + filename_utf8.length();
+		*extra_version = 1;
+		*extra_crc32 = ZipArchive_Impl::calc_crc32(filename_cp437.data(), filename_cp437.size());
+		memcpy(unicode_path.get_data() + 9, filename_utf8.data(), filename_utf8.length());
+		local_header.extra_field_length = unicode_path.get_size();
+		local_header.extra_field = unicode_path;
+	}
+
+	return local_header;
+}
+
+void ZipWriter_Impl::write_file(const ZipWriter_PendingFile &file)
+{
+	FileEntry file_entry;
+	file_entry.local_header = file.local_header;
+	file_entry.local_header.crc32 = file.crc32;
+	file_entry.local_header.compressed_size = file.compressed_data.get_size();
+	file_entry.local_header_offset = output.get_position();
+
+	file_entry.local_header.save(output);
+	output.write(file.compressed_data.get_data(), file.compressed_data.get_size());
+	written_files.push_back(file_entry);
+}
+
+void ZipWriter_Impl::write_pending_files(size_t max_pending)
+{
+	// Entries are written in the order they were added, so the archive does not depend on scheduling
+	while (pending_files.size() > max_pending)
+	{
+		std::shared_ptr<ZipWriter_PendingFile> file = pending_files.front();
+		pending_files.pop_front();
+		file->done_event.wait();
+		if (file->failed)
+			throw Exception(file->error);
+		write_file(*file);
+	}
+}
+
 }
@@ -30,6 +30,11 @@
 #include "API/Core/Zip/zlib_compression.h"
 #include "API/Core/System/databuffer.h"
 #include "API/Core/IOData/iodevice_memory.h"
+#include "API/Core/System/work_queue.h"
+#include "API/Core/System/event.h"
+#include "API/Core/System/interlocked_variable.h"
+#include "API/Core/Math/cl_math.h"
+#include "Core/Crypto/checksum_impl.h"
 
 #define INCLUDED_FROM_ZLIB_COMPRESSION_CPP
 #include "miniz.h"
@@ -37,6 +42,108 @@
 namespace clan
 {
 
+/// \brief Shared state of a block-parallel deflate.
+class ZLibParallelCompression
+{
+public:
+	ZLibParallelCompression(int num_blocks) : blocks(num_blocks)
+	{
+		blocks_remaining.set(num_blocks);
+	}
+
+	struct Block
+	{
+		Block() : adler32(1), failed(false) { }
+
+		std::vector<unsigned char> output;
+		ubyte32 adler32;
+		bool failed;
+	};
+
+	std::vector<Block> blocks;
+	InterlockedVariable blocks_remaining;
+	Event done_event;
+};
+
+/// \brief Compresses one block of a block-parallel deflate.
+///
+/// The compressor is primed with the last 32 KB of the previous block by compressing it first and
+/// discarding the output up to a sync flush. The block output then starts on a byte boundary and
+/// can refer back into the primed data, which the decompressor has already produced.
+class ZLibCompressionBlock : public WorkItem
+{
+public:
+	ZLibCompressionBlock(const std::shared_ptr<ZLibParallelCompression> &compression, int index, const unsigned char *data, int size, int dictionary_size, bool last_block, mz_uint flags)
+	: compression(compression), index(index), data(data), size(size), dictionary_size(dictionary_size), last_block(last_block), flags(flags)
+	{
+	}
+
+	void process_work()
+	{
+		ZLibParallelCompression::Block &block = compression->blocks[index];
+		try
+		{
+			block.failed = !compress_block(block);
+		}
+		catch (...)
+		{
+			block.failed = true;
+		}
+
+		if (compression->blocks_remaining.decrement() == 0)
+			compression->done_event.set();
+	}
+
+private:
+	bool compress_block(ZLibParallelCompression::Block &block)
+	{
+		block.adler32 = Checksum_Impl::adler32_update(1, data, size);
+		block.output.reserve(size / 2 + 1024);
+
+		std::unique_ptr<tdefl_compressor> compressor(new tdefl_compressor);
+		if (tdefl_init(compressor.get(), &ZLibCompressionBlock::put_output, &block.output, flags) != TDEFL_STATUS_OKAY)
+			return false;
+
+		if (dictionary_size > 0)
+		{
+			if (tdefl_compress_buffer(compressor.get(), data - dictionary_size, dictionary_size, TDEFL_SYNC_FLUSH) != TDEFL_STATUS_OKAY)
+				return false;
+			block.output.clear();
+		}
+
+		tdefl_status status = tdefl_compress_buffer(compressor.get(), data, size, last_block ? TDEFL_FINISH : TDEFL_SYNC_FLUSH);
+		return status == (last_block ? TDEFL_STATUS_DONE : TDEFL_STATUS_OKAY);
+	}
+
+	static mz_bool put_output(const void *buffer, int length, void *user)
+	{
+		std::vector<unsigned char> *output = (std::vector<unsigned char> *) user;
+		output->insert(output->end(), (const unsigned char *) buffer, (const unsigned char *) buffer + length);
+		return MZ_TRUE;
+	}
+
+	std::shared_ptr<ZLibParallelCompression> compression;
+	int index;
+	const unsigned char *data;
+	int size;
+	int dictionary_size;
+	bool last_block;
+	mz_uint flags;
+};
+
+static int get_miniz_strategy(ZLibCompression::CompressionMode mode)
+{
+	switch (mode)
+	{
+	case ZLibCompression::default_strategy: return MZ_DEFAULT_STRATEGY;
+	case ZLibCompression::filtered: return MZ_FILTERED;
+	case ZLibCompression::huffman_only: return MZ_HUFFMAN_ONLY;
+	case ZLibCompression::rle: return MZ_RLE;
+	case ZLibCompression::fixed: return MZ_FIXED;
+	}
+	return MZ_DEFAULT_STRATEGY;
+}
+
 DataBuffer ZLibCompression::compress(const DataBuffer &data, bool raw, int compression_level, CompressionMode mode)
 {
 	const int window_bits = 15;
@@ -44,15 +151,7 @@ DataBuffer ZLibCompression::compress(const DataBuffer &data, bool raw, int compr
 	DataBuffer zbuffer(1024*1024);
 	IODevice_Memory output;
 
-	int strategy = MZ_DEFAULT_STRATEGY;
-	switch (mode)
-	{
-	case default_strategy: strategy = MZ_DEFAULT_STRATEGY; break;
-	case filtered: strategy = MZ_FILTERED; break;
-	case huffman_only: strategy = MZ_HUFFMAN_ONLY; break;
-	case rle: strategy = MZ_RLE; break;
-	case fixed: strategy = MZ_FIXED; break;
-	}
+	int strategy = get_miniz_strategy(mode);
 
 	mz_stream zs = { 0 };
 	int result = mz_deflateInit2(&zs, compression_level, MZ_DEFLATED, raw ? -window_bits : window_bits, 8, strategy); // Undocumented: if wbits is negative, zlib skips header check
@@ -93,6 +192,70 @@ DataBuffer ZLibCompression::compress(const DataBuffer &data, bool raw, int compr
 	return output.get_data();
 }
 
+DataBuffer ZLibCompression::compress(const DataBuffer &data, WorkQueue &work_queue, bool raw, int compression_level, CompressionMode mode)
+{
+	const int dictionary_size = 32*1024;
+	const int block_size = parallel_block_size;
+
+	int num_blocks = (data.get_size() + block_size - 1) / block_size;
+	if (num_blocks <= 1)
+		return compress(data, raw, compression_level, mode);
+
+	if (compression_level < MZ_DEFAULT_COMPRESSION || compression_level > 10)
+		throw Exception("Zlib deflateInit failed");
+
+	mz_uint flags = tdefl_create_comp_flags_from_zip_params(compression_level, -15, get_miniz_strategy(mode));
+	const unsigned char *input = (const unsigned char *) data.get_data();
+
+	std::shared_ptr<ZLibParallelCompression> compression(new ZLibParallelCompression(num_blocks));
+	std::vector<WorkItem *> items;
+	items.reserve(num_blocks);
+	for (int i = 0; i < num_blocks; i++)
+	{
+		int offset = i * block_size;
+		int size = min(block_size, data.get_size() - offset);
+		items.push_back(new ZLibCompressionBlock(compression, i, input + offset, size, min(offset, dictionary_size), i + 1 == num_blocks, flags));
+	}
+	work_queue.queue_batch(items);
+	compression->done_event.wait();
+
+	// Concatenate the blocks, adding the zlib header and adler-32 trailer when not raw:
+	int output_size = raw ? 0 : 6;
+	for (int i = 0; i < num_blocks; i++)
+	{
+		if (compression->blocks[i].failed)
+			throw Exception("Zlib deflate failed while compressing zip file!");
+		output_size += compression->blocks[i].output.size();
+	}
+
+	DataBuffer output(output_size);
+	unsigned char *output_data = (unsigned char *) output.get_data();
+	if (!raw)
+	{
+		*(output_data++) = 0x78;
+		*(output_data++) = 0x01;
+	}
+
+	ubyte32 adler32 = 1;
+	for (int i = 0; i < num_blocks; i++)
+	{
+		ZLibParallelCompression::Block &block = compression->blocks[i];
+		if (!block.output.empty())
+			memcpy(output_data, &block.output[0], block.output.size());
+		output_data += block.output.size();
+		adler32 = Checksum_Impl::adler32_combine(adler32, block.adler32, min(block_size, data.get_size() - i * block_size));
+		std::vector<unsigned char>().swap(block.output);
+	}
+
+	if (!raw)
+	{
+		for (int i = 0; i < 4; i++)
+			*(output_data++) = (unsigned char) (adler32 >> (24 - i * 8));
+	}
+
+	return output;
+}
+
 DataBuffer ZLibCompression::decompress(const DataBuffer &data, bool raw)
 {
 	const int window_bits = 15;
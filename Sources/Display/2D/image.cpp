@@ -42,6 +42,7 @@
 #include "render_batch_triangle.h"
 #include "../Render/graphic_context_impl.h"
 #include "canvas_impl.h"
+#include "../Resources/preloaded_images.h"
 #include "API/Display/Resources/display_cache.h"
 
 namespace clan
@@ -178,6 +179,11 @@ Resource<Image> Image::resource(Canvas &canvas, const std::string &id, const Res
 }
 
 Image Image::load(Canvas &canvas, const std::string &id, const XMLResourceDocument &doc)
+{
+	return load_image_resource(canvas, id, doc, PreloadedImages());
+}
+
+Image load_image_resource(Canvas &canvas, const std::string &id, const XMLResourceDocument &doc, const PreloadedImages &preloaded_images)
 {
 	Image image;
 
@@ -194,7 +200,7 @@ Image Image::load(Canvas &canvas, const std::string &id, const XMLResourceDocume
 		if (tag_name == "image" || tag_name == "image-file")
 		{
 			std::string image_name = cur_element.get_attribute("file");
-			Texture2D texture = Texture2D(canvas, PathHelp::combine(resource.get_base_path(), image_name), resource.get_file_system());
+			Texture2D texture = preloaded_images.create_texture(canvas, PathHelp::combine(resource.get_base_path(), image_name), resource.get_file_system());
 
 			DomNode cur_child(cur_element.get_first_child());
 			if(cur_child.is_null()) 
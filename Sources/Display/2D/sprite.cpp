@@ -44,6 +44,7 @@
 #include "API/Display/ImageProviders/png_provider.h"
 #include "API/Display/Collision/collision_outline.h"
 #include "sprite_impl.h"
+#include "../Resources/preloaded_images.h"
 #include "render_batch_triangle.h"
 #include "API/Display/Resources/display_cache.h"
 #include "API/Display/2D/subtexture.h"
@@ -98,6 +99,11 @@ Resource<Sprite> Sprite::resource(Canvas &canvas, const std::string &id, const R
 }
 
 Sprite Sprite::load(Canvas &canvas, const std::string &id, const XMLResourceDocument &doc)
+{
+	return load_sprite_resource(canvas, id, doc, PreloadedImages());
+}
+
+Sprite load_sprite_resource(Canvas &canvas, const std::string &id, const XMLResourceDocument &doc, const PreloadedImages &preloaded_images)
 {
 	Sprite sprite(canvas);
 
@@ -158,7 +164,7 @@ Sprite Sprite::load(Canvas &canvas, const std::string &id, const XMLResourceDocu
 
 					try
 					{
-						Texture2D texture = Texture2D(canvas, PathHelp::combine(resource.get_base_path(), file_name), fs);
+						Texture2D texture = preloaded_images.create_texture(canvas, PathHelp::combine(resource.get_base_path(), file_name), fs);
 						sprite.add_frame(texture);
 						found_initial = true;
 					}
@@ -178,7 +184,7 @@ Sprite Sprite::load(Canvas &canvas, const std::string &id, const XMLResourceDocu
 			{
 				std::string image_name = cur_element.get_attribute("file");
 				FileSystem fs = resource.get_file_system();
-				Texture2D texture = Texture2D(canvas, PathHelp::combine(resource.get_base_path(), image_name), fs);
+				Texture2D texture = preloaded_images.create_texture(canvas, PathHelp::combine(resource.get_base_path(), image_name), fs);
 
 				DomNode cur_child(cur_element.get_first_child());
 				if(cur_child.is_null()) 
@@ -98,6 +98,11 @@ Subtexture TextureGroup::add(GraphicContext &context, const Size &size)
 	return impl->add_new_node(context, size);
 }
 
+Subtexture TextureGroup::try_add(GraphicContext &context, const Size &size)
+{
+	return impl->add_existing_node(size);
+}
+
 void TextureGroup::remove(Subtexture &subtexture)
 {
 	impl->remove(subtexture);
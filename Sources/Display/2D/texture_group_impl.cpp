@@ -101,6 +101,7 @@ Subtexture TextureGroup_Impl::add_new_node(GraphicContext &context, const Size &
 
 	// Try inserting in current active texture
 	Node *node;
+	RootNode *root = active_root;
 	if (!active_root)
 	{
 		// Create an initial root, if it does not exist
@@ -123,7 +124,10 @@ Subtexture TextureGroup_Impl::add_new_node(GraphicContext &context, const Size &
 			{
 				node = root_nodes[index]->node.insert(texture_size, next_id);
 				if(node)	// We found space in a previous texture
+				{
+					root = root_nodes[index];
 					break;
+				}
 			}
 		}
 
@@ -132,12 +136,13 @@ Subtexture TextureGroup_Impl::add_new_node(GraphicContext &context, const Size &
 			if(texture_size.width > initial_texture_size.width || texture_size.height > initial_texture_size.height)
 			{
 				// If the specified size is greater than the initial size,  then create a texture using the specified size
-				node = add_new_root(context, texture_size)->node.insert(texture_size, next_id);
+				root = add_new_root(context, texture_size);
 			}
 			else
 			{
-				node = add_new_root(context, initial_texture_size)->node.insert(texture_size, next_id);
+				root = add_new_root(context, initial_texture_size);
 			}
+			node = root->node.insert(texture_size, next_id);
 		}
 
 		if(node == 0)
@@ -146,7 +151,31 @@ Subtexture TextureGroup_Impl::add_new_node(GraphicContext &context, const Size &
 
 	next_id++;
 
-	return Subtexture(active_root->texture, node->image_rect);
+	return Subtexture(root->texture, node->image_rect);
+}
+
+Subtexture TextureGroup_Impl::add_existing_node(const Size &texture_size)
+{
+	if (!active_root)
+		return Subtexture();
+
+	Node *node = active_root->node.insert(texture_size, next_id);
+	RootNode *root = active_root;
+
+	std::vector<RootNode *>::size_type index, size;
+	size = root_nodes.size();
+	for(index = 0; node == 0 && index < size; ++index)
+	{
+		node = root_nodes[index]->node.insert(texture_size, next_id);
+		root = root_nodes[index];
+	}
+
+	if (node == 0)
+		return Subtexture();
+
+	next_id++;
+
+	return Subtexture(root->texture, node->image_rect);
 }
 
 TextureGroup_Impl::RootNode *TextureGroup_Impl::add_new_root(GraphicContext &context, const Size &texture_size)
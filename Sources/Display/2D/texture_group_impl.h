@@ -81,6 +81,7 @@ public:
 	std::vector<Texture2D> get_textures() const;
 
 	Subtexture add_new_node(GraphicContext &context, const Size &texture_size);
+	Subtexture add_existing_node(const Size &texture_size);
 
 	std::vector<RootNode *> root_nodes;
 
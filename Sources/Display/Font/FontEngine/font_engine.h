@@ -81,6 +81,9 @@ public:
 	virtual FontPixelBuffer get_font_glyph_subpixel(int glyph) = 0;
 	virtual Shape2D load_glyph_outline(int glyph_index, int &out_advance_x) = 0;
 
+	/// \brief Creates a copy of the engine that can rasterize glyphs on another thread. Returns NULL if not supported.
+	virtual FontEngine *create_worker_engine() { return 0; }
+
 };
 
 }
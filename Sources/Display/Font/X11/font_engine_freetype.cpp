@@ -82,16 +82,59 @@ FontEngine_Freetype_Library &FontEngine_Freetype_Library::instance()
 /////////////////////////////////////////////////////////////////////////////
 // FontEngine_Freetype Construction:
 
-FontEngine_Freetype::FontEngine_Freetype(IODevice &io_dev, int average_width, int height) : face(0)
+FontEngine_Freetype::FontEngine_Freetype(IODevice &io_dev, int average_width, int height) : face(0), worker_library(0)
 {
-
-
 	data_buffer = DataBuffer(io_dev.get_size());
 	io_dev.read(data_buffer.get_data(), data_buffer.get_size());
 
-	FontEngine_Freetype_Library &library = FontEngine_Freetype_Library::instance();
+	load_face(average_width, height);
+}
+
+FontEngine_Freetype::FontEngine_Freetype(const DataBuffer &font_data, int average_width, int height, bool own_library) : face(0), data_buffer(font_data), worker_library(0)
+{
+	if (own_library)
+	{
+		FT_Error error = FT_Init_FreeType( &worker_library );
+		if ( error )
+		{
+			throw Exception("FontEngine_Freetype: Initializing FreeType library failed.");
+		}
+		FT_Library_SetLcdFilter(worker_library, FT_LCD_FILTER_DEFAULT);
+	}
 
-	FT_Error error = FT_New_Memory_Face( library.library, (FT_Byte*)data_buffer.get_data(), data_buffer.get_size(), 0, &face);
+	try
+	{
+		load_face(average_width, height);
+	}
+	catch (...)
+	{
+		if (worker_library)
+			FT_Done_FreeType(worker_library);
+		throw;
+	}
+}
+
+FontEngine_Freetype::~FontEngine_Freetype()
+{
+	if (face)
+	{
+		FT_Done_Face(face);
+	}
+	if (worker_library)
+	{
+		FT_Done_FreeType(worker_library);
+	}
+}
+
+void FontEngine_Freetype::load_face(int new_average_width, int new_height)
+{
+	average_width = new_average_width;
+	height = new_height;
+
+	FT_Library library = worker_library ? worker_library : FontEngine_Freetype_Library::instance().library;
+
+	// Note, the face references data_buffer directly. It is shared with the worker engines and never modified.
+	FT_Error error = FT_New_Memory_Face( library, (FT_Byte*)data_buffer.get_data(), data_buffer.get_size(), 0, &face);
 
 	if ( error == FT_Err_Unknown_File_Format )
 	{
@@ -102,28 +145,21 @@ FontEngine_Freetype::FontEngine_Freetype(IODevice &io_dev, int average_width, in
 		throw Exception("Freetype error: Font file could not be opened or read, or is corrupted.");
 	}
 
-	if (height >= 0.0f)
+	int char_height = height;
+	if (char_height >= 0.0f)
 	{
 		if ( (face->height != 0) && (face->units_per_EM !=0) )	// Is scalable font
 		{
-			height = height*face->units_per_EM/face->height;
+			char_height = char_height*face->units_per_EM/face->height;
 		}
 	}
 	else
 	{
-		height = -height;
+		char_height = -char_height;
 	}
 
 	// if the device is 72 DCL_PI then 1 point becomes 1 pixel
-	FT_Set_Char_Size( face, (int)(average_width*64.0f), (int)(height*64.0f), 72, 72 );
-}
-
-FontEngine_Freetype::~FontEngine_Freetype()
-{
-	if (face)
-	{
-		FT_Done_Face(face);
-	}
+	FT_Set_Char_Size( face, (int)(average_width*64.0f), (int)(char_height*64.0f), 72, 72 );
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -473,6 +509,11 @@ FontPixelBuffer FontEngine_Freetype::get_font_glyph_subpixel(int glyph)
 	return font_buffer;
 }
 
+FontEngine *FontEngine_Freetype::create_worker_engine()
+{
+	return new FontEngine_Freetype(data_buffer, average_width, height, true);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // FontEngine_Freetype Implementation:
 
@@ -66,6 +66,7 @@ class FontEngine_Freetype : public FontEngine
 /// \{
 public:
 	FontEngine_Freetype(IODevice &io_dev, int average_width, int height);
+	FontEngine_Freetype(const DataBuffer &font_data, int average_width, int height, bool own_library);
 	~FontEngine_Freetype();
 
 /// \}
@@ -97,11 +98,14 @@ public:
 public:
 	Shape2D load_glyph_outline(int glyph_index, int &out_advance_x);
 
+	FontEngine *create_worker_engine();
+
 /// \}
 /// \name Implementation
 /// \{
 
 private:
+	void load_face(int average_width, int height);
 	TagStruct get_tag_struct(int cont, int index, FT_Outline *outline);
 	int get_index_of_next_contour_point(int cont, int index, FT_Outline *outline);
 	int get_index_of_prev_contour_point(int cont, int index, FT_Outline *outline);
@@ -112,6 +116,11 @@ private:
 	std::vector<TaggedPoint> get_contour_points(int cont, FT_Outline *outline);
 
 	DataBuffer data_buffer;
+	int average_width;
+	int height;
+
+	// Worker engines use their own library, as FreeType libraries must not be shared between threads
+	FT_Library worker_library;
 /// \}
 
 };
@@ -97,6 +97,8 @@ int FontProvider_Freetype::get_character_index(GraphicContext &gc, const std::st
 
 void FontProvider_Freetype::free_font()
 {
+	glyph_cache.free_worker_engines();
+
 	if (font_engine)
 	{
 		delete(font_engine);
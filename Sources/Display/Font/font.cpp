@@ -367,6 +367,12 @@ int Font::get_character_index(Canvas &canvas, const std::string &text, const Poi
 	return 0;
 }
 
+void Font::prefetch(Canvas &canvas, const std::string &text)
+{
+	if (impl)
+		impl->prefetch(canvas, text);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // Font Implementation:
 
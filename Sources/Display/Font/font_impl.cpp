@@ -80,6 +80,8 @@ Font_Impl::~Font_Impl()
 
 void Font_Impl::free_font()
 {
+	glyph_cache.free_worker_engines();
+
 	if (font_engine)
 	{
 		delete(font_engine);
@@ -204,6 +206,11 @@ int Font_Impl::get_character_index(GraphicContext &gc, const std::string &text,
 	return glyph_cache.get_character_index(font_engine, gc, text, point);
 }
 
+void Font_Impl::prefetch(Canvas &canvas, const std::string &text)
+{
+	glyph_cache.prefetch(font_engine, canvas, text);
+}
+
 void Font_Impl::load_font( Canvas &canvas, Sprite &sprite, const std::string &glyph_list, int spacelen, bool monospace, const FontMetrics &metrics)
 {
 	free_font();
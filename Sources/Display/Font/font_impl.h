@@ -57,6 +57,7 @@ public:
 	Size get_text_size(GraphicContext &gc, const std::string &text);
 	FontMetrics get_font_metrics();
 	int get_character_index(GraphicContext &gc, const std::string &text, const Point &point);
+	void prefetch(Canvas &canvas, const std::string &text);
 
 	/// \brief Loads a font from a XML resource definition
 	static Font load(Canvas &canvas, const FontDescription &reference_desc, const std::string &id, const XMLResourceDocument &doc, Callback_2<Resource<Sprite>, Canvas &, const std::string &> cb_get_sprite);
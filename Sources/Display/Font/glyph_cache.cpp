@@ -47,6 +47,10 @@
 #include "../Render/graphic_context_impl.h"
 #include "API/Display/2D/canvas.h"
 #include "../2D/canvas_impl.h"
+#include "API/Core/System/system.h"
+#include "API/Core/System/event.h"
+#include "API/Core/System/interlocked_variable.h"
+#include <algorithm>
 
 namespace clan
 {
@@ -55,11 +59,11 @@ namespace clan
 // GlyphCache Construction:
 
 GlyphCache::GlyphCache()
+: small_atlas(Size(256,256)), large_atlas(Size(512,512)), custom_texture_group(false), atlas_memory_limit(default_atlas_memory_limit)
 {
-	glyph_list.reserve(256);
-
-	// Note, the user can specify a different texture group size using set_texture_group()
-	texture_group = TextureGroup(Size(256,256));
+	// Note, the user can specify a different texture group using set_texture_group()
+	small_atlas.texture_group.set_texture_allocation_policy(TextureGroup::search_previous_textures);
+	large_atlas.texture_group.set_texture_allocation_policy(TextureGroup::search_previous_textures);
 
 	// Set default font metrics
 	font_metrics = FontMetrics(
@@ -72,8 +76,10 @@ GlyphCache::GlyphCache()
 
 GlyphCache::~GlyphCache()
 {
-	for (int cnt = 0; cnt < glyph_list.size(); cnt++)
-		delete glyph_list[cnt];
+	free_worker_engines();
+
+	for (GlyphMap::iterator it = glyph_map.begin(); it != glyph_map.end(); ++it)
+		delete it->second;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -112,26 +118,15 @@ Size GlyphCache::get_text_size(FontEngine *font_engine, GraphicContext &gc, cons
 
 Font_TextureGlyph *GlyphCache::get_glyph(FontEngine *font_engine, GraphicContext &gc, unsigned int glyph)
 {
-	std::vector< Font_TextureGlyph * >::size_type size = glyph_list.size();
-	for (int cnt=0; cnt<size; cnt++)
-	{
-		if (glyph_list[cnt]->glyph == glyph)
-			return &(*glyph_list[cnt]);
-	}
-
-	// If glyph does not exist, create one automatically
-
-	insert_glyph(font_engine, gc, glyph);
-
-	// Search for the glyph again
-	size = glyph_list.size();
-	for (int cnt=0; cnt<size; cnt++)
-	{
-		if (glyph_list[cnt]->glyph == glyph)
-			return &(*glyph_list[cnt]);
-	}
+	return get_glyph(font_engine, gc, 0, glyph);
+}
 
-	return NULL;
+int GlyphCache::get_atlas_memory_usage() const
+{
+	if (custom_texture_group)
+		return small_atlas.get_memory_usage();
+	else
+		return small_atlas.get_memory_usage() + large_atlas.get_memory_usage();
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -190,30 +185,7 @@ int GlyphCache::get_character_index(FontEngine *font_engine, GraphicContext &gc,
 
 void GlyphCache::insert_glyph(GraphicContext &gc, FontPixelBuffer &pb)
 {
-	// Search for duplicated glyph's, if found silently ignore them
-	std::vector< Font_TextureGlyph * >::size_type size = glyph_list.size();
-	for (int cnt=0; cnt<size; cnt++)
-	{
-		if (glyph_list[cnt]->glyph == pb.glyph)
-			return ;
-	}
-
-	Font_TextureGlyph *font_glyph = new Font_TextureGlyph();
-	
-	glyph_list.push_back(font_glyph);
-	font_glyph->glyph = pb.glyph;
-	font_glyph->offset = pb.offset;
-	font_glyph->increment = pb.increment;
-
-	if (!pb.empty_buffer)
-	{
-		PixelBuffer buffer_with_border = PixelBufferHelp::add_border(pb.buffer, glyph_border_size, pb.buffer_rect);
-
-		Subtexture sub_texture = texture_group.add(gc, Size(buffer_with_border.get_width(), buffer_with_border.get_height() ));
-		font_glyph->texture = sub_texture.get_texture();
-		font_glyph->geometry = Rect(sub_texture.get_geometry().left + glyph_border_size, sub_texture.get_geometry().top + glyph_border_size, pb.buffer_rect.get_size() );
-		sub_texture.get_texture().set_subimage(gc, sub_texture.get_geometry().left, sub_texture.get_geometry().top, buffer_with_border, buffer_with_border.get_size());
-	}
+	insert_glyph(gc, 0, pb);
 }
 
 void GlyphCache::insert_glyph(FontEngine *font_engine, GraphicContext &gc, const std::string &text)
@@ -227,16 +199,12 @@ void GlyphCache::insert_glyph(FontEngine *font_engine, GraphicContext &gc, const
 void GlyphCache::insert_glyph(GraphicContext &gc, unsigned int glyph, Subtexture &sub_texture, const Point &offset, const Point &increment)
 {
 	// Search for duplicated glyph's, if found silently ignore them
-	std::vector< Font_TextureGlyph * >::size_type size = glyph_list.size();
-	for (int cnt=0; cnt<size; cnt++)
-	{
-		if (glyph_list[cnt]->glyph == glyph)
-			return;
-	}
+	if (glyph_map.find(glyph) != glyph_map.end())
+		return;
 
 	Font_TextureGlyph *font_glyph = new Font_TextureGlyph();
 	
-	glyph_list.push_back(font_glyph);
+	glyph_map[glyph] = font_glyph;
 	font_glyph->glyph = glyph;
 	font_glyph->offset = offset;
 	font_glyph->increment = increment;
@@ -251,24 +219,47 @@ void GlyphCache::insert_glyph(GraphicContext &gc, unsigned int glyph, Subtexture
 
 void GlyphCache::insert_glyph(FontEngine *font_engine, GraphicContext &gc, int glyph)
 {
-	if (enable_subpixel)
+	insert_glyph(font_engine, gc, 0, glyph);
+}
+
+void GlyphCache::prefetch(FontEngine *font_engine, Canvas &canvas, const std::string &text)
+{
+	std::vector<unsigned int> missing_glyphs;
+	UTF8_Reader reader(text.data(), text.length());
+	while(!reader.is_end())
 	{
-		FontPixelBuffer pb = font_engine->get_font_glyph_subpixel(glyph);
-		if (pb.glyph)	// Ignore invalid glyphs
-		{
-			insert_glyph(gc, pb);
-		}
+		unsigned int glyph = reader.get_char();
+		reader.next();
+		if (glyph_map.find(glyph) == glyph_map.end())
+			missing_glyphs.push_back(glyph);
 	}
-	else
+
+	std::sort(missing_glyphs.begin(), missing_glyphs.end());
+	missing_glyphs.erase(std::unique(missing_glyphs.begin(), missing_glyphs.end()), missing_glyphs.end());
+	if (missing_glyphs.empty())
+		return;
+
+	std::vector<FontPixelBuffer> buffers;
+	rasterize_glyphs(font_engine, missing_glyphs, buffers);
+
+	// Textures can only be uploaded on this thread
+	GraphicContext &gc = canvas.get_gc();
+	for (std::vector<FontPixelBuffer>::size_type i = 0; i < buffers.size(); i++)
 	{
-		FontPixelBuffer pb = font_engine->get_font_glyph_standard(glyph, anti_alias);
-		if (pb.glyph)	// Ignore invalid glyphs
-		{
-			insert_glyph(gc, pb);
-		}
+		if (buffers[i].glyph)	// Ignore invalid glyphs
+			insert_glyph(gc, &canvas, buffers[i]);
 	}
 }
 
+void GlyphCache::free_worker_engines()
+{
+	prefetch_queue.reset();
+
+	for (std::vector<FontEngine *>::size_type i = 0; i < worker_engines.size(); i++)
+		delete worker_engines[i];
+	worker_engines.clear();
+}
+
 void GlyphCache::draw_text(FontEngine *font_engine, Canvas &canvas, float xpos, float ypos, const std::string &text, const Colorf &color) 
 {
 	std::string::size_type string_length = text.length();
@@ -286,7 +277,7 @@ void GlyphCache::draw_text(FontEngine *font_engine, Canvas &canvas, float xpos,
 		unsigned int glyph = reader.get_char();
 		reader.next();
 
-		Font_TextureGlyph *gptr = get_glyph(font_engine, gc, glyph);
+		Font_TextureGlyph *gptr = get_glyph(font_engine, gc, &canvas, glyph);
 		if (gptr == NULL) continue;
 
 		if (!gptr->texture.is_null())
@@ -315,12 +306,18 @@ void GlyphCache::set_texture_group(TextureGroup &new_texture_group)
 		throw Exception("Specified texture group is not valid");
 	}
 
-	if (!glyph_list.empty())
+	if (!glyph_map.empty())
 	{
 		throw Exception("Cannot specify a new texture group after the font has been used");
 	}
 
-	texture_group = new_texture_group;
+	small_atlas.texture_group = new_texture_group;
+	custom_texture_group = true;
+}
+
+void GlyphCache::set_atlas_memory_limit(int limit)
+{
+	atlas_memory_limit = limit;
 }
 
 void GlyphCache::set_font_metrics(const FontMetrics &metrics)
@@ -331,4 +328,226 @@ void GlyphCache::set_font_metrics(const FontMetrics &metrics)
 /////////////////////////////////////////////////////////////////////////////
 // GlyphCache Implementation:
 
+Font_TextureGlyph *GlyphCache::get_glyph(FontEngine *font_engine, GraphicContext &gc, Canvas *canvas, unsigned int glyph)
+{
+	Font_TextureGlyph *font_glyph = find_glyph(glyph);
+	if (font_glyph)
+		return font_glyph;
+
+	// If glyph does not exist, create one automatically
+	insert_glyph(font_engine, gc, canvas, glyph);
+
+	GlyphMap::iterator it = glyph_map.find(glyph);
+	return (it != glyph_map.end()) ? it->second : NULL;
+}
+
+Font_TextureGlyph *GlyphCache::find_glyph(unsigned int glyph)
+{
+	GlyphMap::iterator it = glyph_map.find(glyph);
+	if (it == glyph_map.end())
+		return NULL;
+
+	// Mark as most recently used
+	Font_TextureGlyph *font_glyph = it->second;
+	if (font_glyph->atlas)
+		lru_list.splice(lru_list.begin(), lru_list, font_glyph->lru_position);
+
+	return font_glyph;
+}
+
+void GlyphCache::insert_glyph(FontEngine *font_engine, GraphicContext &gc, Canvas *canvas, unsigned int glyph)
+{
+	FontPixelBuffer pb = rasterize_glyph(font_engine, glyph);
+	if (pb.glyph)	// Ignore invalid glyphs
+	{
+		insert_glyph(gc, canvas, pb);
+	}
+}
+
+void GlyphCache::insert_glyph(GraphicContext &gc, Canvas *canvas, FontPixelBuffer &pb)
+{
+	// Search for duplicated glyph's, if found silently ignore them
+	if (glyph_map.find(pb.glyph) != glyph_map.end())
+		return;
+
+	GlyphAtlas *atlas = 0;
+	Subtexture sub_texture;
+	PixelBuffer buffer_with_border;
+	if (!pb.empty_buffer)
+	{
+		buffer_with_border = PixelBufferHelp::add_border(pb.buffer, glyph_border_size, pb.buffer_rect);
+		Size size(buffer_with_border.get_width(), buffer_with_border.get_height());
+		atlas = &get_atlas(size);
+		sub_texture = allocate_subtexture(gc, canvas, *atlas, size);
+	}
+
+	Font_TextureGlyph *font_glyph = new Font_TextureGlyph();
+	
+	glyph_map[pb.glyph] = font_glyph;
+	font_glyph->glyph = pb.glyph;
+	font_glyph->offset = pb.offset;
+	font_glyph->increment = pb.increment;
+
+	if (atlas)
+	{
+		font_glyph->texture = sub_texture.get_texture();
+		font_glyph->geometry = Rect(sub_texture.get_geometry().left + glyph_border_size, sub_texture.get_geometry().top + glyph_border_size, pb.buffer_rect.get_size() );
+		sub_texture.get_texture().set_subimage(gc, sub_texture.get_geometry().left, sub_texture.get_geometry().top, buffer_with_border, buffer_with_border.get_size());
+
+		font_glyph->atlas = atlas;
+		font_glyph->subtexture = sub_texture;
+		lru_list.push_front(font_glyph);
+		font_glyph->lru_position = lru_list.begin();
+	}
+}
+
+FontPixelBuffer GlyphCache::rasterize_glyph(FontEngine *font_engine, unsigned int glyph)
+{
+	if (enable_subpixel)
+		return font_engine->get_font_glyph_subpixel(glyph);
+	else
+		return font_engine->get_font_glyph_standard(glyph, anti_alias);
+}
+
+void GlyphCache::rasterize_glyphs(FontEngine *font_engine, const std::vector<unsigned int> &glyphs, std::vector<FontPixelBuffer> &out_buffers)
+{
+	// Below this amount of glyphs per thread the work queue overhead is larger than the gain
+	const int min_glyphs_per_worker = 16;
+
+	out_buffers.resize(glyphs.size());
+
+	int num_workers = min(System::get_num_cores(), (int)glyphs.size() / min_glyphs_per_worker);
+	while ((int)worker_engines.size() < num_workers)
+	{
+		FontEngine *engine = font_engine->create_worker_engine();
+		if (engine == 0)
+			break;
+		worker_engines.push_back(engine);
+	}
+	num_workers = min(num_workers, (int)worker_engines.size());
+
+	if (num_workers <= 1)
+	{
+		for (std::vector<unsigned int>::size_type i = 0; i < glyphs.size(); i++)
+			out_buffers[i] = rasterize_glyph(font_engine, glyphs[i]);
+		return;
+	}
+
+	if (!prefetch_queue)
+		prefetch_queue.reset(new WorkQueue(false, System::get_num_cores()));
+
+	InterlockedVariable remaining_workers;
+	remaining_workers.set(num_workers);
+	Event done;
+
+	for (int worker = 0; worker < num_workers; worker++)
+	{
+		FontEngine *engine = worker_engines[worker];
+		prefetch_queue->queue([=, &glyphs, &out_buffers, &remaining_workers, &done]()
+		{
+			try
+			{
+				for (std::vector<unsigned int>::size_type i = worker; i < glyphs.size(); i += num_workers)
+					out_buffers[i] = rasterize_glyph(engine, glyphs[i]);
+			}
+			catch (...)
+			{
+				// Glyphs that failed are left invalid and will be rasterized again when used
+			}
+
+			if (remaining_workers.decrement() == 0)
+				done.set();
+		});
+	}
+
+	done.wait();
+}
+
+GlyphAtlas &GlyphCache::get_atlas(const Size &size)
+{
+	if (custom_texture_group || (size.width <= small_glyph_size && size.height <= small_glyph_size))
+		return small_atlas;
+	else
+		return large_atlas;
+}
+
+Subtexture GlyphCache::allocate_subtexture(GraphicContext &gc, Canvas *canvas, GlyphAtlas &atlas, const Size &size)
+{
+	// Number of single glyph evictions before the least recently used page is freed entirely
+	const int max_glyph_evictions = 16;
+
+	Subtexture sub_texture = atlas.texture_group.try_add(gc, size);
+	if (!sub_texture.is_null())
+		return sub_texture;
+
+	// Evicting requires a canvas, as glyphs already batched may refer to the space being reused
+	if (canvas)
+	{
+		Size page_size = atlas.texture_group.get_texture_sizes();
+		int page_memory = max(page_size.width, size.width) * max(page_size.height, size.height) * 4;
+
+		bool batch_flushed = false;
+		int glyph_evictions = 0;
+		// The least recently used glyph may be in another atlas. Evicting it frees its page for this atlas once the page is empty.
+		while (!lru_list.empty() && get_atlas_memory_usage() + page_memory > atlas_memory_limit)
+		{
+			if (!batch_flushed)
+			{
+				canvas->flush();
+				batch_flushed = true;
+			}
+
+			// Evicted glyphs may leave holes too small for the new glyph. Repack by emptying the page of the least recently used glyph.
+			if (glyph_evictions == max_glyph_evictions)
+			{
+				evict_page(lru_list.back()->subtexture.get_texture());
+				glyph_evictions = 0;
+			}
+			else
+			{
+				evict_glyph(lru_list.back());
+				glyph_evictions++;
+			}
+
+			sub_texture = atlas.texture_group.try_add(gc, size);
+			if (!sub_texture.is_null())
+				return sub_texture;
+		}
+	}
+
+	return atlas.texture_group.add(gc, size);
+}
+
+void GlyphCache::evict_glyph(Font_TextureGlyph *font_glyph)
+{
+	font_glyph->atlas->texture_group.remove(font_glyph->subtexture);
+	lru_list.erase(font_glyph->lru_position);
+	glyph_map.erase(font_glyph->glyph);
+	delete font_glyph;
+}
+
+void GlyphCache::evict_page(const Texture2D &texture)
+{
+	std::list<Font_TextureGlyph *>::iterator it = lru_list.begin();
+	while (it != lru_list.end())
+	{
+		Font_TextureGlyph *font_glyph = *it;
+		++it;
+		if (font_glyph->texture == texture)
+			evict_glyph(font_glyph);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// GlyphAtlas Attributes:
+
+int GlyphAtlas::get_memory_usage() const
+{
+	int memory = 0;
+	std::vector<Texture2D> textures = texture_group.get_textures();
+	for (std::vector<Texture2D>::size_type i = 0; i < textures.size(); i++)
+		memory += textures[i].get_width() * textures[i].get_height() * 4;
+	return memory;
+}
+
 }
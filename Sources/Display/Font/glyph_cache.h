@@ -34,8 +34,10 @@
 #include "API/Display/2D/texture_group.h"
 #include "API/Display/2D/subtexture.h"
 #include "API/Display/Render/texture_2d.h"
+#include "API/Core/System/work_queue.h"
 #include <list>
 #include <map>
+#include <unordered_map>
 
 namespace clan
 {
@@ -44,6 +46,7 @@ class Colorf;
 class TextureGroup;
 class FontEngine;
 class Font_TextureGlyph;
+class GlyphAtlas;
 class Subtexture;
 class FontPixelBuffer;
 
@@ -51,7 +54,7 @@ class FontPixelBuffer;
 class Font_TextureGlyph
 {
 public:
-	Font_TextureGlyph() : glyph(0) { };
+	Font_TextureGlyph() : glyph(0), atlas(0) { };
 
 	/// \brief Glyph this pixel buffer refers to.
 	unsigned int glyph;
@@ -75,6 +78,27 @@ public:
 	    pos_x += pixelbuffer.increment.x;
 	    pos_y += pixelbuffer.increment.y;*/
 	Point increment;
+
+	/// \brief Atlas the glyph was allocated in. NULL if the glyph cannot be evicted
+	GlyphAtlas *atlas;
+
+	/// \brief Space allocated in the atlas (including the border)
+	Subtexture subtexture;
+
+	/// \brief Position in the least recently used list of the glyph cache
+	std::list<Font_TextureGlyph *>::iterator lru_position;
+};
+
+/// \brief Atlas pages of one size
+class GlyphAtlas
+{
+public:
+	GlyphAtlas(const Size &page_size) : texture_group(page_size) { }
+
+	/// \brief Returns the texture memory used by the pages, in bytes
+	int get_memory_usage() const;
+
+	TextureGroup texture_group;
 };
 
 class GlyphCache
@@ -96,6 +120,9 @@ public:
 	/// \brief Get a glyph. Returns NULL if the glyph was not found
 	Font_TextureGlyph *get_glyph(FontEngine *font_engine, GraphicContext &gc, unsigned int glyph);
 
+	/// \brief Returns the texture memory used by the glyph atlas pages, in bytes
+	int get_atlas_memory_usage() const;
+
 /// \}
 /// \name Operations
 /// \{
@@ -112,6 +139,9 @@ public:
 
 	void set_texture_group(TextureGroup &new_texture_group);
 
+	/// \brief Set the texture memory the glyph atlas pages may use before glyphs are evicted, in bytes
+	void set_atlas_memory_limit(int limit);
+
 	int get_character_index(FontEngine *font_engine, GraphicContext &gc, const std::string &text, const Point &point);
 
 	void insert_glyph(GraphicContext &gc, unsigned int glyph, Subtexture &sub_texture, const Point &offset, const Point &increment);
@@ -119,6 +149,14 @@ public:
 	void insert_glyph(GraphicContext &gc, FontPixelBuffer &pb);
 	void insert_glyph(FontEngine *font_engine, GraphicContext &gc, const std::string &text);
 
+	/// \brief Rasterizes all glyphs in text that are not cached yet
+	///
+	/// The glyphs are rasterized in parallel when the font engine supports it.
+	void prefetch(FontEngine *font_engine, Canvas &canvas, const std::string &text);
+
+	/// \brief Frees the font engines used by prefetch(). Must be called before the font engine is destroyed.
+	void free_worker_engines();
+
 /// \}
 /// \name Implementation
 /// \{
@@ -126,11 +164,36 @@ private:
 	/// \brief Set the font metrics from the OS font
 	void write_font_metrics(GraphicContext &gc);
 
-	std::vector<Font_TextureGlyph* > glyph_list;
+	Font_TextureGlyph *get_glyph(FontEngine *font_engine, GraphicContext &gc, Canvas *canvas, unsigned int glyph);
+	Font_TextureGlyph *find_glyph(unsigned int glyph);
+	void insert_glyph(FontEngine *font_engine, GraphicContext &gc, Canvas *canvas, unsigned int glyph);
+	void insert_glyph(GraphicContext &gc, Canvas *canvas, FontPixelBuffer &pb);
+	FontPixelBuffer rasterize_glyph(FontEngine *font_engine, unsigned int glyph);
+	void rasterize_glyphs(FontEngine *font_engine, const std::vector<unsigned int> &glyphs, std::vector<FontPixelBuffer> &out_buffers);
 
-	TextureGroup texture_group;
+	GlyphAtlas &get_atlas(const Size &size);
+	Subtexture allocate_subtexture(GraphicContext &gc, Canvas *canvas, GlyphAtlas &atlas, const Size &size);
+	void evict_glyph(Font_TextureGlyph *font_glyph);
+	void evict_page(const Texture2D &texture);
+
+	typedef std::unordered_map<unsigned int, Font_TextureGlyph *> GlyphMap;
+	GlyphMap glyph_map;
+
+	// Small glyphs and large glyphs use separate pages, to reduce fragmentation when glyphs are evicted
+	GlyphAtlas small_atlas;
+	GlyphAtlas large_atlas;
+	bool custom_texture_group;
+	int atlas_memory_limit;
+
+	// Glyphs of all atlases, most recently used first. A single list keeps the memory limit shared between the atlases
+	std::list<Font_TextureGlyph *> lru_list;
+
+	std::vector<FontEngine *> worker_engines;
+	std::unique_ptr<WorkQueue> prefetch_queue;
 
 	static const int glyph_border_size = 1;
+	static const int small_glyph_size = 32;
+	static const int default_atlas_memory_limit = 16*1024*1024;
 
 public:
 	// Contains the anti alias setting
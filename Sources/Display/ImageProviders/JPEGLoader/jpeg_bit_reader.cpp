@@ -34,50 +34,69 @@ namespace clan
 {
 
 JPEGBitReader::JPEGBitReader(JPEGFileReader *reader)
-: reader(reader), length(0), pos(0), bitpos(0)
+: reader(reader), data(0), length(0), pos(0), bit_buffer(0), bit_count(0), padding_bits(0), end_of_data(false)
 {
 	buffer.resize(16*1024);
+	data = &buffer[0];
+}
+
+JPEGBitReader::JPEGBitReader(const unsigned char *data, int length)
+: reader(0), data(data), length(length), pos(0), bit_buffer(0), bit_count(0), padding_bits(0), end_of_data(false)
+{
 }
 
 void JPEGBitReader::reset()
 {
 	length = 0;
 	pos = 0;
-	bitpos = 0;
-	buffer.resize(16*1024);
+	bit_buffer = 0;
+	bit_count = 0;
+	padding_bits = 0;
+	end_of_data = false;
 }
 
-unsigned int JPEGBitReader::get_bit()
+void JPEGBitReader::fill()
 {
-	if (bitpos == 8)
+	while (bit_count <= 56)
 	{
-		pos++;
-		bitpos = 0;
-	}
-	if (pos == length)
-	{
-		length = reader->read_entropy_data(&buffer[0], buffer.size());
-		if (length == 0)
+		if (pos == length)
 		{
-			//JPEGMarker marker = reader->read_marker();
-			throw Exception("Premature end of JPEG entropy data");
+			if (reader && !end_of_data)
+			{
+				length = reader->read_entropy_data(&buffer[0], buffer.size());
+				pos = 0;
+			}
+
+			if (pos == length)
+			{
+				// Pad with zero bits so that codes at the very end can be looked up.
+				// skip_bits throws if any of them are consumed.
+				end_of_data = true;
+				int bytes = (64 - bit_count) >> 3;
+				bit_count += bytes * 8;
+				padding_bits += bytes * 8;
+				return;
+			}
 		}
-		pos = 0;
-	}
 
-	unsigned int v = (buffer[pos] >> (7-bitpos)) & 0x01;
-	bitpos++;
-	return v;
-}
+		if (length - pos >= 8)
+		{
+			// Bulk refill. Bits of the partially loaded last byte are loaded again by the next refill.
+			const unsigned char *p = data + pos;
+			ubyte64 v =
+				(((ubyte64)p[0]) << 56) | (((ubyte64)p[1]) << 48) | (((ubyte64)p[2]) << 40) | (((ubyte64)p[3]) << 32) |
+				(((ubyte64)p[4]) << 24) | (((ubyte64)p[5]) << 16) | (((ubyte64)p[6]) << 8) | ((ubyte64)p[7]);
+			int bytes = (64 - bit_count) >> 3;
+			bit_buffer |= v >> bit_count;
+			bit_count += bytes * 8;
+			pos += bytes;
+			return;
+		}
 
-unsigned int JPEGBitReader::get_bits(int count)
-{
-	int v = 0;
-	for (int i = 0; i < count; i++)
-	{
-		v = (v << 1)|get_bit();
+		bit_buffer |= ((ubyte64)data[pos]) << (56 - bit_count);
+		bit_count += 8;
+		pos++;
 	}
-	return v;
 }
 
 }
@@ -36,18 +36,59 @@ class JPEGFileReader;
 class JPEGBitReader
 {
 public:
+	/// \brief Reads the entropy coded data following the current file position
 	JPEGBitReader(JPEGFileReader *reader);
 
+	/// \brief Reads an entropy coded segment already in memory, with the byte stuffing removed
+	JPEGBitReader(const unsigned char *data, int length);
+
 	void reset();
-	unsigned int get_bit();
-	unsigned int get_bits(int count);
+
+	unsigned int get_bit()
+	{
+		return get_bits(1);
+	}
+
+	unsigned int get_bits(int count)
+	{
+		unsigned int v = peek_bits(count);
+		skip_bits(count);
+		return v;
+	}
+
+	/// \brief Returns the next count bits (at most 16) without consuming them
+	unsigned int peek_bits(int count)
+	{
+		if (bit_count < count)
+			fill();
+		return count ? (unsigned int)(bit_buffer >> (64 - count)) : 0;
+	}
+
+	/// \brief Consumes bits previously returned by peek_bits
+	void skip_bits(int count)
+	{
+		bit_buffer <<= count;
+		bit_count -= count;
+		if (bit_count < padding_bits)
+			throw Exception("Premature end of JPEG entropy data");
+	}
 
 private:
+	void fill();
+
 	JPEGFileReader *reader;
 	std::vector<unsigned char> buffer;
+	const unsigned char *data;
 	int length;
 	int pos;
-	int bitpos;
+
+	// The next bits of the stream, most significant bit first
+	ubyte64 bit_buffer;
+	int bit_count;
+
+	// Zero bits appended to bit_buffer after the end of the entropy data
+	int padding_bits;
+	bool end_of_data;
 };
 
 }
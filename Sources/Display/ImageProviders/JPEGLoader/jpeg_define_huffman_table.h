@@ -38,6 +38,10 @@ class JPEGHuffmanTable
 public:
 	JPEGHuffmanTable() : table_class(dc_table), table_index(0) { for (int i = 0; i < 16; i++) bits[i] = 0; }
 	void build_tree();
+	void build_lookup();
+
+	// Number of bits decoded with a single table lookup
+	enum { lookahead_bits = 9 };
 
 	enum TableClass
 	{
@@ -53,6 +57,14 @@ public:
 	std::vector<ubyte8> values;
 
 	std::vector<JPEGHuffmanNode> tree;
+
+	// Code length in the high byte and the value in the low byte for every lookahead_bits prefix.
+	// Zero if the code is longer than lookahead_bits.
+	ubyte16 lookup[1 << lookahead_bits];
+
+	// Largest code of each length (-1 if none) and offset from a code of that length to its value index
+	int maxcode[17];
+	int valoffset[17];
 };
 
 typedef std::vector<JPEGHuffmanTable> JPEGDefineHuffmanTable;
@@ -100,6 +112,37 @@ inline void JPEGHuffmanTable::build_tree()
 		}
 		nodes = child_nodes - bits[level];
 	}
+
+	build_lookup();
+}
+
+inline void JPEGHuffmanTable::build_lookup()
+{
+	memset(lookup, 0, sizeof(lookup));
+
+	int code = 0;
+	int values_index = 0;
+	maxcode[0] = -1;
+	valoffset[0] = 0;
+	for (int length = 1; length <= 16; length++)
+	{
+		int count = bits[length-1];
+		if (values_index + count > (int)values.size() || code + count > (1 << length))
+			throw Exception("Invalid JPEG File");
+
+		valoffset[length] = values_index - code;
+		for (int i = 0; i < count; i++, code++, values_index++)
+		{
+			if (length <= lookahead_bits)
+			{
+				int shift = lookahead_bits - length;
+				for (int j = 0; j < (1 << shift); j++)
+					lookup[(code << shift) + j] = (length << 8) | values[values_index];
+			}
+		}
+		maxcode[length] = count ? code - 1 : -1;
+		code <<= 1;
+	}
 }
 
 }
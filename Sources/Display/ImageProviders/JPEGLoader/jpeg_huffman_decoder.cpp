@@ -36,15 +36,24 @@ namespace clan
 
 unsigned int JPEGHuffmanDecoder::decode(JPEGBitReader &reader, const JPEGHuffmanTable &table)
 {
-	int node = 0;
-	while (true)
+	unsigned int bits = reader.peek_bits(16);
+
+	// Most codes are short enough to be found with a single table lookup
+	unsigned int entry = table.lookup[bits >> (16 - JPEGHuffmanTable::lookahead_bits)];
+	if (entry != 0)
+	{
+		reader.skip_bits(entry >> 8);
+		return entry & 0xff;
+	}
+
+	for (int length = JPEGHuffmanTable::lookahead_bits + 1; length <= 16; length++)
 	{
-		unsigned int bit = reader.get_bit();
-		node = table.tree[node].children[bit];
-		if (node == 0 || node == table.tree.size())
-			break;
-		else if (table.tree[node].leaf)
-			return table.tree[node].value;
+		int code = bits >> (16 - length);
+		if (code <= table.maxcode[length])
+		{
+			reader.skip_bits(length);
+			return table.values[code + table.valoffset[length]];
+		}
 	}
 	throw Exception("Invalid JPEG Huffman encoding");
 }
@@ -53,6 +62,8 @@ short JPEGHuffmanDecoder::decode_number(JPEGBitReader &reader, int length)
 {
 	if (length == 0)
 		return 0;
+	else if (length > 16)
+		throw Exception("Invalid JPEG Huffman encoding");
 	int v = reader.get_bits(length);
 	if ((v) < (1 << ((length) - 1)))
 		return (v) + (((-1) << (length)) + 1);
@@ -32,30 +32,163 @@
 #include "jpeg_huffman_decoder.h"
 #include "jpeg_mcu_decoder.h"
 #include "jpeg_rgb_decoder.h"
+#include "API/Core/System/system.h"
+#include "API/Core/System/event.h"
+#include "API/Core/System/mutex.h"
+#include "API/Core/System/interlocked_variable.h"
 
 namespace clan
 {
 
+/// \brief Completion state of work spread over the work queue of a JPEGLoader
+class JPEGParallelWork
+{
+public:
+	JPEGParallelWork(int num_items) : failed(false)
+	{
+		items_remaining.set(num_items);
+	}
+
+	void item_done()
+	{
+		if (items_remaining.decrement() == 0)
+			done_event.set();
+	}
+
+	void item_failed(const std::string &message)
+	{
+		MutexSection mutex_lock(&mutex);
+		if (!failed)
+		{
+			failed = true;
+			error_message = message;
+		}
+	}
+
+	void wait()
+	{
+		done_event.wait();
+		if (failed)
+			throw Exception(error_message);
+	}
+
+private:
+	InterlockedVariable items_remaining;
+	Event done_event;
+	Mutex mutex;
+	bool failed;
+	std::string error_message;
+};
+
+/// \brief Entropy decodes a range of restart intervals of a sequential scan
+class JPEGRestartIntervalsWorkItem : public WorkItem
+{
+public:
+	JPEGRestartIntervalsWorkItem(const std::shared_ptr<JPEGParallelWork> &work, JPEGLoader *loader, const JPEGStartOfScan *start_of_scan, const std::vector<int> *component_to_sof, const unsigned char *data, const int *offsets, int first_interval, int end_interval)
+	: work(work), loader(loader), start_of_scan(start_of_scan), component_to_sof(component_to_sof), data(data), offsets(offsets), first_interval(first_interval), end_interval(end_interval)
+	{
+	}
+
+	void process_work()
+	{
+		try
+		{
+			loader->decode_restart_intervals(*start_of_scan, *component_to_sof, data, offsets, first_interval, end_interval);
+		}
+		catch (Exception &e)
+		{
+			work->item_failed(e.message);
+		}
+		catch (...)
+		{
+			work->item_failed("Unable to decode JPEG entropy data");
+		}
+		work->item_done();
+	}
+
+private:
+	std::shared_ptr<JPEGParallelWork> work;
+	JPEGLoader *loader;
+	const JPEGStartOfScan *start_of_scan;
+	const std::vector<int> *component_to_sof;
+	const unsigned char *data;
+	const int *offsets;
+	int first_interval;
+	int end_interval;
+};
+
+/// \brief Converts a band of MCU rows to pixels
+class JPEGPixelRowsWorkItem : public WorkItem
+{
+public:
+	JPEGPixelRowsWorkItem(const std::shared_ptr<JPEGParallelWork> &work, JPEGLoader *loader, unsigned int *image_pixels, int start_mcu_row, int end_mcu_row)
+	: work(work), loader(loader), image_pixels(image_pixels), start_mcu_row(start_mcu_row), end_mcu_row(end_mcu_row)
+	{
+	}
+
+	void process_work()
+	{
+		try
+		{
+			loader->decode_pixels(image_pixels, start_mcu_row, end_mcu_row);
+		}
+		catch (Exception &e)
+		{
+			work->item_failed(e.message);
+		}
+		catch (...)
+		{
+			work->item_failed("Unable to decode JPEG image");
+		}
+		work->item_done();
+	}
+
+private:
+	std::shared_ptr<JPEGParallelWork> work;
+	JPEGLoader *loader;
+	unsigned int *image_pixels;
+	int start_mcu_row;
+	int end_mcu_row;
+};
+
+Mutex JPEGLoader::work_queue_mutex;
+WorkQueue *JPEGLoader::work_queue = 0;
+bool JPEGLoader::parallel_decode_forced = false;
+bool JPEGLoader::instructions_selected = false;
+JPEGProvider::DecoderInstructions JPEGLoader::selected_instructions = JPEGProvider::decoder_scalar;
+
 PixelBuffer JPEGLoader::load(IODevice iodevice, bool srgb)
 {
 	JPEGLoader loader(iodevice);
-	JPEGMCUDecoder mcu_decoder(&loader);
-	JPEGRGBDecoder rgb_decoder(&loader);
 
-	int image_width = loader.start_of_frame.width;
-	int image_height = loader.start_of_frame.height;
-	PixelBuffer image(image_width, image_height, srgb ? tf_srgb8_alpha8 : tf_rgba8);
+	PixelBuffer image(loader.start_of_frame.width, loader.start_of_frame.height, srgb ? tf_srgb8_alpha8 : tf_rgba8);
 	unsigned int *image_pixels = reinterpret_cast<unsigned int *>(image.get_data());
 
+	if (loader.parallel_decode)
+		loader.decode_pixels_parallel(image_pixels);
+	else
+		loader.decode_pixels(image_pixels, 0, loader.mcu_height);
+
+	return image;
+}
+
+void JPEGLoader::decode_pixels(unsigned int *image_pixels, int start_mcu_row, int end_mcu_row)
+{
+	JPEGMCUDecoder mcu_decoder(this);
+	JPEGRGBDecoder rgb_decoder(this);
+
+	int image_width = start_of_frame.width;
+	int image_height = start_of_frame.height;
+
 	const unsigned int *block_pixels = rgb_decoder.get_pixels();
 	int block_width = rgb_decoder.get_width();
 	int block_height = rgb_decoder.get_height();
 
-	for (int curMcuY = 0, y = 0; curMcuY < loader.mcu_height; curMcuY++, y += block_height)
+	for (int curMcuY = start_mcu_row, y = start_mcu_row * block_height; curMcuY < end_mcu_row; curMcuY++, y += block_height)
 	{
-		for (int curMcuX = 0, x = 0; curMcuX < loader.mcu_width; curMcuX++, x += block_width)
+		for (int curMcuX = 0, x = 0; curMcuX < mcu_width; curMcuX++, x += block_width)
 		{
-			mcu_decoder.decode(curMcuX + curMcuY * loader.mcu_width);
+			mcu_decoder.decode(curMcuX + curMcuY * mcu_width);
 			rgb_decoder.decode(&mcu_decoder);
 
 			int w = min(block_width, image_width-x);
@@ -74,12 +207,25 @@ PixelBuffer JPEGLoader::load(IODevice iodevice, bool srgb)
 			}
 		}
 	}
+}
 
-	return image;
+void JPEGLoader::decode_pixels_parallel(unsigned int *image_pixels)
+{
+	// A few bands per thread, so threads finishing early can take over the remaining bands
+	WorkQueue &queue = get_work_queue();
+	int num_bands = min(mcu_height, max(queue.get_num_threads(), 1) * 4);
+	std::shared_ptr<JPEGParallelWork> work(new JPEGParallelWork(num_bands));
+	std::vector<WorkItem *> items;
+	items.reserve(num_bands);
+	for (int band = 0; band < num_bands; band++)
+		items.push_back(new JPEGPixelRowsWorkItem(work, this, image_pixels, band * mcu_height / num_bands, (band + 1) * mcu_height / num_bands));
+	queue.queue_batch(items);
+	work->wait();
 }
 
 JPEGLoader::JPEGLoader(IODevice iodevice)
-: progressive(false), scan_count(0), mcu_x(0), mcu_y(0), mcu_width(0), mcu_height(0), restart_interval(0), eobrun(0), is_jfif_jpeg(false), is_adobe_jpeg(false), adobe_app14_transform(1)
+: progressive(false), scan_count(0), mcu_x(0), mcu_y(0), mcu_width(0), mcu_height(0), restart_interval(0), eobrun(0), parallel_decode(false), instructions(get_instructions()),
+  is_jfif_jpeg(false), is_adobe_jpeg(false), adobe_app14_transform(1)
 {
 	JPEGFileReader reader(iodevice);
 
@@ -306,6 +452,12 @@ void JPEGLoader::process_sos_sequential(JPEGStartOfScan &start_of_scan, std::vec
 	verify_dc_table_selector(start_of_scan);
 	verify_ac_table_selector(start_of_scan);
 
+	if (is_parallel_decode_possible())
+	{
+		process_sos_sequential_parallel(start_of_scan, component_to_sof, reader);
+		return;
+	}
+
 	JPEGBitReader bit_reader(&reader);
 	int restart_counter = 0;
 	for (int mcu_block = 0; mcu_block < mcu_width*mcu_height; mcu_block++)
@@ -325,46 +477,167 @@ void JPEGLoader::process_sos_sequential(JPEGStartOfScan &start_of_scan, std::vec
 		}
 		restart_counter++;
 
-		for (size_t c = 0; c < start_of_scan.components.size(); c++)
+		decode_sequential_mcu(start_of_scan, component_to_sof, bit_reader, mcu_block, last_dc_values);
+	}
+}
+
+bool JPEGLoader::is_parallel_decode_possible() const
+{
+	if (restart_interval == 0 || restart_interval >= mcu_width*mcu_height)
+		return false;
+	return parallel_decode_forced || (mcu_width*mcu_height >= min_parallel_mcus && System::get_num_cores() > 1);
+}
+
+WorkQueue &JPEGLoader::get_work_queue()
+{
+	MutexSection mutex_lock(&work_queue_mutex);
+	// At least two threads, so a forced parallel decode on a single core still runs work items concurrently
+	if (!work_queue)
+		work_queue = new WorkQueue(false, max(System::get_num_cores(), 2));
+	return *work_queue;
+}
+
+void JPEGLoader::free_work_queue()
+{
+	MutexSection mutex_lock(&work_queue_mutex);
+	delete work_queue;
+	work_queue = 0;
+}
+
+bool JPEGLoader::is_instructions_supported(JPEGProvider::DecoderInstructions instructions)
+{
+	return JPEGMCUDecoder::is_supported(instructions);
+}
+
+JPEGProvider::DecoderInstructions JPEGLoader::get_instructions()
+{
+	if (instructions_selected)
+		return selected_instructions;
+	else if (is_instructions_supported(JPEGProvider::decoder_avx2))
+		return JPEGProvider::decoder_avx2;
+	else if (is_instructions_supported(JPEGProvider::decoder_sse2))
+		return JPEGProvider::decoder_sse2;
+	else
+		return JPEGProvider::decoder_scalar;
+}
+
+void JPEGLoader::set_instructions(JPEGProvider::DecoderInstructions instructions)
+{
+	if (!is_instructions_supported(instructions))
+		throw Exception("JPEG decoder instructions not supported by this CPU");
+	selected_instructions = instructions;
+	instructions_selected = true;
+}
+
+void JPEGLoader::set_parallel_decode_forced(bool force)
+{
+	parallel_decode_forced = force;
+}
+
+// Restart intervals are independent of each other, so the entropy coded segments between
+// the restart markers are read into memory and decoded on several threads.
+void JPEGLoader::process_sos_sequential_parallel(JPEGStartOfScan &start_of_scan, const std::vector<int> &component_to_sof, JPEGFileReader &reader)
+{
+	int num_intervals = (mcu_width*mcu_height + restart_interval - 1) / restart_interval;
+
+	std::vector<unsigned char> data;
+	std::vector<int> offsets;
+	offsets.reserve(num_intervals + 1);
+	for (int interval = 0; interval < num_intervals; interval++)
+	{
+		if (interval > 0)
+		{
+			JPEGMarker marker = reader.read_marker();
+			if (marker < marker_rst0 || marker > marker_rst7)
+			{
+				throw Exception("Restart marker missing between JPEG entropy data");
+			}
+		}
+
+		offsets.push_back(data.size());
+		while (true)
+		{
+			size_t pos = data.size();
+			data.resize(pos + 16*1024);
+			int length = reader.read_entropy_data(&data[pos], 16*1024);
+			data.resize(pos + length);
+			if (length == 0)
+				break;
+		}
+	}
+	offsets.push_back(data.size());
+	data.resize(data.size() + 1); // Keeps &data[0] valid when all segments are empty
+
+	parallel_decode = true;
+
+	WorkQueue &queue = get_work_queue();
+	int num_groups = min(num_intervals, max(queue.get_num_threads(), 1) * 4);
+	std::shared_ptr<JPEGParallelWork> work(new JPEGParallelWork(num_groups));
+	std::vector<WorkItem *> items;
+	items.reserve(num_groups);
+	for (int group = 0; group < num_groups; group++)
+		items.push_back(new JPEGRestartIntervalsWorkItem(work, this, &start_of_scan, &component_to_sof, &data[0], &offsets[0], group * num_intervals / num_groups, (group + 1) * num_intervals / num_groups));
+	queue.queue_batch(items);
+	work->wait();
+}
+
+void JPEGLoader::decode_restart_intervals(const JPEGStartOfScan &start_of_scan, const std::vector<int> &component_to_sof, const unsigned char *data, const int *offsets, int first_interval, int end_interval)
+{
+	int num_mcus = mcu_width*mcu_height;
+	std::vector<short> dc_values(last_dc_values.size());
+	for (int interval = first_interval; interval < end_interval; interval++)
+	{
+		JPEGBitReader bit_reader(data + offsets[interval], offsets[interval + 1] - offsets[interval]);
+		for (size_t i = 0; i < dc_values.size(); i++)
+			dc_values[i] = 0;
+
+		int end_mcu = min((interval + 1) * restart_interval, num_mcus);
+		for (int mcu_block = interval * restart_interval; mcu_block < end_mcu; mcu_block++)
+			decode_sequential_mcu(start_of_scan, component_to_sof, bit_reader, mcu_block, dc_values);
+	}
+}
+
+void JPEGLoader::decode_sequential_mcu(const JPEGStartOfScan &start_of_scan, const std::vector<int> &component_to_sof, JPEGBitReader &bit_reader, int mcu_block, std::vector<short> &dc_values)
+{
+	for (size_t c = 0; c < start_of_scan.components.size(); c++)
+	{
+		int c_sof = component_to_sof[c];
+		const JPEGHuffmanTable &dc_table = huffman_dc_tables[start_of_scan.components[c].dc_table_selector];
+		const JPEGHuffmanTable &ac_table = huffman_ac_tables[start_of_scan.components[c].ac_table_selector];
+		int scale_x = start_of_frame.components[c_sof].horz_sampling_factor;
+		int scale_y = start_of_frame.components[c_sof].vert_sampling_factor;
+		for (int i = 0; i < scale_x * scale_y; i++)
 		{
-			int c_sof = component_to_sof[c];
-			const JPEGHuffmanTable &dc_table = huffman_dc_tables[start_of_scan.components[c].dc_table_selector];
-			const JPEGHuffmanTable &ac_table = huffman_ac_tables[start_of_scan.components[c].ac_table_selector];
-			int scale_x = start_of_frame.components[c_sof].horz_sampling_factor;
-			int scale_y = start_of_frame.components[c_sof].vert_sampling_factor;
-			for (int i = 0; i < scale_x * scale_y; i++)
+			short *dct = component_dcts[c_sof].get(mcu_block*scale_x*scale_y+i);
+			for (int j = start_of_scan.start_dct_coefficient; j <= start_of_scan.end_dct_coefficient; j++)
 			{
-				short *dct = component_dcts[c_sof].get(mcu_block*scale_x*scale_y+i);
-				for (int j = start_of_scan.start_dct_coefficient; j <= start_of_scan.end_dct_coefficient; j++)
+				if (j == 0) // DCT DC coefficient
 				{
-					if (j == 0) // DCT DC coefficient
-					{
-						unsigned int code = JPEGHuffmanDecoder::decode(bit_reader, dc_table);
-						if (code != huffman_eob)
-							dct[0] = JPEGHuffmanDecoder::decode_number(bit_reader, code);
-						dct[0] <<= start_of_scan.point_transform;
+					unsigned int code = JPEGHuffmanDecoder::decode(bit_reader, dc_table);
+					if (code != huffman_eob)
+						dct[0] = JPEGHuffmanDecoder::decode_number(bit_reader, code);
+					dct[0] <<= start_of_scan.point_transform;
 
-						dct[0] += last_dc_values[c_sof];
-						last_dc_values[c_sof] = dct[0];
-					}
-					else // DCT AC coefficient
+					dct[0] += dc_values[c_sof];
+					dc_values[c_sof] = dct[0];
+				}
+				else // DCT AC coefficient
+				{
+					unsigned int code = JPEGHuffmanDecoder::decode(bit_reader, ac_table);
+					if (code != huffman_eob)
 					{
-						unsigned int code = JPEGHuffmanDecoder::decode(bit_reader, ac_table);
-						if (code != huffman_eob)
+						unsigned int zeros = (code>>4);
+						j += zeros;
+						if (j <= start_of_scan.end_dct_coefficient)
 						{
-							unsigned int zeros = (code>>4);
-							j += zeros;
-							if (j <= start_of_scan.end_dct_coefficient)
-							{
-								dct[zigzag_map[j]] = JPEGHuffmanDecoder::decode_number(bit_reader, code & 0x0f);
-								dct[zigzag_map[j]] <<= start_of_scan.point_transform;
-							}
-						}
-						else
-						{
-							break;
+							dct[zigzag_map[j]] = JPEGHuffmanDecoder::decode_number(bit_reader, code & 0x0f);
+							dct[zigzag_map[j]] <<= start_of_scan.point_transform;
 						}
 					}
+					else
+					{
+						break;
+					}
 				}
 			}
 		}
@@ -37,6 +37,9 @@
 #include "jpeg_define_quantization_table.h"
 #include "jpeg_component_dcts.h"
 #include "jpeg_markers.h"
+#include "API/Core/System/work_queue.h"
+#include "API/Core/System/mutex.h"
+#include "API/Display/ImageProviders/jpeg_provider.h"
 
 namespace clan
 {
@@ -48,6 +51,14 @@ class JPEGLoader
 public:
 	static PixelBuffer load(IODevice iodevice, bool srgb);
 
+	static bool is_instructions_supported(JPEGProvider::DecoderInstructions instructions);
+	static JPEGProvider::DecoderInstructions get_instructions();
+	static void set_instructions(JPEGProvider::DecoderInstructions instructions);
+	static void set_parallel_decode_forced(bool force);
+
+	/// \brief Destroys the work queue shared by all loaders. Called by SetupDisplay.
+	static void free_work_queue();
+
 private:
 	enum ColorSpace
 	{
@@ -65,6 +76,13 @@ private:
 	void process_dnl(JPEGFileReader &reader);
 	void process_sos(JPEGFileReader &reader);
 	void process_sos_sequential(JPEGStartOfScan &start_of_scan, std::vector<int> component_to_sof, JPEGFileReader &reader);
+	void process_sos_sequential_parallel(JPEGStartOfScan &start_of_scan, const std::vector<int> &component_to_sof, JPEGFileReader &reader);
+	void decode_sequential_mcu(const JPEGStartOfScan &start_of_scan, const std::vector<int> &component_to_sof, JPEGBitReader &bit_reader, int mcu_block, std::vector<short> &dc_values);
+	void decode_restart_intervals(const JPEGStartOfScan &start_of_scan, const std::vector<int> &component_to_sof, const unsigned char *data, const int *offsets, int first_interval, int end_interval);
+	void decode_pixels(unsigned int *image_pixels, int start_mcu_row, int end_mcu_row);
+	void decode_pixels_parallel(unsigned int *image_pixels);
+	bool is_parallel_decode_possible() const;
+	static WorkQueue &get_work_queue();
 	void process_sos_progressive(JPEGStartOfScan &start_of_scan, std::vector<int> component_to_sof, JPEGFileReader &reader);
 	void process_dqt(JPEGFileReader &reader);
 	void process_dht(JPEGFileReader &reader);
@@ -88,14 +106,33 @@ private:
 	int eobrun;
 	std::vector<short> last_dc_values;
 
+	// True when the image has restart intervals and is large enough to be decoded on several cores
+	bool parallel_decode;
+
+	// Instructions used by the IDCT and color conversion, fixed when the loader is created
+	JPEGProvider::DecoderInstructions instructions;
+
 	bool is_jfif_jpeg;
 	bool is_adobe_jpeg;
 	int adobe_app14_transform;
 
 	static int zigzag_map[64];
 
+	// Images smaller than this number of MCUs are decoded on the calling thread, unless parallel decoding is forced
+	static const int min_parallel_mcus = 512;
+
+	// Created on first use and shared by all loaders, so decoding many images does not start a thread pool per image
+	static Mutex work_queue_mutex;
+	static WorkQueue *work_queue;
+
+	static bool parallel_decode_forced;
+	static bool instructions_selected;
+	static JPEGProvider::DecoderInstructions selected_instructions;
+
 	friend class JPEGMCUDecoder;
 	friend class JPEGRGBDecoder;
+	friend class JPEGRestartIntervalsWorkItem;
+	friend class JPEGPixelRowsWorkItem;
 };
 
 }
@@ -35,6 +35,17 @@
 #ifndef ARM_PLATFORM
 #include <xmmintrin.h>
 #include <emmintrin.h>
+
+#if defined(_MSC_VER) && _MSC_VER >= 1800
+	#define CL_JPEG_AVX2
+	#define cl_target_avx2
+	#include <immintrin.h>
+#elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+	#define CL_JPEG_AVX2
+	#define cl_target_avx2 __attribute__((target("avx2")))
+	#include <immintrin.h>
+#endif
+
 #endif
 #endif // not DISABLE_SSE2
 
@@ -42,7 +53,7 @@ namespace clan
 {
 
 JPEGMCUDecoder::JPEGMCUDecoder(JPEGLoader *loader)
-: loader(loader)
+: loader(loader), instructions(loader->instructions)
 {
 	try
 	{
@@ -87,6 +98,25 @@ JPEGMCUDecoder::~JPEGMCUDecoder()
 		System::aligned_free(quant[c]);
 }
 
+bool JPEGMCUDecoder::is_supported(JPEGProvider::DecoderInstructions instructions)
+{
+	switch (instructions)
+	{
+	case JPEGProvider::decoder_scalar:
+		return true;
+#if !defined(DISABLE_SSE2) && !defined(ARM_PLATFORM)
+	case JPEGProvider::decoder_sse2:
+		return System::detect_cpu_extension(System::sse2);
+#endif
+#ifdef CL_JPEG_AVX2
+	case JPEGProvider::decoder_avx2:
+		return System::detect_cpu_extension(System::avx2);
+#endif
+	default:
+		return false;
+	}
+}
+
 void JPEGMCUDecoder::decode(int block)
 {
 	for (size_t c = 0; c < channels.size(); c++)
@@ -105,7 +135,12 @@ void JPEGMCUDecoder::decode(int block)
 #else
 
 #ifndef ARM_PLATFORM
-				idct_sse(dct, channels[c]+dct_x*8+dct_y*scale_x*64, scale_x*8, quant[c]);
+				if (instructions == JPEGProvider::decoder_avx2)
+					idct_avx2(dct, channels[c]+dct_x*8+dct_y*scale_x*64, scale_x*8, quant[c]);
+				else if (instructions == JPEGProvider::decoder_sse2)
+					idct_sse(dct, channels[c]+dct_x*8+dct_y*scale_x*64, scale_x*8, quant[c]);
+				else
+					idct(dct, channels[c]+dct_x*8+dct_y*scale_x*64, scale_x*8, quant[c]);
 #else
 				idct(dct, channels[c]+dct_x*8+dct_y*scale_x*64, scale_x*8, quant[c]);
 #endif
@@ -437,10 +472,149 @@ void JPEGMCUDecoder::idct_sse(short *inptr, unsigned char *outptr, int pitch, fl
 		wsptr += 8*4; /* advance pointer to next row */
 	}
 }
-#endif
-#endif // not DISABLE_SSE2
+#ifdef CL_JPEG_AVX2
+
+static inline cl_target_avx2 __m256 cl_jpeg_dequantize_avx2(const short *inptr, const float *quantptr)
+{
+	return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)inptr))), _mm256_loadu_ps(quantptr));
+}
+
+static inline cl_target_avx2 void cl_jpeg_transpose8x8_avx2(__m256 *r)
+{
+	__m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+	__m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+	__m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+	__m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+	__m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+	__m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+	__m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+	__m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+
+	__m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1,0,1,0));
+	__m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3,2,3,2));
+	__m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1,0,1,0));
+	__m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3,2,3,2));
+	__m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1,0,1,0));
+	__m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3,2,3,2));
+	__m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1,0,1,0));
+	__m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3,2,3,2));
+
+	r[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+	r[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+	r[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+	r[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+	r[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+	r[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+	r[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+	r[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+}
+
+// One pass of the AA&N IDCT on eight columns at once. The operations are done in the same
+// order as in idct_sse, which makes the output of both functions identical.
+static inline cl_target_avx2 void cl_jpeg_idct_pass_avx2(const __m256 *w, __m256 *out)
+{
+	__m256 constant1 = _mm256_set1_ps(1.414213562f);
+	__m256 constant2 = _mm256_set1_ps(1.847759065f);
+	__m256 constant3 = _mm256_set1_ps(1.082392200f);
+	__m256 constant4 = _mm256_set1_ps(-2.613125930f);
+
+	/* Even part */
+
+	__m256 tmp10 = _mm256_add_ps(w[0], w[4]); /* phase 3 */
+	__m256 tmp11 = _mm256_sub_ps(w[0], w[4]);
+
+	__m256 tmp13 = _mm256_add_ps(w[2], w[6]); /* phases 5-3 */
+	__m256 tmp12 = _mm256_sub_ps(_mm256_mul_ps(_mm256_sub_ps(w[2], w[6]), constant1), tmp13);
+
+	__m256 tmp0 = _mm256_add_ps(tmp10, tmp13); /* phase 2 */
+	__m256 tmp3 = _mm256_sub_ps(tmp10, tmp13);
+	__m256 tmp1 = _mm256_add_ps(tmp11, tmp12);
+	__m256 tmp2 = _mm256_sub_ps(tmp11, tmp12);
+
+	/* Odd part */
+
+	__m256 z13 = _mm256_add_ps(w[5], w[3]); /* phase 6 */
+	__m256 z10 = _mm256_sub_ps(w[5], w[3]);
+	__m256 z11 = _mm256_add_ps(w[1], w[7]);
+	__m256 z12 = _mm256_sub_ps(w[1], w[7]);
+
+	__m256 tmp7 = _mm256_add_ps(z11, z13); /* phase 5 */
+	tmp11 = _mm256_mul_ps(_mm256_sub_ps(z11, z13), constant1); /* 2*c4 */
+
+	__m256 z5 = _mm256_mul_ps(_mm256_add_ps(z10, z12), constant2); /* 2*c2 */
+	tmp10 = _mm256_sub_ps(_mm256_mul_ps(constant3, z12), z5); /* 2*(c2-c6) */
+	tmp12 = _mm256_add_ps(_mm256_mul_ps(constant4, z10), z5); /* -2*(c2+c6) */
+
+	__m256 tmp6 = _mm256_sub_ps(tmp12, tmp7); /* phase 2 */
+	__m256 tmp5 = _mm256_sub_ps(tmp11, tmp6);
+	__m256 tmp4 = _mm256_add_ps(tmp10, tmp5);
+
+	out[0] = _mm256_add_ps(tmp0, tmp7);
+	out[7] = _mm256_sub_ps(tmp0, tmp7);
+	out[1] = _mm256_add_ps(tmp1, tmp6);
+	out[6] = _mm256_sub_ps(tmp1, tmp6);
+	out[2] = _mm256_add_ps(tmp2, tmp5);
+	out[5] = _mm256_sub_ps(tmp2, tmp5);
+	out[4] = _mm256_add_ps(tmp3, tmp4);
+	out[3] = _mm256_sub_ps(tmp3, tmp4);
+}
+
+cl_target_avx2 void JPEGMCUDecoder::idct_avx2(short *inptr, unsigned char *outptr, int pitch, float *quantptr)
+{
+	__m256 input[8];
+	__m256 workspace[8];
+
+	/* Pass 1: process all columns from input, store into work array. */
+
+	for (int i = 0; i < 8; i++)
+		input[i] = cl_jpeg_dequantize_avx2(inptr + i * 8, quantptr + i * 8);
+	cl_jpeg_idct_pass_avx2(input, workspace);
+
+	/* Pass 2: process rows from work array, transposed so that each lane is a row. */
+
+	cl_jpeg_transpose8x8_avx2(workspace);
+	__m256 output[8];
+	cl_jpeg_idct_pass_avx2(workspace, output);
+
+	/* Final output stage: scale down by a factor of 8 and range-limit */
+
+	__m256 descale = _mm256_set1_ps(1.0f/8.0f);
+	__m256 constant5 = _mm256_set1_ps(128.0f);
+	for (int i = 0; i < 8; i++)
+		output[i] = _mm256_add_ps(_mm256_mul_ps(output[i], descale), constant5);
+	cl_jpeg_transpose8x8_avx2(output);
+
+	// Packing is done within 128 bit lanes, leaving the low half of four rows in the low lane and
+	// the high half in the high lane. The final permute puts each row back together.
+	__m256i row_order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	for (int i = 0; i < 8; i += 4)
+	{
+		__m256i rows01 = _mm256_packs_epi32(_mm256_cvttps_epi32(output[i + 0]), _mm256_cvttps_epi32(output[i + 1]));
+		__m256i rows23 = _mm256_packs_epi32(_mm256_cvttps_epi32(output[i + 2]), _mm256_cvttps_epi32(output[i + 3]));
+		__m256i rows = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(rows01, rows23), row_order);
+		__m128i lo = _mm256_castsi256_si128(rows);
+		__m128i hi = _mm256_extracti128_si256(rows, 1);
+		_mm_storel_epi64((__m128i*)outptr, lo);
+		outptr += pitch;
+		_mm_storel_epi64((__m128i*)outptr, _mm_srli_si128(lo, 8));
+		outptr += pitch;
+		_mm_storel_epi64((__m128i*)outptr, hi);
+		outptr += pitch;
+		_mm_storel_epi64((__m128i*)outptr, _mm_srli_si128(hi, 8));
+		outptr += pitch;
+	}
+}
 
+#else
 
+void JPEGMCUDecoder::idct_avx2(short *inptr, unsigned char *outptr, int pitch, float *quantptr)
+{
+	idct_sse(inptr, outptr, pitch, quantptr);
+}
+
+#endif
+#endif
+#endif // not DISABLE_SSE2
 
 unsigned char JPEGMCUDecoder::float_to_int(float f)
 {
@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include "API/Display/ImageProviders/jpeg_provider.h"
+
 namespace clan
 {
 
@@ -39,6 +41,8 @@ public:
 	JPEGMCUDecoder(JPEGLoader *loader);
 	~JPEGMCUDecoder();
 
+	static bool is_supported(JPEGProvider::DecoderInstructions instructions);
+
 	void decode(int block);
 	int get_channel_count() const { return (int) channels.size(); }
 	const unsigned char *get_channel(int c) const { return channels[c]; }
@@ -46,11 +50,13 @@ public:
 private:
 	void idct(short *inptr, unsigned char *outptr, int pitch, float *quantptr);
 	void idct_sse(short *inptr, unsigned char *outptr, int pitch, float *quantptr);
+	void idct_avx2(short *inptr, unsigned char *outptr, int pitch, float *quantptr);
 	static inline unsigned char float_to_int(float v);
 
 	JPEGLoader *loader;
 	std::vector<unsigned char *> channels;
 	std::vector<float *> quant;
+	JPEGProvider::DecoderInstructions instructions;
 };
 
 }
@@ -36,6 +36,17 @@
 #ifndef ARM_PLATFORM
 #include <xmmintrin.h>
 #include <emmintrin.h>
+
+#if defined(_MSC_VER) && _MSC_VER >= 1800
+	#define CL_JPEG_AVX2
+	#define cl_target_avx2
+	#include <immintrin.h>
+#elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+	#define CL_JPEG_AVX2
+	#define cl_target_avx2 __attribute__((target("avx2")))
+	#include <immintrin.h>
+#endif
+
 #endif
 #endif
 
@@ -43,10 +54,15 @@ namespace clan
 {
 
 JPEGRGBDecoder::JPEGRGBDecoder(JPEGLoader *loader)
-: loader(loader), mcu_x(0), mcu_y(0), pixels(0)
+: loader(loader), mcu_x(0), mcu_y(0), pixels(0), use_sse2(false), use_avx2(false)
 {
 	mcu_x = loader->mcu_x;
 	mcu_y = loader->mcu_y;
+
+	// Decided once here, as decode is called for every MCU
+	use_sse2 = (loader->instructions == JPEGProvider::decoder_sse2);
+	use_avx2 = (loader->instructions == JPEGProvider::decoder_avx2);
+
 	try
 	{
 		pixels = (unsigned int *) System::aligned_alloc(mcu_x*mcu_y*64*4, 16);
@@ -80,7 +96,9 @@ void JPEGRGBDecoder::decode(JPEGMCUDecoder *mcu_decoder)
 		break;
 	case JPEGLoader::colorspace_ycrcb:
 #ifndef DISABLE_SSE2
-		if (System::detect_cpu_extension(System::sse2))
+		if (use_avx2)
+			convert_ycrcb_avx2();
+		else if (use_sse2)
 			convert_ycrcb_sse();
 		else
 			convert_ycrcb_float();
@@ -207,6 +225,63 @@ void JPEGRGBDecoder::convert_ycrcb_sse()
 		}
 	}
 }
+#ifdef CL_JPEG_AVX2
+
+// Same operations as convert_ycrcb_sse on eight pixels at a time, giving identical output
+cl_target_avx2 void JPEGRGBDecoder::convert_ycrcb_avx2()
+{
+	int height = mcu_y*8;
+	int width = mcu_x*8;
+
+	__m256 half_range = _mm256_set1_ps(128.0f);
+	__m256 cr_to_r = _mm256_set1_ps(1.40200f);
+	__m256 cb_to_g = _mm256_set1_ps(0.34414f);
+	__m256 cr_to_g = _mm256_set1_ps(0.71414f);
+	__m256 cb_to_b = _mm256_set1_ps(1.77200f);
+	__m256 zero = _mm256_setzero_ps();
+	__m256 max_value = _mm256_set1_ps(255.0f);
+	__m256 round = _mm256_set1_ps(0.5f);
+	__m256i alpha = _mm256_set1_epi32(0xff000000);
+
+	for (int y = 0; y < height; y++)
+	{
+		const unsigned char *c_line[3] =
+		{
+			&channels[0][y*width],
+			&channels[1][y*width],
+			&channels[2][y*width]
+		};
+		unsigned int *p_line = pixels + y * width;
+		for (int x = 0; x < width; x+=8)
+		{
+			__m256 Y = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(c_line[0] + x))));
+			__m256 Cb = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(c_line[1] + x))));
+			__m256 Cr = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(c_line[2] + x))));
+			Cr = _mm256_sub_ps(Cr, half_range);
+			Cb = _mm256_sub_ps(Cb, half_range);
+
+			__m256 R = _mm256_add_ps(Y, _mm256_mul_ps(cr_to_r, Cr));
+			__m256 G = _mm256_sub_ps(_mm256_sub_ps(Y, _mm256_mul_ps(cb_to_g, Cb)), _mm256_mul_ps(cr_to_g, Cr));
+			__m256 B = _mm256_add_ps(Y, _mm256_mul_ps(cb_to_b, Cb));
+
+			R = _mm256_add_ps(_mm256_min_ps(_mm256_max_ps(R, zero), max_value), round);
+			G = _mm256_add_ps(_mm256_min_ps(_mm256_max_ps(G, zero), max_value), round);
+			B = _mm256_add_ps(_mm256_min_ps(_mm256_max_ps(B, zero), max_value), round);
+
+			__m256i rgb = _mm256_add_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(B), _mm256_slli_epi32(_mm256_cvttps_epi32(G), 8)), _mm256_slli_epi32(_mm256_cvttps_epi32(R), 16));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(p_line + x), _mm256_add_epi32(alpha, rgb));
+		}
+	}
+}
+
+#else
+
+void JPEGRGBDecoder::convert_ycrcb_avx2()
+{
+	convert_ycrcb_sse();
+}
+
+#endif
 #endif
 #endif	//not DISABLE_SSE2
 
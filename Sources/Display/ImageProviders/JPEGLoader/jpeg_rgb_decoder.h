@@ -50,6 +50,7 @@ private:
 	void upsample(JPEGMCUDecoder *mcu_decoder);
 	void convert_monochrome();
 	void convert_ycrcb_sse();
+	void convert_ycrcb_avx2();
 	void convert_ycrcb_float();
 	void convert_rgb();
 
@@ -57,6 +58,8 @@ private:
 	int mcu_x, mcu_y;
 	unsigned int *pixels;
 	std::vector<unsigned char *> channels;
+	bool use_sse2;
+	bool use_avx2;
 };
 
 }
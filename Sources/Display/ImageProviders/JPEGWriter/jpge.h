@@ -19,12 +19,13 @@ namespace clan_jpge
   // JPEG compression parameters structure.
   struct params
   {
-    inline params() : m_quality(85), m_subsampling(H2V2), m_no_chroma_discrim_flag(false), m_two_pass_flag(false) { }
+    inline params() : m_quality(85), m_subsampling(H2V2), m_no_chroma_discrim_flag(false), m_two_pass_flag(false), m_restart_interval(0) { }
 
     inline bool check() const
     {
       if ((m_quality < 1) || (m_quality > 100)) return false;
       if ((uint)m_subsampling > (uint)H2V2) return false;
+      if ((m_restart_interval < 0) || (m_restart_interval > 65535)) return false;
       return true;
     }
 
@@ -43,6 +44,10 @@ namespace clan_jpge
     bool m_no_chroma_discrim_flag;
 
     bool m_two_pass_flag;
+
+    // Number of MCUs between restart markers, or 0 to not emit any.
+    // Restart intervals can be entropy decoded independently of each other.
+    int m_restart_interval;
   };
   
   // Writes JPEG image to a file. 
@@ -110,6 +115,7 @@ namespace clan_jpge
     int m_mcu_x, m_mcu_y;
     uint8 *m_mcu_lines[16];
     uint8 m_mcu_y_ofs;
+    int m_mcus_coded;
     sample_array_t m_sample_array[64];
     int16 m_coefficient_array[64];
     int32 m_quantization_tables[2][64];
@@ -138,7 +144,9 @@ namespace clan_jpge
     void emit_dht(uint8 *bits, uint8 *val, int index, bool ac_flag);
     void emit_dhts();
     void emit_sos();
+    void emit_dri();
     void emit_markers();
+    void emit_restart();
     void compute_huffman_table(uint *codes, uint8 *code_sizes, uint8 *bits, uint8 *val);
     void compute_quant_table(int32 *dst, int16 *src);
     void adjust_quant_table(int32 *dst, int32 *src);
@@ -0,0 +1,85 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+#include "Display/precomp.h"
+#include "png_inflate_stream.h"
+
+namespace clan
+{
+
+PNGInflateStream::PNGInflateStream(const std::vector<DataBuffer> &idat_chunks)
+: idat_chunks(idat_chunks), next_chunk(0), stream_end(false)
+{
+	const int window_bits = 15;
+
+	memset(&zs, 0, sizeof(mz_stream));
+	if (mz_inflateInit2(&zs, window_bits) != MZ_OK)
+		throw Exception("Zlib inflateInit failed");
+}
+
+PNGInflateStream::~PNGInflateStream()
+{
+	mz_inflateEnd(&zs);
+}
+
+void PNGInflateStream::read(void *data, int size)
+{
+	zs.next_out = static_cast<unsigned char *>(data);
+	zs.avail_out = size;
+
+	while (zs.avail_out > 0)
+	{
+		if (stream_end)
+			throw Exception("Invalid PNG image file");
+
+		// Feed the next IDAT chunk once the current one has been consumed:
+		if (zs.avail_in == 0 && next_chunk < idat_chunks.size())
+		{
+			const DataBuffer &chunk = idat_chunks[next_chunk++];
+			zs.next_in = reinterpret_cast<const unsigned char *>(chunk.get_data());
+			zs.avail_in = chunk.get_size();
+			continue;
+		}
+
+		int result = mz_inflate(&zs, MZ_NO_FLUSH);
+		if (result == MZ_STREAM_END)
+		{
+			stream_end = true;
+		}
+		else if (result == MZ_BUF_ERROR)
+		{
+			if (zs.avail_in == 0 && next_chunk == idat_chunks.size())
+				throw Exception("Invalid PNG image file");
+		}
+		else if (result != MZ_OK)
+		{
+			throw Exception("Invalid PNG image file");
+		}
+	}
+}
+
+}
@@ -0,0 +1,62 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+#pragma once
+
+#include "API/Core/System/databuffer.h"
+#include "Core/Zip/miniz.h"
+#include <vector>
+
+namespace clan
+{
+
+/// \brief Inflates the zlib stream spread over a PNG file's IDAT chunks on demand
+///
+/// The decompressed image data is never held in full. Each call to read
+/// inflates just enough of the stream to fill the destination buffer.
+class PNGInflateStream
+{
+public:
+	PNGInflateStream(const std::vector<DataBuffer> &idat_chunks);
+	~PNGInflateStream();
+
+	/// \brief Inflates exactly size bytes into data
+	///
+	/// Throws an exception if the stream ends before enough data has been produced.
+	void read(void *data, int size);
+
+private:
+	PNGInflateStream(const PNGInflateStream &);
+	PNGInflateStream &operator=(const PNGInflateStream &);
+
+	const std::vector<DataBuffer> &idat_chunks;
+	size_t next_chunk;
+	mz_stream zs;
+	bool stream_end;
+};
+
+}
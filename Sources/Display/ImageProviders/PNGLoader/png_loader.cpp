@@ -28,22 +28,53 @@
 
 #include "Display/precomp.h"
 #include "png_loader.h"
+#include "png_inflate_stream.h"
 #include "API/Display/Image/pixel_buffer_lock.h"
-#include "API/Core/Zip/zlib_compression.h"
 #include "API/Core/System/system.h"
 
+#ifndef DISABLE_SSE2
+#ifndef ARM_PLATFORM
+#include <emmintrin.h>
+#define CL_PNG_SSE2
+
+#if defined(_MSC_VER)
+	#define CL_PNG_SSSE3
+	#define cl_target_ssse3
+	#include <tmmintrin.h>
+#elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+	#define CL_PNG_SSSE3
+	#define cl_target_ssse3 __attribute__((target("ssse3")))
+	#include <tmmintrin.h>
+#endif
+
+#endif
+#endif // not DISABLE_SSE2
+
 namespace clan
 {
 
 PixelBuffer PNGLoader::load(IODevice iodevice, bool srgb)
 {
-	PNGLoader loader(iodevice, srgb);
+	PNGLoader loader(iodevice, srgb, false, tf_rgba8);
+	return loader.image;
+}
+
+PixelBuffer PNGLoader::load(IODevice iodevice, TextureFormat format)
+{
+	PNGLoader loader(iodevice, false, true, format);
 	return loader.image;
 }
 
-PNGLoader::PNGLoader(IODevice iodevice, bool force_srgb)
-: file(iodevice), force_srgb(force_srgb), scanline(0), prev_scanline(0), scanline_4ub(0), scanline_4us(0), palette(0)
+PNGLoader::PNGLoader(IODevice iodevice, bool force_srgb, bool use_output_format, TextureFormat output_format)
+: file(iodevice), force_srgb(force_srgb), use_output_format(use_output_format), output_format(output_format), scanline(0), prev_scanline(0), scanline_4ub(0), scanline_4us(0), palette(0), use_sse2(false), use_ssse3(false)
 {
+#ifdef CL_PNG_SSE2
+	use_sse2 = System::detect_cpu_extension(System::sse2);
+#endif
+#ifdef CL_PNG_SSSE3
+	use_ssse3 = System::detect_cpu_extension(System::ssse3);
+#endif
+
 	read_magic();
 	read_chunks();
 	decode_header();
@@ -76,9 +107,6 @@ void PNGLoader::read_chunks()
 
 	std::map<std::string, DataBuffer> chunks;
 
-	std::vector<DataBuffer> idat_chunks;
-	ubyte64 total_idat_size = 0;
-
 	while (true)
 	{
 		unsigned int length = file.read_uint32();
@@ -93,10 +121,9 @@ void PNGLoader::read_chunks()
 
 		// To do: should we do a crc32 check on data or leave it out for performance reasons?
 
-		if (name == std::string("IDAT")) // Concatenate all IDAT chunks to one big
+		if (name == std::string("IDAT")) // All IDAT chunks form one zlib stream, which is inflated row by row while decoding
 		{
-			total_idat_size += length;
-			idat_chunks.push_back(data);
+			idat.push_back(data);
 		}
 		else
 		{
@@ -106,17 +133,6 @@ void PNGLoader::read_chunks()
 		}
 	}
 
-	if (total_idat_size >= (1 << 31))
-		throw Exception("PNG image file too big!");
-
-	idat = DataBuffer((int)total_idat_size);
-	int idat_pos = 0;
-	for (size_t i = 0; i < idat_chunks.size(); i++)
-	{
-		memcpy(idat.get_data() + idat_pos, idat_chunks[i].get_data(), idat_chunks[i].get_size());
-		idat_pos += idat_chunks[i].get_size();
-	}
-
 	ihdr = chunks["IHDR"];
 	plte = chunks["PLTE"];
 
@@ -127,7 +143,7 @@ void PNGLoader::read_chunks()
 	sbit = chunks["sBIT"];
 	srgb = chunks["sRGB"];
 
-	if (ihdr.is_null() || idat_chunks.empty() || ihdr.get_size() != 13) // Always required chunks
+	if (ihdr.is_null() || idat.empty() || ihdr.get_size() != 13) // Always required chunks
 		throw Exception("Invalid PNG image file");
 }
 
@@ -216,18 +232,31 @@ void PNGLoader::decode_colorkey()
 
 void PNGLoader::decode_image()
 {
-	DataBuffer image_data = ZLibCompression::decompress(idat, false);
-
 	create_image();
 	create_scanline_buffers();
 
+	PNGInflateStream stream(idat);
+
 	if (interlace_method == 0)
 	{
-		decode_interlace_none(reinterpret_cast<const unsigned char*>(image_data.get_data()), image_data.get_size());
+		decode_interlace_none(stream);
 	}
 	else if (interlace_method == 1)
 	{
-		decode_interlace_adam7(reinterpret_cast<const unsigned char*>(image_data.get_data()), image_data.get_size());
+		// Adam7 passes scatter pixels over the whole image, so a conversion has to wait until all passes are done
+		if (is_native_format(image.get_format()))
+		{
+			decode_interlace_adam7(stream, image);
+		}
+		else
+		{
+			PixelBuffer native_image(image_width, image_height, get_native_format());
+			decode_interlace_adam7(stream, native_image);
+
+			PixelBufferLockAny input(native_image);
+			PixelBufferLockAny output(image);
+			converter.convert(output.get_data(), output.get_pitch(), image.get_format(), input.get_data(), input.get_pitch(), native_image.get_format(), image_width, image_height);
+		}
 	}
 	else
 	{
@@ -237,10 +266,10 @@ void PNGLoader::decode_image()
 
 void PNGLoader::create_image()
 {
-	if (bit_depth <= 8)
-		image = PixelBuffer(image_width, image_height, force_srgb ? tf_srgb8_alpha8 : tf_rgba8);
-	else
-		image = PixelBuffer(image_width, image_height, tf_rgba16);
+	if (!use_output_format)
+		output_format = get_native_format();
+
+	image = PixelBuffer(image_width, image_height, output_format);
 }
 
 void PNGLoader::create_scanline_buffers()
@@ -248,8 +277,10 @@ void PNGLoader::create_scanline_buffers()
 	int size = (image_width * bit_depth * get_image_data_channels() + 7) / 8;
 	scanline = static_cast<unsigned char *>(System::aligned_alloc(size));
 	prev_scanline = static_cast<unsigned char *>(System::aligned_alloc(size));
-	scanline_4ub = static_cast<Vec4ub *>(System::aligned_alloc(image_width * sizeof(Vec4ub)));
-	scanline_4us = static_cast<Vec4us *>(System::aligned_alloc(image_width * sizeof(Vec4us)));
+	if (bit_depth <= 8)
+		scanline_4ub = static_cast<Vec4ub *>(System::aligned_alloc(image_width * convert_strip_height * sizeof(Vec4ub)));
+	else
+		scanline_4us = static_cast<Vec4us *>(System::aligned_alloc(image_width * convert_strip_height * sizeof(Vec4us)));
 }
 
 int PNGLoader::get_image_data_channels()
@@ -265,47 +296,62 @@ int PNGLoader::get_image_data_channels()
 	}
 }
 
-void PNGLoader::decode_interlace_none(const unsigned char *data, int data_length)
+TextureFormat PNGLoader::get_native_format()
+{
+	if (bit_depth <= 8)
+		return force_srgb ? tf_srgb8_alpha8 : tf_rgba8;
+	else
+		return tf_rgba16;
+}
+
+bool PNGLoader::is_native_format(TextureFormat format)
+{
+	if (bit_depth <= 8)
+		return format == tf_rgba8 || format == tf_srgb8_alpha8;
+	else
+		return format == tf_rgba16;
+}
+
+void PNGLoader::decode_interlace_none(PNGInflateStream &stream)
 {
 	int scanline_size = (image_width * bit_depth * get_image_data_channels() + 7) / 8;
-	if ((1 + scanline_size) * image_height > data_length)
-		throw Exception("Invalid PNG image file");
+	memset(scanline, 0, scanline_size);
 
-	for (size_t i = 0; i < scanline_size; i++)
-		scanline[i] = 0;
+	// Rows are written straight into the image when it uses the format we decode to.
+	// Otherwise they are staged in a strip which is then converted into the image.
+	bool convert = !is_native_format(image.get_format());
+	TextureFormat native_format = get_native_format();
+	int native_pitch = image_width * (bit_depth <= 8 ? sizeof(Vec4ub) : sizeof(Vec4us));
 
-	int data_pos = 0;
 	PixelBufferLockAny pixels(image);
-	for (int y = 0; y < image_height; y++)
+	int strip_start = 0;
+	for (int y = 0; y < (int)image_height; y++)
 	{
 		unsigned char *tmp = scanline;
 		scanline = prev_scanline;
 		prev_scanline = tmp;
 
-		int predictor_type = data[data_pos++];
-		memcpy(scanline, data + data_pos, scanline_size);
-		data_pos += scanline_size;
-
-		filter_scanline(predictor_type, scanline_size);
+		read_scanline(stream, scanline_size);
 
+		int strip_row = y - strip_start;
 		if (bit_depth <= 8)
-			convert_scanline_4ub(image_width);
+			convert_scanline_4ub(convert ? scanline_4ub + strip_row * image_width : reinterpret_cast<Vec4ub*>(pixels.get_row(y)), image_width);
 		else
-			convert_scanline_4us(image_width);
+			convert_scanline_4us(convert ? scanline_4us + strip_row * image_width : reinterpret_cast<Vec4us*>(pixels.get_row(y)), image_width);
 
-		unsigned char *output_line = pixels.get_row(y);
-		if (bit_depth <= 8)
-			memcpy(output_line, scanline_4ub, image_width * 4);
-		else
-			memcpy(output_line, scanline_4us, image_width * 8);
+		if (convert && (strip_row + 1 == convert_strip_height || y + 1 == (int)image_height))
+		{
+			const void *strip = (bit_depth <= 8) ? static_cast<const void*>(scanline_4ub) : static_cast<const void*>(scanline_4us);
+			converter.convert(pixels.get_row(strip_start), pixels.get_pitch(), image.get_format(), strip, native_pitch, native_format, image_width, strip_row + 1);
+			strip_start = y + 1;
+		}
 	}
 }
 
-void PNGLoader::decode_interlace_adam7(const unsigned char *data, int data_length)
+void PNGLoader::decode_interlace_adam7(PNGInflateStream &stream, PixelBuffer &target)
 {
 	int scanline_size = (image_width * bit_depth * get_image_data_channels() + 7) / 8;
 
-	int data_pos = 0;
 	int channels = get_image_data_channels();
 
 	int starting_row[7]  = { 0, 0, 4, 0, 2, 0, 1 };
@@ -315,17 +361,16 @@ void PNGLoader::decode_interlace_adam7(const unsigned char *data, int data_lengt
 	//int block_height[7]  = { 8, 8, 4, 4, 2, 2, 1 };
 	//int block_width[7]   = { 8, 4, 4, 2, 2, 1, 1 };
 
-	PixelBufferLockAny pixels(image);
+	PixelBufferLockAny pixels(target);
 	unsigned char *output = pixels.get_data();
 	int output_pitch = pixels.get_pitch();
 	for (int pass = 0; pass < 7; pass++)
 	{
-		for (size_t i = 0; i < scanline_size; i++)
-			scanline[i] = 0;
+		memset(scanline, 0, scanline_size);
 
-		for (int y = starting_row[pass]; y < image_height; y += row_increment[pass])
+		for (int y = starting_row[pass]; y < (int)image_height; y += row_increment[pass])
 		{
-			if (starting_col[pass] < image_width)
+			if (starting_col[pass] < (int)image_width)
 			{
 				unsigned char *tmp = scanline;
 				scanline = prev_scanline;
@@ -334,22 +379,15 @@ void PNGLoader::decode_interlace_adam7(const unsigned char *data, int data_lengt
 				int scanline_pixel_length = (image_width - starting_col[pass] + col_increment[pass] - 1) / col_increment[pass];
 				int scanline_byte_length = (scanline_pixel_length * bit_depth * channels + 7) / 8;
 
-				if (data_pos + scanline_byte_length > data_length)
-					throw Exception("Invalid PNG image file");
-
-				int predictor_type = data[data_pos++];
-				memcpy(scanline, data + data_pos, scanline_byte_length);
-				data_pos += scanline_byte_length;
-
-				filter_scanline(predictor_type, scanline_byte_length);
+				read_scanline(stream, scanline_byte_length);
 
 				if (bit_depth <= 8)
-					convert_scanline_4ub(scanline_pixel_length);
+					convert_scanline_4ub(scanline_4ub, scanline_pixel_length);
 				else
-					convert_scanline_4us(scanline_pixel_length);
+					convert_scanline_4us(scanline_4us, scanline_pixel_length);
 
 				int scanline_pos = 0;
-				for (int x = starting_col[pass]; x < image_width; x += col_increment[pass])
+				for (int x = starting_col[pass]; x < (int)image_width; x += col_increment[pass])
 				{
 					if (bit_depth <= 8)
 						*reinterpret_cast<Vec4ub*>(output + y * output_pitch + x * 4) = scanline_4ub[scanline_pos++];
@@ -361,16 +399,49 @@ void PNGLoader::decode_interlace_adam7(const unsigned char *data, int data_lengt
 	}
 }
 
+void PNGLoader::read_scanline(PNGInflateStream &stream, int scanline_byte_length)
+{
+	unsigned char predictor_type = 0;
+	stream.read(&predictor_type, 1);
+	stream.read(scanline, scanline_byte_length);
+	filter_scanline(predictor_type, scanline_byte_length);
+}
+
 void PNGLoader::filter_scanline(int predictor_type, int scanline_byte_length)
 {
 	int channels = get_image_data_channels();
+	int bytes_per_pixel = channels * ((bit_depth + 7) / 8);
+
+	// The SIMD kernels handle one 3 or 4 byte pixel per step
+	bool simd_pixels = (bytes_per_pixel == 3 || bytes_per_pixel == 4);
+
 	switch (predictor_type)
 	{
 	case 0: break; // none
-	case 1: predictor_sub(scanline, prev_scanline, scanline_byte_length, channels, bit_depth); break;
-	case 2: predictor_up(scanline, prev_scanline, scanline_byte_length, channels, bit_depth); break;
-	case 3: predictor_average(scanline, prev_scanline, scanline_byte_length, channels, bit_depth); break;
-	case 4: predictor_paeth(scanline, prev_scanline, scanline_byte_length, channels, bit_depth); break;
+	case 1:
+		if (use_sse2 && simd_pixels)
+			predictor_sub_sse2(scanline, scanline_byte_length, bytes_per_pixel);
+		else
+			predictor_sub(scanline, prev_scanline, scanline_byte_length, channels, bit_depth);
+		break;
+	case 2:
+		if (use_sse2)
+			predictor_up_sse2(scanline, prev_scanline, scanline_byte_length);
+		else
+			predictor_up(scanline, prev_scanline, scanline_byte_length, channels, bit_depth);
+		break;
+	case 3:
+		if (use_sse2 && simd_pixels)
+			predictor_average_sse2(scanline, prev_scanline, scanline_byte_length, bytes_per_pixel);
+		else
+			predictor_average(scanline, prev_scanline, scanline_byte_length, channels, bit_depth);
+		break;
+	case 4:
+		if (use_ssse3 && simd_pixels)
+			predictor_paeth_ssse3(scanline, prev_scanline, scanline_byte_length, bytes_per_pixel);
+		else
+			predictor_paeth(scanline, prev_scanline, scanline_byte_length, channels, bit_depth);
+		break;
 	default: throw Exception("Invalid PNG image file");
 	}
 }
@@ -433,32 +504,175 @@ void PNGLoader::predictor_paeth(unsigned char *scanline, const unsigned char *pr
 	}
 }
 
-void PNGLoader::convert_scanline_4ub(int scanline_pixel_length)
+#ifdef CL_PNG_SSE2
+
+// Loads a single 3 or 4 byte pixel into the low lanes of a SSE register.
+// 3 byte pixels are assembled in a register, as a partial copy through memory stalls store forwarding.
+template<int bytes_per_pixel>
+static inline __m128i cl_png_load_pixel(const unsigned char *src)
+{
+	int value;
+	if (bytes_per_pixel == 4)
+		memcpy(&value, src, 4);
+	else
+		value = src[0] | (src[1] << 8) | (src[2] << 16);
+	return _mm_cvtsi32_si128(value);
+}
+
+// Stores the low lanes of a SSE register as a single 3 or 4 byte pixel
+template<int bytes_per_pixel>
+static inline void cl_png_store_pixel(unsigned char *dest, __m128i pixel)
+{
+	int value = _mm_cvtsi128_si32(pixel);
+	if (bytes_per_pixel == 4)
+	{
+		memcpy(dest, &value, 4);
+	}
+	else
+	{
+		dest[0] = static_cast<unsigned char>(value);
+		dest[1] = static_cast<unsigned char>(value >> 8);
+		dest[2] = static_cast<unsigned char>(value >> 16);
+	}
+}
+
+template<int bytes_per_pixel>
+static void cl_png_sub_sse2(unsigned char *scanline, int byte_length)
+{
+	__m128i a = _mm_setzero_si128();
+	for (int i = 0; i < byte_length; i += bytes_per_pixel)
+	{
+		a = _mm_add_epi8(a, cl_png_load_pixel<bytes_per_pixel>(scanline + i));
+		cl_png_store_pixel<bytes_per_pixel>(scanline + i, a);
+	}
+}
+
+template<int bytes_per_pixel>
+static void cl_png_average_sse2(unsigned char *scanline, const unsigned char *prev_scanline, int byte_length)
+{
+	__m128i one = _mm_set1_epi8(1);
+	__m128i a = _mm_setzero_si128();
+	for (int i = 0; i < byte_length; i += bytes_per_pixel)
+	{
+		__m128i b = cl_png_load_pixel<bytes_per_pixel>(prev_scanline + i);
+
+		// _mm_avg_epu8 rounds up while the predictor rounds down
+		__m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+
+		a = _mm_add_epi8(cl_png_load_pixel<bytes_per_pixel>(scanline + i), average);
+		cl_png_store_pixel<bytes_per_pixel>(scanline + i, a);
+	}
+}
+
+#ifdef CL_PNG_SSSE3
+
+template<int bytes_per_pixel>
+static cl_target_ssse3 void cl_png_paeth_ssse3(unsigned char *scanline, const unsigned char *prev_scanline, int byte_length)
+{
+	// a, b and c are kept as 16 bit lanes so the distances cannot overflow
+	__m128i zero = _mm_setzero_si128();
+	__m128i a = zero;
+	__m128i c = zero;
+	for (int i = 0; i < byte_length; i += bytes_per_pixel)
+	{
+		__m128i b = _mm_unpacklo_epi8(cl_png_load_pixel<bytes_per_pixel>(prev_scanline + i), zero);
+
+		// With p = a + b - c: p - a = b - c, p - b = a - c and p - c = (b - c) + (a - c)
+		__m128i delta_a = _mm_sub_epi16(b, c);
+		__m128i delta_b = _mm_sub_epi16(a, c);
+		__m128i pa = _mm_abs_epi16(delta_a);
+		__m128i pb = _mm_abs_epi16(delta_b);
+		__m128i pc = _mm_abs_epi16(_mm_add_epi16(delta_a, delta_b));
+
+		// Ties are resolved in the order a, b, c
+		__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+		__m128i use_a = _mm_cmpeq_epi16(pa, smallest);
+		__m128i use_b = _mm_andnot_si128(use_a, _mm_cmpeq_epi16(pb, smallest));
+		__m128i use_c = _mm_andnot_si128(_mm_or_si128(use_a, use_b), _mm_set1_epi16(-1));
+		__m128i predictor = _mm_or_si128(_mm_or_si128(_mm_and_si128(use_a, a), _mm_and_si128(use_b, b)), _mm_and_si128(use_c, c));
+
+		__m128i x = _mm_add_epi8(cl_png_load_pixel<bytes_per_pixel>(scanline + i), _mm_packus_epi16(predictor, predictor));
+		cl_png_store_pixel<bytes_per_pixel>(scanline + i, x);
+
+		a = _mm_unpacklo_epi8(x, zero);
+		c = b;
+	}
+}
+
+#endif
+#endif
+
+void PNGLoader::predictor_sub_sse2(unsigned char *scanline, int byte_length, int bytes_per_pixel)
+{
+#ifdef CL_PNG_SSE2
+	if (bytes_per_pixel == 3)
+		cl_png_sub_sse2<3>(scanline, byte_length);
+	else
+		cl_png_sub_sse2<4>(scanline, byte_length);
+#endif
+}
+
+void PNGLoader::predictor_up_sse2(unsigned char *scanline, const unsigned char *prev_scanline, int byte_length)
+{
+#ifdef CL_PNG_SSE2
+	int i = 0;
+	for (; i + 16 <= byte_length; i += 16)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(scanline + i));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev_scanline + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(scanline + i), _mm_add_epi8(x, b));
+	}
+	for (; i < byte_length; i++)
+		scanline[i] += prev_scanline[i];
+#endif
+}
+
+void PNGLoader::predictor_average_sse2(unsigned char *scanline, const unsigned char *prev_scanline, int byte_length, int bytes_per_pixel)
+{
+#ifdef CL_PNG_SSE2
+	if (bytes_per_pixel == 3)
+		cl_png_average_sse2<3>(scanline, prev_scanline, byte_length);
+	else
+		cl_png_average_sse2<4>(scanline, prev_scanline, byte_length);
+#endif
+}
+
+void PNGLoader::predictor_paeth_ssse3(unsigned char *scanline, const unsigned char *prev_scanline, int byte_length, int bytes_per_pixel)
+{
+#ifdef CL_PNG_SSSE3
+	if (bytes_per_pixel == 3)
+		cl_png_paeth_ssse3<3>(scanline, prev_scanline, byte_length);
+	else
+		cl_png_paeth_ssse3<4>(scanline, prev_scanline, byte_length);
+#endif
+}
+
+void PNGLoader::convert_scanline_4ub(Vec4ub *output, int scanline_pixel_length)
 {
 	switch (color_type)
 	{
-	case 0: grayscale_to_4ub(scanline_pixel_length); break;
-	case 2: truecolor_to_4ub(scanline_pixel_length); break;
-	case 3: indexed_to_4ub(scanline_pixel_length); break;
-	case 4: grayscale_alpha_to_4ub(scanline_pixel_length); break;
-	case 6: truecolor_alpha_to_4ub(scanline_pixel_length); break;
+	case 0: grayscale_to_4ub(output, scanline_pixel_length); break;
+	case 2: truecolor_to_4ub(output, scanline_pixel_length); break;
+	case 3: indexed_to_4ub(output, scanline_pixel_length); break;
+	case 4: grayscale_alpha_to_4ub(output, scanline_pixel_length); break;
+	case 6: truecolor_alpha_to_4ub(output, scanline_pixel_length); break;
 	default: throw Exception("Invalid PNG image file");
 	}
 }
 
-void PNGLoader::convert_scanline_4us(int scanline_pixel_length)
+void PNGLoader::convert_scanline_4us(Vec4us *output, int scanline_pixel_length)
 {
 	switch (color_type)
 	{
-	case 0: grayscale_to_4us(scanline_pixel_length); break;
-	case 2: truecolor_to_4us(scanline_pixel_length); break;
-	case 4: grayscale_alpha_to_4us(scanline_pixel_length); break;
-	case 6: truecolor_alpha_to_4us(scanline_pixel_length); break;
+	case 0: grayscale_to_4us(output, scanline_pixel_length); break;
+	case 2: truecolor_to_4us(output, scanline_pixel_length); break;
+	case 4: grayscale_alpha_to_4us(output, scanline_pixel_length); break;
+	case 6: truecolor_alpha_to_4us(output, scanline_pixel_length); break;
 	default: throw Exception("Invalid PNG image file");
 	}
 }
 
-void PNGLoader::grayscale_to_4ub(int count)
+void PNGLoader::grayscale_to_4ub(Vec4ub *output, int count)
 {
 	unsigned char *input = scanline;
 	if (bit_depth == 1)
@@ -470,7 +684,7 @@ void PNGLoader::grayscale_to_4ub(int count)
 				int shift = i % 8;
 				unsigned char value = (input[i/8] >> shift) & 1;
 				value = static_cast<int>(value) * 255;
-				scanline_4ub[i] = Vec4ub(value, value, value, 255);
+				output[i] = Vec4ub(value, value, value, 255);
 			}
 		}
 		else
@@ -481,7 +695,7 @@ void PNGLoader::grayscale_to_4ub(int count)
 				unsigned char value = (input[i/8] >> shift) & 1;
 				unsigned char alpha = (value != colorkey.r) ? 255 : 0;
 				value = static_cast<int>(value) * 255;
-				scanline_4ub[i] = Vec4ub(value, value, value, alpha);
+				output[i] = Vec4ub(value, value, value, alpha);
 			}
 		}
 	}
@@ -494,7 +708,7 @@ void PNGLoader::grayscale_to_4ub(int count)
 				int shift = (i % 4) * 2;
 				unsigned char value = (input[i/4] >> shift) & 3;
 				value = (static_cast<int>(value) * 255 + 1) / 2;
-				scanline_4ub[i] = Vec4ub(value, value, value, 255);
+				output[i] = Vec4ub(value, value, value, 255);
 			}
 		}
 		else
@@ -505,7 +719,7 @@ void PNGLoader::grayscale_to_4ub(int count)
 				unsigned char value = (input[i/4] >> shift) & 3;
 				unsigned char alpha = (value != colorkey.r) ? 255 : 0;
 				value = (static_cast<int>(value) * 255 + 1) / 2;
-				scanline_4ub[i] = Vec4ub(value, value, value, alpha);
+				output[i] = Vec4ub(value, value, value, alpha);
 			}
 		}
 	}
@@ -518,7 +732,7 @@ void PNGLoader::grayscale_to_4ub(int count)
 				int shift = (i % 2) * 4;
 				unsigned char value = (input[i/4] >> shift) & 15;
 				value = (static_cast<int>(value) * 255 + 8) / 16;
-				scanline_4ub[i] = Vec4ub(value, value, value, 255);
+				output[i] = Vec4ub(value, value, value, 255);
 			}
 		}
 		else
@@ -529,7 +743,7 @@ void PNGLoader::grayscale_to_4ub(int count)
 				unsigned char value = (input[i/4] >> shift) & 15;
 				unsigned char alpha = (value != colorkey.r) ? 255 : 0;
 				value = (static_cast<int>(value) * 255 + 8) / 16;
-				scanline_4ub[i] = Vec4ub(value, value, value, alpha);
+				output[i] = Vec4ub(value, value, value, alpha);
 			}
 		}
 	}
@@ -540,7 +754,7 @@ void PNGLoader::grayscale_to_4ub(int count)
 			for (int i = 0; i < count; i++)
 			{
 				unsigned char value = input[i];
-				scanline_4ub[i] = Vec4ub(value, value, value, 255);
+				output[i] = Vec4ub(value, value, value, 255);
 			}
 		}
 		else
@@ -549,7 +763,7 @@ void PNGLoader::grayscale_to_4ub(int count)
 			{
 				unsigned char value = input[i];
 				unsigned char alpha = (value != colorkey.r) ? 255 : 0;
-				scanline_4ub[i] = Vec4ub(value, value, value, alpha);
+				output[i] = Vec4ub(value, value, value, alpha);
 			}
 		}
 	}
@@ -559,7 +773,7 @@ void PNGLoader::grayscale_to_4ub(int count)
 	}
 }
 
-void PNGLoader::truecolor_to_4ub(int count)
+void PNGLoader::truecolor_to_4ub(Vec4ub *output, int count)
 {
 	if (bit_depth != 8)
 		throw Exception("Invalid PNG image file");
@@ -573,7 +787,7 @@ void PNGLoader::truecolor_to_4ub(int count)
 			unsigned char red = input[i * 3 + 0];
 			unsigned char green = input[i * 3 + 1];
 			unsigned char blue = input[i * 3 + 2];
-			scanline_4ub[i] = Vec4ub(red, green, blue, 255);
+			output[i] = Vec4ub(red, green, blue, 255);
 		}
 	}
 	else
@@ -586,12 +800,12 @@ void PNGLoader::truecolor_to_4ub(int count)
 			unsigned char alpha = 255;
 			if (red == colorkey.r && green == colorkey.g && blue == colorkey.b)
 				alpha = 0;
-			scanline_4ub[i] = Vec4ub(red, green, blue, alpha);
+			output[i] = Vec4ub(red, green, blue, alpha);
 		}
 	}
 }
 
-void PNGLoader::indexed_to_4ub(int count)
+void PNGLoader::indexed_to_4ub(Vec4ub *output, int count)
 {
 	unsigned char *input = scanline;
 	if (bit_depth == 1)
@@ -600,7 +814,7 @@ void PNGLoader::indexed_to_4ub(int count)
 		{
 			int shift = i % 8;
 			unsigned char value = (input[i/8] >> shift) & 1;
-			scanline_4ub[i] = palette[value];
+			output[i] = palette[value];
 		}
 	}
 	else if (bit_depth == 2)
@@ -609,7 +823,7 @@ void PNGLoader::indexed_to_4ub(int count)
 		{
 			int shift = (i % 4) * 2;
 			unsigned char value = (input[i/4] >> shift) & 3;
-			scanline_4ub[i] = palette[value];
+			output[i] = palette[value];
 		}
 	}
 	else if (bit_depth == 4)
@@ -618,7 +832,7 @@ void PNGLoader::indexed_to_4ub(int count)
 		{
 			int shift = (i % 2) * 4;
 			unsigned char value = (input[i/4] >> shift) & 15;
-			scanline_4ub[i] = palette[value];
+			output[i] = palette[value];
 		}
 	}
 	else if (bit_depth == 8)
@@ -626,7 +840,7 @@ void PNGLoader::indexed_to_4ub(int count)
 		for (int i = 0; i < count; i++)
 		{
 			unsigned char value = input[i];
-			scanline_4ub[i] = palette[value];
+			output[i] = palette[value];
 		}
 	}
 	else
@@ -635,7 +849,7 @@ void PNGLoader::indexed_to_4ub(int count)
 	}
 }
 
-void PNGLoader::grayscale_alpha_to_4ub(int count)
+void PNGLoader::grayscale_alpha_to_4ub(Vec4ub *output, int count)
 {
 	if (bit_depth != 8)
 		throw Exception("Invalid PNG image file");
@@ -645,11 +859,11 @@ void PNGLoader::grayscale_alpha_to_4ub(int count)
 	{
 		unsigned char value = input[i * 2];
 		unsigned char alpha = input[i * 2 + 1];
-		scanline_4ub[i] = Vec4ub(value, value, value, alpha);
+		output[i] = Vec4ub(value, value, value, alpha);
 	}
 }
 
-void PNGLoader::truecolor_alpha_to_4ub(int count)
+void PNGLoader::truecolor_alpha_to_4ub(Vec4ub *output, int count)
 {
 	if (bit_depth != 8)
 		throw Exception("Invalid PNG image file");
@@ -661,11 +875,11 @@ void PNGLoader::truecolor_alpha_to_4ub(int count)
 		unsigned char green = input[i * 4 + 1];
 		unsigned char blue = input[i * 4 + 2];
 		unsigned char alpha = input[i * 4 + 3];
-		scanline_4ub[i] = Vec4ub(red, green, blue, alpha);
+		output[i] = Vec4ub(red, green, blue, alpha);
 	}
 }
 
-void PNGLoader::grayscale_to_4us(int count)
+void PNGLoader::grayscale_to_4us(Vec4us *output, int count)
 {
 	if (bit_depth != 16)
 		throw Exception("Invalid PNG image file");
@@ -676,7 +890,7 @@ void PNGLoader::grayscale_to_4us(int count)
 		for (int i = 0; i < count; i++)
 		{
 			unsigned short value = from_network_order(input[i]);
-			scanline_4us[i] = Vec4us(value, value, value, 65535);
+			output[i] = Vec4us(value, value, value, 65535);
 		}
 	}
 	else
@@ -685,12 +899,12 @@ void PNGLoader::grayscale_to_4us(int count)
 		{
 			unsigned short value = from_network_order(input[i]);
 			unsigned short alpha = (value != colorkey.r) ? 65535 : 0;
-			scanline_4us[i] = Vec4us(value, value, value, alpha);
+			output[i] = Vec4us(value, value, value, alpha);
 		}
 	}
 }
 
-void PNGLoader::truecolor_to_4us(int count)
+void PNGLoader::truecolor_to_4us(Vec4us *output, int count)
 {
 	if (bit_depth != 16)
 		throw Exception("Invalid PNG image file");
@@ -703,7 +917,7 @@ void PNGLoader::truecolor_to_4us(int count)
 			unsigned short red = from_network_order(input[i * 3 + 0]);
 			unsigned short green = from_network_order(input[i * 3 + 1]);
 			unsigned short blue = from_network_order(input[i * 3 + 2]);
-			scanline_4us[i] = Vec4us(red, green, blue, 65535);
+			output[i] = Vec4us(red, green, blue, 65535);
 		}
 	}
 	else
@@ -716,12 +930,12 @@ void PNGLoader::truecolor_to_4us(int count)
 			unsigned short alpha = 65535;
 			if (red == colorkey.r && green == colorkey.g && blue == colorkey.b)
 				alpha = 0;
-			scanline_4us[i] = Vec4us(red, green, blue, alpha);
+			output[i] = Vec4us(red, green, blue, alpha);
 		}
 	}
 }
 
-void PNGLoader::grayscale_alpha_to_4us(int count)
+void PNGLoader::grayscale_alpha_to_4us(Vec4us *output, int count)
 {
 	if (bit_depth != 16)
 		throw Exception("Invalid PNG image file");
@@ -731,11 +945,11 @@ void PNGLoader::grayscale_alpha_to_4us(int count)
 	{
 		unsigned short value = from_network_order(input[i * 2]);
 		unsigned short alpha = from_network_order(input[i * 2 + 1]);
-		scanline_4us[i] = Vec4us(value, value, value, alpha);
+		output[i] = Vec4us(value, value, value, alpha);
 	}
 }
 
-void PNGLoader::truecolor_alpha_to_4us(int count)
+void PNGLoader::truecolor_alpha_to_4us(Vec4us *output, int count)
 {
 	if (bit_depth != 16)
 		throw Exception("Invalid PNG image file");
@@ -747,7 +961,7 @@ void PNGLoader::truecolor_alpha_to_4us(int count)
 		unsigned short green = from_network_order(input[i * 4 + 1]);
 		unsigned short blue = from_network_order(input[i * 4 + 2]);
 		unsigned short alpha = from_network_order(input[i * 4 + 3]);
-		scanline_4us[i] = Vec4us(red, green, blue, alpha);
+		output[i] = Vec4us(red, green, blue, alpha);
 	}
 }
 
@@ -31,18 +31,23 @@
 #include "API/Core/IOData/iodevice.h"
 #include "API/Display/Image/pixel_buffer.h"
 #include "API/Core/System/databuffer.h"
+#include "API/Display/Image/pixel_converter.h"
 #include <map>
+#include <vector>
 
 namespace clan
 {
 
+class PNGInflateStream;
+
 class PNGLoader
 {
 public:
 	static PixelBuffer load(IODevice iodevice, bool srgb);
+	static PixelBuffer load(IODevice iodevice, TextureFormat format);
 
 private:
-	PNGLoader(IODevice iodevice, bool force_srgb);
+	PNGLoader(IODevice iodevice, bool force_srgb, bool use_output_format, TextureFormat output_format);
 	~PNGLoader();
 	void read_magic();
 	void read_chunks();
@@ -50,12 +55,15 @@ private:
 	void decode_palette();
 	void decode_colorkey();
 	void decode_image();
-	void decode_interlace_none(const unsigned char *data, int data_length);
-	void decode_interlace_adam7(const unsigned char *data, int data_length);
+	void decode_interlace_none(PNGInflateStream &stream);
+	void decode_interlace_adam7(PNGInflateStream &stream, PixelBuffer &target);
+	void read_scanline(PNGInflateStream &stream, int scanline_byte_length);
 
 	void create_image();
 	void create_scanline_buffers();
 	int get_image_data_channels();
+	TextureFormat get_native_format();
+	bool is_native_format(TextureFormat format);
 
 	void filter_scanline(int predictor_type, int scanline_byte_length);
 	static void predictor_sub(unsigned char *scanline, const unsigned char *prev_scanline, int byte_length, int channels, int bit_depth);
@@ -63,19 +71,24 @@ private:
 	static void predictor_average(unsigned char *scanline, const unsigned char *prev_scanline, int byte_length, int channels, int bit_depth);
 	static void predictor_paeth(unsigned char *scanline, const unsigned char *prev_scanline, int byte_length, int channels, int bit_depth);
 
-	void convert_scanline_4ub(int scanline_pixel_length);
-	void convert_scanline_4us(int scanline_pixel_length);
+	static void predictor_sub_sse2(unsigned char *scanline, int byte_length, int bytes_per_pixel);
+	static void predictor_up_sse2(unsigned char *scanline, const unsigned char *prev_scanline, int byte_length);
+	static void predictor_average_sse2(unsigned char *scanline, const unsigned char *prev_scanline, int byte_length, int bytes_per_pixel);
+	static void predictor_paeth_ssse3(unsigned char *scanline, const unsigned char *prev_scanline, int byte_length, int bytes_per_pixel);
+
+	void convert_scanline_4ub(Vec4ub *output, int scanline_pixel_length);
+	void convert_scanline_4us(Vec4us *output, int scanline_pixel_length);
 
-	void grayscale_to_4ub(int count);
-	void truecolor_to_4ub(int count);
-	void indexed_to_4ub(int count);
-	void grayscale_alpha_to_4ub(int count);
-	void truecolor_alpha_to_4ub(int count);
+	void grayscale_to_4ub(Vec4ub *output, int count);
+	void truecolor_to_4ub(Vec4ub *output, int count);
+	void indexed_to_4ub(Vec4ub *output, int count);
+	void grayscale_alpha_to_4ub(Vec4ub *output, int count);
+	void truecolor_alpha_to_4ub(Vec4ub *output, int count);
 
-	void grayscale_to_4us(int count);
-	void truecolor_to_4us(int count);
-	void grayscale_alpha_to_4us(int count);
-	void truecolor_alpha_to_4us(int count);
+	void grayscale_to_4us(Vec4us *output, int count);
+	void truecolor_to_4us(Vec4us *output, int count);
+	void grayscale_alpha_to_4us(Vec4us *output, int count);
+	void truecolor_alpha_to_4us(Vec4us *output, int count);
 	
 	static int abs(int a) { return a >= 0 ? a : -a; }
 
@@ -93,12 +106,18 @@ private:
 
 	IODevice file;
 	bool force_srgb;
+	bool use_output_format;
+	TextureFormat output_format;
 
 	PixelBuffer image;
+	PixelConverter converter;
+
+	// Rows are staged in strips of this height when the output format requires a conversion
+	enum { convert_strip_height = 16 };
 
 	DataBuffer ihdr; // image header, which is the first chunk in a PNG datastream.
 	DataBuffer plte; // palette table associated with indexed PNG images.
-	DataBuffer idat; // image data chunks.
+	std::vector<DataBuffer> idat; // image data chunks, inflated as one zlib stream.
 
 	DataBuffer trns; // Transparency information
 	DataBuffer chrm; // Colour space information (5 chunks)
@@ -123,6 +142,9 @@ private:
 	Vec4ub *palette;
 	Vec3us colorkey;
 	bool has_colorkey;
+
+	bool use_sse2;
+	bool use_ssse3;
 };
 
 }
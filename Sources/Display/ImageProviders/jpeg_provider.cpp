@@ -71,18 +71,20 @@ PixelBuffer JPEGProvider::load(
 void JPEGProvider::save(
 	PixelBuffer buffer,
 	const std::string &fullname,
-	int quality)
+	int quality,
+	int restart_interval)
 {
 	std::string path = PathHelp::get_fullpath(fullname, PathHelp::path_type_file);
 	std::string filename = PathHelp::get_filename(fullname, PathHelp::path_type_file);
 	FileSystem vfs(path);
-	return JPEGProvider::save(buffer, filename, vfs, quality);
+	return JPEGProvider::save(buffer, filename, vfs, quality, restart_interval);
 }
 
 void JPEGProvider::save(
 	PixelBuffer buffer,
 	IODevice &file,
-	int quality)
+	int quality,
+	int restart_interval)
 {
 	if (buffer.get_format() != tf_rgb8)
 	{
@@ -96,7 +98,8 @@ void JPEGProvider::save(
 
 	clan_jpge::params desc;
 	desc.m_quality = quality;
-	bool result = clan_jpge::compress_image_to_jpeg_file_in_memory(output.get_data(), size, buffer.get_width(), buffer.get_height(), 3, output.get_data<clan_jpge::uint8>(), desc);
+	desc.m_restart_interval = restart_interval;
+	bool result = clan_jpge::compress_image_to_jpeg_file_in_memory(output.get_data(), size, buffer.get_width(), buffer.get_height(), 3, buffer.get_data<clan_jpge::uint8>(), desc);
 	if (!result)
 		throw Exception("Unable to compress JPEG image");
 
@@ -107,10 +110,37 @@ void JPEGProvider::save(
 	PixelBuffer buffer,
 	const std::string &filename,
 	FileSystem &fs,
-	int quality)
+	int quality,
+	int restart_interval)
 {
 	IODevice iodev = fs.open_file(filename, File::create_always, File::access_read_write);
-	save(buffer, iodev, quality);
+	save(buffer, iodev, quality, restart_interval);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// JPEGProvider attributes:
+
+bool JPEGProvider::is_decoder_instructions_supported(DecoderInstructions instructions)
+{
+	return JPEGLoader::is_instructions_supported(instructions);
+}
+
+JPEGProvider::DecoderInstructions JPEGProvider::get_decoder_instructions()
+{
+	return JPEGLoader::get_instructions();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// JPEGProvider operations:
+
+void JPEGProvider::set_decoder_instructions(DecoderInstructions instructions)
+{
+	JPEGLoader::set_instructions(instructions);
+}
+
+void JPEGProvider::set_parallel_decode_forced(bool force)
+{
+	JPEGLoader::set_parallel_decode_forced(force);
 }
 
 }
@@ -64,6 +64,27 @@ PixelBuffer PNGProvider::load(IODevice &file, bool srgb)
 	return PNGLoader::load(file, srgb);
 }
 
+PixelBuffer PNGProvider::load(
+	const std::string &filename,
+	const FileSystem &fs,
+	TextureFormat format)
+{
+	return PNGLoader::load(fs.open_file(filename), format);
+}
+
+PixelBuffer PNGProvider::load(
+	const std::string &fullname,
+	TextureFormat format)
+{
+	File file(fullname);
+	return PNGLoader::load(file, format);
+}
+
+PixelBuffer PNGProvider::load(IODevice &file, TextureFormat format)
+{
+	return PNGLoader::load(file, format);
+}
+
 void PNGProvider::save(
 	PixelBuffer buffer,
 	const std::string &filename,
@@ -45,6 +45,7 @@
 #include "API/Core/IOData/path_help.h"
 #include "API/Core/Text/string_format.h"
 #include "texture_impl.h"
+#include "../Resources/preloaded_images.h"
 
 namespace clan
 {
@@ -173,6 +174,11 @@ Resource<Texture> Texture::resource(GraphicContext &gc, const std::string &id, c
 }
 
 Texture Texture::load(GraphicContext &gc, const std::string &id, const XMLResourceDocument &doc)
+{
+	return load_texture_resource(gc, id, doc, PreloadedImages());
+}
+
+Texture load_texture_resource(GraphicContext &gc, const std::string &id, const XMLResourceDocument &doc, const PreloadedImages &preloaded_images)
 {
 	XMLResourceNode resource = doc.get_resource(id);
 
@@ -181,12 +187,10 @@ Texture Texture::load(GraphicContext &gc, const std::string &id, const XMLResour
 	if (type != "texture")
 		throw Exception(string_format("Resource '%1' is not of type 'texture'", id));
 
-	ImageImportDescription import_desc; // The infamous ImageImportDescription strikes again!
-
 	std::string filename = resource.get_element().get_attribute("file");
 	FileSystem fs = resource.get_file_system();
 
-	Texture2D texture(gc, PathHelp::combine(resource.get_base_path(), filename), fs, import_desc);
+	Texture2D texture = preloaded_images.create_texture(gc, PathHelp::combine(resource.get_base_path(), filename), fs);
 
 	return Resource<Texture>(texture);
 }
@@ -0,0 +1,55 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Display/precomp.h"
+#include "preloaded_images.h"
+#include "API/Display/ImageProviders/provider_factory.h"
+#include "API/Display/Image/image_import_description.h"
+
+namespace clan
+{
+
+int PreloadedImages::decode(const std::string &filename, const FileSystem &fs)
+{
+	// Apply the default import processing here, so the GC thread only uploads the pixels
+	PixelBuffer image = ImageProviderFactory::load(filename, fs, std::string());
+	ImageImportDescription import_desc;
+	image = import_desc.process(image);
+	images[filename] = image;
+	return image.get_pitch() * image.get_height();
+}
+
+Texture2D PreloadedImages::create_texture(GraphicContext &gc, const std::string &filename, const FileSystem &fs) const
+{
+	std::map<std::string, PixelBuffer>::const_iterator it = images.find(filename);
+	if (it == images.end())
+		return Texture2D(gc, filename, fs);
+	return Texture2D(gc, it->second);
+}
+
+}
@@ -0,0 +1,75 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "API/Display/Image/pixel_buffer.h"
+#include "API/Display/Render/texture_2d.h"
+#include "API/Core/IOData/file_system.h"
+#include <map>
+
+namespace clan
+{
+
+class Canvas;
+class GraphicContext;
+class Sprite;
+class Image;
+class Texture;
+class XMLResourceDocument;
+
+/// \brief Images of a resource decoded ahead of time, keyed by file name
+///
+/// Lets the expensive decoding of the files of a resource run on a worker thread,
+/// leaving only the texture creation to the GC thread.
+class PreloadedImages
+{
+public:
+	/// \brief Decodes a file and prepares it for texture creation
+	///
+	/// Can be called on any thread. Throws if the file cannot be loaded.
+	/// \return The size of the decoded image in bytes
+	int decode(const std::string &filename, const FileSystem &fs);
+
+	/// \brief Creates a texture for a file, from the decoded image if there is one
+	Texture2D create_texture(GraphicContext &gc, const std::string &filename, const FileSystem &fs) const;
+
+private:
+	std::map<std::string, PixelBuffer> images;
+};
+
+/// \brief Loads a sprite resource like Sprite::load, taking its images from preloaded_images
+Sprite load_sprite_resource(Canvas &canvas, const std::string &id, const XMLResourceDocument &doc, const PreloadedImages &preloaded_images);
+
+/// \brief Loads an image resource like Image::load, taking its images from preloaded_images
+Image load_image_resource(Canvas &canvas, const std::string &id, const XMLResourceDocument &doc, const PreloadedImages &preloaded_images);
+
+/// \brief Loads a texture resource like Texture::load, taking its image from preloaded_images
+Texture load_texture_resource(GraphicContext &gc, const std::string &id, const XMLResourceDocument &doc, const PreloadedImages &preloaded_images);
+
+}
@@ -39,14 +39,58 @@
 #include "API/Core/Text/string_help.h"
 #include "API/Core/XML/dom_element.h"
 #include "API/Core/IOData/path_help.h"
+#include "API/Core/Resources/xml_resource_node.h"
+#include "API/Core/System/system.h"
+#include "API/Display/ImageProviders/provider_factory.h"
 #include "xml_display_cache.h"
 #include "../Font/font_impl.h"
+#include "preloaded_images.h"
 
 namespace clan
 {
 
+/////////////////////////////////////////////////////////////////////////////
+// XMLDisplayCache::DecodeWorkItem Class:
+
+class XMLDisplayCache::DecodeWorkItem : public WorkItem
+{
+public:
+	DecodeWorkItem(const std::shared_ptr<LoadQueue> &load_queue, const std::shared_ptr<LoadRequest> &request)
+	: load_queue(load_queue), request(request)
+	{
+	}
+
+	void process_work()
+	{
+		int decoded_bytes = 0;
+		for (size_t i = 0; i < request->files.size(); i++)
+		{
+			try
+			{
+				decoded_bytes += request->images.decode(request->files[i], request->fs);
+			}
+			catch (const Exception &)
+			{
+				// The error is reported when the resource is created on the GC thread
+			}
+		}
+
+		MutexSection mutex_lock(&load_queue->mutex);
+		request->decoded_bytes = decoded_bytes;
+		load_queue->decode_queue_depth--;
+		load_queue->decoded.push_back(request);
+	}
+
+private:
+	std::shared_ptr<LoadQueue> load_queue;
+	std::shared_ptr<LoadRequest> request;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// XMLDisplayCache Construction:
+
 XMLDisplayCache::XMLDisplayCache(const XMLResourceDocument &doc)
-	: doc(doc)
+	: doc(doc), load_queue(new LoadQueue), resources_loaded(0), resources_failed(0), total_latency(0.0), max_latency(0.0)
 {
 }
 
@@ -126,6 +170,212 @@ Resource<Font> XMLDisplayCache::get_font(Canvas &canvas, const FontDescription &
 	return font;
 }
 
+Resource<Sprite> XMLDisplayCache::get_sprite_async(Canvas &canvas, const std::string &id)
+{
+	if (sprites.find(id) != sprites.end())
+		return get_sprite(canvas, id);
+
+	// A new handle reports updated() the first time. Consume that so it only does once the sprite is set
+	Resource<Sprite> sprite;
+	sprite.updated();
+	request_load(id)->sprite_handles.push_back(sprite);
+	return sprite;
+}
+
+Resource<Image> XMLDisplayCache::get_image_async(Canvas &canvas, const std::string &id)
+{
+	if (images.find(id) != images.end())
+		return get_image(canvas, id);
+
+	Resource<Image> image;
+	image.updated();
+	request_load(id)->image_handles.push_back(image);
+	return image;
+}
+
+Resource<Texture> XMLDisplayCache::get_texture_async(GraphicContext &gc, const std::string &id)
+{
+	if (textures.find(id) != textures.end())
+		return get_texture(gc, id);
+
+	Resource<Texture> texture;
+	texture.updated();
+	request_load(id)->texture_handles.push_back(texture);
+	return texture;
+}
+
+void XMLDisplayCache::preload(const std::string &section)
+{
+	std::string section_prefix = section.empty() ? std::string() : PathHelp::add_trailing_slash(section, PathHelp::path_type_virtual);
+
+	const char *types[] = { "sprite", "image", "texture" };
+	for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+	{
+		std::vector<std::string> names = doc.get_resource_names_of_type(types[i]);
+		for (size_t j = 0; j < names.size(); j++)
+		{
+			const std::string &id = names[j];
+			if (id.compare(0, section_prefix.length(), section_prefix) != 0)
+				continue;
+			if (sprites.find(id) != sprites.end() || images.find(id) != images.end() || textures.find(id) != textures.end())
+				continue;
+			request_load(id);
+		}
+	}
+}
+
+void XMLDisplayCache::process_uploads(Canvas &canvas, int max_upload_bytes)
+{
+	int uploaded_bytes = 0;
+	while (true)
+	{
+		MutexSection mutex_lock(&load_queue->mutex);
+		if (load_queue->decoded.empty())
+			break;
+		std::shared_ptr<LoadRequest> request = load_queue->decoded.front();
+		if (uploaded_bytes > 0 && uploaded_bytes + request->decoded_bytes > max_upload_bytes)
+			break;
+		load_queue->decoded.pop_front();
+		mutex_lock.unlock();
+
+		pending_loads.erase(request->id);
+		uploaded_bytes += request->decoded_bytes;
+
+		// A resource that fails to load must not keep the requests behind it in the queue from finishing
+		try
+		{
+			complete_load(canvas, *request);
+		}
+		catch (const Exception &e)
+		{
+			fail_load(*request, e.message);
+			continue;
+		}
+
+		double latency = (System::get_microseconds() - request->request_time) / 1000.0;
+		resources_loaded++;
+		total_latency += latency;
+		if (latency > max_latency)
+			max_latency = latency;
+	}
+}
+
+DisplayCacheLoadStats XMLDisplayCache::get_load_stats() const
+{
+	DisplayCacheLoadStats stats;
+	MutexSection mutex_lock(&load_queue->mutex);
+	stats.decode_queue_depth = load_queue->decode_queue_depth;
+	stats.upload_queue_depth = load_queue->decoded.size();
+	mutex_lock.unlock();
+
+	stats.resources_loaded = resources_loaded;
+	stats.resources_failed = resources_failed;
+	stats.last_error = last_error;
+	stats.average_latency = resources_loaded > 0 ? (float)(total_latency / resources_loaded) : 0.0f;
+	stats.max_latency = (float)max_latency;
+	return stats;
+}
+
+std::shared_ptr<XMLDisplayCache::LoadRequest> XMLDisplayCache::request_load(const std::string &id)
+{
+	std::map<std::string, std::shared_ptr<LoadRequest> >::iterator it = pending_loads.find(id);
+	if (it != pending_loads.end())
+		return it->second;
+
+	// The resource document is not thread safe. Collect the files here so the worker only decodes them
+	XMLResourceNode resource = doc.get_resource(id);
+	DomElement element = resource.get_element();
+
+	std::shared_ptr<LoadRequest> request(new LoadRequest);
+	request->id = id;
+	request->type = resource.get_type();
+	request->fs = resource.get_file_system();
+	request->request_time = System::get_microseconds();
+
+	if (request->type == "texture")
+	{
+		request->files.push_back(PathHelp::combine(resource.get_base_path(), element.get_attribute("file")));
+	}
+	else
+	{
+		for (DomNode cur_node = element.get_first_child(); !cur_node.is_null(); cur_node = cur_node.get_next_sibling())
+		{
+			if (!cur_node.is_element())
+				continue;
+
+			DomElement cur_element = cur_node.to_element();
+			std::string tag_name = cur_element.get_tag_name();
+			if ((tag_name == "image" || tag_name == "image-file") && cur_element.has_attribute("file"))
+				request->files.push_back(PathHelp::combine(resource.get_base_path(), cur_element.get_attribute("file")));
+		}
+	}
+
+	pending_loads[id] = request;
+
+	if (!decode_work_queue)
+		decode_work_queue.reset(new WorkQueue());
+
+	MutexSection mutex_lock(&load_queue->mutex);
+	load_queue->decode_queue_depth++;
+	mutex_lock.unlock();
+
+	decode_work_queue->queue(new DecodeWorkItem(load_queue, request));
+	return request;
+}
+
+void XMLDisplayCache::complete_load(Canvas &canvas, LoadRequest &request)
+{
+	// The images were decoded by the worker, so only the GPU upload happens here
+	if (request.type == "sprite" || !request.sprite_handles.empty())
+	{
+		if (sprites.find(request.id) == sprites.end())
+			sprites[request.id] = load_sprite_resource(canvas, request.id, doc, request.images);
+		for (size_t i = 0; i < request.sprite_handles.size(); i++)
+			request.sprite_handles[i].set(get_sprite(canvas, request.id).get());
+	}
+
+	if (request.type == "image" || !request.image_handles.empty())
+	{
+		if (images.find(request.id) == images.end())
+			images[request.id] = load_image_resource(canvas, request.id, doc, request.images);
+		for (size_t i = 0; i < request.image_handles.size(); i++)
+			request.image_handles[i].set(get_image(canvas, request.id).get());
+	}
+
+	if (request.type == "texture" || !request.texture_handles.empty())
+	{
+		GraphicContext &gc = canvas.get_gc();
+		if (textures.find(request.id) == textures.end())
+			textures[request.id] = load_texture_resource(gc, request.id, doc, request.images);
+		Resource<Texture> texture = get_texture(gc, request.id);
+		for (size_t i = 0; i < request.texture_handles.size(); i++)
+			request.texture_handles[i].set(texture.get());
+	}
+}
+
+void XMLDisplayCache::fail_load(LoadRequest &request, const std::string &error)
+{
+	// Set the handles that were not loaded to null objects, so callers polling Resource::updated() see the request finish
+	if (sprites.find(request.id) == sprites.end())
+	{
+		for (size_t i = 0; i < request.sprite_handles.size(); i++)
+			request.sprite_handles[i].set(Sprite());
+	}
+	if (images.find(request.id) == images.end())
+	{
+		for (size_t i = 0; i < request.image_handles.size(); i++)
+			request.image_handles[i].set(Image());
+	}
+	if (textures.find(request.id) == textures.end())
+	{
+		for (size_t i = 0; i < request.texture_handles.size(); i++)
+			request.texture_handles[i].set(Texture());
+	}
+
+	resources_failed++;
+	last_error = string_format("Could not load resource %1: %2", request.id, error);
+}
+
 Resource<Font> XMLDisplayCache::load_font(Canvas &canvas, const FontDescription &desc)
 {
 	bool is_resource_font = false;
@@ -30,6 +30,11 @@
 
 #include "API/Display/Resources/display_cache.h"
 #include "API/Core/Resources/xml_resource_document.h"
+#include "API/Core/IOData/file_system.h"
+#include "API/Core/System/work_queue.h"
+#include "API/Core/System/mutex.h"
+#include "preloaded_images.h"
+#include <list>
 
 namespace clan
 {
@@ -46,9 +51,52 @@ public:
 	Resource<Font> get_font(Canvas &canvas, const FontDescription &desc);
 	Resource<CollisionOutline> get_collision(const std::string &id);
 
+	Resource<Sprite> get_sprite_async(Canvas &canvas, const std::string &id);
+	Resource<Image> get_image_async(Canvas &canvas, const std::string &id);
+	Resource<Texture> get_texture_async(GraphicContext &gc, const std::string &id);
+	void preload(const std::string &section);
+	void process_uploads(Canvas &canvas, int max_upload_bytes);
+	DisplayCacheLoadStats get_load_stats() const;
+
 private:
+	/// \brief Resource whose files are decoded on a worker thread before it is created on the GC thread
+	class LoadRequest
+	{
+	public:
+		LoadRequest() : request_time(0), decoded_bytes(0) { }
+
+		std::string id;
+		std::string type;
+		FileSystem fs;
+		std::vector<std::string> files;
+		PreloadedImages images;
+		ubyte64 request_time;
+		int decoded_bytes;
+
+		std::vector<Resource<Sprite> > sprite_handles;
+		std::vector<Resource<Image> > image_handles;
+		std::vector<Resource<Texture> > texture_handles;
+	};
+
+	/// \brief State shared between the cache and the decoding work items
+	class LoadQueue
+	{
+	public:
+		LoadQueue() : decode_queue_depth(0) { }
+
+		Mutex mutex;
+		int decode_queue_depth;
+		std::list<std::shared_ptr<LoadRequest> > decoded;
+	};
+
+	class DecodeWorkItem;
+
 	Resource<Font> load_font(Canvas &canvas, const FontDescription &desc);
 
+	std::shared_ptr<LoadRequest> request_load(const std::string &id);
+	void complete_load(Canvas &canvas, LoadRequest &request);
+	void fail_load(LoadRequest &request, const std::string &error);
+
 	XMLResourceDocument doc;
 
 	std::map<std::string, Resource<Sprite> > sprites;
@@ -56,6 +104,16 @@ private:
 	std::map<std::string, Resource<CollisionOutline> > collisions;
 	std::map<std::string, Resource<Texture> > textures;
 	std::map<std::string, Resource<Font> > fonts;
+
+	std::map<std::string, std::shared_ptr<LoadRequest> > pending_loads;
+	std::shared_ptr<LoadQueue> load_queue;
+	std::unique_ptr<WorkQueue> decode_work_queue;
+
+	int resources_loaded;
+	int resources_failed;
+	std::string last_error;
+	double total_latency;
+	double max_latency;
 };
 
 }
@@ -37,6 +37,7 @@
 #include "API/Core/Resources/xml_resource_manager.h"
 #include "API/Core/Resources/xml_resource_document.h"
 #include "Display/Resources/xml_display_cache.h"
+#include "Display/ImageProviders/JPEGLoader/jpeg_loader.h"
 
 #ifndef WIN32
 #ifndef __APPLE__
@@ -116,6 +117,8 @@ void SetupDisplay_Impl::deinit()
 
 	delete tga_provider;
 	tga_provider = NULL;
+
+	JPEGLoader::free_work_queue();
 }
 
 void SetupDisplay_Impl::add_cache_factory(ResourceManager &manager, const XMLResourceDocument &doc)
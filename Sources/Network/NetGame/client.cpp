@@ -51,6 +51,10 @@ void NetGameClient::connect(const std::string &server, const std::string &port)
 {
 	disconnect();
 	impl->connection.reset(new NetGameConnection(this, SocketName(server, port)));
+	impl->connection->set_flush_policy(impl->flush_policy);
+	impl->connection->set_delta_encoding(impl->delta_encoding);
+	if (impl->compact_encoding)
+		impl->connection->announce_compact_encoding();
 }
 
 void NetGameClient::disconnect()
@@ -72,6 +76,31 @@ void NetGameClient::send_event(const NetGameEvent &game_event)
 		impl->connection->send_event(game_event);
 }
 
+void NetGameClient::set_flush_policy(NetGameConnection::FlushPolicy policy)
+{
+	impl->flush_policy = policy;
+	if (impl->connection.get() != 0)
+		impl->connection->set_flush_policy(policy);
+}
+
+void NetGameClient::set_delta_encoding(bool enable)
+{
+	impl->delta_encoding = enable;
+	if (impl->connection.get() != 0)
+		impl->connection->set_delta_encoding(enable);
+}
+
+void NetGameClient::set_compact_encoding(bool enable)
+{
+	impl->compact_encoding = enable;
+}
+
+void NetGameClient::flush()
+{
+	if (impl->connection.get() != 0)
+		impl->connection->flush();
+}
+
 Signal_v1<const NetGameEvent &> &NetGameClient::sig_event_received()
 {
 	return impl->sig_game_event_received;
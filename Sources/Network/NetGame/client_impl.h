@@ -37,10 +37,15 @@ namespace clan
 class NetGameClient_Impl : public KeepAliveObject
 {
 public:
+	NetGameClient_Impl() : flush_policy(NetGameConnection::flush_immediately), delta_encoding(false), compact_encoding(false) { }
+
 	void process();
 
 	Mutex mutex;
 	std::vector<NetGameNetworkEvent> events;
+	NetGameConnection::FlushPolicy flush_policy;
+	bool delta_encoding;
+	bool compact_encoding;
 
 	std::unique_ptr<NetGameConnection> connection;
 	Signal_v1<const NetGameEvent &> sig_game_event_received;
@@ -48,6 +48,12 @@ NetGameConnection::NetGameConnection(NetGameConnectionSite *site, const SocketNa
 	impl->start(this, site, socket_name);
 }
 
+NetGameConnection::NetGameConnection(NetGameConnectionSite *site, const TCPConnection &connection, NetGameConnectionReactor *reactor)
+: impl(new NetGameConnection_Impl())
+{
+	impl->start(this, site, connection, reactor);
+}
+
 NetGameConnection::~NetGameConnection()
 {
 	delete impl;
@@ -68,6 +74,26 @@ void NetGameConnection::send_event(const NetGameEvent &game_event)
 	impl->send_event(game_event);
 }
 
+void NetGameConnection::set_flush_policy(FlushPolicy policy)
+{
+	impl->set_flush_policy(policy);
+}
+
+void NetGameConnection::set_delta_encoding(bool enable)
+{
+	impl->set_delta_encoding(enable);
+}
+
+void NetGameConnection::announce_compact_encoding()
+{
+	impl->announce_compact_encoding();
+}
+
+void NetGameConnection::flush()
+{
+	impl->flush();
+}
+
 void NetGameConnection::disconnect()
 {
 	impl->disconnect();
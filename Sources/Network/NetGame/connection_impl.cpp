@@ -33,12 +33,16 @@
 #include "API/Core/System/databuffer.h"
 #include "network_event.h"
 #include "network_data.h"
+#include "network_data_compact.h"
 #include "connection_impl.h"
+#include "connection_reactor.h"
 
 namespace clan
 {
 
 NetGameConnection_Impl::NetGameConnection_Impl()
+: stop_event((EventProvider *) 0), queue_event((EventProvider *) 0), disconnect_queued(false), flush_policy(NetGameConnection::flush_immediately),
+  compact_encoding(false), compact_announced(false), reactor(0), reactor_index(0), wakeup_pending(false)
 {
 }
 
@@ -49,7 +53,7 @@ void NetGameConnection_Impl::start(NetGameConnection *xbase, NetGameConnectionSi
 	connection = xconnection;
 	socket_name = connection.get_remote_name();
 	is_connected = true;
-	thread.start(this, &NetGameConnection_Impl::connection_main);
+	start_thread();
 }
 
 void NetGameConnection_Impl::start(NetGameConnection *xbase, NetGameConnectionSite *xsite, const SocketName &xsocket_name)
@@ -58,11 +62,44 @@ void NetGameConnection_Impl::start(NetGameConnection *xbase, NetGameConnectionSi
 	site = xsite;
 	socket_name = xsocket_name;
 	is_connected = false;
+	start_thread();
+}
+
+void NetGameConnection_Impl::start(NetGameConnection *xbase, NetGameConnectionSite *xsite, const TCPConnection &xconnection, NetGameConnectionReactor *xreactor)
+{
+	base = xbase;
+	site = xsite;
+	connection = xconnection;
+	socket_name = connection.get_remote_name();
+	is_connected = true;
+#ifdef __linux__
+	reactor = xreactor;
+	wakeup_pending = true;
+	reactor->add(this);
+#else
+	start_thread();
+#endif
+}
+
+void NetGameConnection_Impl::start_thread()
+{
+	// Only connections with their own thread wait on events. Each event is a socket pair,
+	// which a server with thousands of reactor driven connections would run out of.
+	stop_event = Event();
+	queue_event = Event();
+	queue_event.set();
 	thread.start(this, &NetGameConnection_Impl::connection_main);
 }
 
 NetGameConnection_Impl::~NetGameConnection_Impl()
 {
+#ifdef __linux__
+	if (reactor)
+	{
+		reactor->remove(this);
+		return;
+	}
+#endif
 	stop_event.set();
 	thread.join();
 }
@@ -96,20 +133,54 @@ void *NetGameConnection_Impl::get_data(const std::string &name) const
 void NetGameConnection_Impl::send_event(const NetGameEvent &game_event)
 {
 	MutexSection mutex_lock(&mutex);
-	Message message;
-	message.type = Message::type_message;
-	message.event = game_event;
-	send_queue.push_back(message);
-	queue_event.set();
+	if (disconnect_queued)
+		return;
+
+	if (compact_encoding)
+		encoder.send_data(queued_data, game_event);
+	else
+		NetGameNetworkData::send_data(queued_data, game_event);
+	if (flush_policy == NetGameConnection::flush_immediately || queued_data.get_size() >= auto_flush_size)
+		queue_changed();
+}
+
+void NetGameConnection_Impl::set_flush_policy(NetGameConnection::FlushPolicy policy)
+{
+	MutexSection mutex_lock(&mutex);
+	flush_policy = policy;
+	if (flush_policy == NetGameConnection::flush_immediately && queued_data.get_size() > 0)
+		queue_changed();
+}
+
+void NetGameConnection_Impl::set_delta_encoding(bool enable)
+{
+	MutexSection mutex_lock(&mutex);
+	encoder.set_delta_encoding(enable);
+}
+
+void NetGameConnection_Impl::announce_compact_encoding()
+{
+	// Sent in the original format. Events stay in that format until the peer answers.
+	MutexSection mutex_lock(&mutex);
+	if (compact_announced || disconnect_queued)
+		return;
+	compact_announced = true;
+	NetGameNetworkData::send_data(queued_data, NetGameEvent("_compact", compact_format_version));
+	queue_changed();
+}
+
+void NetGameConnection_Impl::flush()
+{
+	MutexSection mutex_lock(&mutex);
+	if (queued_data.get_size() > 0)
+		queue_changed();
 }
 
 void NetGameConnection_Impl::disconnect()
 {
 	MutexSection mutex_lock(&mutex);
-	Message message;
-	message.type = Message::type_disconnect;
-	send_queue.push_back(message);
-	queue_event.set();
+	disconnect_queued = true;
+	queue_changed();
 }
 
 SocketName NetGameConnection_Impl::get_remote_name() const
@@ -171,7 +242,15 @@ void NetGameConnection_Impl::connection_main()
 			}
 			else if (wakeup_reason == 2) // we got data to send
 			{
-				if (!send_buffer_empty)
+				if (send_buffer_empty)
+				{
+					bytes_sent = 0;
+					send_buffer.set_size(0);
+					send_graceful_close = write_data(send_buffer);
+				}
+
+				// The socket is usually writable, so try to send the new data right away
+				if (bytes_sent < send_buffer.get_size())
 				{
 					int bytes = connection.write(send_buffer.get_data() + bytes_sent, send_buffer.get_size() - bytes_sent, false);
 					if (bytes < 0)
@@ -179,19 +258,10 @@ void NetGameConnection_Impl::connection_main()
 					bytes_sent += bytes;
 				}
 
-				if (bytes_sent == send_buffer.get_size())
+				if (bytes_sent == send_buffer.get_size() && send_graceful_close)
 				{
-					if (send_graceful_close)
-					{
-						connection.disconnect_graceful();
-						break;
-					}
-					else
-					{
-						bytes_sent = 0;
-						send_buffer.set_size(0);
-						send_graceful_close = write_data(send_buffer);
-					}
+					connection.disconnect_graceful();
+					break;
 				}
 			}
 		}
@@ -210,7 +280,7 @@ bool NetGameConnection_Impl::read_data(const void *data, int size, int &bytes_co
 	while (bytes_consumed != size)
 	{
 		int bytes = 0;
-		NetGameEvent incoming_event = NetGameNetworkData::receive_data(static_cast<const char*>(data) + bytes_consumed, size - bytes_consumed, bytes);
+		NetGameEvent incoming_event = decoder.receive_data(static_cast<const char*>(data) + bytes_consumed, size - bytes_consumed, bytes);
 		bytes_consumed += bytes;
 
 		if (bytes == 0)
@@ -221,6 +291,19 @@ bool NetGameConnection_Impl::read_data(const void *data, int size, int &bytes_co
 		{
 			return true;
 		}
+		else if (incoming_event.get_name() == "_compact")
+		{
+			// The peer has advertised the compact format. Answer, unless this was the answer to our own announcement.
+			MutexSection mutex_lock(&mutex);
+			if (!compact_announced && !disconnect_queued)
+			{
+				compact_announced = true;
+				NetGameNetworkData::send_data(queued_data, NetGameEvent("_compact", compact_format_version));
+				queue_changed();
+			}
+			compact_encoding = true;
+			continue;
+		}
 
 		site->add_network_event(NetGameNetworkEvent(base, incoming_event));
 	}
@@ -229,27 +312,41 @@ bool NetGameConnection_Impl::read_data(const void *data, int size, int &bytes_co
 
 bool NetGameConnection_Impl::write_data(DataBuffer &buffer)
 {
+	// buffer is empty here; hand it over as the next queue so no allocation is needed
 	MutexSection mutex_lock(&mutex);
-	queue_event.reset();
-	std::vector<Message> new_send_queue;
-	send_queue.swap(new_send_queue);
-	mutex_lock.unlock();
-	for (unsigned int i = 0; i < new_send_queue.size(); i++)
+	if (reactor)
 	{
-		if (new_send_queue[i].type == Message::type_message)
-		{
-			DataBuffer packet = NetGameNetworkData::send_data(new_send_queue[i].event);
+		// The reactor also calls this when the socket becomes writable; data held back for flush() stays queued
+		if (!wakeup_pending)
+			return false;
+		wakeup_pending = false;
+	}
+	else
+	{
+		queue_event.reset();
+	}
 
-			int pos = buffer.get_size();
-			buffer.set_size(pos + packet.get_size());
-			memcpy(buffer.get_data() + pos, packet.get_data(), packet.get_size());
-		}
-		else if (new_send_queue[i].type == Message::type_disconnect)
+	DataBuffer empty_buffer = buffer;
+	buffer = queued_data;
+	queued_data = empty_buffer;
+	return disconnect_queued;
+}
+
+void NetGameConnection_Impl::queue_changed()
+{
+	// Called with mutex held
+#ifdef __linux__
+	if (reactor)
+	{
+		if (!wakeup_pending)
 		{
-			return true;
+			wakeup_pending = true;
+			reactor->wakeup(this);
 		}
+		return;
 	}
-	return false;
+#endif
+	queue_event.set();
 }
 
 }
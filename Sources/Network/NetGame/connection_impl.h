@@ -29,9 +29,13 @@
 
 #pragma once
 
+#include "network_data_compact.h"
+
 namespace clan
 {
 
+class NetGameConnectionReactor;
+
 class NetGameConnection_Impl
 {
 public:
@@ -39,16 +43,23 @@ public:
 	~NetGameConnection_Impl();
 	void start(NetGameConnection *base, NetGameConnectionSite *site, const TCPConnection &connection);
 	void start(NetGameConnection *base, NetGameConnectionSite *site, const SocketName &socket_name);
+	void start(NetGameConnection *base, NetGameConnectionSite *site, const TCPConnection &connection, NetGameConnectionReactor *reactor);
 	void set_data(const std::string &name, void *data);
 	void *get_data(const std::string &name) const;
 	void send_event(const NetGameEvent &game_event);
+	void set_flush_policy(NetGameConnection::FlushPolicy policy);
+	void set_delta_encoding(bool enable);
+	void announce_compact_encoding();
+	void flush();
 	void disconnect();
 	SocketName get_remote_name() const;
 
 private:
+	void start_thread();
 	void connection_main();
 	bool read_data(const void *data, int size, int &out_bytes_consumed);
 	bool write_data(DataBuffer &buffer);
+	void queue_changed();
 
 	NetGameConnection *base;
 
@@ -59,24 +70,34 @@ private:
 	Thread thread;
 	Event stop_event, queue_event;
 	Mutex mutex;
-	struct Message
-	{
-		Message() : type(type_message), event(std::string()) { }
-		enum Type
-		{
-			type_message,
-			type_disconnect
-		};
-		Type type;
-		NetGameEvent event;
-	};
-	std::vector<Message> send_queue;
+
+	// Events are encoded into queued_data as they are sent. The connection thread swaps it with its
+	// send buffer, so both buffers keep their capacity and a tick of events goes out in one write.
+	DataBuffer queued_data;
+	bool disconnect_queued;
+	NetGameConnection::FlushPolicy flush_policy;
+	static const unsigned int auto_flush_size = 64*1024;
+
+	// Events are sent in the compact format once the peer has announced it understands it.
+	// The decoder is only used by the thread receiving data.
+	bool compact_encoding;
+	bool compact_announced;
+	NetGameCompactEncoder encoder;
+	NetGameCompactDecoder decoder;
+	static const unsigned int compact_format_version = 1;
 	struct AttachedData
 	{
 		std::string name;
 		void *data;
 	};
 	std::vector<AttachedData> data;
+
+	// Set when the connection is serviced by a reactor thread instead of its own thread
+	NetGameConnectionReactor *reactor;
+	int reactor_index;
+	bool wakeup_pending;
+
+	friend class NetGameConnectionReactor;
 };
 
 }
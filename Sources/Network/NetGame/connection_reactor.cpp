@@ -0,0 +1,427 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Network/precomp.h"
+
+#ifdef __linux__
+
+#include "API/Network/NetGame/connection.h"
+#include "API/Network/NetGame/connection_site.h"
+#include "API/Core/System/system.h"
+#include "API/Core/Math/cl_math.h"
+#include "connection_reactor.h"
+#include "connection_impl.h"
+#include "network_event.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+
+namespace clan
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// NetGameConnectionReactor Construction:
+
+NetGameConnectionReactor::NetGameConnectionReactor(int num_threads)
+{
+	if (num_threads <= 0)
+		num_threads = max(System::get_num_cores() - 1, 1);
+
+	for (int i = 0; i < num_threads; i++)
+	{
+		std::unique_ptr<ReactorThread> reactor_thread(new ReactorThread());
+		reactor_thread->index = i;
+		reactor_thread->epoll_handle = epoll_create1(EPOLL_CLOEXEC);
+		if (reactor_thread->epoll_handle == -1)
+			break;
+
+		reactor_thread->wakeup_handle = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (reactor_thread->wakeup_handle == -1)
+		{
+			close(reactor_thread->epoll_handle);
+			break;
+		}
+
+		epoll_event event;
+		memset(&event, 0, sizeof(epoll_event));
+		event.events = EPOLLIN;
+		event.data.fd = reactor_thread->wakeup_handle;
+		epoll_ctl(reactor_thread->epoll_handle, EPOLL_CTL_ADD, reactor_thread->wakeup_handle, &event);
+
+		threads.push_back(reactor_thread.release());
+	}
+
+	if (threads.empty())
+		throw Exception("Unable to create epoll instance");
+
+	for (std::vector<ReactorThread *>::size_type i = 0; i < threads.size(); i++)
+		threads[i]->thread.start(this, &NetGameConnectionReactor::reactor_thread_main, threads[i]);
+}
+
+NetGameConnectionReactor::~NetGameConnectionReactor()
+{
+	stop_flag.set(1);
+	for (std::vector<ReactorThread *>::size_type i = 0; i < threads.size(); i++)
+		eventfd_write(threads[i]->wakeup_handle, 1);
+
+	for (std::vector<ReactorThread *>::size_type i = 0; i < threads.size(); i++)
+	{
+		ReactorThread *reactor_thread = threads[i];
+		reactor_thread->thread.join();
+
+		// The sockets themselves belong to the connection objects
+		std::map<int, Connection *>::iterator it;
+		for (it = reactor_thread->connections.begin(); it != reactor_thread->connections.end(); ++it)
+			delete it->second;
+
+		close(reactor_thread->wakeup_handle);
+		close(reactor_thread->epoll_handle);
+		delete reactor_thread;
+	}
+	threads.clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// NetGameConnectionReactor Operations:
+
+void NetGameConnectionReactor::add(NetGameConnection_Impl *impl)
+{
+	ReactorThread *reactor_thread = threads[(next_thread.increment() - 1) % threads.size()];
+	impl->reactor_index = reactor_thread->index;
+
+	MutexSection queue_lock(&reactor_thread->queue_mutex);
+	reactor_thread->added.push_back(impl);
+	signal_thread(reactor_thread);
+}
+
+void NetGameConnectionReactor::remove(NetGameConnection_Impl *impl)
+{
+	ReactorThread *reactor_thread = threads[impl->reactor_index];
+
+	MutexSection mutex_lock(&reactor_thread->mutex);
+
+	MutexSection queue_lock(&reactor_thread->queue_mutex);
+	reactor_thread->added.erase(std::remove(reactor_thread->added.begin(), reactor_thread->added.end(), impl), reactor_thread->added.end());
+	reactor_thread->dirty.erase(std::remove(reactor_thread->dirty.begin(), reactor_thread->dirty.end(), impl), reactor_thread->dirty.end());
+	queue_lock.unlock();
+
+	Connection *connection = find_connection(reactor_thread, impl);
+	if (connection)
+	{
+		epoll_ctl(reactor_thread->epoll_handle, EPOLL_CTL_DEL, connection->handle, 0);
+		if (connection->closing)
+			reactor_thread->num_closing--;
+		reactor_thread->connections.erase(connection->handle);
+		delete connection;
+	}
+}
+
+void NetGameConnectionReactor::wakeup(NetGameConnection_Impl *impl)
+{
+	ReactorThread *reactor_thread = threads[impl->reactor_index];
+
+	MutexSection queue_lock(&reactor_thread->queue_mutex);
+	reactor_thread->dirty.push_back(impl);
+	signal_thread(reactor_thread);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// NetGameConnectionReactor Implementation:
+
+void NetGameConnectionReactor::signal_thread(ReactorThread *reactor_thread)
+{
+	// Caller holds queue_mutex. One eventfd write covers everything queued until the thread wakes up.
+	if (!reactor_thread->wakeup_signalled)
+	{
+		reactor_thread->wakeup_signalled = true;
+		eventfd_write(reactor_thread->wakeup_handle, 1);
+	}
+}
+
+void NetGameConnectionReactor::reactor_thread_main(ReactorThread *reactor_thread)
+{
+	DataBuffer receive_buffer(receive_buffer_size);
+	std::vector<epoll_event> events(256);
+	while (stop_flag.get() == 0)
+	{
+		int count = epoll_wait(reactor_thread->epoll_handle, &events[0], events.size(), 1000);
+		if (count == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		MutexSection mutex_lock(&reactor_thread->mutex);
+		for (int i = 0; i < count; i++)
+		{
+			if (events[i].data.fd == reactor_thread->wakeup_handle)
+			{
+				eventfd_t value;
+				eventfd_read(reactor_thread->wakeup_handle, &value);
+				process_queue(reactor_thread);
+				continue;
+			}
+
+			// A connection closed earlier in this batch is no longer in the map
+			std::map<int, Connection *>::iterator it = reactor_thread->connections.find(events[i].data.fd);
+			if (it == reactor_thread->connections.end())
+				continue;
+
+			Connection *connection = it->second;
+			bool alive = true;
+			if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+				alive = read_connection(reactor_thread, connection, receive_buffer);
+			if (alive && (events[i].events & EPOLLOUT))
+				write_connection(reactor_thread, connection);
+		}
+
+		if (reactor_thread->num_closing > 0 && System::get_time() >= reactor_thread->next_expiry_check)
+			close_expired_connections(reactor_thread);
+	}
+}
+
+void NetGameConnectionReactor::process_queue(ReactorThread *reactor_thread)
+{
+	std::vector<NetGameConnection_Impl *> added, dirty;
+	MutexSection queue_lock(&reactor_thread->queue_mutex);
+	added.swap(reactor_thread->added);
+	dirty.swap(reactor_thread->dirty);
+	reactor_thread->wakeup_signalled = false;
+	queue_lock.unlock();
+
+	// Connections are registered before their queued data is looked at, as both may arrive in the same wakeup
+	for (std::vector<NetGameConnection_Impl *>::size_type i = 0; i < added.size(); i++)
+		register_connection(reactor_thread, added[i]);
+
+	for (std::vector<NetGameConnection_Impl *>::size_type i = 0; i < dirty.size(); i++)
+	{
+		Connection *connection = find_connection(reactor_thread, dirty[i]);
+		if (connection && !connection->closing)
+			write_connection(reactor_thread, connection);
+	}
+}
+
+void NetGameConnectionReactor::register_connection(ReactorThread *reactor_thread, NetGameConnection_Impl *impl)
+{
+	std::unique_ptr<Connection> connection(new Connection());
+	connection->impl = impl;
+	connection->handle = impl->connection.get_handle();
+
+	int flags = fcntl(connection->handle, F_GETFL, 0);
+	fcntl(connection->handle, F_SETFL, flags | O_NONBLOCK);
+	int nodelay = 1;
+	setsockopt(connection->handle, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(int));
+
+	epoll_event event;
+	memset(&event, 0, sizeof(epoll_event));
+	event.events = EPOLLIN;
+	event.data.fd = connection->handle;
+	if (epoll_ctl(reactor_thread->epoll_handle, EPOLL_CTL_ADD, connection->handle, &event) == -1)
+	{
+		impl->site->add_network_event(NetGameNetworkEvent(impl->base, NetGameNetworkEvent::client_disconnected, NetGameEvent(std::string(strerror(errno)))));
+		return;
+	}
+	connection->events = EPOLLIN;
+
+	reactor_thread->connections[connection->handle] = connection.get();
+	impl->site->add_network_event(NetGameNetworkEvent(impl->base, NetGameNetworkEvent::client_connected));
+
+	// Anything sent from a connect handler that ran before the connection was registered
+	write_connection(reactor_thread, connection.release());
+}
+
+NetGameConnectionReactor::Connection *NetGameConnectionReactor::find_connection(ReactorThread *reactor_thread, NetGameConnection_Impl *impl)
+{
+	std::map<int, Connection *>::iterator it = reactor_thread->connections.find(impl->connection.get_handle());
+	if (it != reactor_thread->connections.end() && it->second->impl == impl)
+		return it->second;
+	else
+		return 0;
+}
+
+bool NetGameConnectionReactor::read_connection(ReactorThread *reactor_thread, Connection *connection, DataBuffer &receive_buffer)
+{
+	// Only one read per wakeup so a busy connection cannot starve the others on this thread
+	int bytes_carried = connection->partial_data.get_size();
+	if (bytes_carried > 0)
+		memcpy(receive_buffer.get_data(), connection->partial_data.get_data(), bytes_carried);
+
+	int bytes = recv(connection->handle, receive_buffer.get_data() + bytes_carried, receive_buffer.get_size() - bytes_carried, 0);
+	if (bytes == -1)
+	{
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return true;
+		close_connection(reactor_thread, connection, std::string(strerror(errno)));
+		return false;
+	}
+	else if (bytes == 0)
+	{
+		close_connection(reactor_thread, connection, std::string());
+		return false;
+	}
+
+	// Data arriving after we shut down our side is discarded
+	if (connection->closing)
+		return true;
+
+	int bytes_received = bytes_carried + bytes;
+	int bytes_consumed = 0;
+	try
+	{
+		if (connection->impl->read_data(receive_buffer.get_data(), bytes_received, bytes_consumed))
+		{
+			shutdown_connection(reactor_thread, connection);
+			return true;
+		}
+	}
+	catch (const Exception &e)
+	{
+		close_connection(reactor_thread, connection, e.message);
+		return false;
+	}
+
+	int bytes_left = bytes_received - bytes_consumed;
+	connection->partial_data.set_size(bytes_left);
+	if (bytes_left > 0)
+		memcpy(connection->partial_data.get_data(), receive_buffer.get_data() + bytes_consumed, bytes_left);
+	return true;
+}
+
+bool NetGameConnectionReactor::write_connection(ReactorThread *reactor_thread, Connection *connection)
+{
+	while (true)
+	{
+		if (connection->bytes_sent == connection->send_buffer.get_size())
+		{
+			connection->bytes_sent = 0;
+			connection->send_buffer.set_size(0);
+			connection->send_graceful_close = connection->impl->write_data(connection->send_buffer);
+
+			if (connection->send_buffer.get_size() == 0)
+				break;
+		}
+
+		int bytes = send(connection->handle, connection->send_buffer.get_data() + connection->bytes_sent, connection->send_buffer.get_size() - connection->bytes_sent, MSG_NOSIGNAL);
+		if (bytes == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			close_connection(reactor_thread, connection, std::string(strerror(errno)));
+			return false;
+		}
+		connection->bytes_sent += bytes;
+	}
+
+	if (connection->bytes_sent == connection->send_buffer.get_size() && connection->send_graceful_close)
+	{
+		shutdown_connection(reactor_thread, connection);
+		return true;
+	}
+
+	bool send_pending = connection->bytes_sent < connection->send_buffer.get_size();
+	update_events(reactor_thread, connection, send_pending ? EPOLLIN | EPOLLOUT : EPOLLIN);
+	return true;
+}
+
+void NetGameConnectionReactor::update_events(ReactorThread *reactor_thread, Connection *connection, unsigned int events)
+{
+	if (connection->events != events)
+	{
+		epoll_event event;
+		memset(&event, 0, sizeof(epoll_event));
+		event.events = events;
+		event.data.fd = connection->handle;
+		epoll_ctl(reactor_thread->epoll_handle, EPOLL_CTL_MOD, connection->handle, &event);
+		connection->events = events;
+	}
+}
+
+void NetGameConnectionReactor::shutdown_connection(ReactorThread *reactor_thread, Connection *connection)
+{
+	// The socket is closed abortively when the connection object is destroyed, which would discard
+	// data still in flight. Wait for the peer to see our FIN and close its end first.
+	if (!connection->closing)
+	{
+		shutdown(connection->handle, SHUT_WR);
+		connection->closing = true;
+		connection->close_deadline = System::get_time() + close_timeout;
+		connection->partial_data = DataBuffer();
+		connection->send_buffer = DataBuffer();
+		connection->bytes_sent = 0;
+		reactor_thread->num_closing++;
+		update_events(reactor_thread, connection, EPOLLIN);
+	}
+}
+
+void NetGameConnectionReactor::close_connection(ReactorThread *reactor_thread, Connection *connection, const std::string &reason)
+{
+	epoll_ctl(reactor_thread->epoll_handle, EPOLL_CTL_DEL, connection->handle, 0);
+	if (connection->closing)
+		reactor_thread->num_closing--;
+	reactor_thread->connections.erase(connection->handle);
+
+	NetGameConnection_Impl *impl = connection->impl;
+	delete connection;
+
+	// The server destroys the connection object once it has processed this event
+	if (reason.empty())
+		impl->site->add_network_event(NetGameNetworkEvent(impl->base, NetGameNetworkEvent::client_disconnected));
+	else
+		impl->site->add_network_event(NetGameNetworkEvent(impl->base, NetGameNetworkEvent::client_disconnected, NetGameEvent(reason)));
+}
+
+void NetGameConnectionReactor::close_expired_connections(ReactorThread *reactor_thread)
+{
+	ubyte64 current_time = System::get_time();
+	reactor_thread->next_expiry_check = current_time + 1000;
+
+	std::vector<Connection *> expired;
+	std::map<int, Connection *>::iterator it;
+	for (it = reactor_thread->connections.begin(); it != reactor_thread->connections.end(); ++it)
+	{
+		if (it->second->closing && it->second->close_deadline <= current_time)
+			expired.push_back(it->second);
+	}
+
+	for (std::vector<Connection *>::size_type i = 0; i < expired.size(); i++)
+		close_connection(reactor_thread, expired[i], std::string());
+}
+
+}
+
+#endif
@@ -0,0 +1,152 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#ifdef __linux__
+
+#include "API/Core/System/databuffer.h"
+#include "API/Core/System/mutex.h"
+#include "API/Core/System/thread.h"
+#include "API/Core/System/interlocked_variable.h"
+#include <map>
+#include <vector>
+
+namespace clan
+{
+
+class NetGameConnection_Impl;
+
+/// \brief Event driven socket handling for NetGameServer connections
+///
+/// Every connection is assigned to one of a small pool of reactor threads, each
+/// waiting on its connections with epoll. A connection is only ever serviced by
+/// its own thread, so its events reach the server in the order they were received.
+/// Incoming data is read into a buffer shared by all connections of a thread and
+/// only incomplete packets are copied to the connection, which keeps idle
+/// connections cheap.
+class NetGameConnectionReactor
+{
+/// \name Construction
+/// \{
+
+public:
+	NetGameConnectionReactor(int num_threads);
+
+	~NetGameConnectionReactor();
+
+
+/// \}
+/// \name Operations
+/// \{
+
+public:
+	/// \brief Hands a connected socket over to one of the reactor threads
+	void add(NetGameConnection_Impl *connection);
+
+	/// \brief Detaches a connection. The reactor will not touch it after this returns.
+	void remove(NetGameConnection_Impl *connection);
+
+	/// \brief Lets the reactor thread of a connection send its queued data
+	void wakeup(NetGameConnection_Impl *connection);
+
+
+/// \}
+/// \name Implementation
+/// \{
+
+private:
+	struct Connection
+	{
+		Connection() : impl(0), handle(-1), bytes_sent(0), send_graceful_close(false), closing(false), close_deadline(0), events(0) { }
+
+		NetGameConnection_Impl *impl;
+		int handle;
+
+		// Start of a packet that did not arrive completely in the last read
+		DataBuffer partial_data;
+
+		DataBuffer send_buffer;
+		int bytes_sent;
+		bool send_graceful_close;
+
+		// Our side has shut down and we wait for the peer to close the connection
+		bool closing;
+		ubyte64 close_deadline;
+
+		unsigned int events;
+	};
+
+	struct ReactorThread
+	{
+		ReactorThread() : index(0), epoll_handle(-1), wakeup_handle(-1), wakeup_signalled(false), num_closing(0), next_expiry_check(0) { }
+
+		int index;
+		int epoll_handle;
+		int wakeup_handle;
+
+		// Held while the thread processes socket activity
+		Mutex mutex;
+		std::map<int, Connection *> connections;
+
+		// Connections waiting to be registered or to have their queued data sent
+		Mutex queue_mutex;
+		std::vector<NetGameConnection_Impl *> added;
+		std::vector<NetGameConnection_Impl *> dirty;
+		bool wakeup_signalled;
+
+		int num_closing;
+		ubyte64 next_expiry_check;
+
+		Thread thread;
+	};
+
+	void reactor_thread_main(ReactorThread *reactor_thread);
+	void process_queue(ReactorThread *reactor_thread);
+	void register_connection(ReactorThread *reactor_thread, NetGameConnection_Impl *impl);
+	Connection *find_connection(ReactorThread *reactor_thread, NetGameConnection_Impl *impl);
+	bool read_connection(ReactorThread *reactor_thread, Connection *connection, DataBuffer &receive_buffer);
+	bool write_connection(ReactorThread *reactor_thread, Connection *connection);
+	void update_events(ReactorThread *reactor_thread, Connection *connection, unsigned int events);
+	void shutdown_connection(ReactorThread *reactor_thread, Connection *connection);
+	void close_connection(ReactorThread *reactor_thread, Connection *connection, const std::string &reason);
+	void close_expired_connections(ReactorThread *reactor_thread);
+	void signal_thread(ReactorThread *reactor_thread);
+
+	static const int receive_buffer_size = 64*1024;
+	static const ubyte64 close_timeout = 5000;
+
+	std::vector<ReactorThread *> threads;
+	InterlockedVariable next_thread;
+	InterlockedVariable stop_flag;
+/// \}
+};
+
+}
+
+#endif
@@ -219,7 +219,7 @@ float NetGameEventValue::to_number() const
 		throw Exception("NetGameEventValue is not a floating point number");
 }
 
-std::string NetGameEventValue::to_string() const
+const std::string &NetGameEventValue::to_string() const
 {
 	if (is_string())
 		return value_string;
@@ -31,6 +31,7 @@
 #include "API/Core/IOData/iodevice_memory.h"
 #include "API/Core/Text/string_help.h"
 #include "API/Core/Zip/zlib_compression.h"
+#include "API/Core/Math/cl_math.h"
 #include "network_data.h"
 
 namespace clan
@@ -47,8 +48,7 @@ NetGameEvent NetGameNetworkData::receive_data(const void *data, int size, int &o
 		if (size >= 2 + payload_size)
 		{
 			out_bytes_consumed = 2 + payload_size;
-			DataBuffer buffer(static_cast<const char*>(data) + 2, payload_size);
-			return decode_event(buffer);
+			return decode_event(static_cast<const unsigned char*>(data) + 2, payload_size);
 		}
 	}
 
@@ -58,16 +58,30 @@ NetGameEvent NetGameNetworkData::receive_data(const void *data, int size, int &o
 
 DataBuffer NetGameNetworkData::send_data(const NetGameEvent &e)
 {
-	DataBuffer buffer = encode_event(e);
-	if (buffer.get_size() > packet_limit + 2)
-		throw Exception("Outgoing message too big");
+	DataBuffer buffer;
+	send_data(buffer, e);
 	return buffer;
 }
 
-NetGameEvent NetGameNetworkData::decode_event(const DataBuffer &data)
+void NetGameNetworkData::send_data(DataBuffer &buffer, const NetGameEvent &e)
+{
+	unsigned int length = get_encoded_length(e);
+	if (length > packet_limit)
+		throw Exception("Outgoing message too big");
+
+	unsigned int pos = buffer.get_size();
+	unsigned int new_size = pos + 2 + length;
+	if (new_size > buffer.get_capacity())
+		buffer.set_capacity(max(new_size, buffer.get_capacity() * 2));
+	buffer.set_size(new_size);
+
+	unsigned char *d = buffer.get_data<unsigned char>() + pos;
+	*reinterpret_cast<unsigned short*>(d) = length;
+	encode_event(d + 2, e);
+}
+
+NetGameEvent NetGameNetworkData::decode_event(const unsigned char *d, unsigned int length)
 {
-	const unsigned char *d = data.get_data<unsigned char>();
-	unsigned int length = data.get_size();
 	if (length < 3)
 		throw Exception("Invalid network data");
 
@@ -183,18 +197,16 @@ NetGameEventValue NetGameNetworkData::decode_value(unsigned char type, const uns
 	}
 }
 
-DataBuffer NetGameNetworkData::encode_event(const NetGameEvent &e)
+unsigned int NetGameNetworkData::get_encoded_length(const NetGameEvent &e)
 {
 	unsigned int length = 3 + e.get_name().length();
 	for (unsigned int i = 0; i < e.get_argument_count(); i++)
 		length += get_encoded_length(e.get_argument(i));
+	return length;
+}
 
-	DataBuffer data(length + 2);
-
-	*data.get_data<unsigned short>() = length;
-
-	unsigned char *d = data.get_data<unsigned char>() + 2;
-
+void NetGameNetworkData::encode_event(unsigned char *d, const NetGameEvent &e)
+{
 	// Write name (2 + name length)
 	unsigned int name_length = e.get_name().length();
 	*reinterpret_cast<unsigned short*>(d) = name_length;
@@ -207,8 +219,6 @@ DataBuffer NetGameNetworkData::encode_event(const NetGameEvent &e)
 
 	// Write end marker
 	*d = 0;
-
-	return data;
 }
 
 unsigned int NetGameNetworkData::encode_value(unsigned char *d, const NetGameEventValue &value)
@@ -235,7 +245,7 @@ unsigned int NetGameNetworkData::encode_value(unsigned char *d, const NetGameEve
 		return 1;
 	case NetGameEventValue::string:
 		{
-			std::string s = value.to_string();
+			const std::string &s = value.to_string();
 			*d = 7;
 			*reinterpret_cast<unsigned short*>(d + 1) = s.length();
 			memcpy(d + 3, s.data(), s.length());
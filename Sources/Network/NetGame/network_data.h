@@ -43,16 +43,23 @@ public:
 	static NetGameEvent receive_data(const void *data, int size, int &out_bytes_consumed);
 	static DataBuffer send_data(const NetGameEvent &e);
 
+	/// \brief Encodes an event and appends the packet to the end of buffer
+	///
+	/// The capacity of the buffer grows geometrically, so a buffer that is reused between sends stops allocating.
+	static void send_data(DataBuffer &buffer, const NetGameEvent &e);
+
+	/// \brief Largest payload of a packet
+	enum { packet_limit = 32000 };
+
 private:
-	static NetGameEvent decode_event(const DataBuffer &data);
-	static DataBuffer encode_event(const NetGameEvent &e);
+	static NetGameEvent decode_event(const unsigned char *d, unsigned int length);
+	static unsigned int get_encoded_length(const NetGameEvent &e);
+	static void encode_event(unsigned char *d, const NetGameEvent &e);
 
 	static unsigned int get_encoded_length(const NetGameEventValue &value);
 	static unsigned int encode_value(unsigned char *d, const NetGameEventValue &value);
 
 	static NetGameEventValue decode_value(unsigned char type, const unsigned char *d, unsigned int length, unsigned int &pos);
-
-	enum { packet_limit = 32000 };
 };
 
 }
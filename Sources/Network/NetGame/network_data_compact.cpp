@@ -0,0 +1,533 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Network/precomp.h"
+#include "API/Core/System/databuffer.h"
+#include "API/Core/Math/cl_math.h"
+#include "network_data.h"
+#include "network_data_compact.h"
+
+namespace clan
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// Wire format helpers:
+
+// Packets in the compact format have this bit set in their length prefix
+static const unsigned short compact_packet_flag = 0x8000;
+
+// Names after this many are sent in full with every event
+static const unsigned int max_interned_names = 1024;
+
+// The changed arguments of a delta encoded event are described by a 32 bit mask
+static const unsigned int max_delta_arguments = 32;
+
+// Limits the recursion when decoding complex values
+static const int max_value_depth = 16;
+
+enum
+{
+	argument_header_delta = 1,
+	argument_header_remember = 2,
+	argument_header_count_shift = 2
+};
+
+static inline bool write_varint(unsigned char *&d, unsigned char *end, unsigned int value)
+{
+	while (value >= 0x80)
+	{
+		if (d == end)
+			return false;
+		*(d++) = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+	if (d == end)
+		return false;
+	*(d++) = (unsigned char)value;
+	return true;
+}
+
+static inline bool write_bytes(unsigned char *&d, unsigned char *end, const void *data, unsigned int length)
+{
+	if ((unsigned int)(end - d) < length)
+		return false;
+	memcpy(d, data, length);
+	d += length;
+	return true;
+}
+
+static inline unsigned int read_varint(const unsigned char *&d, const unsigned char *end)
+{
+	unsigned int value = 0;
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		if (d == end)
+			throw Exception("Invalid network data");
+		unsigned char b = *(d++);
+		value |= (unsigned int)(b & 0x7f) << shift;
+		if ((b & 0x80) == 0)
+			return value;
+	}
+	throw Exception("Invalid network data");
+}
+
+static inline void read_bytes(const unsigned char *&d, const unsigned char *end, void *data, unsigned int length)
+{
+	if ((unsigned int)(end - d) < length)
+		throw Exception("Invalid network data");
+	memcpy(data, d, length);
+	d += length;
+}
+
+static inline unsigned int zigzag_encode(int value)
+{
+	return ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+}
+
+static inline int zigzag_decode(unsigned int value)
+{
+	return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// NetGameCompactEncoder Construction:
+
+NetGameCompactEncoder::NetGameCompactEncoder()
+: delta_encoding(false)
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// NetGameCompactEncoder Operations:
+
+void NetGameCompactEncoder::set_delta_encoding(bool enable)
+{
+	delta_encoding = enable;
+
+	// Events sent meanwhile are not remembered, so the old values can no longer be used as a base
+	if (!enable)
+	{
+		for (std::vector<LastEvent>::size_type i = 0; i < last_events.size(); i++)
+			last_events[i].valid = false;
+	}
+}
+
+unsigned int NetGameCompactEncoder::encode(unsigned char *d, unsigned int size, const NetGameEvent &e)
+{
+	unsigned char *end = d + min(size, 2u + NetGameNetworkData::packet_limit);
+	if (end - d < 2)
+		return 0;
+	unsigned char *p = d + 2;
+	bool fits = true;
+
+	// Event name, or the index of a name sent earlier
+	const std::string &name = e.get_name();
+	std::map<std::string, unsigned int>::iterator it_name = name_ids.find(name);
+	bool interned = true;
+	bool define_name = false;
+	unsigned int id = 0;
+	if (it_name != name_ids.end())
+	{
+		id = it_name->second;
+		fits = write_varint(p, end, id * 2 + 2);
+	}
+	else
+	{
+		if (name_ids.size() < max_interned_names)
+		{
+			id = name_ids.size();
+			define_name = true;
+			fits = write_varint(p, end, id * 2 + 1);
+		}
+		else
+		{
+			interned = false;
+			fits = write_varint(p, end, 0);
+		}
+		fits = fits && write_varint(p, end, name.length()) && write_bytes(p, end, name.data(), name.length());
+	}
+
+	// Arguments, or the arguments that changed since the last event of this name
+	unsigned int count = e.get_argument_count();
+	unsigned char *arguments_start = p;
+	bool remember = fits && interned && delta_encoding && count <= max_delta_arguments;
+	if (remember)
+		remember = encode_delta_arguments(p, end, id, e);
+	if (!remember)
+	{
+		p = arguments_start;
+		fits = fits && write_varint(p, end, count << argument_header_count_shift);
+		for (unsigned int i = 0; fits && i < count; i++)
+			fits = encode_value(p, end, e.get_argument(i));
+	}
+
+	if (!fits)
+	{
+		if (size >= 2 + NetGameNetworkData::packet_limit)
+			throw Exception("Outgoing message too big");
+		return 0;
+	}
+
+	unsigned int payload_size = p - d - 2;
+	*reinterpret_cast<unsigned short*>(d) = compact_packet_flag | payload_size;
+
+	if (define_name)
+		name_ids[name] = id;
+
+	return p - d;
+}
+
+void NetGameCompactEncoder::send_data(DataBuffer &buffer, const NetGameEvent &e)
+{
+	unsigned int pos = buffer.get_size();
+	while (true)
+	{
+		unsigned int available = buffer.get_capacity() - pos;
+		unsigned int length = encode(buffer.get_data<unsigned char>() + pos, available, e);
+		if (length != 0)
+		{
+			buffer.set_size(pos + length);
+			return;
+		}
+		buffer.set_capacity(max(pos + 64, buffer.get_capacity() * 2));
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// NetGameCompactEncoder Implementation:
+
+bool NetGameCompactEncoder::encode_delta_arguments(unsigned char *&d, unsigned char *end, unsigned int id, const NetGameEvent &e)
+{
+	// Encode the arguments behind room for the argument header and change mask. They are compared
+	// in their encoded form, which is also what is remembered for the next event with this name.
+	const unsigned int max_header_size = 10;
+	unsigned int count = e.get_argument_count();
+	if ((unsigned int)(end - d) < max_header_size)
+		return false;
+	unsigned char *values = d + max_header_size;
+	unsigned char *values_end = values;
+	unsigned int offsets[max_delta_arguments + 1];
+	offsets[0] = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (!encode_value(values_end, end, e.get_argument(i)))
+			return false;
+		offsets[i + 1] = values_end - values;
+	}
+
+	// The packet fits from here on, so the encoder state can be updated
+	if (id >= last_events.size())
+		last_events.resize(id + 1);
+	LastEvent &last = last_events[id];
+
+	unsigned int changed_mask = 0;
+	bool delta = last.valid && last.offsets.size() == count + 1;
+	if (delta)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int length = offsets[i + 1] - offsets[i];
+			unsigned int last_length = last.offsets[i + 1] - last.offsets[i];
+			if (length != last_length || memcmp(values + offsets[i], &last.values[last.offsets[i]], length) != 0)
+				changed_mask |= 1u << i;
+		}
+
+		// Skip the mask when everything changed
+		unsigned int all_mask = (count == 32) ? 0xffffffff : (1u << count) - 1;
+		delta = (changed_mask != all_mask);
+	}
+
+	last.values.assign(values, values_end);
+	last.offsets.assign(offsets, offsets + count + 1);
+	last.valid = true;
+
+	unsigned int argument_header = (count << argument_header_count_shift) | argument_header_remember;
+	if (delta)
+		argument_header |= argument_header_delta;
+	write_varint(d, end, argument_header);
+	if (delta)
+		write_varint(d, end, changed_mask);
+
+	// Move the arguments that are sent down behind the header
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (!delta || (changed_mask & (1u << i)))
+		{
+			unsigned int length = offsets[i + 1] - offsets[i];
+			memmove(d, values + offsets[i], length);
+			d += length;
+		}
+	}
+	return true;
+}
+
+bool NetGameCompactEncoder::encode_value(unsigned char *&d, unsigned char *end, const NetGameEventValue &value)
+{
+	if (d == end)
+		return false;
+
+	// Type codes are the same as in the original format
+	switch (value.get_type())
+	{
+	case NetGameEventValue::null:
+		*(d++) = 1;
+		return true;
+	case NetGameEventValue::uinteger:
+		*(d++) = 2;
+		return write_varint(d, end, value.to_uinteger());
+	case NetGameEventValue::integer:
+		*(d++) = 3;
+		return write_varint(d, end, zigzag_encode(value.to_integer()));
+	case NetGameEventValue::number:
+		{
+			*(d++) = 4;
+			float v = value.to_number();
+			return write_bytes(d, end, &v, sizeof(float));
+		}
+	case NetGameEventValue::boolean:
+		*(d++) = value.to_boolean() ? 6 : 5;
+		return true;
+	case NetGameEventValue::string:
+		{
+			const std::string &s = value.to_string();
+			*(d++) = 7;
+			return write_varint(d, end, s.length()) && write_bytes(d, end, s.data(), s.length());
+		}
+	case NetGameEventValue::complex:
+		{
+			*(d++) = 8;
+			if (!write_varint(d, end, value.get_member_count()))
+				return false;
+			for (unsigned int i = 0; i < value.get_member_count(); i++)
+			{
+				if (!encode_value(d, end, value.get_member(i)))
+					return false;
+			}
+			return true;
+		}
+	case NetGameEventValue::ucharacter:
+		{
+			*(d++) = 9;
+			unsigned char v = value.to_ucharacter();
+			return write_bytes(d, end, &v, 1);
+		}
+	case NetGameEventValue::character:
+		{
+			*(d++) = 10;
+			char v = value.to_character();
+			return write_bytes(d, end, &v, 1);
+		}
+	case NetGameEventValue::binary:
+		{
+			DataBuffer s = value.to_binary();
+			*(d++) = 11;
+			return write_varint(d, end, s.get_size()) && write_bytes(d, end, s.get_data(), s.get_size());
+		}
+	default:
+		throw Exception("Unknown game event value type");
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// NetGameCompactDecoder Operations:
+
+NetGameEvent NetGameCompactDecoder::receive_data(const void *data, int size, int &out_bytes_consumed)
+{
+	if (size >= 2)
+	{
+		unsigned int header = *static_cast<const unsigned short *>(data);
+		if ((header & compact_packet_flag) == 0)
+			return NetGameNetworkData::receive_data(data, size, out_bytes_consumed);
+
+		int payload_size = header & ~compact_packet_flag;
+		if (payload_size > NetGameNetworkData::packet_limit)
+			throw Exception("Incoming message too big");
+
+		if (size >= 2 + payload_size)
+		{
+			out_bytes_consumed = 2 + payload_size;
+			return decode_event(static_cast<const unsigned char*>(data) + 2, payload_size);
+		}
+	}
+
+	out_bytes_consumed = 0;
+	return NetGameEvent(std::string());
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// NetGameCompactDecoder Implementation:
+
+NetGameEvent NetGameCompactDecoder::decode_event(const unsigned char *d, unsigned int length)
+{
+	const unsigned char *end = d + length;
+
+	unsigned int name_ref = read_varint(d, end);
+	bool interned = (name_ref != 0);
+	unsigned int id = 0;
+	std::string name;
+	if (name_ref == 0 || (name_ref & 1))
+	{
+		unsigned int name_length = read_varint(d, end);
+		if (name_length > (unsigned int)(end - d))
+			throw Exception("Invalid network data");
+		name.assign(reinterpret_cast<const char*>(d), name_length);
+		d += name_length;
+
+		if (interned)
+		{
+			id = name_ref >> 1;
+			if (id != names.size() || id >= max_interned_names)
+				throw Exception("Invalid network data");
+			names.push_back(name);
+		}
+	}
+	else
+	{
+		id = (name_ref >> 1) - 1;
+		if (id >= names.size())
+			throw Exception("Invalid network data");
+	}
+
+	NetGameEvent e(interned ? names[id] : name);
+
+	unsigned int argument_header = read_varint(d, end);
+	unsigned int count = argument_header >> argument_header_count_shift;
+	bool remember = (argument_header & argument_header_remember) != 0;
+	bool delta = (argument_header & argument_header_delta) != 0;
+	if (count > length || ((remember || delta) && (!interned || count > max_delta_arguments)))
+		throw Exception("Invalid network data");
+
+	if (delta)
+	{
+		if (id >= last_arguments.size() || last_arguments[id].size() != count)
+			throw Exception("Invalid network data");
+
+		unsigned int changed_mask = read_varint(d, end);
+		if (count < 32 && (changed_mask >> count) != 0)
+			throw Exception("Invalid network data");
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (changed_mask & (1u << i))
+				e.add_argument(decode_value(d, end, 0));
+			else
+				e.add_argument(last_arguments[id][i]);
+		}
+	}
+	else
+	{
+		for (unsigned int i = 0; i < count; i++)
+			e.add_argument(decode_value(d, end, 0));
+	}
+
+	if (d != end)
+		throw Exception("Invalid network data");
+
+	if (remember)
+	{
+		if (id >= last_arguments.size())
+			last_arguments.resize(id + 1);
+		std::vector<NetGameEventValue> &last = last_arguments[id];
+		last.resize(count);
+		for (unsigned int i = 0; i < count; i++)
+			last[i] = e.get_argument(i);
+	}
+
+	return e;
+}
+
+NetGameEventValue NetGameCompactDecoder::decode_value(const unsigned char *&d, const unsigned char *end, int depth)
+{
+	if (d == end || depth > max_value_depth)
+		throw Exception("Invalid network data");
+
+	unsigned char type = *(d++);
+	switch (type)
+	{
+	case 1: // null
+		return NetGameEventValue(NetGameEventValue::null);
+	case 2: // uint
+		return NetGameEventValue(read_varint(d, end));
+	case 3: // int
+		return NetGameEventValue(zigzag_decode(read_varint(d, end)));
+	case 4: // number
+		{
+			float v;
+			read_bytes(d, end, &v, sizeof(float));
+			return NetGameEventValue(v);
+		}
+	case 5: // false boolean
+		return NetGameEventValue(false);
+	case 6: // true boolean
+		return NetGameEventValue(true);
+	case 7: // string
+		{
+			unsigned int string_length = read_varint(d, end);
+			if (string_length > (unsigned int)(end - d))
+				throw Exception("Invalid network data");
+			std::string value(reinterpret_cast<const char*>(d), string_length);
+			d += string_length;
+			return NetGameEventValue(value);
+		}
+	case 8: // complex
+		{
+			unsigned int member_count = read_varint(d, end);
+			if (member_count > (unsigned int)(end - d))
+				throw Exception("Invalid network data");
+			NetGameEventValue value(NetGameEventValue::complex);
+			for (unsigned int i = 0; i < member_count; i++)
+				value.add_member(decode_value(d, end, depth + 1));
+			return value;
+		}
+	case 9: // uchar
+		{
+			unsigned char v;
+			read_bytes(d, end, &v, 1);
+			return NetGameEventValue(v);
+		}
+	case 10: // char
+		{
+			char v;
+			read_bytes(d, end, &v, 1);
+			return NetGameEventValue(v);
+		}
+	case 11: // binary
+		{
+			unsigned int binary_length = read_varint(d, end);
+			if (binary_length > (unsigned int)(end - d))
+				throw Exception("Invalid network data");
+			DataBuffer value(reinterpret_cast<const char*>(d), binary_length);
+			d += binary_length;
+			return NetGameEventValue(value);
+		}
+	default:
+		throw Exception("Invalid network data");
+	}
+}
+
+}
@@ -0,0 +1,99 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "API/Network/NetGame/event.h"
+#include <map>
+#include <vector>
+
+namespace clan
+{
+
+class DataBuffer;
+
+/// \brief Encodes events in the compact NetGame wire format
+///
+/// Compact packets set the top bit of the 16 bit length prefix, which never occurs in the
+/// original format. Integers are written as varints (zigzag for signed values), event names
+/// are sent once per connection and then referred to by index, and with delta encoding an
+/// event only carries the arguments that changed since the last event with the same name.
+///
+/// The encoder keeps per connection state and must only be used after the peer announced
+/// that it understands the format.
+class NetGameCompactEncoder
+{
+public:
+	NetGameCompactEncoder();
+
+	/// \brief Sends only changed arguments of repeated events
+	void set_delta_encoding(bool enable);
+
+	/// \brief Encodes an event as a complete packet
+	///
+	/// Nothing is allocated, except when a new event name or argument list is remembered.
+	///
+	/// \return Size of the packet, or 0 if it did not fit. The encoder state is unchanged in that case.
+	unsigned int encode(unsigned char *d, unsigned int size, const NetGameEvent &e);
+
+	/// \brief Encodes an event and appends the packet to the end of buffer
+	void send_data(DataBuffer &buffer, const NetGameEvent &e);
+
+private:
+	bool encode_delta_arguments(unsigned char *&d, unsigned char *end, unsigned int id, const NetGameEvent &e);
+	static bool encode_value(unsigned char *&d, unsigned char *end, const NetGameEventValue &value);
+
+	bool delta_encoding;
+	std::map<std::string, unsigned int> name_ids;
+
+	// Encoded arguments of the last event sent with each name, for delta encoding
+	struct LastEvent
+	{
+		LastEvent() : valid(false) { }
+		bool valid;
+		std::vector<unsigned char> values;
+		std::vector<unsigned int> offsets;
+	};
+	std::vector<LastEvent> last_events;
+};
+
+/// \brief Decodes packets in both the original and the compact NetGame wire format
+class NetGameCompactDecoder
+{
+public:
+	NetGameEvent receive_data(const void *data, int size, int &out_bytes_consumed);
+
+private:
+	NetGameEvent decode_event(const unsigned char *d, unsigned int length);
+	static NetGameEventValue decode_value(const unsigned char *&d, const unsigned char *end, int depth);
+
+	std::vector<std::string> names;
+	std::vector<std::vector<NetGameEventValue> > last_arguments;
+};
+
+}
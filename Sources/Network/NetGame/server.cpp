@@ -32,6 +32,7 @@
 #include "API/Network/Socket/socket_name.h"
 #include "network_event.h"
 #include "server_impl.h"
+#include "connection_reactor.h"
 #include <algorithm>
 
 namespace clan
@@ -42,9 +43,19 @@ NetGameServer::NetGameServer()
 {
 }
 
+NetGameServer::NetGameServer(bool use_reactor, int num_reactor_threads)
+: impl(new NetGameServer_Impl)
+{
+#ifdef __linux__
+	if (use_reactor)
+		impl->reactor = std::shared_ptr<NetGameConnectionReactor>(new NetGameConnectionReactor(num_reactor_threads));
+#endif
+}
+
 NetGameServer::~NetGameServer()
 {
 	stop();
+	impl->reactor.reset();
 }
 
 void NetGameServer::process_events()
@@ -68,11 +79,40 @@ void NetGameServer::send_event(const NetGameEvent &game_event)
 	}
 }
 
+void NetGameServer::set_flush_policy(NetGameConnection::FlushPolicy policy)
+{
+	MutexSection mutex_lock(&impl->mutex);
+	impl->flush_policy = policy;
+	for (unsigned int i = 0; i < impl->connections.size(); i++)
+	{
+		impl->connections[i]->set_flush_policy(policy);
+	}
+}
+
+void NetGameServer::set_delta_encoding(bool enable)
+{
+	MutexSection mutex_lock(&impl->mutex);
+	impl->delta_encoding = enable;
+	for (unsigned int i = 0; i < impl->connections.size(); i++)
+	{
+		impl->connections[i]->set_delta_encoding(enable);
+	}
+}
+
+void NetGameServer::flush()
+{
+	MutexSection mutex_lock(&impl->mutex);
+	for (unsigned int i = 0; i < impl->connections.size(); i++)
+	{
+		impl->connections[i]->flush();
+	}
+}
+
 void NetGameServer::start(const std::string &port)
 {
 	stop();
 	impl->stop_event.reset();
-	impl->tcp_listen.reset(new TCPListen(SocketName(port)));
+	impl->tcp_listen.reset(new TCPListen(SocketName(port), NetGameServer_Impl::listen_queue_size));
 	impl->listen_thread.start(this, &NetGameServer::listen_thread_main);
 }
 
@@ -80,7 +120,7 @@ void NetGameServer::start(const std::string &address, const std::string &port)
 {
 	stop();
 	impl->stop_event.reset();
-	impl->tcp_listen.reset(new TCPListen(SocketName(address, port)));
+	impl->tcp_listen.reset(new TCPListen(SocketName(address, port), NetGameServer_Impl::listen_queue_size));
 	impl->listen_thread.start(this, &NetGameServer::listen_thread_main);
 }
 
@@ -107,8 +147,14 @@ void NetGameServer::listen_thread_main()
 			break;
 
 		TCPConnection connection = impl->tcp_listen->accept();
-		std::unique_ptr<NetGameConnection> game_connection(new NetGameConnection(this, connection));
+		std::unique_ptr<NetGameConnection> game_connection;
+		if (impl->reactor)
+			game_connection.reset(new NetGameConnection(this, connection, impl->reactor.get()));
+		else
+			game_connection.reset(new NetGameConnection(this, connection));
 		MutexSection mutex_lock(&impl->mutex);
+		game_connection->set_flush_policy(impl->flush_policy);
+		game_connection->set_delta_encoding(impl->delta_encoding);
 		impl->connections.push_back(game_connection.release());
 	}
 }
@@ -151,7 +197,8 @@ void NetGameServer_Impl::process()
 				sig_game_client_disconnected.invoke(new_events[i].connection, reason);
 			}
 
-			// Destroy connection object
+			// Destroy connection object. Reactor threads add events while holding their own lock,
+			// so the connection must be destroyed after our mutex is released.
 			{
 				MutexSection mutex_lock(&mutex);
 				std::vector<NetGameConnection *>::iterator connection_it;
@@ -160,6 +207,7 @@ void NetGameServer_Impl::process()
 				{
 					connections.erase( connection_it );
 				}
+				mutex_lock.unlock();
 				delete new_events[i].connection;
 			}
 			break;
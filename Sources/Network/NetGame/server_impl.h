@@ -35,9 +35,13 @@
 namespace clan
 {
 
+class NetGameConnectionReactor;
+
 class NetGameServer_Impl : public KeepAliveObject
 {
 public:
+	NetGameServer_Impl() : flush_policy(NetGameConnection::flush_immediately), delta_encoding(false) { }
+
 	void process();
 
 	std::unique_ptr<TCPListen> tcp_listen;
@@ -47,6 +51,13 @@ public:
 	Event stop_event;
 	std::vector<NetGameConnection *> connections;
 	std::vector<NetGameNetworkEvent> events;
+	NetGameConnection::FlushPolicy flush_policy;
+	bool delta_encoding;
+
+	std::shared_ptr<NetGameConnectionReactor> reactor;
+
+	// Lets a full server of players connect at once without dropped connection attempts
+	static const int listen_queue_size = 128;
 
 	Signal_v1<NetGameConnection *> sig_game_client_connected;
 	Signal_v2<NetGameConnection *, const std::string &> sig_game_client_disconnected;
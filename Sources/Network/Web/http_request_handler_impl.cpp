@@ -45,7 +45,6 @@ HTTPRequestHandler_Impl::~HTTPRequestHandler_Impl()
 {
 	if (provider)
 		delete provider;
-		delete provider;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -29,6 +29,7 @@
 #include "Network/precomp.h"
 #include "API/Network/Web/http_server.h"
 #include "http_server_impl.h"
+#include "http_server_reactor.h"
 
 namespace clan
 {
@@ -37,7 +38,12 @@ namespace clan
 // HTTPServer Construction:
 
 HTTPServer::HTTPServer()
-: impl(new HTTPServer_Impl)
+: impl(new HTTPServer_Impl(false, 0))
+{
+}
+
+HTTPServer::HTTPServer(bool use_reactor, int num_workers)
+: impl(new HTTPServer_Impl(use_reactor, num_workers))
 {
 }
 
@@ -53,10 +59,16 @@ HTTPServer::~HTTPServer()
 
 void HTTPServer::bind(const SocketName &name)
 {
-	TCPListen tcp_listen(name);
+	// The reactor accepts connections in bursts; give it a longer backlog to absorb them
+	int queue_size = impl->reactor ? 128 : 5;
+	TCPListen tcp_listen(name, queue_size);
 	MutexSection mutex_lock(&impl->mutex);
 	impl->listen_ports.push_back(tcp_listen);
 	impl->update_event.set();
+#ifdef __linux__
+	if (impl->reactor)
+		impl->reactor->wakeup();
+#endif
 }
 
 void HTTPServer::add_handler(const HTTPRequestHandler &handler)
@@ -62,13 +62,13 @@ public:
 	int send(const void *data, int len, bool send_all)
 	{
 		impl.lock()->performed_write = true;
-		return impl.lock()->connection.send(data, len, send_all);
+		return impl.lock()->write(data, len);
 	}
 
 	int receive(void *data, int len, bool receive_all)
 	{
 		impl.lock()->performed_read = true;
-		return impl.lock()->connection.receive(data, len, receive_all);
+		return impl.lock()->read(data, len, receive_all);
 	}
 
 	int peek(void *data, int len)
@@ -144,7 +144,8 @@ DataBuffer HTTPServerConnection::read_request_data()
 
 	impl->request_read = true;
 
-	if (impl->request_type == "POST")
+	// In buffered mode the server has already read the request data
+	if (impl->request_type == "POST" && !impl->buffered)
 	{
 		std::string content_length = impl->get_header_value("Content-Length", impl->request_headers);
 		std::string transfer_encoding = impl->get_header_value("Transfer-Encoding", impl->request_headers);
@@ -218,7 +219,7 @@ void HTTPServerConnection::write_response_status(int status_code, const std::str
 	status_line.append(" ");
 	status_line.append(status_text);
 	status_line.append("\r\n");
-	impl->connection.write(status_line.data(), status_line.length(), true);
+	impl->write(status_line.data(), status_line.length());
 }
 
 void HTTPServerConnection::write_response_headers(const std::string &headers)
@@ -270,20 +271,23 @@ void HTTPServerConnection::write_response_headers(const std::string &headers)
 			else if (name == "Vary")
 				vary_line = true;
 
-			impl->connection.write(line.data(), line.length(), true);
-			impl->connection.write("\r\n", 2, true);
+			impl->write(line.data(), line.length());
+			impl->write("\r\n", 2);
 		}
 	}
 
 	static std::string str_server_line("Server: ClanLib HTTP Server\r\n");
 	static std::string str_connection_line("Connection: close\r\n");
+	static std::string str_keep_alive_line("Connection: keep-alive\r\n");
 	static std::string str_vary_line("Vary: *\r\n");
 	if (!server_line)
-		impl->connection.write(str_server_line.data(), str_server_line.length(), true);
-	if (!connection_line)
-		impl->connection.write(str_connection_line.data(), str_connection_line.length(), true);
+		impl->write(str_server_line.data(), str_server_line.length());
+	if (!connection_line && impl->keep_alive)
+		impl->write(str_keep_alive_line.data(), str_keep_alive_line.length());
+	else if (!connection_line)
+		impl->write(str_connection_line.data(), str_connection_line.length());
 	if (!date_line && !expires_line && !vary_line)
-		impl->connection.write(str_vary_line.data(), str_vary_line.length(), true);
+		impl->write(str_vary_line.data(), str_vary_line.length());
 //	write_line(connection, "Date: Sun, 16 Oct 2005 20:13:00 GMT");
 //	write_line(connection, "Expires: Sun, 16 Oct 2005 20:13:00 GMT");
 
@@ -305,16 +309,17 @@ void HTTPServerConnection::write_response_data(const DataBuffer &data)
 			length.append("Content-Length: ");
 			length.append(StringHelp::int_to_local8(data.get_size()));
 			length.append("\r\n");
-			impl->connection.write(length.data(), length.length(), true);
+			impl->write(length.data(), length.length());
+			impl->response_framed = true;
 		}
-		impl->connection.write("\r\n", 2, true);
+		impl->write("\r\n", 2);
 	}
 	impl->writing_header = false;
 	if (impl->written_content_length >= 0 && data.get_size() != impl->written_content_length)
 		throw Exception("HTTP Content-Length in header does not match response data size!");
 
 	// Header should be ok.  Write the actual data:
-	impl->connection.write(data.get_data(), data.get_size(), true);
+	impl->write(data.get_data(), data.get_size());
 }
 
 /////////////////////////////////////////////////////////////////////////////
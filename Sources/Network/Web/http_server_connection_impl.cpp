@@ -28,6 +28,7 @@
 
 #include "Network/precomp.h"
 #include "http_server_connection_impl.h"
+#include "API/Core/Math/cl_math.h"
 
 namespace clan
 {
@@ -35,9 +36,10 @@ namespace clan
 /////////////////////////////////////////////////////////////////////////////
 // HTTPServerConnection_Impl Construction:
 
-HTTPServerConnection_Impl::HTTPServerConnection_Impl()
-: request_read(false), performed_read(false), performed_write(false),
-  writing_header(false), written_content_length(-1)
+HTTPServerConnection_Impl::HTTPServerConnection_Impl(const TCPConnection &connection)
+: connection(connection), request_read(false), performed_read(false), performed_write(false),
+  writing_header(false), written_content_length(-1), buffered(false), keep_alive(false),
+  response_framed(false), request_data_pos(0)
 {
 }
 
@@ -51,6 +53,36 @@ HTTPServerConnection_Impl::~HTTPServerConnection_Impl()
 /////////////////////////////////////////////////////////////////////////////
 // HTTPServerConnection_Impl Operations:
 
+int HTTPServerConnection_Impl::write(const void *data, int len)
+{
+	if (buffered)
+	{
+		response_data.append((const char *) data, len);
+		return len;
+	}
+	else
+	{
+		return connection.write(data, len, true);
+	}
+}
+
+int HTTPServerConnection_Impl::read(void *data, int len, bool receive_all)
+{
+	if (buffered)
+	{
+		int available = min(len, request_data.get_size() - request_data_pos);
+		if (receive_all && available != len)
+			throw Exception("Unable to receive all data: end of request data");
+		memcpy(data, request_data.get_data() + request_data_pos, available);
+		request_data_pos += available;
+		return available;
+	}
+	else
+	{
+		return connection.receive(data, len, receive_all);
+	}
+}
+
 std::string HTTPServerConnection_Impl::get_header_value(
 	const std::string &name,
 	const std::string &header_lines)
@@ -40,7 +40,7 @@ class HTTPServerConnection_Impl
 /// \{
 
 public:
-	HTTPServerConnection_Impl();
+	HTTPServerConnection_Impl(const TCPConnection &connection);
 
 	~HTTPServerConnection_Impl();
 
@@ -68,12 +68,29 @@ public:
 
 	byte64 written_content_length;
 
+	/// \brief True when the request was fully read by the server and the response is collected in response_data
+	bool buffered;
+
+	/// \brief True if the connection is kept open after the response (buffered mode only)
+	bool keep_alive;
+
+	/// \brief True if the response length is known to the client
+	bool response_framed;
+
+	int request_data_pos;
+
+	std::string response_data;
+
 
 /// \}
 /// \name Operations
 /// \{
 
 public:
+	int write(const void *data, int len);
+
+	int read(void *data, int len, bool receive_all);
+
 	static std::string get_header_value(
 		const std::string &name,
 		const std::string &header_lines);
@@ -34,6 +34,7 @@
 #include "API/Network/Web/http_server_connection.h"
 #include "http_server_impl.h"
 #include "http_server_connection_impl.h"
+#include "http_server_reactor.h"
 
 namespace clan
 {
@@ -41,13 +42,21 @@ namespace clan
 /////////////////////////////////////////////////////////////////////////////
 // HTTPServer_Impl Construction:
 
-HTTPServer_Impl::HTTPServer_Impl()
+HTTPServer_Impl::HTTPServer_Impl(bool use_reactor, int num_workers)
 {
+#ifdef __linux__
+	if (use_reactor)
+	{
+		reactor = std::shared_ptr<HTTPServerReactor>(new HTTPServerReactor(this, num_workers));
+		return;
+	}
+#endif
 	accept_thread.start(this, &HTTPServer_Impl::accept_thread_main);
 }
 
 HTTPServer_Impl::~HTTPServer_Impl()
 {
+	reactor.reset();
 	stop_event.set();
 	accept_thread.join();
 }
@@ -121,6 +130,37 @@ bool HTTPServer_Impl::read_lines(TCPConnection &connection, std::string &out_hea
 	return false;
 }
 
+bool HTTPServer_Impl::find_handler(const std::string &command, const std::string &url, const std::string &headers, HTTPRequestHandler &out_handler)
+{
+	MutexSection mutex_lock(&mutex);
+	std::vector<HTTPRequestHandler>::size_type index, size;
+	size = handlers.size();
+	for (index = 0; index < size; index++)
+	{
+		if (handlers[index].is_handling_request(command, url, headers))
+		{
+			out_handler = handlers[index];
+			return true;
+		}
+	}
+	return false;
+}
+
+std::string HTTPServer_Impl::get_not_found_response(bool keep_alive)
+{
+	std::string error_msg("404 Not Found");
+	std::string response;
+	response.append("HTTP/1.1 404 Not Found\r\n");
+	response.append("Server: ClanLib HTTP Server\r\n");
+	response.append(keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n");
+	response.append("Vary: *\r\n");
+	response.append("Content-Type: text/plain\r\n");
+	response.append("Content-Length: " + StringHelp::int_to_local8(error_msg.length()+2) + "\r\n");
+	response.append("\r\n");
+	response.append(error_msg + "\r\n");
+	return response;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // HTTPServer_Impl Implementation:
 
@@ -198,49 +238,28 @@ void HTTPServer_Impl::connection_thread_main(TCPConnection connection)
 		// Handle request:
 
 		// Look for a request handler that will deal with the HTTP request:
-		MutexSection mutex_lock(&mutex);
-		std::vector<HTTPRequestHandler>::size_type index, size;
-		size = handlers.size();
-		bool handled = false;
-		for (index = 0; index < size; index++)
+		HTTPRequestHandler handler;
+		if (find_handler(command, url, headers, handler))
 		{
-			if (handlers[index].is_handling_request(command, url, headers))
+			if (command == "POST")
 			{
-				HTTPRequestHandler handler = handlers[index];
-				mutex_lock.unlock();
-
-				if (command == "POST")
-				{
-					write_line(connection, "HTTP/1.1 100 Continue");
-					// write_line(connection, "Content-Length: 0");
-					write_line(connection, "");
-				}
-
-				std::shared_ptr<HTTPServerConnection_Impl> connection_impl(new HTTPServerConnection_Impl);
-				connection_impl->connection = connection;
-				connection_impl->request_type = command;
-				connection_impl->request_url = url;
-				connection_impl->request_headers = headers;
-				HTTPServerConnection http_connection(connection_impl);
-				handler.handle_request(http_connection);
-				handled = true;
-				break;
+				write_line(connection, "HTTP/1.1 100 Continue");
+				// write_line(connection, "Content-Length: 0");
+				write_line(connection, "");
 			}
-		}
-		mutex_lock.unlock();
 
-		if (!handled)
+			std::shared_ptr<HTTPServerConnection_Impl> connection_impl(new HTTPServerConnection_Impl(connection));
+			connection_impl->request_type = command;
+			connection_impl->request_url = url;
+			connection_impl->request_headers = headers;
+			HTTPServerConnection http_connection(connection_impl);
+			handler.handle_request(http_connection);
+		}
+		else
 		{
 			// No handler wants it.  Reply with 404 Not Found:
-			std::string error_msg("404 Not Found");
-			write_line(connection, "HTTP/1.1 404 Not Found");
-			write_line(connection, "Server: ClanLib HTTP Server");
-			write_line(connection, "Connection: close");
-			write_line(connection, "Vary: *");
-			write_line(connection, "Content-Type: text/plain");
-			write_line(connection, "Content-Length: " + StringHelp::int_to_local8(error_msg.length()+2));
-			write_line(connection, "");
-			write_line(connection, error_msg);
+			std::string response = get_not_found_response(false);
+			connection.send(response.data(), response.length(), true);
 		}
 
 		connection.disconnect_graceful();
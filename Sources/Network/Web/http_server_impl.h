@@ -39,13 +39,15 @@
 namespace clan
 {
 
+class HTTPServerReactor;
+
 class HTTPServer_Impl
 {
 /// \name Construction
 /// \{
 
 public:
-	HTTPServer_Impl();
+	HTTPServer_Impl(bool use_reactor, int num_workers);
 
 	~HTTPServer_Impl();
 
@@ -65,6 +67,8 @@ public:
 
 	std::vector<TCPListen> listen_ports;
 
+	std::shared_ptr<HTTPServerReactor> reactor;
+
 
 /// \}
 /// \name Operations
@@ -77,6 +81,12 @@ public:
 
 	static bool read_lines(TCPConnection &connection, std::string &out_header_lines);
 
+	/// \brief Looks for a request handler that will deal with the HTTP request
+	bool find_handler(const std::string &command, const std::string &url, const std::string &headers, HTTPRequestHandler &out_handler);
+
+	/// \brief Returns the full response sent when no handler wants the request
+	static std::string get_not_found_response(bool keep_alive);
+
 
 /// \}
 /// \name Implementation
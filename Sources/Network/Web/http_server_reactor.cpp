@@ -0,0 +1,608 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Network/precomp.h"
+
+#ifdef __linux__
+
+#include "http_server_reactor.h"
+#include "http_server_impl.h"
+#include "http_server_connection_impl.h"
+#include "API/Network/Web/http_server_connection.h"
+#include "API/Network/Web/http_request_handler.h"
+#include "API/Core/System/system.h"
+#include "API/Core/System/exception.h"
+#include "API/Core/Text/string_help.h"
+#include "API/Core/Text/logger.h"
+#include "API/Core/Math/cl_math.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+namespace clan
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// HTTPServerReactor Construction:
+
+HTTPServerReactor::HTTPServerReactor(HTTPServer_Impl *server, int num_workers)
+: server(server), epoll_handle(-1), wakeup_handle(-1), no_connection(-1, false), work_event(false)
+{
+	epoll_handle = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_handle == -1)
+		throw Exception("Unable to create epoll instance");
+
+	wakeup_handle = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (wakeup_handle == -1)
+	{
+		close(epoll_handle);
+		throw Exception("Unable to create eventfd");
+	}
+
+	epoll_event event;
+	memset(&event, 0, sizeof(epoll_event));
+	event.events = EPOLLIN;
+	event.data.fd = wakeup_handle;
+	epoll_ctl(epoll_handle, EPOLL_CTL_ADD, wakeup_handle, &event);
+
+	if (num_workers <= 0)
+		num_workers = max(System::get_num_cores() - 1, 1);
+	for (int i = 0; i < num_workers; i++)
+	{
+		Thread thread;
+		thread.start(this, &HTTPServerReactor::worker_thread_main);
+		worker_threads.push_back(thread);
+	}
+
+	reactor_thread.start(this, &HTTPServerReactor::reactor_thread_main);
+}
+
+HTTPServerReactor::~HTTPServerReactor()
+{
+	// Workers check stop_flag under the same lock before they signal wakeup_handle
+	MutexSection mutex_lock(&completed_mutex);
+	stop_flag.set(1);
+	wakeup();
+	mutex_lock.unlock();
+
+	stop_event.set();
+	reactor_thread.join();
+	for (std::vector<Thread>::size_type i = 0; i < worker_threads.size(); i++)
+		worker_threads[i].join();
+
+	std::map<int, std::shared_ptr<Client> >::iterator it;
+	for (it = clients.begin(); it != clients.end(); ++it)
+	{
+		it->second->closed = true;
+		close(it->second->handle);
+	}
+	clients.clear();
+
+	close(wakeup_handle);
+	close(epoll_handle);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// HTTPServerReactor Operations:
+
+void HTTPServerReactor::wakeup()
+{
+	eventfd_write(wakeup_handle, 1);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// HTTPServerReactor Implementation:
+
+void HTTPServerReactor::reactor_thread_main()
+{
+	update_listen_ports();
+
+	std::vector<epoll_event> events(256);
+	ubyte64 last_idle_check = System::get_time();
+	while (stop_flag.get() == 0)
+	{
+		int count = epoll_wait(epoll_handle, &events[0], events.size(), 1000);
+		if (count == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			log_event("error", "HTTPServer: epoll_wait failed");
+			break;
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			int handle = events[i].data.fd;
+			if (handle == wakeup_handle)
+			{
+				eventfd_t value;
+				eventfd_read(wakeup_handle, &value);
+				update_listen_ports();
+				process_completed();
+			}
+			else if (listen_ports.find(handle) != listen_ports.end())
+			{
+				accept_connections(handle);
+			}
+			else
+			{
+				std::map<int, std::shared_ptr<Client> >::iterator it = clients.find(handle);
+				if (it == clients.end())
+					continue;
+
+				std::shared_ptr<Client> client = it->second;
+				if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+				{
+					if (client->peer_closed)
+					{
+						// Both directions are shut down; nothing more can be sent
+						close_client(client);
+						continue;
+					}
+					read_client(client);
+				}
+				if (!client->closed && (events[i].events & EPOLLOUT))
+					write_client(client);
+				if (!client->closed)
+				{
+					process_input(client);
+					update_client(client);
+				}
+			}
+		}
+
+		ubyte64 current_time = System::get_time();
+		if (current_time - last_idle_check >= 1000)
+		{
+			last_idle_check = current_time;
+			close_idle_clients();
+		}
+	}
+}
+
+void HTTPServerReactor::update_listen_ports()
+{
+	MutexSection mutex_lock(&server->mutex);
+	for (std::vector<TCPListen>::size_type i = 0; i < server->listen_ports.size(); i++)
+	{
+		int handle = server->listen_ports[i].get_handle();
+		if (listen_ports.find(handle) == listen_ports.end())
+		{
+			listen_ports.insert(std::pair<int, TCPListen>(handle, server->listen_ports[i]));
+
+			epoll_event event;
+			memset(&event, 0, sizeof(epoll_event));
+			event.events = EPOLLIN;
+			event.data.fd = handle;
+			epoll_ctl(epoll_handle, EPOLL_CTL_ADD, handle, &event);
+		}
+	}
+}
+
+void HTTPServerReactor::accept_connections(int listen_handle)
+{
+	while (true)
+	{
+		int handle = accept4(listen_handle, 0, 0, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (handle == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				log_event("error", "HTTPServer: accept failed: %1", std::string(strerror(errno)));
+			break;
+		}
+
+		// Responses are written in one piece; no need to wait for more data
+		int nodelay = 1;
+		setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(int));
+
+		std::shared_ptr<Client> client(new Client);
+		client->handle = handle;
+		client->last_activity = System::get_time();
+		client->events = EPOLLIN;
+
+		epoll_event event;
+		memset(&event, 0, sizeof(epoll_event));
+		event.events = client->events;
+		event.data.fd = handle;
+		if (epoll_ctl(epoll_handle, EPOLL_CTL_ADD, handle, &event) == -1)
+		{
+			close(handle);
+			continue;
+		}
+
+		clients[handle] = client;
+	}
+}
+
+void HTTPServerReactor::read_client(const std::shared_ptr<Client> &client)
+{
+	while (!client->input.is_full())
+	{
+		int received = recv(client->handle, client->input.get_write_pos(), client->input.get_write_size(), 0);
+		if (received > 0)
+		{
+			client->input.write(received);
+			client->last_activity = System::get_time();
+		}
+		else if (received == 0)
+		{
+			client->peer_closed = true;
+			break;
+		}
+		else if (errno == EINTR)
+		{
+			continue;
+		}
+		else if (errno == EAGAIN || errno == EWOULDBLOCK)
+		{
+			break;
+		}
+		else
+		{
+			close_client(client);
+			break;
+		}
+	}
+}
+
+void HTTPServerReactor::write_client(const std::shared_ptr<Client> &client)
+{
+	while (client->output_pos < client->output.length())
+	{
+		int sent = send(client->handle, client->output.data() + client->output_pos, client->output.length() - client->output_pos, MSG_NOSIGNAL);
+		if (sent >= 0)
+		{
+			client->output_pos += sent;
+			client->last_activity = System::get_time();
+		}
+		else if (errno == EINTR)
+		{
+			continue;
+		}
+		else if (errno == EAGAIN || errno == EWOULDBLOCK)
+		{
+			return;
+		}
+		else
+		{
+			close_client(client);
+			return;
+		}
+	}
+
+	client->output.clear();
+	client->output_pos = 0;
+}
+
+void HTTPServerReactor::process_input(const std::shared_ptr<Client> &client)
+{
+	// Only one request per connection is processed at a time, which keeps pipelined responses in order
+	while (!client->closed && !client->request_pending && !client->close_after_output)
+	{
+		if (!client->reading_body)
+		{
+			size_t header_end = client->input.find("\r\n\r\n", 4, client->scan_offset);
+			if (header_end == RingBuffer::npos)
+			{
+				size_t length = client->input.get_length();
+				if (length >= max_header_size)
+					write_error(client, 431, "Request Header Fields Too Large");
+				else
+					client->scan_offset = length > 3 ? length - 3 : 0;
+				break;
+			}
+
+			client->scan_offset = 0;
+			if (header_end + 4 > max_header_size)
+			{
+				write_error(client, 431, "Request Header Fields Too Large");
+				break;
+			}
+
+			if (!parse_request_header(client, header_end + 4))
+				break;
+		}
+
+		int body_size = client->request_body.get_size();
+		while (client->body_pos < body_size && client->input.get_length() > 0)
+		{
+			size_t available = min((size_t)(body_size - client->body_pos), client->input.get_read_size());
+			memcpy(client->request_body.get_data() + client->body_pos, client->input.get_read_pos(), available);
+			client->input.read(available);
+			client->body_pos += available;
+		}
+		if (client->body_pos < body_size)
+			break;
+
+		client->reading_body = false;
+		dispatch_request(client);
+	}
+}
+
+bool HTTPServerReactor::parse_request_header(const std::shared_ptr<Client> &client, size_t header_length)
+{
+	std::string header = client->input.read_to_string(header_length);
+	std::string::size_type line_end = header.find("\r\n");
+	std::string request = header.substr(0, line_end);
+
+	// Extract request command, url and version:
+
+	std::string::size_type pos1 = request.find(' ');
+	std::string::size_type pos2 = (pos1 != std::string::npos) ? request.find(' ', pos1 + 1) : std::string::npos;
+	if (pos2 == std::string::npos || request.find(' ', pos2 + 1) != std::string::npos)
+	{
+		write_error(client, 400, "Bad Request");
+		return false;
+	}
+
+	client->request_type = request.substr(0, pos1);
+	client->request_url = request.substr(pos1 + 1, pos2 - pos1 - 1);
+	client->request_version = request.substr(pos2 + 1);
+	client->request_headers = header.substr(line_end + 2);
+
+	if (client->request_type != "POST" && client->request_type != "GET")
+	{
+		write_error(client, 501, "Not Implemented");
+		return false;
+	}
+
+	std::string connection_header = HTTPServerConnection_Impl::get_header_value("Connection", client->request_headers);
+	if (client->request_version == "HTTP/1.1")
+		client->keep_alive = StringHelp::compare(connection_header, "close", true) != 0;
+	else
+		client->keep_alive = StringHelp::compare(connection_header, "keep-alive", true) == 0;
+
+	// Chunked request bodies are not supported in this mode
+	std::string transfer_encoding = HTTPServerConnection_Impl::get_header_value("Transfer-Encoding", client->request_headers);
+	if (!transfer_encoding.empty() && StringHelp::compare(transfer_encoding, "identity", true) != 0)
+	{
+		write_error(client, 411, "Length Required");
+		return false;
+	}
+
+	int content_length = 0;
+	std::string content_length_header = HTTPServerConnection_Impl::get_header_value("Content-Length", client->request_headers);
+	if (!content_length_header.empty())
+		content_length = StringHelp::text_to_int(content_length_header);
+	if (content_length < 0)
+	{
+		write_error(client, 400, "Bad Request");
+		return false;
+	}
+	else if (content_length > max_body_size)
+	{
+		write_error(client, 413, "Request Entity Too Large");
+		return false;
+	}
+
+	client->request_body = DataBuffer(content_length);
+	client->body_pos = 0;
+	client->reading_body = true;
+
+	if (content_length > (int)client->input.get_length())
+	{
+		std::string expect = HTTPServerConnection_Impl::get_header_value("Expect", client->request_headers);
+		if (StringHelp::compare(expect, "100-continue", true) == 0)
+			client->output.append("HTTP/1.1 100 Continue\r\n\r\n");
+	}
+
+	return true;
+}
+
+void HTTPServerReactor::dispatch_request(const std::shared_ptr<Client> &client)
+{
+	std::shared_ptr<HTTPServerConnection_Impl> connection(new HTTPServerConnection_Impl(no_connection));
+	connection->buffered = true;
+	connection->keep_alive = client->keep_alive;
+	connection->request_type = client->request_type;
+	connection->request_url = client->request_url;
+	connection->request_headers = client->request_headers;
+	connection->request_data = client->request_body;
+	client->request_body = DataBuffer();
+	client->request_pending = true;
+
+	Request request;
+	request.client = client;
+	request.connection = connection;
+	MutexSection mutex_lock(&pending_mutex);
+	pending.push_back(request);
+	mutex_lock.unlock();
+	work_event.set();
+}
+
+void HTTPServerReactor::worker_thread_main()
+{
+	while (true)
+	{
+		MutexSection mutex_lock(&pending_mutex);
+		if (pending.empty())
+		{
+			mutex_lock.unlock();
+			if (Event::wait(stop_event, work_event) != 1)
+				break;
+			continue;
+		}
+
+		Request request = pending.front();
+		pending.pop_front();
+		if (!pending.empty())
+			work_event.set();
+		mutex_lock.unlock();
+
+		process_request(request);
+	}
+}
+
+void HTTPServerReactor::process_request(Request &request)
+{
+	std::shared_ptr<HTTPServerConnection_Impl> &connection = request.connection;
+	try
+	{
+		HTTPRequestHandler handler;
+		if (server->find_handler(connection->request_type, connection->request_url, connection->request_headers, handler))
+		{
+			HTTPServerConnection http_connection(connection);
+			handler.handle_request(http_connection);
+		}
+		else
+		{
+			connection->response_data = HTTPServer_Impl::get_not_found_response(connection->keep_alive);
+			connection->response_framed = true;
+		}
+	}
+	catch (const Exception& e)
+	{
+		log_event("error", e.message);
+		connection->keep_alive = false;
+	}
+
+	// Without a Content-Length the client can only find the end of the response by the connection closing
+	if (!connection->response_framed)
+		connection->keep_alive = false;
+
+	MutexSection mutex_lock(&completed_mutex);
+	if (stop_flag.get() == 0)
+	{
+		completed.push_back(request);
+		wakeup();
+	}
+}
+
+void HTTPServerReactor::process_completed()
+{
+	MutexSection mutex_lock(&completed_mutex);
+	std::vector<Request> requests;
+	requests.swap(completed);
+	mutex_lock.unlock();
+
+	for (std::vector<Request>::size_type i = 0; i < requests.size(); i++)
+	{
+		std::shared_ptr<Client> &client = requests[i].client;
+		if (client->closed)
+			continue;
+
+		client->request_pending = false;
+		client->output.append(requests[i].connection->response_data);
+		if (!requests[i].connection->keep_alive)
+			client->close_after_output = true;
+
+		process_input(client);
+		update_client(client);
+	}
+}
+
+void HTTPServerReactor::write_error(const std::shared_ptr<Client> &client, int status_code, const std::string &status_text)
+{
+	std::string error_msg = StringHelp::int_to_local8(status_code) + " " + status_text;
+	client->output.append("HTTP/1.1 " + error_msg + "\r\n");
+	client->output.append("Server: ClanLib HTTP Server\r\n");
+	client->output.append("Connection: close\r\n");
+	client->output.append("Content-Type: text/plain\r\n");
+	client->output.append("Content-Length: " + StringHelp::int_to_local8(error_msg.length()) + "\r\n");
+	client->output.append("\r\n");
+	client->output.append(error_msg);
+	client->close_after_output = true;
+}
+
+void HTTPServerReactor::update_client(const std::shared_ptr<Client> &client)
+{
+	if (!client->output.empty())
+	{
+		write_client(client);
+		if (client->closed)
+			return;
+	}
+
+	bool output_pending = !client->output.empty();
+	if (!output_pending && !client->request_pending && (client->close_after_output || client->peer_closed))
+	{
+		close_client(client);
+		return;
+	}
+
+	unsigned int events = 0;
+	if (!client->peer_closed && !client->close_after_output && !client->input.is_full())
+		events |= EPOLLIN;
+	if (output_pending)
+		events |= EPOLLOUT;
+
+	if (events != client->events)
+	{
+		client->events = events;
+
+		epoll_event event;
+		memset(&event, 0, sizeof(epoll_event));
+		event.events = events;
+		event.data.fd = client->handle;
+		epoll_ctl(epoll_handle, EPOLL_CTL_MOD, client->handle, &event);
+	}
+}
+
+void HTTPServerReactor::close_client(const std::shared_ptr<Client> &client)
+{
+	if (client->closed)
+		return;
+
+	epoll_ctl(epoll_handle, EPOLL_CTL_DEL, client->handle, 0);
+
+	// Discard unread data so that close sends FIN rather than RST and the client gets the last response
+	shutdown(client->handle, SHUT_WR);
+	char buffer[1024];
+	while (recv(client->handle, buffer, 1024, 0) > 0)
+	{
+	}
+	close(client->handle);
+
+	client->closed = true;
+	clients.erase(client->handle);
+}
+
+void HTTPServerReactor::close_idle_clients()
+{
+	ubyte64 current_time = System::get_time();
+	std::vector<std::shared_ptr<Client> > idle_clients;
+	std::map<int, std::shared_ptr<Client> >::iterator it;
+	for (it = clients.begin(); it != clients.end(); ++it)
+	{
+		if (!it->second->request_pending && current_time - it->second->last_activity >= idle_timeout)
+			idle_clients.push_back(it->second);
+	}
+	for (std::vector<std::shared_ptr<Client> >::size_type i = 0; i < idle_clients.size(); i++)
+		close_client(idle_clients[i]);
+}
+
+}
+
+#endif
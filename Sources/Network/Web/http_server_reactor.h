@@ -0,0 +1,165 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#ifdef __linux__
+
+#include "API/Network/Socket/tcp_listen.h"
+#include "API/Core/System/databuffer.h"
+#include "API/Core/System/mutex.h"
+#include "API/Core/System/thread.h"
+#include "API/Core/System/interlocked_variable.h"
+#include "API/Core/System/event.h"
+#include "API/Network/Socket/tcp_connection.h"
+#include "ring_buffer.h"
+#include <map>
+#include <deque>
+#include <vector>
+
+namespace clan
+{
+
+class HTTPServer_Impl;
+class HTTPServerConnection_Impl;
+
+/// \brief Event driven connection handling for HTTPServer
+///
+/// A single thread multiplexes all listen sockets and connections using epoll.
+/// Requests are parsed from a per connection ring buffer and dispatched to a
+/// fixed pool of worker threads. Responses are collected by the workers and sent
+/// back by the reactor thread, which keeps connections alive and serves pipelined
+/// requests one at a time in the order they arrived.
+class HTTPServerReactor
+{
+/// \name Construction
+/// \{
+
+public:
+	HTTPServerReactor(HTTPServer_Impl *server, int num_workers);
+
+	~HTTPServerReactor();
+
+
+/// \}
+/// \name Operations
+/// \{
+
+public:
+	/// \brief Wakes up the reactor thread to pick up new listen ports
+	void wakeup();
+
+
+/// \}
+/// \name Implementation
+/// \{
+
+private:
+	struct Client
+	{
+		Client()
+		: handle(-1), input(input_buffer_size), output_pos(0), scan_offset(0), reading_body(false), body_pos(0), keep_alive(false),
+		  request_pending(false), close_after_output(false), peer_closed(false), closed(false), events(0), last_activity(0)
+		{
+		}
+
+		int handle;
+
+		RingBuffer input;
+		std::string output;
+		std::string::size_type output_pos;
+
+		size_t scan_offset;
+		bool reading_body;
+		std::string request_type, request_url, request_version, request_headers;
+		DataBuffer request_body;
+		int body_pos;
+		bool keep_alive;
+
+		bool request_pending;
+		bool close_after_output;
+		bool peer_closed;
+		bool closed;
+
+		unsigned int events;
+		ubyte64 last_activity;
+	};
+
+	struct Request
+	{
+		std::shared_ptr<Client> client;
+		std::shared_ptr<HTTPServerConnection_Impl> connection;
+	};
+
+	void reactor_thread_main();
+	void update_listen_ports();
+	void accept_connections(int listen_handle);
+	void read_client(const std::shared_ptr<Client> &client);
+	void write_client(const std::shared_ptr<Client> &client);
+	void process_input(const std::shared_ptr<Client> &client);
+	bool parse_request_header(const std::shared_ptr<Client> &client, size_t header_length);
+	void dispatch_request(const std::shared_ptr<Client> &client);
+	void worker_thread_main();
+	void process_request(Request &request);
+	void process_completed();
+	void write_error(const std::shared_ptr<Client> &client, int status_code, const std::string &status_text);
+	void update_client(const std::shared_ptr<Client> &client);
+	void close_client(const std::shared_ptr<Client> &client);
+	void close_idle_clients();
+
+	static const size_t input_buffer_size = 64*1024;
+	static const size_t max_header_size = 32*1024;
+	static const int max_body_size = 16*1024*1024;
+	static const ubyte64 idle_timeout = 15000;
+
+	HTTPServer_Impl *server;
+	int epoll_handle;
+	int wakeup_handle;
+	InterlockedVariable stop_flag;
+
+	std::map<int, TCPListen> listen_ports;
+	std::map<int, std::shared_ptr<Client> > clients;
+
+	// Placeholder for the connection of buffered requests, which never touch the socket
+	TCPConnection no_connection;
+
+	Mutex pending_mutex;
+	std::deque<Request> pending;
+	Event work_event, stop_event;
+
+	Mutex completed_mutex;
+	std::vector<Request> completed;
+
+	Thread reactor_thread;
+	std::vector<Thread> worker_threads;
+/// \}
+};
+
+}
+
+#endif
@@ -51,12 +51,12 @@ char *RingBuffer::get_write_pos()
 
 size_t RingBuffer::get_write_size()
 {
+	if (length == size)
+		return 0;
+
 	size_t end_pos = pos + length;
 	if (end_pos >= size)
-		end_pos -= size;
-
-	if (pos < end_pos)
-		return end_pos - pos;
+		return pos - (end_pos - size);
 	else
 		return size - end_pos;
 }
@@ -72,6 +72,10 @@ void RingBuffer::read(size_t read_length)
 	length -= read_length;
 	if (pos >= size)
 		pos -= size;
+
+	// Keep the free space contiguous when possible
+	if (length == 0)
+		pos = 0;
 }
 
 std::string RingBuffer::read_to_string(size_t length)
@@ -90,11 +94,11 @@ std::string RingBuffer::read_to_string(size_t length)
 	return s;
 }
 
-size_t RingBuffer::find(const char *search_data, size_t search_size)
+size_t RingBuffer::find(const char *search_data, size_t search_size, size_t offset)
 {
-	if (search_size <= length)
+	if (offset + search_size <= length)
 	{
-		for (size_t i = pos; i <= pos+length-search_size; i++)
+		for (size_t i = pos + offset; i <= pos+length-search_size; i++)
 		{
 			bool found = true;
 			for (size_t j = 0; j < search_size; j++)
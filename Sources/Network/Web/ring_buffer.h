@@ -20,7 +20,11 @@ public:
 	void write(size_t length);
 	void read(size_t length);
 	std::string read_to_string(size_t length);
-	size_t find(const char *data, size_t size);
+	size_t find(const char *data, size_t size, size_t offset = 0);
+
+	size_t get_length() const { return length; }
+	size_t get_capacity() const { return size; }
+	bool is_full() const { return length == size; }
 
 	static const size_t npos = (size_t)(-1);
 
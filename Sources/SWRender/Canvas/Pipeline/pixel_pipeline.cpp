@@ -27,10 +27,10 @@
 */
 
 #include "SWRender/precomp.h"
-//#define PROFILE_PIPELINE
 #include "pixel_pipeline.h"
 #include "API/SWRender/pixel_thread_context.h"
 #include "API/SWRender/pixel_command.h"
+#include <emmintrin.h>
 
 #ifdef _MSC_VER
 	#include <intrin.h>
@@ -39,28 +39,24 @@
 	#define cl_compiler_barrier()  __asm__ __volatile__("" : : : "memory")
 #endif
 
-#ifdef PROFILE_PIPELINE
-#include "API/Core/Text/string_format.h"
-#endif
-
 namespace clan
 {
 
 
 PixelPipeline::PixelPipeline()
-: active_cores(0), local_writer_index(0), local_reader_index(0), local_commands_written(0), cur_block(0)
+: active_cores(0), spin_count(0), local_writer_index(0), local_reader_index(0), local_commands_written(0), commands_since_wakeup(0), cur_block(0), profiling(false)
 {
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-	SetThreadIdealProcessor(GetCurrentThread(), 0);
-	SetThreadAffinityMask(GetCurrentThread(), 1);
-	profiler.start_time = __rdtsc();
-#endif
-
 	active_cores = System::get_num_cores();
+
+	// Spinning only pays off when the producer and the workers are not competing for the same core
+	if (active_cores > 1)
+		spin_count = max_spin_count;
+
 	for (size_t i = 0; i < queue_max; i++)
 		command_queue[i] = 0;
 	reader_indices.resize(active_cores);
-	reader_active.resize(active_cores);
+	reader_parked.resize(active_cores);
+	worker_parks.resize(active_cores);
 
 	// Do not change this code to event_more_commands.resize().
 	// If you do this, the same Event handle end up in every index due to resize(n) calling resize(n, Event()).
@@ -78,9 +74,6 @@ PixelPipeline::PixelPipeline()
 PixelPipeline::~PixelPipeline()
 {
 	wait_for_workers();
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-	profiler.end_time = __rdtsc();
-#endif
 	event_stop.set();
 	for (std::vector<Thread>::size_type i = 0; i < worker_threads.size(); i++)
 		worker_threads[i].join();
@@ -93,118 +86,121 @@ PixelPipeline::~PixelPipeline()
 
 	if (cur_block && cur_block->refcount == 1)
 		delete[] (char*) cur_block;
+}
 
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-	MessageBoxA(0, cl_format("Queue = %1\r\nSetEvent = %2\r\nWaitForWorkers = %3\r\nWaitForSpace = %4\r\nAllocFree = %5",
-		(int)(profiler.queue_time*100/(profiler.end_time-profiler.start_time)),
-		(int)(profiler.set_event_time*100/(profiler.end_time-profiler.start_time)),
-		(int)(profiler.wait_for_workers_time*100/(profiler.end_time-profiler.start_time)),
-		(int)(profiler.wait_for_space_time*100/(profiler.end_time-profiler.start_time)),
-		(int)(profiler.alloc_time*100/(profiler.end_time-profiler.start_time))).c_str(),
-		"DEBUG", MB_OK);
-#endif
+PixelPipelineStats PixelPipeline::get_stats() const
+{
+	PixelPipelineStats result = stats;
+	for (int core = 0; core < active_cores; core++)
+		result.worker_parks += worker_parks[core].get();
+	return result;
+}
+
+void PixelPipeline::reset_stats()
+{
+	stats = PixelPipelineStats();
+	for (int core = 0; core < active_cores; core++)
+		worker_parks[core].set(0);
 }
 
 void PixelPipeline::queue(std::unique_ptr<PixelCommand> &command)
 {
-	wait_for_space();
-	delete command_queue[local_writer_index];
+	int next_index = local_writer_index + 1;
+	if (next_index == queue_max)
+		next_index = 0;
+	if (next_index == local_reader_index)
+	{
+		ubyte64 start_time = get_profile_time();
+		wait_for_readers(false);
+		stats.wait_for_space_time += get_profile_time() - start_time;
+	}
 
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-	unsigned __int64 start_time = __rdtsc();
-#endif
+	ubyte64 start_time = get_profile_time();
 
+	delete command_queue[local_writer_index];
 	command_queue[local_writer_index] = command.get();
 	command.release();
 
-	local_writer_index++;
-	if (local_writer_index == queue_max)
-		local_writer_index = 0;
+	local_writer_index = next_index;
 	local_commands_written++;
+	stats.commands_queued++;
 
-	if (local_commands_written == fragment_size)
-	{
-		cl_compiler_barrier();
-		writer_index.set(local_writer_index);
-		local_commands_written = 0;
+	if (local_commands_written == publish_interval)
+		publish_commands(false);
 
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-		unsigned __int64 start_event_time = __rdtsc();
-#endif
+	stats.queue_time += get_profile_time() - start_time;
+}
+
+void PixelPipeline::publish_commands(bool wake_parked_workers)
+{
+	cl_compiler_barrier();
+	writer_index.set(local_writer_index);
+	commands_since_wakeup += local_commands_written;
+	local_commands_written = 0;
+
+	// Spinning workers pick up the new commands by themselves. Parked ones are only woken once enough work has piled up.
+	if (wake_parked_workers || commands_since_wakeup >= wakeup_interval)
+	{
+		commands_since_wakeup = 0;
 		for (int i = 0; i < active_cores; i++)
 		{
-			if (reader_active[i].get() == 0)
+			if (reader_parked[i].get() != 0)
 				event_more_commands[i].set();
 		}
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-		unsigned __int64 end_event_time = __rdtsc();
-		profiler.set_event_time += end_event_time-start_event_time;
-#endif
 	}
-
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-	unsigned __int64 end_time = __rdtsc();
-	profiler.queue_time += end_time-start_time;
-#endif
 }
 
-void PixelPipeline::wait_for_space()
+void PixelPipeline::wait_for_workers()
 {
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-	unsigned __int64 start_time = __rdtsc();
-#endif
+	ubyte64 start_time = get_profile_time();
 
-	int next_index = local_writer_index+1;
-	if (next_index == queue_max)
-		next_index = 0;
-	if (next_index == local_reader_index)
+	publish_commands(true);
+
+	if (local_reader_index != local_writer_index)
+		wait_for_readers(true);
+
+	stats.wait_for_workers_time += get_profile_time() - start_time;
+}
+
+bool PixelPipeline::is_waiting_for_readers(bool all_readers_done)
+{
+	update_local_reader_index();
+	if (all_readers_done)
 	{
-		update_local_reader_index();
-		while (next_index == local_reader_index)
-		{
-			event_reader_done.wait();
-			event_reader_done.reset();
-			update_local_reader_index();
-		}
+		return local_reader_index != local_writer_index;
+	}
+	else
+	{
+		int next_index = local_writer_index + 1;
+		if (next_index == queue_max)
+			next_index = 0;
+		return local_reader_index == next_index;
 	}
-
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-	unsigned __int64 end_time = __rdtsc();
-	profiler.wait_for_space_time += end_time-start_time;
-#endif
 }
 
-void PixelPipeline::wait_for_workers()
+void PixelPipeline::wait_for_readers(bool all_readers_done)
 {
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-	unsigned __int64 start_time = __rdtsc();
-#endif
+	if (!all_readers_done)
+		publish_commands(true);
 
-	if (local_commands_written > 0)
+	// Spin first, as readers retire commands in small batches
+	for (int spin = 0; spin < spin_count; spin++)
 	{
-		cl_compiler_barrier();
-		writer_index.set(local_writer_index);
-		local_commands_written = 0;
-
-		for (int i = 0; i < active_cores; i++)
-			event_more_commands[i].set();
+		if (!is_waiting_for_readers(all_readers_done))
+			return;
+		_mm_pause();
 	}
 
-	if (local_reader_index != local_writer_index)
+	while (true)
 	{
-		update_local_reader_index();
-		while (local_reader_index != local_writer_index)
-		{
-			event_reader_done.wait();
-			event_reader_done.reset();
-			update_local_reader_index();
-		}
+		event_reader_done.reset();
+		producer_waiting.set(1);
+		if (!is_waiting_for_readers(all_readers_done))
+			break;
+		stats.producer_stalls++;
+		event_reader_done.wait();
 	}
-
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-	unsigned __int64 end_time = __rdtsc();
-	profiler.wait_for_workers_time += end_time-start_time;
-#endif
+	producer_waiting.set(0);
 }
 
 void PixelPipeline::update_local_reader_index()
@@ -222,42 +218,38 @@ void PixelPipeline::update_local_reader_index()
 		local_reader_index += queue_max;
 }
 
+bool PixelPipeline::spin_for_commands(int core)
+{
+	for (int spin = 0; spin < spin_count; spin++)
+	{
+		if (reader_indices[core].get() != writer_index.get())
+			return true;
+		_mm_pause();
+	}
+	return false;
+}
+
 void PixelPipeline::worker_main(int core)
 {
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-	SetThreadIdealProcessor(GetCurrentThread(), core);
-	SetThreadAffinityMask(GetCurrentThread(), 1 << core);
-	unsigned __int64 ticks_waiting = 0;
-	unsigned __int64 ticks_working = 0;
-#endif
 	PixelThreadContext context(core, active_cores);
 	while (true)
 	{
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-		unsigned __int64 wait_start_time = __rdtsc();
-#endif
-		int wakeup_reason = Event::wait(event_more_commands[core], event_stop);
-		if (wakeup_reason != 0)
-			break;
-		event_more_commands[core].reset();
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-		unsigned __int64 wait_end_time = __rdtsc();
-		ticks_waiting += wait_end_time-wait_start_time;
-#endif
 		process_commands(&context);
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-		unsigned __int64 commands_end_time = __rdtsc();
-		ticks_working += commands_end_time-wait_end_time;
-#endif
+		if (spin_for_commands(core))
+			continue;
+
+		// Announce that we are parked before checking for commands a final time, so the producer cannot miss us
+		event_more_commands[core].reset();
+		reader_parked[core].set(1);
+		if (reader_indices[core].get() == writer_index.get())
+		{
+			worker_parks[core].increment();
+			int wakeup_reason = Event::wait(event_more_commands[core], event_stop);
+			if (wakeup_reason != 0)
+				break;
+		}
+		reader_parked[core].set(0);
 	}
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-	MessageBoxA(
-		0,
-		cl_format("Pipeline core %1 spent %2 percent of its time waiting for commands",
-		core,
-		(int)(ticks_waiting*100/(ticks_working+ticks_waiting))).c_str(),
-		"DEBUG", MB_OK);
-#endif
 }
 
 void PixelPipeline::process_commands(PixelThreadContext *context)
@@ -270,7 +262,6 @@ void PixelPipeline::process_commands(PixelThreadContext *context)
 		if (worker_reader_index == worker_writer_index)
 			break;
 
-		reader_active[context->core].set(1);
 		while (worker_reader_index != worker_writer_index)
 		{
 			PixelCommand *command = command_queue[worker_reader_index];
@@ -281,12 +272,13 @@ void PixelPipeline::process_commands(PixelThreadContext *context)
 				worker_reader_index = 0;
 			worker_commands_retired++;
 
-			if (worker_commands_retired == fragment_size)
+			if (worker_commands_retired == retire_interval)
 			{
 				cl_compiler_barrier();
 				reader_indices[context->core].set(worker_reader_index);
 				worker_commands_retired = 0;
-				event_reader_done.set();
+				if (producer_waiting.get() != 0)
+					event_reader_done.set();
 			}
 		}
 
@@ -295,17 +287,15 @@ void PixelPipeline::process_commands(PixelThreadContext *context)
 			cl_compiler_barrier();
 			reader_indices[context->core].set(worker_reader_index);
 			worker_commands_retired = 0;
-			event_reader_done.set();
+			if (producer_waiting.get() != 0)
+				event_reader_done.set();
 		}
-		reader_active[context->core].set(0);
 	}
 }
 
 void *PixelPipeline::alloc_command(size_t s)
 {
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-	unsigned __int64 start_time = __rdtsc();
-#endif
+	ubyte64 start_time = get_profile_time();
 
 	s += sizeof(unsigned int);
 	s = ((s+63)/64)*64; // Place each command in its own cache line (is this really smart?)
@@ -335,19 +325,14 @@ void *PixelPipeline::alloc_command(size_t s)
 	cur_block->pos += s;
 	cur_block->refcount++;
 
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-	unsigned __int64 end_time = __rdtsc();
-	profiler.alloc_time += end_time-start_time;
-#endif
+	stats.alloc_time += get_profile_time() - start_time;
 
 	return d;
 }
 
 void PixelPipeline::free_command(void *d)
 {
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-	unsigned __int64 start_time = __rdtsc();
-#endif
+	ubyte64 start_time = get_profile_time();
 
 	char *data = (char *) d;
 	data -= sizeof(unsigned int);
@@ -357,10 +342,7 @@ void PixelPipeline::free_command(void *d)
 	if (block->refcount == 0)
 		delete[] (char*) block;
 
-#if defined(WIN32) && defined(PROFILE_PIPELINE)
-	unsigned __int64 end_time = __rdtsc();
-	profiler.alloc_time += end_time-start_time;
-#endif
+	stats.alloc_time += get_profile_time() - start_time;
 }
 
 }
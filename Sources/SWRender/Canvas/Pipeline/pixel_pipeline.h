@@ -29,6 +29,7 @@
 #pragma once
 
 #include "API/SWRender/pixel_thread_context.h"
+#include "API/SWRender/pixel_pipeline_stats.h"
 #include "API/Core/System/event.h"
 #include "API/Core/System/thread.h"
 #include "API/Core/System/interlocked_variable.h"
@@ -42,6 +43,12 @@ namespace clan
 
 class PixelCommand;
 
+/// \brief Single producer, multiple consumer command ring
+///
+/// Every worker core runs every command, rendering only the scanlines belonging to that core.
+/// The producer publishes its writer index every publish_interval commands. Workers spin for a
+/// while when they run out of commands before parking on their event, and the producer only
+/// signals parked workers once wakeup_interval commands have piled up or when it has to wait.
 class PixelPipeline
 {
 public:
@@ -56,28 +63,39 @@ public:
 	void *alloc_command(size_t s);
 	void free_command(void *d);
 
+	PixelPipelineStats get_stats() const;
+	void reset_stats();
+	void set_profiling(bool enable) { profiling = enable; }
+
 private:
 	void worker_main(int core);
 	void process_commands(PixelThreadContext *context);
-	void wait_for_space();
+	bool spin_for_commands(int core);
+	void publish_commands(bool wake_parked_workers);
+	void wait_for_readers(bool all_readers_done);
+	bool is_waiting_for_readers(bool all_readers_done);
 	void update_local_reader_index();
+	ubyte64 get_profile_time() const { return profiling ? System::get_microseconds() : 0; }
 
 	int active_cores;
+	int spin_count;
 	Event event_stop;
 	std::vector<Thread> worker_threads;
 
-	enum { queue_max = 12*1024, fragment_size = 3*1024 };
+	enum { queue_max = 12*1024, publish_interval = 64, retire_interval = 64, wakeup_interval = 1024, max_spin_count = 4000 };
 	PixelCommand *command_queue[queue_max];
 
 	int local_writer_index;
 	int local_reader_index;
 	int local_commands_written;
+	int commands_since_wakeup;
 	InterlockedVariable writer_index;
 	std::vector<InterlockedVariable> reader_indices;
 	std::vector<Event> event_more_commands;
 	Event event_reader_done;
 
-	std::vector<InterlockedVariable> reader_active;
+	std::vector<InterlockedVariable> reader_parked;
+	InterlockedVariable producer_waiting;
 
 	struct AllocBlock
 	{
@@ -88,19 +106,9 @@ private:
 	};
 	AllocBlock *cur_block;
 
-	#ifdef PROFILE_PIPELINE
-	struct PerformanceCounters
-	{
-		PerformanceCounters() : start_time(0), end_time(0), queue_time(0), set_event_time(0), wait_for_workers_time(0), wait_for_space_time(0), alloc_time(0) { }
-		unsigned __int64 start_time;
-		unsigned __int64 end_time;
-		unsigned __int64 queue_time;
-		unsigned __int64 set_event_time;
-		unsigned __int64 wait_for_workers_time;
-		unsigned __int64 wait_for_space_time;
-		unsigned __int64 alloc_time;
-	} profiler;
-	#endif
+	bool profiling;
+	PixelPipelineStats stats;
+	std::vector<InterlockedVariable> worker_parks;
 };
 
 }
@@ -29,6 +29,7 @@
 #include "SWRender/precomp.h"
 #include "pixel_fill_renderer.h"
 #include "API/Display/2D/color.h"
+#include "API/SWRender/pixel_scanline_kernels.h"
 #include <emmintrin.h>
 
 namespace clan
@@ -36,7 +37,7 @@ namespace clan
 
 
 PixelFillRenderer::PixelFillRenderer()
-: core(0), num_cores(1)
+: core(0), num_cores(1), instruction_set(PixelScanlineKernels::get_instruction_set())
 {
 }
 
@@ -140,29 +141,9 @@ void PixelFillRenderer::fill_rect(const Rect &dest, const Colorf &primary_color)
 		}
 		else
 		{
-			unsigned int pos_salpha = salpha*256/255;
-			unsigned int neg_salpha = 256-salpha;
 			while (dest_y < end_y)
 			{
-				for (int x = 0; x < line_length; x++)
-				{
-					#define alpha_component(a) (((a)&0xff000000)>>24)
-					#define red_component(a) (((a)&0x00ff0000)>>16)
-					#define green_component(a) (((a)&0x0000ff00)>>8)
-					#define blue_component(a) ((a)&0x000000ff)
-
-					unsigned int dest_color = dest_line[x];
-					unsigned int dred = red_component(dest_color);
-					unsigned int dgreen = green_component(dest_color);
-					unsigned int dblue = blue_component(dest_color);
-					unsigned int dalpha = alpha_component(dest_color);
-
-					unsigned red = (dred * neg_salpha + sred * pos_salpha) >> 8;
-					unsigned green = (dgreen * neg_salpha + sgreen * pos_salpha) >> 8;
-					unsigned blue = (dblue * neg_salpha + sblue * pos_salpha) >> 8;
-					unsigned alpha = (dalpha * neg_salpha + salpha * pos_salpha) >> 8;
-					dest_line[x] = (alpha<<24) + (red<<16) + (green<<8) + blue;
-				}
+				PixelScanlineKernels::fill_blend(dest_line, line_length, primary_color, instruction_set);
 
 				dest_y += num_cores;
 				dest_line += dest_line_incr;
@@ -30,6 +30,7 @@
 
 #include "API/Core/Math/rect.h"
 #include "API/Display/Render/blend_state.h"
+#include "API/SWRender/pixel_scanline_kernels.h"
 
 namespace clan
 {
@@ -63,6 +64,7 @@ private:
 	Rect clip_rect;
 	int core;
 	int num_cores;
+	PixelScanlineKernels::InstructionSet instruction_set;
 };
 
 }
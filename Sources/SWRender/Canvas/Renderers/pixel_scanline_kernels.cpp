@@ -0,0 +1,686 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "SWRender/precomp.h"
+#include "API/SWRender/pixel_scanline_kernels.h"
+#include "API/SWRender/blit_argb8_sse.h"
+#include "API/Core/System/system.h"
+
+#if defined(_MSC_VER) && _MSC_VER >= 1800
+	#define CL_SCANLINE_AVX2
+	#define cl_target_avx2
+	#include <immintrin.h>
+#elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+	#define CL_SCANLINE_AVX2
+	#define cl_target_avx2 __attribute__((target("avx2")))
+	#include <immintrin.h>
+#endif
+
+namespace clan
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// Reference kernels:
+//
+// These emulate the 16 bit lane arithmetic of the SIMD kernels exactly, including wrap around and saturation.
+
+static inline unsigned int cl_mul16(unsigned int a, unsigned int b) { return (a * b) & 0xffff; }
+static inline unsigned int cl_add16(unsigned int a, unsigned int b) { return (a + b) & 0xffff; }
+
+static inline int cl_wrap_texcoord(int t, int size16)
+{
+	while (t < 0)
+		t += size16;
+	while (t >= size16)
+		t -= size16;
+	return t;
+}
+
+// Same as _mm_packs_epi32(_mm_srai_epi32(c, 8), ..)
+static inline unsigned int cl_color_to_short(int c)
+{
+	c >>= 8;
+	if (c > 32767)
+		c = 32767;
+	else if (c < -32768)
+		c = -32768;
+	return ((unsigned int)c) & 0xffff;
+}
+
+// Same as _mm_packus_epi16
+static inline unsigned int cl_pack_channel(unsigned int v)
+{
+	int s = (v & 0x8000) ? (int)v - 0x10000 : (int)v;
+	return s < 0 ? 0 : (s > 255 ? 255 : s);
+}
+
+static inline unsigned int cl_shade_pixel(unsigned int texel, unsigned int dest_pixel, const unsigned int color[4], int blend)
+{
+	unsigned int s[4], d[4];
+	for (int i = 0; i < 4; i++)
+	{
+		s[i] = cl_mul16((texel >> (i * 8)) & 0xff, color[i]) >> 8;
+		d[i] = (dest_pixel >> (i * 8)) & 0xff;
+	}
+
+	unsigned int inv_alpha = (256 - s[3]) & 0xffff;
+	unsigned int result = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		unsigned int v;
+		switch (blend)
+		{
+		default:
+		case PixelScanlineKernels::blend_normal:
+			v = cl_add16(cl_add16(cl_mul16(s[i], s[3]), cl_mul16(d[i], inv_alpha)), 0x7f) >> 8;
+			break;
+		case PixelScanlineKernels::blend_premultiplied:
+			v = cl_add16(cl_add16(cl_mul16(d[i], inv_alpha), 0x7f) >> 8, s[i]);
+			break;
+		case PixelScanlineKernels::blend_additive:
+			v = cl_add16(d[i], s[i]);
+			break;
+		case PixelScanlineKernels::blend_copy:
+			v = s[i];
+			break;
+		}
+		result |= cl_pack_channel(v) << (i * 8);
+	}
+	return result;
+}
+
+static inline unsigned int cl_sample_linear(const PixelScanline &scanline, int tx, int ty)
+{
+	int x0 = tx >> 16;
+	int y0 = ty >> 16;
+	int x1 = (x0 + 1 == scanline.src_width) ? 0 : x0 + 1;
+	int y1 = (y0 + 1 == scanline.src_height) ? 0 : y0 + 1;
+	unsigned int fx = (tx & 0xffff) >> 9;
+	unsigned int fy = (ty & 0xffff) >> 9;
+
+	unsigned int weights[4];
+	weights[0] = cl_mul16(0x80 - fx, 0x80 - fy) >> 7;
+	weights[1] = cl_mul16(fx, 0x80 - fy) >> 7;
+	weights[2] = cl_mul16(0x80 - fx, fy) >> 7;
+	weights[3] = cl_mul16(fx, fy) >> 7;
+
+	unsigned int texels[4];
+	texels[0] = scanline.src[x0 + y0 * scanline.src_width];
+	texels[1] = scanline.src[x1 + y0 * scanline.src_width];
+	texels[2] = scanline.src[x0 + y1 * scanline.src_width];
+	texels[3] = scanline.src[x1 + y1 * scanline.src_width];
+
+	unsigned int result = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		unsigned int v = 0;
+		for (int j = 0; j < 4; j++)
+			v = cl_add16(v, cl_mul16((texels[j] >> (i * 8)) & 0xff, weights[j]));
+		v = cl_add16(v, 0x40) >> 7;
+		result |= (v & 0xff) << (i * 8);
+	}
+	return result;
+}
+
+template<bool linear>
+static void cl_render_scanline_reference(const PixelScanline &scanline, int blend)
+{
+	int src_width16 = scanline.src_width << 16;
+	int src_height16 = scanline.src_height << 16;
+	int tx = scanline.tx;
+	int ty = scanline.ty;
+	int colors[4] = { scanline.blue, scanline.green, scanline.red, scanline.alpha };
+	int slopes[4] = { scanline.slope_blue, scanline.slope_green, scanline.slope_red, scanline.slope_alpha };
+
+	for (int x = 0; x < scanline.length; x++)
+	{
+		tx = cl_wrap_texcoord(tx, src_width16);
+		ty = cl_wrap_texcoord(ty, src_height16);
+
+		unsigned int texel;
+		if (linear)
+			texel = cl_sample_linear(scanline, tx, ty);
+		else
+			texel = scanline.src[(tx >> 16) + (ty >> 16) * scanline.src_width];
+
+		unsigned int color[4];
+		for (int i = 0; i < 4; i++)
+		{
+			color[i] = cl_color_to_short(colors[i]);
+			colors[i] += slopes[i];
+		}
+
+		scanline.dest[x] = cl_shade_pixel(texel, scanline.dest[x], color, blend);
+		tx += scanline.slope_tx;
+		ty += scanline.slope_ty;
+	}
+}
+
+static void cl_fill_blend_reference(unsigned int *dest, int length, unsigned int color8888, unsigned int pos_salpha, unsigned int neg_salpha)
+{
+	for (int x = 0; x < length; x++)
+	{
+		unsigned int result = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			unsigned int s = (color8888 >> (i * 8)) & 0xff;
+			unsigned int d = (dest[x] >> (i * 8)) & 0xff;
+			result |= ((d * neg_salpha + s * pos_salpha) >> 8) << (i * 8);
+		}
+		dest[x] = result;
+	}
+}
+
+// Advances the scanline past the pixels already rendered by a SIMD kernel
+static inline void cl_skip_pixels(PixelScanline &scanline, int count, int tx, int ty, const int colors[4])
+{
+	scanline.dest += count;
+	scanline.length -= count;
+	scanline.tx = tx;
+	scanline.ty = ty;
+	scanline.blue = colors[0];
+	scanline.green = colors[1];
+	scanline.red = colors[2];
+	scanline.alpha = colors[3];
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// SSE2 kernels:
+
+template<int blend>
+static inline void cl_blend_sse2(__m128i &dest, __m128i &src, __m128i &one, __m128i &half)
+{
+	switch (blend)
+	{
+	default:
+	case PixelScanlineKernels::blend_normal:
+		cl_blitargb8sse_blend_normal(dest, src, one, half);
+		break;
+	case PixelScanlineKernels::blend_premultiplied:
+		BlitARGB8SSE::blend_premultiplied(dest, src, one, half);
+		break;
+	case PixelScanlineKernels::blend_additive:
+		dest = _mm_add_epi16(dest, src);
+		break;
+	case PixelScanlineKernels::blend_copy:
+		dest = src;
+		break;
+	}
+}
+
+// Broadcasts four 16 bit values, one per pixel, to all channels of pixels 0-1 (lo) and 2-3 (hi)
+static inline void cl_broadcast_weights_sse2(__m128i weights, __m128i &lo, __m128i &hi)
+{
+	__m128i w = _mm_unpacklo_epi16(weights, weights);
+	lo = _mm_unpacklo_epi32(w, w);
+	hi = _mm_unpackhi_epi32(w, w);
+}
+
+template<bool linear, int blend>
+static void cl_render_scanline_sse2(PixelScanline scanline)
+{
+	int sse_length = scanline.length & ~3;
+	if (sse_length > 0)
+	{
+		__m128i one, half;
+		BlitARGB8SSE::set_one(one);
+		BlitARGB8SSE::set_half(half);
+		__m128i zero = _mm_setzero_si128();
+
+		__m128i tx = _mm_add_epi32(_mm_set1_epi32(scanline.tx), _mm_setr_epi32(0, scanline.slope_tx, scanline.slope_tx * 2, scanline.slope_tx * 3));
+		__m128i ty = _mm_add_epi32(_mm_set1_epi32(scanline.ty), _mm_setr_epi32(0, scanline.slope_ty, scanline.slope_ty * 2, scanline.slope_ty * 3));
+		__m128i inc_tx = _mm_set1_epi32(scanline.slope_tx * 4);
+		__m128i inc_ty = _mm_set1_epi32(scanline.slope_ty * 4);
+		__m128i color = _mm_setr_epi32(scanline.blue, scanline.green, scanline.red, scanline.alpha);
+		__m128i inc_color = _mm_setr_epi32(scanline.slope_blue, scanline.slope_green, scanline.slope_red, scanline.slope_alpha);
+		__m128i src_width16 = _mm_set1_epi32(scanline.src_width << 16);
+		__m128i src_height16 = _mm_set1_epi32(scanline.src_height << 16);
+		__m128i frac_mask = _mm_set1_epi32(0xffff);
+		__m128i weight_one = _mm_set1_epi16(0x80);
+		__m128i weight_half = _mm_set1_epi16(0x40);
+
+		const unsigned int *src = scanline.src;
+		int src_width = scanline.src_width;
+		int src_height = scanline.src_height;
+
+		for (int x = 0; x < sse_length; x += 4)
+		{
+			cl_blitargb8sse_texture_repeat(tx, ty, src_width16, src_height16);
+
+			#ifdef _MSC_VER
+			__declspec(align(16)) int ix[4], iy[4];
+			#else
+			__attribute__ ((aligned(16))) int ix[4], iy[4];
+			#endif
+			_mm_store_si128((__m128i*) ix, _mm_srai_epi32(tx, 16));
+			_mm_store_si128((__m128i*) iy, _mm_srai_epi32(ty, 16));
+
+			__m128i src0, src1;
+			if (linear)
+			{
+				int x1[4], y0[4], y1[4];
+				for (int i = 0; i < 4; i++)
+				{
+					x1[i] = (ix[i] + 1 == src_width) ? 0 : ix[i] + 1;
+					y0[i] = iy[i] * src_width;
+					y1[i] = ((iy[i] + 1 == src_height) ? 0 : iy[i] + 1) * src_width;
+				}
+
+				__m128i fx = _mm_srli_epi32(_mm_and_si128(tx, frac_mask), 9);
+				__m128i fy = _mm_srli_epi32(_mm_and_si128(ty, frac_mask), 9);
+				fx = _mm_packs_epi32(fx, fx);
+				fy = _mm_packs_epi32(fy, fy);
+				__m128i inv_fx = _mm_sub_epi16(weight_one, fx);
+				__m128i inv_fy = _mm_sub_epi16(weight_one, fy);
+
+				__m128i w0lo, w0hi, w1lo, w1hi, w2lo, w2hi, w3lo, w3hi;
+				cl_broadcast_weights_sse2(_mm_srli_epi16(_mm_mullo_epi16(inv_fx, inv_fy), 7), w0lo, w0hi);
+				cl_broadcast_weights_sse2(_mm_srli_epi16(_mm_mullo_epi16(fx, inv_fy), 7), w1lo, w1hi);
+				cl_broadcast_weights_sse2(_mm_srli_epi16(_mm_mullo_epi16(inv_fx, fy), 7), w2lo, w2hi);
+				cl_broadcast_weights_sse2(_mm_srli_epi16(_mm_mullo_epi16(fx, fy), 7), w3lo, w3hi);
+
+				__m128i t0 = _mm_setr_epi32(src[ix[0] + y0[0]], src[ix[1] + y0[1]], src[ix[2] + y0[2]], src[ix[3] + y0[3]]);
+				__m128i t1 = _mm_setr_epi32(src[x1[0] + y0[0]], src[x1[1] + y0[1]], src[x1[2] + y0[2]], src[x1[3] + y0[3]]);
+				__m128i t2 = _mm_setr_epi32(src[ix[0] + y1[0]], src[ix[1] + y1[1]], src[ix[2] + y1[2]], src[ix[3] + y1[3]]);
+				__m128i t3 = _mm_setr_epi32(src[x1[0] + y1[0]], src[x1[1] + y1[1]], src[x1[2] + y1[2]], src[x1[3] + y1[3]]);
+
+				src0 = _mm_mullo_epi16(_mm_unpacklo_epi8(t0, zero), w0lo);
+				src0 = _mm_add_epi16(src0, _mm_mullo_epi16(_mm_unpacklo_epi8(t1, zero), w1lo));
+				src0 = _mm_add_epi16(src0, _mm_mullo_epi16(_mm_unpacklo_epi8(t2, zero), w2lo));
+				src0 = _mm_add_epi16(src0, _mm_mullo_epi16(_mm_unpacklo_epi8(t3, zero), w3lo));
+				src0 = _mm_srli_epi16(_mm_add_epi16(src0, weight_half), 7);
+
+				src1 = _mm_mullo_epi16(_mm_unpackhi_epi8(t0, zero), w0hi);
+				src1 = _mm_add_epi16(src1, _mm_mullo_epi16(_mm_unpackhi_epi8(t1, zero), w1hi));
+				src1 = _mm_add_epi16(src1, _mm_mullo_epi16(_mm_unpackhi_epi8(t2, zero), w2hi));
+				src1 = _mm_add_epi16(src1, _mm_mullo_epi16(_mm_unpackhi_epi8(t3, zero), w3hi));
+				src1 = _mm_srli_epi16(_mm_add_epi16(src1, weight_half), 7);
+			}
+			else
+			{
+				__m128i p4src = _mm_setr_epi32(src[ix[0] + iy[0] * src_width], src[ix[1] + iy[1] * src_width], src[ix[2] + iy[2] * src_width], src[ix[3] + iy[3] * src_width]);
+				src0 = _mm_unpacklo_epi8(p4src, zero);
+				src1 = _mm_unpackhi_epi8(p4src, zero);
+			}
+
+			__m128i color0 = color;
+			__m128i color1 = _mm_add_epi32(color0, inc_color);
+			__m128i color2 = _mm_add_epi32(color1, inc_color);
+			__m128i color3 = _mm_add_epi32(color2, inc_color);
+			color = _mm_add_epi32(color3, inc_color);
+
+			__m128i p4dest = _mm_loadu_si128((__m128i*)(scanline.dest + x));
+			__m128i dest0 = _mm_unpacklo_epi8(p4dest, zero);
+			__m128i dest1 = _mm_unpackhi_epi8(p4dest, zero);
+
+			cl_blitargb8sse_multiply_color(src0, _mm_packs_epi32(_mm_srai_epi32(color0, 8), _mm_srai_epi32(color1, 8)));
+			cl_blitargb8sse_multiply_color(src1, _mm_packs_epi32(_mm_srai_epi32(color2, 8), _mm_srai_epi32(color3, 8)));
+			cl_blend_sse2<blend>(dest0, src0, one, half);
+			cl_blend_sse2<blend>(dest1, src1, one, half);
+
+			_mm_storeu_si128((__m128i*)(scanline.dest + x), _mm_packus_epi16(dest0, dest1));
+
+			tx = _mm_add_epi32(tx, inc_tx);
+			ty = _mm_add_epi32(ty, inc_ty);
+		}
+
+		#ifdef _MSC_VER
+		__declspec(align(16)) int colors[4];
+		#else
+		__attribute__ ((aligned(16))) int colors[4];
+		#endif
+		_mm_store_si128((__m128i*) colors, color);
+		cl_skip_pixels(scanline, sse_length, _mm_cvtsi128_si32(tx), _mm_cvtsi128_si32(ty), colors);
+	}
+
+	if (scanline.length > 0)
+		cl_render_scanline_reference<linear>(scanline, blend);
+}
+
+static void cl_fill_blend_sse2(unsigned int *dest, int length, unsigned int color8888, unsigned int pos_salpha, unsigned int neg_salpha)
+{
+	int sse_length = length & ~3;
+	__m128i zero = _mm_setzero_si128();
+	__m128i src_term = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_set1_epi32(color8888), zero), _mm_set1_epi16(pos_salpha));
+	__m128i neg = _mm_set1_epi16(neg_salpha);
+	for (int x = 0; x < sse_length; x += 4)
+	{
+		__m128i p4dest = _mm_loadu_si128((__m128i*)(dest + x));
+		__m128i dest0 = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(p4dest, zero), neg), src_term), 8);
+		__m128i dest1 = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(p4dest, zero), neg), src_term), 8);
+		_mm_storeu_si128((__m128i*)(dest + x), _mm_packus_epi16(dest0, dest1));
+	}
+	cl_fill_blend_reference(dest + sse_length, length - sse_length, color8888, pos_salpha, neg_salpha);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// AVX2 kernels:
+
+#ifdef CL_SCANLINE_AVX2
+
+#define cl_blitargb8avx2_texture_repeat(t, size) \
+{ \
+	__m256i zero = _mm256_setzero_si256(); \
+	while (true) \
+	{ \
+		__m256i compare_result = _mm256_cmpgt_epi32(zero, t); \
+		if (_mm256_movemask_epi8(compare_result)) \
+			t = _mm256_add_epi32(t, _mm256_and_si256(compare_result, size)); \
+		else \
+			break; \
+	} \
+	while (true) \
+	{ \
+		__m256i compare_result = _mm256_cmpgt_epi32(size, t); \
+		if (_mm256_movemask_epi8(compare_result) != -1) \
+			t = _mm256_sub_epi32(t, _mm256_andnot_si256(compare_result, size)); \
+		else \
+			break; \
+	} \
+}
+
+template<int blend>
+static inline cl_target_avx2 void cl_blend_avx2(__m256i &dest, __m256i src, __m256i one, __m256i half)
+{
+	switch (blend)
+	{
+	default:
+	case PixelScanlineKernels::blend_normal:
+		{
+			__m256i src_alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(src, 0xff), 0xff);
+			__m256i invsrc_alpha = _mm256_sub_epi16(one, src_alpha);
+			dest = _mm256_add_epi16(_mm256_mullo_epi16(dest, invsrc_alpha), _mm256_mullo_epi16(src, src_alpha));
+			dest = _mm256_srli_epi16(_mm256_add_epi16(dest, half), 8);
+		}
+		break;
+	case PixelScanlineKernels::blend_premultiplied:
+		{
+			__m256i src_alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(src, 0xff), 0xff);
+			__m256i invsrc_alpha = _mm256_sub_epi16(one, src_alpha);
+			dest = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(dest, invsrc_alpha), half), 8);
+			dest = _mm256_add_epi16(dest, src);
+		}
+		break;
+	case PixelScanlineKernels::blend_additive:
+		dest = _mm256_add_epi16(dest, src);
+		break;
+	case PixelScanlineKernels::blend_copy:
+		dest = src;
+		break;
+	}
+}
+
+// Broadcasts eight 16 bit values, one per pixel, to all channels of pixels 0,1,4,5 (lo) and 2,3,6,7 (hi)
+static inline cl_target_avx2 void cl_broadcast_weights_avx2(__m256i weights, __m256i &lo, __m256i &hi)
+{
+	__m256i w = _mm256_unpacklo_epi16(weights, weights);
+	lo = _mm256_unpacklo_epi32(w, w);
+	hi = _mm256_unpackhi_epi32(w, w);
+}
+
+template<bool linear, int blend>
+static cl_target_avx2 void cl_render_scanline_avx2(PixelScanline scanline)
+{
+	int avx_length = scanline.length & ~7;
+	if (avx_length > 0)
+	{
+		__m256i one = _mm256_set1_epi16(0x0100);
+		__m256i half = _mm256_set1_epi16(0x007f);
+		__m256i zero = _mm256_setzero_si256();
+
+		__m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		__m256i tx = _mm256_add_epi32(_mm256_set1_epi32(scanline.tx), _mm256_mullo_epi32(_mm256_set1_epi32(scanline.slope_tx), lane));
+		__m256i ty = _mm256_add_epi32(_mm256_set1_epi32(scanline.ty), _mm256_mullo_epi32(_mm256_set1_epi32(scanline.slope_ty), lane));
+		__m256i inc_tx = _mm256_set1_epi32(scanline.slope_tx * 8);
+		__m256i inc_ty = _mm256_set1_epi32(scanline.slope_ty * 8);
+
+		// The low 128 bits hold the color of pixel 0, the high 128 bits the color of pixel 4
+		__m256i inc_color = _mm256_setr_epi32(
+			scanline.slope_blue, scanline.slope_green, scanline.slope_red, scanline.slope_alpha,
+			scanline.slope_blue, scanline.slope_green, scanline.slope_red, scanline.slope_alpha);
+		__m256i color = _mm256_setr_epi32(
+			scanline.blue, scanline.green, scanline.red, scanline.alpha,
+			scanline.blue + scanline.slope_blue * 4, scanline.green + scanline.slope_green * 4, scanline.red + scanline.slope_red * 4, scanline.alpha + scanline.slope_alpha * 4);
+		__m256i inc_color8 = _mm256_slli_epi32(inc_color, 3);
+
+		__m256i src_width16 = _mm256_set1_epi32(scanline.src_width << 16);
+		__m256i src_height16 = _mm256_set1_epi32(scanline.src_height << 16);
+		__m256i src_width = _mm256_set1_epi32(scanline.src_width);
+		__m256i frac_mask = _mm256_set1_epi32(0xffff);
+		__m256i weight_one = _mm256_set1_epi16(0x80);
+		__m256i weight_half = _mm256_set1_epi16(0x40);
+		__m256i int_one = _mm256_set1_epi32(1);
+		const int *src = (const int *) scanline.src;
+
+		for (int x = 0; x < avx_length; x += 8)
+		{
+			cl_blitargb8avx2_texture_repeat(tx, src_width16);
+			cl_blitargb8avx2_texture_repeat(ty, src_height16);
+
+			__m256i ix = _mm256_srai_epi32(tx, 16);
+			__m256i iy = _mm256_srai_epi32(ty, 16);
+
+			__m256i src0, src1;
+			if (linear)
+			{
+				__m256i x1 = _mm256_add_epi32(ix, int_one);
+				x1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(x1, src_width), x1);
+				__m256i y1 = _mm256_add_epi32(iy, int_one);
+				y1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(y1, _mm256_set1_epi32(scanline.src_height)), y1);
+				__m256i y0 = _mm256_mullo_epi32(iy, src_width);
+				y1 = _mm256_mullo_epi32(y1, src_width);
+
+				__m256i fx = _mm256_srli_epi32(_mm256_and_si256(tx, frac_mask), 9);
+				__m256i fy = _mm256_srli_epi32(_mm256_and_si256(ty, frac_mask), 9);
+				fx = _mm256_packs_epi32(fx, fx);
+				fy = _mm256_packs_epi32(fy, fy);
+				__m256i inv_fx = _mm256_sub_epi16(weight_one, fx);
+				__m256i inv_fy = _mm256_sub_epi16(weight_one, fy);
+
+				__m256i w0lo, w0hi, w1lo, w1hi, w2lo, w2hi, w3lo, w3hi;
+				cl_broadcast_weights_avx2(_mm256_srli_epi16(_mm256_mullo_epi16(inv_fx, inv_fy), 7), w0lo, w0hi);
+				cl_broadcast_weights_avx2(_mm256_srli_epi16(_mm256_mullo_epi16(fx, inv_fy), 7), w1lo, w1hi);
+				cl_broadcast_weights_avx2(_mm256_srli_epi16(_mm256_mullo_epi16(inv_fx, fy), 7), w2lo, w2hi);
+				cl_broadcast_weights_avx2(_mm256_srli_epi16(_mm256_mullo_epi16(fx, fy), 7), w3lo, w3hi);
+
+				__m256i t0 = _mm256_i32gather_epi32(src, _mm256_add_epi32(ix, y0), 4);
+				__m256i t1 = _mm256_i32gather_epi32(src, _mm256_add_epi32(x1, y0), 4);
+				__m256i t2 = _mm256_i32gather_epi32(src, _mm256_add_epi32(ix, y1), 4);
+				__m256i t3 = _mm256_i32gather_epi32(src, _mm256_add_epi32(x1, y1), 4);
+
+				src0 = _mm256_mullo_epi16(_mm256_unpacklo_epi8(t0, zero), w0lo);
+				src0 = _mm256_add_epi16(src0, _mm256_mullo_epi16(_mm256_unpacklo_epi8(t1, zero), w1lo));
+				src0 = _mm256_add_epi16(src0, _mm256_mullo_epi16(_mm256_unpacklo_epi8(t2, zero), w2lo));
+				src0 = _mm256_add_epi16(src0, _mm256_mullo_epi16(_mm256_unpacklo_epi8(t3, zero), w3lo));
+				src0 = _mm256_srli_epi16(_mm256_add_epi16(src0, weight_half), 7);
+
+				src1 = _mm256_mullo_epi16(_mm256_unpackhi_epi8(t0, zero), w0hi);
+				src1 = _mm256_add_epi16(src1, _mm256_mullo_epi16(_mm256_unpackhi_epi8(t1, zero), w1hi));
+				src1 = _mm256_add_epi16(src1, _mm256_mullo_epi16(_mm256_unpackhi_epi8(t2, zero), w2hi));
+				src1 = _mm256_add_epi16(src1, _mm256_mullo_epi16(_mm256_unpackhi_epi8(t3, zero), w3hi));
+				src1 = _mm256_srli_epi16(_mm256_add_epi16(src1, weight_half), 7);
+			}
+			else
+			{
+				__m256i p8src = _mm256_i32gather_epi32(src, _mm256_add_epi32(ix, _mm256_mullo_epi32(iy, src_width)), 4);
+				src0 = _mm256_unpacklo_epi8(p8src, zero);
+				src1 = _mm256_unpackhi_epi8(p8src, zero);
+			}
+
+			__m256i color0 = color;
+			__m256i color1 = _mm256_add_epi32(color0, inc_color);
+			__m256i color2 = _mm256_add_epi32(color1, inc_color);
+			__m256i color3 = _mm256_add_epi32(color2, inc_color);
+			color = _mm256_add_epi32(color, inc_color8);
+
+			__m256i p8dest = _mm256_loadu_si256((__m256i*)(scanline.dest + x));
+			__m256i dest0 = _mm256_unpacklo_epi8(p8dest, zero);
+			__m256i dest1 = _mm256_unpackhi_epi8(p8dest, zero);
+
+			src0 = _mm256_srli_epi16(_mm256_mullo_epi16(src0, _mm256_packs_epi32(_mm256_srai_epi32(color0, 8), _mm256_srai_epi32(color1, 8))), 8);
+			src1 = _mm256_srli_epi16(_mm256_mullo_epi16(src1, _mm256_packs_epi32(_mm256_srai_epi32(color2, 8), _mm256_srai_epi32(color3, 8))), 8);
+			cl_blend_avx2<blend>(dest0, src0, one, half);
+			cl_blend_avx2<blend>(dest1, src1, one, half);
+
+			_mm256_storeu_si256((__m256i*)(scanline.dest + x), _mm256_packus_epi16(dest0, dest1));
+
+			tx = _mm256_add_epi32(tx, inc_tx);
+			ty = _mm256_add_epi32(ty, inc_ty);
+		}
+
+		int colors[4];
+		_mm_storeu_si128((__m128i*) colors, _mm256_castsi256_si128(color));
+		cl_skip_pixels(scanline, avx_length, _mm256_cvtsi256_si32(tx), _mm256_cvtsi256_si32(ty), colors);
+	}
+
+	if (scanline.length > 0)
+		cl_render_scanline_sse2<linear, blend>(scanline);
+}
+
+static cl_target_avx2 void cl_fill_blend_avx2(unsigned int *dest, int length, unsigned int color8888, unsigned int pos_salpha, unsigned int neg_salpha)
+{
+	int avx_length = length & ~7;
+	__m256i zero = _mm256_setzero_si256();
+	__m256i src_term = _mm256_mullo_epi16(_mm256_unpacklo_epi8(_mm256_set1_epi32(color8888), zero), _mm256_set1_epi16(pos_salpha));
+	__m256i neg = _mm256_set1_epi16(neg_salpha);
+	for (int x = 0; x < avx_length; x += 8)
+	{
+		__m256i p8dest = _mm256_loadu_si256((__m256i*)(dest + x));
+		__m256i dest0 = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(p8dest, zero), neg), src_term), 8);
+		__m256i dest1 = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(p8dest, zero), neg), src_term), 8);
+		_mm256_storeu_si256((__m256i*)(dest + x), _mm256_packus_epi16(dest0, dest1));
+	}
+	cl_fill_blend_sse2(dest + avx_length, length - avx_length, color8888, pos_salpha, neg_salpha);
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+// PixelScanlineKernels Attributes:
+
+PixelScanlineKernels::InstructionSet PixelScanlineKernels::get_instruction_set()
+{
+	// Detected once, cpuid is far too slow to run per command
+	static int detected_isa = -1;
+	if (detected_isa == -1)
+	{
+		int isa = isa_reference;
+		if (System::detect_cpu_extension(System::sse2))
+			isa = isa_sse2;
+#ifdef CL_SCANLINE_AVX2
+		if (System::detect_cpu_extension(System::avx2))
+			isa = isa_avx2;
+#endif
+		detected_isa = isa;
+	}
+	return (InstructionSet)detected_isa;
+}
+
+PixelScanlineKernels::BlendMode PixelScanlineKernels::get_blend_mode(BlendFunc src, BlendFunc dest)
+{
+	if (src == blend_one && dest == blend_one_minus_src_alpha)
+		return blend_premultiplied;
+	else if (src == blend_one && dest == blend_one)
+		return blend_additive;
+	else if (src == blend_one && dest == blend_zero)
+		return blend_copy;
+	else
+		return blend_normal;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// PixelScanlineKernels Operations:
+
+template<bool linear>
+static void cl_render_scanline(const PixelScanline &scanline, PixelScanlineKernels::BlendMode blend, PixelScanlineKernels::InstructionSet isa)
+{
+	switch (isa)
+	{
+	case PixelScanlineKernels::isa_reference:
+		cl_render_scanline_reference<linear>(scanline, blend);
+		break;
+#ifdef CL_SCANLINE_AVX2
+	case PixelScanlineKernels::isa_avx2:
+		switch (blend)
+		{
+		case PixelScanlineKernels::blend_normal: cl_render_scanline_avx2<linear, PixelScanlineKernels::blend_normal>(scanline); break;
+		case PixelScanlineKernels::blend_premultiplied: cl_render_scanline_avx2<linear, PixelScanlineKernels::blend_premultiplied>(scanline); break;
+		case PixelScanlineKernels::blend_additive: cl_render_scanline_avx2<linear, PixelScanlineKernels::blend_additive>(scanline); break;
+		case PixelScanlineKernels::blend_copy: cl_render_scanline_avx2<linear, PixelScanlineKernels::blend_copy>(scanline); break;
+		}
+		break;
+#endif
+	default:
+		switch (blend)
+		{
+		case PixelScanlineKernels::blend_normal: cl_render_scanline_sse2<linear, PixelScanlineKernels::blend_normal>(scanline); break;
+		case PixelScanlineKernels::blend_premultiplied: cl_render_scanline_sse2<linear, PixelScanlineKernels::blend_premultiplied>(scanline); break;
+		case PixelScanlineKernels::blend_additive: cl_render_scanline_sse2<linear, PixelScanlineKernels::blend_additive>(scanline); break;
+		case PixelScanlineKernels::blend_copy: cl_render_scanline_sse2<linear, PixelScanlineKernels::blend_copy>(scanline); break;
+		}
+		break;
+	}
+}
+
+void PixelScanlineKernels::render_nearest(PixelScanline scanline, BlendMode blend, InstructionSet isa)
+{
+	cl_render_scanline<false>(scanline, blend, isa);
+}
+
+void PixelScanlineKernels::render_linear(PixelScanline scanline, BlendMode blend, InstructionSet isa)
+{
+	cl_render_scanline<true>(scanline, blend, isa);
+}
+
+void PixelScanlineKernels::fill_blend(unsigned int *dest, int length, const Colorf &color, InstructionSet isa)
+{
+	unsigned int sred = (unsigned int) (color.r*255);
+	unsigned int sgreen = (unsigned int) (color.g*255);
+	unsigned int sblue = (unsigned int) (color.b*255);
+	unsigned int salpha = (unsigned int) (color.a*255);
+	unsigned int color8888 = (salpha<<24) + (sred<<16) + (sgreen<<8) + sblue;
+	unsigned int pos_salpha = salpha*256/255;
+	unsigned int neg_salpha = 256-salpha;
+
+	switch (isa)
+	{
+	case isa_reference:
+		cl_fill_blend_reference(dest, length, color8888, pos_salpha, neg_salpha);
+		break;
+#ifdef CL_SCANLINE_AVX2
+	case isa_avx2:
+		cl_fill_blend_avx2(dest, length, color8888, pos_salpha, neg_salpha);
+		break;
+#endif
+	default:
+		cl_fill_blend_sse2(dest, length, color8888, pos_salpha, neg_salpha);
+		break;
+	}
+}
+
+}
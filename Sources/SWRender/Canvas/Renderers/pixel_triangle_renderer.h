@@ -30,6 +30,7 @@
 
 #include "API/Core/Math/rect.h"
 #include "API/Display/Render/blend_state.h"
+#include "API/SWRender/pixel_scanline_kernels.h"
 
 namespace clan
 {
@@ -82,6 +83,7 @@ private:
 	void render_scanline_nearest(int y, const LinePoint &p0, const LinePoint &p1);
 	void render_scanline_linear(int y, const LinePoint &p0, const LinePoint &p1);
 	bool prepare_scanline(int y, const LinePoint &p0, const LinePoint &p1, ScanLine &out_scanline);
+	bool prepare_kernel_scanline(int y, const LinePoint &p0, const LinePoint &p1, PixelScanline &out_scanline);
 	void prepare_scanline2(int y, const LinePoint &p0, const LinePoint &p1, ScanLine &out_scanline);
 
 	unsigned int *dest;
@@ -103,6 +105,8 @@ private:
 	Rect clip_rect;
 	int core;
 	int num_cores;
+	PixelScanlineKernels::BlendMode blend_mode;
+	PixelScanlineKernels::InstructionSet instruction_set;
 };
 
 }
@@ -31,6 +31,7 @@
 #include "API/SWRender/pixel_command.h"
 #include "swr_graphic_context_provider.h"
 #include "Canvas/pixel_canvas.h"
+#include "Canvas/Pipeline/pixel_pipeline.h"
 
 namespace clan
 {
@@ -83,6 +84,11 @@ PixelPipeline *GraphicContext_SWRender::get_pipeline() const
 	return impl->provider->get_canvas()->get_pipeline();
 }
 
+PixelPipelineStats GraphicContext_SWRender::get_pipeline_stats() const
+{
+	return get_pipeline()->get_stats();
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // GraphicContext_SWRender Operations:
 
@@ -96,6 +102,16 @@ void GraphicContext_SWRender::draw_pixels(float x, float y, float zoom_x, float
 	impl->provider->draw_pixels(x, y, zoom_x, zoom_y, pixel_buffer, src_rect, color);
 }
 
+void GraphicContext_SWRender::set_pipeline_profiling(bool enable)
+{
+	get_pipeline()->set_profiling(enable);
+}
+
+void GraphicContext_SWRender::reset_pipeline_stats()
+{
+	get_pipeline()->reset_stats();
+}
+
 void GraphicContext_SWRender::queue_command(std::unique_ptr<PixelCommand> &command)
 {
 	impl->provider->queue_command(command);
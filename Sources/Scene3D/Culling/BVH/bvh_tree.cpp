@@ -0,0 +1,794 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+#include "Scene3D/precomp.h"
+#include "bvh_tree.h"
+#include "API/Core/Math/frustum_planes.h"
+#include "API/Core/System/system.h"
+#include <algorithm>
+
+#ifndef DISABLE_SSE2
+#ifndef ARM_PLATFORM
+#include <emmintrin.h>
+#define CL_BVH_SSE2
+
+#if defined(_MSC_VER)
+	#define CL_BVH_AVX
+	#define cl_target_avx
+	#include <immintrin.h>
+#elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+	#define CL_BVH_AVX
+	#define cl_target_avx __attribute__((target("avx")))
+	#include <immintrin.h>
+#endif
+
+#endif
+#endif // not DISABLE_SSE2
+
+namespace clan
+{
+
+static const float bvh_empty_min = 1e30f;
+static const float bvh_empty_max = -1e30f;
+
+BVHFrustum::BVHFrustum(const FrustumPlanes &frustum)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const float normal[3] = { frustum.planes[i].x, frustum.planes[i].y, frustum.planes[i].z };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			planes[i][axis] = normal[axis];
+			far_index[i][axis] = normal[axis] >= 0.0f ? 3 + axis : axis;
+			near_index[i][axis] = normal[axis] >= 0.0f ? axis : 3 + axis;
+		}
+		planes[i][3] = frustum.planes[i].w;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+BVHTree::BVHTree()
+: bounds_stride(0), tree_count(0), removed_count(0), tree_cost(0.0f), built_cost(0.0f), use_sse2(false), use_avx(false)
+{
+#ifdef CL_BVH_SSE2
+	use_sse2 = System::detect_cpu_extension(System::sse2);
+#endif
+#ifdef CL_BVH_AVX
+	use_avx = System::detect_cpu_extension(System::avx);
+#endif
+}
+
+BVHTree::~BVHTree()
+{
+	for (size_t i = 0; i < objects.size(); i++)
+		delete objects[i];
+	for (size_t i = 0; i < pending.size(); i++)
+		delete pending[i];
+}
+
+SceneCullProxy *BVHTree::create_proxy(SceneItem *object, const AxisAlignedBoundingBox &box)
+{
+	BVHObject *tree_object = new BVHObject(object, box);
+	tree_object->pending_index = (int)pending.size();
+	pending.push_back(tree_object);
+	return tree_object;
+}
+
+void BVHTree::delete_proxy(SceneCullProxy *proxy)
+{
+	BVHObject *tree_object = static_cast<BVHObject*>(proxy);
+	if (tree_object->pending_index != -1)
+	{
+		BVHObject *last = pending.back();
+		pending[tree_object->pending_index] = last;
+		last->pending_index = tree_object->pending_index;
+		pending.pop_back();
+	}
+	else
+	{
+		int slot = tree_object->slot;
+		items[slot] = 0;
+		objects[slot] = 0;
+		for (int row = 0; row < 6; row++)
+			object_bounds[row * bounds_stride + slot] = row < 3 ? bvh_empty_min : bvh_empty_max;
+		refit(slot);
+		removed_count++;
+	}
+	delete tree_object;
+}
+
+void BVHTree::set_aabb(SceneCullProxy *proxy, const AxisAlignedBoundingBox &box)
+{
+	BVHObject *tree_object = static_cast<BVHObject*>(proxy);
+	tree_object->box = box;
+	if (tree_object->slot != -1)
+	{
+		set_object_bounds(tree_object->slot, box);
+		refit(tree_object->slot);
+	}
+}
+
+AxisAlignedBoundingBox BVHTree::get_aabb(SceneCullProxy *proxy)
+{
+	BVHObject *tree_object = static_cast<BVHObject*>(proxy);
+	return tree_object->box;
+}
+
+std::vector<SceneItem *> BVHTree::cull(const FrustumPlanes &frustum)
+{
+	update();
+
+	std::vector<BVHFrustum> frustums(1, BVHFrustum(frustum));
+	std::vector<std::vector<SceneItem *> > pvs(1);
+	cull_views(frustums, 0, 1, pvs);
+	return pvs[0];
+}
+
+std::vector<std::vector<SceneItem *> > BVHTree::cull_views(const std::vector<FrustumPlanes> &frustums)
+{
+	update();
+
+	std::vector<BVHFrustum> bvh_frustums;
+	bvh_frustums.reserve(frustums.size());
+	for (size_t i = 0; i < frustums.size(); i++)
+		bvh_frustums.push_back(BVHFrustum(frustums[i]));
+
+	std::vector<std::vector<SceneItem *> > pvs(frustums.size());
+	for (int first_view = 0; first_view < (int)frustums.size(); first_view += max_views)
+		cull_views(bvh_frustums, first_view, std::min((int)frustums.size() - first_view, (int)max_views), pvs);
+	return pvs;
+}
+
+std::vector<SceneItem *> BVHTree::cull(const Vec3f &point)
+{
+	update();
+
+	std::vector<SceneItem *> pvs;
+
+	const float p[3] = { point.x, point.y, point.z };
+	std::vector<int> stack;
+	if (!nodes.empty())
+		stack.push_back(0);
+	while (!stack.empty())
+	{
+		const BVHNode &node = nodes[stack.back()];
+		stack.pop_back();
+
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if (node.count[lane] == 0)
+				continue;
+
+			bool inside =
+				p[0] >= node.bounds[0][lane] && p[0] <= node.bounds[3][lane] &&
+				p[1] >= node.bounds[1][lane] && p[1] <= node.bounds[4][lane] &&
+				p[2] >= node.bounds[2][lane] && p[2] <= node.bounds[5][lane];
+			if (!inside)
+				continue;
+
+			if (node.child[lane] != -1)
+			{
+				stack.push_back(node.child[lane]);
+			}
+			else
+			{
+				int end = node.first[lane] + node.count[lane];
+				for (int slot = node.first[lane]; slot < end; slot++)
+				{
+					bool obj_inside = items[slot] &&
+						p[0] >= object_bounds[slot] && p[0] <= object_bounds[3 * bounds_stride + slot] &&
+						p[1] >= object_bounds[bounds_stride + slot] && p[1] <= object_bounds[4 * bounds_stride + slot] &&
+						p[2] >= object_bounds[2 * bounds_stride + slot] && p[2] <= object_bounds[5 * bounds_stride + slot];
+					if (obj_inside)
+						pvs.push_back(items[slot]);
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		const AxisAlignedBoundingBox &box = pending[i]->box;
+		bool obj_inside =
+			point.x >= box.aabb_min.x && point.x <= box.aabb_max.x &&
+			point.y >= box.aabb_min.y && point.y <= box.aabb_max.y &&
+			point.z >= box.aabb_min.z && point.z <= box.aabb_max.z;
+		if (obj_inside)
+			pvs.push_back(pending[i]->visible_object);
+	}
+
+	return pvs;
+}
+
+void BVHTree::cull_views(const std::vector<BVHFrustum> &frustums, int first_view, int num_views, std::vector<std::vector<SceneItem *> > &pvs)
+{
+	// Each stack entry holds a node and the views that partially overlap it.
+	// Views that fully contain a lane get the whole contiguous object range of its subtree.
+	std::vector<std::pair<int, unsigned int> > stack;
+	if (!nodes.empty())
+		stack.push_back(std::pair<int, unsigned int>(0, num_views == 32 ? 0xffffffff : (1u << num_views) - 1));
+
+	while (!stack.empty())
+	{
+		const BVHNode &node = nodes[stack.back().first];
+		unsigned int views = stack.back().second;
+		stack.pop_back();
+
+		unsigned int lane_views[4] = { 0, 0, 0, 0 };
+		for (int view = 0; views; view++, views >>= 1)
+		{
+			if ((views & 1) == 0)
+				continue;
+
+			int outside, partial;
+			test_node(node, frustums[first_view + view], outside, partial);
+			for (int lane = 0; lane < 4; lane++)
+			{
+				if (node.count[lane] == 0 || (outside & (1 << lane)))
+					continue;
+				else if (partial & (1 << lane))
+					lane_views[lane] |= 1u << view;
+				else
+					add_range(node.first[lane], node.count[lane], pvs[first_view + view]);
+			}
+		}
+
+		for (int lane = 3; lane >= 0; lane--)
+		{
+			if (lane_views[lane] == 0)
+				continue;
+
+			if (node.child[lane] != -1)
+			{
+				stack.push_back(std::pair<int, unsigned int>(node.child[lane], lane_views[lane]));
+			}
+			else
+			{
+				int first = node.first[lane];
+				int count_mask = (1 << node.count[lane]) - 1;
+				views = lane_views[lane];
+				for (int view = 0; views; view++, views >>= 1)
+				{
+					if ((views & 1) == 0)
+						continue;
+
+					int visible = test_leaf(first, frustums[first_view + view]) & count_mask;
+					std::vector<SceneItem *> &view_pvs = pvs[first_view + view];
+					for (int i = 0; visible; i++, visible >>= 1)
+					{
+						if ((visible & 1) && items[first + i])
+							view_pvs.push_back(items[first + i]);
+					}
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		for (int view = 0; view < num_views; view++)
+		{
+			if (!is_outside(frustums[first_view + view], pending[i]->box))
+				pvs[first_view + view].push_back(pending[i]->visible_object);
+		}
+	}
+}
+
+#ifdef CL_BVH_SSE2
+static void cl_bvh_test_node_sse2(const BVHNode &node, const BVHFrustum &frustum, int &out_outside, int &out_partial)
+{
+	__m128 zero = _mm_setzero_ps();
+	__m128 outside = _mm_setzero_ps();
+	__m128 partial = _mm_setzero_ps();
+	for (int i = 0; i < 6; i++)
+	{
+		const float *plane = frustum.planes[i];
+		const int *far_index = frustum.far_index[i];
+		const int *near_index = frustum.near_index[i];
+
+		__m128 nx = _mm_set1_ps(plane[0]);
+		__m128 ny = _mm_set1_ps(plane[1]);
+		__m128 nz = _mm_set1_ps(plane[2]);
+		__m128 d = _mm_set1_ps(plane[3]);
+
+		__m128 far_dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(node.bounds[far_index[0]])), _mm_mul_ps(ny, _mm_loadu_ps(node.bounds[far_index[1]]))), _mm_add_ps(_mm_mul_ps(nz, _mm_loadu_ps(node.bounds[far_index[2]])), d));
+		__m128 near_dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(node.bounds[near_index[0]])), _mm_mul_ps(ny, _mm_loadu_ps(node.bounds[near_index[1]]))), _mm_add_ps(_mm_mul_ps(nz, _mm_loadu_ps(node.bounds[near_index[2]])), d));
+
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(far_dist, zero));
+		partial = _mm_or_ps(partial, _mm_cmple_ps(near_dist, zero));
+	}
+	out_outside = _mm_movemask_ps(outside);
+	out_partial = _mm_movemask_ps(partial) & ~out_outside;
+}
+
+static int cl_bvh_test_leaf_sse2(const float *bounds, int stride, const BVHFrustum &frustum)
+{
+	__m128 zero = _mm_setzero_ps();
+	__m128 outside0 = _mm_setzero_ps();
+	__m128 outside1 = _mm_setzero_ps();
+	for (int i = 0; i < 6; i++)
+	{
+		const float *plane = frustum.planes[i];
+		const float *x = bounds + frustum.far_index[i][0] * stride;
+		const float *y = bounds + frustum.far_index[i][1] * stride;
+		const float *z = bounds + frustum.far_index[i][2] * stride;
+
+		__m128 nx = _mm_set1_ps(plane[0]);
+		__m128 ny = _mm_set1_ps(plane[1]);
+		__m128 nz = _mm_set1_ps(plane[2]);
+		__m128 d = _mm_set1_ps(plane[3]);
+
+		__m128 dist0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(x)), _mm_mul_ps(ny, _mm_loadu_ps(y))), _mm_add_ps(_mm_mul_ps(nz, _mm_loadu_ps(z)), d));
+		__m128 dist1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(x + 4)), _mm_mul_ps(ny, _mm_loadu_ps(y + 4))), _mm_add_ps(_mm_mul_ps(nz, _mm_loadu_ps(z + 4)), d));
+		outside0 = _mm_or_ps(outside0, _mm_cmplt_ps(dist0, zero));
+		outside1 = _mm_or_ps(outside1, _mm_cmplt_ps(dist1, zero));
+	}
+	return ~(_mm_movemask_ps(outside0) | (_mm_movemask_ps(outside1) << 4)) & 0xff;
+}
+#endif
+
+#ifdef CL_BVH_AVX
+static cl_target_avx int cl_bvh_test_leaf_avx(const float *bounds, int stride, const BVHFrustum &frustum)
+{
+	__m256 zero = _mm256_setzero_ps();
+	__m256 outside = _mm256_setzero_ps();
+	for (int i = 0; i < 6; i++)
+	{
+		const float *plane = frustum.planes[i];
+		__m256 x = _mm256_loadu_ps(bounds + frustum.far_index[i][0] * stride);
+		__m256 y = _mm256_loadu_ps(bounds + frustum.far_index[i][1] * stride);
+		__m256 z = _mm256_loadu_ps(bounds + frustum.far_index[i][2] * stride);
+
+		__m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[0]), x), _mm256_mul_ps(_mm256_set1_ps(plane[1]), y)), _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[2]), z), _mm256_set1_ps(plane[3])));
+		outside = _mm256_or_ps(outside, _mm256_cmp_ps(dist, zero, _CMP_LT_OQ));
+	}
+	return ~_mm256_movemask_ps(outside) & 0xff;
+}
+#endif
+
+void BVHTree::test_node(const BVHNode &node, const BVHFrustum &frustum, int &out_outside, int &out_partial) const
+{
+#ifdef CL_BVH_SSE2
+	if (use_sse2)
+	{
+		cl_bvh_test_node_sse2(node, frustum, out_outside, out_partial);
+		return;
+	}
+#endif
+
+	out_outside = 0;
+	out_partial = 0;
+	for (int lane = 0; lane < 4; lane++)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			const float *plane = frustum.planes[i];
+			const int *far_index = frustum.far_index[i];
+			const int *near_index = frustum.near_index[i];
+			float far_dist = plane[0] * node.bounds[far_index[0]][lane] + plane[1] * node.bounds[far_index[1]][lane] + plane[2] * node.bounds[far_index[2]][lane] + plane[3];
+			float near_dist = plane[0] * node.bounds[near_index[0]][lane] + plane[1] * node.bounds[near_index[1]][lane] + plane[2] * node.bounds[near_index[2]][lane] + plane[3];
+			if (far_dist < 0.0f)
+			{
+				out_outside |= 1 << lane;
+				break;
+			}
+			else if (near_dist <= 0.0f)
+			{
+				out_partial |= 1 << lane;
+			}
+		}
+	}
+	out_partial &= ~out_outside;
+}
+
+int BVHTree::test_leaf(int first, const BVHFrustum &frustum) const
+{
+	const float *bounds = &object_bounds[first];
+
+#ifdef CL_BVH_AVX
+	if (use_avx)
+		return cl_bvh_test_leaf_avx(bounds, bounds_stride, frustum);
+#endif
+#ifdef CL_BVH_SSE2
+	if (use_sse2)
+		return cl_bvh_test_leaf_sse2(bounds, bounds_stride, frustum);
+#endif
+
+	int visible = 0;
+	for (int i = 0; i < max_leaf_objects; i++)
+	{
+		bool outside = false;
+		for (int j = 0; j < 6 && !outside; j++)
+		{
+			const float *plane = frustum.planes[j];
+			const int *far_index = frustum.far_index[j];
+			float far_dist = plane[0] * bounds[far_index[0] * bounds_stride + i] + plane[1] * bounds[far_index[1] * bounds_stride + i] + plane[2] * bounds[far_index[2] * bounds_stride + i] + plane[3];
+			outside = far_dist < 0.0f;
+		}
+		if (!outside)
+			visible |= 1 << i;
+	}
+	return visible;
+}
+
+void BVHTree::add_range(int first, int count, std::vector<SceneItem *> &pvs) const
+{
+	int end = first + count;
+	for (int slot = first; slot < end; slot++)
+	{
+		if (items[slot])
+			pvs.push_back(items[slot]);
+	}
+}
+
+bool BVHTree::is_outside(const BVHFrustum &frustum, const AxisAlignedBoundingBox &box)
+{
+	const float bounds[6] = { box.aabb_min.x, box.aabb_min.y, box.aabb_min.z, box.aabb_max.x, box.aabb_max.y, box.aabb_max.z };
+	for (int i = 0; i < 6; i++)
+	{
+		const float *plane = frustum.planes[i];
+		const int *far_index = frustum.far_index[i];
+		float far_dist = plane[0] * bounds[far_index[0]] + plane[1] * bounds[far_index[1]] + plane[2] * bounds[far_index[2]] + plane[3];
+		if (far_dist < 0.0f)
+			return true;
+	}
+	return false;
+}
+
+void BVHTree::update()
+{
+	// New objects are culled linearly until enough have accumulated to justify a rebuild.
+	// Refits keep the tree correct for moving objects, but its quality degrades as boxes
+	// grow apart from their original clusters; the summed node surface area tracks that.
+	bool rebuild_needed =
+		(int)pending.size() > std::max(64, tree_count / 16) ||
+		removed_count > tree_count / 4 ||
+		tree_cost > built_cost * 2.0f;
+
+	if (rebuild_needed)
+		rebuild();
+}
+
+void BVHTree::rebuild()
+{
+	std::vector<BuildItem> build_items;
+	build_items.reserve(tree_count - removed_count + pending.size());
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		if (objects[i])
+		{
+			BuildItem item;
+			item.object = objects[i];
+			build_items.push_back(item);
+		}
+	}
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		BuildItem item;
+		item.object = pending[i];
+		build_items.push_back(item);
+	}
+	pending.clear();
+
+	for (size_t i = 0; i < build_items.size(); i++)
+	{
+		BuildItem &item = build_items[i];
+		const AxisAlignedBoundingBox &box = item.object->box;
+		item.bounds[0] = box.aabb_min.x;
+		item.bounds[1] = box.aabb_min.y;
+		item.bounds[2] = box.aabb_min.z;
+		item.bounds[3] = box.aabb_max.x;
+		item.bounds[4] = box.aabb_max.y;
+		item.bounds[5] = box.aabb_max.z;
+		for (int axis = 0; axis < 3; axis++)
+			item.center[axis] = (item.bounds[axis] + item.bounds[3 + axis]) * 0.5f;
+	}
+
+	tree_count = (int)build_items.size();
+	removed_count = 0;
+
+	// Padding lets the leaf tests always load eight objects
+	bounds_stride = ((tree_count + 7) & ~7) + 8;
+	object_bounds.resize(6 * bounds_stride);
+	for (int row = 0; row < 6; row++)
+		std::fill(object_bounds.begin() + row * bounds_stride, object_bounds.begin() + (row + 1) * bounds_stride, row < 3 ? bvh_empty_min : bvh_empty_max);
+
+	items.resize(tree_count);
+	objects.resize(tree_count);
+	slot_leaf.resize(tree_count);
+
+	nodes.clear();
+	tree_cost = 0.0f;
+	if (tree_count > 0)
+	{
+		nodes.reserve(tree_count / 2 + 1);
+		BVHNode root;
+		root.parent = -1;
+		root.parent_lane = 0;
+		nodes.push_back(root);
+		build_node(0, build_items, 0, tree_count);
+	}
+	built_cost = tree_cost;
+
+	for (int slot = 0; slot < tree_count; slot++)
+	{
+		BVHObject *object = build_items[slot].object;
+		object->slot = slot;
+		object->pending_index = -1;
+		items[slot] = object->visible_object;
+		objects[slot] = object;
+		for (int row = 0; row < 6; row++)
+			object_bounds[row * bounds_stride + slot] = build_items[slot].bounds[row];
+	}
+}
+
+void BVHTree::build_node(int node_index, std::vector<BuildItem> &build_items, int begin, int end)
+{
+	// Split the largest cluster until there is one per lane or all fit in a leaf
+	int cluster_begin[4] = { begin, 0, 0, 0 };
+	int cluster_end[4] = { end, 0, 0, 0 };
+	int num_clusters = 1;
+	while (num_clusters < 4)
+	{
+		int largest = 0;
+		for (int i = 1; i < num_clusters; i++)
+		{
+			if (cluster_end[i] - cluster_begin[i] > cluster_end[largest] - cluster_begin[largest])
+				largest = i;
+		}
+		if (cluster_end[largest] - cluster_begin[largest] <= max_leaf_objects)
+			break;
+
+		int middle = split_sah(build_items, cluster_begin[largest], cluster_end[largest]);
+		for (int i = num_clusters; i > largest + 1; i--)
+		{
+			cluster_begin[i] = cluster_begin[i - 1];
+			cluster_end[i] = cluster_end[i - 1];
+		}
+		cluster_begin[largest + 1] = middle;
+		cluster_end[largest + 1] = cluster_end[largest];
+		cluster_end[largest] = middle;
+		num_clusters++;
+	}
+
+	for (int lane = 0; lane < 4; lane++)
+	{
+		float bounds[6] = { bvh_empty_min, bvh_empty_min, bvh_empty_min, bvh_empty_max, bvh_empty_max, bvh_empty_max };
+		int first = 0, count = 0;
+		if (lane < num_clusters)
+		{
+			first = cluster_begin[lane];
+			count = cluster_end[lane] - cluster_begin[lane];
+			for (int i = cluster_begin[lane]; i < cluster_end[lane]; i++)
+			{
+				for (int axis = 0; axis < 3; axis++)
+				{
+					bounds[axis] = std::min(bounds[axis], build_items[i].bounds[axis]);
+					bounds[3 + axis] = std::max(bounds[3 + axis], build_items[i].bounds[3 + axis]);
+				}
+			}
+			tree_cost += half_area(bounds);
+		}
+
+		BVHNode &node = nodes[node_index];
+		for (int row = 0; row < 6; row++)
+			node.bounds[row][lane] = bounds[row];
+		node.first[lane] = first;
+		node.count[lane] = count;
+		node.child[lane] = -1;
+	}
+
+	for (int lane = 0; lane < num_clusters; lane++)
+	{
+		if (cluster_end[lane] - cluster_begin[lane] > max_leaf_objects)
+		{
+			int child_index = (int)nodes.size();
+			BVHNode child;
+			child.parent = node_index;
+			child.parent_lane = lane;
+			nodes.push_back(child);
+			nodes[node_index].child[lane] = child_index;
+			build_node(child_index, build_items, cluster_begin[lane], cluster_end[lane]);
+		}
+		else
+		{
+			for (int slot = cluster_begin[lane]; slot < cluster_end[lane]; slot++)
+				slot_leaf[slot] = node_index * 4 + lane;
+		}
+	}
+}
+
+int BVHTree::split_sah(std::vector<BuildItem> &build_items, int begin, int end)
+{
+	float center_min[3] = { bvh_empty_min, bvh_empty_min, bvh_empty_min };
+	float center_max[3] = { bvh_empty_max, bvh_empty_max, bvh_empty_max };
+	for (int i = begin; i < end; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			center_min[axis] = std::min(center_min[axis], build_items[i].center[axis]);
+			center_max[axis] = std::max(center_max[axis], build_items[i].center[axis]);
+		}
+	}
+
+	int best_axis = -1;
+	int best_bin = 0;
+	float best_cost = 0.0f;
+	float best_scale = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = center_max[axis] - center_min[axis];
+		if (extent <= 0.0f)
+			continue;
+		float scale = sah_bins * 0.9999f / extent;
+
+		int bin_count[sah_bins];
+		float bin_bounds[sah_bins][6];
+		for (int bin = 0; bin < sah_bins; bin++)
+		{
+			bin_count[bin] = 0;
+			for (int row = 0; row < 6; row++)
+				bin_bounds[bin][row] = row < 3 ? bvh_empty_min : bvh_empty_max;
+		}
+
+		for (int i = begin; i < end; i++)
+		{
+			int bin = (int)((build_items[i].center[axis] - center_min[axis]) * scale);
+			bin_count[bin]++;
+			for (int row = 0; row < 3; row++)
+			{
+				bin_bounds[bin][row] = std::min(bin_bounds[bin][row], build_items[i].bounds[row]);
+				bin_bounds[bin][3 + row] = std::max(bin_bounds[bin][3 + row], build_items[i].bounds[3 + row]);
+			}
+		}
+
+		// Sweep from the right to get the cost of everything above each split plane
+		float right_area[sah_bins];
+		int right_count[sah_bins];
+		float bounds[6] = { bvh_empty_min, bvh_empty_min, bvh_empty_min, bvh_empty_max, bvh_empty_max, bvh_empty_max };
+		int count = 0;
+		for (int bin = sah_bins - 1; bin > 0; bin--)
+		{
+			for (int row = 0; row < 3; row++)
+			{
+				bounds[row] = std::min(bounds[row], bin_bounds[bin][row]);
+				bounds[3 + row] = std::max(bounds[3 + row], bin_bounds[bin][3 + row]);
+			}
+			count += bin_count[bin];
+			right_area[bin] = half_area(bounds);
+			right_count[bin] = count;
+		}
+
+		for (int row = 0; row < 6; row++)
+			bounds[row] = row < 3 ? bvh_empty_min : bvh_empty_max;
+		count = 0;
+		for (int bin = 0; bin < sah_bins - 1; bin++)
+		{
+			for (int row = 0; row < 3; row++)
+			{
+				bounds[row] = std::min(bounds[row], bin_bounds[bin][row]);
+				bounds[3 + row] = std::max(bounds[3 + row], bin_bounds[bin][3 + row]);
+			}
+			count += bin_count[bin];
+			if (count == 0 || right_count[bin + 1] == 0)
+				continue;
+
+			float cost = half_area(bounds) * count + right_area[bin + 1] * right_count[bin + 1];
+			if (best_axis == -1 || cost < best_cost)
+			{
+				best_axis = axis;
+				best_bin = bin;
+				best_cost = cost;
+				best_scale = scale;
+			}
+		}
+	}
+
+	if (best_axis == -1)
+		return (begin + end) / 2;
+
+	int middle = begin;
+	for (int i = begin; i < end; i++)
+	{
+		int bin = (int)((build_items[i].center[best_axis] - center_min[best_axis]) * best_scale);
+		if (bin <= best_bin)
+			std::swap(build_items[i], build_items[middle++]);
+	}
+	return middle;
+}
+
+void BVHTree::refit(int slot)
+{
+	int node_index = slot_leaf[slot] / 4;
+	int lane = slot_leaf[slot] % 4;
+
+	float bounds[6];
+	const BVHNode &leaf = nodes[node_index];
+	int end = leaf.first[lane] + leaf.count[lane];
+	for (int row = 0; row < 6; row++)
+	{
+		const float *values = &object_bounds[row * bounds_stride];
+		float value = row < 3 ? bvh_empty_min : bvh_empty_max;
+		for (int i = leaf.first[lane]; i < end; i++)
+			value = row < 3 ? std::min(value, values[i]) : std::max(value, values[i]);
+		bounds[row] = value;
+	}
+
+	while (true)
+	{
+		BVHNode &node = nodes[node_index];
+
+		float old_bounds[6];
+		bool changed = false;
+		for (int row = 0; row < 6; row++)
+		{
+			old_bounds[row] = node.bounds[row][lane];
+			changed = changed || old_bounds[row] != bounds[row];
+			node.bounds[row][lane] = bounds[row];
+		}
+		if (!changed)
+			break;
+
+		tree_cost += half_area(bounds) - half_area(old_bounds);
+
+		if (node.parent == -1)
+			break;
+
+		for (int row = 0; row < 6; row++)
+		{
+			const float *values = node.bounds[row];
+			bounds[row] = row < 3 ?
+				std::min(std::min(values[0], values[1]), std::min(values[2], values[3])) :
+				std::max(std::max(values[0], values[1]), std::max(values[2], values[3]));
+		}
+		lane = node.parent_lane;
+		node_index = node.parent;
+	}
+}
+
+void BVHTree::set_object_bounds(int slot, const AxisAlignedBoundingBox &box)
+{
+	object_bounds[slot] = box.aabb_min.x;
+	object_bounds[bounds_stride + slot] = box.aabb_min.y;
+	object_bounds[2 * bounds_stride + slot] = box.aabb_min.z;
+	object_bounds[3 * bounds_stride + slot] = box.aabb_max.x;
+	object_bounds[4 * bounds_stride + slot] = box.aabb_max.y;
+	object_bounds[5 * bounds_stride + slot] = box.aabb_max.z;
+}
+
+float BVHTree::half_area(const float *bounds)
+{
+	float dx = bounds[3] - bounds[0];
+	float dy = bounds[4] - bounds[1];
+	float dz = bounds[5] - bounds[2];
+	if (dx < 0.0f || dy < 0.0f || dz < 0.0f)
+		return 0.0f;
+	return dx * dy + dy * dz + dz * dx;
+}
+
+}
@@ -0,0 +1,149 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "API/Scene3D/scene_cull_provider.h"
+#include "API/Core/Math/aabb.h"
+
+namespace clan
+{
+
+class FrustumPlanes;
+
+class BVHObject : public SceneCullProxy
+{
+public:
+	BVHObject(SceneItem *visible_object, const AxisAlignedBoundingBox &box) : visible_object(visible_object), box(box), slot(-1), pending_index(-1) { }
+
+	SceneItem *visible_object;
+	AxisAlignedBoundingBox box;
+
+	/// \brief Index into the leaf ordered object arrays, or -1 if not in the tree
+	int slot;
+
+	/// \brief Index into the pending list, or -1 if not pending
+	int pending_index;
+};
+
+/// \brief Four-wide BVH node with its child bounds stored as structure of arrays
+///
+/// bounds[0..2] holds min x,y,z and bounds[3..5] max x,y,z for each of the four lanes.
+/// A lane with child -1 is a leaf covering count objects starting at first. Internal
+/// lanes also store the object range of their subtree, as subtrees are kept contiguous.
+class BVHNode
+{
+public:
+	float bounds[6][4];
+	int child[4];
+	int first[4];
+	int count[4];
+	int parent;
+	int parent_lane;
+};
+
+/// \brief Frustum planes prepared for testing against SoA bounds
+class BVHFrustum
+{
+public:
+	BVHFrustum(const FrustumPlanes &frustum);
+
+	float planes[6][4];
+
+	/// \brief Bounds row of the corner furthest along each plane normal
+	int far_index[6][3];
+
+	/// \brief Bounds row of the corner nearest along each plane normal
+	int near_index[6][3];
+};
+
+/// \brief Cull provider using a flattened SAH built bounding volume hierarchy
+class BVHTree : public SceneCullProvider
+{
+public:
+	BVHTree();
+	~BVHTree();
+
+	SceneCullProxy *create_proxy(SceneItem *item, const AxisAlignedBoundingBox &aabb);
+	void delete_proxy(SceneCullProxy *proxy);
+
+	void set_aabb(SceneCullProxy *proxy, const AxisAlignedBoundingBox &aabb);
+	AxisAlignedBoundingBox get_aabb(SceneCullProxy *proxy);
+
+	std::vector<SceneItem *> cull(const FrustumPlanes &frustum);
+	std::vector<SceneItem *> cull(const Vec3f &point);
+	std::vector<std::vector<SceneItem *> > cull_views(const std::vector<FrustumPlanes> &frustums);
+
+private:
+	class BuildItem
+	{
+	public:
+		float bounds[6];
+		float center[3];
+		BVHObject *object;
+	};
+
+	void update();
+	void rebuild();
+	void build_node(int node_index, std::vector<BuildItem> &build_items, int begin, int end);
+	int split_sah(std::vector<BuildItem> &build_items, int begin, int end);
+	void refit(int slot);
+	void set_object_bounds(int slot, const AxisAlignedBoundingBox &box);
+
+	void cull_views(const std::vector<BVHFrustum> &frustums, int first_view, int num_views, std::vector<std::vector<SceneItem *> > &pvs);
+	void test_node(const BVHNode &node, const BVHFrustum &frustum, int &out_outside, int &out_partial) const;
+	int test_leaf(int first, const BVHFrustum &frustum) const;
+	void add_range(int first, int count, std::vector<SceneItem *> &pvs) const;
+
+	static float half_area(const float *bounds);
+	static bool is_outside(const BVHFrustum &frustum, const AxisAlignedBoundingBox &box);
+
+	std::vector<BVHNode> nodes;
+
+	std::vector<SceneItem *> items;
+	std::vector<BVHObject *> objects;
+	std::vector<int> slot_leaf;
+	std::vector<float> object_bounds;
+	int bounds_stride;
+
+	std::vector<BVHObject *> pending;
+
+	int tree_count;
+	int removed_count;
+	float tree_cost;
+	float built_cost;
+
+	bool use_sse2;
+	bool use_avx;
+
+	static const int max_leaf_objects = 8;
+	static const int sah_bins = 16;
+	static const int max_views = 32;
+};
+
+}
@@ -28,6 +28,8 @@
 
 #include "Scene3D/precomp.h"
 #include "rtree.h"
+#include "API/Core/Math/frustum_planes.h"
+#include "API/Core/Math/intersection_test.h"
 
 namespace clan
 {
@@ -86,15 +88,28 @@ AxisAlignedBoundingBox RTree::get_aabb(SceneCullProxy *proxy)
 std::vector<SceneItem *> RTree::cull(const FrustumPlanes &frustum)
 {
 	std::vector<SceneItem *> pvs;
-	//root->cull(frame++, frustum, aabb, pvs);
+	root.Search(RTreeFrustumTest(frustum), &RTree::add_result, &pvs);
 	return pvs;
 }
 
 std::vector<SceneItem *> RTree::cull(const Vec3f &point)
 {
 	std::vector<SceneItem *> pvs;
+	float a_point[3] = { point.x, point.y, point.z };
+	root.Search(a_point, a_point, &RTree::add_result, &pvs);
 	return pvs;
 }
 
+bool RTree::add_result(RTreeObject *tree_object, void *context)
+{
+	static_cast<std::vector<SceneItem *> *>(context)->push_back(tree_object->visible_object);
+	return true;
 }
 
+bool RTreeFrustumTest::operator()(const float *a_min, const float *a_max) const
+{
+	AxisAlignedBoundingBox box(Vec3f(a_min[0], a_min[1], a_min[2]), Vec3f(a_max[0], a_max[1], a_max[2]));
+	return IntersectionTest::frustum_aabb(frustum, box) != IntersectionTest::outside;
+}
+
+}
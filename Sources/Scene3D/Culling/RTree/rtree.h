@@ -36,6 +36,7 @@ namespace clan
 {
 
 class AxisAlignedBoundingBox;
+class FrustumPlanes;
 
 class RTreeObject : public SceneCullProxy
 {
@@ -60,6 +61,15 @@ public:
 	}
 };
 
+class RTreeFrustumTest
+{
+public:
+	RTreeFrustumTest(const FrustumPlanes &frustum) : frustum(frustum) { }
+	bool operator()(const float *a_min, const float *a_max) const;
+
+	const FrustumPlanes &frustum;
+};
+
 class RTree : public SceneCullProvider
 {
 public:
@@ -76,6 +86,8 @@ public:
 	std::vector<SceneItem *> cull(const Vec3f &point);
 
 private:
+	static bool add_result(RTreeObject *tree_object, void *context);
+
 	RTreeRoot<RTreeObject*, float, 3, float> root;
 	int frame;
 };
@@ -129,6 +129,19 @@ public:
   /// \param a_context User context to pass as parameter to a_resultCallback
   /// \return Returns the number of entries found
   int Search(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDIMS], t_resultCallback a_resultCallback, void* a_context);
+
+  /// Find all whose bounding rect passes a volume test
+  /// \param a_test Functor called with the min and max of a bounding rect. Returns true if the rect overlaps the search volume
+  /// \param a_resultCallback Callback function to return result.  Callback should return 'true' to continue searching
+  /// \param a_context User context to pass as parameter to a_resultCallback
+  /// \return Returns the number of entries found
+  template<typename t_volumeTest>
+  int Search(const t_volumeTest& a_test, t_resultCallback a_resultCallback, void* a_context)
+  {
+    int foundCount = 0;
+    Search(m_root, a_test, foundCount, a_resultCallback, a_context);
+    return foundCount;
+  }
   
   /// Remove all entries from tree
   void RemoveAll();
@@ -391,6 +404,36 @@ protected:
   bool Overlap(Rect* a_rectA, Rect* a_rectB);
   void ReInsert(Node* a_node, ListNode** a_listNode);
   bool Search(Node* a_node, Rect* a_rect, int& a_foundCount, t_resultCallback a_resultCallback, void* a_context);
+
+  template<typename t_volumeTest>
+  bool Search(Node* a_node, const t_volumeTest& a_test, int& a_foundCount, t_resultCallback a_resultCallback, void* a_context)
+  {
+    for(int index=0; index < a_node->m_count; ++index)
+    {
+      Branch& branch = a_node->m_branch[index];
+      if(!a_test(branch.m_rect.m_min, branch.m_rect.m_max))
+      {
+        continue;
+      }
+
+      if(a_node->IsInternalNode())
+      {
+        if(!Search(branch.m_child, a_test, a_foundCount, a_resultCallback, a_context))
+        {
+          return false;
+        }
+      }
+      else
+      {
+        ++a_foundCount;
+        if(a_resultCallback && !a_resultCallback(branch.m_data, a_context))
+        {
+          return false;
+        }
+      }
+    }
+    return true; // Continue searching
+  }
   void RemoveAllRec(Node* a_node);
   void Reset();
   void CountRec(Node* a_node, int& a_count);
@@ -0,0 +1,67 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include <vector>
+
+namespace clan
+{
+
+/// \brief Contiguous array of scene items with constant time removal
+///
+/// Each item stores its position in the pool in a pool_index member. Removing an
+/// item moves the last item into the hole, so the order of the items is not kept.
+template<typename Type>
+class ScenePool
+{
+public:
+	void add(Type *item)
+	{
+		item->pool_index = (int)items.size();
+		items.push_back(item);
+	}
+
+	void remove(Type *item)
+	{
+		Type *last = items.back();
+		items[item->pool_index] = last;
+		last->pool_index = item->pool_index;
+		items.pop_back();
+		item->pool_index = -1;
+	}
+
+	bool empty() const { return items.empty(); }
+	size_t size() const { return items.size(); }
+	Type *operator[](size_t index) const { return items[index]; }
+
+private:
+	std::vector<Type *> items;
+};
+
+}
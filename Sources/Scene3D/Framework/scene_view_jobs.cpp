@@ -0,0 +1,264 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+#include "Scene3D/precomp.h"
+#include "scene_view_jobs.h"
+#include "API/Core/System/event.h"
+#include "API/Core/System/interlocked_variable.h"
+#include "API/Core/System/system.h"
+#include "Scene3D/scene_impl.h"
+#include "Scene3D/scene_object_impl.h"
+#include "Scene3D/scene_light_impl.h"
+#include "Scene3D/scene_particle_emitter_impl.h"
+#include "Scene3D/Model/model.h"
+#include "Scene3D/Framework/instances_buffer.h"
+#include <algorithm>
+
+namespace clan
+{
+
+/// \brief Completion state of the views being built by a SceneViewJobs
+class SceneViewJobsState
+{
+public:
+	SceneViewJobsState(int num_items)
+	{
+		items_remaining.set(num_items);
+	}
+
+	void item_done()
+	{
+		if (items_remaining.decrement() == 0)
+			done_event.set();
+	}
+
+	void wait()
+	{
+		done_event.wait();
+	}
+
+private:
+	InterlockedVariable items_remaining;
+	Event done_event;
+};
+
+/// \brief Builds the draw lists of a single view
+class SceneViewWorkItem : public WorkItem
+{
+public:
+	SceneViewWorkItem(const std::shared_ptr<SceneViewJobsState> &state, SceneView *view, const std::vector<SceneItem *> *items)
+	: state(state), view(view), items(items)
+	{
+	}
+
+	void process_work()
+	{
+		view->build(*items);
+		state->item_done();
+	}
+
+private:
+	std::shared_ptr<SceneViewJobsState> state;
+	SceneView *view;
+	const std::vector<SceneItem *> *items;
+};
+
+/// \brief Writes the instance data for a range of instances of a model
+class ModelUploadWorkItem : public WorkItem
+{
+public:
+	ModelUploadWorkItem(const std::shared_ptr<SceneViewJobsState> &state, Model *model, Vec4f *instance_data, size_t begin, size_t end, const Mat4f &world_to_eye, const Mat4f &eye_to_projection)
+	: state(state), model(model), instance_data(instance_data), begin(begin), end(end), world_to_eye(world_to_eye), eye_to_projection(eye_to_projection)
+	{
+	}
+
+	void process_work()
+	{
+		model->upload(instance_data, begin, end, world_to_eye, eye_to_projection);
+		state->item_done();
+	}
+
+private:
+	std::shared_ptr<SceneViewJobsState> state;
+	Model *model;
+	Vec4f *instance_data;
+	size_t begin, end;
+	Mat4f world_to_eye;
+	Mat4f eye_to_projection;
+};
+
+class SceneViewInstanceLess
+{
+public:
+	bool operator()(const SceneViewInstance &a, const SceneViewInstance &b) const
+	{
+		return a.model_index < b.model_index;
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+void SceneView::build(const std::vector<SceneItem *> &items)
+{
+	instances.clear();
+	lights.clear();
+	emitters.clear();
+
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		SceneObject_Impl *object = dynamic_cast<SceneObject_Impl*>(items[i]);
+		if (object)
+		{
+			Model *model = object->instance.get_renderer().get();
+			if (model)
+			{
+				instances.push_back(SceneViewInstance(model->get_model_index(), model, object));
+				instances.back().object_to_world = object->get_object_to_world();
+			}
+			continue;
+		}
+
+		SceneLight_Impl *light = dynamic_cast<SceneLight_Impl*>(items[i]);
+		if (light)
+		{
+			lights.push_back(light);
+			continue;
+		}
+
+		SceneParticleEmitter_Impl *emitter = dynamic_cast<SceneParticleEmitter_Impl*>(items[i]);
+		if (emitter)
+			emitters.push_back(emitter);
+	}
+
+	// Stable so instances of a model keep the order the cull provider returned them in
+	std::stable_sort(instances.begin(), instances.end(), SceneViewInstanceLess());
+}
+
+bool SceneView::is_frustum(const FrustumPlanes &other) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		if (frustum.planes[i] != other.planes[i])
+			return false;
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+SceneViewJobs::SceneViewJobs()
+: num_threads(0)
+{
+	set_num_threads(System::get_num_cores() - 1);
+}
+
+SceneViewJobs::~SceneViewJobs()
+{
+}
+
+void SceneViewJobs::set_num_threads(int new_num_threads)
+{
+	new_num_threads = std::max(new_num_threads, 0);
+	if (new_num_threads != num_threads || (new_num_threads > 0 && !work_queue))
+	{
+		work_queue.reset();
+		num_threads = new_num_threads;
+		if (num_threads > 0)
+			work_queue.reset(new WorkQueue(false, num_threads));
+	}
+}
+
+void SceneViewJobs::run(SceneCullProvider *cull_provider, std::vector<SceneView> &views, size_t first_view)
+{
+	size_t num_views = views.size() - first_view;
+	if (num_views == 0)
+		return;
+
+	std::vector<FrustumPlanes> frustums;
+	frustums.reserve(num_views);
+	for (size_t i = 0; i < num_views; i++)
+		frustums.push_back(views[first_view + i].frustum);
+
+	pvs = cull_provider->cull_views(frustums);
+
+	if (!work_queue || num_views < 2)
+	{
+		for (size_t i = 0; i < num_views; i++)
+			views[first_view + i].build(pvs[i]);
+		return;
+	}
+
+	// The calling thread builds the first view while the workers build the rest
+	std::shared_ptr<SceneViewJobsState> state(new SceneViewJobsState((int)num_views - 1));
+	std::vector<WorkItem *> items;
+	items.reserve(num_views - 1);
+	for (size_t i = 1; i < num_views; i++)
+		items.push_back(new SceneViewWorkItem(state, &views[first_view + i], &pvs[i]));
+	work_queue->queue_batch(items, work_priority_high);
+	views[first_view].build(pvs[0]);
+	state->wait();
+}
+
+void SceneViewJobs::upload(const std::vector<Model *> &models, InstancesBuffer &instances_buffer, const Mat4f &world_to_eye, const Mat4f &eye_to_projection)
+{
+	// Buffer space is handed out in model order on the calling thread
+	std::vector<Vec4f *> instance_data(models.size());
+	int num_batches = 0;
+	for (size_t i = 0; i < models.size(); i++)
+	{
+		instance_data[i] = instances_buffer.upload(models[i]->get_model_index(), models[i]->get_instance_vectors_count());
+		num_batches += (models[i]->get_instance_count() + instances_per_upload_batch - 1) / instances_per_upload_batch;
+	}
+
+	if (!work_queue || num_batches < 2)
+	{
+		for (size_t i = 0; i < models.size(); i++)
+			models[i]->upload(instance_data[i], 0, models[i]->get_instance_count(), world_to_eye, eye_to_projection);
+		return;
+	}
+
+	// The calling thread uploads the first batch while the workers do the rest
+	std::shared_ptr<SceneViewJobsState> state(new SceneViewJobsState(num_batches - 1));
+	std::vector<WorkItem *> items;
+	items.reserve(num_batches - 1);
+	for (size_t i = 0; i < models.size(); i++)
+	{
+		size_t count = models[i]->get_instance_count();
+		for (size_t begin = 0; begin < count; begin += instances_per_upload_batch)
+		{
+			if (i == 0 && begin == 0)
+				continue;
+			size_t end = std::min(begin + instances_per_upload_batch, count);
+			items.push_back(new ModelUploadWorkItem(state, models[i], instance_data[i], begin, end, world_to_eye, eye_to_projection));
+		}
+	}
+	work_queue->queue_batch(items, work_priority_high);
+	models[0]->upload(instance_data[0], 0, std::min((size_t)instances_per_upload_batch, (size_t)models[0]->get_instance_count()), world_to_eye, eye_to_projection);
+	state->wait();
+}
+
+}
@@ -0,0 +1,101 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "API/Core/Math/frustum_planes.h"
+#include "API/Core/System/work_queue.h"
+#include "API/Scene3D/scene_cull_provider.h"
+
+namespace clan
+{
+
+class Model;
+class InstancesBuffer;
+class SceneObject_Impl;
+class SceneLight_Impl;
+class SceneParticleEmitter_Impl;
+
+/// \brief Model instance in the draw list of a view
+class SceneViewInstance
+{
+public:
+	SceneViewInstance(int model_index, Model *model, SceneObject_Impl *object) : model_index(model_index), model(model), object(object) { }
+
+	int model_index;
+	Model *model;
+	SceneObject_Impl *object;
+	Mat4f object_to_world;
+};
+
+/// \brief Visible items of a view, sorted for submission
+class SceneView
+{
+public:
+	/// \brief Sorts the potential visible set into draw lists
+	///
+	/// Instances are grouped by model so each model is uploaded and drawn once.
+	void build(const std::vector<SceneItem *> &items);
+
+	bool is_frustum(const FrustumPlanes &other) const;
+
+	FrustumPlanes frustum;
+	std::vector<SceneViewInstance> instances;
+	std::vector<SceneLight_Impl *> lights;
+	std::vector<SceneParticleEmitter_Impl *> emitters;
+};
+
+/// \brief Builds the draw lists of several views on worker threads
+class SceneViewJobs
+{
+public:
+	SceneViewJobs();
+	~SceneViewJobs();
+
+	/// \brief Sets the number of worker threads. Zero builds the views on the calling thread.
+	void set_num_threads(int num_threads);
+
+	/// \brief Culls the views from first_view onwards in one pass and builds their draw lists
+	///
+	/// The cull provider is only accessed from the calling thread.
+	void run(SceneCullProvider *cull_provider, std::vector<SceneView> &views, size_t first_view);
+
+	/// \brief Writes the instance data of the models into a locked instances buffer
+	///
+	/// The instances of each model are split into batches that are animated in parallel.
+	void upload(const std::vector<Model *> &models, InstancesBuffer &instances_buffer, const Mat4f &world_to_eye, const Mat4f &eye_to_projection);
+
+	static const int instances_per_upload_batch = 32;
+
+private:
+	std::unique_ptr<WorkQueue> work_queue;
+	int num_threads;
+	std::vector<std::vector<SceneItem *> > pvs;
+};
+
+}
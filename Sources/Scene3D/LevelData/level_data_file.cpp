@@ -0,0 +1,157 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Scene3D/precomp.h"
+#include "API/Scene3D/LevelData/level_data_file.h"
+#include "API/Scene3D/LevelData/level_data.h"
+#include "Scene3D/Resources/scene_data_file_format.h"
+
+namespace clan
+{
+
+static const char level_data_file_magic[4] = { 'C', 'L', 'L', 'D' };
+
+void LevelDataFile::save(const std::string &filename, const LevelData &level_data)
+{
+	SceneDataFileWriter writer(level_data_file_magic, version);
+
+	writer.write<ubyte32>(level_data.portals.size());
+	for (size_t i = 0; i < level_data.portals.size(); i++)
+	{
+		const LevelDataPortal &portal = level_data.portals[i];
+		writer.write_array(portal.points);
+		writer.write<Vec4f>(portal.plane);
+		writer.write<int>(portal.front);
+		writer.write<int>(portal.back);
+	}
+
+	writer.write<ubyte32>(level_data.sectors.size());
+	for (size_t i = 0; i < level_data.sectors.size(); i++)
+	{
+		writer.write_array(level_data.sectors[i].portals);
+		writer.write_array(level_data.sectors[i].objects);
+		writer.write_array(level_data.sectors[i].lights);
+	}
+
+	writer.write<ubyte32>(level_data.objects.size());
+	for (size_t i = 0; i < level_data.objects.size(); i++)
+	{
+		const LevelDataObject &object = level_data.objects[i];
+		writer.write_string(object.model_filename);
+		writer.write<Vec3f>(object.position);
+		writer.write<Quaternionf>(object.orientation);
+		writer.write<Vec3f>(object.scale);
+		writer.write<int>(object.level_set);
+	}
+
+	writer.write<ubyte32>(level_data.lights.size());
+	for (size_t i = 0; i < level_data.lights.size(); i++)
+	{
+		const LevelDataLight &light = level_data.lights[i];
+		writer.write<Vec3f>(light.position);
+		writer.write<Quaternionf>(light.orientation);
+		writer.write<Vec3f>(light.color);
+		writer.write<float>(light.attenuation_start);
+		writer.write<float>(light.attenuation_end);
+		writer.write<float>(light.falloff);
+		writer.write<float>(light.hotspot);
+		writer.write<unsigned char>(light.casts_shadows);
+		writer.write<int>(light.level_set);
+	}
+
+	writer.write<ubyte32>(level_data.level_sets.size());
+	for (size_t i = 0; i < level_data.level_sets.size(); i++)
+		writer.write_string(level_data.level_sets[i]);
+
+	writer.write<Vec3f>(level_data.aabb_min);
+	writer.write<Vec3f>(level_data.aabb_max);
+
+	writer.save(filename);
+}
+
+std::shared_ptr<LevelData> LevelDataFile::load(const std::string &filename)
+{
+	SceneDataFileReader reader(filename, level_data_file_magic, version);
+
+	std::shared_ptr<LevelData> level_data(new LevelData());
+
+	level_data->portals.resize(reader.read_count());
+	for (size_t i = 0; i < level_data->portals.size(); i++)
+	{
+		LevelDataPortal &portal = level_data->portals[i];
+		reader.read_array(portal.points);
+		portal.plane = reader.read<Vec4f>();
+		portal.front = reader.read<int>();
+		portal.back = reader.read<int>();
+	}
+
+	level_data->sectors.resize(reader.read_count());
+	for (size_t i = 0; i < level_data->sectors.size(); i++)
+	{
+		reader.read_array(level_data->sectors[i].portals);
+		reader.read_array(level_data->sectors[i].objects);
+		reader.read_array(level_data->sectors[i].lights);
+	}
+
+	level_data->objects.resize(reader.read_count());
+	for (size_t i = 0; i < level_data->objects.size(); i++)
+	{
+		LevelDataObject &object = level_data->objects[i];
+		object.model_filename = reader.read_string();
+		object.position = reader.read<Vec3f>();
+		object.orientation = reader.read<Quaternionf>();
+		object.scale = reader.read<Vec3f>();
+		object.level_set = reader.read<int>();
+	}
+
+	level_data->lights.resize(reader.read_count());
+	for (size_t i = 0; i < level_data->lights.size(); i++)
+	{
+		LevelDataLight &light = level_data->lights[i];
+		light.position = reader.read<Vec3f>();
+		light.orientation = reader.read<Quaternionf>();
+		light.color = reader.read<Vec3f>();
+		light.attenuation_start = reader.read<float>();
+		light.attenuation_end = reader.read<float>();
+		light.falloff = reader.read<float>();
+		light.hotspot = reader.read<float>();
+		light.casts_shadows = reader.read<unsigned char>() != 0;
+		light.level_set = reader.read<int>();
+	}
+
+	level_data->level_sets.resize(reader.read_count());
+	for (size_t i = 0; i < level_data->level_sets.size(); i++)
+		level_data->level_sets[i] = reader.read_string();
+
+	level_data->aabb_min = reader.read<Vec3f>();
+	level_data->aabb_max = reader.read<Vec3f>();
+
+	return level_data;
+}
+
+}
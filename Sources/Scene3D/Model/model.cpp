@@ -41,7 +41,7 @@ namespace clan
 
 
 Model::Model(GraphicContext &gc, ModelMaterialCache &texture_cache, ModelShaderCache &shader_cache, std::shared_ptr<ModelData> model_data, int model_index)
-: shader_cache(shader_cache), model_data(model_data), frame(-1), max_instances(0), model_index(model_index)
+: shader_cache(shader_cache), model_data(model_data), animation_sampler(model_data), frame(-1), max_instances(0), model_index(model_index)
 {
 /*
 	// Small hack until we support rendering unskinned meshes
@@ -62,6 +62,12 @@ Model::Model(GraphicContext &gc, ModelMaterialCache &texture_cache, ModelShaderC
 		}
 	}
 */
+	for (size_t i = 0; i < model_data->bones.size(); i++)
+	{
+		if (model_data->bones[i].billboarded)
+			billboarded_bones.push_back(i);
+	}
+
 	levels.push_back(std::shared_ptr<ModelLOD>(new ModelLOD(gc, model_index, model_data)));
 
 	for (size_t i = 0; i < model_data->textures.size(); i++)
@@ -111,11 +117,16 @@ int Model::get_vectors_per_instance() const
 }
 
 void Model::upload(InstancesBuffer &instances_buffer, const Mat4f &world_to_eye, const Mat4f &eye_to_projection)
+{
+	Vec4f *instance_data = instances_buffer.upload(model_index, get_instance_vectors_count());
+	upload(instance_data, 0, instances.size(), world_to_eye, eye_to_projection);
+}
+
+void Model::upload(Vec4f *instance_data, size_t begin, size_t end, const Mat4f &world_to_eye, const Mat4f &eye_to_projection)
 {
 	int vectors_per_instance = get_vectors_per_instance();
 
-	Vec4f *instance_data = instances_buffer.upload(model_index, get_instance_vectors_count());
-	for (size_t j = 0; j < instances.size(); j++)
+	for (size_t j = begin; j < end; j++)
 	{
 		Vec4f *vectors = instance_data + j * vectors_per_instance;
 
@@ -146,30 +157,23 @@ void Model::upload(InstancesBuffer &instances_buffer, const Mat4f &world_to_eye,
 
 		vectors[15] = Vec4f(instances_light_probe_color[j], 0.0f);
 
-		for (size_t i = 0; i < model_data->bones.size(); i++)
-		{
-			Vec3f position = model_data->bones[i].position.get_value(instances[j]->animation_index, instances[j]->animation_time);
-			Quaternionf orientation = model_data->bones[i].orientation.get_value(instances[j]->animation_index, instances[j]->animation_time);
-			Vec3f scale = model_data->bones[i].scale.get_value(instances[j]->animation_index, instances[j]->animation_time);
-
-			if (model_data->bones[i].billboarded)
-			{
-				// To do: optimize this away by feeding upload with the camera orientation and the instance orientation
-				Vec3f camera_pos, camera_scale;
-				Quaternionf camera_orientation;
+		animation_sampler.sample_bones(instances[j]->animation_index, instances[j]->animation_time, instances[j]->animation_cursors, vectors + instance_base_vectors);
 
-				Mat4f object_to_eye = world_to_eye * instances_object_to_world[j];
-				object_to_eye.decompose(camera_pos, camera_orientation, camera_scale);
+		for (size_t k = 0; k < billboarded_bones.size(); k++)
+		{
+			size_t i = billboarded_bones[k];
+			Vec3f position, scale;
+			Quaternionf orientation;
+			animation_sampler.sample_bone(instances[j]->animation_index, instances[j]->animation_time, i, position, orientation, scale);
 
-				orientation = Quaternionf::inverse(camera_orientation) * orientation;
-			}
+			// To do: optimize this away by feeding upload with the camera orientation and the instance orientation
+			Vec3f camera_pos, camera_scale;
+			Quaternionf camera_orientation;
 
-			/*
-			DualQuaternionf dual_quaternion(position, orientation);
+			Mat4f object_to_eye = world_to_eye * instances_object_to_world[j];
+			object_to_eye.decompose(camera_pos, camera_orientation, camera_scale);
 
-			vectors[instance_base_vectors + i * vectors_per_bone + 0] = Vec4f(dual_quaternion.first.x, dual_quaternion.first.y, dual_quaternion.first.z, dual_quaternion.first.w);
-			vectors[instance_base_vectors + i * vectors_per_bone + 1] = Vec4f(dual_quaternion.second.x, dual_quaternion.second.y, dual_quaternion.second.z, dual_quaternion.second.w);
-			*/
+			orientation = Quaternionf::inverse(camera_orientation) * orientation;
 
 			Mat4f transform = Mat4f::translate(position) * orientation.to_matrix() * Mat4f::scale(scale);
 			transform.transpose();
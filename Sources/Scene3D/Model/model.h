@@ -29,6 +29,7 @@
 #pragma once
 
 #include "API/Scene3D/ModelData/model_data.h"
+#include "API/Scene3D/ModelData/model_data_animation_sampler.h"
 #include "model_instance.h"
 
 namespace clan
@@ -48,13 +49,20 @@ public:
 	Model(GraphicContext &gc, ModelMaterialCache &texture_cache, ModelShaderCache &shader_cache, std::shared_ptr<ModelData> model_data, int model_index);
 	const std::vector<ModelDataLight> &get_lights();
 	const std::shared_ptr<ModelData> &get_model_data() const { return model_data; }
+	int get_model_index() const { return model_index; }
 
 	bool add_instance(int frame, const ModelInstance &instance, const Mat4f &object_to_world, const Vec3f &light_probe_color);
 
+	int get_instance_count() const { return instances.size(); }
 	int get_instance_vectors_count() const;
 	int get_vectors_per_instance() const;
 	void upload(InstancesBuffer &instances_buffer, const Mat4f &world_to_eye, const Mat4f &eye_to_projection);
 
+	/// \brief Writes the instance vectors of instances begin to end
+	///
+	/// Different ranges of the same frame can be written from different threads.
+	void upload(Vec4f *instance_data, size_t begin, size_t end, const Mat4f &world_to_eye, const Mat4f &eye_to_projection);
+
 	void visit(GraphicContext &gc, InstancesBuffer &instances_buffer, ModelMeshVisitor *visitor);
 
 	static const int vectors_per_bone = 3;
@@ -68,6 +76,9 @@ private:
 
 	std::vector<std::shared_ptr<ModelLOD> > levels;
 
+	ModelDataAnimationSampler animation_sampler;
+	std::vector<size_t> billboarded_bones;
+
 	int frame;
 	std::vector<const ModelInstance *> instances;
 	std::vector<Mat4f> instances_object_to_world;
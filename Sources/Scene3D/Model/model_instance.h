@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include "API/Scene3D/ModelData/model_data_animation_sampler.h"
+
 namespace clan
 {
 
@@ -47,7 +49,7 @@ class ModelInstance
 {
 public:
 	ModelInstance();
-	std::shared_ptr<Model> get_renderer() const { return renderer; }
+	const std::shared_ptr<Model> &get_renderer() const { return renderer; }
 	void set_renderer(std::shared_ptr<Model> renderer);
 	void play_animation(const std::string &name);
 	void update(float time_elapsed);
@@ -65,6 +67,9 @@ private:
 	std::vector<ModelReplacedMaterial> replaced_materials;
 	std::shared_ptr<Model> renderer;
 
+	// Written by Model::upload, which only sees the instance as const
+	mutable ModelDataAnimationCursors animation_cursors;
+
 	// To do: add selection id
 
 	friend class Model;
@@ -42,20 +42,27 @@ ModelLOD::ModelLOD(GraphicContext &gc, int model_index, std::shared_ptr<ModelDat
 	{
 		ModelMeshBuffers buffers;
 		buffers.primitives_array = PrimitivesArray(gc);
-		buffers.vertices = upload_vector(gc, buffers.primitives_array, 0, model_data->meshes[i].vertices);
-		buffers.normals = upload_vector(gc, buffers.primitives_array, 1, model_data->meshes[i].normals);
-		buffers.bitangents = upload_vector(gc, buffers.primitives_array, 2, model_data->meshes[i].bitangents);
-		buffers.tangents = upload_vector(gc, buffers.primitives_array, 3, model_data->meshes[i].tangents);
-		buffers.bone_weights = upload_vector(gc, buffers.primitives_array, 4, model_data->meshes[i].bone_weights, true);
-		buffers.bone_selectors = upload_vector(gc, buffers.primitives_array, 5, model_data->meshes[i].bone_selectors, false);
-		buffers.colors = upload_vector(gc, buffers.primitives_array, 6, model_data->meshes[i].colors, true);
-
-		for (size_t channel = 0; channel < model_data->meshes[i].channels.size(); channel++)
+		if (!model_data->meshes[i].stream.is_null())
 		{
-			buffers.channels.push_back(upload_vector(gc, buffers.primitives_array, 7 + channel, model_data->meshes[i].channels[channel]));
+			upload_stream(gc, buffers, model_data->meshes[i].stream);
+		}
+		else
+		{
+			buffers.vertices = upload_vector(gc, buffers.primitives_array, 0, model_data->meshes[i].vertices);
+			buffers.normals = upload_vector(gc, buffers.primitives_array, 1, model_data->meshes[i].normals);
+			buffers.bitangents = upload_vector(gc, buffers.primitives_array, 2, model_data->meshes[i].bitangents);
+			buffers.tangents = upload_vector(gc, buffers.primitives_array, 3, model_data->meshes[i].tangents);
+			buffers.bone_weights = upload_vector(gc, buffers.primitives_array, 4, model_data->meshes[i].bone_weights, true);
+			buffers.bone_selectors = upload_vector(gc, buffers.primitives_array, 5, model_data->meshes[i].bone_selectors, false);
+			buffers.colors = upload_vector(gc, buffers.primitives_array, 6, model_data->meshes[i].colors, true);
+
+			for (size_t channel = 0; channel < model_data->meshes[i].channels.size(); channel++)
+			{
+				buffers.channels.push_back(upload_vector(gc, buffers.primitives_array, 7 + channel, model_data->meshes[i].channels[channel]));
+			}
+
+			buffers.elements = ElementArrayVector<unsigned int>(gc, model_data->meshes[i].elements);
 		}
-
-		buffers.elements = ElementArrayVector<unsigned int>(gc, model_data->meshes[i].elements);
 
 		size_t num_materials = model_data->meshes[i].draw_ranges.size();
 		for (size_t j = 0; j < num_materials; j++)
@@ -81,6 +88,43 @@ ModelLOD::ModelLOD(GraphicContext &gc, int model_index, std::shared_ptr<ModelDat
 	}
 }
 
+void ModelLOD::upload_stream(GraphicContext &gc, ModelMeshBuffers &buffers, const ModelDataMeshStream &stream)
+{
+	if (stream.num_vertices > 0)
+	{
+		buffers.interleaved = VertexArrayBuffer(gc, stream.vertex_data, stream.num_vertices * stream.vertex_stride);
+		for (size_t attribute = 0; attribute < stream.attribute_offsets.size(); attribute++)
+		{
+			int offset = stream.attribute_offsets[attribute];
+			if (offset == -1)
+				continue;
+
+			switch (attribute)
+			{
+			case ModelDataMeshStream::attribute_vertices:
+			case ModelDataMeshStream::attribute_normals:
+			case ModelDataMeshStream::attribute_bitangents:
+			case ModelDataMeshStream::attribute_tangents:
+				buffers.primitives_array.set_attributes(attribute, buffers.interleaved, 3, type_float, offset, stream.vertex_stride, false);
+				break;
+			case ModelDataMeshStream::attribute_bone_weights:
+			case ModelDataMeshStream::attribute_colors:
+				buffers.primitives_array.set_attributes(attribute, buffers.interleaved, 4, type_unsigned_byte, offset, stream.vertex_stride, true);
+				break;
+			case ModelDataMeshStream::attribute_bone_selectors:
+				buffers.primitives_array.set_attributes(attribute, buffers.interleaved, 4, type_unsigned_byte, offset, stream.vertex_stride, false);
+				break;
+			default:
+				buffers.primitives_array.set_attributes(attribute, buffers.interleaved, 2, type_float, offset, stream.vertex_stride, false);
+				break;
+			}
+		}
+	}
+
+	if (stream.num_elements > 0)
+		buffers.elements = ElementArrayVector<unsigned int>(gc, const_cast<unsigned int *>(stream.element_data), stream.num_elements);
+}
+
 template<typename Type>
 VertexArrayVector<Type> ModelLOD::upload_vector(GraphicContext &gc, PrimitivesArray &primitives_array, int index, const std::vector<Type> &vec)
 {
@@ -34,6 +34,7 @@ namespace clan
 {
 
 class ModelData;
+class ModelDataMeshStream;
 
 class ModelLOD
 {
@@ -48,6 +49,8 @@ public:
 	ModelRenderCommandList early_z_commands;
 
 private:
+	void upload_stream(GraphicContext &gc, ModelMeshBuffers &buffers, const ModelDataMeshStream &stream);
+
 	template<typename Type>
 	VertexArrayVector<Type> upload_vector(GraphicContext &gc, PrimitivesArray &primitives_array, int index, const std::vector<Type> &vec);
 
@@ -59,6 +59,7 @@ public:
 	VertexArrayVector<Vec4ub> colors;
 	ElementArrayVector<unsigned int> elements;
 	std::vector<VertexArrayBuffer> channels;
+	VertexArrayBuffer interleaved;
 	std::vector<UniformVector<ModelMaterialUniforms> > uniforms;
 	PrimitivesArray primitives_array;
 };
@@ -0,0 +1,361 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Scene3D/precomp.h"
+#include "API/Scene3D/ModelData/model_data_animation_sampler.h"
+#include "API/Scene3D/ModelData/model_data.h"
+
+#ifndef DISABLE_SSE2
+#ifndef ARM_PLATFORM
+#include <emmintrin.h>
+#define CL_ANIMATION_SSE2
+#endif
+#endif // not DISABLE_SSE2
+
+namespace clan
+{
+
+/// \brief Interpolation inputs for four bones in structure of arrays form
+///
+/// Components 0-2 are the position, 3-6 the orientation (x, y, z, w) and 7-9 the scale.
+class ModelDataAnimationBoneLanes
+{
+public:
+	enum { position = 0, orientation = 3, scale = 7, num_components = 10 };
+
+	float a[num_components][4];
+	float b[num_components][4];
+	float t[num_components][4];
+
+	void clear(int lane)
+	{
+		for (int c = 0; c < num_components; c++)
+		{
+			a[c][lane] = 0.0f;
+			b[c][lane] = 0.0f;
+			t[c][lane] = 0.0f;
+		}
+	}
+
+	void set(int lane, int component, const Vec3f &value_a, const Vec3f &value_b, float mix)
+	{
+		a[component + 0][lane] = value_a.x;
+		a[component + 1][lane] = value_a.y;
+		a[component + 2][lane] = value_a.z;
+		b[component + 0][lane] = value_b.x;
+		b[component + 1][lane] = value_b.y;
+		b[component + 2][lane] = value_b.z;
+		for (int i = 0; i < 3; i++)
+			t[component + i][lane] = mix;
+	}
+
+	void set(int lane, int component, const Quaternionf &value_a, const Quaternionf &value_b, float mix)
+	{
+		const float xyzw_a[4] = { value_a.x, value_a.y, value_a.z, value_a.w };
+		const float xyzw_b[4] = { value_b.x, value_b.y, value_b.z, value_b.w };
+		set(lane, component, xyzw_a, xyzw_b, mix);
+	}
+
+	void set(int lane, int component, const float *xyzw_a, const float *xyzw_b, float mix)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			a[component + i][lane] = xyzw_a[i];
+			b[component + i][lane] = xyzw_b[i];
+			t[component + i][lane] = mix;
+		}
+	}
+
+	/// \brief Interpolated value of a component, as computed by compute_bones
+	float get(int lane, int component) const
+	{
+		return a[component][lane] * (1.0f - t[component][lane]) + b[component][lane] * t[component][lane];
+	}
+};
+
+template<typename Type>
+static void gather_track(ModelDataAnimationBoneLanes &lanes, int lane, int component, const ModelDataAnimationTimeline<Type> *timeline, int &cursor, float timestamp)
+{
+	if (timeline == 0 || timeline->values.empty())
+	{
+		lanes.set(lane, component, Type(), Type(), 0.0f);
+	}
+	else if (timeline->timestamps.empty())
+	{
+		lanes.set(lane, component, timeline->values[0], timeline->values[0], 0.0f);
+	}
+	else
+	{
+		int index = ModelDataCompressedTrack::find_key(&timeline->timestamps[0], (int)timeline->timestamps.size(), timestamp, cursor);
+		int index2 = min(index + 1, (int)timeline->timestamps.size() - 1);
+		cursor = index;
+
+		float start = timeline->timestamps[index];
+		float end = timeline->timestamps[index2];
+		float t = (start != end) ? clamp((timestamp - start) / (end - start), 0.0f, 1.0f) : 0.0f;
+		lanes.set(lane, component, timeline->values[index], timeline->values[index2], t);
+	}
+}
+
+static void gather_compressed_vec3(ModelDataAnimationBoneLanes &lanes, int lane, int component, const ModelDataCompressedAnimation *animation, int track_index, int &cursor, float timestamp)
+{
+	if (track_index == -1)
+	{
+		lanes.set(lane, component, Vec3f(), Vec3f(), 0.0f);
+	}
+	else
+	{
+		const ModelDataCompressedTrack &track = animation->tracks[track_index];
+		int index, index2;
+		float t = track.find_keys(timestamp, cursor, index, index2);
+		Vec3f a = track.get_vec3(index);
+		lanes.set(lane, component, a, (index2 != index) ? track.get_vec3(index2) : a, t);
+	}
+}
+
+static void gather_compressed_quaternion(ModelDataAnimationBoneLanes &lanes, int lane, int component, const ModelDataCompressedAnimation *animation, int track_index, int &cursor, float timestamp)
+{
+	if (track_index == -1)
+	{
+		lanes.set(lane, component, Quaternionf(), Quaternionf(), 0.0f);
+	}
+	else
+	{
+		const ModelDataCompressedTrack &track = animation->tracks[track_index];
+		int index, index2;
+		float t = track.find_keys(timestamp, cursor, index, index2);
+
+		float a[4], b[4];
+		track.get_quaternion(index, a);
+		if (index2 != index)
+			track.get_quaternion(index2, b);
+		else
+			std::memcpy(b, a, sizeof(a));
+
+		// The encoding picks the sign of each key, so interpolate along the shortest path
+		if (a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3] < 0.0f)
+		{
+			for (int i = 0; i < 4; i++)
+				b[i] = -b[i];
+		}
+		lanes.set(lane, component, a, b, t);
+	}
+}
+
+#ifdef CL_ANIMATION_SSE2
+
+static void compute_bones(const ModelDataAnimationBoneLanes &lanes, int count, Vec4f *out_vectors)
+{
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 two = _mm_set1_ps(2.0f);
+
+	// mix(a, b, t) = a * (1 - t) + b * t, as ModelDataAnimationTimeline does it
+	__m128 v[ModelDataAnimationBoneLanes::num_components];
+	for (int c = 0; c < ModelDataAnimationBoneLanes::num_components; c++)
+	{
+		__m128 t = _mm_loadu_ps(lanes.t[c]);
+		v[c] = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(lanes.a[c]), _mm_sub_ps(one, t)), _mm_mul_ps(_mm_loadu_ps(lanes.b[c]), t));
+	}
+
+	// Quaternionf::normalize
+	__m128 x = v[ModelDataAnimationBoneLanes::orientation + 0];
+	__m128 y = v[ModelDataAnimationBoneLanes::orientation + 1];
+	__m128 z = v[ModelDataAnimationBoneLanes::orientation + 2];
+	__m128 w = v[ModelDataAnimationBoneLanes::orientation + 3];
+	__m128 magnitude = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w)));
+	__m128 nonzero = _mm_cmpneq_ps(magnitude, _mm_setzero_ps());
+	x = _mm_and_ps(_mm_div_ps(x, magnitude), nonzero);
+	y = _mm_and_ps(_mm_div_ps(y, magnitude), nonzero);
+	z = _mm_and_ps(_mm_div_ps(z, magnitude), nonzero);
+	w = _mm_and_ps(_mm_div_ps(w, magnitude), nonzero);
+
+	// Quaternionf::to_matrix
+	__m128 x2 = _mm_mul_ps(two, x);
+	__m128 y2 = _mm_mul_ps(two, y);
+	__m128 z2 = _mm_mul_ps(two, z);
+	__m128 w2 = _mm_mul_ps(two, w);
+	__m128 rows[3][3] =
+	{
+		{
+			_mm_sub_ps(_mm_sub_ps(one, _mm_mul_ps(y2, y)), _mm_mul_ps(z2, z)),
+			_mm_sub_ps(_mm_mul_ps(x2, y), _mm_mul_ps(w2, z)),
+			_mm_add_ps(_mm_mul_ps(x2, z), _mm_mul_ps(w2, y))
+		},
+		{
+			_mm_add_ps(_mm_mul_ps(x2, y), _mm_mul_ps(w2, z)),
+			_mm_sub_ps(_mm_sub_ps(one, _mm_mul_ps(x2, x)), _mm_mul_ps(z2, z)),
+			_mm_sub_ps(_mm_mul_ps(y2, z), _mm_mul_ps(w2, x))
+		},
+		{
+			_mm_sub_ps(_mm_mul_ps(x2, z), _mm_mul_ps(w2, y)),
+			_mm_add_ps(_mm_mul_ps(y2, z), _mm_mul_ps(w2, x)),
+			_mm_sub_ps(_mm_sub_ps(one, _mm_mul_ps(x2, x)), _mm_mul_ps(y2, y))
+		}
+	};
+
+	for (int row = 0; row < 3; row++)
+	{
+		__m128 c0 = _mm_mul_ps(rows[row][0], v[ModelDataAnimationBoneLanes::scale + 0]);
+		__m128 c1 = _mm_mul_ps(rows[row][1], v[ModelDataAnimationBoneLanes::scale + 1]);
+		__m128 c2 = _mm_mul_ps(rows[row][2], v[ModelDataAnimationBoneLanes::scale + 2]);
+		__m128 c3 = v[ModelDataAnimationBoneLanes::position + row];
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+		__m128 bone_rows[4] = { c0, c1, c2, c3 };
+		for (int lane = 0; lane < count; lane++)
+			_mm_storeu_ps(&out_vectors[lane * ModelDataAnimationSampler::vectors_per_bone + row].x, bone_rows[lane]);
+	}
+}
+
+#else
+
+static void compute_bones(const ModelDataAnimationBoneLanes &lanes, int count, Vec4f *out_vectors)
+{
+	for (int lane = 0; lane < count; lane++)
+	{
+		float v[ModelDataAnimationBoneLanes::num_components];
+		for (int c = 0; c < ModelDataAnimationBoneLanes::num_components; c++)
+			v[c] = lanes.a[c][lane] * (1.0f - lanes.t[c][lane]) + lanes.b[c][lane] * lanes.t[c][lane];
+
+		Quaternionf orientation(v[ModelDataAnimationBoneLanes::orientation + 3], v[ModelDataAnimationBoneLanes::orientation + 0], v[ModelDataAnimationBoneLanes::orientation + 1], v[ModelDataAnimationBoneLanes::orientation + 2]);
+		Vec3f scale(v[ModelDataAnimationBoneLanes::scale + 0], v[ModelDataAnimationBoneLanes::scale + 1], v[ModelDataAnimationBoneLanes::scale + 2]);
+		orientation.normalize();
+
+		Mat4f rotation = orientation.to_matrix();
+		for (int row = 0; row < 3; row++)
+			out_vectors[lane * ModelDataAnimationSampler::vectors_per_bone + row] = Vec4f(rotation[row] * scale.x, rotation[4 + row] * scale.y, rotation[8 + row] * scale.z, v[ModelDataAnimationBoneLanes::position + row]);
+	}
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+
+ModelDataAnimationSampler::ModelDataAnimationSampler()
+: compressed(0), num_bones(0), num_animations(0)
+{
+}
+
+ModelDataAnimationSampler::ModelDataAnimationSampler(const std::shared_ptr<ModelData> &model_data)
+: model_data(model_data), compressed(model_data->compressed_animation.get()), num_bones((int)model_data->bones.size()), num_animations(max((int)model_data->animations.size(), 1))
+{
+	if (compressed)
+	{
+		num_bones = compressed->num_bones;
+		num_animations = compressed->num_animations;
+		return;
+	}
+
+	for (int bone = 0; bone < num_bones; bone++)
+	{
+		num_animations = max(num_animations, (int)model_data->bones[bone].position.timelines.size());
+		num_animations = max(num_animations, (int)model_data->bones[bone].orientation.timelines.size());
+		num_animations = max(num_animations, (int)model_data->bones[bone].scale.timelines.size());
+	}
+
+	tracks.resize(num_animations * num_bones);
+	for (int animation = 0; animation < num_animations; animation++)
+	{
+		for (int bone = 0; bone < num_bones; bone++)
+		{
+			BoneTracks &bone_tracks = tracks[animation * num_bones + bone];
+			bone_tracks.position = find_timeline(model_data->bones[bone].position, animation);
+			bone_tracks.orientation = find_timeline(model_data->bones[bone].orientation, animation);
+			bone_tracks.scale = find_timeline(model_data->bones[bone].scale, animation);
+		}
+	}
+}
+
+template<typename Type>
+const ModelDataAnimationTimeline<Type> *ModelDataAnimationSampler::find_timeline(const ModelDataAnimationData<Type> &data, int animation_index)
+{
+	// Same timeline selection as ModelDataAnimationData::get_value
+	if (data.timelines.empty())
+		return 0;
+	return &data.timelines[min(animation_index, (int)data.timelines.size() - 1)];
+}
+
+void ModelDataAnimationSampler::sample_bones(int animation_index, float timestamp, ModelDataAnimationCursors &cursors, Vec4f *out_vectors) const
+{
+	if (num_bones == 0)
+		return;
+
+	animation_index = clamp(animation_index, 0, num_animations - 1);
+	if (cursors.animation_index != animation_index || cursors.keys.size() != (size_t)num_bones * 3)
+	{
+		cursors.animation_index = animation_index;
+		cursors.keys.assign(num_bones * 3, 0);
+	}
+
+	int *keys = &cursors.keys[0];
+
+	ModelDataAnimationBoneLanes lanes;
+	for (int bone = 0; bone < num_bones; bone += 4)
+	{
+		int count = min(num_bones - bone, 4);
+		for (int lane = 0; lane < count; lane++)
+			gather_bone(lanes, lane, animation_index, bone + lane, keys + (bone + lane) * 3, timestamp);
+		for (int lane = count; lane < 4; lane++)
+			lanes.clear(lane);
+
+		compute_bones(lanes, count, out_vectors + bone * vectors_per_bone);
+	}
+}
+
+void ModelDataAnimationSampler::sample_bone(int animation_index, float timestamp, int bone, Vec3f &out_position, Quaternionf &out_orientation, Vec3f &out_scale) const
+{
+	animation_index = clamp(animation_index, 0, num_animations - 1);
+
+	int keys[3] = { 0, 0, 0 };
+	ModelDataAnimationBoneLanes lanes;
+	gather_bone(lanes, 0, animation_index, bone, keys, timestamp);
+
+	out_position = Vec3f(lanes.get(0, ModelDataAnimationBoneLanes::position + 0), lanes.get(0, ModelDataAnimationBoneLanes::position + 1), lanes.get(0, ModelDataAnimationBoneLanes::position + 2));
+	out_orientation = Quaternionf(lanes.get(0, ModelDataAnimationBoneLanes::orientation + 3), lanes.get(0, ModelDataAnimationBoneLanes::orientation + 0), lanes.get(0, ModelDataAnimationBoneLanes::orientation + 1), lanes.get(0, ModelDataAnimationBoneLanes::orientation + 2));
+	out_orientation.normalize();
+	out_scale = Vec3f(lanes.get(0, ModelDataAnimationBoneLanes::scale + 0), lanes.get(0, ModelDataAnimationBoneLanes::scale + 1), lanes.get(0, ModelDataAnimationBoneLanes::scale + 2));
+}
+
+void ModelDataAnimationSampler::gather_bone(ModelDataAnimationBoneLanes &lanes, int lane, int animation_index, int bone, int *keys, float timestamp) const
+{
+	if (compressed)
+	{
+		gather_compressed_vec3(lanes, lane, ModelDataAnimationBoneLanes::position, compressed, compressed->get_track_index(animation_index, bone, ModelDataCompressedAnimation::track_position), keys[0], timestamp);
+		gather_compressed_quaternion(lanes, lane, ModelDataAnimationBoneLanes::orientation, compressed, compressed->get_track_index(animation_index, bone, ModelDataCompressedAnimation::track_orientation), keys[1], timestamp);
+		gather_compressed_vec3(lanes, lane, ModelDataAnimationBoneLanes::scale, compressed, compressed->get_track_index(animation_index, bone, ModelDataCompressedAnimation::track_scale), keys[2], timestamp);
+	}
+	else
+	{
+		const BoneTracks &bone_tracks = tracks[animation_index * num_bones + bone];
+		gather_track(lanes, lane, ModelDataAnimationBoneLanes::position, bone_tracks.position, keys[0], timestamp);
+		gather_track(lanes, lane, ModelDataAnimationBoneLanes::orientation, bone_tracks.orientation, keys[1], timestamp);
+		gather_track(lanes, lane, ModelDataAnimationBoneLanes::scale, bone_tracks.scale, keys[2], timestamp);
+	}
+}
+
+}
@@ -0,0 +1,398 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Scene3D/precomp.h"
+#include "API/Scene3D/ModelData/model_data_compressed_animation.h"
+#include "API/Scene3D/ModelData/model_data.h"
+
+namespace clan
+{
+
+/// \brief Compresses a single keyframe track
+///
+/// Values are handled as Vec4f. Vec3f tracks leave w unused and quaternions are stored as x, y, z, w.
+class ModelDataTrackCompressor
+{
+public:
+	ModelDataTrackCompressor(const std::vector<float> &timestamps, const std::vector<Vec4f> &values, bool quaternion, float max_error)
+	: timestamps(timestamps), values(values), quaternion(quaternion), max_error(max_error)
+	{
+		if (quaternion)
+		{
+			for (size_t i = 0; i < this->values.size(); i++)
+				this->values[i] = normalize(this->values[i]);
+		}
+		else
+		{
+			range_min = Vec3f(values[0]);
+			Vec3f range_max = range_min;
+			for (size_t i = 1; i < values.size(); i++)
+			{
+				range_min = Vec3f(min(range_min.x, values[i].x), min(range_min.y, values[i].y), min(range_min.z, values[i].z));
+				range_max = Vec3f(max(range_max.x, values[i].x), max(range_max.y, values[i].y), max(range_max.z, values[i].z));
+			}
+			range_extent = range_max - range_min;
+		}
+	}
+
+	ModelDataCompressedTrack compress()
+	{
+		ModelDataCompressedTrack best = create_constant();
+		if (timestamps.size() <= 1 || is_within_error(best))
+			return best;
+
+		best = create_reduced();
+
+		// Uniform tracks are resampled at multiples of the median key interval
+		std::vector<float> intervals;
+		for (size_t i = 1; i < timestamps.size(); i++)
+			intervals.push_back(timestamps[i] - timestamps[i - 1]);
+		std::nth_element(intervals.begin(), intervals.begin() + intervals.size() / 2, intervals.end());
+		float base_interval = intervals[intervals.size() / 2];
+
+		if (base_interval > 0.0f)
+		{
+			const int steps[] = { 1, 2, 3, 4, 6, 8, 12, 16 };
+			for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++)
+			{
+				ModelDataCompressedTrack uniform = create_uniform(base_interval * steps[i]);
+				if (uniform.num_keys > 1 && get_track_size(uniform) < get_track_size(best) && is_within_error(uniform))
+					best = uniform;
+			}
+		}
+
+		return best;
+	}
+
+	static size_t get_track_size(const ModelDataCompressedTrack &track)
+	{
+		return track.timestamps.size() * sizeof(float) + track.values.size() * sizeof(unsigned short);
+	}
+
+private:
+	ModelDataCompressedTrack create_constant()
+	{
+		ModelDataCompressedTrack track = create_track();
+		add_key(track, values[0]);
+		return track;
+	}
+
+	// Greedy keyframe reduction: each segment is extended while the keys it skips stay within the error bound
+	ModelDataCompressedTrack create_reduced()
+	{
+		ModelDataCompressedTrack track = create_track();
+		size_t num_keys = timestamps.size();
+
+		size_t anchor = 0;
+		add_key(track, values[anchor], timestamps[anchor]);
+		while (anchor + 1 < num_keys)
+		{
+			Vec4f anchor_value = decode(encode(values[anchor]));
+			size_t end = anchor + 1;
+			while (end + 1 < num_keys && is_segment_within_error(anchor, end + 1, anchor_value))
+				end++;
+			add_key(track, values[end], timestamps[end]);
+			anchor = end;
+		}
+		return track;
+	}
+
+	ModelDataCompressedTrack create_uniform(float interval)
+	{
+		ModelDataCompressedTrack track = create_track();
+		float start = timestamps.front();
+		float length = timestamps.back() - start;
+		int num_keys = (int)std::ceil(length / interval - 0.001f) + 1;
+
+		track.start_time = start;
+		track.sample_rate = 1.0f / interval;
+		for (int i = 0; i < num_keys; i++)
+			add_key(track, evaluate(start + i * interval));
+		return track;
+	}
+
+	bool is_segment_within_error(size_t begin, size_t end, const Vec4f &begin_value)
+	{
+		Vec4f end_value = decode(encode(values[end]));
+		float start = timestamps[begin];
+		float duration = timestamps[end] - start;
+		for (size_t i = begin + 1; i < end; i++)
+		{
+			float t = (duration > 0.0f) ? (timestamps[i] - start) / duration : 0.0f;
+			if (get_error(interpolate(begin_value, end_value, t), values[i]) > max_error)
+				return false;
+		}
+		return true;
+	}
+
+	bool is_within_error(const ModelDataCompressedTrack &track)
+	{
+		int cursor = 0;
+		for (size_t i = 0; i < timestamps.size(); i++)
+		{
+			int index, index2;
+			float t = track.find_keys(timestamps[i], cursor, index, index2);
+			Vec4f value = interpolate(get_key(track, index), get_key(track, index2), t);
+			if (get_error(value, values[i]) > max_error)
+				return false;
+		}
+		return true;
+	}
+
+	ModelDataCompressedTrack create_track() const
+	{
+		ModelDataCompressedTrack track;
+		track.range_min = range_min;
+		track.range_extent = range_extent;
+		return track;
+	}
+
+	void add_key(ModelDataCompressedTrack &track, const Vec4f &value)
+	{
+		Vec3us words = encode(value);
+		track.values.push_back(words.x);
+		track.values.push_back(words.y);
+		track.values.push_back(words.z);
+		track.num_keys++;
+	}
+
+	void add_key(ModelDataCompressedTrack &track, const Vec4f &value, float timestamp)
+	{
+		add_key(track, value);
+		track.timestamps.push_back(timestamp);
+	}
+
+	Vec4f get_key(const ModelDataCompressedTrack &track, int key) const
+	{
+		if (quaternion)
+		{
+			Vec4f value;
+			track.get_quaternion(key, &value.x);
+			return value;
+		}
+		else
+		{
+			return Vec4f(track.get_vec3(key), 0.0f);
+		}
+	}
+
+	// Value of the source track, interpolated the same way as ModelDataAnimationTimeline::get_value
+	Vec4f evaluate(float timestamp) const
+	{
+		int index = ModelDataCompressedTrack::find_key(&timestamps[0], (int)timestamps.size(), timestamp, 0);
+		int index2 = min(index + 1, (int)timestamps.size() - 1);
+		float start = timestamps[index];
+		float end = timestamps[index2];
+		float t = (start != end) ? clamp((timestamp - start) / (end - start), 0.0f, 1.0f) : 0.0f;
+		Vec4f value = values[index] * (1.0f - t) + values[index2] * t;
+		return quaternion ? normalize(value) : value;
+	}
+
+	// Interpolation used by ModelDataAnimationSampler for compressed tracks
+	Vec4f interpolate(const Vec4f &a, Vec4f b, float t) const
+	{
+		if (quaternion)
+		{
+			if (Vec4f::dot4(a, b) < 0.0f)
+				b = -b;
+			return normalize(a * (1.0f - t) + b * t);
+		}
+		else
+		{
+			return a * (1.0f - t) + b * t;
+		}
+	}
+
+	float get_error(const Vec4f &value, Vec4f expected) const
+	{
+		if (quaternion && Vec4f::dot4(value, expected) < 0.0f)
+			expected = -expected;
+		Vec4f delta = value - expected;
+		return max(max(std::abs(delta.x), std::abs(delta.y)), max(std::abs(delta.z), std::abs(delta.w)));
+	}
+
+	Vec3us encode(const Vec4f &value) const
+	{
+		if (quaternion)
+		{
+			const float *c = &value.x;
+			int largest = 0;
+			for (int i = 1; i < 4; i++)
+			{
+				if (std::abs(c[i]) > std::abs(c[largest]))
+					largest = i;
+			}
+
+			// q and -q are the same rotation. Flip so the dropped component is positive.
+			float sign = (c[largest] < 0.0f) ? -1.0f : 1.0f;
+			unsigned short words[3];
+			int j = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				if (i != largest)
+				{
+					float normalized = clamp((c[i] * sign + 0.70710678f) / 1.41421356f, 0.0f, 1.0f);
+					words[j++] = (unsigned short)(normalized * 32767.0f + 0.5f);
+				}
+			}
+			words[0] |= (unsigned short)((largest >> 1) << 15);
+			words[1] |= (unsigned short)((largest & 1) << 15);
+			return Vec3us(words[0], words[1], words[2]);
+		}
+		else
+		{
+			return Vec3us(quantize(value.x, range_min.x, range_extent.x), quantize(value.y, range_min.y, range_extent.y), quantize(value.z, range_min.z, range_extent.z));
+		}
+	}
+
+	Vec4f decode(const Vec3us &words) const
+	{
+		ModelDataCompressedTrack track = create_track();
+		track.values.push_back(words.x);
+		track.values.push_back(words.y);
+		track.values.push_back(words.z);
+		return get_key(track, 0);
+	}
+
+	static unsigned short quantize(float value, float range_min, float range_extent)
+	{
+		if (range_extent <= 0.0f)
+			return 0;
+		return (unsigned short)(clamp((value - range_min) / range_extent, 0.0f, 1.0f) * 65535.0f + 0.5f);
+	}
+
+	static Vec4f normalize(const Vec4f &q)
+	{
+		float magnitude = std::sqrt(Vec4f::dot4(q, q));
+		return (magnitude != 0.0f) ? q / magnitude : Vec4f(0.0f);
+	}
+
+	std::vector<float> timestamps;
+	std::vector<Vec4f> values;
+	bool quaternion;
+	float max_error;
+	Vec3f range_min;
+	Vec3f range_extent;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+static Vec4f to_vec4f(const Vec3f &value)
+{
+	return Vec4f(value, 0.0f);
+}
+
+static Vec4f to_vec4f(const Quaternionf &value)
+{
+	return Vec4f(value.x, value.y, value.z, value.w);
+}
+
+template<typename Type>
+static void add_tracks(ModelDataCompressedAnimation &animation, int bone, ModelDataCompressedAnimation::TrackType type, const ModelDataAnimationData<Type> &data, bool quaternion, float max_error)
+{
+	// One compressed track per timeline, shared by the animations that select the same timeline
+	std::vector<int> timeline_tracks;
+	for (size_t i = 0; i < data.timelines.size(); i++)
+	{
+		const ModelDataAnimationTimeline<Type> &timeline = data.timelines[i];
+		if (timeline.values.empty())
+		{
+			timeline_tracks.push_back(-1);
+			continue;
+		}
+
+		std::vector<float> timestamps = timeline.timestamps;
+		timestamps.resize(timeline.values.size(), timestamps.empty() ? 0.0f : timestamps.back());
+
+		std::vector<Vec4f> values;
+		values.reserve(timeline.values.size());
+		for (size_t j = 0; j < timeline.values.size(); j++)
+			values.push_back(to_vec4f(timeline.values[j]));
+
+		ModelDataTrackCompressor compressor(timestamps, values, quaternion, max_error);
+		timeline_tracks.push_back(animation.tracks.size());
+		animation.tracks.push_back(compressor.compress());
+	}
+
+	for (int animation_index = 0; animation_index < animation.num_animations; animation_index++)
+	{
+		int track_index = -1;
+		if (!timeline_tracks.empty())
+			track_index = timeline_tracks[min(animation_index, (int)timeline_tracks.size() - 1)];
+		animation.track_indices[(animation_index * animation.num_bones + bone) * ModelDataCompressedAnimation::num_track_types + type] = track_index;
+	}
+}
+
+template<typename Type>
+static size_t get_timelines_memory_usage(const ModelDataAnimationData<Type> &data)
+{
+	size_t size = data.timelines.size() * sizeof(ModelDataAnimationTimeline<Type>);
+	for (size_t i = 0; i < data.timelines.size(); i++)
+		size += data.timelines[i].timestamps.size() * sizeof(float) + data.timelines[i].values.size() * sizeof(Type);
+	return size;
+}
+
+std::shared_ptr<ModelDataCompressedAnimation> ModelDataCompressedAnimation::compress(const ModelData &model_data, const ModelDataAnimationCompression &settings)
+{
+	std::shared_ptr<ModelDataCompressedAnimation> animation(new ModelDataCompressedAnimation());
+	animation->num_bones = model_data.bones.size();
+	animation->num_animations = max((int)model_data.animations.size(), 1);
+	for (size_t i = 0; i < model_data.bones.size(); i++)
+	{
+		animation->num_animations = max(animation->num_animations, (int)model_data.bones[i].position.timelines.size());
+		animation->num_animations = max(animation->num_animations, (int)model_data.bones[i].orientation.timelines.size());
+		animation->num_animations = max(animation->num_animations, (int)model_data.bones[i].scale.timelines.size());
+	}
+
+	animation->track_indices.resize(animation->num_animations * animation->num_bones * num_track_types, -1);
+	for (int bone = 0; bone < animation->num_bones; bone++)
+	{
+		add_tracks(*animation, bone, track_position, model_data.bones[bone].position, false, settings.max_position_error);
+		add_tracks(*animation, bone, track_orientation, model_data.bones[bone].orientation, true, settings.max_orientation_error);
+		add_tracks(*animation, bone, track_scale, model_data.bones[bone].scale, false, settings.max_scale_error);
+	}
+	return animation;
+}
+
+size_t ModelDataCompressedAnimation::get_memory_usage() const
+{
+	size_t size = sizeof(ModelDataCompressedAnimation) + track_indices.size() * sizeof(int);
+	for (size_t i = 0; i < tracks.size(); i++)
+		size += sizeof(ModelDataCompressedTrack) + ModelDataTrackCompressor::get_track_size(tracks[i]);
+	return size;
+}
+
+size_t ModelDataCompressedAnimation::get_uncompressed_memory_usage(const ModelData &model_data)
+{
+	size_t size = 0;
+	for (size_t i = 0; i < model_data.bones.size(); i++)
+		size += get_timelines_memory_usage(model_data.bones[i].position) + get_timelines_memory_usage(model_data.bones[i].orientation) + get_timelines_memory_usage(model_data.bones[i].scale);
+	return size;
+}
+
+}
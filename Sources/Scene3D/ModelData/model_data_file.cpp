@@ -0,0 +1,486 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Scene3D/precomp.h"
+#include "API/Scene3D/ModelData/model_data_file.h"
+#include "API/Scene3D/ModelData/model_data.h"
+#include "Scene3D/Resources/scene_data_file_format.h"
+
+namespace clan
+{
+
+static const char model_data_file_magic[4] = { 'C', 'L', 'M', 'D' };
+
+template<typename Type>
+static void write_animation_data(SceneDataFileWriter &writer, const ModelDataAnimationData<Type> &data)
+{
+	writer.write<ubyte32>(data.timelines.size());
+	for (size_t i = 0; i < data.timelines.size(); i++)
+	{
+		writer.write_array(data.timelines[i].timestamps);
+		writer.write_array(data.timelines[i].values);
+	}
+}
+
+template<typename Type>
+static void read_animation_data(SceneDataFileReader &reader, ModelDataAnimationData<Type> &data)
+{
+	data.timelines.resize(reader.read_count());
+	for (size_t i = 0; i < data.timelines.size(); i++)
+	{
+		reader.read_array(data.timelines[i].timestamps);
+		reader.read_array(data.timelines[i].values);
+		reader.check(data.timelines[i].timestamps.size() == data.timelines[i].values.size());
+	}
+}
+
+template<typename Type>
+static void interleave(unsigned char *dest, const ModelDataMeshStream &layout, int attribute, const std::vector<Type> &values)
+{
+	int offset = layout.attribute_offsets[attribute];
+	if (offset != -1)
+	{
+		for (size_t i = 0; i < values.size(); i++)
+			memcpy(dest + i * layout.vertex_stride + offset, &values[i], sizeof(Type));
+	}
+}
+
+static void add_attribute(ModelDataMeshStream &layout, int attribute, size_t count)
+{
+	if (count != 0)
+	{
+		if (count != (size_t)layout.num_vertices)
+			throw Exception("Mesh vertex attributes must all have the same length");
+		layout.attribute_offsets[attribute] = layout.vertex_stride;
+		layout.vertex_stride += ModelDataMeshStream::get_attribute_size(attribute);
+	}
+}
+
+static void write_texture_map(SceneDataFileWriter &writer, const ModelDataTextureMap &map)
+{
+	writer.write<int>(map.texture);
+	writer.write<int>(map.channel);
+	writer.write<int>(map.wrap_x);
+	writer.write<int>(map.wrap_y);
+	write_animation_data(writer, map.uvw_offset);
+	write_animation_data(writer, map.uvw_rotation);
+	write_animation_data(writer, map.uvw_scale);
+}
+
+static void read_texture_map(SceneDataFileReader &reader, ModelDataTextureMap &map)
+{
+	map.texture = reader.read<int>();
+	map.channel = reader.read<int>();
+	map.wrap_x = (ModelDataTextureMap::WrapMode)reader.read<int>();
+	map.wrap_y = (ModelDataTextureMap::WrapMode)reader.read<int>();
+	read_animation_data(reader, map.uvw_offset);
+	read_animation_data(reader, map.uvw_rotation);
+	read_animation_data(reader, map.uvw_scale);
+}
+
+static void write_draw_range(SceneDataFileWriter &writer, const ModelDataDrawRange &range)
+{
+	writer.write<int>(range.start_element);
+	writer.write<int>(range.num_elements);
+	writer.write<unsigned char>(range.two_sided);
+	writer.write<unsigned char>(range.transparent);
+	writer.write<unsigned char>(range.alpha_test);
+	write_animation_data(writer, range.ambient);
+	write_animation_data(writer, range.diffuse);
+	write_animation_data(writer, range.specular);
+	write_animation_data(writer, range.self_illumination_amount);
+	write_animation_data(writer, range.self_illumination);
+	write_animation_data(writer, range.glossiness);
+	write_animation_data(writer, range.specular_level);
+	write_texture_map(writer, range.diffuse_map);
+	write_texture_map(writer, range.specular_map);
+	write_texture_map(writer, range.bumpmap_map);
+	write_texture_map(writer, range.self_illumination_map);
+}
+
+static void read_draw_range(SceneDataFileReader &reader, ModelDataDrawRange &range)
+{
+	range.start_element = reader.read<int>();
+	range.num_elements = reader.read<int>();
+	range.two_sided = reader.read<unsigned char>() != 0;
+	range.transparent = reader.read<unsigned char>() != 0;
+	range.alpha_test = reader.read<unsigned char>() != 0;
+	read_animation_data(reader, range.ambient);
+	read_animation_data(reader, range.diffuse);
+	read_animation_data(reader, range.specular);
+	read_animation_data(reader, range.self_illumination_amount);
+	read_animation_data(reader, range.self_illumination);
+	read_animation_data(reader, range.glossiness);
+	read_animation_data(reader, range.specular_level);
+	read_texture_map(reader, range.diffuse_map);
+	read_texture_map(reader, range.specular_map);
+	read_texture_map(reader, range.bumpmap_map);
+	read_texture_map(reader, range.self_illumination_map);
+}
+
+static void write_mesh(SceneDataFileWriter &writer, const ModelDataMesh &mesh)
+{
+	ModelDataMeshStream layout;
+	if (!mesh.stream.is_null())
+	{
+		layout = mesh.stream;
+	}
+	else
+	{
+		layout.num_vertices = mesh.vertices.size();
+		layout.attribute_offsets.resize(ModelDataMeshStream::attribute_channels + mesh.channels.size(), -1);
+		add_attribute(layout, ModelDataMeshStream::attribute_vertices, mesh.vertices.size());
+		add_attribute(layout, ModelDataMeshStream::attribute_normals, mesh.normals.size());
+		add_attribute(layout, ModelDataMeshStream::attribute_bitangents, mesh.bitangents.size());
+		add_attribute(layout, ModelDataMeshStream::attribute_tangents, mesh.tangents.size());
+		add_attribute(layout, ModelDataMeshStream::attribute_bone_weights, mesh.bone_weights.size());
+		add_attribute(layout, ModelDataMeshStream::attribute_bone_selectors, mesh.bone_selectors.size());
+		add_attribute(layout, ModelDataMeshStream::attribute_colors, mesh.colors.size());
+		for (size_t channel = 0; channel < mesh.channels.size(); channel++)
+			add_attribute(layout, ModelDataMeshStream::attribute_channels + channel, mesh.channels[channel].size());
+	}
+
+	writer.write<int>(layout.num_vertices);
+	writer.write<int>(layout.vertex_stride);
+	writer.write<ubyte32>(layout.attribute_offsets.size());
+	for (size_t i = 0; i < layout.attribute_offsets.size(); i++)
+		writer.write<int>(layout.attribute_offsets[i]);
+
+	size_t vertex_data_offset = writer.reserve_array((size_t)layout.num_vertices * layout.vertex_stride, 1);
+	unsigned char *vertex_data = writer.get_data(vertex_data_offset);
+	if (!mesh.stream.is_null())
+	{
+		memcpy(vertex_data, mesh.stream.vertex_data, (size_t)layout.num_vertices * layout.vertex_stride);
+		writer.write_array(mesh.stream.element_data, mesh.stream.num_elements, sizeof(unsigned int));
+	}
+	else
+	{
+		interleave(vertex_data, layout, ModelDataMeshStream::attribute_vertices, mesh.vertices);
+		interleave(vertex_data, layout, ModelDataMeshStream::attribute_normals, mesh.normals);
+		interleave(vertex_data, layout, ModelDataMeshStream::attribute_bitangents, mesh.bitangents);
+		interleave(vertex_data, layout, ModelDataMeshStream::attribute_tangents, mesh.tangents);
+		interleave(vertex_data, layout, ModelDataMeshStream::attribute_bone_weights, mesh.bone_weights);
+		interleave(vertex_data, layout, ModelDataMeshStream::attribute_bone_selectors, mesh.bone_selectors);
+		interleave(vertex_data, layout, ModelDataMeshStream::attribute_colors, mesh.colors);
+		for (size_t channel = 0; channel < mesh.channels.size(); channel++)
+			interleave(vertex_data, layout, ModelDataMeshStream::attribute_channels + channel, mesh.channels[channel]);
+		writer.write_array(mesh.elements);
+	}
+
+	writer.write<ubyte32>(mesh.draw_ranges.size());
+	for (size_t i = 0; i < mesh.draw_ranges.size(); i++)
+		write_draw_range(writer, mesh.draw_ranges[i]);
+}
+
+static void read_mesh(SceneDataFileReader &reader, ModelDataMesh &mesh)
+{
+	ModelDataMeshStream &stream = mesh.stream;
+	stream.num_vertices = reader.read<int>();
+	stream.vertex_stride = reader.read<int>();
+	reader.check(stream.num_vertices >= 0 && stream.vertex_stride >= 0);
+
+	stream.attribute_offsets.resize(reader.read_count());
+	for (size_t i = 0; i < stream.attribute_offsets.size(); i++)
+	{
+		int offset = reader.read<int>();
+		reader.check(offset == -1 || (offset >= 0 && offset + ModelDataMeshStream::get_attribute_size(i) <= stream.vertex_stride));
+		stream.attribute_offsets[i] = offset;
+	}
+
+	size_t vertex_data_size = 0;
+	size_t num_elements = 0;
+	stream.vertex_data = reader.read_pointer<unsigned char>(vertex_data_size);
+	stream.element_data = reader.read_pointer<unsigned int>(num_elements);
+	stream.num_elements = num_elements;
+	reader.check(vertex_data_size == (size_t)stream.num_vertices * stream.vertex_stride);
+
+	mesh.draw_ranges.resize(reader.read_count());
+	for (size_t i = 0; i < mesh.draw_ranges.size(); i++)
+	{
+		read_draw_range(reader, mesh.draw_ranges[i]);
+		reader.check(mesh.draw_ranges[i].start_element >= 0 && mesh.draw_ranges[i].num_elements >= 0 && (size_t)mesh.draw_ranges[i].start_element + mesh.draw_ranges[i].num_elements <= num_elements);
+	}
+}
+
+static void write_compressed_animation(SceneDataFileWriter &writer, const ModelDataCompressedAnimation &animation)
+{
+	writer.write<int>(animation.num_animations);
+	writer.write<int>(animation.num_bones);
+	writer.write_array(animation.track_indices);
+
+	writer.write<ubyte32>(animation.tracks.size());
+	for (size_t i = 0; i < animation.tracks.size(); i++)
+	{
+		const ModelDataCompressedTrack &track = animation.tracks[i];
+		writer.write<int>(track.num_keys);
+		writer.write<float>(track.start_time);
+		writer.write<float>(track.sample_rate);
+		writer.write<Vec3f>(track.range_min);
+		writer.write<Vec3f>(track.range_extent);
+		writer.write_array(track.timestamps);
+		writer.write_array(track.values);
+	}
+}
+
+static void read_compressed_animation(SceneDataFileReader &reader, ModelDataCompressedAnimation &animation)
+{
+	animation.num_animations = reader.read<int>();
+	animation.num_bones = reader.read<int>();
+	reader.read_array(animation.track_indices);
+
+	animation.tracks.resize(reader.read_count());
+	for (size_t i = 0; i < animation.tracks.size(); i++)
+	{
+		ModelDataCompressedTrack &track = animation.tracks[i];
+		track.num_keys = reader.read<int>();
+		track.start_time = reader.read<float>();
+		track.sample_rate = reader.read<float>();
+		track.range_min = reader.read<Vec3f>();
+		track.range_extent = reader.read<Vec3f>();
+		reader.read_array(track.timestamps);
+		reader.read_array(track.values);
+		reader.check(track.num_keys >= 0 && track.values.size() == (size_t)track.num_keys * 3 && (track.num_keys <= 1 || track.is_uniform() || track.timestamps.size() == (size_t)track.num_keys));
+	}
+
+	reader.check(animation.num_animations >= 0 && animation.num_bones >= 0);
+	reader.check(animation.track_indices.size() == (size_t)animation.num_animations * animation.num_bones * ModelDataCompressedAnimation::num_track_types);
+	for (size_t i = 0; i < animation.track_indices.size(); i++)
+		reader.check(animation.track_indices[i] == -1 || (animation.track_indices[i] >= 0 && (size_t)animation.track_indices[i] < animation.tracks.size()));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// ModelDataFile operations:
+
+void ModelDataFile::save(const std::string &filename, const ModelData &model_data)
+{
+	SceneDataFileWriter writer(model_data_file_magic, version);
+
+	writer.write<ubyte32>(model_data.meshes.size());
+	for (size_t i = 0; i < model_data.meshes.size(); i++)
+		write_mesh(writer, model_data.meshes[i]);
+
+	writer.write<ubyte32>(model_data.textures.size());
+	for (size_t i = 0; i < model_data.textures.size(); i++)
+	{
+		writer.write_string(model_data.textures[i].name);
+		writer.write<float>(model_data.textures[i].gamma);
+	}
+
+	writer.write<ubyte32>(model_data.bones.size());
+	for (size_t i = 0; i < model_data.bones.size(); i++)
+	{
+		const ModelDataBone &bone = model_data.bones[i];
+		writer.write<unsigned char>(bone.billboarded);
+		writer.write<short>(bone.parent_bone);
+		write_animation_data(writer, bone.position);
+		write_animation_data(writer, bone.orientation);
+		write_animation_data(writer, bone.scale);
+		writer.write<Vec3f>(bone.pivot);
+	}
+
+	writer.write<ubyte32>(model_data.lights.size());
+	for (size_t i = 0; i < model_data.lights.size(); i++)
+	{
+		const ModelDataLight &light = model_data.lights[i];
+		write_animation_data(writer, light.position);
+		write_animation_data(writer, light.orientation);
+		write_animation_data(writer, light.color);
+		write_animation_data(writer, light.attenuation_start);
+		write_animation_data(writer, light.attenuation_end);
+		write_animation_data(writer, light.falloff);
+		write_animation_data(writer, light.hotspot);
+		write_animation_data(writer, light.aspect);
+		write_animation_data(writer, light.ambient_illumination);
+		writer.write<int>(light.bone_selector);
+		writer.write<unsigned char>(light.casts_shadows);
+		writer.write<unsigned char>(light.rectangle);
+	}
+
+	writer.write<ubyte32>(model_data.cameras.size());
+	for (size_t i = 0; i < model_data.cameras.size(); i++)
+	{
+		write_animation_data(writer, model_data.cameras[i].position);
+		write_animation_data(writer, model_data.cameras[i].orientation);
+		writer.write<float>(model_data.cameras[i].fov_y);
+	}
+
+	writer.write<ubyte32>(model_data.attachment_points.size());
+	for (size_t i = 0; i < model_data.attachment_points.size(); i++)
+	{
+		const ModelDataAttachmentPoint &point = model_data.attachment_points[i];
+		writer.write_string(point.name);
+		writer.write<Vec3f>(point.position);
+		writer.write<Quaternionf>(point.orientation);
+		writer.write<int>(point.bone_selector);
+	}
+
+	writer.write<ubyte32>(model_data.particle_emitters.size());
+	for (size_t i = 0; i < model_data.particle_emitters.size(); i++)
+	{
+		const ModelDataParticleEmitter &emitter = model_data.particle_emitters[i];
+		writer.write<Vec3f>(emitter.position);
+		writer.write<int>(emitter.bone_selector);
+		writer.write<float>(emitter.size);
+		writer.write<float>(emitter.speed);
+		writer.write<float>(emitter.spread);
+		writer.write<float>(emitter.gravity);
+		writer.write<float>(emitter.longevity);
+		writer.write<float>(emitter.delay);
+		writer.write<Vec4f>(emitter.color);
+		writer.write_string(emitter.texture);
+	}
+
+	writer.write<ubyte32>(model_data.animations.size());
+	for (size_t i = 0; i < model_data.animations.size(); i++)
+	{
+		const ModelDataAnimation &animation = model_data.animations[i];
+		writer.write_string(animation.name);
+		writer.write<float>(animation.length);
+		writer.write<unsigned char>(animation.loop);
+		writer.write<float>(animation.playback_speed);
+		writer.write<float>(animation.moving_speed);
+		writer.write<unsigned short>(animation.rarity);
+	}
+
+	writer.write<Vec3f>(model_data.aabb_min);
+	writer.write<Vec3f>(model_data.aabb_max);
+
+	writer.write<unsigned char>(model_data.compressed_animation ? 1 : 0);
+	if (model_data.compressed_animation)
+		write_compressed_animation(writer, *model_data.compressed_animation);
+
+	writer.save(filename);
+}
+
+std::shared_ptr<ModelData> ModelDataFile::load(const std::string &filename)
+{
+	SceneDataFileReader reader(filename, model_data_file_magic, version);
+
+	std::shared_ptr<ModelData> model_data(new ModelData());
+	model_data->mapped_file = reader.get_mapped_file();
+
+	model_data->meshes.resize(reader.read_count());
+	for (size_t i = 0; i < model_data->meshes.size(); i++)
+		read_mesh(reader, model_data->meshes[i]);
+
+	model_data->textures.resize(reader.read_count());
+	for (size_t i = 0; i < model_data->textures.size(); i++)
+	{
+		model_data->textures[i].name = reader.read_string();
+		model_data->textures[i].gamma = reader.read<float>();
+	}
+
+	model_data->bones.resize(reader.read_count());
+	for (size_t i = 0; i < model_data->bones.size(); i++)
+	{
+		ModelDataBone &bone = model_data->bones[i];
+		bone.billboarded = reader.read<unsigned char>() != 0;
+		bone.parent_bone = reader.read<short>();
+		read_animation_data(reader, bone.position);
+		read_animation_data(reader, bone.orientation);
+		read_animation_data(reader, bone.scale);
+		bone.pivot = reader.read<Vec3f>();
+	}
+
+	model_data->lights.resize(reader.read_count());
+	for (size_t i = 0; i < model_data->lights.size(); i++)
+	{
+		ModelDataLight &light = model_data->lights[i];
+		read_animation_data(reader, light.position);
+		read_animation_data(reader, light.orientation);
+		read_animation_data(reader, light.color);
+		read_animation_data(reader, light.attenuation_start);
+		read_animation_data(reader, light.attenuation_end);
+		read_animation_data(reader, light.falloff);
+		read_animation_data(reader, light.hotspot);
+		read_animation_data(reader, light.aspect);
+		read_animation_data(reader, light.ambient_illumination);
+		light.bone_selector = reader.read<int>();
+		light.casts_shadows = reader.read<unsigned char>() != 0;
+		light.rectangle = reader.read<unsigned char>() != 0;
+	}
+
+	model_data->cameras.resize(reader.read_count());
+	for (size_t i = 0; i < model_data->cameras.size(); i++)
+	{
+		read_animation_data(reader, model_data->cameras[i].position);
+		read_animation_data(reader, model_data->cameras[i].orientation);
+		model_data->cameras[i].fov_y = reader.read<float>();
+	}
+
+	model_data->attachment_points.resize(reader.read_count());
+	for (size_t i = 0; i < model_data->attachment_points.size(); i++)
+	{
+		ModelDataAttachmentPoint &point = model_data->attachment_points[i];
+		point.name = reader.read_string();
+		point.position = reader.read<Vec3f>();
+		point.orientation = reader.read<Quaternionf>();
+		point.bone_selector = reader.read<int>();
+	}
+
+	model_data->particle_emitters.resize(reader.read_count());
+	for (size_t i = 0; i < model_data->particle_emitters.size(); i++)
+	{
+		ModelDataParticleEmitter &emitter = model_data->particle_emitters[i];
+		emitter.position = reader.read<Vec3f>();
+		emitter.bone_selector = reader.read<int>();
+		emitter.size = reader.read<float>();
+		emitter.speed = reader.read<float>();
+		emitter.spread = reader.read<float>();
+		emitter.gravity = reader.read<float>();
+		emitter.longevity = reader.read<float>();
+		emitter.delay = reader.read<float>();
+		emitter.color = reader.read<Vec4f>();
+		emitter.texture = reader.read_string();
+	}
+
+	model_data->animations.resize(reader.read_count());
+	for (size_t i = 0; i < model_data->animations.size(); i++)
+	{
+		ModelDataAnimation &animation = model_data->animations[i];
+		animation.name = reader.read_string();
+		animation.length = reader.read<float>();
+		animation.loop = reader.read<unsigned char>() != 0;
+		animation.playback_speed = reader.read<float>();
+		animation.moving_speed = reader.read<float>();
+		animation.rarity = reader.read<unsigned short>();
+	}
+
+	model_data->aabb_min = reader.read<Vec3f>();
+	model_data->aabb_max = reader.read<Vec3f>();
+
+	if (reader.read<unsigned char>() != 0)
+	{
+		model_data->compressed_animation = std::shared_ptr<ModelDataCompressedAnimation>(new ModelDataCompressedAnimation());
+		read_compressed_animation(reader, *model_data->compressed_animation);
+	}
+
+	return model_data;
+}
+
+}
@@ -77,8 +77,7 @@ void GBufferPass::run(GraphicContext &render_gc, Scene_Impl *scene)
 	gc.set_blend_state(early_z_blend_state);
 
 	Mat4f eye_to_projection = Mat4f::perspective(field_of_view.get(), viewport_size.width/(float)viewport_size.height, 0.1f, 1.e10f, handed_left, gc.get_clip_z_range());
-	Mat4f eye_to_cull_projection = Mat4f::perspective(field_of_view.get(), viewport_size.width/(float)viewport_size.height, 0.1f, 150.0f, handed_left, clip_negative_positive_w);
-	FrustumPlanes frustum(eye_to_cull_projection * world_to_eye.get());
+	FrustumPlanes frustum = scene->get_camera_cull_frustum();
 
 	render_list.clear();
 	scene->visit(gc, world_to_eye.get(), eye_to_projection, frustum, this);
@@ -74,8 +74,7 @@ void VSMShadowMapPass::find_lights(Scene_Impl *scene)
 	Size viewport_size = viewport->get_size();
 
 	Mat4f eye_to_projection = Mat4f::perspective(field_of_view.get(), viewport_size.width/(float)viewport_size.height, 0.1f, 1.e10f, handed_left, gc.get_clip_z_range());
-	Mat4f eye_to_cull_projection = Mat4f::perspective(field_of_view.get(), viewport_size.width/(float)viewport_size.height, 0.1f, 150.0f, handed_left, clip_negative_positive_w);
-	FrustumPlanes frustum(eye_to_cull_projection * world_to_eye.get());
+	FrustumPlanes frustum = scene->get_camera_cull_frustum();
 	scene->visit_lights(gc, world_to_eye.get(), eye_to_projection, frustum, this);
 }
 
@@ -86,8 +85,7 @@ void VSMShadowMapPass::light(GraphicContext &gc, const Mat4f &world_to_eye, cons
 	if (!light->vsm_data)
 		light->vsm_data.reset(new VSMShadowMapPassLightData(this, light));
 
-	Quaternionf inv_orientation = Quaternionf::inverse(light->orientation);
-	light->vsm_data->world_to_eye = inv_orientation.to_matrix() * Mat4f::translate(-light->position);
+	light->vsm_data->world_to_eye = get_world_to_eye(light);
 
 	if (light->type == SceneLight::type_spot)
 	{
@@ -106,7 +104,7 @@ void VSMShadowMapPass::light(GraphicContext &gc, const Mat4f &world_to_eye, cons
 	light->vsm_data->world_to_shadow_projection = light->vsm_data->eye_to_projection * light->vsm_data->world_to_eye;
 
 	// Only spot lights with shadow casting enabled uses shadow maps right now, so only generate for those
-	if (light->type == SceneLight::type_spot && light->shadow_caster)
+	if (is_shadow_map_light(light))
 	{
 		// skip shadow maps far away
 		//float dist = (world_to_eye * Vec4f(light->position, 1.0f)).length3() - light->attenuation_end;
@@ -117,6 +115,39 @@ void VSMShadowMapPass::light(GraphicContext &gc, const Mat4f &world_to_eye, cons
 	}
 }
 
+bool VSMShadowMapPass::is_shadow_map_light(const SceneLight_Impl *light)
+{
+	return light->type == SceneLight::type_spot && light->shadow_caster;
+}
+
+Mat4f VSMShadowMapPass::get_world_to_eye(const SceneLight_Impl *light)
+{
+	Quaternionf inv_orientation = Quaternionf::inverse(light->orientation);
+	return inv_orientation.to_matrix() * Mat4f::translate(-light->position);
+}
+
+FrustumPlanes VSMShadowMapPass::get_cull_frustum(const SceneLight_Impl *light)
+{
+	float field_of_view = light->falloff;
+	Mat4f eye_to_cull_projection = Mat4f::perspective(field_of_view, light->aspect_ratio, 0.1f, light->attenuation_end + 5.0f, handed_left, clip_negative_positive_w);
+	return FrustumPlanes(eye_to_cull_projection * get_world_to_eye(light));
+}
+
+void VSMShadowMapPass::get_frame_lights(const std::vector<SceneLight_Impl *> &visible_lights, std::vector<SceneLight_Impl *> &out_lights) const
+{
+	std::vector<SceneLight_Impl *> shadow_lights;
+	for (size_t i = 0; i < visible_lights.size(); i++)
+	{
+		if (is_shadow_map_light(visible_lights[i]))
+			shadow_lights.push_back(visible_lights[i]);
+	}
+
+	// Only a few shadow maps are rendered each frame, taking turns
+	out_lights.clear();
+	for (size_t j = 0; j < max_lights_per_frame && j < shadow_lights.size(); j++)
+		out_lights.push_back(shadow_lights[(round_robin + j) % shadow_lights.size()]);
+}
+
 void VSMShadowMapPass::assign_shadow_map_indexes()
 {
 	maps.start_frame();
@@ -130,26 +161,20 @@ void VSMShadowMapPass::render_maps(Scene_Impl *scene)
 	gc.set_depth_stencil_state(depth_stencil_state);
 	gc.set_blend_state(blend_state);
 
-	const size_t max_lights_per_frame = 4;
+	// Scene_Impl::prepare_views made the same selection at the start of the frame
+	get_frame_lights(lights, frame_lights);
 	round_robin += max_lights_per_frame;
 
-	blur_indexes.clear();
-	for (size_t j = 0; j < max_lights_per_frame && j < lights.size(); j++)
+	for (size_t i = 0; i < frame_lights.size(); i++)
 	{
-		size_t i = (round_robin + j) % lights.size();
-
-		if (lights[i]->vsm_data->shadow_map.get_index() != -1)
+		if (frame_lights[i]->vsm_data->shadow_map.get_index() != -1)
 		{
-			gc.set_frame_buffer(lights[i]->vsm_data->shadow_map.get_framebuffer());
-			gc.set_viewport(lights[i]->vsm_data->shadow_map.get_view().get_size());
+			gc.set_frame_buffer(frame_lights[i]->vsm_data->shadow_map.get_framebuffer());
+			gc.set_viewport(frame_lights[i]->vsm_data->shadow_map.get_view().get_size());
 			gc.clear_depth(1.0f);
 
-			float field_of_view = lights[i]->falloff;
-			Mat4f eye_to_cull_projection = Mat4f::perspective(field_of_view, lights[i]->aspect_ratio, 0.1f, lights[i]->attenuation_end + 5.0f, handed_left, clip_negative_positive_w);
-
-			FrustumPlanes frustum(eye_to_cull_projection * lights[i]->vsm_data->world_to_eye);
-			scene->visit(gc, lights[i]->vsm_data->world_to_eye, lights[i]->vsm_data->eye_to_projection, frustum, this);
-			blur_indexes.push_back(i);
+			FrustumPlanes frustum = get_cull_frustum(frame_lights[i]);
+			scene->visit(gc, frame_lights[i]->vsm_data->world_to_eye, frame_lights[i]->vsm_data->eye_to_projection, frustum, this);
 		}
 	}
 
@@ -176,13 +201,12 @@ void VSMShadowMapPass::render(GraphicContext &gc, ModelLOD *model_lod, int num_i
 
 void VSMShadowMapPass::blur_maps()
 {
-	for (size_t j = 0; j < blur_indexes.size(); j++)
+	for (size_t i = 0; i < frame_lights.size(); i++)
 	{
-		size_t i = blur_indexes[j];
-		if (lights[i]->vsm_data->shadow_map.get_index() != -1)
+		if (frame_lights[i]->vsm_data->shadow_map.get_index() != -1)
 		{
-			blur.input.set(lights[i]->vsm_data->shadow_map.get_view());
-			blur.output.set(lights[i]->vsm_data->shadow_map.get_framebuffer());
+			blur.input.set(frame_lights[i]->vsm_data->shadow_map.get_view());
+			blur.output.set(frame_lights[i]->vsm_data->shadow_map.get_framebuffer());
 			blur.blur(gc, tf_rg32f, 1.3f, 9);
 		}
 	}
@@ -45,6 +45,13 @@ public:
 	VSMShadowMapPass(GraphicContext &gc, ResourceContainer &inout);
 	void run(GraphicContext &gc, Scene_Impl *scene);
 
+	static bool is_shadow_map_light(const SceneLight_Impl *light);
+	static Mat4f get_world_to_eye(const SceneLight_Impl *light);
+	static FrustumPlanes get_cull_frustum(const SceneLight_Impl *light);
+
+	/// \brief Finds the shadow map lights rendered this frame, out of the lights visible to the camera
+	void get_frame_lights(const std::vector<SceneLight_Impl *> &visible_lights, std::vector<SceneLight_Impl *> &out_lights) const;
+
 private:
 	void find_lights(Scene_Impl *scene);
 	void assign_shadow_map_indexes();
@@ -64,7 +71,9 @@ private:
 
 	std::vector<SceneLight_Impl *> lights;
 	int round_robin;
-	std::vector<size_t> blur_indexes;
+	std::vector<SceneLight_Impl *> frame_lights;
+
+	static const size_t max_lights_per_frame = 4;
 
 	ShadowMaps maps;
 	GaussianBlur blur;
@@ -0,0 +1,258 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Scene3D/precomp.h"
+#include "API/Scene3D/Resources/scene_data_file_cache.h"
+#include "API/Scene3D/ModelData/model_data_file.h"
+#include "API/Scene3D/ModelData/model_data.h"
+#include "API/Scene3D/LevelData/level_data_file.h"
+#include "API/Scene3D/LevelData/level_data.h"
+#include "API/Core/System/work_queue.h"
+#include "API/Core/Crypto/hash_functions.h"
+#include <set>
+
+namespace clan
+{
+
+/// \brief Tracks the conversions queued by a SceneDataFileCache
+///
+/// Shared with the work items, so a conversion in progress never refers to a destroyed cache.
+class SceneDataFileConversions
+{
+public:
+	SceneDataFileConversions(const std::string &cache_path) : cache_path(cache_path), idle_event(true, true) { }
+
+	/// \brief Registers a conversion of a source file. Returns false if one is already pending.
+	bool begin(const std::string &filename)
+	{
+		MutexSection mutex_lock(&mutex);
+		if (!pending.insert(filename).second)
+			return false;
+		idle_event.reset();
+		return true;
+	}
+
+	void end(const std::string &filename)
+	{
+		MutexSection mutex_lock(&mutex);
+		pending.erase(filename);
+		if (pending.empty())
+			idle_event.set();
+	}
+
+	int get_pending()
+	{
+		MutexSection mutex_lock(&mutex);
+		return pending.size();
+	}
+
+	void wait()
+	{
+		idle_event.wait();
+	}
+
+	std::string get_cache_filename(const std::string &filename, int version, const std::string &extension) const
+	{
+		std::string source_hash = HashFunctions::sha1(File::read_bytes(filename));
+		return PathHelp::combine(cache_path, string_format("%1.v%2%3", source_hash, version, extension));
+	}
+
+private:
+	std::string cache_path;
+	Mutex mutex;
+	std::set<std::string> pending;
+	Event idle_event;
+};
+
+/// \brief Loads a source file if needed and writes its converted file
+template<typename DataType, typename FileType>
+class SceneDataFileConversionWorkItem : public WorkItem
+{
+public:
+	typedef Callback_1<std::shared_ptr<DataType>, const std::string &> Loader;
+
+	SceneDataFileConversionWorkItem(const std::shared_ptr<SceneDataFileConversions> &conversions, const std::string &filename, const std::string &extension, const Loader &loader, const std::string &cache_filename, const std::shared_ptr<DataType> &data)
+	: conversions(conversions), filename(filename), extension(extension), loader(loader), cache_filename(cache_filename), data(data)
+	{
+	}
+
+	void process_work()
+	{
+		try
+		{
+			if (cache_filename.empty())
+				cache_filename = conversions->get_cache_filename(filename, FileType::version, extension);
+
+			if (data || !FileHelp::file_exists(cache_filename))
+			{
+				if (!data)
+					data = loader.invoke(filename);
+				FileType::save(cache_filename, *data);
+			}
+		}
+		catch (...)
+		{
+			// A failed conversion only means the source file is loaded again next time
+		}
+
+		data.reset();
+		conversions->end(filename);
+	}
+
+private:
+	std::shared_ptr<SceneDataFileConversions> conversions;
+	std::string filename;
+	std::string extension;
+	Loader loader;
+	std::string cache_filename;
+	std::shared_ptr<DataType> data;
+};
+
+typedef SceneDataFileConversionWorkItem<ModelData, ModelDataFile> ModelDataFileConversionWorkItem;
+typedef SceneDataFileConversionWorkItem<LevelData, LevelDataFile> LevelDataFileConversionWorkItem;
+
+class SceneDataFileCache_Impl
+{
+public:
+	SceneDataFileCache_Impl(const std::string &cache_path, const SceneDataFileCache::ModelLoader &model_loader, const SceneDataFileCache::LevelLoader &level_loader)
+	: conversions(new SceneDataFileConversions(cache_path)), model_loader(model_loader), level_loader(level_loader)
+	{
+	}
+
+	std::shared_ptr<SceneDataFileConversions> conversions;
+	SceneDataFileCache::ModelLoader model_loader;
+	SceneDataFileCache::LevelLoader level_loader;
+	WorkQueue work_queue;
+
+	static const char *model_extension;
+	static const char *level_extension;
+};
+
+const char *SceneDataFileCache_Impl::model_extension = ".cmodel";
+const char *SceneDataFileCache_Impl::level_extension = ".clevel";
+
+/////////////////////////////////////////////////////////////////////////////
+// SceneDataFileCache construction:
+
+SceneDataFileCache::SceneDataFileCache(const std::string &cache_path, const ModelLoader &model_loader, const LevelLoader &level_loader)
+: impl(new SceneDataFileCache_Impl(cache_path, model_loader, level_loader))
+{
+	Directory::create(cache_path, true);
+}
+
+SceneDataFileCache::~SceneDataFileCache()
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// SceneDataFileCache attributes:
+
+int SceneDataFileCache::get_pending_conversions() const
+{
+	return impl->conversions->get_pending();
+}
+
+std::string SceneDataFileCache::get_model_cache_filename(const std::string &filename) const
+{
+	return impl->conversions->get_cache_filename(filename, ModelDataFile::version, SceneDataFileCache_Impl::model_extension);
+}
+
+std::string SceneDataFileCache::get_level_cache_filename(const std::string &filename) const
+{
+	return impl->conversions->get_cache_filename(filename, LevelDataFile::version, SceneDataFileCache_Impl::level_extension);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// SceneDataFileCache operations:
+
+std::shared_ptr<ModelData> SceneDataFileCache::get_model_data(const std::string &filename)
+{
+	std::string cache_filename = get_model_cache_filename(filename);
+	if (FileHelp::file_exists(cache_filename))
+	{
+		try
+		{
+			return ModelDataFile::load(cache_filename);
+		}
+		catch (Exception &)
+		{
+			// Corrupt file. Convert it again below.
+		}
+	}
+
+	std::shared_ptr<ModelData> model_data = impl->model_loader.invoke(filename);
+	if (impl->conversions->begin(filename))
+		impl->work_queue.queue(new ModelDataFileConversionWorkItem(impl->conversions, filename, SceneDataFileCache_Impl::model_extension, impl->model_loader, cache_filename, model_data), work_priority_low);
+	return model_data;
+}
+
+std::shared_ptr<LevelData> SceneDataFileCache::get_level_data(const std::string &filename)
+{
+	if (impl->level_loader.is_null())
+		throw Exception("SceneDataFileCache has no level loader");
+
+	std::string cache_filename = get_level_cache_filename(filename);
+	if (FileHelp::file_exists(cache_filename))
+	{
+		try
+		{
+			return LevelDataFile::load(cache_filename);
+		}
+		catch (Exception &)
+		{
+			// Corrupt file. Convert it again below.
+		}
+	}
+
+	std::shared_ptr<LevelData> level_data = impl->level_loader.invoke(filename);
+	if (impl->conversions->begin(filename))
+		impl->work_queue.queue(new LevelDataFileConversionWorkItem(impl->conversions, filename, SceneDataFileCache_Impl::level_extension, impl->level_loader, cache_filename, level_data), work_priority_low);
+	return level_data;
+}
+
+void SceneDataFileCache::convert_model(const std::string &filename)
+{
+	if (impl->conversions->begin(filename))
+		impl->work_queue.queue(new ModelDataFileConversionWorkItem(impl->conversions, filename, SceneDataFileCache_Impl::model_extension, impl->model_loader, std::string(), std::shared_ptr<ModelData>()), work_priority_low);
+}
+
+void SceneDataFileCache::convert_level(const std::string &filename)
+{
+	if (impl->level_loader.is_null())
+		throw Exception("SceneDataFileCache has no level loader");
+
+	if (impl->conversions->begin(filename))
+		impl->work_queue.queue(new LevelDataFileConversionWorkItem(impl->conversions, filename, SceneDataFileCache_Impl::level_extension, impl->level_loader, std::string(), std::shared_ptr<LevelData>()), work_priority_low);
+}
+
+void SceneDataFileCache::wait_for_conversions()
+{
+	impl->conversions->wait();
+}
+
+}
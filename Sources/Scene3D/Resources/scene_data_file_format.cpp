@@ -0,0 +1,176 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "Scene3D/precomp.h"
+#include "scene_data_file_format.h"
+
+namespace clan
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// SceneDataFileWriter:
+
+SceneDataFileWriter::SceneDataFileWriter(const char magic[4], int version)
+{
+	SceneDataFileHeader header;
+	memset(&header, 0, sizeof(SceneDataFileHeader));
+	memcpy(header.magic, magic, 4);
+	header.version = version;
+	header.byte_order = SceneDataFileHeader::byte_order_mark;
+	header.header_size = sizeof(SceneDataFileHeader);
+
+	data.resize(sizeof(SceneDataFileHeader));
+	memcpy(&data[0], &header, sizeof(SceneDataFileHeader));
+}
+
+void SceneDataFileWriter::write_string(const std::string &value)
+{
+	write<ubyte32>(value.size());
+	write_metadata(value.data(), value.size());
+}
+
+void SceneDataFileWriter::write_array(const void *values, size_t count, size_t element_size)
+{
+	size_t offset = reserve_array(count, element_size);
+	if (count > 0)
+		memcpy(&data[offset], values, count * element_size);
+}
+
+size_t SceneDataFileWriter::reserve_array(size_t count, size_t element_size)
+{
+	size_t offset = (data.size() + SceneDataFileHeader::alignment - 1) / SceneDataFileHeader::alignment * SceneDataFileHeader::alignment;
+	data.resize(offset + count * element_size, 0);
+
+	write<ubyte64>(offset);
+	write<ubyte64>(count);
+	return offset;
+}
+
+void SceneDataFileWriter::write_metadata(const void *value, size_t size)
+{
+	if (size > 0)
+	{
+		const unsigned char *bytes = static_cast<const unsigned char *>(value);
+		metadata.insert(metadata.end(), bytes, bytes + size);
+	}
+}
+
+void SceneDataFileWriter::save(const std::string &filename)
+{
+	size_t metadata_offset = (data.size() + SceneDataFileHeader::alignment - 1) / SceneDataFileHeader::alignment * SceneDataFileHeader::alignment;
+
+	SceneDataFileHeader *header = reinterpret_cast<SceneDataFileHeader *>(&data[0]);
+	header->metadata_offset = metadata_offset;
+	header->metadata_size = metadata.size();
+	header->file_size = metadata_offset + metadata.size();
+
+	std::string temp_filename = filename + ".tmp";
+	{
+		File file(temp_filename, File::create_always, File::access_write);
+		file.write(&data[0], (int)data.size());
+
+		unsigned char padding[SceneDataFileHeader::alignment] = { 0 };
+		file.write(padding, (int)(metadata_offset - data.size()));
+
+		if (!metadata.empty())
+			file.write(&metadata[0], (int)metadata.size());
+	}
+
+	if (FileHelp::file_exists(filename))
+		FileHelp::delete_file(filename);
+	if (!Directory::rename(temp_filename, filename))
+		throw Exception(string_format("Unable to write %1", filename));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// SceneDataFileReader:
+
+SceneDataFileReader::SceneDataFileReader(const std::string &filename, const char magic[4], int version)
+: filename(filename), metadata(0), metadata_pos(0), metadata_size(0)
+{
+	mapped_file = std::shared_ptr<MemoryMappedFile>(new MemoryMappedFile(filename));
+
+	SceneDataFileHeader header;
+	if (mapped_file->get_size() < (byte64)sizeof(SceneDataFileHeader))
+		throw Exception(string_format("%1 is not a valid scene data file", filename));
+	memcpy(&header, mapped_file->get_data(), sizeof(SceneDataFileHeader));
+
+	if (memcmp(header.magic, magic, 4) != 0 || header.byte_order != SceneDataFileHeader::byte_order_mark || header.header_size != sizeof(SceneDataFileHeader))
+		throw Exception(string_format("%1 is not a valid scene data file", filename));
+	if (header.version != (ubyte32)version)
+		throw Exception(string_format("%1 is version %2, expected version %3", filename, (int)header.version, version));
+	if (header.file_size != (ubyte64)mapped_file->get_size() || header.metadata_offset > header.file_size || header.metadata_size > header.file_size - header.metadata_offset)
+		throw Exception(string_format("%1 is truncated", filename));
+
+	metadata = mapped_file->get_data() + header.metadata_offset;
+	metadata_size = header.metadata_size;
+}
+
+std::string SceneDataFileReader::read_string()
+{
+	size_t length = read_count();
+
+	std::string value(reinterpret_cast<const char *>(metadata + metadata_pos), length);
+	metadata_pos += length;
+	return value;
+}
+
+const void *SceneDataFileReader::read_array(size_t &out_count, size_t element_size)
+{
+	ubyte64 offset = read<ubyte64>();
+	ubyte64 count = read<ubyte64>();
+
+	ubyte64 file_size = mapped_file->get_size();
+	check(offset % SceneDataFileHeader::alignment == 0 && offset <= file_size && count <= (file_size - offset) / element_size);
+
+	out_count = (size_t)count;
+	return mapped_file->get_data() + offset;
+}
+
+size_t SceneDataFileReader::read_count()
+{
+	size_t count = read<ubyte32>();
+	check(count <= metadata_size - metadata_pos);
+	return count;
+}
+
+void SceneDataFileReader::check(bool condition) const
+{
+	if (!condition)
+		throw Exception(string_format("%1 is corrupt", filename));
+}
+
+void SceneDataFileReader::read_metadata(void *value, size_t size)
+{
+	check(size <= metadata_size - metadata_pos);
+
+	memcpy(value, metadata + metadata_pos, size);
+	metadata_pos += size;
+}
+
+}
@@ -0,0 +1,153 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#pragma once
+
+#include "API/Core/IOData/memory_mapped_file.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstring>
+
+namespace clan
+{
+
+/// \brief Header at the start of binary scene data files
+///
+/// The header is followed by the array data and then the metadata describing it. Arrays are
+/// referenced from the metadata by their offset from the start of the file, so a file is valid
+/// wherever it is mapped.
+class SceneDataFileHeader
+{
+public:
+	/// \brief Alignment of arrays within the file
+	static const int alignment = 16;
+
+	/// \brief Value stored in byte_order. Files written on a machine with another byte order are rejected.
+	static const ubyte32 byte_order_mark = 0x01020304;
+
+	char magic[4];
+	ubyte32 version;
+	ubyte32 byte_order;
+	ubyte32 header_size;
+	ubyte64 file_size;
+	ubyte64 metadata_offset;
+	ubyte64 metadata_size;
+	ubyte32 reserved[2];
+};
+
+/// \brief Builds a binary scene data file in memory
+class SceneDataFileWriter
+{
+public:
+	SceneDataFileWriter(const char magic[4], int version);
+
+	/// \brief Appends a value to the metadata
+	template<typename Type>
+	void write(const Type &value) { write_metadata(&value, sizeof(Type)); }
+
+	void write_string(const std::string &value);
+
+	/// \brief Stores an array in the data section and appends its location to the metadata
+	template<typename Type>
+	void write_array(const std::vector<Type> &values) { write_array(values.empty() ? 0 : &values[0], values.size(), sizeof(Type)); }
+
+	void write_array(const void *data, size_t count, size_t element_size);
+
+	/// \brief Allocates an array in the data section and appends its location to the metadata
+	///
+	/// Returns the offset of the array, to be used with get_data() until the next array is added.
+	size_t reserve_array(size_t count, size_t element_size);
+
+	unsigned char *get_data(size_t offset) { return &data[offset]; }
+
+	/// \brief Writes the file through a temporary file, so readers never see a partially written file
+	void save(const std::string &filename);
+
+private:
+	void write_metadata(const void *value, size_t size);
+
+	std::vector<unsigned char> data;
+	std::vector<unsigned char> metadata;
+};
+
+/// \brief Reads a memory mapped binary scene data file
+///
+/// Every array location is checked against the size of the file, but the array contents are
+/// not inspected.
+class SceneDataFileReader
+{
+public:
+	/// \brief Maps the file and validates its header
+	SceneDataFileReader(const std::string &filename, const char magic[4], int version);
+
+	/// \brief Reads the next value in the metadata
+	template<typename Type>
+	Type read()
+	{
+		Type value;
+		read_metadata(&value, sizeof(Type));
+		return value;
+	}
+
+	std::string read_string();
+
+	/// \brief Copies the next array into a vector
+	template<typename Type>
+	void read_array(std::vector<Type> &out_values)
+	{
+		size_t count = 0;
+		const Type *values = static_cast<const Type *>(read_array(count, sizeof(Type)));
+		out_values.assign(values, values + count);
+	}
+
+	/// \brief Returns the next array as a pointer into the mapped file
+	template<typename Type>
+	const Type *read_pointer(size_t &out_count) { return static_cast<const Type *>(read_array(out_count, sizeof(Type))); }
+
+	const void *read_array(size_t &out_count, size_t element_size);
+
+	/// \brief Reads an array or element count and checks that the metadata can hold that many entries
+	size_t read_count();
+
+	/// \brief Throws an exception reporting the file as corrupt if the condition is false
+	void check(bool condition) const;
+
+	const std::shared_ptr<MemoryMappedFile> &get_mapped_file() const { return mapped_file; }
+
+private:
+	void read_metadata(void *value, size_t size);
+
+	std::string filename;
+	std::shared_ptr<MemoryMappedFile> mapped_file;
+	const unsigned char *metadata;
+	size_t metadata_pos;
+	size_t metadata_size;
+};
+
+}
@@ -34,9 +34,12 @@
 #include "API/Scene3D/Performance/scope_timer.h"
 #include "API/Core/Math/frustum_planes.h"
 #include "Scene3D/Culling/OctTree/oct_tree.h"
+#include "Scene3D/Culling/BVH/bvh_tree.h"
 #include "scene_impl.h"
 #include "scene_object_impl.h"
 #include "scene_light_probe_impl.h"
+#include "scene_light_impl.h"
+#include "scene_particle_emitter_impl.h"
 #include "scene_pass_impl.h"
 
 namespace clan
@@ -149,6 +152,19 @@ void Scene::set_cull_oct_tree(float max_size)
 	set_cull_oct_tree(AxisAlignedBoundingBox(Vec3f(-max_size), Vec3f(max_size)));
 }
 
+void Scene::set_cull_bvh()
+{
+	if (!impl->objects.empty() || !impl->lights.empty() || !impl->emitters.empty() || !impl->light_probes.empty())
+		throw Exception("Cannot change scene culling strategy after objects have been added");
+
+	impl->cull_provider = std::unique_ptr<SceneCullProvider>(new BVHTree());
+}
+
+void Scene::set_visit_threads(int num_threads)
+{
+	impl->set_visit_threads(num_threads);
+}
+
 ScenePass Scene::add_pass(const std::string &name, const std::string &insert_before)
 {
 	return impl->add_pass(name, insert_before);
@@ -200,7 +216,7 @@ std::vector<GPUTimer::Result> Scene::gpu_results;
 /////////////////////////////////////////////////////////////////////////////
 
 Scene_Impl::Scene_Impl(GraphicContext &gc, const ResourceManager &resources, const std::string &shader_path)
-: resources(resources), frame(0)
+: resources(resources), frame(0), render_frame(0)
 {
 	cull_provider = std::unique_ptr<SceneCullProvider>(new OctTree());
 
@@ -305,6 +321,8 @@ void Scene_Impl::render(GraphicContext &gc)
 
 	out_world_to_eye.set(world_to_eye);
 
+	prepare_views();
+
 	for (size_t i = 0; i < passes.size(); i++)
 	{
 		if (!passes[i].func_run().is_null())
@@ -317,6 +335,8 @@ void Scene_Impl::render(GraphicContext &gc)
 
 	gpu_timer.end_frame(gc);
 
+	render_frame++;
+
 	Scene::gpu_results = gpu_timer.get_results(gc);
 
 	if (gc.get_shader_language() == shader_glsl)
@@ -330,6 +350,35 @@ void Scene_Impl::update(GraphicContext &gc, float time_elapsed)
 	// To do: update scene object animations here too
 }
 
+void Scene_Impl::prepare_views()
+{
+	ScopeTimeFunction();
+
+	// The camera view is used by the gbuffer, transparency, light and particle passes
+	frame_views.resize(1);
+	frame_views[0].frustum = get_camera_cull_frustum();
+	view_jobs.run(cull_provider.get(), frame_views, 0);
+
+	// The shadow map pass picks the lights it renders from the lights in the camera view
+	vsm_shadow_map_pass->get_frame_lights(frame_views[0].lights, frame_shadow_lights);
+	for (size_t i = 0; i < frame_shadow_lights.size(); i++)
+	{
+		frame_views.push_back(SceneView());
+		frame_views.back().frustum = VSMShadowMapPass::get_cull_frustum(frame_shadow_lights[i]);
+	}
+	view_jobs.run(cull_provider.get(), frame_views, 1);
+}
+
+const SceneView &Scene_Impl::get_view(const FrustumPlanes &frustum)
+{
+	for (size_t i = 0; i < frame_views.size(); i++)
+	{
+		if (frame_views[i].is_frustum(frustum))
+			return frame_views[i];
+	}
+	throw Exception("Scene view was not prepared at the start of the frame");
+}
+
 void Scene_Impl::visit(GraphicContext &gc, const Mat4f &world_to_eye, const Mat4f &eye_to_projection, FrustumPlanes frustum, ModelMeshVisitor *visitor)
 {
 	ScopeTimeFunction();
@@ -337,30 +386,22 @@ void Scene_Impl::visit(GraphicContext &gc, const Mat4f &world_to_eye, const Mat4
 
 	std::vector<Model *> models;
 
-	std::vector<SceneItem *> visible_objects = cull_provider->cull(frustum);
-	for (size_t i = 0; i < visible_objects.size(); i++)
+	const SceneView &view = get_view(frustum);
+	for (size_t i = 0; i < view.instances.size(); i++)
 	{
-		SceneObject_Impl *object = dynamic_cast<SceneObject_Impl*>(visible_objects[i]);
-		if (object)
+		const SceneViewInstance &view_instance = view.instances[i];
+		SceneObject_Impl *object = view_instance.object;
+
+		Vec3f light_probe_color;
+		if (object->light_probe_receiver)
+			light_probe_color = get_light_probe_color(object);
+
+		Scene::instances_drawn++;
+		bool first_instance = view_instance.model->add_instance(frame, object->instance, view_instance.object_to_world, light_probe_color);
+		if (first_instance)
 		{
-			if (object->instance.get_renderer())
-			{
-				Vec3f light_probe_color;
-				if (object->light_probe_receiver)
-				{
-					SceneLightProbe_Impl *probe = find_nearest_probe(object->position);
-					if (probe)
-						light_probe_color = probe->color;
-				}
-
-				Scene::instances_drawn++;
-				bool first_instance = object->instance.get_renderer()->add_instance(frame, object->instance, object->get_object_to_world(), light_probe_color);
-				if (first_instance)
-				{
-					models.push_back(object->instance.get_renderer().get());
-					Scene::models_drawn++;
-				}
-			}
+			models.push_back(view_instance.model);
+			Scene::models_drawn++;
 		}
 	}
 
@@ -371,8 +412,7 @@ void Scene_Impl::visit(GraphicContext &gc, const Mat4f &world_to_eye, const Mat4
 		instances_buffer.add(models[i]->get_instance_vectors_count());
 
 	instances_buffer.lock(gc);
-	for (size_t i = 0; i < models.size(); i++)
-		models[i]->upload(instances_buffer, world_to_eye, eye_to_projection);
+	view_jobs.upload(models, instances_buffer, world_to_eye, eye_to_projection);
 	instances_buffer.unlock(gc);
 
 	for (size_t i = 0; i < models.size(); i++)
@@ -383,30 +423,37 @@ void Scene_Impl::visit_lights(GraphicContext &gc, const Mat4f &world_to_eye, con
 {
 	ScopeTimeFunction();
 
-	std::vector<SceneItem *> visible_objects = cull_provider->cull(frustum);
-	for (size_t i = 0; i < visible_objects.size(); i++)
-	{
-		SceneLight_Impl *light = dynamic_cast<SceneLight_Impl*>(visible_objects[i]);
-		if (light)
-		{
-			visitor->light(gc, world_to_eye, eye_to_projection, light);
-		}
-	}
+	const SceneView &view = get_view(frustum);
+	for (size_t i = 0; i < view.lights.size(); i++)
+		visitor->light(gc, world_to_eye, eye_to_projection, view.lights[i]);
 }
 
 void Scene_Impl::visit_emitters(GraphicContext &gc, const Mat4f &world_to_eye, const Mat4f &eye_to_projection, FrustumPlanes frustum, SceneParticleEmitterVisitor *visitor)
 {
 	ScopeTimeFunction();
 
-	std::vector<SceneItem *> visible_objects = cull_provider->cull(frustum);
-	for (size_t i = 0; i < visible_objects.size(); i++)
+	const SceneView &view = get_view(frustum);
+	for (size_t i = 0; i < view.emitters.size(); i++)
+		visitor->emitter(gc, world_to_eye, eye_to_projection, view.emitters[i]);
+}
+
+FrustumPlanes Scene_Impl::get_camera_cull_frustum() const
+{
+	Size viewport_size = viewport->get_size();
+	Mat4f eye_to_cull_projection = Mat4f::perspective(camera_field_of_view.get(), viewport_size.width/(float)viewport_size.height, 0.1f, 150.0f, handed_left, clip_negative_positive_w);
+	return FrustumPlanes(eye_to_cull_projection * out_world_to_eye.get());
+}
+
+Vec3f Scene_Impl::get_light_probe_color(SceneObject_Impl *object)
+{
+	// An object is often visible in several views per frame
+	if (object->light_probe_frame != render_frame)
 	{
-		SceneParticleEmitter_Impl *emitter = dynamic_cast<SceneParticleEmitter_Impl*>(visible_objects[i]);
-		if (emitter)
-		{
-			visitor->emitter(gc, world_to_eye, eye_to_projection, emitter);
-		}
+		SceneLightProbe_Impl *probe = find_nearest_probe(object->position);
+		object->light_probe_color = probe ? probe->color : Vec3f();
+		object->light_probe_frame = render_frame;
 	}
+	return object->light_probe_color;
 }
 
 SceneLightProbe_Impl *Scene_Impl::find_nearest_probe(const Vec3f &position)
@@ -0,0 +1,62 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+#include "Scene3D/precomp.h"
+#include "API/Scene3D/scene_cull_provider.h"
+#include "API/Core/Math/frustum_planes.h"
+#include "Scene3D/Culling/OctTree/oct_tree.h"
+#include "Scene3D/Culling/RTree/rtree.h"
+#include "Scene3D/Culling/BVH/bvh_tree.h"
+
+namespace clan
+{
+
+std::vector<std::vector<SceneItem *> > SceneCullProvider::cull_views(const std::vector<FrustumPlanes> &frustums)
+{
+	std::vector<std::vector<SceneItem *> > pvs;
+	pvs.reserve(frustums.size());
+	for (size_t i = 0; i < frustums.size(); i++)
+		pvs.push_back(cull(frustums[i]));
+	return pvs;
+}
+
+std::unique_ptr<SceneCullProvider> SceneCullProvider::create_oct_tree(const AxisAlignedBoundingBox &aabb)
+{
+	return std::unique_ptr<SceneCullProvider>(new OctTree(aabb));
+}
+
+std::unique_ptr<SceneCullProvider> SceneCullProvider::create_rtree()
+{
+	return std::unique_ptr<SceneCullProvider>(new RTree());
+}
+
+std::unique_ptr<SceneCullProvider> SceneCullProvider::create_bvh()
+{
+	return std::unique_ptr<SceneCullProvider>(new BVHTree());
+}
+
+}
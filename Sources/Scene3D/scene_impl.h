@@ -35,6 +35,8 @@
 #include "API/Scene3D/Performance/gpu_timer.h"
 #include "Scene3D/Framework/material_cache.h"
 #include "Scene3D/Framework/instances_buffer.h"
+#include "Scene3D/Framework/scene_pool.h"
+#include "Scene3D/Framework/scene_view_jobs.h"
 #include "Scene3D/Model/model_shader_cache.h"
 #include "Scene3D/Model/model_cache.h"
 #include "Scene3D/Passes/VSMShadowMap/vsm_shadow_map_pass.h"
@@ -47,7 +49,6 @@
 #include "Scene3D/Passes/Final/final_pass.h"
 #include "Scene3D/Passes/Transparency/transparency_pass.h"
 #include "Scene3D/Passes/ParticleEmitter/particle_emitter_pass.h"
-#include <list>
 
 namespace clan
 {
@@ -83,6 +84,9 @@ public:
 
 	SceneLightProbe_Impl *find_nearest_probe(const Vec3f &position);
 
+	FrustumPlanes get_camera_cull_frustum() const;
+	void set_visit_threads(int num_threads) { view_jobs.set_num_threads(num_threads); }
+
 	GPUTimer &get_gpu_timer() { return gpu_timer; }
 
 	const ResourceManager &get_resources() const { return resources; }
@@ -95,23 +99,32 @@ public:
 	std::vector<ScenePass> passes;
 
 private:
+	void prepare_views();
+	const SceneView &get_view(const FrustumPlanes &frustum);
+	Vec3f get_light_probe_color(SceneObject_Impl *object);
+
 	ResourceManager resources;
 	std::string shader_path;
 
 	int frame;
+	int render_frame;
 	InstancesBuffer instances_buffer;
 
 	std::unique_ptr<MaterialCache> material_cache;
 	std::unique_ptr<ModelShaderCache> model_shader_cache;
 	std::unique_ptr<ModelCache> model_cache;
 
-	std::list<SceneObject_Impl *> objects;
-	std::list<SceneLight_Impl *> lights;
-	std::list<SceneLightProbe_Impl *> light_probes;
-	std::list<SceneParticleEmitter_Impl *> emitters;
+	ScenePool<SceneObject_Impl> objects;
+	ScenePool<SceneLight_Impl> lights;
+	ScenePool<SceneLightProbe_Impl> light_probes;
+	ScenePool<SceneParticleEmitter_Impl> emitters;
 
 	std::unique_ptr<SceneCullProvider> cull_provider;
 
+	SceneViewJobs view_jobs;
+	std::vector<SceneView> frame_views;
+	std::vector<SceneLight_Impl *> frame_shadow_lights;
+
 	SceneCamera camera;
 
 	Resource<float> camera_field_of_view;
@@ -205,17 +205,17 @@ void SceneLight::set_shadow_source(SceneLight light)
 /////////////////////////////////////////////////////////////////////////////
 
 SceneLight_Impl::SceneLight_Impl(Scene_Impl *scene)
-: scene(scene), cull_proxy(0), type(SceneLight::type_omni), color(Colorf::white), falloff(90.0f),
+: scene(scene), cull_proxy(0), pool_index(-1), type(SceneLight::type_omni), color(Colorf::white), falloff(90.0f),
   hotspot(45.0f), ambient_illumination(0.0f), attenuation_start(1.0f), attenuation_end(100.0f), rectangle_shape(false), aspect_ratio(1.0f), shadow_caster(false), light_caster(true)
 {
-	it = scene->lights.insert(scene->lights.end(), this);
+	scene->lights.add(this);
 }
 
 SceneLight_Impl::~SceneLight_Impl()
 {
 	if (cull_proxy)
 		scene->cull_provider->delete_proxy(cull_proxy);
-	scene->lights.erase(it);
+	scene->lights.remove(this);
 }
 
 AxisAlignedBoundingBox SceneLight_Impl::get_aabb()
@@ -89,16 +89,16 @@ void SceneLightProbe::set_color(const Vec3f &color)
 /////////////////////////////////////////////////////////////////////////////
 
 SceneLightProbe_Impl::SceneLightProbe_Impl(Scene_Impl *scene)
-: scene(scene), cull_proxy(0), radius(1.0f)
+: scene(scene), cull_proxy(0), pool_index(-1), radius(1.0f)
 {
-	it = scene->light_probes.insert(scene->light_probes.end(), this);
+	scene->light_probes.add(this);
 }
 
 SceneLightProbe_Impl::~SceneLightProbe_Impl()
 {
 	if (cull_proxy)
 		scene->cull_provider->delete_proxy(cull_proxy);
-	scene->light_probes.erase(it);
+	scene->light_probes.remove(this);
 }
 
 AxisAlignedBoundingBox SceneLightProbe_Impl::get_aabb()
@@ -137,16 +137,16 @@ SceneObject &SceneObject::rotate(float dir, float up, float tilt)
 /////////////////////////////////////////////////////////////////////////////
 
 SceneObject_Impl::SceneObject_Impl(Scene_Impl *scene)
-: scene(scene), cull_proxy(0), scale(1.0f), light_probe_receiver(false)
+: scene(scene), cull_proxy(0), pool_index(-1), scale(1.0f), light_probe_receiver(false), light_probe_frame(-1)
 {
-	it = scene->objects.insert(scene->objects.end(), this);
+	scene->objects.add(this);
 }
 
 SceneObject_Impl::~SceneObject_Impl()
 {
 	if (cull_proxy)
 		scene->cull_provider->delete_proxy(cull_proxy);
-	scene->objects.erase(it);
+	scene->objects.remove(this);
 }
 
 void SceneObject_Impl::create_lights(Scene &scene_base)
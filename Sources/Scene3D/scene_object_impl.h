@@ -31,7 +31,6 @@
 #include "API/Scene3D/scene_light.h"
 #include "API/Scene3D/scene_cull_provider.h"
 #include "Model/model_instance.h"
-#include <list>
 
 namespace clan
 {
@@ -56,13 +55,15 @@ public:
 
 	Scene_Impl *scene;
 	SceneCullProxy *cull_proxy;
-	std::list<SceneObject_Impl *>::iterator it;
+	int pool_index;
 
 	Vec3f position;
 	Quaternionf orientation;
 	Vec3f scale;
 
 	bool light_probe_receiver;
+	int light_probe_frame;
+	Vec3f light_probe_color;
 
 	ModelInstance instance;
 	std::vector<SceneLight> lights;
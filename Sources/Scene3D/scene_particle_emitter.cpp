@@ -175,16 +175,16 @@ void SceneParticleEmitter::set_gradient_texture(const std::string &texture)
 /////////////////////////////////////////////////////////////////////////////
 
 SceneParticleEmitter_Impl::SceneParticleEmitter_Impl(Scene_Impl *scene)
-: scene(scene), cull_proxy(0), type(SceneParticleEmitter::type_omni), particles_per_second(10), falloff(90.0f), life_span(5.0f), start_size(1.0f), end_size(2.0f), speed(10.0f)
+: scene(scene), cull_proxy(0), pool_index(-1), type(SceneParticleEmitter::type_omni), particles_per_second(10), falloff(90.0f), life_span(5.0f), start_size(1.0f), end_size(2.0f), speed(10.0f)
 {
-	it = scene->emitters.insert(scene->emitters.end(), this);
+	scene->emitters.add(this);
 }
 
 SceneParticleEmitter_Impl::~SceneParticleEmitter_Impl()
 {
 	if (cull_proxy)
 		scene->cull_provider->delete_proxy(cull_proxy);
-	scene->emitters.erase(it);
+	scene->emitters.remove(this);
 
 	if (pass_data)
 	{
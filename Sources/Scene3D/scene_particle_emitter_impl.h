@@ -29,7 +29,6 @@
 #pragma once
 
 #include "API/Scene3D/scene_cull_provider.h"
-#include <list>
 
 namespace clan
 {
@@ -46,7 +45,7 @@ public:
 
 	Scene_Impl *scene;
 	SceneCullProxy *cull_proxy;
-	std::list<SceneParticleEmitter_Impl *>::iterator it;
+	int pool_index;
 
 	SceneParticleEmitter::Type type;
 	Vec3f position;
@@ -67,11 +67,22 @@ int TestApp::main(const std::vector<std::string> &args)
 #endif
 		Console::write_line("Directory: API/Core/Math");
 
+		test_checksum();
 		test_md5();
 		test_rsa();
 		test_aes128();
 		test_aes192();
 		test_aes256();
+
+		// Repeat the CBC tests with the portable implementation, in case AES-NI was used above
+		AES_Backend::set_hardware_enabled(false);
+		test_aes128();
+		test_aes192();
+		test_aes256();
+		AES_Backend::set_hardware_enabled(true);
+
+		test_aes_ctr();
+		test_aes_gcm();
 		test_sha1();
 		test_sha224();
 		test_sha256();
@@ -79,6 +90,10 @@ int TestApp::main(const std::vector<std::string> &args)
 		test_sha512();
 		test_sha512_224();
 		test_sha512_256();
+		test_sha_batch();
+		test_aes_benchmark();
+		test_checksum_benchmark();
+		test_sha_benchmark();
 
 		Console::write_line("All Tests Complete");
 		console.display_close_message();
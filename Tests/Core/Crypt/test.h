@@ -69,7 +69,17 @@ private:
 	void test_aes192_helper(const char *key_ptr, const char *iv_ptr, const char *plaintext_ptr, const char *ciphertext_ptr);
 	void test_aes256();
 	void test_aes256_helper(const char *key_ptr, const char *iv_ptr, const char *plaintext_ptr, const char *ciphertext_ptr);
+	void test_aes_ctr();
+	void test_aes_ctr_helper(const char *key_ptr, const char *iv_ptr, const char *plaintext_ptr, const char *ciphertext_ptr);
+	void test_aes_gcm();
+	void test_aes_gcm_helper(const char *key_ptr, const char *iv_ptr, const char *aad_ptr, const char *plaintext_ptr, const char *ciphertext_ptr, const char *tag_ptr);
+	void test_aes_benchmark();
+	void report_throughput(const std::string &name, int data_size, int iterations, ubyte64 microseconds);
 	void convert_ascii(const char *src, std::vector<unsigned char> &dest);
+	void test_checksum();
+	void test_checksum_benchmark();
+	void test_sha_batch();
+	void test_sha_benchmark();
 
 	void test_rsa();
 	void test_md5();
@@ -0,0 +1,118 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Mark Page
+**    (if your name is missing here, please add it)
+*/
+
+#include "test.h"
+
+void TestApp::test_aes_benchmark()
+{
+	Console::write_line(" Benchmark: AES throughput (AES-128 key, 4 MB buffer)");
+
+	const int data_size = 4 * 1024 * 1024;
+	std::vector<unsigned char> data(data_size);
+	for (int cnt = 0; cnt < data_size; cnt++)
+		data[cnt] = (unsigned char) cnt;
+
+	std::vector<unsigned char> key;
+	std::vector<unsigned char> iv;
+	convert_ascii("2b7e151628aed2a6abf7158809cf4f3c", key);
+	convert_ascii("000102030405060708090a0b0c0d0e0f", iv);
+
+	bool hardware_enabled = AES_Backend::is_hardware_enabled();
+	for (int backend = 0; backend < 2; backend++)
+	{
+		if (backend == 0 && !AES_Backend::is_hardware_supported())
+			continue;
+		AES_Backend::set_hardware_enabled(backend == 0);
+		std::string backend_name = (backend == 0) ? "AES-NI   " : "bitsliced";
+
+		DataBuffer ciphertext;
+		ubyte64 start_time = System::get_microseconds();
+		int iterations = 0;
+		do
+		{
+			AES128_Encrypt aes_encrypt;
+			aes_encrypt.set_padding(false);
+			aes_encrypt.set_iv(&iv[0]);
+			aes_encrypt.set_key(&key[0]);
+			aes_encrypt.add(&data[0], data_size);
+			aes_encrypt.calculate();
+			ciphertext = aes_encrypt.get_data();
+			iterations++;
+		} while (System::get_microseconds() - start_time < 250000);
+		report_throughput(backend_name + " CBC encrypt", data_size, iterations, System::get_microseconds() - start_time);
+
+		start_time = System::get_microseconds();
+		iterations = 0;
+		do
+		{
+			AES128_Decrypt aes_decrypt;
+			aes_decrypt.set_padding(false);
+			aes_decrypt.set_iv(&iv[0]);
+			aes_decrypt.set_key(&key[0]);
+			aes_decrypt.add(ciphertext);
+			if (!aes_decrypt.calculate())
+				fail();
+			iterations++;
+		} while (System::get_microseconds() - start_time < 250000);
+		report_throughput(backend_name + " CBC decrypt", data_size, iterations, System::get_microseconds() - start_time);
+
+		start_time = System::get_microseconds();
+		iterations = 0;
+		do
+		{
+			AES_CTR aes_ctr;
+			aes_ctr.set_iv(&iv[0]);
+			aes_ctr.set_key(&key[0], key.size());
+			aes_ctr.add(&data[0], data_size);
+			aes_ctr.calculate();
+			iterations++;
+		} while (System::get_microseconds() - start_time < 250000);
+		report_throughput(backend_name + " CTR        ", data_size, iterations, System::get_microseconds() - start_time);
+
+		start_time = System::get_microseconds();
+		iterations = 0;
+		do
+		{
+			AES_GCM_Encrypt aes_gcm;
+			aes_gcm.set_key(&key[0], key.size());
+			aes_gcm.set_iv(&iv[0], AES_GCM_Encrypt::iv_size);
+			aes_gcm.add(&data[0], data_size);
+			aes_gcm.calculate();
+			iterations++;
+		} while (System::get_microseconds() - start_time < 250000);
+		report_throughput(backend_name + " GCM encrypt", data_size, iterations, System::get_microseconds() - start_time);
+	}
+	AES_Backend::set_hardware_enabled(hardware_enabled);
+}
+
+void TestApp::report_throughput(const std::string &name, int data_size, int iterations, ubyte64 microseconds)
+{
+	double gigabytes_per_second = (double) data_size * iterations / (microseconds * 1000.0);
+	Console::write_line("  %1: %2 GB/s", name, StringHelp::double_to_text(gigabytes_per_second, 3));
+}
@@ -0,0 +1,160 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Mark Page
+**    (if your name is missing here, please add it)
+*/
+
+#include "test.h"
+
+void TestApp::test_aes_ctr()
+{
+	Console::write_line(" Header: aes_ctr.h");
+	Console::write_line("  Class: AES_CTR");
+
+	bool hardware_enabled = AES_Backend::is_hardware_enabled();
+	for (int backend = 0; backend < 2; backend++)
+	{
+		// Run the tests with the portable implementation as well, even if AES-NI is available
+		AES_Backend::set_hardware_enabled(backend == 0);
+
+		// Test data from http://csrc.nist.gov/publications/nistpubs/800-38a/sp800-38a.pdf
+
+		test_aes_ctr_helper(
+			"2b7e151628aed2a6abf7158809cf4f3c",	// KEY
+			"f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff",	// IV
+			"6bc1bee22e409f96e93d7e117393172a"	// PLAINTEXT
+			"ae2d8a571e03ac9c9eb76fac45af8e51"
+			"30c81c46a35ce411e5fbc1191a0a52ef"
+			"f69f2445df4f9b17ad2b417be66c3710",
+			"874d6191b620e3261bef6864990db6ce"	// CIPHERTEXT
+			"9806f66b7970fdff8617187bb9fffdff"
+			"5ae4df3edbd5d35e5b4f09020db03eab"
+			"1e031dda2fbe03d1792170a0f3009cee"
+			);
+
+		test_aes_ctr_helper(
+			"8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b",	// KEY
+			"f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff",	// IV
+			"6bc1bee22e409f96e93d7e117393172a"	// PLAINTEXT
+			"ae2d8a571e03ac9c9eb76fac45af8e51"
+			"30c81c46a35ce411e5fbc1191a0a52ef"
+			"f69f2445df4f9b17ad2b417be66c3710",
+			"1abc932417521ca24f2b0459fe7e6e0b"	// CIPHERTEXT
+			"090339ec0aa6faefd5ccc2c6f4ce8e94"
+			"1e36b26bd1ebc670d1bd1d665620abf7"
+			"4f78a7f6d29809585a97daec58c6b050"
+			);
+
+		test_aes_ctr_helper(
+			"603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4",	// KEY
+			"f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff",	// IV
+			"6bc1bee22e409f96e93d7e117393172a"	// PLAINTEXT
+			"ae2d8a571e03ac9c9eb76fac45af8e51"
+			"30c81c46a35ce411e5fbc1191a0a52ef"
+			"f69f2445df4f9b17ad2b417be66c3710",
+			"601ec313775789a5b7a7f504bbf3d228"	// CIPHERTEXT
+			"f443e3ca4d62b59aca84e990cacaf5c5"
+			"2b0930daa23de94ce87017ba2d84988d"
+			"dfc9c58db67aada613c2dd08457941a6"
+			);
+	}
+
+	// Both implementations must produce the same data, also when the counter wraps around
+	const int test_data_length = 16 * 37 + 5;
+	unsigned char test_data[test_data_length];
+	for (int cnt = 0; cnt < test_data_length; cnt++)
+		test_data[cnt] = (unsigned char) (cnt * 13);
+
+	std::vector<unsigned char> key;
+	std::vector<unsigned char> iv;
+	convert_ascii("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f", key);
+	convert_ascii("fffffffffffffffffffffffffffffffd", iv);
+
+	DataBuffer results[2];
+	for (int backend = 0; backend < 2; backend++)
+	{
+		AES_Backend::set_hardware_enabled(backend == 0);
+
+		AES_CTR aes_ctr;
+		aes_ctr.set_iv(&iv[0]);
+		aes_ctr.set_key(&key[0], key.size());
+
+		// Add the data in pieces of different sizes, to test the handling of partial blocks
+		int pos = 0;
+		for (int piece = 1; pos < test_data_length; piece++)
+		{
+			int size = min(piece, test_data_length - pos);
+			aes_ctr.add(test_data + pos, size);
+			pos += size;
+		}
+		aes_ctr.calculate();
+		results[backend] = aes_ctr.get_data();
+	}
+
+	if (results[0].get_size() != test_data_length || results[1].get_size() != test_data_length)
+		fail();
+	if (memcmp(results[0].get_data(), results[1].get_data(), test_data_length))
+		fail();
+
+	AES_Backend::set_hardware_enabled(hardware_enabled);
+}
+
+void TestApp::test_aes_ctr_helper(const char *key_ptr, const char *iv_ptr, const char *plaintext_ptr, const char *ciphertext_ptr)
+{
+	std::vector<unsigned char> key;
+	std::vector<unsigned char> iv;
+	std::vector<unsigned char> plaintext;
+	std::vector<unsigned char> ciphertext;
+
+	convert_ascii(key_ptr, key);
+	convert_ascii(iv_ptr, iv);
+	convert_ascii(plaintext_ptr, plaintext);
+	convert_ascii(ciphertext_ptr, ciphertext);
+
+	AES_CTR aes_encrypt;
+	aes_encrypt.set_iv(&iv[0]);
+	aes_encrypt.set_key(&key[0], key.size());
+	aes_encrypt.add(&plaintext[0], plaintext.size());
+	aes_encrypt.calculate();
+	DataBuffer buffer = aes_encrypt.get_data();
+	if (buffer.get_size() != ciphertext.size())
+		fail();
+	unsigned char *data_ptr = (unsigned char *) buffer.get_data();
+	if (memcmp(data_ptr, &ciphertext[0], ciphertext.size()))
+		fail();
+
+	AES_CTR aes_decrypt;
+	aes_decrypt.set_iv(&iv[0]);
+	aes_decrypt.set_key(&key[0], key.size());
+	aes_decrypt.add(data_ptr, buffer.get_size());
+	aes_decrypt.calculate();
+	DataBuffer buffer2 = aes_decrypt.get_data();
+	if (buffer2.get_size() != plaintext.size())
+		fail();
+	unsigned char *data_ptr2 = (unsigned char *) buffer2.get_data();
+	if (memcmp(data_ptr2, &plaintext[0], plaintext.size()))
+		fail();
+}
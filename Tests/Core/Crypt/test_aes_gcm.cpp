@@ -0,0 +1,250 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Mark Page
+**    (if your name is missing here, please add it)
+*/
+
+#include "test.h"
+
+void TestApp::test_aes_gcm()
+{
+	Console::write_line(" Header: aes_gcm_encrypt.h and aes_gcm_decrypt.h");
+	Console::write_line("  Class: AES_GCM_Encrypt and AES_GCM_Decrypt");
+
+	bool hardware_enabled = AES_Backend::is_hardware_enabled();
+	for (int backend = 0; backend < 2; backend++)
+	{
+		// Run the tests with the portable implementation as well, even if AES-NI is available
+		AES_Backend::set_hardware_enabled(backend == 0);
+
+		// Test data from "The Galois/Counter Mode of Operation (GCM)" by McGrew and Viega, Appendix B
+
+		// Test Case 1
+		test_aes_gcm_helper(
+			"00000000000000000000000000000000",	// KEY
+			"000000000000000000000000",	// IV
+			"",	// AUTHENTICATED DATA
+			"",	// PLAINTEXT
+			"",	// CIPHERTEXT
+			"58e2fccefa7e3061367f1d57a4e7455a"	// TAG
+			);
+
+		// Test Case 2
+		test_aes_gcm_helper(
+			"00000000000000000000000000000000",	// KEY
+			"000000000000000000000000",	// IV
+			"",	// AUTHENTICATED DATA
+			"00000000000000000000000000000000",	// PLAINTEXT
+			"0388dace60b6a392f328c2b971b2fe78",	// CIPHERTEXT
+			"ab6e47d42cec13bdf53a67b21257bddf"	// TAG
+			);
+
+		// Test Case 3
+		test_aes_gcm_helper(
+			"feffe9928665731c6d6a8f9467308308",	// KEY
+			"cafebabefacedbaddecaf888",	// IV
+			"",	// AUTHENTICATED DATA
+			"d9313225f88406e5a55909c5aff5269a"	// PLAINTEXT
+			"86a7a9531534f7da2e4c303d8a318a72"
+			"1c3c0c95956809532fcf0e2449a6b525"
+			"b16aedf5aa0de657ba637b391aafd255",
+			"42831ec2217774244b7221b784d0d49c"	// CIPHERTEXT
+			"e3aa212f2c02a4e035c17e2329aca12e"
+			"21d514b25466931c7d8f6a5aac84aa05"
+			"1ba30b396a0aac973d58e091473f5985",
+			"4d5c2af327cd64a62cf35abd2ba6fab4"	// TAG
+			);
+
+		// Test Case 4
+		test_aes_gcm_helper(
+			"feffe9928665731c6d6a8f9467308308",	// KEY
+			"cafebabefacedbaddecaf888",	// IV
+			"feedfacedeadbeeffeedfacedeadbeef"	// AUTHENTICATED DATA
+			"abaddad2",
+			"d9313225f88406e5a55909c5aff5269a"	// PLAINTEXT
+			"86a7a9531534f7da2e4c303d8a318a72"
+			"1c3c0c95956809532fcf0e2449a6b525"
+			"b16aedf5aa0de657ba637b39",
+			"42831ec2217774244b7221b784d0d49c"	// CIPHERTEXT
+			"e3aa212f2c02a4e035c17e2329aca12e"
+			"21d514b25466931c7d8f6a5aac84aa05"
+			"1ba30b396a0aac973d58e091",
+			"5bc94fbc3221a5db94fae95ae7121a47"	// TAG
+			);
+
+		// Test Case 5 (64 bit IV)
+		test_aes_gcm_helper(
+			"feffe9928665731c6d6a8f9467308308",	// KEY
+			"cafebabefacedbad",	// IV
+			"feedfacedeadbeeffeedfacedeadbeef"	// AUTHENTICATED DATA
+			"abaddad2",
+			"d9313225f88406e5a55909c5aff5269a"	// PLAINTEXT
+			"86a7a9531534f7da2e4c303d8a318a72"
+			"1c3c0c95956809532fcf0e2449a6b525"
+			"b16aedf5aa0de657ba637b39",
+			"61353b4c2806934a777ff51fa22a4755"	// CIPHERTEXT
+			"699b2a714fcdc6f83766e5f97b6c7423"
+			"73806900e49f24b22b097544d4896b42"
+			"4989b5e1ebac0f07c23f4598",
+			"3612d2e79e3b0785561be14aaca2fccb"	// TAG
+			);
+
+		// Test Case 15 (AES-256)
+		test_aes_gcm_helper(
+			"feffe9928665731c6d6a8f9467308308"	// KEY
+			"feffe9928665731c6d6a8f9467308308",
+			"cafebabefacedbaddecaf888",	// IV
+			"",	// AUTHENTICATED DATA
+			"d9313225f88406e5a55909c5aff5269a"	// PLAINTEXT
+			"86a7a9531534f7da2e4c303d8a318a72"
+			"1c3c0c95956809532fcf0e2449a6b525"
+			"b16aedf5aa0de657ba637b391aafd255",
+			"522dc1f099567d07f47f37a32a84427d"	// CIPHERTEXT
+			"643a8cdcbfe5c0c97598a2bd2555d1aa"
+			"8cb08e48590dbb3da7b08b1056828838"
+			"c5f61e6393ba7a0abcc9f662898015ad",
+			"b094dac5d93471bdec1a502270e3cc6c"	// TAG
+			);
+	}
+
+	// Both implementations must produce the same data and tag, also when the data is added in pieces
+	const int test_data_length = 16 * 41 + 7;
+	unsigned char test_data[test_data_length];
+	for (int cnt = 0; cnt < test_data_length; cnt++)
+		test_data[cnt] = (unsigned char) (cnt * 7);
+
+	std::vector<unsigned char> key;
+	std::vector<unsigned char> iv;
+	convert_ascii("000102030405060708090a0b0c0d0e0f1011121314151617", key);
+	convert_ascii("cafebabefacedbaddecaf888", iv);
+
+	DataBuffer results[2];
+	unsigned char tags[2][AES_GCM_Encrypt::tag_size];
+	for (int backend = 0; backend < 2; backend++)
+	{
+		AES_Backend::set_hardware_enabled(backend == 0);
+
+		AES_GCM_Encrypt aes_encrypt;
+		aes_encrypt.set_key(&key[0], key.size());
+		aes_encrypt.set_iv(&iv[0], iv.size());
+		aes_encrypt.add_authenticated_data(test_data, 5);
+		aes_encrypt.add_authenticated_data(test_data + 5, 30);
+
+		int pos = 0;
+		for (int piece = 1; pos < test_data_length; piece += 3)
+		{
+			int size = min(piece, test_data_length - pos);
+			aes_encrypt.add(test_data + pos, size);
+			pos += size;
+		}
+		aes_encrypt.calculate();
+		results[backend] = aes_encrypt.get_data();
+		aes_encrypt.get_tag(tags[backend]);
+
+		// Any modification of the data must be detected
+		DataBuffer modified(results[backend].get_data(), results[backend].get_size());
+		modified.get_data<unsigned char>()[100] ^= 1;
+		AES_GCM_Decrypt aes_decrypt;
+		aes_decrypt.set_key(&key[0], key.size());
+		aes_decrypt.set_iv(&iv[0], iv.size());
+		aes_decrypt.add_authenticated_data(test_data, 35);
+		aes_decrypt.add(modified);
+		if (aes_decrypt.calculate(tags[backend]))
+			fail();
+	}
+
+	if (results[0].get_size() != test_data_length || results[1].get_size() != test_data_length)
+		fail();
+	if (memcmp(results[0].get_data(), results[1].get_data(), test_data_length))
+		fail();
+	if (memcmp(tags[0], tags[1], AES_GCM_Encrypt::tag_size))
+		fail();
+
+	AES_Backend::set_hardware_enabled(hardware_enabled);
+}
+
+void TestApp::test_aes_gcm_helper(const char *key_ptr, const char *iv_ptr, const char *aad_ptr, const char *plaintext_ptr, const char *ciphertext_ptr, const char *tag_ptr)
+{
+	std::vector<unsigned char> key;
+	std::vector<unsigned char> iv;
+	std::vector<unsigned char> aad;
+	std::vector<unsigned char> plaintext;
+	std::vector<unsigned char> ciphertext;
+	std::vector<unsigned char> tag;
+
+	convert_ascii(key_ptr, key);
+	convert_ascii(iv_ptr, iv);
+	convert_ascii(aad_ptr, aad);
+	convert_ascii(plaintext_ptr, plaintext);
+	convert_ascii(ciphertext_ptr, ciphertext);
+	convert_ascii(tag_ptr, tag);
+
+	AES_GCM_Encrypt aes_encrypt;
+	aes_encrypt.set_key(&key[0], key.size());
+	aes_encrypt.set_iv(&iv[0], iv.size());
+	if (!aad.empty())
+		aes_encrypt.add_authenticated_data(&aad[0], aad.size());
+	if (!plaintext.empty())
+		aes_encrypt.add(&plaintext[0], plaintext.size());
+	aes_encrypt.calculate();
+	DataBuffer buffer = aes_encrypt.get_data();
+	if (buffer.get_size() != ciphertext.size())
+		fail();
+	unsigned char *data_ptr = (unsigned char *) buffer.get_data();
+	if (!ciphertext.empty() && memcmp(data_ptr, &ciphertext[0], ciphertext.size()))
+		fail();
+	unsigned char calculated_tag[AES_GCM_Encrypt::tag_size];
+	aes_encrypt.get_tag(calculated_tag);
+	if (memcmp(calculated_tag, &tag[0], AES_GCM_Encrypt::tag_size))
+		fail();
+
+	AES_GCM_Decrypt aes_decrypt;
+	aes_decrypt.set_key(&key[0], key.size());
+	aes_decrypt.set_iv(&iv[0], iv.size());
+	if (!aad.empty())
+		aes_decrypt.add_authenticated_data(&aad[0], aad.size());
+	aes_decrypt.add(buffer);
+	bool result = aes_decrypt.calculate(&tag[0]);
+	if (!result)
+		fail();
+	DataBuffer buffer2 = aes_decrypt.get_data();
+	if (buffer2.get_size() != plaintext.size())
+		fail();
+	unsigned char *data_ptr2 = (unsigned char *) buffer2.get_data();
+	if (!plaintext.empty() && memcmp(data_ptr2, &plaintext[0], plaintext.size()))
+		fail();
+
+	// A modified tag must be rejected
+	tag[15] ^= 0x80;
+	AES_GCM_Decrypt aes_decrypt2;
+	aes_decrypt2.set_key(&key[0], key.size());
+	aes_decrypt2.set_iv(&iv[0], iv.size());
+	if (!aad.empty())
+		aes_decrypt2.add_authenticated_data(&aad[0], aad.size());
+	aes_decrypt2.add(buffer);
+	if (aes_decrypt2.calculate(&tag[0]))
+		fail();
+}
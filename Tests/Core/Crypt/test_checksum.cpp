@@ -0,0 +1,151 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "test.h"
+
+static ubyte32 reference_crc32(const unsigned char *data, int size, ubyte32 crc)
+{
+	crc = ~crc;
+	for (int i = 0; i < size; i++)
+	{
+		crc ^= data[i];
+		for (int bit = 0; bit < 8; bit++)
+			crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+	}
+	return ~crc;
+}
+
+static ubyte32 reference_adler32(const unsigned char *data, int size, ubyte32 adler)
+{
+	ubyte32 s1 = adler & 0xffff;
+	ubyte32 s2 = adler >> 16;
+	for (int i = 0; i < size; i++)
+	{
+		s1 = (s1 + data[i]) % 65521;
+		s2 = (s2 + s1) % 65521;
+	}
+	return s1 | (s2 << 16);
+}
+
+void TestApp::test_checksum()
+{
+	Console::write_line(" Header: hash_functions.h");
+	Console::write_line("  Function: crc32(), adler32(), crc32_combine(), adler32_combine()");
+
+	const char *check_text = "123456789";
+	if (HashFunctions::crc32(check_text, 9) != 0xcbf43926)
+		fail();
+	if (HashFunctions::adler32(check_text, 9) != 0x091e01de)
+		fail();
+	if (HashFunctions::crc32(check_text, 0) != 0 || HashFunctions::adler32(check_text, 0) != 1)
+		fail();
+
+	const int data_size = 256 * 1024 + 77;
+	std::vector<unsigned char> data(data_size);
+	ubyte32 seed = 0x12345678;
+	for (int i = 0; i < data_size; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		data[i] = (unsigned char) (seed >> 16);
+	}
+	// A run of 0xff bytes stresses the adler32 overflow limits
+	memset(&data[100000], 0xff, 20000);
+
+	// All small sizes at every alignment, covering the SIMD paths and their tails
+	for (int offset = 0; offset < 16; offset++)
+	{
+		for (int size = 0; size < 300; size++)
+		{
+			if (HashFunctions::crc32(&data[offset], size) != reference_crc32(&data[offset], size, 0))
+				fail();
+			if (HashFunctions::adler32(&data[offset], size) != reference_adler32(&data[offset], size, 1))
+				fail();
+		}
+	}
+
+	ubyte32 crc = reference_crc32(&data[0], data_size, 0);
+	ubyte32 adler = reference_adler32(&data[0], data_size, 1);
+	if (HashFunctions::crc32(&data[0], data_size) != crc)
+		fail();
+	if (HashFunctions::adler32(&data[0], data_size) != adler)
+		fail();
+
+	// Running checksums and combining independently calculated blocks
+	const int split_points[] = { 0, 1, 15, 64, 1000, 5552, 65536, 100003, data_size };
+	for (int i = 0; i < (int) (sizeof(split_points) / sizeof(int)); i++)
+	{
+		int size1 = split_points[i];
+		int size2 = data_size - size1;
+		ubyte32 crc1 = HashFunctions::crc32(&data[0], size1);
+		ubyte32 crc2 = HashFunctions::crc32(&data[size1], size2);
+		ubyte32 adler1 = HashFunctions::adler32(&data[0], size1);
+		ubyte32 adler2 = HashFunctions::adler32(&data[size1], size2);
+
+		if (HashFunctions::crc32(&data[size1], size2, crc1) != crc)
+			fail();
+		if (HashFunctions::adler32(&data[size1], size2, adler1) != adler)
+			fail();
+		if (HashFunctions::crc32_combine(crc1, crc2, size2) != crc)
+			fail();
+		if (HashFunctions::adler32_combine(adler1, adler2, size2) != adler)
+			fail();
+	}
+}
+
+void TestApp::test_checksum_benchmark()
+{
+	Console::write_line(" Benchmark: checksum throughput (4 MB buffer)");
+
+	const int data_size = 4 * 1024 * 1024;
+	std::vector<unsigned char> data(data_size);
+	for (int cnt = 0; cnt < data_size; cnt++)
+		data[cnt] = (unsigned char) (cnt * 7);
+
+	ubyte32 crc = HashFunctions::crc32(&data[0], data_size);
+	ubyte32 adler = HashFunctions::adler32(&data[0], data_size);
+
+	ubyte64 start_time = System::get_microseconds();
+	int iterations = 0;
+	do
+	{
+		if (HashFunctions::crc32(&data[0], data_size) != crc)
+			fail();
+		iterations++;
+	} while (System::get_microseconds() - start_time < 250000);
+	report_throughput("crc32  ", data_size, iterations, System::get_microseconds() - start_time);
+
+	start_time = System::get_microseconds();
+	iterations = 0;
+	do
+	{
+		if (HashFunctions::adler32(&data[0], data_size) != adler)
+			fail();
+		iterations++;
+	} while (System::get_microseconds() - start_time < 250000);
+	report_throughput("adler32", data_size, iterations, System::get_microseconds() - start_time);
+}
@@ -0,0 +1,146 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "test.h"
+
+void TestApp::test_sha_batch()
+{
+	Console::write_line(" Header: hash_functions.h");
+	Console::write_line("  Function: sha1_batch(), sha256_batch(), sha512_batch()");
+
+	// Sizes around the block and padding boundaries, plus some larger buffers
+	std::vector<DataBuffer> buffers;
+	for (int cnt = 0; cnt < 300; cnt++)
+	{
+		int size = (cnt < 200) ? cnt : (cnt * 7919) % 20000;
+		DataBuffer buffer(size);
+		for (int pos = 0; pos < size; pos++)
+			buffer.get_data()[pos] = (char) (pos * 13 + cnt);
+		buffers.push_back(buffer);
+	}
+	int num_buffers = buffers.size();
+
+	std::vector<unsigned char> expected(num_buffers * SHA512::hash_size);
+	std::vector<unsigned char> batch(num_buffers * SHA512::hash_size);
+	std::vector<unsigned char> queued(num_buffers * SHA512::hash_size);
+	WorkQueue work_queue(false, 4);
+
+	for (int cnt = 0; cnt < num_buffers; cnt++)
+		HashFunctions::sha1(buffers[cnt], &expected[cnt * SHA1::hash_size]);
+	HashFunctions::sha1_batch(&buffers[0], num_buffers, &batch[0]);
+	HashFunctions::sha1_batch(&buffers[0], num_buffers, &queued[0], work_queue);
+	if (memcmp(&expected[0], &batch[0], num_buffers * SHA1::hash_size) || memcmp(&expected[0], &queued[0], num_buffers * SHA1::hash_size))
+		fail();
+
+	for (int cnt = 0; cnt < num_buffers; cnt++)
+		HashFunctions::sha256(buffers[cnt], &expected[cnt * SHA256::hash_size]);
+	HashFunctions::sha256_batch(&buffers[0], num_buffers, &batch[0]);
+	HashFunctions::sha256_batch(&buffers[0], num_buffers, &queued[0], work_queue);
+	if (memcmp(&expected[0], &batch[0], num_buffers * SHA256::hash_size) || memcmp(&expected[0], &queued[0], num_buffers * SHA256::hash_size))
+		fail();
+
+	for (int cnt = 0; cnt < num_buffers; cnt++)
+		HashFunctions::sha512(buffers[cnt], &expected[cnt * SHA512::hash_size]);
+	HashFunctions::sha512_batch(&buffers[0], num_buffers, &batch[0]);
+	HashFunctions::sha512_batch(&buffers[0], num_buffers, &queued[0], work_queue);
+	if (memcmp(&expected[0], &batch[0], num_buffers * SHA512::hash_size) || memcmp(&expected[0], &queued[0], num_buffers * SHA512::hash_size))
+		fail();
+
+	// Data added in pieces must give the same hash as in one go
+	SHA256 sha256;
+	sha256.add(buffers[299].get_data(), 100);
+	sha256.add(buffers[299].get_data() + 100, buffers[299].get_size() - 100);
+	sha256.calculate();
+	if (HashFunctions::sha256(buffers[299]) != sha256.get_hash())
+		fail();
+}
+
+void TestApp::test_sha_benchmark()
+{
+	Console::write_line(" Benchmark: SHA throughput (4 MB buffer, and a batch of 4096 buffers of 1 KB)");
+
+	const int data_size = 4 * 1024 * 1024;
+	DataBuffer data(data_size);
+	for (int cnt = 0; cnt < data_size; cnt++)
+		data.get_data()[cnt] = (char) cnt;
+
+	const int num_buffers = 4096;
+	std::vector<DataBuffer> buffers;
+	for (int cnt = 0; cnt < num_buffers; cnt++)
+		buffers.push_back(DataBuffer(data.get_data() + cnt * 1024, 1024));
+	std::vector<unsigned char> hashes(num_buffers * SHA512::hash_size);
+	WorkQueue work_queue;
+
+	for (int algorithm = 0; algorithm < 3; algorithm++)
+	{
+		std::string name = (algorithm == 0) ? "SHA-1  " : (algorithm == 1) ? "SHA-256" : "SHA-512";
+
+		unsigned char hash[SHA512::hash_size];
+		ubyte64 start_time = System::get_microseconds();
+		int iterations = 0;
+		do
+		{
+			if (algorithm == 0)
+				HashFunctions::sha1(data, hash);
+			else if (algorithm == 1)
+				HashFunctions::sha256(data, hash);
+			else
+				HashFunctions::sha512(data, hash);
+			iterations++;
+		} while (System::get_microseconds() - start_time < 250000);
+		report_throughput(name + "              ", data_size, iterations, System::get_microseconds() - start_time);
+
+		start_time = System::get_microseconds();
+		iterations = 0;
+		do
+		{
+			if (algorithm == 0)
+				HashFunctions::sha1_batch(&buffers[0], num_buffers, &hashes[0]);
+			else if (algorithm == 1)
+				HashFunctions::sha256_batch(&buffers[0], num_buffers, &hashes[0]);
+			else
+				HashFunctions::sha512_batch(&buffers[0], num_buffers, &hashes[0]);
+			iterations++;
+		} while (System::get_microseconds() - start_time < 250000);
+		report_throughput(name + " batch        ", num_buffers * 1024, iterations, System::get_microseconds() - start_time);
+
+		start_time = System::get_microseconds();
+		iterations = 0;
+		do
+		{
+			if (algorithm == 0)
+				HashFunctions::sha1_batch(&buffers[0], num_buffers, &hashes[0], work_queue);
+			else if (algorithm == 1)
+				HashFunctions::sha256_batch(&buffers[0], num_buffers, &hashes[0], work_queue);
+			else
+				HashFunctions::sha512_batch(&buffers[0], num_buffers, &hashes[0], work_queue);
+			iterations++;
+		} while (System::get_microseconds() - start_time < 250000);
+		report_throughput(name + " batch, queued", num_buffers * 1024, iterations, System::get_microseconds() - start_time);
+	}
+}
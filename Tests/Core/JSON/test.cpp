@@ -0,0 +1,337 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "test.h"
+
+// This is the Program class that is called by Application
+class Program
+{
+public:
+	static int main(const std::vector<std::string> &args)
+	{
+		// Initialize ClanLib base components
+		SetupCore setup_core;
+
+		// Start the Application
+		TestApp app;
+		int retval = app.main(args);
+		return retval;
+	}
+};
+
+// Instantiate Application, informing it where the Program is located
+Application app(&Program::main);
+
+int TestApp::main(const std::vector<std::string> &args)
+{
+	ConsoleWindow console("Console");
+
+	try
+	{
+		run_test();
+		console.display_close_message();
+	}
+	catch(Exception error)
+	{
+		Console::write_line("Unhandled exception: %1", error.message);
+		console.display_close_message();
+		return -1;
+	}
+
+	return 0;
+}
+
+void TestApp::run_test()
+{
+	verify_reader();
+	verify_reader_errors();
+	verify_reader_long_numbers();
+	verify_writer();
+	verify_document();
+
+	std::string json = create_telemetry(100000);
+	verify_streaming(json);
+	benchmark_parse(json);
+}
+
+void TestApp::verify_reader()
+{
+	std::string json = " { \"a\" : [1, -2.5, 3e2, true, false, null], \"b\\n\\u00e5\\ud83d\\ude00\" : {}, \"c\" : [] } ";
+	JsonReader reader(json);
+
+	const JsonReader::Token expected[] =
+	{
+		JsonReader::token_begin_object,
+		JsonReader::token_key, JsonReader::token_begin_array,
+		JsonReader::token_number, JsonReader::token_number, JsonReader::token_number,
+		JsonReader::token_boolean, JsonReader::token_boolean, JsonReader::token_null,
+		JsonReader::token_end_array,
+		JsonReader::token_key, JsonReader::token_begin_object, JsonReader::token_end_object,
+		JsonReader::token_key, JsonReader::token_begin_array, JsonReader::token_end_array,
+		JsonReader::token_end_object,
+		JsonReader::token_end
+	};
+	const double numbers[] = { 1.0, -2.5, 300.0 };
+
+	int number_index = 0;
+	for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++)
+	{
+		JsonReader::Token token = reader.next();
+		if (token != expected[i])
+			throw Exception(string_format("JsonReader returned token %1, expected %2", (int)token, (int)expected[i]));
+		if (token == JsonReader::token_number && reader.get_number() != numbers[number_index++])
+			throw Exception("JsonReader returned the wrong number");
+		if (i == 10 && reader.get_string() != "b\n\xc3\xa5\xf0\x9f\x98\x80")
+			throw Exception("JsonReader did not decode string escapes");
+	}
+
+	JsonReader skip_reader(json);
+	skip_reader.next();
+	skip_reader.next();
+	skip_reader.skip();
+	if (skip_reader.next() != JsonReader::token_key || skip_reader.get_depth() != 1)
+		throw Exception("JsonReader::skip did not skip the member value");
+
+	Console::write_line("Reader tokens: OK");
+}
+
+void TestApp::verify_reader_errors()
+{
+	std::vector<std::string> invalid =
+	{
+		"", "[1,]", "{\"a\" 1}", "{\"a\":1,}", "[1 2]", "{1:2}", "[1]]", "\"abc", "[tru]", "-", "1.", "1e", "[1] 2", "\"\\ud800\"",
+		"0123", "-01", "[00]", "01.5",
+		"\"a\x01" "b\"", "\"tab\there\"", "[\"line\nbreak\"]", "{\"\x1f\":1}", std::string("\"\0\"", 3)
+	};
+
+	for (size_t i = 0; i < invalid.size(); i++)
+	{
+		bool failed = false;
+		try
+		{
+			JsonReader reader(invalid[i]);
+			while (reader.next() != JsonReader::token_end)
+			{
+			}
+		}
+		catch (JsonException &)
+		{
+			failed = true;
+		}
+		if (!failed)
+			throw Exception(string_format("JsonReader accepted invalid JSON: %1", invalid[i]));
+	}
+
+	Console::write_line("Reader errors: OK");
+}
+
+void TestApp::verify_reader_long_numbers()
+{
+	// JSON numbers have no length limit
+	std::string long_digits(300, '1');
+	struct LongNumber
+	{
+		std::string text;
+		double expected;
+	} numbers[] =
+	{
+		{ "-" + long_digits, -strtod(long_digits.c_str(), 0) },
+		{ "0." + long_digits + "5", strtod(("0." + long_digits + "5").c_str(), 0) },
+		{ "1e" + std::string(300, '0') + "5", 1e5 },
+		{ std::string(61, '1') + "e+5", strtod((std::string(61, '1') + "e+5").c_str(), 0) }
+	};
+
+	for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++)
+	{
+		JsonReader memory_reader(numbers[i].text);
+		if (memory_reader.next() != JsonReader::token_number || memory_reader.get_number() != numbers[i].expected)
+			throw Exception(string_format("JsonReader misread long number %1", i));
+
+		// Padded so the number crosses the end of the first 64 KB device buffer
+		std::string padded = std::string(64 * 1024 - 100, ' ') + numbers[i].text;
+		DataBuffer data(padded.data(), padded.length());
+		IODevice_Memory device(data);
+		JsonReader device_reader(device);
+		if (device_reader.next() != JsonReader::token_number || device_reader.get_number() != numbers[i].expected)
+			throw Exception(string_format("JsonReader misread long number %1 from a device", i));
+
+		JsonDocument document("[" + numbers[i].text + "]");
+		if (document.get_root()[0].to_double() != numbers[i].expected)
+			throw Exception(string_format("JsonDocument misread long number %1", i));
+	}
+
+	Console::write_line("Reader long numbers: OK");
+}
+
+void TestApp::verify_writer()
+{
+	DataBuffer data;
+	IODevice_Memory device(data);
+	JsonWriter writer(device);
+	writer.begin_object();
+	writer.write_key("name");
+	writer.write_string("quote \" backslash \\ newline \n tab \t bell \x07");
+	writer.write_key("values");
+	writer.begin_array();
+	writer.write_number(42);
+	writer.write_number(-7);
+	writer.write_number(0.1);
+	writer.write_number(1e300);
+	writer.write_number(0.30000000000000004);
+	writer.write_boolean(true);
+	writer.write_null();
+	writer.end_array();
+	writer.write_key("empty");
+	writer.begin_object();
+	writer.end_object();
+	writer.end_object();
+	writer.flush();
+
+	std::string json(device.get_data().get_data(), device.get_data().get_size());
+	std::string expected = "{\"name\":\"quote \\\" backslash \\\\ newline \\n tab \\t bell \\u0007\",\"values\":[42,-7,0.1,1e+300,0.30000000000000004,true,null],\"empty\":{}}";
+	if (json != expected)
+		throw Exception("JsonWriter output mismatch: " + json);
+
+	JsonDocument document(json);
+	if (document.get_root()["name"].to_string() != "quote \" backslash \\ newline \n tab \t bell \x07")
+		throw Exception("JsonWriter string escapes did not read back");
+	if (document.get_root()["values"][3].to_double() != 1e300)
+		throw Exception("JsonWriter number did not read back");
+
+	bool failed = false;
+	try
+	{
+		writer.write_number(1);
+	}
+	catch (JsonException &)
+	{
+		failed = true;
+	}
+	if (!failed)
+		throw Exception("JsonWriter accepted a second top level value");
+
+	Console::write_line("Writer: OK");
+}
+
+void TestApp::verify_document()
+{
+	JsonDocument document("{\"zeta\":1,\"alpha\":{\"x\":[10,20,30]},\"mid\":\"text\",\"alpha\":{\"x\":[40]},\"flag\":false}");
+	JsonNode root = document.get_root();
+
+	if (root.get_size() != 4 || root.get_member_name(0) != "alpha" || root.get_member_name(3) != "zeta")
+		throw Exception("JsonDocument members are not sorted and unique");
+	if (root["alpha"]["x"].get_size() != 1 || root["alpha"]["x"][0].to_int() != 40)
+		throw Exception("JsonDocument did not keep the last duplicate key");
+	if (root["mid"].to_string() != "text" || strcmp(root["mid"].get_string_data(), "text") != 0)
+		throw Exception("JsonDocument string lookup failed");
+	if (root["flag"].to_boolean() || root["zeta"].to_int() != 1)
+		throw Exception("JsonDocument value lookup failed");
+	if (!root["missing"].is_null() || root.has_member("missing") || !root.has_member("zeta"))
+		throw Exception("JsonDocument missing member lookup failed");
+
+	JsonValue value = root.to_value();
+	if (value["alpha"]["x"][0].to_int() != 40 || value["mid"].to_string() != "text" || value.get_members().size() != 4)
+		throw Exception("JsonNode::to_value did not copy the tree");
+
+	Console::write_line("Document: OK");
+}
+
+void TestApp::verify_streaming(const std::string &json)
+{
+	// Strings and numbers cross the device buffer boundaries in a file this size
+	DataBuffer data(json.data(), json.length());
+	IODevice_Memory device(data);
+	JsonReader stream_reader(device);
+	JsonReader memory_reader(json);
+
+	while (true)
+	{
+		JsonReader::Token token = memory_reader.next();
+		if (stream_reader.next() != token ||
+			stream_reader.get_string() != memory_reader.get_string() ||
+			stream_reader.get_number() != memory_reader.get_number())
+			throw Exception("JsonReader returned different tokens for a device");
+		if (token == JsonReader::token_end)
+			break;
+	}
+
+	Console::write_line("Streaming from device: OK");
+}
+
+std::string TestApp::create_telemetry(int num_records)
+{
+	// Save file or telemetry style records
+	std::string json = "[";
+	for (int i = 0; i < num_records; i++)
+	{
+		if (i > 0)
+			json += ",\n";
+		json += string_format("{\"id\":%1,\"name\":\"entity_%2\",\"position\":[%3,%4,%5],", i, i % 1000, i * 0.25, -i * 0.5, 1.5);
+		json += string_format("\"health\":%1,\"alive\":%2,\"inventory\":{\"gold\":%3,\"items\":[\"sword\",\"shield\",\"potion\"]}}",
+			100 - i % 100, (i % 7) ? "true" : "false", i * 3);
+	}
+	json += "]";
+	return json;
+}
+
+void TestApp::benchmark_parse(const std::string &json)
+{
+	const int iterations = 3;
+	double megabytes = json.length() / (1024.0 * 1024.0);
+	Console::write_line("");
+	Console::write_line("Parse throughput, %1 MB of JSON", StringHelp::double_to_text(megabytes, 1));
+
+	ubyte64 start_time = System::get_microseconds();
+	size_t size = 0;
+	for (int i = 0; i < iterations; i++)
+		size += JsonValue::from_json(json).get_size();
+	ubyte64 tree_time = System::get_microseconds() - start_time;
+
+	start_time = System::get_microseconds();
+	size_t document_size = 0;
+	for (int i = 0; i < iterations; i++)
+		document_size += JsonDocument(json).get_root().get_size();
+	ubyte64 document_time = System::get_microseconds() - start_time;
+
+	start_time = System::get_microseconds();
+	int tokens = 0;
+	for (int i = 0; i < iterations; i++)
+	{
+		JsonReader reader(json);
+		while (reader.next() != JsonReader::token_end)
+			tokens++;
+	}
+	ubyte64 reader_time = System::get_microseconds() - start_time;
+
+	if (size != document_size)
+		throw Exception("JsonDocument and JsonValue disagree on the document size");
+
+	Console::write_line("JsonValue::from_json: %1 MB/s", StringHelp::double_to_text(megabytes * iterations * 1000000.0 / tree_time, 1));
+	Console::write_line("JsonDocument:         %1 MB/s", StringHelp::double_to_text(megabytes * iterations * 1000000.0 / document_time, 1));
+	Console::write_line("JsonReader:           %1 MB/s (%2 tokens)", StringHelp::double_to_text(megabytes * iterations * 1000000.0 / reader_time, 1), tokens / iterations);
+}
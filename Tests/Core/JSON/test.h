@@ -0,0 +1,53 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#ifndef _header_test_
+#define _header_test_
+
+#include <ClanLib/core.h>
+#include <ClanLib/application.h>
+using namespace clan;
+
+class TestApp
+{
+public:
+	int main(const std::vector<std::string> &args);
+
+private:
+	void run_test();
+	void verify_reader();
+	void verify_reader_errors();
+	void verify_reader_long_numbers();
+	void verify_writer();
+	void verify_document();
+	void verify_streaming(const std::string &json);
+	std::string create_telemetry(int num_records);
+	void benchmark_parse(const std::string &json);
+};
+
+#endif
@@ -0,0 +1,314 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "test.h"
+#include <algorithm>
+
+// This is the Program class that is called by Application
+class Program
+{
+public:
+	static int main(const std::vector<std::string> &args)
+	{
+		// Initialize ClanLib base components
+		SetupCore setup_core;
+
+		// Start the Application
+		TestApp app;
+		int retval = app.main(args);
+		return retval;
+	}
+};
+
+// Instantiate Application, informing it where the Program is located
+Application app(&Program::main);
+
+int TestApp::main(const std::vector<std::string> &args)
+{
+	ConsoleWindow console("Console");
+
+	try
+	{
+		run_test();
+		console.display_close_message();
+	}
+	catch(Exception error)
+	{
+		Console::write_line("Unhandled exception: %1", error.message);
+		console.display_close_message();
+		return -1;
+	}
+
+	return 0;
+}
+
+void TestApp::run_test()
+{
+	write_file("bundle_test_image.png", std::string("\x89PNG\r\n\x1a\n\0binary", 15));
+
+	verify_bundle(
+		"<?xml version='1.0'?>"
+		"<clres:resources xmlns:clres='http://clanlib.org/xmlns/resources-1.0'>"
+		"<clres:section clres:name='sprites'>"
+		"<clres:sprite clres:name='player' speed='60'><clres:image file='bundle_test_image.png'/><clres:frame x='1' y='2'/></clres:sprite>"
+		"<clres:section clres:name='enemies'><clres:sprite clres:name='ghost'><clres:image file='missing.png'/></clres:sprite></clres:section>"
+		"</clres:section>"
+		"<clres:string clres:name='title' value='Hello &amp; welcome'/>"
+		"<clres:text clres:name='story'>Once upon a time<![CDATA[ <b>x</b> ]]></clres:text>"
+		"</clres:resources>");
+
+	verify_bundle(
+		"<resources>"
+		"<section name='sounds'><sample name='boom' file='bundle_test_image.png'/></section>"
+		"<integer name='lives' value='3'/>"
+		"<boolean name='fullscreen' value='true'/>"
+		"</resources>");
+
+	verify_lazy_loading();
+	verify_mutation();
+	verify_corrupt_bundle();
+	benchmark_load(5000);
+
+	FileHelp::delete_file("bundle_test_image.png");
+	FileHelp::delete_file("bundle_test.xml");
+	FileHelp::delete_file("bundle_test.bundle");
+}
+
+void TestApp::verify_bundle(const std::string &xml)
+{
+	write_file("bundle_test.xml", xml);
+	XMLResourceDocument xml_doc("bundle_test.xml");
+	xml_doc.save_bundle("bundle_test.bundle");
+
+	XMLResourceDocument bundle_doc("bundle_test.bundle");
+	if (!bundle_doc.is_bundle())
+		throw Exception("Bundle was not detected by XMLResourceDocument::load");
+	compare_documents(xml_doc, bundle_doc);
+
+	XMLResourceDocument bundle_doc2;
+	bundle_doc2.load_bundle("bundle_test.bundle");
+	compare_documents(xml_doc, bundle_doc2);
+
+	// Referenced files are served from the bundle
+	std::vector<std::string> names = bundle_doc.get_resource_names();
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		XMLResourceNode resource = bundle_doc.get_resource(names[i]);
+		DomNode child = resource.get_element().get_first_child();
+		DomElement element = child.is_element() ? child.to_element() : resource.get_element();
+		if (element.get_attribute("file") == "bundle_test_image.png")
+		{
+			FileHelp::delete_file("bundle_test_image.png");
+			std::string contents = read_file(resource.open_file("bundle_test_image.png"));
+			if (contents != read_file(resource.get_file_system().open_file(PathHelp::combine(resource.get_base_path(), "bundle_test_image.png"))))
+				throw Exception("Embedded file opened differently through the file system");
+			write_file("bundle_test_image.png", std::string("\x89PNG\r\n\x1a\n\0binary", 15));
+			if (contents != std::string("\x89PNG\r\n\x1a\n\0binary", 15))
+				throw Exception("Embedded file contents differ");
+		}
+	}
+
+	// Resources from the bundle can be loaded again as XML
+	bundle_doc.save("bundle_test.xml");
+	XMLResourceDocument xml_doc2("bundle_test.xml");
+	compare_documents(xml_doc, xml_doc2);
+}
+
+void TestApp::verify_lazy_loading()
+{
+	write_file("bundle_test.xml", create_resources_xml(100));
+	XMLResourceDocument("bundle_test.xml").save_bundle("bundle_test.bundle", false);
+
+	XMLResourceDocument doc("bundle_test.bundle");
+	DomElement root = doc.get_resource("sprites/sprite_10").get_element().get_owner_document().get_document_element();
+	if (root.select_nodes("//sprite").size() != 1)
+		throw Exception("Bundle resources were not materialised lazily");
+
+	doc.get_resource("sprites/sprite_10");
+	DomNode section = doc.get_resource("sprites/sprite_11").get_element().get_parent_node();
+	if (root.select_nodes("//sprite").size() != 2 || section.get_local_name() != "section" || section.to_element().get_attribute("clres:name") != "sprites")
+		throw Exception("Materialised resources were not placed in their section");
+
+	if (doc.resource_exists("sprites/sprite_100") || doc.resource_exists("sprite_10") || doc.resource_exists(""))
+		throw Exception("Bundle hash index returned a resource that does not exist");
+	if (doc.get_integer_resource("sprites/missing", 42) != 42)
+		throw Exception("Default value not returned for missing bundle resource");
+}
+
+void TestApp::verify_mutation()
+{
+	write_file("bundle_test.xml", create_resources_xml(10));
+	XMLResourceDocument("bundle_test.xml").save_bundle("bundle_test.bundle");
+
+	XMLResourceDocument doc("bundle_test.bundle");
+	XMLResourceNode first = doc.get_resource("sprites/sprite_1");
+	doc.create_resource("sprites/added/sprite", "sprite");
+	doc.destroy_resource("sprites/sprite_2");
+	if (doc.is_bundle())
+		throw Exception("Document still uses the bundle after it was modified");
+	if (!(doc.get_resource("sprites/sprite_1") == first))
+		throw Exception("Materialised resource was replaced when unbundling");
+
+	doc.save("bundle_test.xml");
+	XMLResourceDocument reloaded("bundle_test.xml");
+	if (reloaded.get_resource_names().size() != 10 || !reloaded.resource_exists("sprites/added/sprite") || reloaded.resource_exists("sprites/sprite_2"))
+		throw Exception("Modified bundle document was not saved correctly");
+}
+
+void TestApp::verify_corrupt_bundle()
+{
+	write_file("bundle_test.xml", create_resources_xml(10));
+	XMLResourceDocument("bundle_test.xml").save_bundle("bundle_test.bundle");
+
+	File file("bundle_test.bundle");
+	std::string contents = read_file(file);
+	file.close();
+
+	for (int truncate = 1; truncate < 3; truncate++)
+	{
+		write_file("bundle_test.bundle", contents.substr(0, contents.length() * truncate / 3));
+		bool failed = false;
+		try
+		{
+			XMLResourceDocument doc("bundle_test.bundle");
+		}
+		catch (Exception &)
+		{
+			failed = true;
+		}
+		if (!failed)
+			throw Exception("Truncated bundle was accepted");
+	}
+}
+
+void TestApp::compare_documents(XMLResourceDocument &doc1, XMLResourceDocument &doc2)
+{
+	std::vector<std::string> names1 = doc1.get_resource_names();
+	std::vector<std::string> names2 = doc2.get_resource_names();
+	if (names1 != names2)
+		throw Exception("Resource names differ");
+	if (doc1.get_section_names() != doc2.get_section_names())
+		throw Exception("Section names differ");
+
+	for (size_t i = 0; i < names1.size(); i++)
+	{
+		XMLResourceNode resource1 = doc1.get_resource(names1[i]);
+		XMLResourceNode resource2 = doc2.get_resource(names1[i]);
+		if (!doc2.resource_exists(names1[i]))
+			throw Exception(string_format("Resource %1 does not exist", names1[i]));
+		if (resource1.get_type() != resource2.get_type() || resource1.get_name() != resource2.get_name())
+			throw Exception(string_format("Resource %1 has a different type or name", names1[i]));
+		if (describe_node(resource1.get_element()) != describe_node(resource2.get_element()))
+			throw Exception(string_format("Resource %1 differs: %2 instead of %3", names1[i], describe_node(resource2.get_element()), describe_node(resource1.get_element())));
+
+		std::string section = PathHelp::get_basepath(names1[i], PathHelp::path_type_virtual);
+		if (doc1.get_resource_names(section) != doc2.get_resource_names(section))
+			throw Exception(string_format("Resource names in section %1 differ", section));
+		if (doc1.get_resource_names_of_type(resource1.get_type()) != doc2.get_resource_names_of_type(resource1.get_type()))
+			throw Exception(string_format("Resource names of type %1 differ", resource1.get_type()));
+		if (doc1.get_string_resource(names1[i], "") != doc2.get_string_resource(names1[i], ""))
+			throw Exception(string_format("String resource %1 differs", names1[i]));
+	}
+}
+
+std::string TestApp::describe_node(const DomNode &node)
+{
+	std::string description = string_format("[%1 %2 %3 %4", node.get_node_type(), node.get_namespace_uri(), node.get_node_name(), node.get_node_value());
+
+	std::vector<std::string> attributes;
+	DomNamedNodeMap attribute_map = node.get_attributes();
+	for (unsigned long i = 0; i < attribute_map.get_length(); i++)
+	{
+		DomNode attribute = attribute_map.item(i);
+		attributes.push_back(string_format("%1 %2=%3", attribute.get_namespace_uri(), attribute.get_node_name(), attribute.get_node_value()));
+	}
+	std::sort(attributes.begin(), attributes.end());
+	for (size_t i = 0; i < attributes.size(); i++)
+		description += " " + attributes[i];
+
+	for (DomNode child = node.get_first_child(); !child.is_null(); child = child.get_next_sibling())
+	{
+		if (!child.is_comment())
+			description += describe_node(child);
+	}
+	return description + "]";
+}
+
+std::string TestApp::create_resources_xml(int num_resources)
+{
+	std::string xml = "<clres:resources xmlns:clres='http://clanlib.org/xmlns/resources-1.0'><clres:section clres:name='sprites'>";
+	for (int i = 0; i < num_resources; i++)
+		xml += string_format("<sprite clres:name='sprite_%1'><image file='sprite_%2.png'/><frame x='%3'/><frame x='%4'/></sprite>", i, i, i, i + 1);
+	xml += "</clres:section></clres:resources>";
+	return xml;
+}
+
+void TestApp::write_file(const std::string &filename, const std::string &contents)
+{
+	File file(filename, File::create_always, File::access_read_write);
+	file.write(contents.data(), contents.length());
+}
+
+std::string TestApp::read_file(IODevice file)
+{
+	std::string contents(file.get_size(), 0);
+	if (!contents.empty() && file.read(&contents[0], contents.length()) != (int)contents.length())
+		throw Exception("Unable to read file");
+	return contents;
+}
+
+void TestApp::benchmark_load(int num_resources)
+{
+	const int iterations = 10;
+	write_file("bundle_test.xml", create_resources_xml(num_resources));
+	XMLResourceDocument("bundle_test.xml").save_bundle("bundle_test.bundle", false);
+
+	Console::write_line("");
+	Console::write_line("Load %1 resources and access 10 of them", num_resources);
+
+	ubyte64 start_time = System::get_microseconds();
+	for (int i = 0; i < iterations; i++)
+	{
+		XMLResourceDocument doc("bundle_test.xml");
+		for (int j = 0; j < 10; j++)
+			doc.get_resource(string_format("sprites/sprite_%1", j * 97));
+	}
+	ubyte64 xml_time = System::get_microseconds() - start_time;
+
+	start_time = System::get_microseconds();
+	for (int i = 0; i < iterations; i++)
+	{
+		XMLResourceDocument doc("bundle_test.bundle");
+		for (int j = 0; j < 10; j++)
+			doc.get_resource(string_format("sprites/sprite_%1", j * 97));
+	}
+	ubyte64 bundle_time = System::get_microseconds() - start_time;
+
+	Console::write_line("XML document:    %1 us", (int)(xml_time / iterations));
+	Console::write_line("Resource bundle: %1 us", (int)(bundle_time / iterations));
+}
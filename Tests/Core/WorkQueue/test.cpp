@@ -0,0 +1,182 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "test.h"
+
+// This is the Program class that is called by Application
+class Program
+{
+public:
+	static int main(const std::vector<std::string> &args)
+	{
+		// Initialize ClanLib base components
+		SetupCore setup_core;
+
+		// Start the Application
+		TestApp app;
+		int retval = app.main(args);
+		return retval;
+	}
+};
+
+// Instantiate Application, informing it where the Program is located
+Application app(&Program::main);
+
+// Small job roughly the size of a tile decode or path node expansion
+class BenchmarkItem : public WorkItem
+{
+public:
+	BenchmarkItem(InterlockedVariable *counter) : counter(counter) { }
+
+	void process_work()
+	{
+		unsigned int value = 0x12345678;
+		for (int i = 0; i < 64; i++)
+			value = value * 1664525 + 1013904223;
+		result = value;
+		counter->increment();
+	}
+
+	unsigned int result;
+
+private:
+	InterlockedVariable *counter;
+};
+
+class SignalItem : public WorkItem
+{
+public:
+	SignalItem(Event *event) : event(event) { }
+	void process_work() { event->set(); }
+
+private:
+	Event *event;
+};
+
+int TestApp::main(const std::vector<std::string> &args)
+{
+	ConsoleWindow console("Console");
+
+	try
+	{
+		run_test();
+		console.display_close_message();
+	}
+	catch(Exception error)
+	{
+		Console::write_line("Unhandled exception: %1", error.message);
+		console.display_close_message();
+		return -1;
+	}
+
+	return 0;
+}
+
+void TestApp::run_test()
+{
+	verify_children();
+	verify_priorities();
+
+	const int num_items = 200000;
+	int max_threads = System::get_num_cores();
+
+	Console::write_line("WorkQueue throughput, %1 items per run", num_items);
+	Console::write_line("Threads  queue() items/s  queue_batch() items/s");
+	for (int num_threads = 1; num_threads <= max_threads; num_threads++)
+	{
+		double single = benchmark_queue(num_threads, num_items, false);
+		double batch = benchmark_queue(num_threads, num_items, true);
+		Console::write_line("%1  %2  %3", num_threads, StringHelp::double_to_text(single, 0), StringHelp::double_to_text(batch, 0));
+	}
+}
+
+void TestApp::verify_children()
+{
+	InterlockedVariable counter;
+	Event done;
+	std::vector<WorkItem *> children;
+	for (int i = 0; i < 1000; i++)
+		children.push_back(new BenchmarkItem(&counter));
+
+	WorkQueue work_queue(false);
+	work_queue.queue_children(new SignalItem(&done), children);
+	if (!done.wait(10000) || counter.get() != 1000)
+		throw Exception("Parent item was processed before all its children");
+
+	Console::write_line("Parent/child completion: OK");
+}
+
+void TestApp::verify_priorities()
+{
+	Event blocker, done;
+	std::vector<int> order;
+	Mutex mutex;
+
+	WorkQueue work_queue(true);
+	work_queue.queue([&]() { blocker.wait(); });
+	work_queue.queue([&]() { MutexSection lock(&mutex); order.push_back(2); }, work_priority_low);
+	work_queue.queue([&]() { MutexSection lock(&mutex); order.push_back(1); }, work_priority_normal);
+	work_queue.queue([&]() { MutexSection lock(&mutex); order.push_back(0); }, work_priority_high);
+	work_queue.queue([&]() { done.set(); }, work_priority_low);
+	blocker.set();
+
+	if (!done.wait(10000) || order.size() != 3 || order[0] != 0 || order[1] != 1 || order[2] != 2)
+		throw Exception("Work items were not processed in priority order");
+
+	Console::write_line("Priority order: OK");
+}
+
+double TestApp::benchmark_queue(int num_threads, int num_items, bool batch)
+{
+	InterlockedVariable counter;
+	Event done;
+	WorkQueue work_queue(false, num_threads);
+
+	std::vector<WorkItem *> items;
+	items.reserve(num_items);
+	for (int i = 0; i < num_items; i++)
+		items.push_back(new BenchmarkItem(&counter));
+
+	ubyte64 start_time = System::get_microseconds();
+	if (batch)
+	{
+		work_queue.queue_children(new SignalItem(&done), items);
+	}
+	else
+	{
+		for (int i = 0; i < num_items; i++)
+			work_queue.queue(items[i]);
+		while (counter.get() != num_items)
+			System::sleep(0);
+		done.set();
+	}
+	done.wait();
+	ubyte64 end_time = System::get_microseconds();
+
+	return num_items * 1000000.0 / std::max(end_time - start_time, (ubyte64)1);
+}
@@ -0,0 +1,334 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "test.h"
+
+// This is the Program class that is called by Application
+class Program
+{
+public:
+	static int main(const std::vector<std::string> &args)
+	{
+		// Initialize ClanLib base components
+		SetupCore setup_core;
+
+		// Start the Application
+		TestApp app;
+		int retval = app.main(args);
+		return retval;
+	}
+};
+
+// Instantiate Application, informing it where the Program is located
+Application app(&Program::main);
+
+int TestApp::main(const std::vector<std::string> &args)
+{
+	ConsoleWindow console("Console");
+
+	try
+	{
+		run_test();
+		console.display_close_message();
+	}
+	catch(Exception error)
+	{
+		Console::write_line("Unhandled exception: %1", error.message);
+		console.display_close_message();
+		return -1;
+	}
+
+	return 0;
+}
+
+void TestApp::run_test()
+{
+	verify_views();
+	verify_unescape();
+	verify_errors();
+
+	verify_incremental(create_resources(100), 1);
+	std::string xml = create_resources(50000);
+	verify_incremental(xml, 7);
+	verify_incremental(xml, 4096);
+	benchmark_tokenizer(xml);
+}
+
+void TestApp::verify_views()
+{
+	std::string xml =
+		"\xef\xbb\xbf<?xml version=\"1.0\"?>\n"
+		"<!-- A &amp; B -->\n"
+		"<sprite name=\"a&amp;b\" file='x.png'>\n"
+		"  some &lt;text&gt;  \n"
+		"  <![CDATA[&amp;]]>\n"
+		"  <frame/>\n"
+		"</sprite>";
+
+	XMLTokenizer tokenizer(xml.data(), xml.length());
+	XMLTokenView view;
+
+	if (!tokenizer.next_view(&view) || view.type != XMLToken::PROCESSING_INSTRUCTION_TOKEN || view.name != "xml" || view.value != "version=\"1.0\"")
+		throw Exception("Processing instruction not read correctly");
+
+	if (!tokenizer.next_view(&view) || view.type != XMLToken::COMMENT_TOKEN || view.value != "A &amp; B" || view.value.to_string() != "A & B")
+		throw Exception("Comment not read correctly");
+
+	if (!tokenizer.next_view(&view) || view.type != XMLToken::ELEMENT_TOKEN || view.variant != XMLToken::BEGIN || view.name != "sprite" || view.attributes.size() != 2)
+		throw Exception("Element not read correctly");
+	if (view.attributes[0].first != "name" || view.attributes[0].second != "a&amp;b" || view.attributes[0].second.to_string() != "a&b")
+		throw Exception("Attribute not read correctly");
+	if (view.attributes[1].first != "file" || view.attributes[1].second.to_string() != "x.png")
+		throw Exception("Single quoted attribute not read correctly");
+
+	// The views must point directly into the caller buffer
+	if (view.name.get_data() < xml.data() || view.name.get_data() >= xml.data() + xml.length())
+		throw Exception("Token view does not reference the XML data");
+
+	if (!tokenizer.next_view(&view) || view.type != XMLToken::TEXT_TOKEN || view.value.to_string() != "some <text>")
+		throw Exception("Text not read correctly");
+
+	if (!tokenizer.next_view(&view) || view.type != XMLToken::CDATA_SECTION_TOKEN || view.value.to_string() != "&amp;")
+		throw Exception("CDATA section must not be unescaped");
+
+	if (!tokenizer.next_view(&view) || view.type != XMLToken::ELEMENT_TOKEN || view.variant != XMLToken::SINGLE || view.name != "frame")
+		throw Exception("Single element not read correctly");
+
+	if (!tokenizer.next_view(&view) || view.type != XMLToken::ELEMENT_TOKEN || view.variant != XMLToken::END || view.name != "sprite")
+		throw Exception("End element not read correctly");
+
+	if (tokenizer.next_view(&view) || view.type != XMLToken::NULL_TOKEN || tokenizer.is_data_needed())
+		throw Exception("Tokenizer did not stop at the end of the data");
+
+	// The IODevice tokenizer must produce the same tokens
+	XMLTokenizer view_tokenizer(xml.data(), xml.length());
+	DataBuffer buffer(xml.data(), xml.length());
+	IODevice_Memory device(buffer);
+	XMLTokenizer device_tokenizer(device);
+	compare_tokens(read_tokens(view_tokenizer), read_tokens(device_tokenizer));
+}
+
+void TestApp::verify_unescape()
+{
+	const char *tests[][2] =
+	{
+		{ "", "" },
+		{ "plain", "plain" },
+		{ "&quot;&apos;&lt;&gt;&amp;", "\"'<>&" },
+		{ "&amp;lt;", "&lt;" },
+		{ "&amp;amp;", "&amp;" },
+		{ "a & b &unknown; &", "a & b &unknown; &" },
+		{ "&lt", "&lt" },
+		{ "x&gt;y&quot", "x>y&quot" }
+	};
+
+	for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+	{
+		XMLTokenString text(tests[i][0], strlen(tests[i][0]), true);
+		if (text.to_string() != tests[i][1])
+			throw Exception(string_format("Unescaping %1 gave %2", tests[i][0], text.to_string()));
+
+		XMLTokenString raw(tests[i][0], strlen(tests[i][0]), false);
+		if (raw.to_string() != tests[i][0])
+			throw Exception("Unescaped text that was not escaped");
+	}
+}
+
+void TestApp::verify_errors()
+{
+	const char *invalid[] = { "<a", "<a b=\"c", "<!-- a", "<![CDATA[ a", "<?pi a" };
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+	{
+		bool failed = false;
+		try
+		{
+			XMLTokenizer tokenizer(invalid[i], strlen(invalid[i]));
+			read_tokens(tokenizer);
+		}
+		catch (Exception &)
+		{
+			failed = true;
+		}
+		if (!failed)
+			throw Exception(string_format("XMLTokenizer accepted invalid XML: %1", invalid[i]));
+
+		// Incremental tokenizers wait for more data until the end of data is reached
+		XMLTokenizer tokenizer = XMLTokenizer::create_incremental();
+		tokenizer.add_data(invalid[i], strlen(invalid[i]));
+		XMLTokenView view;
+		if (tokenizer.next_view(&view) || !tokenizer.is_data_needed())
+			throw Exception(string_format("Incremental XMLTokenizer did not ask for more data: %1", invalid[i]));
+
+		failed = false;
+		try
+		{
+			tokenizer.end_of_data();
+			tokenizer.next_view(&view);
+		}
+		catch (Exception &)
+		{
+			failed = true;
+		}
+		if (!failed)
+			throw Exception(string_format("Incremental XMLTokenizer accepted invalid XML: %1", invalid[i]));
+	}
+}
+
+void TestApp::verify_incremental(const std::string &xml, int chunk_size)
+{
+	XMLTokenizer tokenizer(xml.data(), xml.length());
+	std::vector<XMLToken> expected = read_tokens(tokenizer);
+
+	std::vector<XMLToken> tokens;
+	XMLTokenizer incremental = XMLTokenizer::create_incremental();
+	XMLTokenView view;
+	for (std::string::size_type pos = 0; pos < xml.length(); pos += chunk_size)
+	{
+		incremental.add_data(xml.data() + pos, std::min((std::string::size_type)chunk_size, xml.length() - pos));
+		while (incremental.next_view(&view))
+		{
+			tokens.push_back(XMLToken());
+			view.to_token(tokens.back());
+		}
+		if (!incremental.is_data_needed())
+			throw Exception("Incremental XMLTokenizer stopped before the end of data");
+	}
+
+	incremental.end_of_data();
+	while (incremental.next_view(&view))
+	{
+		tokens.push_back(XMLToken());
+		view.to_token(tokens.back());
+	}
+	if (incremental.is_data_needed())
+		throw Exception("Incremental XMLTokenizer needs data after the end of data");
+
+	compare_tokens(expected, tokens);
+}
+
+std::vector<XMLToken> TestApp::read_tokens(XMLTokenizer &tokenizer)
+{
+	std::vector<XMLToken> tokens;
+	XMLToken token;
+	tokenizer.next(&token);
+	while (token.type != XMLToken::NULL_TOKEN)
+	{
+		tokens.push_back(token);
+		tokenizer.next(&token);
+	}
+	return tokens;
+}
+
+void TestApp::compare_tokens(const std::vector<XMLToken> &tokens1, const std::vector<XMLToken> &tokens2)
+{
+	if (tokens1.size() != tokens2.size())
+		throw Exception(string_format("Token count mismatch, %1 and %2", (int)tokens1.size(), (int)tokens2.size()));
+
+	for (size_t i = 0; i < tokens1.size(); i++)
+	{
+		const XMLToken &a = tokens1[i];
+		const XMLToken &b = tokens2[i];
+		if (a.type != b.type || a.variant != b.variant || a.name != b.name || a.value != b.value || a.attributes != b.attributes)
+			throw Exception(string_format("Token %1 mismatch", (int)i));
+	}
+}
+
+std::string TestApp::create_resources(int num_resources)
+{
+	std::string xml = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<resources>\n";
+	for (int i = 0; i < num_resources; i++)
+	{
+		xml += string_format("  <sprite name=\"sprite_%1\" x=\"%2\" y='%3' caption=\"A &amp; B &lt;%1&gt;\">\n", i, i * 3, i * 7);
+		xml += string_format("    <!-- frame list %1 -->\n", i);
+		xml += string_format("    <image file=\"images/sprite_%1.png\" />\n", i);
+		xml += string_format("    Description of &quot;sprite %1&quot;\n", i);
+		xml += "  </sprite>\n";
+	}
+	xml += "</resources>\n";
+	return xml;
+}
+
+void TestApp::benchmark_tokenizer(const std::string &xml)
+{
+	const int iterations = 3;
+	double megabytes = xml.length() / (1024.0 * 1024.0);
+	Console::write_line("");
+	Console::write_line("Tokenizer throughput, %1 MB of XML", StringHelp::double_to_text(megabytes, 1));
+
+	ubyte64 start_time = System::get_microseconds();
+	int tokens = 0;
+	for (int i = 0; i < iterations; i++)
+	{
+		DataBuffer buffer(xml.data(), xml.length());
+		IODevice_Memory device(buffer);
+		XMLTokenizer tokenizer(device);
+		XMLToken token;
+		tokenizer.next(&token);
+		while (token.type != XMLToken::NULL_TOKEN)
+		{
+			tokens++;
+			tokenizer.next(&token);
+		}
+	}
+	ubyte64 token_time = System::get_microseconds() - start_time;
+
+	start_time = System::get_microseconds();
+	int view_tokens = 0;
+	for (int i = 0; i < iterations; i++)
+	{
+		XMLTokenizer tokenizer(xml.data(), xml.length());
+		XMLTokenView view;
+		while (tokenizer.next_view(&view))
+			view_tokens++;
+	}
+	ubyte64 view_time = System::get_microseconds() - start_time;
+
+	start_time = System::get_microseconds();
+	for (int i = 0; i < iterations; i++)
+	{
+		XMLTokenizer tokenizer = XMLTokenizer::create_incremental();
+		XMLTokenView view;
+		for (std::string::size_type pos = 0; pos < xml.length(); pos += 65536)
+		{
+			tokenizer.add_data(xml.data() + pos, std::min((std::string::size_type)65536, xml.length() - pos));
+			while (tokenizer.next_view(&view))
+				;
+		}
+		tokenizer.end_of_data();
+		while (tokenizer.next_view(&view))
+			;
+	}
+	ubyte64 incremental_time = System::get_microseconds() - start_time;
+
+	if (tokens != view_tokens)
+		throw Exception("XMLToken and XMLTokenView disagree on the number of tokens");
+
+	Console::write_line("next(XMLToken):          %1 MB/s (%2 tokens)", StringHelp::double_to_text(megabytes * iterations * 1000000.0 / token_time, 1), tokens / iterations);
+	Console::write_line("next_view(XMLTokenView): %1 MB/s", StringHelp::double_to_text(megabytes * iterations * 1000000.0 / view_time, 1));
+	Console::write_line("incremental, 64 KB:      %1 MB/s", StringHelp::double_to_text(megabytes * iterations * 1000000.0 / incremental_time, 1));
+}
@@ -0,0 +1,254 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "test.h"
+
+// This is the Program class that is called by Application
+class Program
+{
+public:
+	static int main(const std::vector<std::string> &args)
+	{
+		// Initialize ClanLib base components
+		SetupCore setup_core;
+
+		// Start the Application
+		TestApp app;
+		int retval = app.main(args);
+		return retval;
+	}
+};
+
+// Instantiate Application, informing it where the Program is located
+Application app(&Program::main);
+
+int TestApp::main(const std::vector<std::string> &args)
+{
+	ConsoleWindow console("Console");
+
+	try
+	{
+		run_test();
+		console.display_close_message();
+	}
+	catch(Exception error)
+	{
+		Console::write_line("Unhandled exception: %1", error.message);
+		console.display_close_message();
+		return -1;
+	}
+
+	return 0;
+}
+
+void TestApp::run_test()
+{
+	verify_expressions();
+	verify_cache();
+	benchmark_queries(create_resources(2000), 2000);
+}
+
+void TestApp::verify_expressions()
+{
+	std::string xml =
+		"<resources id='r'>"
+		"<section id='s1' name='sprites'>"
+		"<sprite id='a' name='player' type='animated'><image id='a1' file='p1.png'/><image id='a2' file='p2.png'/></sprite>"
+		"<sprite id='b' name='enemy'><image id='b1' file='e1.png'/>text<!--comment--></sprite>"
+		"<sprite id='c' name='player'><image id='c1' file='p3.png'/></sprite>"
+		"</section>"
+		"<section id='s2' name='sounds'><sample id='d' name='boom' file='boom.ogg'/><sprite id='e' name='ghost'/></section>"
+		"</resources>";
+	DataBuffer buffer(xml.data(), xml.length());
+	IODevice_Memory device(buffer);
+	DomDocument document(device);
+	DomNode root = document.get_document_element();
+	DomNode section = root.select_node("section");
+
+	struct Test
+	{
+		const char *expression;
+		bool location_path;
+	};
+
+	Test tests[] =
+	{
+		{ "section", true },
+		{ "section/sprite", true },
+		{ "section/sprite/@name", true },
+		{ "section/sprite[@name='player']", true },
+		{ "section/sprite[@name!='player']", true },
+		{ "section/sprite[@type]", true },
+		{ "section/sprite[@name='player'][2]", true },
+		{ "section/sprite[2]/image[1]/@file", true },
+		{ "section/*", true },
+		{ "section/sprite/@*", true },
+		{ "section/sprite/node()", true },
+		{ "section/sprite/text()", true },
+		{ "section/sprite/comment()", true },
+		{ "/resources/section", true },
+		{ "/", true },
+		{ "//image", true },
+		{ "//sprite[@name='player']/image", true },
+		{ "//@file", true },
+		{ "descendant::image", true },
+		{ "descendant-or-self::sprite", true },
+		{ "child::section/attribute::name", true },
+		{ "section/sprite/..", true },
+		{ "section/./sprite", true },
+		{ "self::resources", true },
+		{ "section/sprite[position()=2]", false },
+		{ "section/sprite[@name='player' and @type]", false },
+		{ "section/sprite[image/@file='e1.png']", false },
+		{ "section/sprite | section/sample", false },
+		{ "ancestor::*", false },
+		{ "following-sibling::*", false }
+	};
+
+	for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+	{
+		XPathExpression expression(tests[i].expression);
+		if (expression.is_location_path() != tests[i].location_path)
+			throw Exception(string_format("Expression %1 compiled differently than expected", tests[i].expression));
+
+		DomNode contexts[] = { document, root, section };
+		for (size_t j = 0; j < sizeof(contexts) / sizeof(contexts[0]); j++)
+		{
+			XPathEvaluator evaluator;
+			std::vector<DomNode> expected = evaluator.evaluate(tests[i].expression, contexts[j]).get_node_set();
+			compare_node_sets(tests[i].expression, expected, expression.select_nodes(contexts[j]));
+			compare_node_sets(tests[i].expression, expected, expression.evaluate(contexts[j]).get_node_set());
+			compare_node_sets(tests[i].expression, expected, contexts[j].select_nodes(tests[i].expression));
+		}
+	}
+
+	// Descendant axes must stay within the context node
+	if (section.select_nodes("descendant-or-self::sprite").size() != 3)
+		throw Exception("descendant-or-self axis left the context node");
+
+	// Syntax errors are reported when the expression is evaluated
+	XPathExpression invalid("section/child::");
+	bool failed = false;
+	try
+	{
+		invalid.evaluate(root);
+	}
+	catch (Exception &)
+	{
+		failed = true;
+	}
+	if (!failed)
+		throw Exception("Invalid expression was accepted");
+}
+
+void TestApp::verify_cache()
+{
+	XPathExpression::set_cache_size(2);
+
+	XPathExpression a = XPathExpression::get_cached("a");
+	if (&a.get_expression() != &XPathExpression::get_cached("a").get_expression())
+		throw Exception("Cached expression was compiled again");
+
+	XPathExpression::get_cached("b");
+	XPathExpression::get_cached("c");
+	if (&a.get_expression() == &XPathExpression::get_cached("a").get_expression())
+		throw Exception("Least recently used expression was not evicted");
+
+	XPathExpression::set_cache_size(256);
+}
+
+void TestApp::compare_node_sets(const std::string &expression, const std::vector<DomNode> &nodes1, const std::vector<DomNode> &nodes2)
+{
+	if (nodes1.size() != nodes2.size())
+		throw Exception(string_format("%1 returned %2 and %3 nodes", expression, (int)nodes1.size(), (int)nodes2.size()));
+
+	for (size_t i = 0; i < nodes1.size(); i++)
+	{
+		if (describe_node(nodes1[i]) != describe_node(nodes2[i]))
+			throw Exception(string_format("%1 returned %2 instead of %3", expression, describe_node(nodes2[i]), describe_node(nodes1[i])));
+	}
+}
+
+std::string TestApp::describe_node(const DomNode &node)
+{
+	std::string id = node.is_element() ? node.to_element().get_attribute("id") : std::string();
+	return string_format("%1 %2 %3 %4", node.get_node_type(), node.get_node_name(), node.get_node_value(), id);
+}
+
+DomDocument TestApp::create_resources(int num_resources)
+{
+	std::string xml = "<resources>";
+	for (int i = 0; i < num_resources; i++)
+		xml += string_format("<sprite name='sprite_%1'><image file='sprite_%2.png'/><frame x='%3'/><frame x='%4'/></sprite>", i, i, i, i + 1);
+	xml += "</resources>";
+
+	DataBuffer buffer(xml.data(), xml.length());
+	IODevice_Memory device(buffer);
+	return DomDocument(device);
+}
+
+void TestApp::benchmark_queries(DomDocument document, int num_resources)
+{
+	const int num_queries = 2000;
+	DomNode root = document.get_document_element();
+	std::vector<std::string> queries;
+	for (int i = 0; i < num_queries; i++)
+		queries.push_back(string_format("sprite[@name='sprite_%1']/image/@file", (i * 7) % num_resources));
+
+	Console::write_line("");
+	Console::write_line("Repeated queries on %1 resources", num_resources);
+
+	ubyte64 start_time = System::get_microseconds();
+	size_t evaluator_nodes = 0;
+	XPathEvaluator evaluator;
+	for (int i = 0; i < num_queries; i++)
+		evaluator_nodes += evaluator.evaluate(queries[i], root).get_node_set().size();
+	ubyte64 evaluator_time = System::get_microseconds() - start_time;
+
+	start_time = System::get_microseconds();
+	size_t compiled_nodes = 0;
+	std::vector<XPathExpression> expressions;
+	for (int i = 0; i < num_queries; i++)
+		expressions.push_back(XPathExpression(queries[i]));
+	for (int i = 0; i < num_queries; i++)
+		compiled_nodes += expressions[i].select_nodes(root).size();
+	ubyte64 compiled_time = System::get_microseconds() - start_time;
+
+	start_time = System::get_microseconds();
+	size_t select_nodes = 0;
+	for (int i = 0; i < num_queries; i++)
+		select_nodes += root.select_nodes(queries[i]).size();
+	ubyte64 select_time = System::get_microseconds() - start_time;
+
+	if (evaluator_nodes != num_queries || compiled_nodes != num_queries || select_nodes != num_queries)
+		throw Exception(string_format("Queries returned the wrong number of nodes (%1, %2, %3)", (int)evaluator_nodes, (int)compiled_nodes, (int)select_nodes));
+
+	Console::write_line("XPathEvaluator:        %1 queries/s", (int)(num_queries * 1000000.0 / evaluator_time));
+	Console::write_line("XPathExpression:       %1 queries/s", (int)(num_queries * 1000000.0 / compiled_time));
+	Console::write_line("DomNode::select_nodes: %1 queries/s", (int)(num_queries * 1000000.0 / select_time));
+}
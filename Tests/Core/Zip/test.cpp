@@ -54,6 +54,13 @@ int TestApp::main(const std::vector<std::string> &args)
 	try
 	{
 		run_test();
+		{
+			TempFile archive_file("ZipArchive.zip");
+			test_archive(archive_file.filename);
+			benchmark_archive(archive_file.filename);
+		}
+		test_parallel_compression();
+		test_parallel_zip_writer();
 		console.display_close_message();
 	}
 	catch(Exception error)
@@ -95,7 +102,7 @@ void TestApp::run_test()
 		Console::write_line("File: %1", zip_reader.get_filename());
 		DataBuffer buffer(zip_reader.get_uncompressed_size());
 		zip_reader.read_file_data(buffer.get_data(), buffer.get_size());
-		std::string str8(buffer.get_data(), buffer.get_size(), false);
+		std::string str8(buffer.get_data(), buffer.get_size());
 		Console::write_line("Contents: %1", StringHelp::utf8_to_text(str8));
 	}
 }
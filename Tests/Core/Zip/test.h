@@ -31,8 +31,43 @@
 
 #include <ClanLib/core.h>
 #include <ClanLib/application.h>
+#include <cstdio>
+#include <cstdlib>
+#ifdef WIN32
+#include <windows.h>
+#endif
 using namespace clan;
 
+// File in the temp directory that is deleted again when it goes out of scope, also when a test fails
+class TempFile
+{
+public:
+	TempFile(const std::string &name) : filename(PathHelp::combine(get_temp_path(), name))
+	{
+	}
+
+	~TempFile()
+	{
+		remove(filename.c_str());
+	}
+
+	std::string filename;
+
+private:
+	static std::string get_temp_path()
+	{
+#ifdef WIN32
+		char path[MAX_PATH];
+		if (GetTempPathA(MAX_PATH, path) == 0)
+			return ".";
+		return path;
+#else
+		const char *path = getenv("TMPDIR");
+		return (path && path[0]) ? path : "/tmp";
+#endif
+	}
+};
+
 class TestApp
 {
 public:
@@ -40,6 +75,10 @@ public:
 
 private:
 	void run_test();
+	void test_archive(const std::string &filename);
+	void benchmark_archive(const std::string &filename);
+	void test_parallel_compression();
+	void test_parallel_zip_writer();
 };
 
 #endif
@@ -0,0 +1,193 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "test.h"
+
+namespace
+{
+	const int num_small_files = 40000;
+	const int large_file_size = 8*1024*1024;
+
+	DataBuffer create_test_data(int size, unsigned int seed)
+	{
+		// Text-like data that compresses to roughly half its size
+		static const char alphabet[] = "ClanLib zip archive test data\r\n";
+		DataBuffer data(size);
+		unsigned int value = seed;
+		for (int i = 0; i < size; i++)
+		{
+			value = value * 1103515245 + 12345;
+			data.get_data()[i] = alphabet[(value >> 16) % (sizeof(alphabet) - 1)];
+		}
+		return data;
+	}
+
+	std::string get_small_filename(int index)
+	{
+		return string_format("dir%1/file%2.txt", index % 100, index);
+	}
+
+	void verify_contents(IODevice &device, const DataBuffer &expected, int offset, int length)
+	{
+		DataBuffer buffer(length);
+		int received = device.read(buffer.get_data(), length);
+		if (received != length || memcmp(buffer.get_data(), expected.get_data() + offset, length) != 0)
+			throw Exception(string_format("Zip file entry contents differ at offset %1", offset));
+	}
+}
+
+void TestApp::test_archive(const std::string &filename)
+{
+	Console::write_line("Creating synthetic archive with %1 files", num_small_files + 2);
+
+	DataBuffer large_data = create_test_data(large_file_size, 1);
+	{
+		File file(filename, File::create_always, File::access_write);
+		ZipWriter zip_writer(file);
+		for (int i = 0; i < num_small_files; i++)
+		{
+			std::string contents = string_format("Contents of file %1", i);
+			zip_writer.begin_file(get_small_filename(i), (i % 2) == 0);
+			zip_writer.write_file_data(contents.data(), contents.length());
+			zip_writer.end_file();
+		}
+		zip_writer.begin_file("large_deflated.bin", true);
+		zip_writer.write_file_data(large_data.get_data(), large_data.get_size());
+		zip_writer.end_file();
+		zip_writer.begin_file("large_stored.bin", false);
+		zip_writer.write_file_data(large_data.get_data(), large_data.get_size());
+		zip_writer.end_file();
+		zip_writer.write_toc();
+	}
+
+	File archive_file(filename, File::open_existing, File::access_read);
+	ZipArchive unmapped_archive(archive_file);
+	ZipArchive mapped_archive(filename);
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		ZipArchive &archive = (pass == 0) ? unmapped_archive : mapped_archive;
+		Console::write_line(pass == 0 ? "Verifying archive read through IODevice" : "Verifying memory mapped archive");
+
+		for (int i = 0; i < num_small_files; i += 997)
+		{
+			std::string contents = string_format("Contents of file %1", i);
+			IODevice device = archive.open_file(get_small_filename(i));
+			if (device.get_size() != (int)contents.length())
+				throw Exception("Zip file entry has the wrong size");
+			DataBuffer buffer(device.get_size());
+			device.read(buffer.get_data(), buffer.get_size());
+			if (std::string(buffer.get_data(), buffer.get_size()) != contents)
+				throw Exception("Zip file entry has the wrong contents");
+		}
+
+		bool missing_found = true;
+		try
+		{
+			archive.open_file("does_not_exist.txt");
+		}
+		catch (Exception &)
+		{
+			missing_found = false;
+		}
+		if (missing_found)
+			throw Exception("Opening a missing zip file entry did not fail");
+
+		const char *large_files[] = { "large_deflated.bin", "large_stored.bin" };
+		for (int file_index = 0; file_index < 2; file_index++)
+		{
+			IODevice device = archive.open_file(large_files[file_index]);
+			if (device.get_size() != large_file_size)
+				throw Exception("Zip file entry has the wrong size");
+
+			// Sequential read followed by random seeks in both directions
+			verify_contents(device, large_data, 0, large_file_size);
+			unsigned int value = 12345;
+			for (int i = 0; i < 200; i++)
+			{
+				value = value * 1103515245 + 12345;
+				int offset = (value >> 4) % (large_file_size - 4096);
+				device.seek(offset, IODevice::seek_set);
+				if (device.get_position() != offset)
+					throw Exception("Zip file entry has the wrong position after seek");
+
+				char peeked[16];
+				if (device.peek(peeked, 16) != 16 || memcmp(peeked, large_data.get_data() + offset, 16) != 0)
+					throw Exception("Zip file entry peek returned the wrong data");
+				verify_contents(device, large_data, offset, 4096);
+			}
+
+			device.seek(-100, IODevice::seek_end);
+			verify_contents(device, large_data, large_file_size - 100, 100);
+			device.seek(-200, IODevice::seek_cur);
+			verify_contents(device, large_data, large_file_size - 200, 200);
+		}
+
+		int view_size = 0;
+		const unsigned char *view = archive.get_file_view("large_stored.bin", view_size);
+		if (pass == 0 && view)
+			throw Exception("Unmapped zip archive returned a file view");
+		if (pass == 1 && (view == 0 || view_size != large_file_size || memcmp(view, large_data.get_data(), large_file_size) != 0))
+			throw Exception("Memory mapped zip archive returned the wrong file view");
+		if (archive.get_file_view("large_deflated.bin", view_size))
+			throw Exception("Zip archive returned a file view for a compressed file");
+	}
+}
+
+void TestApp::benchmark_archive(const std::string &filename)
+{
+	ZipArchive archive(filename);
+	unsigned int value = 54321;
+
+	const int num_opens = 100000;
+	ubyte64 start_time = System::get_microseconds();
+	for (int i = 0; i < num_opens; i++)
+	{
+		value = value * 1103515245 + 12345;
+		IODevice device = archive.open_file(get_small_filename((value >> 8) % num_small_files));
+	}
+	ubyte64 end_time = System::get_microseconds();
+	Console::write_line("Random open_file: %1 us per open", StringHelp::double_to_text((end_time - start_time) / (double)num_opens, 3));
+
+	const char *large_files[] = { "large_deflated.bin", "large_stored.bin" };
+	for (int file_index = 0; file_index < 2; file_index++)
+	{
+		const int num_seeks = 2000;
+		char buffer[4096];
+		IODevice device = archive.open_file(large_files[file_index]);
+		start_time = System::get_microseconds();
+		for (int i = 0; i < num_seeks; i++)
+		{
+			value = value * 1103515245 + 12345;
+			device.seek((value >> 4) % (large_file_size - sizeof(buffer)), IODevice::seek_set);
+			device.read(buffer, sizeof(buffer));
+		}
+		end_time = System::get_microseconds();
+		Console::write_line("Random seek and 4 KB read in %1: %2 us per seek", large_files[file_index], StringHelp::double_to_text((end_time - start_time) / (double)num_seeks, 3));
+	}
+}
@@ -0,0 +1,148 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "test.h"
+
+namespace
+{
+	DataBuffer create_compressible_data(int size, unsigned int seed)
+	{
+		// Words from a small vocabulary, so the data compresses like text
+		static const char *words[] = { "clan", "lib ", "zip ", "deflate ", "block ", "thread ", "queue ", "data\r\n" };
+		DataBuffer data(size);
+		unsigned int value = seed;
+		int pos = 0;
+		while (pos < size)
+		{
+			value = value * 1103515245 + 12345;
+			const char *word = words[(value >> 16) % 8];
+			for (int i = 0; word[i] && pos < size; i++)
+				data.get_data()[pos++] = word[i];
+		}
+		return data;
+	}
+
+	bool equal(const DataBuffer &a, const DataBuffer &b)
+	{
+		return a.get_size() == b.get_size() && (a.get_size() == 0 || memcmp(a.get_data(), b.get_data(), a.get_size()) == 0);
+	}
+}
+
+void TestApp::test_parallel_compression()
+{
+	Console::write_line("Block-parallel deflate");
+
+	const int thread_counts[] = { 1, 4, 16 };
+	const int data_sizes[] = { 0, 1000, ZLibCompression::parallel_block_size, ZLibCompression::parallel_block_size + 1, 5*1024*1024 + 123 };
+	for (int size_index = 0; size_index < 5; size_index++)
+	{
+		DataBuffer data = create_compressible_data(data_sizes[size_index], size_index);
+		for (int raw = 0; raw < 2; raw++)
+		{
+			DataBuffer first_output;
+			for (int thread_index = 0; thread_index < 3; thread_index++)
+			{
+				WorkQueue work_queue(false, thread_counts[thread_index]);
+				DataBuffer compressed = ZLibCompression::compress(data, work_queue, raw != 0);
+				if (!equal(ZLibCompression::decompress(compressed, raw != 0), data))
+					throw Exception(string_format("Block-parallel deflate round trip failed for %1 bytes", data.get_size()));
+
+				if (thread_index == 0)
+					first_output = compressed;
+				else if (!equal(compressed, first_output))
+					throw Exception("Block-parallel deflate output depends on the number of threads");
+			}
+		}
+	}
+
+	DataBuffer data = create_compressible_data(16*1024*1024, 1);
+	ubyte64 start_time = System::get_microseconds();
+	DataBuffer serial_output = ZLibCompression::compress(data);
+	ubyte64 end_time = System::get_microseconds();
+	Console::write_line("  serial   : %1 MB/s, ratio %2", (int)(data.get_size() / (double)(end_time - start_time)), StringHelp::double_to_text(serial_output.get_size() / (double)data.get_size(), 3));
+
+	for (int thread_index = 0; thread_index < 3; thread_index++)
+	{
+		WorkQueue work_queue(false, thread_counts[thread_index]);
+		start_time = System::get_microseconds();
+		DataBuffer output = ZLibCompression::compress(data, work_queue);
+		end_time = System::get_microseconds();
+		Console::write_line("  %1 threads: %2 MB/s, ratio %3", thread_counts[thread_index], (int)(data.get_size() / (double)(end_time - start_time)), StringHelp::double_to_text(output.get_size() / (double)data.get_size(), 3));
+	}
+}
+
+void TestApp::test_parallel_zip_writer()
+{
+	Console::write_line("Parallel ZipWriter");
+
+	TempFile archive_file("ZipWriterParallel.zip");
+	std::vector<std::string> filenames;
+	std::vector<DataBuffer> contents;
+	for (int i = 0; i < 100; i++)
+	{
+		filenames.push_back(string_format("file%1.txt", i));
+		contents.push_back(create_compressible_data((i % 10 == 0) ? 1536*1024 : 20000 + i * 100, i));
+	}
+
+	const int thread_counts[] = { 1, 4, 16 };
+	std::vector<ZipFileEntry> first_entries;
+	for (int thread_index = 0; thread_index < 3; thread_index++)
+	{
+		WorkQueue work_queue(false, thread_counts[thread_index]);
+		ubyte64 start_time = System::get_microseconds();
+		{
+			File file(archive_file.filename, File::create_always, File::access_read_write);
+			ZipWriter zip_writer(file, work_queue, true);
+			for (size_t i = 0; i < filenames.size(); i++)
+				zip_writer.add_file(filenames[i], contents[i], (i % 7) != 3);
+			zip_writer.write_toc();
+		}
+		ubyte64 end_time = System::get_microseconds();
+		Console::write_line("  %1 threads: %2 ms", thread_counts[thread_index], (int)((end_time - start_time) / 1000));
+
+		ZipArchive archive(archive_file.filename);
+		std::vector<ZipFileEntry> entries = archive.get_file_list();
+		if (entries.size() != filenames.size())
+			throw Exception("Parallel ZipWriter wrote the wrong number of entries");
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].get_archive_filename() != filenames[i])
+				throw Exception("Parallel ZipWriter wrote the entries out of order");
+			if (thread_index > 0 && entries[i].get_compressed_size() != first_entries[i].get_compressed_size())
+				throw Exception("Parallel ZipWriter output depends on the number of threads");
+
+			IODevice device = archive.open_file(filenames[i]);
+			DataBuffer buffer(device.get_size());
+			device.read(buffer.get_data(), buffer.get_size());
+			if (!equal(buffer, contents[i]))
+				throw Exception(string_format("Parallel ZipWriter wrote the wrong contents for %1", filenames[i]));
+		}
+		if (thread_index == 0)
+			first_entries = entries;
+	}
+}
@@ -0,0 +1,148 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "test.h"
+
+// This is the Program class that is called by Application
+class Program
+{
+public:
+	static int main(const std::vector<std::string> &args)
+	{
+		// Initialize ClanLib base components
+		SetupCore setup_core;
+
+		// Initialize the ClanLib display component
+		SetupDisplay setup_display;
+
+		// Initilize the OpenGL drivers
+		SetupGL setup_gl;
+
+		// Start the Application
+		TestApp app;
+		int retval = app.main(args);
+		return retval;
+	}
+};
+
+// Instantiate Application, informing it where the Program is located
+Application app(&Program::main);
+
+// CJK Unified Ideographs
+static const unsigned int first_cjk_glyph = 0x4e00;
+static const int num_cjk_glyphs = 20000;
+
+int TestApp::main(const std::vector<std::string> &args)
+{
+	ConsoleWindow console("Console");
+
+	try
+	{
+		run_test();
+		console.display_close_message();
+	}
+	catch(Exception error)
+	{
+		Console::write_line("Unhandled exception: %1", error.message);
+		console.display_close_message();
+		return -1;
+	}
+
+	return 0;
+}
+
+void TestApp::run_test()
+{
+	quit = false;
+
+	DisplayWindow window("ClanLib GlyphCache Test", 1024, 768);
+	Slot slot_quit = window.sig_window_close().connect(this, &TestApp::on_window_close);
+	Canvas canvas(window);
+
+	FontDescription desc("Sans");
+	desc.set_height(24);
+	desc.set_subpixel(false);
+
+	// Prefetch: rasterizes the glyphs of a full screen in parallel
+	Font prefetch_font(canvas, desc);
+	std::string page = get_cjk_text(first_cjk_glyph, 1500);
+	ubyte64 start_time = System::get_microseconds();
+	prefetch_font.prefetch(canvas, page);
+	ubyte64 prefetch_time = System::get_microseconds() - start_time;
+
+	Font serial_font(canvas, desc);
+	start_time = System::get_microseconds();
+	serial_font.get_text_size(canvas, page);
+	ubyte64 serial_time = System::get_microseconds() - start_time;
+
+	Console::write_line("1500 glyphs: prefetch %1 ms, on demand %2 ms", prefetch_time / 1000, serial_time / 1000);
+
+	// Scroll through far more glyphs than fit in the atlas memory limit, to exercise the eviction
+	Font font(canvas, desc);
+	const int glyphs_per_line = 40;
+	const int lines_per_frame = 28;
+	unsigned int scroll_glyph = first_cjk_glyph;
+	ubyte64 frame_start_time = System::get_microseconds();
+	int frames = 0;
+
+	while (!quit && scroll_glyph < first_cjk_glyph + num_cjk_glyphs)
+	{
+		canvas.clear(Colorf::black);
+
+		for (int line = 0; line < lines_per_frame; line++)
+		{
+			std::string text = get_cjk_text(scroll_glyph + line * glyphs_per_line, glyphs_per_line);
+			font.draw_text(canvas, 10.0f, 24.0f + line * 26.0f, text);
+		}
+		scroll_glyph += glyphs_per_line;
+
+		window.flip(0);
+		KeepAlive::process();
+
+		frames++;
+		if (frames % 100 == 0)
+		{
+			ubyte64 frame_end_time = System::get_microseconds();
+			Console::write_line("Frames %1-%2: %3 ms per frame", frames - 100, frames, StringHelp::double_to_text((frame_end_time - frame_start_time) / 100000.0, 2));
+			frame_start_time = frame_end_time;
+		}
+	}
+}
+
+std::string TestApp::get_cjk_text(unsigned int first_glyph, int length)
+{
+	std::string text;
+	for (int i = 0; i < length; i++)
+		text += StringHelp::unicode_to_utf8(first_cjk_glyph + (first_glyph - first_cjk_glyph + i) % num_cjk_glyphs);
+	return text;
+}
+
+void TestApp::on_window_close()
+{
+	quit = true;
+}
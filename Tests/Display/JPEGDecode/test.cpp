@@ -0,0 +1,237 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "test.h"
+#include <cmath>
+
+// This is the Program class that is called by Application
+class Program
+{
+public:
+	static int main(const std::vector<std::string> &args)
+	{
+		// Initialize ClanLib base components
+		SetupCore setup_core;
+
+		// Initialize the ClanLib display component
+		SetupDisplay setup_display;
+
+		// Start the Application
+		TestApp app;
+		int retval = app.main(args);
+		return retval;
+	}
+};
+
+// Instantiate Application, informing it where the Program is located
+Application app(&Program::main);
+
+const double TestApp::max_rounding_psnr_loss = 0.1;
+
+int TestApp::main(const std::vector<std::string> &args)
+{
+	ConsoleWindow console("Console");
+
+	try
+	{
+		run_test();
+		console.display_close_message();
+	}
+	catch(Exception error)
+	{
+		Console::write_line("Unhandled exception: %1", error.message);
+		console.display_close_message();
+		return -1;
+	}
+
+	return 0;
+}
+
+void TestApp::run_test()
+{
+	Console::write_line("JPEG decoding (%1 cores)", System::get_num_cores());
+	Console::write_line("");
+
+	test_image(2048, 1536, 90);
+	test_image(1001, 777, 75);
+	test_image(64, 48, 95);
+
+	Console::write_line("All tests passed");
+}
+
+// Restart markers do not change the coefficients of the image, so files with and without them
+// must decode to exactly the same pixels, whether the restart intervals are decoded in parallel or not.
+// The SSE2 and AVX2 code paths use the same float operations and must give the same pixels too.
+void TestApp::test_image(int width, int height, int quality)
+{
+	Console::write_line("%1x%2, quality %3:", width, height, quality);
+
+	PixelBuffer original = create_photo(width, height);
+	DataBuffer reference_jpeg = encode(original, quality, 0);
+
+	// The scalar code is the original decoder, which the SIMD paths may only differ from by rounding.
+	// Its PSNR against the original image is the floor for the other paths.
+	JPEGProvider::DecoderInstructions best_instructions = JPEGProvider::get_decoder_instructions();
+	JPEGProvider::set_decoder_instructions(JPEGProvider::decoder_scalar);
+	PixelBuffer scalar_reference = decode(reference_jpeg);
+	double scalar_psnr = get_psnr(original, scalar_reference);
+	JPEGProvider::set_decoder_instructions(best_instructions);
+
+	PixelBuffer reference = decode(reference_jpeg);
+	double psnr = get_psnr(original, reference);
+	if (psnr < scalar_psnr - max_rounding_psnr_loss)
+		throw Exception(string_format("Decoded image is worse than the scalar reference decode (PSNR %1 dB, reference %2 dB)", psnr, scalar_psnr));
+
+	int iterations = max(1, 50000000 / (width * height));
+	Console::write_line("   no restart markers: %1 MP/s, PSNR %2 dB, scalar reference %3 dB", decode_speed(reference_jpeg, iterations), psnr, scalar_psnr);
+
+	int restart_intervals[] = { 1, 7, 64, 512 };
+	for (int i = 0; i < 4; i++)
+	{
+		DataBuffer jpeg = encode(original, quality, restart_intervals[i]);
+		std::string test_name = string_format("restart interval %1", restart_intervals[i]);
+		compare_pixels(reference, decode(jpeg), test_name);
+		Console::write_line("   %1: %2 MP/s", test_name, decode_speed(jpeg, iterations));
+	}
+
+	// Every supported instruction set, decoded serially and with the parallel split forced, which
+	// otherwise only happens for large images on multi-core machines
+	JPEGProvider::DecoderInstructions simd_instructions[] = { JPEGProvider::decoder_sse2, JPEGProvider::decoder_avx2 };
+	const char *simd_names[] = { "SSE2", "AVX2" };
+	DataBuffer jpeg = encode(original, quality, 7);
+	for (int i = 0; i < 2; i++)
+	{
+		if (!JPEGProvider::is_decoder_instructions_supported(simd_instructions[i]))
+		{
+			Console::write_line("   %1: not supported by this CPU", simd_names[i]);
+			continue;
+		}
+
+		JPEGProvider::set_decoder_instructions(simd_instructions[i]);
+		for (int parallel = 0; parallel < 2; parallel++)
+		{
+			JPEGProvider::set_parallel_decode_forced(parallel != 0);
+			std::string test_name = string_format("%1 %2", simd_names[i], parallel ? "parallel" : "serial");
+			compare_pixels(reference, decode(reference_jpeg), test_name);
+			compare_pixels(reference, decode(jpeg), test_name + " with restart markers");
+		}
+		JPEGProvider::set_parallel_decode_forced(false);
+		Console::write_line("   %1: serial and parallel decodes identical", simd_names[i]);
+	}
+	JPEGProvider::set_decoder_instructions(best_instructions);
+	Console::write_line("");
+}
+
+PixelBuffer TestApp::create_photo(int width, int height)
+{
+	// Smooth gradients with sensor like noise and some hard edges
+	PixelBuffer image(width, height, tf_rgba8);
+	unsigned char *pixels = image.get_data_uint8();
+	unsigned int seed = 1;
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			seed = seed * 1103515245 + 12345;
+			int noise = (seed >> 16) % 24;
+			float fx = x / (float)width;
+			float fy = y / (float)height;
+			int red = (int)(128.0f + 100.0f * std::sin(fx * 9.0f + fy * 3.0f)) + noise;
+			int green = (int)(128.0f + 90.0f * std::cos(fy * 7.0f - fx * 2.0f)) + noise / 2;
+			int blue = (((x / 37) + (y / 53)) & 1) ? 220 + noise / 2 : 30 + noise;
+
+			unsigned char *p = pixels + (x + y * width) * 4;
+			p[0] = min(red, 255);
+			p[1] = min(green, 255);
+			p[2] = min(blue, 255);
+			p[3] = 255;
+		}
+	}
+	return image;
+}
+
+DataBuffer TestApp::encode(const PixelBuffer &image, int quality, int restart_interval)
+{
+	IODevice_Memory file;
+	JPEGProvider::save(image, file, quality, restart_interval);
+	return file.get_data();
+}
+
+PixelBuffer TestApp::decode(DataBuffer &jpeg)
+{
+	IODevice_Memory file(jpeg);
+	return JPEGProvider::load(file);
+}
+
+double TestApp::decode_speed(DataBuffer &jpeg, int iterations)
+{
+	PixelBuffer image;
+	ubyte64 start_time = System::get_microseconds();
+	for (int i = 0; i < iterations; i++)
+		image = decode(jpeg);
+	ubyte64 end_time = System::get_microseconds();
+
+	double megapixels = image.get_width() * (double)image.get_height() * iterations / 1000000.0;
+	return megapixels * 1000000.0 / max(end_time - start_time, (ubyte64)1);
+}
+
+void TestApp::compare_pixels(const PixelBuffer &expected, const PixelBuffer &actual, const std::string &test_name)
+{
+	if (expected.get_width() != actual.get_width() || expected.get_height() != actual.get_height())
+		throw Exception(string_format("%1: image size differs", test_name));
+
+	for (int y = 0; y < expected.get_height(); y++)
+	{
+		const unsigned int *expected_line = static_cast<const unsigned int *>(expected.get_line(y));
+		const unsigned int *actual_line = static_cast<const unsigned int *>(actual.get_line(y));
+		for (int x = 0; x < expected.get_width(); x++)
+		{
+			if (expected_line[x] != actual_line[x])
+				throw Exception(string_format("%1: pixel %2,%3 differs", test_name, x, y));
+		}
+	}
+}
+
+double TestApp::get_psnr(const PixelBuffer &original, const PixelBuffer &decoded)
+{
+	double error = 0.0;
+	for (int y = 0; y < original.get_height(); y++)
+	{
+		const unsigned char *original_line = static_cast<const unsigned char *>(original.get_line(y));
+		const unsigned char *decoded_line = static_cast<const unsigned char *>(decoded.get_line(y));
+		for (int x = 0; x < original.get_width() * 4; x++)
+		{
+			if ((x & 3) == 3)
+				continue;
+			double diff = original_line[x] - (double)decoded_line[x];
+			error += diff * diff;
+		}
+	}
+	double mean_error = error / (original.get_width() * original.get_height() * 3.0);
+	return mean_error > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mean_error) : 100.0;
+}
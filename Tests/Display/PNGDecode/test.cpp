@@ -0,0 +1,304 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "test.h"
+#include <cmath>
+
+// This is the Program class that is called by Application
+class Program
+{
+public:
+	static int main(const std::vector<std::string> &args)
+	{
+		// Initialize ClanLib base components
+		SetupCore setup_core;
+
+		// Initialize the ClanLib display component
+		SetupDisplay setup_display;
+
+		// Start the Application
+		TestApp app;
+		int retval = app.main(args);
+		return retval;
+	}
+};
+
+// Instantiate Application, informing it where the Program is located
+Application app(&Program::main);
+
+int TestApp::main(const std::vector<std::string> &args)
+{
+	ConsoleWindow console("Console");
+
+	try
+	{
+		run_test();
+		console.display_close_message();
+	}
+	catch(Exception error)
+	{
+		Console::write_line("Unhandled exception: %1", error.message);
+		console.display_close_message();
+		return -1;
+	}
+
+	return 0;
+}
+
+void TestApp::run_test()
+{
+	Console::write_line("PNG decoding");
+	Console::write_line("");
+
+	test_image(2048, 2048, 4);
+	test_image(2048, 2048, 3);
+	test_image(1001, 777, 4);
+	test_image(1001, 777, 3);
+	test_image(3, 5, 3);
+	test_truncated_stream();
+
+	Console::write_line("All tests passed");
+}
+
+// Every filter type must reproduce the original pixels exactly, both when decoding to
+// the native format and when converting rows directly into another pixel format.
+void TestApp::test_image(int width, int height, int channels)
+{
+	Console::write_line("%1x%2, %3 channels:", width, height, channels);
+
+	PixelBuffer original = create_atlas(width, height, channels);
+	int iterations = clamp(20000000 / (width * height), 1, 1000);
+
+	const char *filter_names[] = { "none", "sub", "up", "average", "paeth", "mixed" };
+	for (int filter_type = 0; filter_type < 6; filter_type++)
+	{
+		DataBuffer png = encode(original, channels, filter_type);
+		std::string test_name = string_format("filter %1", filter_names[filter_type]);
+		compare_pixels(original, decode(png, tf_rgba8), false, test_name);
+		compare_pixels(original, decode(png, tf_bgra8), true, test_name + " to bgra8");
+		Console::write_line("   %1: %2 MP/s", test_name, decode_speed(png, iterations));
+	}
+	Console::write_line("");
+}
+
+void TestApp::test_truncated_stream()
+{
+	PixelBuffer original = create_atlas(64, 64, 4);
+	DataBuffer png = encode(original, 4, 4, true);
+	try
+	{
+		decode(png, tf_rgba8);
+	}
+	catch (Exception &)
+	{
+		Console::write_line("Truncated image data rejected");
+		Console::write_line("");
+		return;
+	}
+	throw Exception("Truncated image data was not rejected");
+}
+
+PixelBuffer TestApp::create_atlas(int width, int height, int channels)
+{
+	// Tiles of flat color, smooth gradients and noise, like a texture atlas
+	PixelBuffer image(width, height, tf_rgba8);
+	unsigned char *pixels = image.get_data_uint8();
+	unsigned int seed = 1;
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			seed = seed * 1103515245 + 12345;
+			int noise = (seed >> 16) & 0xff;
+			int tile = ((x / 64) + (y / 64) * 3) % 3;
+
+			unsigned char *p = pixels + (x + y * width) * 4;
+			if (tile == 0)
+			{
+				p[0] = 40;
+				p[1] = 120;
+				p[2] = 200;
+			}
+			else if (tile == 1)
+			{
+				p[0] = (int)(128.0f + 100.0f * std::sin(x * 0.05f + y * 0.02f)) + noise % 8;
+				p[1] = (x + y) & 0xff;
+				p[2] = (x * y) & 0xff;
+			}
+			else
+			{
+				p[0] = noise;
+				p[1] = noise ^ 0x5a;
+				p[2] = (noise * 7) & 0xff;
+			}
+			p[3] = (channels == 4) ? ((x + y * 3) & 0xff) : 255;
+		}
+	}
+	return image;
+}
+
+DataBuffer TestApp::encode(const PixelBuffer &image, int channels, int filter_type, bool truncate_image_data)
+{
+	int width = image.get_width();
+	int height = image.get_height();
+	int scanline_size = width * channels;
+
+	DataBuffer raw_rows(height * scanline_size);
+	for (int y = 0; y < height; y++)
+	{
+		const unsigned char *input = static_cast<const unsigned char *>(image.get_line(y));
+		unsigned char *output = reinterpret_cast<unsigned char *>(raw_rows.get_data()) + y * scanline_size;
+		for (int x = 0; x < width; x++)
+		{
+			for (int c = 0; c < channels; c++)
+				output[x * channels + c] = input[x * 4 + c];
+		}
+	}
+
+	// Type 5 cycles through all filter types, one per row
+	DataBuffer filtered(height * (1 + scanline_size));
+	std::vector<unsigned char> zero_scanline(scanline_size);
+	for (int y = 0; y < height; y++)
+	{
+		const unsigned char *scanline = reinterpret_cast<const unsigned char *>(raw_rows.get_data()) + y * scanline_size;
+		const unsigned char *prev_scanline = (y > 0) ? scanline - scanline_size : &zero_scanline[0];
+		unsigned char *output = reinterpret_cast<unsigned char *>(filtered.get_data()) + y * (1 + scanline_size);
+		int row_filter = (filter_type < 5) ? filter_type : y % 5;
+		output[0] = row_filter;
+		filter_scanline(output + 1, scanline, prev_scanline, scanline_size, channels, row_filter);
+	}
+
+	DataBuffer image_data = ZLibCompression::compress(filtered, false);
+	int image_data_size = truncate_image_data ? image_data.get_size() / 2 : image_data.get_size();
+
+	unsigned char header[13] = { 0 };
+	header[0] = width >> 24; header[1] = width >> 16; header[2] = width >> 8; header[3] = width;
+	header[4] = height >> 24; header[5] = height >> 16; header[6] = height >> 8; header[7] = height;
+	header[8] = 8; // bit depth
+	header[9] = (channels == 4) ? 6 : 2; // truecolor with or without alpha
+
+	IODevice_Memory file;
+	file.set_big_endian_mode();
+	unsigned char magic[8] = { 0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A };
+	file.write(magic, 8);
+	write_chunk(file, "IHDR", header, 13);
+
+	// Split the image data over several IDAT chunks, as encoders commonly do
+	const int idat_chunk_size = 8192;
+	for (int pos = 0; pos < image_data_size; pos += idat_chunk_size)
+		write_chunk(file, "IDAT", image_data.get_data() + pos, min(idat_chunk_size, image_data_size - pos));
+
+	write_chunk(file, "IEND", 0, 0);
+	return file.get_data();
+}
+
+void TestApp::filter_scanline(unsigned char *output, const unsigned char *scanline, const unsigned char *prev_scanline, int byte_length, int bytes_per_pixel, int filter_type)
+{
+	for (int i = 0; i < byte_length; i++)
+	{
+		int a = (i >= bytes_per_pixel) ? scanline[i - bytes_per_pixel] : 0;
+		int b = prev_scanline[i];
+		int c = (i >= bytes_per_pixel) ? prev_scanline[i - bytes_per_pixel] : 0;
+
+		int predictor = 0;
+		switch (filter_type)
+		{
+		case 1: predictor = a; break;
+		case 2: predictor = b; break;
+		case 3: predictor = (a + b) / 2; break;
+		case 4:
+			{
+				int p = a + b - c;
+				int pa = std::abs(p - a);
+				int pb = std::abs(p - b);
+				int pc = std::abs(p - c);
+				if (pa <= pb && pa <= pc)
+					predictor = a;
+				else if (pb <= pc)
+					predictor = b;
+				else
+					predictor = c;
+			}
+			break;
+		}
+		output[i] = scanline[i] - predictor;
+	}
+}
+
+void TestApp::write_chunk(IODevice &file, const char *name, const void *data, int size)
+{
+	ubyte32 crc = HashFunctions::crc32(name, 4);
+	if (size > 0)
+		crc = HashFunctions::crc32(data, size, crc);
+
+	file.write_uint32(size);
+	file.write(name, 4);
+	if (size > 0)
+		file.write(data, size);
+	file.write_uint32(crc);
+}
+
+PixelBuffer TestApp::decode(DataBuffer &png, TextureFormat format)
+{
+	IODevice_Memory file(png);
+	return PNGProvider::load(file, format);
+}
+
+double TestApp::decode_speed(DataBuffer &png, int iterations)
+{
+	PixelBuffer image;
+	ubyte64 start_time = System::get_microseconds();
+	for (int i = 0; i < iterations; i++)
+		image = decode(png, tf_rgba8);
+	ubyte64 end_time = System::get_microseconds();
+
+	double megapixels = image.get_width() * (double)image.get_height() * iterations / 1000000.0;
+	return megapixels * 1000000.0 / max(end_time - start_time, (ubyte64)1);
+}
+
+void TestApp::compare_pixels(const PixelBuffer &expected, const PixelBuffer &actual, bool bgra, const std::string &test_name)
+{
+	if (expected.get_width() != actual.get_width() || expected.get_height() != actual.get_height())
+		throw Exception(string_format("%1: image size differs", test_name));
+
+	for (int y = 0; y < expected.get_height(); y++)
+	{
+		const unsigned char *expected_line = static_cast<const unsigned char *>(expected.get_line(y));
+		const unsigned char *actual_line = static_cast<const unsigned char *>(actual.get_line(y));
+		for (int x = 0; x < expected.get_width(); x++)
+		{
+			const unsigned char *e = expected_line + x * 4;
+			const unsigned char *a = actual_line + x * 4;
+			bool same = bgra ?
+				(e[0] == a[2] && e[1] == a[1] && e[2] == a[0] && e[3] == a[3]) :
+				(e[0] == a[0] && e[1] == a[1] && e[2] == a[2] && e[3] == a[3]);
+			if (!same)
+				throw Exception(string_format("%1: pixel %2,%3 differs", test_name, x, y));
+		}
+	}
+}
@@ -0,0 +1,55 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#ifndef _header_test_
+#define _header_test_
+
+#include <ClanLib/core.h>
+#include <ClanLib/application.h>
+#include <ClanLib/display.h>
+using namespace clan;
+
+class TestApp
+{
+public:
+	int main(const std::vector<std::string> &args);
+
+private:
+	void run_test();
+	void test_image(int width, int height, int channels);
+	void test_truncated_stream();
+	PixelBuffer create_atlas(int width, int height, int channels);
+	DataBuffer encode(const PixelBuffer &image, int channels, int filter_type, bool truncate_image_data = false);
+	void filter_scanline(unsigned char *output, const unsigned char *scanline, const unsigned char *prev_scanline, int byte_length, int bytes_per_pixel, int filter_type);
+	void write_chunk(IODevice &file, const char *name, const void *data, int size);
+	PixelBuffer decode(DataBuffer &png, TextureFormat format);
+	double decode_speed(DataBuffer &png, int iterations);
+	void compare_pixels(const PixelBuffer &expected, const PixelBuffer &actual, bool bgra, const std::string &test_name);
+};
+
+#endif
@@ -0,0 +1,206 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "test.h"
+
+// This is the Program class that is called by Application
+class Program
+{
+public:
+	static int main(const std::vector<std::string> &args)
+	{
+		// Initialize ClanLib base components
+		SetupCore setup_core;
+
+		// Initialize the ClanLib display component
+		SetupDisplay setup_display;
+
+		// Initilize the OpenGL drivers
+		SetupGL setup_gl;
+
+		// Start the Application
+		TestApp app;
+		int retval = app.main(args);
+		return retval;
+	}
+};
+
+// Instantiate Application, informing it where the Program is located
+Application app(&Program::main);
+
+int TestApp::main(const std::vector<std::string> &args)
+{
+	ConsoleWindow console("Console");
+
+	try
+	{
+		run_test();
+		console.display_close_message();
+	}
+	catch(Exception error)
+	{
+		Console::write_line("Unhandled exception: %1", error.message);
+		console.display_close_message();
+		return -1;
+	}
+
+	return 0;
+}
+
+void TestApp::run_test()
+{
+	quit = false;
+
+	DisplayWindow window("ClanLib Resource Preload Test", 1024, 768);
+	Slot slot_quit = window.sig_window_close().connect(this, &TestApp::on_window_close);
+	Canvas canvas(window);
+
+	const int num_sprites = 200;
+	XMLResourceDocument doc = create_resources(num_sprites);
+
+	// Synchronous loading for comparison
+	ResourceManager sync_resources = XMLResourceManager::create(doc);
+	ubyte64 start_time = System::get_microseconds();
+	for (int i = 0; i < num_sprites; i++)
+		Sprite::resource(canvas, string_format("level2/sprite%1", i), sync_resources);
+	ubyte64 sync_time = System::get_microseconds() - start_time;
+	Console::write_line("Synchronous: %1 sprites in %2 ms", num_sprites, (int)(sync_time / 1000));
+
+	// Preload a section and request the sprites of another one, uploading with a per-frame budget
+	ResourceManager resources = XMLResourceManager::create(doc);
+	DisplayCache &cache = DisplayCache::get(resources);
+	cache.preload("level1");
+
+	std::vector<Resource<Sprite> > sprites;
+	for (int i = 0; i < num_sprites; i++)
+		sprites.push_back(cache.get_sprite_async(canvas, string_format("level2/sprite%1", i)));
+	print_stats("After requests", cache.get_load_stats());
+
+	int frames = 0;
+	int sprites_ready = 0;
+	ubyte64 longest_frame = 0;
+	start_time = System::get_microseconds();
+	while (!quit && sprites_ready < num_sprites)
+	{
+		ubyte64 frame_start = System::get_microseconds();
+		cache.process_uploads(canvas, 1024 * 1024);
+
+		canvas.clear(Colorf::black);
+		for (int i = 0; i < num_sprites; i++)
+		{
+			if (sprites[i].updated())
+				sprites_ready++;
+			if (!sprites[i].get().is_null())
+				sprites[i].get().draw(canvas, (float)(i % 20) * 50.0f, (float)(i / 20) * 70.0f);
+		}
+		window.flip(0);
+		KeepAlive::process();
+
+		longest_frame = max(longest_frame, System::get_microseconds() - frame_start);
+		frames++;
+	}
+	ubyte64 async_time = System::get_microseconds() - start_time;
+
+	Console::write_line("Asynchronous: %1 sprites in %2 ms over %3 frames, longest frame %4 ms", num_sprites, (int)(async_time / 1000), frames, (int)(longest_frame / 1000));
+	print_stats("After loading", cache.get_load_stats());
+
+	// Everything in the preloaded section must be available without loading from disk again
+	while (!quit && cache.get_load_stats().decode_queue_depth + cache.get_load_stats().upload_queue_depth > 0)
+	{
+		cache.process_uploads(canvas, 1024 * 1024);
+		KeepAlive::process();
+	}
+	start_time = System::get_microseconds();
+	for (int i = 0; i < num_sprites; i++)
+	{
+		Sprite sprite = Sprite::resource(canvas, string_format("level1/sprite%1", i), resources);
+		Sprite reference = Sprite::resource(canvas, string_format("level2/sprite%1", i), sync_resources);
+		if (sprite.get_size() != reference.get_size())
+			throw Exception("Preloaded sprite differs from synchronously loaded sprite");
+	}
+	Console::write_line("Preloaded section: %1 sprites fetched in %2 us", num_sprites, (int)(System::get_microseconds() - start_time));
+
+	// A sprite that fails to load is finished as a null sprite, and the sprite queued behind it still loads
+	Resource<Sprite> missing = cache.get_sprite_async(canvas, "failing/missing");
+	Resource<Sprite> valid = cache.get_sprite_async(canvas, "failing/valid");
+	bool missing_done = false;
+	bool valid_done = false;
+	ubyte64 timeout = System::get_time() + 10000;
+	while (!quit && !(missing_done && valid_done))
+	{
+		if (System::get_time() > timeout)
+			throw Exception("Failing resource request did not finish");
+		cache.process_uploads(canvas, 1024 * 1024);
+		KeepAlive::process();
+		missing_done = missing_done || missing.updated();
+		valid_done = valid_done || valid.updated();
+	}
+	DisplayCacheLoadStats stats = cache.get_load_stats();
+	if (!missing.get().is_null() || valid.get().is_null() || stats.resources_failed != 1)
+		throw Exception("Resource that failed to load was not reported");
+	Console::write_line("Failed resource reported: %1", stats.last_error);
+}
+
+XMLResourceDocument TestApp::create_resources(int num_sprites)
+{
+	const char *images[] = { "../Sprites1/Images/background.png", "../Sprites1/Images/testsprite1.png", "../Sprites1/Images/test1_facit.png" };
+
+	XMLResourceDocument doc;
+	for (int section = 1; section <= 2; section++)
+	{
+		for (int i = 0; i < num_sprites; i++)
+		{
+			XMLResourceNode resource = doc.create_resource(string_format("level%1/sprite%2", section, i), "sprite");
+			DomElement image = resource.get_element().get_owner_document().create_element("image");
+			image.set_attribute("file", images[i % 3]);
+			resource.get_element().append_child(image);
+		}
+	}
+
+	const char *failing_files[] = { "../Sprites1/Images/does_not_exist.png", images[0] };
+	const char *failing_ids[] = { "failing/missing", "failing/valid" };
+	for (int i = 0; i < 2; i++)
+	{
+		XMLResourceNode resource = doc.create_resource(failing_ids[i], "sprite");
+		DomElement image = resource.get_element().get_owner_document().create_element("image");
+		image.set_attribute("file", failing_files[i]);
+		resource.get_element().append_child(image);
+	}
+	return doc;
+}
+
+void TestApp::print_stats(const std::string &title, const DisplayCacheLoadStats &stats)
+{
+	Console::write_line("%1: decode queue %2, upload queue %3, loaded %4, failed %5, latency average %6 ms, max %7 ms",
+		title, stats.decode_queue_depth, stats.upload_queue_depth, stats.resources_loaded, stats.resources_failed, (int)stats.average_latency, (int)stats.max_latency);
+}
+
+void TestApp::on_window_close()
+{
+	quit = true;
+}
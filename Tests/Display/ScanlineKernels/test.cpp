@@ -0,0 +1,215 @@
+/*
+**  ClanLib SDK
+**  Copyright (c) 1997-2013 The ClanLib Team
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+**  Note: Some of the libraries ClanLib may link to may have additional
+**  requirements or restrictions.
+**
+**  File Author(s):
+**
+**    Magnus Norddahl
+*/
+
+#include "test.h"
+
+// This is the Program class that is called by Application
+class Program
+{
+public:
+	static int main(const std::vector<std::string> &args)
+	{
+		// Initialize ClanLib base components
+		SetupCore setup_core;
+
+		// Start the Application
+		TestApp app;
+		int retval = app.main(args);
+		return retval;
+	}
+};
+
+// Instantiate Application, informing it where the Program is located
+Application app(&Program::main);
+
+static const int texture_width = 61;
+static const int texture_height = 37;
+
+static const char *isa_names[] = { "reference", "sse2", "avx2" };
+static const char *blend_names[] = { "normal", "premultiplied", "additive", "copy" };
+
+int TestApp::main(const std::vector<std::string> &args)
+{
+	ConsoleWindow console("Console");
+
+	try
+	{
+		run_test();
+		console.display_close_message();
+	}
+	catch(Exception error)
+	{
+		Console::write_line("Unhandled exception: %1", error.message);
+		console.display_close_message();
+		return -1;
+	}
+
+	return 0;
+}
+
+void TestApp::run_test()
+{
+	random_seed = 0x1234;
+	texture.resize(texture_width * texture_height);
+	for (size_t i = 0; i < texture.size(); i++)
+		texture[i] = random();
+
+	PixelScanlineKernels::InstructionSet best_isa = PixelScanlineKernels::get_instruction_set();
+	Console::write_line("Detected instruction set: %1", isa_names[best_isa]);
+
+	for (int isa = PixelScanlineKernels::isa_sse2; isa <= best_isa; isa++)
+	{
+		verify_scanlines(false, (PixelScanlineKernels::InstructionSet)isa);
+		verify_scanlines(true, (PixelScanlineKernels::InstructionSet)isa);
+		verify_fill((PixelScanlineKernels::InstructionSet)isa);
+	}
+
+	Console::write_line("Mpixels/s  nearest  linear");
+	for (int isa = PixelScanlineKernels::isa_reference; isa <= best_isa; isa++)
+	{
+		double nearest = benchmark_scanlines(false, (PixelScanlineKernels::InstructionSet)isa);
+		double linear = benchmark_scanlines(true, (PixelScanlineKernels::InstructionSet)isa);
+		Console::write_line("%1  %2  %3", isa_names[isa], StringHelp::double_to_text(nearest, 1), StringHelp::double_to_text(linear, 1));
+	}
+}
+
+void TestApp::verify_scanlines(bool linear, PixelScanlineKernels::InstructionSet isa)
+{
+	const int max_length = 83;
+	std::vector<unsigned int> background(max_length), expected(max_length), result(max_length);
+
+	for (int blend = 0; blend < 4; blend++)
+	{
+		for (int iteration = 0; iteration < 2000; iteration++)
+		{
+			int length = random() % max_length;
+			for (int i = 0; i < max_length; i++)
+				background[i] = random();
+			expected = background;
+			result = background;
+
+			PixelScanline scanline = random_scanline(&expected[0], length);
+			if (linear)
+				PixelScanlineKernels::render_linear(scanline, (PixelScanlineKernels::BlendMode)blend, PixelScanlineKernels::isa_reference);
+			else
+				PixelScanlineKernels::render_nearest(scanline, (PixelScanlineKernels::BlendMode)blend, PixelScanlineKernels::isa_reference);
+
+			scanline.dest = &result[0];
+			if (linear)
+				PixelScanlineKernels::render_linear(scanline, (PixelScanlineKernels::BlendMode)blend, isa);
+			else
+				PixelScanlineKernels::render_nearest(scanline, (PixelScanlineKernels::BlendMode)blend, isa);
+
+			if (result != expected)
+				throw Exception(string_format("%1 %2 %3 kernel does not match the reference kernel", isa_names[isa], linear ? "linear" : "nearest", blend_names[blend]));
+		}
+	}
+
+	Console::write_line("%1 %2 scanlines: OK", isa_names[isa], linear ? "linear" : "nearest");
+}
+
+void TestApp::verify_fill(PixelScanlineKernels::InstructionSet isa)
+{
+	const int max_length = 83;
+	std::vector<unsigned int> expected(max_length), result(max_length);
+
+	for (int iteration = 0; iteration < 2000; iteration++)
+	{
+		int length = random() % max_length;
+		for (int i = 0; i < max_length; i++)
+			expected[i] = random();
+		result = expected;
+
+		Colorf color((random() & 0xff) / 255.0f, (random() & 0xff) / 255.0f, (random() & 0xff) / 255.0f, (random() & 0xff) / 255.0f);
+		PixelScanlineKernels::fill_blend(&expected[0], length, color, PixelScanlineKernels::isa_reference);
+		PixelScanlineKernels::fill_blend(&result[0], length, color, isa);
+
+		if (result != expected)
+			throw Exception(string_format("%1 fill kernel does not match the reference kernel", isa_names[isa]));
+	}
+
+	Console::write_line("%1 fill: OK", isa_names[isa]);
+}
+
+double TestApp::benchmark_scanlines(bool linear, PixelScanlineKernels::InstructionSet isa)
+{
+	const int width = 1024;
+	const int iterations = 2000;
+	std::vector<unsigned int> dest(width, 0xff808080);
+
+	PixelScanline scanline = random_scanline(&dest[0], width);
+	scanline.slope_tx = (1 << 16) * 3 / 4;
+	scanline.slope_ty = (1 << 16) / 8;
+
+	ubyte64 start_time = System::get_microseconds();
+	for (int i = 0; i < iterations; i++)
+	{
+		if (linear)
+			PixelScanlineKernels::render_linear(scanline, PixelScanlineKernels::blend_normal, isa);
+		else
+			PixelScanlineKernels::render_nearest(scanline, PixelScanlineKernels::blend_normal, isa);
+	}
+	ubyte64 end_time = System::get_microseconds();
+
+	return width * (double)iterations / std::max(end_time - start_time, (ubyte64)1);
+}
+
+PixelScanline TestApp::random_scanline(unsigned int *dest, int length)
+{
+	PixelScanline scanline;
+	scanline.dest = dest;
+	scanline.length = length;
+	scanline.src = &texture[0];
+	scanline.src_width = texture_width;
+	scanline.src_height = texture_height;
+
+	// Coordinates outside the texture exercise the repeat wrapping
+	scanline.tx = (int)(random() % (texture_width * 3 << 16)) - (texture_width << 16);
+	scanline.ty = (int)(random() % (texture_height * 3 << 16)) - (texture_height << 16);
+	scanline.slope_tx = (int)(random() % (4 << 16)) - (2 << 16);
+	scanline.slope_ty = (int)(random() % (4 << 16)) - (2 << 16);
+
+	// Colors may overshoot 1.0 slightly, as the triangle setup can produce
+	scanline.red = random() % 0x11000;
+	scanline.green = random() % 0x11000;
+	scanline.blue = random() % 0x11000;
+	scanline.alpha = random() % 0x11000;
+	scanline.slope_red = (int)(random() % 0x200) - 0x100;
+	scanline.slope_green = (int)(random() % 0x200) - 0x100;
+	scanline.slope_blue = (int)(random() % 0x200) - 0x100;
+	scanline.slope_alpha = (int)(random() % 0x200) - 0x100;
+	return scanline;
+}
+
+unsigned int TestApp::random()
+{
+	random_seed ^= random_seed << 13;
+	random_seed ^= random_seed >> 17;
+	random_seed ^= random_seed << 5;
+	return random_seed;
+}
@@ -0,0 +1,184 @@
+#include <ClanLib/core.h>
+#include <ClanLib/network.h>
+#include <algorithm>
+using namespace clan;
+
+class StatusHandler : public HTTPRequestHandlerProvider
+{
+public:
+	bool is_handling_request(const std::string &type, const std::string &url, const std::string &headers)
+	{
+		return url == "/status";
+	}
+
+	void handle_request(HTTPServerConnection &connection)
+	{
+		static const char body[] = "{\"status\":\"ok\"}";
+		connection.write_response_status(200, "OK");
+		connection.write_response_headers("Content-Type: application/json");
+		connection.write_response_data(DataBuffer(body, sizeof(body) - 1));
+	}
+};
+
+class LoadClient
+{
+public:
+	LoadClient(const SocketName &server_name, bool keep_alive, int pipeline_depth, ubyte64 end_time)
+	: server_name(server_name), keep_alive(keep_alive), pipeline_depth(pipeline_depth), end_time(end_time), errors(0)
+	{
+	}
+
+	void run()
+	{
+		try
+		{
+			if (keep_alive)
+				run_keep_alive();
+			else
+				run_connection_per_request();
+		}
+		catch (Exception &e)
+		{
+			Console::write_line("Client error: %1", e.message);
+			errors++;
+		}
+	}
+
+	std::vector<ubyte64> latencies;
+	int errors;
+
+private:
+	void run_connection_per_request()
+	{
+		std::string request = "GET /status HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+		while (System::get_time() < end_time)
+		{
+			ubyte64 start = System::get_microseconds();
+			TCPConnection connection(server_name);
+			connection.set_nodelay(true);
+			connection.send(request.data(), request.length(), true);
+			std::string input;
+			read_response(connection, input);
+			latencies.push_back(System::get_microseconds() - start);
+		}
+	}
+
+	void run_keep_alive()
+	{
+		std::string request = "GET /status HTTP/1.1\r\nHost: localhost\r\n\r\n";
+		std::string batch;
+		for (int i = 0; i < pipeline_depth; i++)
+			batch += request;
+
+		TCPConnection connection(server_name);
+		connection.set_nodelay(true);
+		std::string input;
+		while (System::get_time() < end_time)
+		{
+			ubyte64 start = System::get_microseconds();
+			connection.send(batch.data(), batch.length(), true);
+			for (int i = 0; i < pipeline_depth; i++)
+			{
+				read_response(connection, input);
+				latencies.push_back(System::get_microseconds() - start);
+			}
+		}
+	}
+
+	void read_response(TCPConnection &connection, std::string &input)
+	{
+		while (true)
+		{
+			std::string::size_type header_end = input.find("\r\n\r\n");
+			if (header_end != std::string::npos)
+			{
+				std::string::size_type length_pos = input.find("Content-Length: ");
+				if (length_pos == std::string::npos || length_pos > header_end)
+					throw Exception("Response without Content-Length");
+				int content_length = StringHelp::text_to_int(input.substr(length_pos + 16, input.find("\r\n", length_pos) - length_pos - 16));
+				std::string::size_type response_length = header_end + 4 + content_length;
+				if (input.length() >= response_length)
+				{
+					if (input.compare(0, 12, "HTTP/1.1 200") != 0)
+						throw Exception("Unexpected response: " + input.substr(0, input.find("\r\n")));
+					input.erase(0, response_length);
+					return;
+				}
+			}
+
+			if (!connection.get_read_event().wait(15000))
+				throw Exception("Response timed out");
+			char buffer[16*1024];
+			int received = connection.receive(buffer, 16*1024, false);
+			if (received == 0)
+				throw Exception("Connection closed by server");
+			input.append(buffer, received);
+		}
+	}
+
+	SocketName server_name;
+	bool keep_alive;
+	int pipeline_depth;
+	ubyte64 end_time;
+};
+
+void run_scenario(const std::string &name, bool use_reactor, int num_clients, bool keep_alive, int pipeline_depth)
+{
+	const int duration = 2000;
+
+	SocketName server_name("127.0.0.1", "8089");
+	HTTPServer server(use_reactor);
+	server.bind(server_name);
+	server.add_handler(HTTPRequestHandler(new StatusHandler));
+	System::sleep(100);
+
+	ubyte64 start_time = System::get_time();
+	std::vector<std::shared_ptr<LoadClient> > clients;
+	std::vector<Thread> threads;
+	for (int i = 0; i < num_clients; i++)
+	{
+		clients.push_back(std::shared_ptr<LoadClient>(new LoadClient(server_name, keep_alive, pipeline_depth, start_time + duration)));
+		threads.push_back(Thread());
+		threads.back().start(clients.back().get(), &LoadClient::run);
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	ubyte64 end_time = System::get_time();
+
+	std::vector<ubyte64> latencies;
+	int errors = 0;
+	for (size_t i = 0; i < clients.size(); i++)
+	{
+		latencies.insert(latencies.end(), clients[i]->latencies.begin(), clients[i]->latencies.end());
+		errors += clients[i]->errors;
+	}
+	std::sort(latencies.begin(), latencies.end());
+
+	double requests_per_second = latencies.size() * 1000.0 / (end_time - start_time);
+	ubyte64 p50 = latencies.empty() ? 0 : latencies[latencies.size() / 2];
+	ubyte64 p99 = latencies.empty() ? 0 : latencies[latencies.size() * 99 / 100];
+	Console::write_line("%1: %2 requests/s, p50 %3 us, p99 %4 us, %5 errors", name, (int)requests_per_second, (int)p50, (int)p99, errors);
+}
+
+int main(int, char**)
+{
+	SetupCore setup_core;
+	SetupNetwork setup_network;
+	try
+	{
+		Console::write_line("HTTPServer loopback load test");
+		Console::write_line("");
+
+		run_scenario("thread per connection,  8 clients, connection per request", false, 8, false, 1);
+		run_scenario("reactor,                8 clients, connection per request", true, 8, false, 1);
+		run_scenario("reactor,                8 clients, keep-alive", true, 8, true, 1);
+		run_scenario("reactor,                8 clients, keep-alive, pipeline depth 8", true, 8, true, 8);
+		run_scenario("reactor,              256 clients, keep-alive", true, 256, true, 1);
+	}
+	catch (Exception &e)
+	{
+		Console::write_line(e.message);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,291 @@
+#include <ClanLib/core.h>
+#include <ClanLib/network.h>
+using namespace clan;
+
+// Plays the remote end of a NetGame connection with a raw socket, so the bytes on the wire can be counted
+class RawPeer
+{
+public:
+	RawPeer(TCPConnection connection) : connection(connection), packets_received(0), bytes_received(0), announcements_received(0)
+	{
+	}
+
+	void send_event(const std::string &name, unsigned int value)
+	{
+		// Original format: length, name length, name, uint type, value, end marker
+		std::string packet(2 + 2 + name.length() + 5 + 1, 0);
+		*reinterpret_cast<unsigned short*>(&packet[0]) = packet.length() - 2;
+		*reinterpret_cast<unsigned short*>(&packet[2]) = name.length();
+		memcpy(&packet[4], name.data(), name.length());
+		packet[4 + name.length()] = 2;
+		*reinterpret_cast<unsigned int*>(&packet[5 + name.length()]) = value;
+		connection.send(packet.data(), packet.length(), true);
+	}
+
+	// Reads count packets after the first skip_packets, which are not counted
+	void receive_packets(int count, int skip_packets)
+	{
+		ubyte64 timeout = System::get_time() + 30000;
+		while (packets_received < count + skip_packets)
+		{
+			if (System::get_time() > timeout)
+				throw Exception(string_format("Timed out after %1 of %2 packets", packets_received, count));
+
+			if (!connection.get_read_event().wait(100))
+				continue;
+			char buffer[64*1024];
+			int received = connection.receive(buffer, 64*1024, false);
+			if (received <= 0)
+				throw Exception("Connection closed");
+			input.append(buffer, received);
+
+			size_t pos = 0;
+			while (input.length() - pos >= 2)
+			{
+				unsigned int length = *reinterpret_cast<const unsigned short*>(&input[pos]) & 0x7fff;
+				if (input.length() - pos < 2 + length)
+					break;
+				if (packets_received >= skip_packets)
+					bytes_received += 2 + length;
+				if (length >= 10 && memcmp(&input[pos + 2], "\x08\0_compact", 10) == 0)
+					announcements_received++;
+				packets_received++;
+				pos += 2 + length;
+			}
+			input.erase(0, pos);
+		}
+	}
+
+	TCPConnection connection;
+	std::string input;
+	int packets_received;
+	int bytes_received;
+	int announcements_received;
+};
+
+class NetGameEncoding
+{
+public:
+	NetGameEncoding() : ready(false), last_connection(0)
+	{
+	}
+
+	void run()
+	{
+		Console::write_line("NetGameEvent wire format, 100000 player_position(id, x, y, z, heading) events");
+		Console::write_line("");
+		measure("original format", false, false);
+		measure("compact format", true, false);
+		measure("compact format, delta encoded", true, true);
+		Console::write_line("");
+		verify_round_trip(false);
+		verify_round_trip(true);
+		verify_no_announcement();
+	}
+
+private:
+	void measure(const std::string &name, bool compact, bool delta)
+	{
+		const int num_events = 100000;
+		const int events_per_tick = 100;
+
+		TCPListen listen(SocketName("127.0.0.1", "4580"));
+		NetGameClient client;
+		SlotContainer slots;
+		slots.connect(client.sig_event_received(), this, &NetGameEncoding::on_client_event_received);
+		client.set_flush_policy(NetGameConnection::flush_per_tick);
+		client.set_delta_encoding(delta);
+		client.connect("127.0.0.1", "4580");
+
+		if (!listen.get_accept_event().wait(5000))
+			throw Exception("Client did not connect");
+		RawPeer peer(listen.accept());
+		if (compact)
+			peer.send_event("_compact", 1);
+		peer.send_event("ready", 0);
+
+		// The ready event arrives after the announcement, so the client has answered it and is encoding in the new format from here
+		ready = false;
+		ubyte64 timeout = System::get_time() + 5000;
+		while (!ready)
+		{
+			if (System::get_time() > timeout)
+				throw Exception("Client did not receive ready event");
+			client.process_events();
+			System::sleep(1);
+		}
+
+		// Only time send_event, which encodes the event into the send queue
+		ubyte64 encode_time = 0;
+		std::vector<NetGameEvent> tick_events;
+		for (int tick = 0; tick < num_events / events_per_tick; tick++)
+		{
+			tick_events.clear();
+			for (int i = 0; i < events_per_tick; i++)
+				tick_events.push_back(create_position_event(i, tick));
+
+			ubyte64 start_time = System::get_microseconds();
+			for (int i = 0; i < events_per_tick; i++)
+				client.send_event(tick_events[i]);
+			encode_time += System::get_microseconds() - start_time;
+			client.flush();
+		}
+		// In the compact runs the client answers the announcement before sending any events
+		peer.receive_packets(num_events, compact ? 1 : 0);
+		if (peer.announcements_received != (compact ? 1 : 0))
+			throw Exception("Client sent an unexpected compact format announcement");
+
+		Console::write_line("%1: %2 bytes/event, %3 ns/event to encode",
+			name, StringHelp::float_to_text(peer.bytes_received / (float)num_events, 2), (int)(encode_time * 1000 / num_events));
+	}
+
+	// Players moving on the ground. Position and heading change every tick, id and height do not.
+	static NetGameEvent create_position_event(int player, int tick)
+	{
+		float x = player * 10.0f + tick * 0.25f;
+		float y = player * 5.0f - tick * 0.125f;
+		return NetGameEvent("player_position", (unsigned int)player, x, y, 0.0f, (unsigned int)((tick * 3 + player) % 360));
+	}
+
+	// Sends events with a mix of types and values between a real server and client, and checks they arrive unchanged
+	void verify_round_trip(bool delta)
+	{
+		NetGameServer server;
+		SlotContainer slots;
+		slots.connect(server.sig_event_received(), this, &NetGameEncoding::on_server_event_received);
+		server.start("127.0.0.1", "4581");
+
+		NetGameClient client;
+		slots.connect(client.sig_event_received(), this, &NetGameEncoding::on_client_event_received);
+		client.set_delta_encoding(delta);
+		client.set_compact_encoding(true);
+		client.connect("127.0.0.1", "4581");
+
+		std::vector<NetGameEvent> sent;
+		received.clear();
+		for (int i = 0; i < 2000; i++)
+		{
+			NetGameEvent e = create_test_event(i);
+			client.send_event(e);
+			sent.push_back(e);
+			if (i % 100 == 0)
+				pump(server, client, 10);
+		}
+
+		ubyte64 timeout = System::get_time() + 10000;
+		while (received.size() < sent.size() && System::get_time() < timeout)
+			pump(server, client, 10);
+
+		if (received.size() != sent.size())
+			throw Exception(string_format("Received %1 of %2 events", (int)received.size(), (int)sent.size()));
+		for (size_t i = 0; i < sent.size(); i++)
+		{
+			if (received[i] != sent[i].to_string())
+				throw Exception(string_format("Event %1 changed: sent %2, received %3", (int)i, sent[i].to_string(), received[i]));
+		}
+
+		Console::write_line("Round trip%1: %2 events arrived unchanged", delta ? " with delta encoding" : "", (int)received.size());
+	}
+
+	// Peers that never announced the compact format, such as older versions, must not receive the announcement
+	void verify_no_announcement()
+	{
+		NetGameServer server;
+		SlotContainer slots;
+		slots.connect(server.sig_event_received(), this, &NetGameEncoding::on_server_event_received);
+		server.start("127.0.0.1", "4582");
+
+		RawPeer peer(TCPConnection(SocketName("127.0.0.1", "4582")));
+		peer.send_event("hello", 1);
+
+		received.clear();
+		ubyte64 timeout = System::get_time() + 5000;
+		while (received.empty())
+		{
+			if (System::get_time() > timeout)
+				throw Exception("Server did not receive hello event");
+			server.process_events();
+			System::sleep(1);
+		}
+
+		last_connection->send_event(NetGameEvent("reply", 2u));
+		peer.receive_packets(1, 0);
+		if (peer.announcements_received != 0)
+			throw Exception("Server announced the compact format to a peer that did not announce it");
+
+		Console::write_line("No announcement to peers without compact format support: OK");
+	}
+
+	static NetGameEvent create_test_event(int i)
+	{
+		switch (i % 4)
+		{
+		case 0:
+			return NetGameEvent("move", (unsigned int)(i / 4), (float)(i % 7), -i * 1000, i % 3 == 0);
+		case 1:
+			return NetGameEvent("chat", StringHelp::int_to_text(i), std::string(i % 50, 'x'));
+		case 2:
+			{
+				NetGameEventValue complex(NetGameEventValue::complex);
+				complex.add_member(NetGameEventValue(0xffffffffu - i));
+				complex.add_member(NetGameEventValue((char)-(i % 100)));
+				complex.add_member(NetGameEventValue((unsigned char)(i % 200)));
+				return NetGameEvent("state", complex, NetGameEventValue(NetGameEventValue::null));
+			}
+		default:
+			{
+				// A new name every time, to go past the interned name limit
+				NetGameEvent e("event_" + StringHelp::int_to_text(i));
+				e.add_argument(-2147483647 - 1);
+				e.add_argument(2147483647);
+				if (i % 8 == 3)
+					e.add_argument(NetGameEventValue((unsigned int)i));
+				return e;
+			}
+		}
+	}
+
+	void pump(NetGameServer &server, NetGameClient &client, int milliseconds)
+	{
+		ubyte64 end_time = System::get_time() + milliseconds;
+		while (System::get_time() < end_time)
+		{
+			server.process_events();
+			client.process_events();
+			System::sleep(1);
+		}
+	}
+
+	void on_client_event_received(const NetGameEvent &e)
+	{
+		if (e.get_name() == "ready")
+			ready = true;
+	}
+
+	void on_server_event_received(NetGameConnection *connection, const NetGameEvent &e)
+	{
+		last_connection = connection;
+		received.push_back(e.to_string());
+	}
+
+	bool ready;
+	NetGameConnection *last_connection;
+	std::vector<std::string> received;
+};
+
+int main(int, char**)
+{
+	SetupCore setup_core;
+	SetupNetwork setup_network;
+	try
+	{
+		NetGameEncoding test;
+		test.run();
+	}
+	catch (Exception &e)
+	{
+		Console::write_line(e.message);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,350 @@
+#include <ClanLib/core.h>
+#include <ClanLib/network.h>
+#include <algorithm>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <fstream>
+using namespace clan;
+
+// Simulated clients use raw sockets and epoll, as thousands of NetGameClient objects would need a thread each
+class LoadGenerator
+{
+public:
+	LoadGenerator(int port, ubyte64 time_base)
+	: port(port), time_base(time_base), epoll_handle(epoll_create1(0)), pongs_received(0), send_errors(0)
+	{
+	}
+
+	~LoadGenerator()
+	{
+		for (size_t i = 0; i < clients.size(); i++)
+			close(clients[i].handle);
+		close(epoll_handle);
+	}
+
+	void connect_clients(int count)
+	{
+		sockaddr_in address;
+		memset(&address, 0, sizeof(sockaddr_in));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+		for (int i = 0; i < count; i++)
+		{
+			Client client;
+			client.handle = socket(AF_INET, SOCK_STREAM, 0);
+			if (client.handle == -1 || connect(client.handle, (sockaddr *) &address, sizeof(sockaddr_in)) == -1)
+				throw Exception(string_format("Client %1 could not connect: %2", (int)clients.size(), std::string(strerror(errno))));
+
+			int nodelay = 1;
+			setsockopt(client.handle, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(int));
+			fcntl(client.handle, F_SETFL, fcntl(client.handle, F_GETFL, 0) | O_NONBLOCK);
+
+			epoll_event event;
+			memset(&event, 0, sizeof(epoll_event));
+			event.events = EPOLLIN;
+			event.data.u32 = clients.size();
+			epoll_ctl(epoll_handle, EPOLL_CTL_ADD, client.handle, &event);
+			clients.push_back(client);
+		}
+	}
+
+	// Every client sends a ping each tick and the server answers with a pong
+	void run_ticks(int num_ticks, int tick_length)
+	{
+		for (int tick = 0; tick < num_ticks; tick++)
+		{
+			ubyte64 tick_end = System::get_time() + tick_length;
+			for (size_t i = 0; i < clients.size(); i++)
+				send_ping(clients[i], i);
+			while (System::get_time() < tick_end)
+				receive_pongs(tick_end - System::get_time());
+		}
+
+		ubyte64 timeout = System::get_time() + 10000;
+		while (pongs_received < num_ticks * (int)clients.size() && System::get_time() < timeout)
+			receive_pongs(100);
+	}
+
+	std::vector<ubyte64> round_trip_times;
+	int pongs_received;
+	int send_errors;
+
+private:
+	struct Client
+	{
+		Client() : handle(-1) { }
+		int handle;
+		std::vector<unsigned char> input;
+	};
+
+	void send_ping(Client &client, unsigned int id)
+	{
+		// NetGame packet for NetGameEvent("ping", id, timestamp)
+		unsigned char packet[19];
+		*reinterpret_cast<unsigned short*>(packet) = 17;
+		*reinterpret_cast<unsigned short*>(packet + 2) = 4;
+		memcpy(packet + 4, "ping", 4);
+		packet[8] = 2;
+		*reinterpret_cast<unsigned int*>(packet + 9) = id;
+		packet[13] = 2;
+		*reinterpret_cast<unsigned int*>(packet + 14) = get_timestamp();
+		packet[18] = 0;
+		if (send(client.handle, packet, 19, MSG_NOSIGNAL) != 19)
+			send_errors++;
+	}
+
+	void receive_pongs(ubyte64 timeout)
+	{
+		epoll_event events[256];
+		int count = epoll_wait(epoll_handle, events, 256, (int)timeout);
+		for (int i = 0; i < count; i++)
+		{
+			Client &client = clients[events[i].data.u32];
+			unsigned char buffer[16*1024];
+			int bytes = recv(client.handle, buffer, 16*1024, 0);
+			if (bytes <= 0)
+				continue;
+			client.input.insert(client.input.end(), buffer, buffer + bytes);
+
+			// NetGameEvent("pong", timestamp): length, name length, name, uint type, timestamp, end marker.
+			size_t pos = 0;
+			while (client.input.size() - pos >= 2)
+			{
+				unsigned int length = *reinterpret_cast<const unsigned short*>(&client.input[pos]);
+				if (client.input.size() - pos < 2 + length)
+					break;
+				if (length >= 11 && memcmp(&client.input[pos + 2], "\x04\0pong", 6) == 0)
+				{
+					unsigned int timestamp = *reinterpret_cast<const unsigned int*>(&client.input[pos + 9]);
+					round_trip_times.push_back(get_timestamp() - timestamp);
+					pongs_received++;
+				}
+				pos += 2 + length;
+			}
+			client.input.erase(client.input.begin(), client.input.begin() + pos);
+		}
+	}
+
+	unsigned int get_timestamp() const
+	{
+		return (unsigned int)(System::get_microseconds() - time_base);
+	}
+
+	int port;
+	ubyte64 time_base;
+	int epoll_handle;
+	std::vector<Client> clients;
+};
+
+class NetGameStress
+{
+public:
+	NetGameStress(const std::string &name, bool use_reactor, int num_clients, int port)
+	: name(name), num_clients(num_clients), port(port), server(use_reactor), clients_connected(0)
+	{
+		time_base = System::get_microseconds();
+		slots.connect(server.sig_client_connected(), this, &NetGameStress::on_client_connected);
+		slots.connect(server.sig_event_received(), this, &NetGameStress::on_event_received);
+	}
+
+	void run()
+	{
+		const int num_ticks = 20;
+		const int tick_length = 100;
+
+		int rss_before = get_process_status("VmRSS:");
+		int threads_before = get_process_status("Threads:");
+
+		server.start("127.0.0.1", StringHelp::int_to_text(port));
+		LoadGenerator generator(port, time_base);
+
+		// Connect in batches that fit in the listen backlog, as a dropped SYN is only retried after a second
+		ubyte64 connect_start = System::get_time();
+		while (clients_connected < num_clients)
+		{
+			int batch_size = min(connect_batch_size, num_clients - clients_connected);
+			generator.connect_clients(batch_size);
+			wait_for(clients_connected, clients_connected + batch_size);
+		}
+		ubyte64 connect_time = System::get_time() - connect_start;
+
+		int rss_connected = get_process_status("VmRSS:");
+		int threads_connected = get_process_status("Threads:");
+
+		GeneratorTicks ticks = { &generator, num_ticks, tick_length };
+		run_generator(&ticks, &GeneratorTicks::run);
+
+		std::sort(dispatch_latencies.begin(), dispatch_latencies.end());
+		std::sort(generator.round_trip_times.begin(), generator.round_trip_times.end());
+
+		Console::write_line("%1, %2 clients:", name, num_clients);
+		Console::write_line("  connected in %1 ms, %2 threads (+%3), %4 KB RSS (+%5 KB, %6 bytes per connection)",
+			(int)connect_time, threads_connected, threads_connected - threads_before, rss_connected, rss_connected - rss_before,
+			(int)((rss_connected - rss_before) * 1024.0 / num_clients));
+		Console::write_line("  dispatch latency: p50 %1 us, p99 %2 us, max %3 us (%4 events)",
+			percentile(dispatch_latencies, 50), percentile(dispatch_latencies, 99), percentile(dispatch_latencies, 100), (int)dispatch_latencies.size());
+		Console::write_line("  round trip: p50 %1 us, p99 %2 us (%3 of %4 pongs, %5 send errors)",
+			percentile(generator.round_trip_times, 50), percentile(generator.round_trip_times, 99), generator.pongs_received, num_ticks * num_clients, generator.send_errors);
+
+		if (generator.pongs_received != num_ticks * num_clients)
+			throw Exception("Not all pings were answered");
+	}
+
+private:
+	static const int connect_batch_size = 100;
+
+	struct GeneratorTicks
+	{
+		LoadGenerator *generator;
+		int num_ticks;
+		int tick_length;
+		void run() { generator->run_ticks(num_ticks, tick_length); }
+	};
+
+	// Runs the load generator on its own thread while this thread processes server events
+	template<typename T>
+	void run_generator(T *instance, void (T::*member)())
+	{
+		generator_done.set(0);
+		generator_error.clear();
+		GeneratorRunner<T> runner = { instance, member, this };
+		Thread thread;
+		thread.start(&runner, &GeneratorRunner<T>::run);
+		while (generator_done.get() == 0)
+			KeepAlive::process(10);
+		thread.join();
+		if (!generator_error.empty())
+			throw Exception(generator_error);
+	}
+
+	template<typename T>
+	struct GeneratorRunner
+	{
+		T *instance;
+		void (T::*member)();
+		NetGameStress *test;
+		void run()
+		{
+			try
+			{
+				(instance->*member)();
+			}
+			catch (Exception &e)
+			{
+				test->generator_error = e.message;
+			}
+			test->generator_done.set(1);
+		}
+	};
+
+	void wait_for(const int &counter, int count)
+	{
+		ubyte64 timeout = System::get_time() + 60000;
+		while (counter < count)
+		{
+			if (System::get_time() > timeout)
+				throw Exception(string_format("Timed out after %1 of %2", counter, count));
+			KeepAlive::process(10);
+		}
+	}
+
+	void on_client_connected(NetGameConnection *connection)
+	{
+		clients_connected++;
+	}
+
+	void on_event_received(NetGameConnection *connection, const NetGameEvent &e)
+	{
+		unsigned int timestamp = e.get_argument(1).to_uinteger();
+		dispatch_latencies.push_back((unsigned int)(System::get_microseconds() - time_base) - timestamp);
+		connection->send_event(NetGameEvent("pong", timestamp));
+	}
+
+	static int percentile(const std::vector<unsigned int> &values, int percent)
+	{
+		if (values.empty())
+			return 0;
+		return values[min(values.size() * percent / 100, values.size() - 1)];
+	}
+
+	static int percentile(const std::vector<ubyte64> &values, int percent)
+	{
+		if (values.empty())
+			return 0;
+		return (int)values[min(values.size() * percent / 100, values.size() - 1)];
+	}
+
+	static int get_process_status(const std::string &field)
+	{
+		std::ifstream status("/proc/self/status");
+		std::string line;
+		while (std::getline(status, line))
+		{
+			if (line.compare(0, field.length(), field) == 0)
+				return StringHelp::text_to_int(StringHelp::trim(line.substr(field.length())));
+		}
+		return 0;
+	}
+
+	std::string name;
+	int num_clients;
+	int port;
+	ubyte64 time_base;
+	NetGameServer server;
+	SlotContainer slots;
+	int clients_connected;
+	std::vector<unsigned int> dispatch_latencies;
+	InterlockedVariable generator_done;
+	std::string generator_error;
+};
+
+int main(int, char**)
+{
+	SetupCore setup_core;
+	SetupNetwork setup_network;
+	try
+	{
+		// Each simulated client uses two sockets in this process
+		rlimit limit;
+		getrlimit(RLIMIT_NOFILE, &limit);
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+
+		Console::write_line("NetGameServer loopback stress test");
+		Console::write_line("");
+
+		// Connection threads wait with select() on the socket and two event socket pairs,
+		// which limits thread per connection mode to a few hundred clients
+		{
+			NetGameStress test("thread per connection", false, 100, 4571);
+			test.run();
+		}
+		{
+			NetGameStress test("reactor", true, 200, 4572);
+			test.run();
+		}
+
+		int num_clients = 5000;
+		if (limit.rlim_cur < (rlim_t)(2 * num_clients + 100))
+			num_clients = (limit.rlim_cur - 100) / 2;
+		{
+			NetGameStress test("reactor", true, num_clients, 4573);
+			test.run();
+		}
+	}
+	catch (Exception &e)
+	{
+		Console::write_line(e.message);
+		return 1;
+	}
+	return 0;
+}
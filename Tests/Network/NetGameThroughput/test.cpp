@@ -0,0 +1,178 @@
+#include <ClanLib/core.h>
+#include <ClanLib/network.h>
+using namespace clan;
+
+class NetGameThroughput
+{
+public:
+	NetGameThroughput() : server_events_received(0), client_events_received(0), clients_connected(0)
+	{
+		slots.connect(server.sig_client_connected(), this, &NetGameThroughput::on_server_client_connected);
+		slots.connect(server.sig_event_received(), this, &NetGameThroughput::on_server_event_received);
+	}
+
+	void run()
+	{
+		server.start("127.0.0.1", "4557");
+
+		Console::write_line("NetGameConnection loopback throughput");
+		Console::write_line("");
+
+		connect_clients(1);
+		test_client_to_server(NetGameConnection::flush_immediately);
+		test_client_to_server(NetGameConnection::flush_per_tick);
+
+		connect_clients(64);
+		test_broadcast(NetGameConnection::flush_immediately);
+		test_broadcast(NetGameConnection::flush_per_tick);
+
+		clients.clear();
+		server.stop();
+	}
+
+private:
+	void connect_clients(int count)
+	{
+		clients.clear();
+		process_until_idle(200);
+		clients_connected = 0;
+
+		for (int i = 0; i < count; i++)
+		{
+			std::shared_ptr<NetGameClient> client(new NetGameClient);
+			slots.connect(client->sig_event_received(), this, &NetGameThroughput::on_client_event_received);
+			client->connect("127.0.0.1", "4557");
+			clients.push_back(client);
+		}
+
+		ubyte64 timeout = System::get_time() + 30000;
+		while (clients_connected < count)
+		{
+			if (System::get_time() > timeout)
+				throw Exception(string_format("Only %1 of %2 clients connected", clients_connected, count));
+			process_events();
+		}
+	}
+
+	// One client sends ticks of small movement events to the server
+	void test_client_to_server(NetGameConnection::FlushPolicy policy)
+	{
+		const int num_ticks = 500;
+		const int events_per_tick = 1000;
+
+		clients[0]->set_flush_policy(policy);
+		server_events_received = 0;
+
+		ubyte64 start_time = System::get_microseconds();
+		for (int tick = 0; tick < num_ticks; tick++)
+		{
+			for (int i = 0; i < events_per_tick; i++)
+				clients[0]->send_event(create_move_event(tick * events_per_tick + i));
+			clients[0]->flush();
+			process_events();
+		}
+		wait_for(server_events_received, num_ticks * events_per_tick);
+		ubyte64 end_time = System::get_microseconds();
+
+		report("client to server", policy, num_ticks * events_per_tick, end_time - start_time);
+	}
+
+	// The server broadcasts ticks of small movement events to all clients
+	void test_broadcast(NetGameConnection::FlushPolicy policy)
+	{
+		const int num_ticks = 200;
+		const int events_per_tick = 100;
+
+		server.set_flush_policy(policy);
+		client_events_received = 0;
+
+		ubyte64 start_time = System::get_microseconds();
+		for (int tick = 0; tick < num_ticks; tick++)
+		{
+			for (int i = 0; i < events_per_tick; i++)
+				server.send_event(create_move_event(tick * events_per_tick + i));
+			server.flush();
+			process_events();
+		}
+		wait_for(client_events_received, num_ticks * events_per_tick * (int)clients.size());
+		ubyte64 end_time = System::get_microseconds();
+
+		report(string_format("server to %1 clients", (int)clients.size()), policy, num_ticks * events_per_tick, end_time - start_time);
+	}
+
+	NetGameEvent create_move_event(int sequence)
+	{
+		return NetGameEvent("move", (unsigned int)sequence, 1.0f, 2.0f, 3.0f);
+	}
+
+	void wait_for(const int &counter, int count)
+	{
+		ubyte64 timeout = System::get_time() + 30000;
+		while (counter < count)
+		{
+			if (System::get_time() > timeout)
+				throw Exception(string_format("Timed out after receiving %1 of %2 events", counter, count));
+			process_events();
+		}
+	}
+
+	void report(const std::string &test, NetGameConnection::FlushPolicy policy, int events_per_connection, ubyte64 microseconds)
+	{
+		double events_per_second = events_per_connection * 1000000.0 / microseconds;
+		std::string policy_name = (policy == NetGameConnection::flush_immediately) ? "flush immediately" : "flush per tick";
+		Console::write_line("%1, %2: %3 events/s per connection", test, policy_name, (int)events_per_second);
+	}
+
+	void process_until_idle(int milliseconds)
+	{
+		ubyte64 end_time = System::get_time() + milliseconds;
+		while (System::get_time() < end_time)
+			process_events();
+	}
+
+	void process_events()
+	{
+		server.process_events();
+		for (size_t i = 0; i < clients.size(); i++)
+			clients[i]->process_events();
+	}
+
+	void on_server_client_connected(NetGameConnection *connection)
+	{
+		clients_connected++;
+	}
+
+	void on_server_event_received(NetGameConnection *connection, const NetGameEvent &e)
+	{
+		server_events_received++;
+	}
+
+	void on_client_event_received(const NetGameEvent &e)
+	{
+		client_events_received++;
+	}
+
+	NetGameServer server;
+	std::vector<std::shared_ptr<NetGameClient> > clients;
+	SlotContainer slots;
+	int server_events_received;
+	int client_events_received;
+	int clients_connected;
+};
+
+int main(int, char**)
+{
+	SetupCore setup_core;
+	SetupNetwork setup_network;
+	try
+	{
+		NetGameThroughput test;
+		test.run();
+	}
+	catch (Exception &e)
+	{
+		Console::write_line(e.message);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,243 @@
+#include <ClanLib/core.h>
+#include <ClanLib/display.h>
+#include <ClanLib/scene3d.h>
+#include <algorithm>
+using namespace clan;
+
+class AnimatedInstance
+{
+public:
+	AnimatedInstance() : animation_index(0), animation_time(0.0f) { }
+
+	int animation_index;
+	float animation_time;
+	ModelDataAnimationCursors cursors;
+};
+
+/// \brief Samples a batch of instances into their part of the bone buffer
+class SampleWorkItem : public WorkItem
+{
+public:
+	SampleWorkItem(const ModelDataAnimationSampler *sampler, AnimatedInstance *instances, Vec4f *bone_vectors, int count, InterlockedVariable *items_remaining, Event *done_event)
+	: sampler(sampler), instances(instances), bone_vectors(bone_vectors), count(count), items_remaining(items_remaining), done_event(done_event)
+	{
+	}
+
+	void process_work()
+	{
+		int vectors_per_instance = sampler->get_num_bones() * ModelDataAnimationSampler::vectors_per_bone;
+		for (int i = 0; i < count; i++)
+			sampler->sample_bones(instances[i].animation_index, instances[i].animation_time, instances[i].cursors, bone_vectors + i * vectors_per_instance);
+
+		if (items_remaining->decrement() == 0)
+			done_event->set();
+	}
+
+private:
+	const ModelDataAnimationSampler *sampler;
+	AnimatedInstance *instances;
+	Vec4f *bone_vectors;
+	int count;
+	InterlockedVariable *items_remaining;
+	Event *done_event;
+};
+
+class AnimationBenchmark
+{
+public:
+	AnimationBenchmark() : random_seed(12345)
+	{
+	}
+
+	void run()
+	{
+		create_model();
+		sampler = ModelDataAnimationSampler(model_data);
+
+		instances.resize(num_instances);
+		for (int i = 0; i < num_instances; i++)
+		{
+			instances[i].animation_index = i % num_animations;
+			instances[i].animation_time = random(0.0f, animation_length);
+		}
+		bone_vectors.resize(num_instances * num_bones * ModelDataAnimationSampler::vectors_per_bone);
+
+		Console::write_line("Skeletal animation sampling, %1 instances with %2 bones", num_instances, num_bones);
+
+		verify();
+
+		measure("ModelDataAnimationData::get_value", &AnimationBenchmark::sample_reference);
+		measure("ModelDataAnimationSampler", &AnimationBenchmark::sample_serial);
+		measure(string_format("ModelDataAnimationSampler, %1 threads", System::get_num_cores()), &AnimationBenchmark::sample_parallel);
+	}
+
+private:
+	void create_model()
+	{
+		model_data = std::shared_ptr<ModelData>(new ModelData());
+		model_data->animations.resize(num_animations);
+		for (int a = 0; a < num_animations; a++)
+		{
+			model_data->animations[a].name = string_format("animation%1", a);
+			model_data->animations[a].length = animation_length;
+			model_data->animations[a].loop = true;
+		}
+
+		// Keys at 30 fps, as a sampled export from a modelling tool would have them
+		int num_keys = (int)(animation_length * 30.0f) + 1;
+
+		model_data->bones.resize(num_bones);
+		for (int b = 0; b < num_bones; b++)
+		{
+			ModelDataBone &bone = model_data->bones[b];
+			bone.billboarded = false;
+			bone.parent_bone = b - 1;
+			bone.position.timelines.resize(num_animations);
+			bone.orientation.timelines.resize(num_animations);
+			bone.scale.timelines.resize(num_animations);
+			for (int a = 0; a < num_animations; a++)
+			{
+				for (int k = 0; k < num_keys; k++)
+				{
+					float timestamp = k / 30.0f;
+					bone.position.timelines[a].timestamps.push_back(timestamp);
+					bone.position.timelines[a].values.push_back(Vec3f(random(-1.0f, 1.0f), random(-1.0f, 1.0f), random(-1.0f, 1.0f)));
+					bone.orientation.timelines[a].timestamps.push_back(timestamp);
+					bone.orientation.timelines[a].values.push_back(Quaternionf(random(-180.0f, 180.0f), random(-180.0f, 180.0f), random(-180.0f, 180.0f), angle_degrees, order_YXZ));
+				}
+				bone.scale.timelines[a].timestamps.push_back(0.0f);
+				bone.scale.timelines[a].values.push_back(Vec3f(1.0f));
+			}
+		}
+	}
+
+	void verify()
+	{
+		std::vector<Vec4f> expected_vectors(bone_vectors.size());
+		sample_reference(1.0f / 60.0f);
+		expected_vectors.swap(bone_vectors);
+		bone_vectors.resize(expected_vectors.size());
+
+		for (int i = 0; i < num_instances; i++)
+			instances[i].animation_time -= 1.0f / 60.0f;
+		sample_serial(1.0f / 60.0f);
+
+		float max_error = 0.0f;
+		for (size_t i = 0; i < bone_vectors.size(); i++)
+		{
+			Vec4f delta = bone_vectors[i] - expected_vectors[i];
+			max_error = std::max(max_error, std::max(std::max(std::abs(delta.x), std::abs(delta.y)), std::max(std::abs(delta.z), std::abs(delta.w))));
+		}
+		if (max_error > 1.0e-5f)
+			throw Exception(string_format("Sampler differs from get_value by %1", max_error));
+	}
+
+	void measure(const std::string &name, void (AnimationBenchmark::*sample)(float))
+	{
+		const int num_frames = 100;
+
+		ubyte64 start_time = System::get_microseconds();
+		for (int frame = 0; frame < num_frames; frame++)
+			(this->*sample)(1.0f / 60.0f);
+		ubyte64 end_time = System::get_microseconds();
+
+		double bones_per_second = (double)num_frames * num_instances * num_bones * 1000000.0 / std::max(end_time - start_time, (ubyte64)1);
+		Console::write_line("%1: %2 million bones/s, %3 ms/frame", name, bones_per_second / 1000000.0, (end_time - start_time) / (num_frames * 1000.0));
+	}
+
+	void advance(float time_elapsed)
+	{
+		for (int i = 0; i < num_instances; i++)
+		{
+			instances[i].animation_time += time_elapsed;
+			while (instances[i].animation_time > animation_length)
+				instances[i].animation_time -= animation_length;
+		}
+	}
+
+	void sample_reference(float time_elapsed)
+	{
+		advance(time_elapsed);
+		for (int i = 0; i < num_instances; i++)
+		{
+			Vec4f *vectors = &bone_vectors[i * num_bones * ModelDataAnimationSampler::vectors_per_bone];
+			for (int b = 0; b < num_bones; b++)
+			{
+				const ModelDataBone &bone = model_data->bones[b];
+				Vec3f position = bone.position.get_value(instances[i].animation_index, instances[i].animation_time);
+				Quaternionf orientation = bone.orientation.get_value(instances[i].animation_index, instances[i].animation_time);
+				Vec3f scale = bone.scale.get_value(instances[i].animation_index, instances[i].animation_time);
+
+				Mat4f transform = Mat4f::translate(position) * orientation.to_matrix() * Mat4f::scale(scale);
+				transform.transpose();
+				vectors[b * 3 + 0] = Vec4f(transform[0], transform[1], transform[2], transform[3]);
+				vectors[b * 3 + 1] = Vec4f(transform[4], transform[5], transform[6], transform[7]);
+				vectors[b * 3 + 2] = Vec4f(transform[8], transform[9], transform[10], transform[11]);
+			}
+		}
+	}
+
+	void sample_serial(float time_elapsed)
+	{
+		advance(time_elapsed);
+		int vectors_per_instance = num_bones * ModelDataAnimationSampler::vectors_per_bone;
+		for (int i = 0; i < num_instances; i++)
+			sampler.sample_bones(instances[i].animation_index, instances[i].animation_time, instances[i].cursors, &bone_vectors[i * vectors_per_instance]);
+	}
+
+	void sample_parallel(float time_elapsed)
+	{
+		advance(time_elapsed);
+
+		int vectors_per_instance = num_bones * ModelDataAnimationSampler::vectors_per_bone;
+		int num_batches = (num_instances + instances_per_batch - 1) / instances_per_batch;
+
+		items_remaining.set(num_batches);
+		done_event.reset();
+
+		std::vector<WorkItem *> items;
+		for (int i = 0; i < num_instances; i += instances_per_batch)
+			items.push_back(new SampleWorkItem(&sampler, &instances[i], &bone_vectors[i * vectors_per_instance], std::min(instances_per_batch, num_instances - i), &items_remaining, &done_event));
+		work_queue.queue_batch(items, work_priority_high);
+		done_event.wait();
+	}
+
+	float random(float min_value, float max_value)
+	{
+		random_seed = random_seed * 1664525 + 1013904223;
+		return min_value + (max_value - min_value) * ((random_seed >> 8) / 16777216.0f);
+	}
+
+	static const int num_instances = 2000;
+	static const int num_bones = 60;
+	static const int num_animations = 4;
+	static const int instances_per_batch = 32;
+	static const float animation_length;
+
+	std::shared_ptr<ModelData> model_data;
+	ModelDataAnimationSampler sampler;
+	std::vector<AnimatedInstance> instances;
+	std::vector<Vec4f> bone_vectors;
+	WorkQueue work_queue;
+	InterlockedVariable items_remaining;
+	Event done_event;
+	unsigned int random_seed;
+};
+
+const float AnimationBenchmark::animation_length = 2.0f;
+
+int main(int, char**)
+{
+	SetupCore setup_core;
+	try
+	{
+		AnimationBenchmark benchmark;
+		benchmark.run();
+	}
+	catch (Exception &e)
+	{
+		Console::write_line(e.message);
+		return 1;
+	}
+	return 0;
+}
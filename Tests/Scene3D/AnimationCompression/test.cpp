@@ -0,0 +1,196 @@
+#include <ClanLib/core.h>
+#include <ClanLib/display.h>
+#include <ClanLib/scene3d.h>
+#include <algorithm>
+using namespace clan;
+
+class AnimationCompressionTest
+{
+public:
+	AnimationCompressionTest() : random_seed(12345)
+	{
+	}
+
+	void run()
+	{
+		create_library();
+
+		Console::write_line("Animation library: %1 animations, %2 bones, 60 keys/s", num_animations, num_bones);
+
+		ubyte64 start_time = System::get_microseconds();
+		std::shared_ptr<ModelDataCompressedAnimation> compressed = ModelDataCompressedAnimation::compress(*model_data, ModelDataAnimationCompression());
+		ubyte64 end_time = System::get_microseconds();
+
+		size_t uncompressed_size = ModelDataCompressedAnimation::get_uncompressed_memory_usage(*model_data);
+		size_t compressed_size = compressed->get_memory_usage();
+		Console::write_line("Compressed in %1 ms", (end_time - start_time) / 1000.0);
+		Console::write_line("Memory: %1 KB uncompressed, %2 KB compressed, ratio %3:1", (int)(uncompressed_size / 1024), (int)(compressed_size / 1024), (float)uncompressed_size / compressed_size);
+
+		int uniform_tracks = 0, reduced_tracks = 0, constant_tracks = 0;
+		for (size_t i = 0; i < compressed->tracks.size(); i++)
+		{
+			if (compressed->tracks[i].num_keys == 1)
+				constant_tracks++;
+			else if (compressed->tracks[i].is_uniform())
+				uniform_tracks++;
+			else
+				reduced_tracks++;
+		}
+		Console::write_line("Tracks: %1 constant, %2 uniform, %3 keyframe reduced", constant_tracks, uniform_tracks, reduced_tracks);
+
+		// The compressed model drops its timelines, as a loader would after compressing
+		compressed_model_data = std::shared_ptr<ModelData>(new ModelData(*model_data));
+		compressed_model_data->compressed_animation = compressed;
+		for (size_t i = 0; i < compressed_model_data->bones.size(); i++)
+		{
+			compressed_model_data->bones[i].position.timelines.clear();
+			compressed_model_data->bones[i].orientation.timelines.clear();
+			compressed_model_data->bones[i].scale.timelines.clear();
+		}
+
+		ModelDataAnimationSampler sampler(model_data);
+		ModelDataAnimationSampler compressed_sampler(compressed_model_data);
+
+		measure_error(sampler, compressed_sampler);
+		measure_decode("Uncompressed", sampler);
+		measure_decode("Compressed", compressed_sampler);
+	}
+
+private:
+	void create_library()
+	{
+		model_data = std::shared_ptr<ModelData>(new ModelData());
+		model_data->bones.resize(num_bones);
+		for (int b = 0; b < num_bones; b++)
+		{
+			model_data->bones[b].billboarded = false;
+			model_data->bones[b].parent_bone = b - 1;
+		}
+
+		for (int a = 0; a < num_animations; a++)
+		{
+			ModelDataAnimation animation;
+			animation.name = string_format("animation%1", a);
+			animation.length = random(1.0f, 4.0f);
+			animation.loop = true;
+			model_data->animations.push_back(animation);
+
+			int num_keys = (int)(animation.length * 60.0f) + 1;
+			for (int b = 0; b < num_bones; b++)
+			{
+				ModelDataBone &bone = model_data->bones[b];
+				ModelDataAnimationTimeline<Vec3f> position;
+				ModelDataAnimationTimeline<Quaternionf> orientation;
+				ModelDataAnimationTimeline<Vec3f> scale;
+
+				// Joint offsets are fixed except for the root, which moves the character
+				Vec3f offset(0.0f, random(0.05f, 0.5f), 0.0f);
+				Vec3f amplitude(random(5.0f, 60.0f), random(5.0f, 60.0f), random(0.0f, 20.0f));
+				Vec3f frequency(random(0.5f, 2.0f), random(0.5f, 2.0f), random(0.5f, 2.0f));
+				Vec3f phase(random(0.0f, 6.28f), random(0.0f, 6.28f), random(0.0f, 6.28f));
+
+				for (int k = 0; k < num_keys; k++)
+				{
+					float t = k / 60.0f;
+					Vec3f angles = amplitude * Vec3f(std::sin(frequency.x * t * 6.28f + phase.x), std::sin(frequency.y * t * 6.28f + phase.y), std::sin(frequency.z * t * 6.28f + phase.z));
+
+					position.timestamps.push_back(t);
+					position.values.push_back(b == 0 ? Vec3f(0.0f, 1.0f + 0.05f * std::sin(t * 12.0f), t * 1.5f) : offset);
+					orientation.timestamps.push_back(t);
+					orientation.values.push_back(Quaternionf(angles.x, angles.y, angles.z, angle_degrees, order_YXZ));
+					scale.timestamps.push_back(t);
+					scale.values.push_back(Vec3f(1.0f));
+				}
+
+				bone.position.timelines.push_back(position);
+				bone.orientation.timelines.push_back(orientation);
+				bone.scale.timelines.push_back(scale);
+			}
+		}
+	}
+
+	void measure_error(const ModelDataAnimationSampler &sampler, const ModelDataAnimationSampler &compressed_sampler)
+	{
+		std::vector<Vec4f> expected(num_bones * ModelDataAnimationSampler::vectors_per_bone);
+		std::vector<Vec4f> actual(expected.size());
+
+		float max_rotation_error = 0.0f;
+		float max_position_error = 0.0f;
+		for (int i = 0; i < 10000; i++)
+		{
+			int animation_index = i % num_animations;
+			float timestamp = random(0.0f, model_data->animations[animation_index].length);
+
+			ModelDataAnimationCursors cursors, compressed_cursors;
+			sampler.sample_bones(animation_index, timestamp, cursors, &expected[0]);
+			compressed_sampler.sample_bones(animation_index, timestamp, compressed_cursors, &actual[0]);
+
+			for (size_t j = 0; j < expected.size(); j++)
+			{
+				Vec4f delta = actual[j] - expected[j];
+				max_rotation_error = std::max(max_rotation_error, std::max(std::abs(delta.x), std::max(std::abs(delta.y), std::abs(delta.z))));
+				max_position_error = std::max(max_position_error, std::abs(delta.w));
+			}
+		}
+
+		Console::write_line("Max error: %1 rotation matrix element, %2 position", max_rotation_error, max_position_error);
+		if (max_rotation_error > 0.01f || max_position_error > 0.01f)
+			throw Exception("Compressed animation error is too large");
+	}
+
+	void measure_decode(const std::string &name, const ModelDataAnimationSampler &sampler)
+	{
+		const int num_instances = 2000;
+		const int num_frames = 50;
+
+		std::vector<ModelDataAnimationCursors> cursors(num_instances);
+		std::vector<float> times(num_instances);
+		for (int i = 0; i < num_instances; i++)
+			times[i] = random(0.0f, 1.0f);
+		std::vector<Vec4f> bone_vectors(num_bones * ModelDataAnimationSampler::vectors_per_bone);
+
+		ubyte64 start_time = System::get_microseconds();
+		for (int frame = 0; frame < num_frames; frame++)
+		{
+			for (int i = 0; i < num_instances; i++)
+			{
+				int animation_index = i % num_animations;
+				times[i] = std::fmod(times[i] + 1.0f / 60.0f, model_data->animations[animation_index].length);
+				sampler.sample_bones(animation_index, times[i], cursors[i], &bone_vectors[0]);
+			}
+		}
+		ubyte64 end_time = System::get_microseconds();
+
+		double bones_per_second = (double)num_frames * num_instances * num_bones * 1000000.0 / std::max(end_time - start_time, (ubyte64)1);
+		Console::write_line("%1 decode: %2 million bones/s", name, bones_per_second / 1000000.0);
+	}
+
+	float random(float min_value, float max_value)
+	{
+		random_seed = random_seed * 1664525 + 1013904223;
+		return min_value + (max_value - min_value) * ((random_seed >> 8) / 16777216.0f);
+	}
+
+	static const int num_animations = 40;
+	static const int num_bones = 60;
+
+	std::shared_ptr<ModelData> model_data;
+	std::shared_ptr<ModelData> compressed_model_data;
+	unsigned int random_seed;
+};
+
+int main(int, char**)
+{
+	SetupCore setup_core;
+	try
+	{
+		AnimationCompressionTest test;
+		test.run();
+	}
+	catch (Exception &e)
+	{
+		Console::write_line(e.message);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,226 @@
+#include <ClanLib/core.h>
+#include <ClanLib/display.h>
+#include <ClanLib/scene3d.h>
+#include <algorithm>
+using namespace clan;
+
+class Prop : public SceneItem
+{
+public:
+	Prop(const AxisAlignedBoundingBox &box) : box(box), proxy(0) { }
+
+	AxisAlignedBoundingBox box;
+	SceneCullProxy *proxy;
+};
+
+class CullBenchmark
+{
+public:
+	CullBenchmark() : random_seed(12345)
+	{
+	}
+
+	~CullBenchmark()
+	{
+		for (size_t i = 0; i < props.size(); i++)
+			delete props[i];
+	}
+
+	void run()
+	{
+		const int num_props = 200000;
+		const float world_size = 4000.0f;
+
+		Console::write_line("Scene culling, %1 props, camera view and %2 shadow cascades", num_props, (int)create_views().size() - 1);
+		Console::write_line("");
+
+		for (int i = 0; i < num_props; i++)
+		{
+			Vec3f position(random(-world_size, world_size), random(0.0f, 50.0f), random(-world_size, world_size));
+			Vec3f extents(random(0.5f, 5.0f), random(0.5f, 10.0f), random(0.5f, 5.0f));
+			props.push_back(new Prop(AxisAlignedBoundingBox(position - extents, position + extents)));
+		}
+
+		std::vector<FrustumPlanes> views = create_views();
+		std::vector<int> expected_counts;
+		for (size_t i = 0; i < views.size(); i++)
+			expected_counts.push_back((int)brute_force(views[i]).size());
+		Console::write_line("Visible per view (all planes):%1", format_counts(expected_counts));
+		Console::write_line("");
+
+		test_provider("OctTree", SceneCullProvider::create_oct_tree(AxisAlignedBoundingBox(Vec3f(-world_size), Vec3f(world_size))), false);
+		test_provider("RTree", SceneCullProvider::create_rtree(), false);
+		test_provider("BVH", SceneCullProvider::create_bvh(), true);
+	}
+
+private:
+	void test_provider(const std::string &name, std::unique_ptr<SceneCullProvider> provider, bool verify)
+	{
+		const int num_frames = 20;
+		const int moves_per_frame = (int)props.size() / 50;
+
+		std::vector<FrustumPlanes> views = create_views();
+
+		ubyte64 start_time = System::get_microseconds();
+		for (size_t i = 0; i < props.size(); i++)
+			props[i]->proxy = provider->create_proxy(props[i], props[i]->box);
+		ubyte64 insert_time = System::get_microseconds() - start_time;
+
+		// The first cull includes any deferred tree building
+		start_time = System::get_microseconds();
+		std::vector<std::vector<SceneItem *> > pvs = provider->cull_views(views);
+		ubyte64 first_cull_time = System::get_microseconds() - start_time;
+
+		std::vector<int> counts;
+		for (size_t i = 0; i < pvs.size(); i++)
+			counts.push_back((int)pvs[i].size());
+
+		Console::write_line("%1:", name);
+		Console::write_line("   insert: %1 ms, first cull: %2 ms", insert_time / 1000.0, first_cull_time / 1000.0);
+		Console::write_line("   visible per view:%1", format_counts(counts));
+
+		start_time = System::get_microseconds();
+		for (int frame = 0; frame < num_frames; frame++)
+		{
+			for (size_t i = 0; i < views.size(); i++)
+				provider->cull(views[i]);
+		}
+		double view_time = (System::get_microseconds() - start_time) / (1000.0 * num_frames);
+		Console::write_line("   cull each view: %1 ms/frame", view_time);
+
+		start_time = System::get_microseconds();
+		for (int frame = 0; frame < num_frames; frame++)
+			provider->cull_views(views);
+		double all_views_time = (System::get_microseconds() - start_time) / (1000.0 * num_frames);
+		Console::write_line("   cull all views: %1 ms/frame", all_views_time);
+
+		if (verify)
+			verify_views(*provider, views);
+
+		// Move 2% of the props each frame
+		start_time = System::get_microseconds();
+		for (int frame = 0; frame < num_frames; frame++)
+		{
+			for (int i = 0; i < moves_per_frame; i++)
+			{
+				Prop *prop = props[random_index()];
+				Vec3f offset(random(-2.0f, 2.0f), 0.0f, random(-2.0f, 2.0f));
+				prop->box = AxisAlignedBoundingBox(prop->box.aabb_min + offset, prop->box.aabb_max + offset);
+				provider->set_aabb(prop->proxy, prop->box);
+			}
+			provider->cull_views(views);
+		}
+		double dynamic_time = (System::get_microseconds() - start_time) / (1000.0 * num_frames);
+		Console::write_line("   move %1 props and cull all views: %2 ms/frame", moves_per_frame, dynamic_time);
+
+		if (verify)
+			verify_views(*provider, views);
+
+		for (size_t i = 0; i < props.size(); i++)
+		{
+			provider->delete_proxy(props[i]->proxy);
+			props[i]->proxy = 0;
+		}
+		Console::write_line("");
+	}
+
+	void verify_views(SceneCullProvider &provider, const std::vector<FrustumPlanes> &views)
+	{
+		std::vector<std::vector<SceneItem *> > pvs = provider.cull_views(views);
+		for (size_t i = 0; i < views.size(); i++)
+		{
+			std::vector<SceneItem *> expected = brute_force(views[i]);
+			std::vector<SceneItem *> single = provider.cull(views[i]);
+			std::sort(expected.begin(), expected.end());
+			std::sort(single.begin(), single.end());
+			std::sort(pvs[i].begin(), pvs[i].end());
+			if (pvs[i] != expected || single != expected)
+				throw Exception(string_format("Culling result for view %1 does not match brute force", (int)i));
+		}
+		Console::write_line("   matches brute force");
+	}
+
+	// A box is outside when its corner furthest along a plane normal is behind the plane
+	std::vector<SceneItem *> brute_force(const FrustumPlanes &frustum)
+	{
+		std::vector<SceneItem *> pvs;
+		for (size_t i = 0; i < props.size(); i++)
+		{
+			const AxisAlignedBoundingBox &box = props[i]->box;
+			bool outside = false;
+			for (int j = 0; j < 6 && !outside; j++)
+			{
+				const Vec4f &plane = frustum.planes[j];
+				Vec3f corner(plane.x >= 0.0f ? box.aabb_max.x : box.aabb_min.x, plane.y >= 0.0f ? box.aabb_max.y : box.aabb_min.y, plane.z >= 0.0f ? box.aabb_max.z : box.aabb_min.z);
+				outside = plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f;
+			}
+			if (!outside)
+				pvs.push_back(props[i]);
+		}
+		return pvs;
+	}
+
+	std::vector<FrustumPlanes> create_views()
+	{
+		Vec3f eye(0.0f, 30.0f, -200.0f);
+		Vec3f center(0.0f, 10.0f, 0.0f);
+		Vec3f light_direction = Vec3f::normalize(Vec3f(0.3f, -1.0f, 0.2f));
+
+		std::vector<FrustumPlanes> views;
+		Mat4f camera = Mat4f::perspective(60.0f, 16.0f / 9.0f, 0.1f, 1000.0f, handed_right, clip_negative_positive_w) * Mat4f::look_at(eye, center, Vec3f(0.0f, 1.0f, 0.0f));
+		views.push_back(FrustumPlanes(camera));
+
+		float cascade_size = 50.0f;
+		for (int i = 0; i < 4; i++, cascade_size *= 3.0f)
+		{
+			Vec3f cascade_center = eye + Vec3f::normalize(center - eye) * cascade_size;
+			Mat4f light_view = Mat4f::look_at(cascade_center - light_direction * 2000.0f, cascade_center, Vec3f(0.0f, 0.0f, 1.0f));
+			Mat4f light_projection = Mat4f::ortho(-cascade_size, cascade_size, -cascade_size, cascade_size, 0.1f, 4000.0f, handed_right, clip_negative_positive_w);
+			views.push_back(FrustumPlanes(light_projection * light_view));
+		}
+		return views;
+	}
+
+	std::string format_counts(const std::vector<int> &counts)
+	{
+		std::string text;
+		for (size_t i = 0; i < counts.size(); i++)
+			text += string_format(" %1", counts[i]);
+		return text;
+	}
+
+	float random(float min_value, float max_value)
+	{
+		return min_value + (max_value - min_value) * (next_random() / 16777216.0f);
+	}
+
+	int random_index()
+	{
+		return (int)(((ubyte64)next_random() * props.size()) >> 24);
+	}
+
+	unsigned int next_random()
+	{
+		random_seed = random_seed * 1664525 + 1013904223;
+		return random_seed >> 8;
+	}
+
+	std::vector<Prop *> props;
+	unsigned int random_seed;
+};
+
+int main(int, char**)
+{
+	SetupCore setup_core;
+	try
+	{
+		CullBenchmark benchmark;
+		benchmark.run();
+	}
+	catch (Exception &e)
+	{
+		Console::write_line(e.message);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,451 @@
+#include <ClanLib/core.h>
+#include <ClanLib/display.h>
+#include <ClanLib/scene3d.h>
+using namespace clan;
+
+// Loads model data from a simple format storing every vector element individually
+class SourceModelFormat
+{
+public:
+	static void save(const std::string &filename, const ModelData &model_data)
+	{
+		// DataBuffer grows to the exact size needed, so reserve the space up front
+		DataBuffer buffer;
+		size_t capacity = 64;
+		for (size_t i = 0; i < model_data.meshes.size(); i++)
+			capacity += model_data.meshes[i].vertices.size() * 72 + model_data.meshes[i].elements.size() * 4 + 64;
+		buffer.set_capacity(capacity);
+
+		IODevice_Memory device(buffer);
+		device.write_uint32(model_data.meshes.size());
+		for (size_t i = 0; i < model_data.meshes.size(); i++)
+		{
+			const ModelDataMesh &mesh = model_data.meshes[i];
+			write_vec3(device, mesh.vertices);
+			write_vec3(device, mesh.normals);
+			write_vec3(device, mesh.tangents);
+			write_vec3(device, mesh.bitangents);
+			write_vec4ub(device, mesh.bone_weights);
+			write_vec4ub(device, mesh.bone_selectors);
+			device.write_uint32(mesh.channels.size());
+			for (size_t channel = 0; channel < mesh.channels.size(); channel++)
+			{
+				device.write_uint32(mesh.channels[channel].size());
+				for (size_t j = 0; j < mesh.channels[channel].size(); j++)
+				{
+					device.write_float(mesh.channels[channel][j].x);
+					device.write_float(mesh.channels[channel][j].y);
+				}
+			}
+			device.write_uint32(mesh.elements.size());
+			for (size_t j = 0; j < mesh.elements.size(); j++)
+				device.write_uint32(mesh.elements[j]);
+			device.write_uint32(mesh.draw_ranges.size());
+			for (size_t j = 0; j < mesh.draw_ranges.size(); j++)
+			{
+				device.write_int32(mesh.draw_ranges[j].start_element);
+				device.write_int32(mesh.draw_ranges[j].num_elements);
+			}
+		}
+		File::write_bytes(filename, device.get_data());
+	}
+
+	static std::shared_ptr<ModelData> load(const std::string &filename)
+	{
+		loads_performed.increment();
+
+		DataBuffer buffer = File::read_bytes(filename);
+		IODevice_Memory device(buffer);
+		std::shared_ptr<ModelData> model_data(new ModelData());
+		model_data->meshes.resize(device.read_uint32());
+		for (size_t i = 0; i < model_data->meshes.size(); i++)
+		{
+			ModelDataMesh &mesh = model_data->meshes[i];
+			read_vec3(device, mesh.vertices);
+			read_vec3(device, mesh.normals);
+			read_vec3(device, mesh.tangents);
+			read_vec3(device, mesh.bitangents);
+			read_vec4ub(device, mesh.bone_weights);
+			read_vec4ub(device, mesh.bone_selectors);
+			mesh.channels.resize(device.read_uint32());
+			for (size_t channel = 0; channel < mesh.channels.size(); channel++)
+			{
+				mesh.channels[channel].resize(device.read_uint32());
+				for (size_t j = 0; j < mesh.channels[channel].size(); j++)
+				{
+					mesh.channels[channel][j].x = device.read_float();
+					mesh.channels[channel][j].y = device.read_float();
+				}
+			}
+			mesh.elements.resize(device.read_uint32());
+			for (size_t j = 0; j < mesh.elements.size(); j++)
+				mesh.elements[j] = device.read_uint32();
+			mesh.draw_ranges.resize(device.read_uint32());
+			for (size_t j = 0; j < mesh.draw_ranges.size(); j++)
+			{
+				mesh.draw_ranges[j].start_element = device.read_int32();
+				mesh.draw_ranges[j].num_elements = device.read_int32();
+			}
+		}
+		return model_data;
+	}
+
+	static InterlockedVariable loads_performed;
+
+private:
+	static void write_vec3(IODevice &device, const std::vector<Vec3f> &values)
+	{
+		device.write_uint32(values.size());
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			device.write_float(values[i].x);
+			device.write_float(values[i].y);
+			device.write_float(values[i].z);
+		}
+	}
+
+	static void write_vec4ub(IODevice &device, const std::vector<Vec4ub> &values)
+	{
+		device.write_uint32(values.size());
+		for (size_t i = 0; i < values.size(); i++)
+			device.write(&values[i], 4);
+	}
+
+	static void read_vec3(IODevice &device, std::vector<Vec3f> &values)
+	{
+		values.resize(device.read_uint32());
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			values[i].x = device.read_float();
+			values[i].y = device.read_float();
+			values[i].z = device.read_float();
+		}
+	}
+
+	static void read_vec4ub(IODevice &device, std::vector<Vec4ub> &values)
+	{
+		values.resize(device.read_uint32());
+		for (size_t i = 0; i < values.size(); i++)
+			device.read(&values[i], 4);
+	}
+};
+
+InterlockedVariable SourceModelFormat::loads_performed;
+
+class ModelDataFileTest
+{
+public:
+	ModelDataFileTest() : random_seed(12345), test_path("ModelDataFileTest")
+	{
+	}
+
+	void run()
+	{
+		Directory::create(test_path);
+		std::string source_filename = PathHelp::combine(test_path, "model.source");
+		std::string binary_filename = PathHelp::combine(test_path, "model.cmodel");
+
+		std::shared_ptr<ModelData> model_data = create_model(32, 20000);
+		SourceModelFormat::save(source_filename, *model_data);
+		ModelDataFile::save(binary_filename, *model_data);
+
+		test_round_trip(*model_data, binary_filename);
+		test_level_round_trip();
+		test_invalid_files(binary_filename);
+		benchmark(source_filename, binary_filename);
+		test_cache(source_filename);
+
+		Directory::remove(test_path, true, true);
+		Console::write_line("All tests passed");
+	}
+
+private:
+	void test_round_trip(const ModelData &model_data, const std::string &binary_filename)
+	{
+		std::shared_ptr<ModelData> loaded = ModelDataFile::load(binary_filename);
+		check(loaded->meshes.size() == model_data.meshes.size(), "Mesh count differs");
+		for (size_t i = 0; i < model_data.meshes.size(); i++)
+		{
+			const ModelDataMesh &mesh = model_data.meshes[i];
+			const ModelDataMeshStream &stream = loaded->meshes[i].stream;
+			check(!stream.is_null() && stream.num_vertices == (int)mesh.vertices.size(), "Mesh stream missing");
+			check(((size_t)stream.vertex_data) % 16 == 0, "Vertex stream not aligned");
+
+			compare_attribute(stream, ModelDataMeshStream::attribute_vertices, mesh.vertices);
+			compare_attribute(stream, ModelDataMeshStream::attribute_normals, mesh.normals);
+			compare_attribute(stream, ModelDataMeshStream::attribute_tangents, mesh.tangents);
+			compare_attribute(stream, ModelDataMeshStream::attribute_bitangents, mesh.bitangents);
+			compare_attribute(stream, ModelDataMeshStream::attribute_bone_weights, mesh.bone_weights);
+			compare_attribute(stream, ModelDataMeshStream::attribute_bone_selectors, mesh.bone_selectors);
+			compare_attribute(stream, ModelDataMeshStream::attribute_channels, mesh.channels[0]);
+			check(stream.attribute_offsets[ModelDataMeshStream::attribute_colors] == -1, "Missing attribute stored");
+
+			check(stream.num_elements == (int)mesh.elements.size() && memcmp(stream.element_data, &mesh.elements[0], mesh.elements.size() * sizeof(unsigned int)) == 0, "Elements differ");
+			check(loaded->meshes[i].draw_ranges.size() == mesh.draw_ranges.size(), "Draw ranges differ");
+			check(loaded->meshes[i].draw_ranges[0].diffuse.get_single_value() == mesh.draw_ranges[0].diffuse.get_single_value(), "Material differs");
+		}
+
+		check(loaded->bones.size() == model_data.bones.size(), "Bone count differs");
+		for (size_t i = 0; i < model_data.bones.size(); i++)
+		{
+			check(loaded->bones[i].parent_bone == model_data.bones[i].parent_bone, "Bone parent differs");
+			check(loaded->bones[i].orientation.timelines[0].values == model_data.bones[i].orientation.timelines[0].values, "Bone orientation differs");
+			check(loaded->bones[i].position.timelines[0].timestamps == model_data.bones[i].position.timelines[0].timestamps, "Bone timestamps differ");
+		}
+		check(loaded->animations.size() == 1 && loaded->animations[0].name == "walk" && loaded->animations[0].length == 2.0f, "Animation differs");
+		check(loaded->textures.size() == 1 && loaded->textures[0].name == "diffuse.png", "Texture differs");
+		check(loaded->aabb_max == model_data.aabb_max, "Bounding box differs");
+		check(loaded->compressed_animation && loaded->compressed_animation->tracks.size() == model_data.compressed_animation->tracks.size(), "Compressed animation differs");
+
+		// Saving mapped data writes the stream unchanged
+		std::string resaved_filename = PathHelp::combine(test_path, "resaved.cmodel");
+		ModelDataFile::save(resaved_filename, *loaded);
+		DataBuffer original_bytes = File::read_bytes(binary_filename);
+		DataBuffer resaved_bytes = File::read_bytes(resaved_filename);
+		check(original_bytes.get_size() == resaved_bytes.get_size() && memcmp(original_bytes.get_data(), resaved_bytes.get_data(), original_bytes.get_size()) == 0, "Saving mapped model data changed the file");
+
+		Console::write_line("Model round trip: ok");
+	}
+
+	void test_level_round_trip()
+	{
+		LevelData level_data;
+		level_data.portals.resize(2);
+		level_data.portals[1].points.push_back(Vec3f(1.0f, 2.0f, 3.0f));
+		level_data.portals[1].points.push_back(Vec3f(4.0f, 5.0f, 6.0f));
+		level_data.portals[1].front = 0;
+		level_data.portals[1].back = 1;
+		level_data.sectors.resize(2);
+		level_data.sectors[0].portals.push_back(1);
+		level_data.sectors[1].objects.push_back(0);
+		LevelDataObject object;
+		object.model_filename = "crate.cmodel";
+		object.position = Vec3f(10.0f, 0.0f, 5.0f);
+		object.scale = Vec3f(1.0f);
+		level_data.objects.push_back(object);
+		level_data.lights.push_back(LevelDataLight(Vec3f(1.0f), Quaternionf(), Vec3f(0.5f), 1.0f, 10.0f, 30.0f, 20.0f, true));
+		level_data.level_sets.push_back("default");
+		level_data.aabb_max = Vec3f(100.0f);
+
+		std::string filename = PathHelp::combine(test_path, "level.clevel");
+		LevelDataFile::save(filename, level_data);
+		std::shared_ptr<LevelData> loaded = LevelDataFile::load(filename);
+
+		check(loaded->portals.size() == 2 && loaded->portals[1].points == level_data.portals[1].points && loaded->portals[1].back == 1, "Portals differ");
+		check(loaded->sectors.size() == 2 && loaded->sectors[0].portals == level_data.sectors[0].portals && loaded->sectors[1].objects == level_data.sectors[1].objects, "Sectors differ");
+		check(loaded->objects.size() == 1 && loaded->objects[0].model_filename == "crate.cmodel" && loaded->objects[0].position == object.position, "Objects differ");
+		check(loaded->lights.size() == 1 && loaded->lights[0].casts_shadows && loaded->lights[0].attenuation_end == 10.0f, "Lights differ");
+		check(loaded->level_sets.size() == 1 && loaded->level_sets[0] == "default" && loaded->aabb_max == level_data.aabb_max, "Level differs");
+
+		Console::write_line("Level round trip: ok");
+	}
+
+	void test_invalid_files(const std::string &binary_filename)
+	{
+		DataBuffer bytes = File::read_bytes(binary_filename);
+
+		// Another format version
+		DataBuffer other_version(bytes);
+		other_version.get_data()[4] = (char)(ModelDataFile::version + 1);
+		check(fails_to_load(other_version), "Loaded a file from another version");
+
+		// Truncated file
+		DataBuffer truncated(bytes.get_data(), bytes.get_size() / 2);
+		check(fails_to_load(truncated), "Loaded a truncated file");
+
+		// Level file loaded as a model
+		check(fails_to_load(File::read_bytes(PathHelp::combine(test_path, "level.clevel"))), "Loaded a level file as a model");
+
+		Console::write_line("Invalid files rejected: ok");
+	}
+
+	bool fails_to_load(const DataBuffer &bytes)
+	{
+		std::string filename = PathHelp::combine(test_path, "invalid.cmodel");
+		File::write_bytes(filename, bytes);
+		try
+		{
+			ModelDataFile::load(filename);
+			return false;
+		}
+		catch (Exception &)
+		{
+			return true;
+		}
+	}
+
+	void benchmark(const std::string &source_filename, const std::string &binary_filename)
+	{
+		const int iterations = 10;
+
+		ubyte64 start_time = System::get_microseconds();
+		for (int i = 0; i < iterations; i++)
+			SourceModelFormat::load(source_filename);
+		ubyte64 source_time = System::get_microseconds() - start_time;
+
+		start_time = System::get_microseconds();
+		for (int i = 0; i < iterations; i++)
+			ModelDataFile::load(binary_filename);
+		ubyte64 binary_time = System::get_microseconds() - start_time;
+
+		// Reading every page of the streams includes the cost of faulting in the mapping, as a GPU upload would
+		unsigned int checksum = 0;
+		start_time = System::get_microseconds();
+		for (int i = 0; i < iterations; i++)
+		{
+			std::shared_ptr<ModelData> model_data = ModelDataFile::load(binary_filename);
+			for (size_t j = 0; j < model_data->meshes.size(); j++)
+			{
+				const ModelDataMeshStream &stream = model_data->meshes[j].stream;
+				size_t size = (size_t)stream.num_vertices * stream.vertex_stride;
+				for (size_t offset = 0; offset < size; offset += 4096)
+					checksum += stream.vertex_data[offset];
+			}
+		}
+		ubyte64 touched_time = System::get_microseconds() - start_time;
+
+		int file_size = File::read_bytes(binary_filename).get_size();
+		Console::write_line("Model with 32 meshes of 20000 vertices, %1 KB binary file", file_size / 1024);
+		Console::write_line("Per-element source load: %1 ms", source_time / 1000.0 / iterations);
+		Console::write_line("Mapped binary load: %1 ms", binary_time / 1000.0 / iterations);
+		Console::write_line("Mapped binary load, streams read: %1 ms (checksum %2)", touched_time / 1000.0 / iterations, (int)(checksum & 0xff));
+	}
+
+	void test_cache(const std::string &source_filename)
+	{
+		std::string cache_path = PathHelp::combine(test_path, "cache", PathHelp::path_type_file);
+		SceneDataFileCache cache(cache_path, SceneDataFileCache::ModelLoader(&SourceModelFormat::load));
+
+		int loads = SourceModelFormat::loads_performed.get();
+		std::shared_ptr<ModelData> first = cache.get_model_data(source_filename);
+		check(SourceModelFormat::loads_performed.get() == loads + 1 && first->meshes[0].stream.is_null(), "Cache miss did not load the source");
+
+		cache.wait_for_conversions();
+		check(cache.get_pending_conversions() == 0, "Conversions still pending");
+		check(FileHelp::file_exists(cache.get_model_cache_filename(source_filename)), "Conversion not written");
+
+		std::shared_ptr<ModelData> second = cache.get_model_data(source_filename);
+		check(SourceModelFormat::loads_performed.get() == loads + 1 && !second->meshes[0].stream.is_null(), "Cache hit loaded the source");
+
+		// An edited source gets a new cache entry
+		std::string old_cache_filename = cache.get_model_cache_filename(source_filename);
+		std::shared_ptr<ModelData> edited = create_model(2, 1000);
+		SourceModelFormat::save(source_filename, *edited);
+		check(cache.get_model_cache_filename(source_filename) != old_cache_filename, "Edited source has the same cache filename");
+
+		cache.convert_model(source_filename);
+		cache.wait_for_conversions();
+		check(SourceModelFormat::loads_performed.get() == loads + 2, "Background conversion did not load the source");
+
+		std::shared_ptr<ModelData> converted = cache.get_model_data(source_filename);
+		check(SourceModelFormat::loads_performed.get() == loads + 2 && converted->meshes.size() == 2 && converted->meshes[0].stream.num_vertices == 1000, "Converted model differs");
+
+		Console::write_line("Conversion cache: ok");
+	}
+
+	std::shared_ptr<ModelData> create_model(int num_meshes, int num_vertices)
+	{
+		std::shared_ptr<ModelData> model_data(new ModelData());
+		model_data->meshes.resize(num_meshes);
+		for (int i = 0; i < num_meshes; i++)
+		{
+			ModelDataMesh &mesh = model_data->meshes[i];
+			mesh.channels.resize(1);
+			for (int j = 0; j < num_vertices; j++)
+			{
+				mesh.vertices.push_back(Vec3f(random(-10.0f, 10.0f), random(-10.0f, 10.0f), random(-10.0f, 10.0f)));
+				mesh.normals.push_back(Vec3f(random(-1.0f, 1.0f), random(-1.0f, 1.0f), random(-1.0f, 1.0f)));
+				mesh.tangents.push_back(Vec3f(random(-1.0f, 1.0f), random(-1.0f, 1.0f), random(-1.0f, 1.0f)));
+				mesh.bitangents.push_back(Vec3f(random(-1.0f, 1.0f), random(-1.0f, 1.0f), random(-1.0f, 1.0f)));
+				mesh.bone_weights.push_back(Vec4ub(255, 0, 0, 0));
+				mesh.bone_selectors.push_back(Vec4ub(j % 32, 0, 0, 0));
+				mesh.channels[0].push_back(Vec2f(random(0.0f, 1.0f), random(0.0f, 1.0f)));
+			}
+			for (int j = 0; j + 2 < num_vertices; j++)
+			{
+				mesh.elements.push_back(j);
+				mesh.elements.push_back(j + 1);
+				mesh.elements.push_back(j + 2);
+			}
+
+			ModelDataDrawRange range;
+			range.start_element = 0;
+			range.num_elements = mesh.elements.size();
+			range.diffuse.set_single_value(Vec3f(0.8f, 0.7f, 0.6f));
+			range.diffuse_map.texture = 0;
+			range.diffuse_map.channel = 0;
+			mesh.draw_ranges.push_back(range);
+		}
+
+		model_data->textures.push_back(ModelDataTexture("diffuse.png", 2.2f));
+
+		ModelDataAnimation animation;
+		animation.name = "walk";
+		animation.length = 2.0f;
+		animation.loop = true;
+		model_data->animations.push_back(animation);
+
+		model_data->bones.resize(32);
+		for (size_t i = 0; i < model_data->bones.size(); i++)
+		{
+			ModelDataBone &bone = model_data->bones[i];
+			bone.parent_bone = (short)i - 1;
+			bone.position.timelines.resize(1);
+			bone.orientation.timelines.resize(1);
+			bone.scale.set_single_value(Vec3f(1.0f));
+			for (int key = 0; key < 60; key++)
+			{
+				float timestamp = key / 30.0f;
+				bone.position.timelines[0].timestamps.push_back(timestamp);
+				bone.position.timelines[0].values.push_back(Vec3f(0.0f, random(0.0f, 1.0f), 0.0f));
+				bone.orientation.timelines[0].timestamps.push_back(timestamp);
+				bone.orientation.timelines[0].values.push_back(Quaternionf(random(-30.0f, 30.0f), random(-30.0f, 30.0f), 0.0f, angle_degrees, order_YXZ));
+			}
+		}
+
+		model_data->aabb_min = Vec3f(-10.0f);
+		model_data->aabb_max = Vec3f(10.0f);
+		model_data->compressed_animation = ModelDataCompressedAnimation::compress(*model_data);
+		return model_data;
+	}
+
+	template<typename Type>
+	void compare_attribute(const ModelDataMeshStream &stream, int attribute, const std::vector<Type> &values)
+	{
+		int offset = stream.attribute_offsets[attribute];
+		check(offset != -1 && ModelDataMeshStream::get_attribute_size(attribute) == sizeof(Type), "Attribute missing");
+		for (size_t i = 0; i < values.size(); i++)
+			check(memcmp(stream.vertex_data + i * stream.vertex_stride + offset, &values[i], sizeof(Type)) == 0, "Attribute differs");
+	}
+
+	void check(bool condition, const std::string &message)
+	{
+		if (!condition)
+			throw Exception(message);
+	}
+
+	float random(float min_value, float max_value)
+	{
+		random_seed = random_seed * 1664525 + 1013904223;
+		return min_value + (max_value - min_value) * ((random_seed >> 8) / 16777216.0f);
+	}
+
+	unsigned int random_seed;
+	std::string test_path;
+};
+
+int main(int, char**)
+{
+	SetupCore setup_core;
+	try
+	{
+		ModelDataFileTest test;
+		test.run();
+	}
+	catch (Exception &e)
+	{
+		Console::write_line(e.message);
+		return 1;
+	}
+	return 0;
+}
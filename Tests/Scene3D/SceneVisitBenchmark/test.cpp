@@ -0,0 +1,237 @@
+#include <ClanLib/core.h>
+#include <ClanLib/display.h>
+#include <ClanLib/gl.h>
+#include <ClanLib/scene3d.h>
+#include <map>
+using namespace clan;
+
+// Procedural scene cache so the benchmark does not depend on exported model files
+class BoxSceneCache : public SceneCache
+{
+public:
+	std::shared_ptr<ModelData> get_model_data(const std::string &name)
+	{
+		if (name != "box")
+			throw Exception(string_format("Unknown model: %1", name));
+		return create_box();
+	}
+
+	Resource<Texture> get_texture(GraphicContext &gc, const std::string &name, bool linear)
+	{
+		std::map<std::string, Resource<Texture> >::iterator it = loaded_textures.find(name);
+		if (it != loaded_textures.end())
+			return it->second;
+
+		ImageImportDescription desc;
+		desc.set_srgb(!linear);
+
+		Resource<Texture> texture;
+		texture.set(Texture2D(gc, name, desc));
+		loaded_textures[name] = texture;
+		return texture;
+	}
+
+	void update_textures(GraphicContext &gc, float time_elapsed)
+	{
+	}
+
+private:
+	static void set_map(ModelDataTextureMap &map, int channel)
+	{
+		map.channel = channel;
+		map.texture = 0;
+		map.uvw_offset.set_single_value(Vec3f());
+		map.uvw_rotation.set_single_value(Quaternionf());
+		map.uvw_scale.set_single_value(Vec3f(1.0f));
+	}
+
+	std::shared_ptr<ModelData> create_box()
+	{
+		std::shared_ptr<ModelData> model_data(new ModelData());
+
+		float size = 1.0f;
+
+		model_data->aabb_min = Vec3f(-size);
+		model_data->aabb_max = Vec3f(size);
+
+		model_data->animations.resize(1);
+		model_data->animations[0].name = "default";
+
+		model_data->textures.resize(1);
+		model_data->textures[0].gamma = 2.2f;
+		model_data->textures[0].name = "../../../Examples/3D/Object3D/Resources/tux.png";
+
+		model_data->meshes.resize(1);
+		ModelDataMesh &mesh = model_data->meshes[0];
+		mesh.channels.resize(4);
+
+		Vec3f normal[6] = { Vec3f(0.0f, 1.0f, 0.0f), Vec3f(0.0f, -1.0f, 0.0f), Vec3f(1.0f, 0.0f, 0.0f), Vec3f(-1.0f, 0.0f, 0.0f), Vec3f(0.0f, 0.0f, 1.0f), Vec3f(0.0f, 0.0f, -1.0f) };
+		Vec3f tangent[6] = { Vec3f(1.0, 0.0f, 0.0f), Vec3f(1.0, 0.0f, 0.0f), Vec3f(0.0f, 1.0f, 0.0f), Vec3f(0.0f, -1.0f, 0.0f), Vec3f(0.0f, 1.0f, 0.0f), Vec3f(0.0f, -1.0f, 0.0f) };
+
+		for (int i = 0; i < 6; i++)
+		{
+			Vec3f bitangent = Vec3f::cross(normal[i], tangent[i]);
+
+			mesh.vertices.push_back((normal[i] - tangent[i] - bitangent) * size);
+			mesh.vertices.push_back((normal[i] + tangent[i] - bitangent) * size);
+			mesh.vertices.push_back((normal[i] - tangent[i] + bitangent) * size);
+			mesh.vertices.push_back((normal[i] + tangent[i] + bitangent) * size);
+
+			for (int j = 0; j < 4; j++)
+			{
+				mesh.normals.push_back(normal[i]);
+				mesh.tangents.push_back(tangent[i]);
+				mesh.bitangents.push_back(bitangent);
+				mesh.channels[j].push_back(Vec2f(0.0f, 0.0f));
+				mesh.channels[j].push_back(Vec2f(1.0f, 0.0f));
+				mesh.channels[j].push_back(Vec2f(0.0f, 1.0f));
+				mesh.channels[j].push_back(Vec2f(1.0f, 1.0f));
+			}
+
+			mesh.elements.push_back(i * 4 + 0);
+			mesh.elements.push_back(i * 4 + 1);
+			mesh.elements.push_back(i * 4 + 2);
+			mesh.elements.push_back(i * 4 + 3);
+			mesh.elements.push_back(i * 4 + 2);
+			mesh.elements.push_back(i * 4 + 1);
+		}
+
+		ModelDataDrawRange range;
+		range.start_element = 0;
+		range.num_elements = 36;
+		range.ambient.set_single_value(Vec3f(1.0f));
+		range.diffuse.set_single_value(Vec3f(1.0f));
+		range.specular.set_single_value(Vec3f(1.0f));
+		range.glossiness.set_single_value(20.0f);
+		range.specular_level.set_single_value(25.0f);
+		range.self_illumination_amount.set_single_value(0.0f);
+		range.self_illumination.set_single_value(Vec3f());
+		set_map(range.diffuse_map, 0);
+		set_map(range.specular_map, 1);
+		mesh.draw_ranges.push_back(range);
+
+		return model_data;
+	}
+
+	std::map<std::string, Resource<Texture> > loaded_textures;
+};
+
+class SceneVisitBenchmark
+{
+public:
+	SceneVisitBenchmark(DisplayWindow &window) : window(window), gc(window.get_gc()), random_seed(12345)
+	{
+	}
+
+	void run()
+	{
+		ResourceManager resources;
+		SceneCache::set(resources, std::shared_ptr<SceneCache>(new BoxSceneCache()));
+
+		Scene scene(gc, resources, "../../../Resources/Scene3D");
+		scene.set_cull_bvh();
+
+		SceneCamera camera(scene);
+		camera.set_position(Vec3f(0.0f, 40.0f, -150.0f));
+		camera.set_orientation(Quaternionf(15.0f, 0.0f, 0.0f, angle_degrees, order_YXZ));
+		scene.set_camera(camera);
+
+		SceneModel box(gc, scene, "box");
+
+		std::vector<SceneObject> objects;
+		for (int i = 0; i < num_objects; i++)
+		{
+			Vec3f position(random(-300.0f, 300.0f), random(0.0f, 20.0f), random(-300.0f, 300.0f));
+			objects.push_back(SceneObject(scene, box, position, Quaternionf(0.0f, random(0.0f, 360.0f), 0.0f, angle_degrees, order_YXZ)));
+		}
+
+		std::vector<SceneLight> lights;
+		for (int i = 0; i < num_lights; i++)
+		{
+			SceneLight spot(scene);
+			spot.set_type(SceneLight::type_spot);
+			spot.set_position(Vec3f(random(-150.0f, 150.0f), 60.0f, random(-100.0f, 150.0f)));
+			spot.set_orientation(Quaternionf(90.0f, random(0.0f, 360.0f), 0.0f, angle_degrees, order_YXZ));
+			spot.set_color(Vec3f(1.0f));
+			spot.set_falloff(45.0f);
+			spot.set_hotspot(15.0f);
+			spot.set_attenuation_start(20.0f);
+			spot.set_attenuation_end(100.0f);
+			spot.set_shadow_caster(true);
+			spot.set_aspect_ratio(1.0f);
+			lights.push_back(spot);
+		}
+
+		Console::write_line("Scene visit CPU time, %1 objects, %2 shadow casting spot lights", num_objects, num_lights);
+
+		scene.set_visit_threads(0);
+		measure(scene, "serial");
+
+		scene.set_visit_threads(System::get_num_cores() - 1);
+		measure(scene, string_format("%1 worker threads", System::get_num_cores() - 1));
+	}
+
+private:
+	void measure(Scene &scene, const std::string &name)
+	{
+		for (int i = 0; i < warmup_frames; i++)
+			render_frame(scene);
+
+		ubyte64 total_time = 0;
+		for (int i = 0; i < num_frames; i++)
+			total_time += render_frame(scene);
+
+		Console::write_line("%1: %2 ms/frame", name, total_time / (num_frames * 1000.0));
+	}
+
+	ubyte64 render_frame(Scene &scene)
+	{
+		scene.set_viewport(gc.get_size());
+
+		ubyte64 start_time = System::get_microseconds();
+		scene.render(gc);
+		ubyte64 end_time = System::get_microseconds();
+
+		window.flip(0);
+		KeepAlive::process();
+		return end_time - start_time;
+	}
+
+	float random(float min_value, float max_value)
+	{
+		random_seed = random_seed * 1664525 + 1013904223;
+		return min_value + (max_value - min_value) * ((random_seed >> 8) / 16777216.0f);
+	}
+
+	static const int num_objects = 20000;
+	static const int num_lights = 64;
+	static const int warmup_frames = 10;
+	static const int num_frames = 100;
+
+	DisplayWindow &window;
+	GraphicContext gc;
+	unsigned int random_seed;
+};
+
+int main(int, char**)
+{
+	SetupCore setup_core;
+	SetupDisplay setup_display;
+	SetupGL setup_gl;
+	try
+	{
+		OpenGLWindowDescription opengl_desc;
+		opengl_desc.set_version(3, 2, false);
+		OpenGLTarget::set_description(opengl_desc);
+
+		DisplayWindow window("Scene visit benchmark", 1280, 720, false, false);
+		SceneVisitBenchmark benchmark(window);
+		benchmark.run();
+	}
+	catch (Exception &e)
+	{
+		Console::write_line(e.message);
+		return 1;
+	}
+	return 0;
+}
@@ -802,6 +802,15 @@ void FBXModelLoader::convert_bones()
 		// FbxMatrix &object_to_world = scene_evaluator->GetNodeGlobalTransform(node, current_time);
 		// FbxAnimCurveNode &value = scene_evaluator->GetPropertyValue(value, current_time);
 	}
+
+	// The tracks are sampled at 60 fps. Compress them and drop the raw timelines.
+	model_data->compressed_animation = ModelDataCompressedAnimation::compress(*model_data);
+	for (size_t bone_index = 0; bone_index < model_data->bones.size(); bone_index++)
+	{
+		model_data->bones[bone_index].position.timelines.clear();
+		model_data->bones[bone_index].orientation.timelines.clear();
+		model_data->bones[bone_index].scale.timelines.clear();
+	}
 }
 
 Vec2f FBXModelLoader::to_vec2f(const FbxVector2 &v)